@@ -0,0 +1,393 @@
+#include "alloc_stats.h"
+
+#ifdef C_PASS_ALLOC_STATS
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+// Marks blocks handed out by the wrappers, anything else is freed uncounted
+#define ALLOC_MAGIC 0x414C4C43u
+
+// Placed in front of every counted block, keeps the alignment malloc guarantees
+union alloc_header {
+    struct {
+        size_t size;
+        int32_t subsystem;
+        uint32_t magic;
+    } info;
+    max_align_t align;
+};
+
+struct subsystem_stats {
+    char name[64];        // Source file, prefixed with "secure " for the secure heap
+    size_t live_bytes;
+    size_t peak_bytes;
+    uint64_t allocations;
+    uint64_t reallocations;
+    uint64_t frees;
+    uint64_t total_bytes; // Bytes ever allocated
+    uint64_t histogram[ALLOC_HISTOGRAM_BUCKETS];
+};
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct subsystem_stats subsystems[MAX_ALLOC_SUBSYSTEMS];
+static int num_subsystems;
+static size_t live_bytes;
+static size_t peak_bytes;
+static uint64_t foreign_frees; // Blocks freed that the wrappers did not allocate
+static int report_fd = -1;     // Duplicate of stderr taken at startup
+#ifndef _WIN32
+static int signal_pipe[2] = {-1, -1};
+#endif
+
+
+/*
+ * Get the bucket of an allocation size, bucket i holds sizes up to 2^i
+ */
+static int histogram_bucket(size_t size) {
+    int bucket = 0;
+    while (bucket < ALLOC_HISTOGRAM_BUCKETS - 1 && ((size_t) 1 << bucket) < size)
+        bucket++;
+    return bucket;
+}
+
+
+/*
+ * Get the id of the subsystem of a source file, registering it on first use. Needs stats_lock
+ *
+ * param int* subsystem: Cached id of the source file, -1 before the first allocation
+ * param const char* file: Path of the source file
+ * param bool secure: Whether the allocation is on the secure heap
+ * return int: The id, the last one is shared once MAX_ALLOC_SUBSYSTEMS are in use
+ */
+static int subsystem_id(int *subsystem, const char *file, const bool secure) {
+    if (*subsystem >= 0)
+        return *subsystem;
+    const char *name = file;
+    for (const char *c = file; *c; c++) {
+        if (*c == '/' || *c == '\\')
+            name = c + 1;
+    }
+    char tag[sizeof(subsystems[0].name)];
+    snprintf(tag, sizeof(tag), "%s%s", secure ? "secure " : "", name);
+    int id = 0;
+    while (id < num_subsystems && strcmp(subsystems[id].name, tag) != 0)
+        id++;
+    if (id == num_subsystems) {
+        if (num_subsystems < MAX_ALLOC_SUBSYSTEMS)
+            memcpy(subsystems[num_subsystems++].name, tag, sizeof(tag));
+        else
+            id = MAX_ALLOC_SUBSYSTEMS - 1;
+    }
+    *subsystem = id;
+    return id;
+}
+
+
+/*
+ * Account for a new block and fill its header
+ */
+static void count_allocation(union alloc_header *header, int *subsystem, const char *file, const bool secure, const size_t size) {
+    alloc_stats_init();
+    pthread_mutex_lock(&stats_lock);
+    const int id = subsystem_id(subsystem, file, secure);
+    struct subsystem_stats *stats = &subsystems[id];
+    stats->allocations++;
+    stats->total_bytes += size;
+    stats->histogram[histogram_bucket(size)]++;
+    stats->live_bytes += size;
+    if (stats->live_bytes > stats->peak_bytes)
+        stats->peak_bytes = stats->live_bytes;
+    live_bytes += size;
+    if (live_bytes > peak_bytes)
+        peak_bytes = live_bytes;
+    pthread_mutex_unlock(&stats_lock);
+    header->info.size = size;
+    header->info.subsystem = id;
+    header->info.magic = ALLOC_MAGIC;
+}
+
+
+/*
+ * Account for a released block
+ */
+static void count_free(const union alloc_header *header) {
+    pthread_mutex_lock(&stats_lock);
+    struct subsystem_stats *stats = &subsystems[header->info.subsystem];
+    stats->frees++;
+    stats->live_bytes -= header->info.size;
+    live_bytes -= header->info.size;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+
+/*
+ * Account for a block that was resized in place or moved
+ */
+static void count_reallocation(union alloc_header *header, const size_t size) {
+    pthread_mutex_lock(&stats_lock);
+    struct subsystem_stats *stats = &subsystems[header->info.subsystem];
+    stats->reallocations++;
+    stats->histogram[histogram_bucket(size)]++;
+    stats->live_bytes = stats->live_bytes - header->info.size + size;
+    if (stats->live_bytes > stats->peak_bytes)
+        stats->peak_bytes = stats->live_bytes;
+    if (size > header->info.size)
+        stats->total_bytes += size - header->info.size;
+    live_bytes = live_bytes - header->info.size + size;
+    if (live_bytes > peak_bytes)
+        peak_bytes = live_bytes;
+    pthread_mutex_unlock(&stats_lock);
+    header->info.size = size;
+}
+
+
+static union alloc_header *header_of(void *ptr) {
+    return (union alloc_header *) ptr - 1;
+}
+
+
+void *counted_malloc(int *subsystem, const char *file, const size_t size) {
+    if (size > SIZE_MAX - sizeof(union alloc_header))
+        return NULL;
+    union alloc_header *header = malloc(sizeof(union alloc_header) + size);
+    if (!header)
+        return NULL;
+    count_allocation(header, subsystem, file, false, size);
+    return header + 1;
+}
+
+
+void *counted_calloc(int *subsystem, const char *file, const size_t count, const size_t size) {
+    if (size != 0 && count > (SIZE_MAX - sizeof(union alloc_header)) / size)
+        return NULL;
+    union alloc_header *header = calloc(1, sizeof(union alloc_header) + count * size);
+    if (!header)
+        return NULL;
+    count_allocation(header, subsystem, file, false, count * size);
+    return header + 1;
+}
+
+
+void *counted_realloc(int *subsystem, const char *file, void *ptr, const size_t size) {
+    if (!ptr)
+        return counted_malloc(subsystem, file, size);
+    union alloc_header *header = header_of(ptr);
+    if (header->info.magic != ALLOC_MAGIC)
+        return realloc(ptr, size);
+    if (size > SIZE_MAX - sizeof(union alloc_header))
+        return NULL;
+    union alloc_header copy = *header;
+    union alloc_header *moved = realloc(header, sizeof(union alloc_header) + size);
+    if (!moved)
+        return NULL;
+    *moved = copy;
+    count_reallocation(moved, size);
+    return moved + 1;
+}
+
+
+char *counted_strdup(int *subsystem, const char *file, const char *text) {
+    const size_t length = strlen(text);
+    char *copy = counted_malloc(subsystem, file, length + 1);
+    if (copy)
+        memcpy(copy, text, length + 1);
+    return copy;
+}
+
+
+char *counted_strndup(int *subsystem, const char *file, const char *text, const size_t length) {
+    size_t copied = 0;
+    while (copied < length && text[copied])
+        copied++;
+    char *copy = counted_malloc(subsystem, file, copied + 1);
+    if (copy) {
+        memcpy(copy, text, copied);
+        copy[copied] = '\0';
+    }
+    return copy;
+}
+
+
+void counted_free(void *ptr) {
+    if (!ptr)
+        return;
+    union alloc_header *header = header_of(ptr);
+    if (header->info.magic != ALLOC_MAGIC) {
+        // Allocated outside the wrappers, e.g. by a library
+        pthread_mutex_lock(&stats_lock);
+        foreign_frees++;
+        pthread_mutex_unlock(&stats_lock);
+        free(ptr);
+        return;
+    }
+    count_free(header);
+    header->info.magic = 0;
+    free(header);
+}
+
+
+void *counted_secure_malloc(int *subsystem, const char *file, const size_t size) {
+    if (size > SIZE_MAX - sizeof(union alloc_header))
+        return NULL;
+    union alloc_header *header = secure_malloc(sizeof(union alloc_header) + size);
+    if (!header)
+        return NULL;
+    count_allocation(header, subsystem, file, true, size);
+    return header + 1;
+}
+
+
+void *counted_secure_realloc(int *subsystem, const char *file, void *ptr, const size_t size) {
+    if (!ptr)
+        return counted_secure_malloc(subsystem, file, size);
+    union alloc_header *header = header_of(ptr);
+    if (header->info.magic != ALLOC_MAGIC)
+        return secure_realloc(ptr, size);
+    if (size > SIZE_MAX - sizeof(union alloc_header))
+        return NULL;
+    union alloc_header copy = *header;
+    union alloc_header *moved = secure_realloc(header, sizeof(union alloc_header) + size);
+    if (!moved)
+        return NULL;
+    *moved = copy;
+    count_reallocation(moved, size);
+    return moved + 1;
+}
+
+
+char *counted_secure_strdup(int *subsystem, const char *file, const char *text) {
+    const size_t length = strlen(text);
+    char *copy = counted_secure_malloc(subsystem, file, length + 1);
+    if (copy)
+        memcpy(copy, text, length + 1);
+    return copy;
+}
+
+
+void counted_secure_free(void *ptr) {
+    if (!ptr)
+        return;
+    union alloc_header *header = header_of(ptr);
+    if (header->info.magic != ALLOC_MAGIC) {
+        pthread_mutex_lock(&stats_lock);
+        foreign_frees++;
+        pthread_mutex_unlock(&stats_lock);
+        secure_free(ptr);
+        return;
+    }
+    count_free(header);
+    secure_free(header);
+}
+
+
+/*
+ * Write the accounting of all subsystems to the report file or the original stderr
+ */
+void alloc_stats_report(void) {
+    pthread_mutex_lock(&stats_lock);
+    const int count = num_subsystems;
+    static struct subsystem_stats snapshot[MAX_ALLOC_SUBSYSTEMS];
+    memcpy(snapshot, subsystems, count * sizeof(struct subsystem_stats));
+    const size_t total_live = live_bytes;
+    const size_t total_peak = peak_bytes;
+    const uint64_t foreign = foreign_frees;
+    pthread_mutex_unlock(&stats_lock);
+
+    const char *path = getenv(ALLOC_REPORT_VARIABLE);
+    FILE *report = NULL;
+    if (path && *path)
+        report = fopen(path, "a");
+    else if (report_fd >= 0)
+        report = fdopen(dup(report_fd), "w");
+    if (!report)
+        return;
+    fprintf(report, "Allocation accounting: %zu bytes live, %zu bytes at peak\n", total_live, total_peak);
+    fprintf(report, "%-28s %12s %12s %10s %10s %10s %14s\n",
+        "Subsystem", "Live", "Peak", "Allocs", "Reallocs", "Frees", "Total bytes");
+    for (int i = 0; i < count; i++) {
+        const struct subsystem_stats *stats = &snapshot[i];
+        fprintf(report, "%-28s %12zu %12zu %10llu %10llu %10llu %14llu\n", stats->name, stats->live_bytes,
+            stats->peak_bytes, (unsigned long long) stats->allocations, (unsigned long long) stats->reallocations,
+            (unsigned long long) stats->frees, (unsigned long long) stats->total_bytes);
+    }
+    fprintf(report, "Sizes (bucket 2^i holds sizes up to 2^i bytes):\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(report, "%-28s", snapshot[i].name);
+        for (int bucket = 0; bucket < ALLOC_HISTOGRAM_BUCKETS; bucket++) {
+            if (snapshot[i].histogram[bucket])
+                fprintf(report, " 2^%d:%llu", bucket, (unsigned long long) snapshot[i].histogram[bucket]);
+        }
+        fprintf(report, "\n");
+    }
+    if (foreign)
+        fprintf(report, "%llu block(s) freed that were not allocated through the accounting\n",
+            (unsigned long long) foreign);
+    fclose(report);
+}
+
+
+#ifndef _WIN32
+/*
+ * Wake the report thread, only async-signal-safe calls are allowed here
+ */
+static void request_report(int signal_number) {
+    (void) signal_number;
+    const char byte = 1;
+    ssize_t written = write(signal_pipe[1], &byte, 1);
+    (void) written;
+}
+
+
+/*
+ * Write a report whenever SIGUSR1 arrives
+ */
+static void *report_on_signal(void *arg) {
+    (void) arg;
+    char byte;
+    while (read(signal_pipe[0], &byte, 1) == 1)
+        alloc_stats_report();
+    return NULL;
+}
+#endif
+
+
+/*
+ * Start the accounting: keep the current stderr for the report, write a report at exit and,
+ * except on Windows, on every SIGUSR1. Runs once, the first counted allocation calls it otherwise,
+ * so main calls it before it redirects stderr
+ */
+static void start_accounting(void) {
+#ifdef _WIN32
+    report_fd = _dup(2);
+#else
+    report_fd = dup(STDERR_FILENO);
+    pthread_t thread;
+    if (pipe(signal_pipe) == 0 && pthread_create(&thread, NULL, report_on_signal, NULL) == 0) {
+        pthread_detach(thread);
+        struct sigaction action = {0};
+        action.sa_handler = request_report;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, NULL);
+    }
+#endif
+    atexit(alloc_stats_report);
+}
+
+
+void alloc_stats_init(void) {
+    static pthread_once_t started = PTHREAD_ONCE_INIT;
+    pthread_once(&started, start_accounting);
+}
+
+#endif //C_PASS_ALLOC_STATS
@@ -0,0 +1,69 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+/*
+ * Opt-in allocation accounting, built with cmake -DC_PASS_ALLOC_STATS=ON.
+ * CMake then includes this header in front of every source file, which routes malloc, calloc,
+ * realloc, strdup, strndup, free and the secure heap through counting wrappers tagged with the
+ * source file of the call. Live and peak bytes, counts and a size histogram per source file are
+ * reported at exit and, except on Windows, whenever the process receives SIGUSR1.
+ * Without the option nothing includes this header and the allocators are called directly.
+ */
+#ifdef C_PASS_ALLOC_STATS
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "secure_heap.h"
+
+// File the report is appended to, the report goes to stderr as it was at startup if unset
+#define ALLOC_REPORT_VARIABLE "C_PASS_ALLOC_REPORT"
+#define MAX_ALLOC_SUBSYSTEMS 128
+// Bucket i counts allocations of up to 2^i bytes
+#define ALLOC_HISTOGRAM_BUCKETS 33
+
+void alloc_stats_init(void);
+void alloc_stats_report(void);
+void *counted_malloc(int *subsystem, const char *file, size_t size);
+void *counted_calloc(int *subsystem, const char *file, size_t count, size_t size);
+void *counted_realloc(int *subsystem, const char *file, void *ptr, size_t size);
+char *counted_strdup(int *subsystem, const char *file, const char *text);
+char *counted_strndup(int *subsystem, const char *file, const char *text, size_t length);
+void counted_free(void *ptr);
+void *counted_secure_malloc(int *subsystem, const char *file, size_t size);
+void *counted_secure_realloc(int *subsystem, const char *file, void *ptr, size_t size);
+char *counted_secure_strdup(int *subsystem, const char *file, const char *text);
+void counted_secure_free(void *ptr);
+
+// The wrappers themselves and the secure heap call the real allocators
+#ifndef ALLOC_STATS_IMPLEMENTATION
+#if defined(__GNUC__)
+#define ALLOC_STATS_UNUSED __attribute__((unused))
+#else
+#define ALLOC_STATS_UNUSED
+#endif
+// Subsystem ids of this source file for the C heap and the secure heap, assigned on first use
+static int alloc_subsystem ALLOC_STATS_UNUSED = -1;
+static int alloc_secure_subsystem ALLOC_STATS_UNUSED = -1;
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+#undef strndup
+#undef free
+#define malloc(size) counted_malloc(&alloc_subsystem, __FILE__, size)
+#define calloc(count, size) counted_calloc(&alloc_subsystem, __FILE__, count, size)
+#define realloc(ptr, size) counted_realloc(&alloc_subsystem, __FILE__, ptr, size)
+#define strdup(text) counted_strdup(&alloc_subsystem, __FILE__, text)
+#define strndup(text, length) counted_strndup(&alloc_subsystem, __FILE__, text, length)
+#define free(ptr) counted_free(ptr)
+#define secure_malloc(size) counted_secure_malloc(&alloc_secure_subsystem, __FILE__, size)
+#define secure_realloc(ptr, size) counted_secure_realloc(&alloc_secure_subsystem, __FILE__, ptr, size)
+#define secure_strdup(text) counted_secure_strdup(&alloc_secure_subsystem, __FILE__, text)
+#define secure_free(ptr) counted_secure_free(ptr)
+#endif
+
+#endif //C_PASS_ALLOC_STATS
+
+#endif //ALLOC_STATS_H
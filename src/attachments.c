@@ -0,0 +1,462 @@
+#include "attachments.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "secure_heap.h"
+#include "vault_store.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#define ATTACHMENT_SALT_SIZE 16
+#define ATTACHMENT_KEY_SIZE 32
+#define ATTACHMENT_TAG_SIZE 16
+#define ATTACHMENT_NONCE_SIZE 12
+#define ATTACHMENT_MAGIC_SIZE (sizeof(ATTACHMENT_MAGIC) - 1)
+#define ATTACHMENT_HEADER_SIZE (ATTACHMENT_MAGIC_SIZE + ATTACHMENT_SALT_SIZE)
+// Every attachment starts with its ID, its size and the nonce prefix of its chunks (8 bytes each),
+// followed by its chunks, each sealed with its own tag
+#define RECORD_HEADER_SIZE 24
+#define NONCE_PREFIX_SIZE 8
+// The file header, the ID of the attachment, the chunk index and whether it is the last chunk
+#define CHUNK_AAD_SIZE (ATTACHMENT_HEADER_SIZE + 8 + 8 + 1)
+#define MAX_CHUNKS UINT32_MAX
+
+
+static void put_le(unsigned char *out, uint64_t value, const int bytes) {
+    for (int i = 0; i < bytes; i++, value >>= 8)
+        out[i] = (unsigned char) value;
+}
+
+
+static uint64_t get_le(const unsigned char *in, const int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        value = value << 8 | in[i];
+    return value;
+}
+
+
+static bool seek_file(FILE *file, const uint64_t position) {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64) position, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t) position, SEEK_SET) == 0;
+#endif
+}
+
+
+/*
+ * Cut a file back to the given size, drops an attachment whose append failed
+ */
+static bool truncate_file(FILE *file, const uint64_t size) {
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), (__int64) size) == 0;
+#else
+    return ftruncate(fileno(file), (off_t) size) == 0;
+#endif
+}
+
+
+/*
+ * Write a whole buffer to a file descriptor, retrying partial writes
+ */
+static bool write_all(const int fd, const unsigned char *data, size_t length) {
+    while (length > 0) {
+#ifdef _WIN32
+        const int written = _write(fd, data, length > INT32_MAX ? INT32_MAX : (unsigned int) length);
+#else
+        const ssize_t written = write(fd, data, length);
+#endif
+        if (written <= 0)
+            return false;
+        data += written;
+        length -= (size_t) written;
+    }
+    return true;
+}
+
+
+/*
+ * Get the path of the attachment file of a vault
+ *
+ * return char*: The path that has to be freed, NULL if memory ran out
+ */
+static char *attachment_file_path(const char *vault_path) {
+    const size_t length = strlen(vault_path);
+    char *path = malloc(length + sizeof(ATTACHMENT_FILE_SUFFIX));
+    if (path) {
+        memcpy(path, vault_path, length);
+        memcpy(path + length, ATTACHMENT_FILE_SUFFIX, sizeof(ATTACHMENT_FILE_SUFFIX));
+    }
+    return path;
+}
+
+
+static bool derive_attachment_key(const struct vault_key *vault_key, const unsigned char *header, unsigned char *key) {
+    return derive_subkey(vault_key, ATTACHMENT_KEY_PURPOSE, header + ATTACHMENT_MAGIC_SIZE, ATTACHMENT_SALT_SIZE,
+        key, ATTACHMENT_KEY_SIZE);
+}
+
+
+/*
+ * Number of chunks an attachment is stored in, an empty attachment still has one (empty) chunk
+ */
+static uint64_t chunk_count(const uint64_t size) {
+    return size == 0 ? 1 : (size - 1) / ATTACHMENT_CHUNK_SIZE + 1;
+}
+
+
+/*
+ * Build the nonce and the additional data of a chunk. Binding the file header, the attachment
+ * and the position to every chunk keeps chunks from being moved, reordered or cut off
+ */
+static void chunk_parameters(
+    const unsigned char *header,
+    const unsigned char *record,
+    const uint64_t index,
+    const bool last,
+    unsigned char *nonce,
+    unsigned char *aad) {
+    memcpy(nonce, record + 16, NONCE_PREFIX_SIZE);
+    put_le(nonce + NONCE_PREFIX_SIZE, index, ATTACHMENT_NONCE_SIZE - NONCE_PREFIX_SIZE);
+    memcpy(aad, header, ATTACHMENT_HEADER_SIZE);
+    memcpy(aad + ATTACHMENT_HEADER_SIZE, record, 8);
+    put_le(aad + ATTACHMENT_HEADER_SIZE + 8, index, 8);
+    aad[CHUNK_AAD_SIZE - 1] = last;
+}
+
+
+static bool seal_chunk(
+    EVP_CIPHER_CTX *ctx,
+    const unsigned char *key,
+    const unsigned char *header,
+    const unsigned char *record,
+    const uint64_t index,
+    const bool last,
+    const unsigned char *plain,
+    const size_t length,
+    unsigned char *sealed) {
+    unsigned char nonce[ATTACHMENT_NONCE_SIZE], aad[CHUNK_AAD_SIZE];
+    chunk_parameters(header, record, index, last, nonce, aad);
+    int out_length = 0, final_length = 0;
+    return EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce) == 1 &&
+        EVP_EncryptUpdate(ctx, NULL, &out_length, aad, sizeof(aad)) == 1 &&
+        EVP_EncryptUpdate(ctx, sealed, &out_length, plain, (int) length) == 1 &&
+        EVP_EncryptFinal_ex(ctx, sealed + out_length, &final_length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, ATTACHMENT_TAG_SIZE, sealed + length) == 1;
+}
+
+
+static bool open_chunk(
+    EVP_CIPHER_CTX *ctx,
+    const unsigned char *key,
+    const unsigned char *header,
+    const unsigned char *record,
+    const uint64_t index,
+    const bool last,
+    const unsigned char *sealed,
+    const size_t length,
+    unsigned char *plain) {
+    unsigned char nonce[ATTACHMENT_NONCE_SIZE], aad[CHUNK_AAD_SIZE];
+    chunk_parameters(header, record, index, last, nonce, aad);
+    int out_length = 0, final_length = 0;
+    return EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce) == 1 &&
+        EVP_DecryptUpdate(ctx, NULL, &out_length, aad, sizeof(aad)) == 1 &&
+        EVP_DecryptUpdate(ctx, plain, &out_length, sealed, (int) length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, ATTACHMENT_TAG_SIZE, (void *) (sealed + length)) == 1 &&
+        EVP_DecryptFinal_ex(ctx, plain + out_length, &final_length) == 1;
+}
+
+
+/*
+ * Open the attachment file for appending, creating it with a new salt if the vault has none yet.
+ * Must be called under the lock of the file, so every process uses the salt of the first one
+ *
+ * param unsigned char* header: Receives the file header
+ * return FILE*: The file opened for update, NULL if it cannot be opened or is no attachment file
+ */
+static FILE *open_attachment_file(const char *path, unsigned char *header) {
+    FILE *file = fopen(path, "r+b");
+    if (file) {
+        if (fread(header, 1, ATTACHMENT_HEADER_SIZE, file) != ATTACHMENT_HEADER_SIZE ||
+            memcmp(header, ATTACHMENT_MAGIC, ATTACHMENT_MAGIC_SIZE) != 0) {
+            fclose(file);
+            return NULL;
+        }
+        return file;
+    }
+    memcpy(header, ATTACHMENT_MAGIC, ATTACHMENT_MAGIC_SIZE);
+    if (RAND_bytes(header + ATTACHMENT_MAGIC_SIZE, ATTACHMENT_SALT_SIZE) != 1 || !(file = fopen(path, "w+b")))
+        return NULL;
+    if (fwrite(header, 1, ATTACHMENT_HEADER_SIZE, file) != ATTACHMENT_HEADER_SIZE || fflush(file) != 0) {
+        fclose(file);
+        remove(path);
+        return NULL;
+    }
+    return file;
+}
+
+
+/*
+ * Encrypt a stream and append it to the attachment file of a vault. The input is read one chunk
+ * ahead, so streams of unknown length such as pipes work too; the size in the record header is
+ * filled in once the stream ended. A failed append is cut off again
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * param FILE* input: The stream to store, read until its end
+ * param uint64_t* id: Receives the ID of the attachment
+ * param uint64_t* size: Receives the size of the attachment
+ * return bool: false if the stream could not be read or the attachment not be written
+ */
+bool store_attachment(const char *vault_path, const struct vault_key *vault_key, FILE *input, uint64_t *id, uint64_t *size) {
+    char *path = attachment_file_path(vault_path);
+    unsigned char *key = secure_malloc(ATTACHMENT_KEY_SIZE);
+    unsigned char *plain = secure_malloc(2 * ATTACHMENT_CHUNK_SIZE);
+    unsigned char *sealed = malloc(ATTACHMENT_CHUNK_SIZE + ATTACHMENT_TAG_SIZE);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    struct vault_file_lock *lock = path && key && plain && sealed && ctx ? lock_vault_file(path) : NULL;
+    unsigned char header[ATTACHMENT_HEADER_SIZE], record[RECORD_HEADER_SIZE];
+    FILE *file = lock ? open_attachment_file(path, header) : NULL;
+#ifdef _WIN32
+    const int64_t start = file && _fseeki64(file, 0, SEEK_END) == 0 ? _ftelli64(file) : -1;
+#else
+    const int64_t start = file && fseeko(file, 0, SEEK_END) == 0 ? (int64_t) ftello(file) : -1;
+#endif
+    bool ok = start >= (int64_t) ATTACHMENT_HEADER_SIZE && derive_attachment_key(vault_key, header, key);
+
+    // A zero ID never matches, so references can use it as a placeholder
+    *id = 0;
+    while (ok && *id == 0) {
+        ok = RAND_bytes(record, 8) == 1;
+        *id = get_le(record, 8);
+    }
+    put_le(record + 8, 0, 8);
+    ok = ok && RAND_bytes(record + 16, NONCE_PREFIX_SIZE) == 1 &&
+        fwrite(record, 1, RECORD_HEADER_SIZE, file) == RECORD_HEADER_SIZE;
+
+    // Only the next chunk tells whether the current one is the last, so two are kept
+    unsigned char *current = plain;
+    unsigned char *next = plain ? plain + ATTACHMENT_CHUNK_SIZE : NULL;
+    size_t length = ok ? fread(current, 1, ATTACHMENT_CHUNK_SIZE, input) : 0;
+    uint64_t total = 0;
+    for (uint64_t index = 0; ok; index++) {
+        const size_t next_length = length == ATTACHMENT_CHUNK_SIZE ? fread(next, 1, ATTACHMENT_CHUNK_SIZE, input) : 0;
+        const bool last = next_length == 0;
+        ok = !(last && ferror(input)) && index < MAX_CHUNKS &&
+            seal_chunk(ctx, key, header, record, index, last, current, length, sealed) &&
+            fwrite(sealed, 1, length + ATTACHMENT_TAG_SIZE, file) == length + ATTACHMENT_TAG_SIZE;
+        total += length;
+        if (last)
+            break;
+        unsigned char *swap = current;
+        current = next;
+        next = swap;
+        length = next_length;
+    }
+    if (ok) {
+        put_le(record + 8, total, 8);
+        ok = seek_file(file, (uint64_t) start + 8) && fwrite(record + 8, 1, 8, file) == 8 && fflush(file) == 0;
+    }
+    if (!ok && start >= (int64_t) ATTACHMENT_HEADER_SIZE)
+        truncate_file(file, (uint64_t) start);
+    if (file)
+        ok = fclose(file) == 0 && ok;
+    unlock_vault_file(lock);
+    *size = ok ? total : 0;
+
+    EVP_CIPHER_CTX_free(ctx);
+    free(sealed);
+    if (plain)
+        OPENSSL_cleanse(plain, 2 * ATTACHMENT_CHUNK_SIZE);
+    secure_free(plain);
+    secure_free(key);
+    free(path);
+    return ok;
+}
+
+
+/*
+ * Decrypt an attachment and write it to a file descriptor. Only the headers of the attachments
+ * in front of it are read, and only one chunk is held in memory, whatever the size of the attachment.
+ * The output may hold a part of the attachment if a chunk turns out to be damaged
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * param uint64_t id: ID of the attachment
+ * param uint64_t size: Size of the attachment according to the reference of the entry
+ * param int fd: The file descriptor receiving the attachment
+ * return bool: false if the attachment is missing, damaged or could not be written
+ */
+bool extract_attachment(const char *vault_path, const struct vault_key *vault_key, const uint64_t id, const uint64_t size, const int fd) {
+    char *path = attachment_file_path(vault_path);
+    FILE *file = path ? fopen(path, "rb") : NULL;
+    unsigned char header[ATTACHMENT_HEADER_SIZE], record[RECORD_HEADER_SIZE];
+    bool ok = file && fread(header, 1, ATTACHMENT_HEADER_SIZE, file) == ATTACHMENT_HEADER_SIZE &&
+        memcmp(header, ATTACHMENT_MAGIC, ATTACHMENT_MAGIC_SIZE) == 0;
+
+    // Skip the attachments in front, the sizes in their headers tell how long they are
+    uint64_t position = ATTACHMENT_HEADER_SIZE;
+    bool found = false;
+    while (ok && !found) {
+        ok = seek_file(file, position) && fread(record, 1, RECORD_HEADER_SIZE, file) == RECORD_HEADER_SIZE;
+        const uint64_t stored_size = get_le(record + 8, 8);
+        found = ok && get_le(record, 8) == id;
+        // A damaged size must not wrap the position around
+        ok = ok && stored_size <= INT64_MAX / 2;
+        position += RECORD_HEADER_SIZE + stored_size + chunk_count(stored_size) * ATTACHMENT_TAG_SIZE;
+    }
+    ok = ok && get_le(record + 8, 8) == size && chunk_count(size) <= MAX_CHUNKS;
+
+    unsigned char *key = ok ? secure_malloc(ATTACHMENT_KEY_SIZE) : NULL;
+    unsigned char *plain = ok ? secure_malloc(ATTACHMENT_CHUNK_SIZE) : NULL;
+    unsigned char *sealed = ok ? malloc(ATTACHMENT_CHUNK_SIZE + ATTACHMENT_TAG_SIZE) : NULL;
+    EVP_CIPHER_CTX *ctx = ok ? EVP_CIPHER_CTX_new() : NULL;
+    ok = key && plain && sealed && ctx && derive_attachment_key(vault_key, header, key);
+    const uint64_t num_chunks = chunk_count(size);
+    uint64_t remaining = size;
+    for (uint64_t index = 0; ok && index < num_chunks; index++) {
+        const size_t length = remaining < ATTACHMENT_CHUNK_SIZE ? (size_t) remaining : ATTACHMENT_CHUNK_SIZE;
+        ok = fread(sealed, 1, length + ATTACHMENT_TAG_SIZE, file) == length + ATTACHMENT_TAG_SIZE &&
+            open_chunk(ctx, key, header, record, index, index + 1 == num_chunks, sealed, length, plain) &&
+            write_all(fd, plain, length);
+        remaining -= length;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    free(sealed);
+    if (plain)
+        OPENSSL_cleanse(plain, ATTACHMENT_CHUNK_SIZE);
+    secure_free(plain);
+    secure_free(key);
+    if (file)
+        fclose(file);
+    free(path);
+    return ok;
+}
+
+
+/*
+ * Parse the next reference of the attachments field of an entry
+ *
+ * param const char** cursor: Position in the field, advanced past the reference. NULL or "" ends the list
+ * param struct attachment_reference* reference: Receives the reference
+ * return bool: false if there are no more references or the field is malformed
+ */
+bool next_attachment_reference(const char **cursor, struct attachment_reference *reference) {
+    const char *text = *cursor;
+    if (!text || !*text)
+        return false;
+    char *end = NULL;
+    reference->id = strtoull(text, &end, 16);
+    if (end == text || *end != ':')
+        return false;
+    text = end + 1;
+    reference->size = strtoull(text, &end, 10);
+    if (end == text || *end != ':')
+        return false;
+    reference->label = end + 1;
+    reference->label_length = strcspn(reference->label, ",");
+    text = reference->label + reference->label_length;
+    *cursor = *text == ',' ? text + 1 : text;
+    return true;
+}
+
+
+/*
+ * Find the reference of an entry to an attachment
+ *
+ * param const struct password* entry: The entry
+ * param uint64_t id: ID of the attachment
+ * param struct attachment_reference* reference: Receives the reference
+ * return bool: false if the entry does not reference the attachment
+ */
+bool find_attachment_reference(const struct password *entry, const uint64_t id, struct attachment_reference *reference) {
+    const char *cursor = entry->attachments;
+    while (next_attachment_reference(&cursor, reference)) {
+        if (reference->id == id)
+            return true;
+    }
+    return false;
+}
+
+
+/*
+ * Add a reference to an attachment to an entry. Commas in the label are replaced, since they
+ * separate the references, and the label is cut to MAX_ATTACHMENT_LABEL bytes
+ *
+ * param struct password* entry: The entry
+ * param uint64_t id: ID returned by store_attachment
+ * param uint64_t size: Size returned by store_attachment
+ * param const char* label: Name of the attachment such as the name of the stored file
+ * return bool: false if memory ran out, the entry is unchanged then
+ */
+bool add_attachment_reference(struct password *entry, const uint64_t id, const uint64_t size, const char *label) {
+    if (!label || !*label)
+        label = "attachment";
+    const size_t label_length = strnlen(label, MAX_ATTACHMENT_LABEL);
+    const size_t current_length = entry->attachments ? strlen(entry->attachments) : 0;
+    // Comma, 16 hex digits, at most 20 decimal digits and two colons
+    char *attachments = secure_malloc(current_length + 40 + label_length + 1);
+    if (!attachments)
+        return false;
+    size_t length = 0;
+    if (current_length) {
+        memcpy(attachments, entry->attachments, current_length);
+        attachments[current_length] = ',';
+        length = current_length + 1;
+    }
+    length += (size_t) sprintf(attachments + length, "%016" PRIx64 ":%" PRIu64 ":", id, size);
+    for (size_t i = 0; i < label_length; i++)
+        attachments[length++] = label[i] == ',' ? '_' : label[i];
+    attachments[length] = '\0';
+    secure_free(entry->attachments);
+    entry->attachments = attachments;
+    return true;
+}
+
+
+/*
+ * Remove the reference of an entry to an attachment. The attachment stays in the attachment file
+ *
+ * param struct password* entry: The entry
+ * param uint64_t id: ID of the attachment
+ * return bool: false if the entry does not reference the attachment or memory ran out
+ */
+bool remove_attachment_reference(struct password *entry, const uint64_t id) {
+    struct attachment_reference reference;
+    if (!find_attachment_reference(entry, id, &reference))
+        return false;
+    // Only the label may hold colons, the reference starts after the comma in front of it
+    const char *start = reference.label;
+    while (start > entry->attachments && start[-1] != ',')
+        start--;
+    const char *end = reference.label + reference.label_length;
+    const size_t before = (size_t) (start - entry->attachments);
+    const size_t after = strlen(end);
+    if (before == 0 && after == 0) {
+        secure_free(entry->attachments);
+        entry->attachments = NULL;
+        return true;
+    }
+    char *attachments = secure_malloc(before + after + 1);
+    if (!attachments)
+        return false;
+    // Drop the comma in front of the reference, or the one after it if it is the first
+    const size_t kept_before = before > 0 && after == 0 ? before - 1 : before;
+    memcpy(attachments, entry->attachments, kept_before);
+    const char *rest = after > 0 ? end + 1 : end;
+    memcpy(attachments + kept_before, rest, strlen(rest) + 1);
+    secure_free(entry->attachments);
+    entry->attachments = attachments;
+    return true;
+}
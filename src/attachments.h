@@ -0,0 +1,36 @@
+#ifndef ATTACHMENTS_H
+#define ATTACHMENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "crypto.h"
+#include "password.h"
+
+// Attachments are appended to "<vault>.attachments", the vault only holds references to them,
+// so unlocking and listing never read attachment bytes
+#define ATTACHMENT_FILE_SUFFIX ".attachments"
+#define ATTACHMENT_MAGIC "CPATTC02"
+// Attachments are encrypted in chunks of this many bytes, extraction holds one chunk in memory
+#define ATTACHMENT_CHUNK_SIZE (64 * 1024)
+// The attachment key is derived from the vault key and the salt in the file header
+#define ATTACHMENT_KEY_PURPOSE "cpass attachments"
+#define MAX_ATTACHMENT_LABEL 255
+
+// A reference of an entry to an attachment, the label points into the attachments field of the entry
+struct attachment_reference {
+    uint64_t id;
+    uint64_t size;
+    const char *label;
+    size_t label_length;
+};
+
+bool store_attachment(const char *vault_path, const struct vault_key *vault_key, FILE *input, uint64_t *id, uint64_t *size);
+bool extract_attachment(const char *vault_path, const struct vault_key *vault_key, uint64_t id, uint64_t size, int fd);
+bool next_attachment_reference(const char **cursor, struct attachment_reference *reference);
+bool find_attachment_reference(const struct password *entry, uint64_t id, struct attachment_reference *reference);
+bool add_attachment_reference(struct password *entry, uint64_t id, uint64_t size, const char *label);
+bool remove_attachment_reference(struct password *entry, uint64_t id);
+
+#endif //ATTACHMENTS_H
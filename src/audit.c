@@ -0,0 +1,504 @@
+#include "audit.h"
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "util.h"
+#include "strength.h"
+#include "secure_heap.h"
+
+// Truncated HMAC-SHA256, 128 bits make accidental collisions impossible in practice
+#define DIGEST_BYTES 16
+#define DIGEST_KEY_BYTES 32
+// Small vaults are not worth starting threads for
+#define MIN_ENTRIES_PER_THREAD 4096
+
+struct digest_job {
+    struct password **passwords;
+    int begin;
+    int end;
+    EVP_MAC *mac;
+    const unsigned char *key;
+    unsigned char *exact;
+    bool *exact_valid;
+    unsigned char *near; // NULL if near-duplicates are not requested
+    bool *near_valid;
+};
+
+struct group_job {
+    const unsigned char *digests;
+    const int *order;            // Slots ordered by partition, ascending within each partition
+    const int *partition_starts; // Partition p consists of order[partition_starts[p]] .. order[partition_starts[p + 1] - 1]
+    int first_partition;
+    int end_partition;
+    int *leader_of;              // Receives the smallest slot with the same digest
+    bool failed;
+};
+
+
+/*
+ * Reduce a password to a normalized skeleton, so that variants like "Summer2023!",
+ * "summer2024" and "$umm3r" end up with the same string: leading and trailing digits
+ * and special characters are stripped, letters are lowercased and common leetspeak
+ * substitutions are undone
+ *
+ * param const char* password: The password to normalize
+ * param char* skeleton: Receives the skeleton, must hold strlen(password) + 1 characters
+ * return size_t: Length of the skeleton
+ */
+static size_t normalize_password(const char *password, char *skeleton) {
+    const char *begin = password;
+    const char *end = password + strlen(password);
+    while (begin < end && !isalpha((unsigned char) *begin) && !strchr("@$", *begin))
+        begin++;
+    while (end > begin && !isalpha((unsigned char) end[-1]))
+        end--;
+    size_t length = 0;
+    for (const char *c = begin; c < end; c++) {
+        char mapped;
+        switch (*c) {
+            case '0': mapped = 'o'; break;
+            case '1': case '!': case '|': mapped = 'i'; break;
+            case '3': mapped = 'e'; break;
+            case '4': case '@': mapped = 'a'; break;
+            case '5': case '$': mapped = 's'; break;
+            case '7': case '+': mapped = 't'; break;
+            default: mapped = (char) tolower((unsigned char) *c);
+        }
+        skeleton[length++] = mapped;
+    }
+    skeleton[length] = '\0';
+    return length;
+}
+
+
+/*
+ * Compute the truncated HMAC of a string, reusing the key schedule of the context
+ *
+ * param EVP_MAC_CTX* ctx: HMAC context initialized with the key
+ * param const char* data: The string to hash
+ * param size_t length: Length of the string
+ * param unsigned char* digest: Receives DIGEST_BYTES bytes
+ * return bool: false if hashing failed
+ */
+static bool keyed_digest(EVP_MAC_CTX *ctx, const char *data, const size_t length, unsigned char *digest) {
+    unsigned char full[EVP_MAX_MD_SIZE];
+    size_t full_length;
+    const bool ok = EVP_MAC_init(ctx, NULL, 0, NULL) &&
+        EVP_MAC_update(ctx, (const unsigned char *) data, length) &&
+        EVP_MAC_final(ctx, full, &full_length, sizeof(full));
+    memcpy(digest, full, DIGEST_BYTES);
+    OPENSSL_cleanse(full, sizeof(full));
+    return ok;
+}
+
+
+/*
+ * Compute the keyed digests of a range of entries (thread entry point)
+ *
+ * param void* arg: The struct digest_job describing the range
+ * return void*: Always NULL
+ */
+static void *digest_range(void *arg) {
+    struct digest_job *job = arg;
+    char digest_name[] = "SHA256";
+    const OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest_name, 0),
+        OSSL_PARAM_construct_end()
+    };
+    EVP_MAC_CTX *ctx = EVP_MAC_CTX_new(job->mac);
+    const bool ready = ctx && EVP_MAC_init(ctx, job->key, DIGEST_KEY_BYTES, params);
+    char buffer[256];
+    for (int i = job->begin; i < job->end; i++) {
+        const struct password *entry = job->passwords[i];
+        job->exact_valid[i] = false;
+        if (job->near)
+            job->near_valid[i] = false;
+        if (entry == NULL || !ready)
+            continue;
+
+        const size_t length = strlen(entry->password);
+        job->exact_valid[i] = keyed_digest(ctx, entry->password, length, job->exact + (size_t) i * DIGEST_BYTES);
+
+        if (job->near) {
+            char *skeleton = length < sizeof(buffer) ? buffer : secure_malloc(length + 1);
+            if (!skeleton)
+                continue;
+            const size_t skeleton_length = normalize_password(entry->password, skeleton);
+            if (skeleton_length >= MIN_SKELETON_LENGTH) {
+                job->near_valid[i] = keyed_digest(ctx, skeleton, skeleton_length, job->near + (size_t) i * DIGEST_BYTES);
+            }
+            if (skeleton != buffer)
+                secure_free(skeleton);
+            else
+                OPENSSL_cleanse(skeleton, skeleton_length);
+        }
+    }
+    EVP_MAC_CTX_free(ctx);
+    return NULL;
+}
+
+
+/*
+ * Find the first slot sharing each digest within a set of partitions (thread entry point).
+ * Every partition gets its own open addressing hash map, so threads never share state
+ *
+ * param void* arg: The struct group_job describing the partitions
+ * return void*: Always NULL
+ */
+static void *group_partitions(void *arg) {
+    struct group_job *job = arg;
+    for (int p = job->first_partition; p < job->end_partition; p++) {
+        const int begin = job->partition_starts[p];
+        const int count = job->partition_starts[p + 1] - begin;
+        if (count == 0)
+            continue;
+        size_t capacity = 16;
+        while (capacity < 2 * (size_t) count)
+            capacity *= 2;
+        int *table = malloc(capacity * sizeof(int));
+        if (!table) {
+            job->failed = true;
+            return NULL;
+        }
+        memset(table, -1, capacity * sizeof(int));
+
+        for (int i = begin; i < begin + count; i++) {
+            const int slot = job->order[i];
+            const unsigned char *digest = job->digests + (size_t) slot * DIGEST_BYTES;
+            uint64_t hash;
+            memcpy(&hash, digest + 4, sizeof(hash));
+            size_t position = hash & (capacity - 1);
+            while (table[position] >= 0 &&
+                memcmp(job->digests + (size_t) table[position] * DIGEST_BYTES, digest, DIGEST_BYTES) != 0) {
+                position = (position + 1) & (capacity - 1);
+            }
+            if (table[position] < 0)
+                table[position] = slot;
+            job->leader_of[slot] = table[position];
+        }
+        free(table);
+    }
+    return NULL;
+}
+
+
+/*
+ * Fill the members and starts arrays of the groups from group_of
+ *
+ * param struct reuse_groups* groups: Groups with group_of and num_groups set
+ * param int num_passwords: Number of array slots
+ * return bool: false if memory ran out
+ */
+static bool build_members(struct reuse_groups *groups, const int num_passwords) {
+    groups->starts = calloc(groups->num_groups + 1, sizeof(int));
+    groups->members = malloc((num_passwords > 0 ? num_passwords : 1) * sizeof(int));
+    if (!groups->starts || !groups->members)
+        return false;
+    for (int slot = 0; slot < num_passwords; slot++) {
+        if (groups->group_of[slot] >= 0)
+            groups->starts[groups->group_of[slot] + 1]++;
+    }
+    for (int g = 0; g < groups->num_groups; g++) {
+        groups->starts[g + 1] += groups->starts[g];
+    }
+    int *next = malloc((groups->num_groups + 1) * sizeof(int));
+    if (!next)
+        return false;
+    memcpy(next, groups->starts, (groups->num_groups + 1) * sizeof(int));
+    for (int slot = 0; slot < num_passwords; slot++) {
+        if (groups->group_of[slot] >= 0)
+            groups->members[next[groups->group_of[slot]]++] = slot;
+    }
+    free(next);
+    return true;
+}
+
+
+/*
+ * Group all slots with equal digests. The slots are distributed into partitions by their
+ * first digest byte with a counting sort, then every thread builds hash maps for its own
+ * partitions. Total work is O(n), groups are numbered in the order of their first slot.
+ *
+ * param const unsigned char* digests: DIGEST_BYTES per slot
+ * param const bool* valid: Whether the digest of a slot is set
+ * param int num_passwords: Number of array slots
+ * param int num_threads: Number of threads to use
+ * param struct reuse_groups* groups: Receives the groups of two or more slots
+ * return bool: false if memory ran out
+ */
+static bool group_digests(
+    const unsigned char *digests,
+    const bool *valid,
+    const int num_passwords,
+    const int num_threads,
+    struct reuse_groups *groups) {
+    const int num_partitions = 256;
+    int *partition_starts = calloc(num_partitions + 1, sizeof(int));
+    int *order = malloc((num_passwords > 0 ? num_passwords : 1) * sizeof(int));
+    int *leader_of = malloc((num_passwords > 0 ? num_passwords : 1) * sizeof(int));
+    int *sizes = calloc(num_passwords > 0 ? num_passwords : 1, sizeof(int));
+    groups->group_of = malloc((num_passwords > 0 ? num_passwords : 1) * sizeof(int));
+    bool ok = partition_starts && order && leader_of && sizes && groups->group_of;
+
+    if (ok) {
+        for (int slot = 0; slot < num_passwords; slot++) {
+            if (valid[slot])
+                partition_starts[digests[(size_t) slot * DIGEST_BYTES] + 1]++;
+        }
+        for (int p = 0; p < num_partitions; p++) {
+            partition_starts[p + 1] += partition_starts[p];
+        }
+        int next[256];
+        memcpy(next, partition_starts, sizeof(next));
+        for (int slot = 0; slot < num_passwords; slot++) {
+            if (valid[slot])
+                order[next[digests[(size_t) slot * DIGEST_BYTES]]++] = slot;
+        }
+
+        struct group_job jobs[MAX_THREADS];
+        for (int t = 0; t < num_threads; t++) {
+            jobs[t] = (struct group_job) {
+                digests, order, partition_starts,
+                t * num_partitions / num_threads, (t + 1) * num_partitions / num_threads,
+                leader_of, false
+            };
+        }
+        run_jobs(group_partitions, jobs, sizeof(struct group_job), num_threads);
+        for (int t = 0; t < num_threads; t++) {
+            ok = ok && !jobs[t].failed;
+        }
+    }
+
+    if (ok) {
+        for (int slot = 0; slot < num_passwords; slot++) {
+            if (valid[slot])
+                sizes[leader_of[slot]]++;
+        }
+        groups->num_groups = 0;
+        for (int slot = 0; slot < num_passwords; slot++) {
+            if (!valid[slot] || sizes[leader_of[slot]] < 2) {
+                groups->group_of[slot] = -1;
+            } else if (leader_of[slot] == slot) {
+                groups->group_of[slot] = groups->num_groups++;
+            } else {
+                groups->group_of[slot] = groups->group_of[leader_of[slot]];
+            }
+        }
+    }
+
+    free(partition_starts);
+    free(order);
+    free(leader_of);
+    free(sizes);
+    return ok;
+}
+
+
+/*
+ * Drop near-duplicate groups whose members all share exactly the same password,
+ * they are already reported as exact reuse
+ *
+ * param struct reuse_groups* near: The near-duplicate groups, members not built yet
+ * param const struct reuse_groups* exact: The exact reuse groups
+ * param int num_passwords: Number of array slots
+ * return bool: false if memory ran out
+ */
+static bool drop_exact_only_groups(struct reuse_groups *near, const struct reuse_groups *exact, const int num_passwords) {
+    int *exact_of_group = malloc((near->num_groups > 0 ? near->num_groups : 1) * sizeof(int));
+    bool *mixed = calloc(near->num_groups > 0 ? near->num_groups : 1, sizeof(bool));
+    int *renumbered = malloc((near->num_groups > 0 ? near->num_groups : 1) * sizeof(int));
+    if (!exact_of_group || !mixed || !renumbered) {
+        free(exact_of_group);
+        free(mixed);
+        free(renumbered);
+        return false;
+    }
+    for (int g = 0; g < near->num_groups; g++) {
+        exact_of_group[g] = -2;
+    }
+    for (int slot = 0; slot < num_passwords; slot++) {
+        const int g = near->group_of[slot];
+        if (g < 0)
+            continue;
+        if (exact_of_group[g] == -2)
+            exact_of_group[g] = exact->group_of[slot];
+        else if (exact_of_group[g] != exact->group_of[slot] || exact->group_of[slot] < 0)
+            mixed[g] = true;
+    }
+    int num_kept = 0;
+    for (int g = 0; g < near->num_groups; g++) {
+        renumbered[g] = mixed[g] ? num_kept++ : -1;
+    }
+    for (int slot = 0; slot < num_passwords; slot++) {
+        if (near->group_of[slot] >= 0)
+            near->group_of[slot] = renumbered[near->group_of[slot]];
+    }
+    near->num_groups = num_kept;
+    free(exact_of_group);
+    free(mixed);
+    free(renumbered);
+    return true;
+}
+
+
+/*
+ * Find all entries that share a password with another entry and, optionally, entries whose
+ * passwords are near-duplicates (same normalized skeleton, e.g. an incremented suffix).
+ * Every password is hashed once with HMAC-SHA256 under a random per-report key, so reuse is
+ * found in O(n) without pairwise comparisons and no digest can be compared across runs.
+ * Large vaults are hashed and grouped on multiple threads.
+ *
+ * param struct password** passwords: Array containing the password struct pointers, may contain tombstones
+ * param int num_passwords: The current size of the array
+ * param bool find_near: Also search for near-duplicates
+ * param struct reuse_report* report: Receives the groups, free with free_reuse_report
+ * return bool: false if memory ran out
+ */
+bool find_reused_passwords(
+    struct password **passwords,
+    const int num_passwords,
+    const bool find_near,
+    struct reuse_report *report) {
+    memset(report, 0, sizeof(*report));
+    report->has_near = find_near;
+    const size_t slots = num_passwords > 0 ? num_passwords : 1;
+
+    int num_threads = available_threads();
+    if (num_threads > MAX_THREADS)
+        num_threads = MAX_THREADS;
+    if (num_threads > num_passwords / MIN_ENTRIES_PER_THREAD)
+        num_threads = num_passwords / MIN_ENTRIES_PER_THREAD;
+    if (num_threads < 1)
+        num_threads = 1;
+
+    unsigned char key[DIGEST_KEY_BYTES];
+    unsigned char *exact = malloc(slots * DIGEST_BYTES);
+    bool *exact_valid = malloc(slots * sizeof(bool));
+    unsigned char *near = find_near ? malloc(slots * DIGEST_BYTES) : NULL;
+    bool *near_valid = find_near ? malloc(slots * sizeof(bool)) : NULL;
+    EVP_MAC *mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+    bool ok = mac && exact && exact_valid && (!find_near || (near && near_valid)) && RAND_bytes(key, sizeof(key)) == 1;
+
+    if (ok) {
+        struct digest_job jobs[MAX_THREADS];
+        for (int t = 0; t < num_threads; t++) {
+            jobs[t] = (struct digest_job) {
+                passwords,
+                (int) ((long long) t * num_passwords / num_threads),
+                (int) ((long long) (t + 1) * num_passwords / num_threads),
+                mac, key, exact, exact_valid, near, near_valid
+            };
+        }
+        run_jobs(digest_range, jobs, sizeof(struct digest_job), num_threads);
+        OPENSSL_cleanse(key, sizeof(key));
+
+        ok = group_digests(exact, exact_valid, num_passwords, num_threads, &report->exact) &&
+            build_members(&report->exact, num_passwords);
+        if (ok && find_near) {
+            ok = group_digests(near, near_valid, num_passwords, num_threads, &report->near) &&
+                drop_exact_only_groups(&report->near, &report->exact, num_passwords) &&
+                build_members(&report->near, num_passwords);
+        }
+    }
+
+    EVP_MAC_free(mac);
+    free(exact);
+    free(exact_valid);
+    free(near);
+    free(near_valid);
+    if (!ok)
+        free_reuse_report(report);
+    return ok;
+}
+
+
+/*
+ * Free the memory held by a reuse report
+ *
+ * param struct reuse_report* report: The report to free
+ */
+void free_reuse_report(struct reuse_report *report) {
+    free(report->exact.group_of);
+    free(report->exact.members);
+    free(report->exact.starts);
+    free(report->near.group_of);
+    free(report->near.members);
+    free(report->near.starts);
+    memset(report, 0, sizeof(*report));
+}
+
+
+/*
+ * Print the members of each group
+ *
+ * param FILE* stream: The output stream
+ * param struct password** passwords: Array containing the password struct pointers
+ * param const struct reuse_groups* groups: The groups to print
+ */
+static void print_groups(FILE *stream, struct password **passwords, const struct reuse_groups *groups) {
+    for (int g = 0; g < groups->num_groups; g++) {
+        fprintf(stream, "  Group %d:", g + 1);
+        for (int m = groups->starts[g]; m < groups->starts[g + 1]; m++) {
+            const struct password *entry = passwords[groups->members[m]];
+            fprintf(stream, "%s %s (%s)", m == groups->starts[g] ? "" : ",", entry->name, entry->username);
+        }
+        fprintf(stream, "\n");
+    }
+}
+
+
+/*
+ * Print the password audit: entries failing the current password requirement,
+ * reused passwords and near-duplicates
+ *
+ * param FILE* stream: The output stream
+ * param struct password** passwords: Array containing the password struct pointers, may contain tombstones
+ * param int num_passwords: The current size of the array
+ * param const struct password_requirement* requirement: The current password requirement
+ * param const struct reuse_report* report: The reuse report created by find_reused_passwords
+ */
+void print_audit_report(
+    FILE *stream,
+    struct password **passwords,
+    const int num_passwords,
+    const struct password_requirement *requirement,
+    const struct reuse_report *report) {
+    fprintf(stream, "Password requirements: minimum length %d, %d uppercase letter(s), %d digit(s), %d special character(s)\n",
+        requirement->length, requirement->uppercased, requirement->digits, requirement->special_characters);
+    if (requirement->num_policies > 0)
+        fprintf(stream, "%d named policy(ies) apply to some entries instead\n", requirement->num_policies);
+    int noncompliant = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] == NULL)
+            continue;
+        struct password_rules rules;
+        get_password_rules(requirement, passwords[i], &rules);
+        if (!meets_password_rules(passwords[i]->password, &rules)) {
+            if (noncompliant++ == 0)
+                fprintf(stream, "Passwords not meeting the requirements:\n");
+            fprintf(stream, "  %s (%s)", passwords[i]->name, passwords[i]->username);
+            if (rules.policy)
+                fprintf(stream, " under policy %s", rules.policy);
+            fprintf(stream, "\n");
+        }
+    }
+    fprintf(stream, "%d of %d password(s) do not meet the requirements.\n\n",
+        noncompliant, count_live_passwords(passwords, num_passwords));
+
+    print_strength_report(stream, passwords, num_passwords, requirement, false);
+    fputc('\n', stream);
+
+    fprintf(stream, "Reused passwords: %d group(s), %d entries\n",
+        report->exact.num_groups, report->exact.starts ? report->exact.starts[report->exact.num_groups] : 0);
+    print_groups(stream, passwords, &report->exact);
+    if (report->has_near) {
+        fprintf(stream, "Near-duplicate passwords: %d group(s), %d entries\n",
+            report->near.num_groups, report->near.starts ? report->near.starts[report->near.num_groups] : 0);
+        print_groups(stream, passwords, &report->near);
+    }
+}
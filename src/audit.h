@@ -0,0 +1,37 @@
+#ifndef AUDIT_H
+#define AUDIT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "password.h"
+
+// Passwords whose normalized form is shorter than this are not compared for near-duplicates
+#define MIN_SKELETON_LENGTH 4
+
+struct reuse_groups {
+    int num_groups;
+    int *group_of; // Group id per array slot, -1 if the slot is not part of a group
+    int *members;  // Array slots ordered by group id
+    int *starts;   // Group g consists of members[starts[g]] .. members[starts[g + 1] - 1]
+};
+
+struct reuse_report {
+    struct reuse_groups exact; // Entries sharing exactly the same password
+    struct reuse_groups near;  // Entries whose passwords only differ in case, leetspeak or affixes
+    bool has_near;
+};
+
+bool find_reused_passwords(
+    struct password **passwords,
+    int num_passwords,
+    bool find_near,
+    struct reuse_report *report);
+void free_reuse_report(struct reuse_report *report);
+void print_audit_report(
+    FILE *stream,
+    struct password **passwords,
+    int num_passwords,
+    const struct password_requirement *requirement,
+    const struct reuse_report *report);
+
+#endif //AUDIT_H
@@ -0,0 +1,284 @@
+#include "autosave.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "frecency.h"
+#include "secure_heap.h"
+#include "vault_store.h"
+
+struct autosave {
+    pthread_t thread;
+    pthread_mutex_t lock;          // Held while the vault is changed or serialized
+    pthread_cond_t wake;
+    const char *path;
+    const struct vault_key *vault_key;
+    struct vault_base *base;
+    struct password ***passwords;
+    int *num_passwords;
+    struct password_requirement *requirement;
+    const struct password_listener *listener;  // Told about the entries merged from other processes
+    unsigned long edits;           // Edits made so far
+    unsigned long saved_edits;     // Edits contained in the vault file
+    unsigned long merges;          // Saves that merged commits of other processes into the entries
+    unsigned long accesses;        // Passwords shown so far
+    unsigned long saved_accesses;  // Accesses contained in the access file
+    enum commit_status status;     // Outcome of the last save
+    bool status_reported;          // Whether take_save_status returned the outcome already
+    bool stopping;
+};
+
+
+/*
+ * Remember the outcome of a save, so the menu reports each change of it once
+ *
+ * param struct autosave* saver: The saver, its lock has to be held
+ * param enum commit_status status: The outcome
+ */
+static void set_save_status(struct autosave *saver, const enum commit_status status) {
+    if (saver->status != status)
+        saver->status_reported = false;
+    saver->status = status;
+}
+
+
+/*
+ * Take a snapshot of the vault and commit it.
+ * Only merging concurrent commits of other processes and serializing the entries happen under the lock,
+ * encrypting and writing the file do not, so the menu can go on changing the vault in the meantime.
+ *
+ * param struct autosave* saver: The saver, its lock has to be held
+ * return bool: true if the snapshot was written
+ */
+static bool save_snapshot(struct autosave *saver) {
+    // The lock is held, so rather than waiting for the commit of another process the save is retried later
+    struct vault_file_lock *file_lock = try_lock_vault_file(saver->path);
+    if (!file_lock)
+        return false;
+
+    const unsigned long edits = saver->edits;
+    const uint64_t merged_version = saver->base->version;
+    char *cleartext = NULL;
+    struct vault_base committed = {0};
+    const enum commit_status merged = merge_vault_changes(saver->path, saver->vault_key, saver->base,
+        saver->requirement, saver->passwords, saver->num_passwords, saver->listener);
+    if (saver->base->version != merged_version)
+        saver->merges++;
+    bool saved = merged == COMMIT_OK &&
+        save_passwords_and_requirements(saver->requirement, *saver->passwords, saver->num_passwords, &cleartext) &&
+        record_vault_base(&committed, saver->base->version + 1, saver->requirement, *saver->passwords,
+            *saver->num_passwords);
+    pthread_mutex_unlock(&saver->lock);
+
+    if (saved)
+        saved = write_vault(saver->path, &cleartext, saver->vault_key, committed.version);
+    secure_free(cleartext);
+    unlock_vault_file(file_lock);
+
+    pthread_mutex_lock(&saver->lock);
+    if (saved) {
+        saver->saved_edits = edits;
+        free_vault_base(saver->base);
+        *saver->base = committed;
+    } else {
+        free_vault_base(&committed);
+    }
+    set_save_status(saver, saved ? COMMIT_OK : merged == COMMIT_CONFLICT ? COMMIT_CONFLICT : COMMIT_FAILED);
+    return saved;
+}
+
+
+/*
+ * Write the access counts to the access file of the vault, only serializing them happens under the lock
+ *
+ * param struct autosave* saver: The saver, its lock has to be held
+ * return bool: true if the counts were written
+ */
+static bool save_access_snapshot(struct autosave *saver) {
+    const unsigned long accesses = saver->accesses;
+    char *cleartext = serialize_access_stats(*saver->passwords, *saver->num_passwords);
+    pthread_mutex_unlock(&saver->lock);
+
+    const bool saved = cleartext && write_access_stats(saver->path, saver->vault_key, &cleartext);
+    secure_free(cleartext);
+
+    pthread_mutex_lock(&saver->lock);
+    if (saved)
+        saver->saved_accesses = accesses;
+    return saved;
+}
+
+
+/*
+ * Thread function of the saver. Waits for edits and saves them once the delay has passed or enough
+ * edits have piled up. Access counts are written after the delay as well. A failed save is retried
+ * after the next delay
+ *
+ * param void* arg: The saver
+ * return void*: NULL
+ */
+static void *run_saver(void *arg) {
+    struct autosave *saver = arg;
+    bool failed = false;
+    pthread_mutex_lock(&saver->lock);
+    while (true) {
+        while (!saver->stopping && saver->edits == saver->saved_edits && saver->accesses == saver->saved_accesses)
+            pthread_cond_wait(&saver->wake, &saver->lock);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += AUTOSAVE_DELAY_SECONDS;
+        while (!saver->stopping && (failed || saver->edits - saver->saved_edits < AUTOSAVE_EDIT_THRESHOLD)) {
+            if (pthread_cond_timedwait(&saver->wake, &saver->lock, &deadline) == ETIMEDOUT)
+                break;
+        }
+
+        bool saved = true;
+        if (saver->edits != saver->saved_edits)
+            saved = save_snapshot(saver);
+        if (saver->accesses != saver->saved_accesses)
+            saved = save_access_snapshot(saver) && saved;
+        failed = !saved;
+        if (saver->stopping)
+            break;
+    }
+    pthread_mutex_unlock(&saver->lock);
+    return NULL;
+}
+
+
+/*
+ * Start saving the vault in the background. Every change to the vault has to happen between
+ * lock_vault and unlock_vault from then on.
+ *
+ * param const char* path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key, has to stay valid until stop_autosave
+ * param struct vault_base* base: The base of the in-memory vault, kept up to date by every save
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * param const struct password_listener* listener: Told about merged entries, may be NULL, has to stay valid
+ *                                                 until stop_autosave
+ * return struct autosave*: The saver, NULL if it could not be started (the vault has to be saved on exit then)
+ */
+struct autosave *start_autosave(
+    const char *path,
+    const struct vault_key *vault_key,
+    struct vault_base *base,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *requirement,
+    const struct password_listener *listener) {
+    struct autosave *saver = calloc(1, sizeof(struct autosave));
+    if (!saver)
+        return NULL;
+    saver->path = path;
+    saver->vault_key = vault_key;
+    saver->base = base;
+    saver->passwords = passwords;
+    saver->num_passwords = num_passwords;
+    saver->requirement = requirement;
+    saver->listener = listener;
+    pthread_mutex_init(&saver->lock, NULL);
+    pthread_cond_init(&saver->wake, NULL);
+    if (pthread_create(&saver->thread, NULL, run_saver, saver) != 0) {
+        pthread_cond_destroy(&saver->wake);
+        pthread_mutex_destroy(&saver->lock);
+        free(saver);
+        return NULL;
+    }
+    return saver;
+}
+
+
+/*
+ * Get exclusive access to the vault before changing it
+ *
+ * param struct autosave* saver: The saver, may be NULL
+ */
+void lock_vault(struct autosave *saver) {
+    if (saver)
+        pthread_mutex_lock(&saver->lock);
+}
+
+
+/*
+ * Release the vault after lock_vault and schedule a save if it was changed
+ *
+ * param struct autosave* saver: The saver, may be NULL
+ * param bool modified: Whether the vault might have been changed
+ */
+void unlock_vault(struct autosave *saver, const bool modified) {
+    if (!saver)
+        return;
+    if (modified) {
+        saver->edits++;
+        pthread_cond_signal(&saver->wake);
+    }
+    pthread_mutex_unlock(&saver->lock);
+}
+
+
+/*
+ * Note that a password was shown and its access counts changed, they are written after the delay or
+ * on stop_autosave rather than right away. Has to be called between lock_vault and unlock_vault
+ *
+ * param struct autosave* saver: The saver
+ */
+void note_vault_access(struct autosave *saver) {
+    saver->accesses++;
+    pthread_cond_signal(&saver->wake);
+}
+
+
+/*
+ * Count the saves that merged commits of other processes into the entries. Entries may have moved
+ * or disappeared whenever the count changes, so numbers shown to the user before no longer apply.
+ * Has to be called between lock_vault and unlock_vault
+ *
+ * param struct autosave* saver: The saver, may be NULL
+ * return unsigned long: The number of merges so far
+ */
+unsigned long count_vault_merges(const struct autosave *saver) {
+    return saver ? saver->merges : 0;
+}
+
+
+/*
+ * Get the outcome of the background saves if it changed since the last call
+ *
+ * param struct autosave* saver: The saver, may be NULL
+ * return enum commit_status: COMMIT_FAILED or COMMIT_CONFLICT once after a save failed, COMMIT_OK otherwise
+ */
+enum commit_status take_save_status(struct autosave *saver) {
+    if (!saver)
+        return COMMIT_OK;
+    pthread_mutex_lock(&saver->lock);
+    const enum commit_status status = saver->status_reported ? COMMIT_OK : saver->status;
+    saver->status_reported = true;
+    pthread_mutex_unlock(&saver->lock);
+    return status;
+}
+
+
+/*
+ * Save the remaining edits and access counts and stop the saver
+ *
+ * param struct autosave* saver: The saver, may be NULL
+ * return bool: true if every edit has been saved, the access counts are not part of the vault
+ */
+bool stop_autosave(struct autosave *saver) {
+    if (!saver)
+        return false;
+    pthread_mutex_lock(&saver->lock);
+    saver->stopping = true;
+    pthread_cond_signal(&saver->wake);
+    pthread_mutex_unlock(&saver->lock);
+    pthread_join(saver->thread, NULL);
+
+    const bool saved = saver->edits == saver->saved_edits;
+    pthread_cond_destroy(&saver->wake);
+    pthread_mutex_destroy(&saver->lock);
+    free(saver);
+    return saved;
+}
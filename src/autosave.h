@@ -0,0 +1,30 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <stdbool.h>
+#include "password.h"
+#include "vault_store.h"
+
+// Save this many seconds after the first unsaved edit
+#define AUTOSAVE_DELAY_SECONDS 3
+// Save right away once this many edits are unsaved
+#define AUTOSAVE_EDIT_THRESHOLD 8
+
+struct autosave;
+
+struct autosave *start_autosave(
+    const char *path,
+    const struct vault_key *vault_key,
+    struct vault_base *base,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *requirement,
+    const struct password_listener *listener);
+void lock_vault(struct autosave *saver);
+void unlock_vault(struct autosave *saver, bool modified);
+void note_vault_access(struct autosave *saver);
+unsigned long count_vault_merges(const struct autosave *saver);
+enum commit_status take_save_status(struct autosave *saver);
+bool stop_autosave(struct autosave *saver);
+
+#endif //AUTOSAVE_H
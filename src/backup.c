@@ -0,0 +1,796 @@
+#include "backup.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crypto.h"
+#include "secure_heap.h"
+#include "util.h"
+#include "vault_store.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#define BACKUP_SALT_SIZE 16
+#define BACKUP_KEY_SIZE 32
+#define BACKUP_ID_SIZE 32
+#define BACKUP_NONCE_SIZE 12
+#define BACKUP_TAG_SIZE 16
+#define MANIFEST_HEADER "C-Pass backup manifest 1"
+#define MANIFEST_SUFFIX ".manifest"
+// Authenticated with the id key and kept in the store, it tells which vault the store belongs to
+#define BACKUP_OWNER_LABEL "cpass backup owner"
+
+// Chunk reference of a manifest
+struct chunk_reference {
+    unsigned char id[BACKUP_ID_SIZE];
+    uint32_t length;
+    int version_index; // Position of the manifest in the sorted list, used when listing
+};
+
+struct manifest {
+    uint64_t version;
+    long long created;
+    uint64_t size;
+    struct chunk_reference *chunks;
+    size_t num_chunks;
+};
+
+// File names of a directory
+struct name_list {
+    char **names;
+    size_t count;
+    size_t capacity;
+};
+
+
+/*
+ * Get the directory of the backup store of a vault
+ *
+ * param const char* vault_path: Path of the vault file
+ * return char*: The value of C_PASS_BACKUP_DIR if set, the vault path with BACKUP_DIRECTORY_SUFFIX otherwise,
+ *               to be freed. NULL if backups are disabled or memory ran out
+ */
+char *default_backup_directory(const char *vault_path) {
+    const char *path = getenv("C_PASS_BACKUP_DIR");
+    if (path)
+        return *path ? strdup(path) : NULL;
+    const size_t length = strlen(vault_path);
+    char *directory = malloc(length + sizeof(BACKUP_DIRECTORY_SUFFIX));
+    if (directory) {
+        memcpy(directory, vault_path, length);
+        memcpy(directory + length, BACKUP_DIRECTORY_SUFFIX, sizeof(BACKUP_DIRECTORY_SUFFIX));
+    }
+    return directory;
+}
+
+
+/*
+ * Join a directory and a file name
+ *
+ * return char*: The path that has to be freed, NULL if memory ran out
+ */
+static char *join_path(const char *directory, const char *name) {
+    const size_t directory_length = strlen(directory);
+    const size_t name_length = strlen(name);
+    char *path = malloc(directory_length + name_length + 2);
+    if (path) {
+        memcpy(path, directory, directory_length);
+        path[directory_length] = '/';
+        memcpy(path + directory_length + 1, name, name_length + 1);
+    }
+    return path;
+}
+
+
+/*
+ * Create a directory unless it exists already
+ */
+static void make_directory(const char *path) {
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0700);
+#endif
+}
+
+
+/*
+ * Add a name to a name list
+ */
+static bool add_name(struct name_list *list, const char *name) {
+    if (list->count == list->capacity) {
+        const size_t capacity = list->capacity ? 2 * list->capacity : 64;
+        char **names = realloc(list->names, capacity * sizeof(char *));
+        if (!names)
+            return false;
+        list->names = names;
+        list->capacity = capacity;
+    }
+    list->names[list->count] = strdup(name);
+    return list->names[list->count++] != NULL;
+}
+
+
+/*
+ * Release a name list
+ */
+static void free_names(struct name_list *list) {
+    for (size_t i = 0; i < list->count; i++)
+        free(list->names[i]);
+    free(list->names);
+    memset(list, 0, sizeof(struct name_list));
+}
+
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+
+/*
+ * List the entries of a directory with the given suffix, sorted by name
+ *
+ * param const char* path: The directory
+ * param const char* suffix: Required suffix of the names, "" for all except "." and ".."
+ * param struct name_list* list: Receives the names
+ * return bool: false if the directory could not be read or memory ran out
+ */
+static bool list_directory(const char *path, const char *suffix, struct name_list *list) {
+    const size_t suffix_length = strlen(suffix);
+    bool ok = true;
+#ifdef _WIN32
+    char *pattern = join_path(path, "*");
+    WIN32_FIND_DATAA data;
+    HANDLE search = pattern ? FindFirstFileA(pattern, &data) : INVALID_HANDLE_VALUE;
+    free(pattern);
+    if (search == INVALID_HANDLE_VALUE)
+        return false;
+    do {
+        const char *name = data.cFileName;
+#else
+    DIR *directory = opendir(path);
+    if (!directory)
+        return false;
+    const struct dirent *entry;
+    while (ok && (entry = readdir(directory)) != NULL) {
+        const char *name = entry->d_name;
+#endif
+        const size_t length = strlen(name);
+        if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0 && length >= suffix_length &&
+            strcmp(name + length - suffix_length, suffix) == 0)
+            ok = add_name(list, name);
+#ifdef _WIN32
+    } while (ok && FindNextFileA(search, &data));
+    FindClose(search);
+#else
+    }
+    closedir(directory);
+#endif
+    qsort(list->names, list->count, sizeof(char *), compare_names);
+    return ok;
+}
+
+
+/*
+ * Write a file atomically through a temporary file
+ */
+static bool write_file(const char *path, const void *data, const size_t size) {
+    const size_t path_length = strlen(path);
+    char *temporary_path = malloc(path_length + sizeof(".tmp"));
+    if (!temporary_path)
+        return false;
+    memcpy(temporary_path, path, path_length);
+    memcpy(temporary_path + path_length, ".tmp", sizeof(".tmp"));
+    FILE *file = fopen(temporary_path, "wb");
+    bool written = file && fwrite(data, 1, size, file) == size;
+    if (file)
+        written = fclose(file) == 0 && written;
+    written = written && replace_file(temporary_path, path);
+    if (!written)
+        remove(temporary_path);
+    free(temporary_path);
+    return written;
+}
+
+
+/*
+ * Read a whole file
+ *
+ * param size_t* size: Receives the size of the file
+ * return unsigned char*: The contents that have to be freed, NULL on failure
+ */
+static unsigned char *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    unsigned char *data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        const long length = ftell(file);
+        rewind(file);
+        data = length >= 0 ? malloc((size_t) length + 1) : NULL;
+        if (data && fread(data, 1, (size_t) length, file) != (size_t) length) {
+            free(data);
+            data = NULL;
+        }
+        *size = (size_t) length;
+    }
+    fclose(file);
+    return data;
+}
+
+
+/*
+ * Derive the keys of the store from the vault key. The salt is created with the store, together with
+ * an owner tag computed from the keys, so the store refuses the versions of any other vault
+ * instead of mixing them up with the versions of its own.
+ * The first key encrypts chunks, the second computes their ids
+ *
+ * param const char* directory: The backup store
+ * param const struct vault_key* vault_key: The vault key
+ * param bool create: Create the salt if the store has none yet
+ * param unsigned char* keys: Receives both keys, 2 * BACKUP_KEY_SIZE bytes
+ * return bool: false if there is no salt, the store belongs to another vault or the keys could not be derived
+ */
+static bool derive_store_keys(const char *directory, const struct vault_key *vault_key, const bool create, unsigned char *keys) {
+    char *salt_path = join_path(directory, "salt");
+    char *owner_path = join_path(directory, "owner");
+    if (!salt_path || !owner_path) {
+        free(salt_path);
+        free(owner_path);
+        return false;
+    }
+    unsigned char salt[BACKUP_SALT_SIZE];
+    size_t size = 0;
+    unsigned char *stored = read_file(salt_path, &size);
+    bool ok = stored && size == BACKUP_SALT_SIZE;
+    if (ok)
+        memcpy(salt, stored, BACKUP_SALT_SIZE);
+    else if (!stored && create)
+        ok = RAND_bytes(salt, BACKUP_SALT_SIZE) == 1 && write_file(salt_path, salt, BACKUP_SALT_SIZE);
+    free(stored);
+    free(salt_path);
+    ok = ok && derive_subkey(vault_key, BACKUP_KEY_PURPOSE, salt, BACKUP_SALT_SIZE, keys, 2 * BACKUP_KEY_SIZE);
+
+    unsigned char owner[BACKUP_ID_SIZE];
+    ok = ok && HMAC(EVP_sha256(), keys + BACKUP_KEY_SIZE, BACKUP_KEY_SIZE,
+        (const unsigned char *) BACKUP_OWNER_LABEL, strlen(BACKUP_OWNER_LABEL), owner, NULL) != NULL;
+    stored = ok ? read_file(owner_path, &size) : NULL;
+    if (stored) {
+        ok = size == BACKUP_ID_SIZE && CRYPTO_memcmp(stored, owner, BACKUP_ID_SIZE) == 0;
+    } else if (ok && create) {
+        // Stores created before the owner tag was introduced get it with their next version
+        ok = write_file(owner_path, owner, BACKUP_ID_SIZE);
+    }
+    free(stored);
+    free(owner_path);
+    if (!ok)
+        OPENSSL_cleanse(keys, 2 * BACKUP_KEY_SIZE);
+    return ok;
+}
+
+
+/*
+ * Fill the table of the gear rolling hash with fixed pseudo random values (splitmix64),
+ * so every build cuts the same content at the same positions
+ */
+static void fill_gear_table(uint64_t gear[256]) {
+    uint64_t state = 0;
+    for (int i = 0; i < 256; i++) {
+        uint64_t value = (state += 0x9E3779B97F4A7C15ULL);
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        gear[i] = value ^ (value >> 31);
+    }
+}
+
+
+/*
+ * Find the end of the next content-defined chunk. The gear hash only depends on the last 64 bytes,
+ * so an edit moves the cut points around it while all later cut points stay where they were.
+ *
+ * param const uint64_t* gear: The gear table
+ * param const unsigned char* data: Start of the remaining data
+ * param size_t length: Length of the remaining data
+ * return size_t: Length of the chunk
+ */
+static size_t next_chunk_length(const uint64_t *gear, const unsigned char *data, const size_t length) {
+    if (length <= BACKUP_MIN_CHUNK_SIZE)
+        return length;
+    const size_t limit = length < BACKUP_MAX_CHUNK_SIZE ? length : BACKUP_MAX_CHUNK_SIZE;
+    // The top bits of the gear hash depend on the most bytes
+    const uint64_t mask = ((1ULL << BACKUP_AVERAGE_CHUNK_BITS) - 1) << (64 - BACKUP_AVERAGE_CHUNK_BITS);
+    uint64_t hash = 0;
+    for (size_t i = BACKUP_MIN_CHUNK_SIZE; i < limit; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & mask) == 0)
+            return i + 1;
+    }
+    return limit;
+}
+
+
+/*
+ * Format a chunk id as hexadecimal file name
+ */
+static void format_id(const unsigned char *id, char *hex) {
+    for (int i = 0; i < BACKUP_ID_SIZE; i++)
+        snprintf(hex + 2 * i, 3, "%02x", id[i]);
+}
+
+
+/*
+ * Parse a hexadecimal chunk id
+ */
+static bool parse_id(const char *hex, unsigned char *id) {
+    for (int i = 0; i < BACKUP_ID_SIZE; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return false;
+        id[i] = (unsigned char) byte;
+    }
+    return true;
+}
+
+
+/*
+ * Get the path of a chunk file, chunks are spread over 256 directories by their first byte
+ *
+ * param bool create: Create the chunk directory
+ * return char*: The path that has to be freed, NULL if memory ran out
+ */
+static char *chunk_path(const char *directory, const unsigned char *id, const bool create) {
+    char hex[2 * BACKUP_ID_SIZE + 1];
+    format_id(id, hex);
+    char prefix[sizeof("chunks/xx")];
+    snprintf(prefix, sizeof(prefix), "chunks/%.2s", hex);
+    char *chunk_directory = join_path(directory, prefix);
+    char *path = chunk_directory ? join_path(chunk_directory, hex + 2) : NULL;
+    if (path && create)
+        make_directory(chunk_directory);
+    free(chunk_directory);
+    return path;
+}
+
+
+/*
+ * Get the path of the manifest of a version
+ *
+ * return char*: The path that has to be freed, NULL if memory ran out
+ */
+static char *manifest_path(const char *directory, const uint64_t version) {
+    char name[sizeof("versions/") + 20 + sizeof(MANIFEST_SUFFIX)];
+    snprintf(name, sizeof(name), "versions/%020llu%s", (unsigned long long) version, MANIFEST_SUFFIX);
+    return join_path(directory, name);
+}
+
+
+/*
+ * Encrypt a chunk and store it unless a chunk with the same id exists already.
+ * Encryption is deterministic (the nonce is taken from the keyed id), so equal chunks
+ * of different versions are stored once.
+ *
+ * return bool: false if the chunk could not be stored
+ */
+static bool store_chunk(
+    const char *directory,
+    const unsigned char *keys,
+    const unsigned char *id,
+    const unsigned char *data,
+    const size_t length,
+    uint64_t *stored_bytes) {
+    char *path = chunk_path(directory, id, true);
+    if (!path)
+        return false;
+    if (file_exists(path)) {
+        free(path);
+        return true;
+    }
+    unsigned char *sealed = malloc(length + BACKUP_TAG_SIZE);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_length = 0, final_length = 0;
+    bool ok = sealed && ctx &&
+        EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, keys, id) == 1 &&
+        EVP_EncryptUpdate(ctx, sealed, &out_length, data, (int) length) == 1 &&
+        EVP_EncryptFinal_ex(ctx, sealed + out_length, &final_length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, BACKUP_TAG_SIZE, sealed + length) == 1 &&
+        write_file(path, sealed, length + BACKUP_TAG_SIZE);
+    if (ok)
+        *stored_bytes += length + BACKUP_TAG_SIZE;
+    EVP_CIPHER_CTX_free(ctx);
+    free(sealed);
+    free(path);
+    return ok;
+}
+
+
+/*
+ * Store the current vault file as a new version of the backup store. Only chunks that no earlier
+ * version contains are written, so each version costs about the size of its changes.
+ *
+ * param const char* directory: The backup store, created if needed
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * return bool: true if the version is in the store afterwards
+ */
+bool backup_vault(const char *directory, const char *vault_path, const struct vault_key *vault_key) {
+    char *cleartext = NULL;
+    uint64_t version = 0;
+    if (!decrypt_file(vault_path, &cleartext, vault_key, &version))
+        return false;
+    make_directory(directory);
+    char *chunks_directory = join_path(directory, "chunks");
+    char *versions_directory = join_path(directory, "versions");
+    char *manifest_file = manifest_path(directory, version);
+    char *lock_path = join_path(directory, "store");
+    bool ok = chunks_directory && versions_directory && manifest_file && lock_path;
+    if (ok) {
+        make_directory(chunks_directory);
+        make_directory(versions_directory);
+    }
+
+    // Pruning must not delete chunks this version is about to reference
+    struct vault_file_lock *lock = ok ? lock_vault_file(lock_path) : NULL;
+    unsigned char *keys = secure_malloc(2 * BACKUP_KEY_SIZE);
+    ok = lock && keys && derive_store_keys(directory, vault_key, true, keys);
+    // Versions are immutable, a version that has been backed up once is done. The store is known to
+    // belong to this vault at this point, so the manifest cannot be the same version of another vault
+    if (!ok || file_exists(manifest_file)) {
+        unlock_vault_file(lock);
+        secure_free(keys);
+        secure_free(cleartext);
+        free(chunks_directory);
+        free(versions_directory);
+        free(manifest_file);
+        free(lock_path);
+        return ok;
+    }
+
+    const size_t size = strlen(cleartext);
+    const unsigned char *data = (const unsigned char *) cleartext;
+    uint64_t gear[256];
+    fill_gear_table(gear);
+    size_t manifest_capacity = 256 + (size / BACKUP_MIN_CHUNK_SIZE + 1) * (2 * BACKUP_ID_SIZE + 16);
+    char *manifest = malloc(manifest_capacity);
+    ok = ok && manifest;
+    size_t manifest_length = 0;
+    size_t num_chunks = 0;
+    uint64_t stored_bytes = 0;
+    char *chunk_lines = manifest;
+    for (size_t offset = 0; ok && offset < size; ) {
+        const size_t length = next_chunk_length(gear, data + offset, size - offset);
+        unsigned char id[BACKUP_ID_SIZE];
+        ok = HMAC(EVP_sha256(), keys + BACKUP_KEY_SIZE, BACKUP_KEY_SIZE, data + offset, length, id, NULL) != NULL &&
+            store_chunk(directory, keys, id, data + offset, length, &stored_bytes);
+        char hex[2 * BACKUP_ID_SIZE + 1];
+        format_id(id, hex);
+        manifest_length += (size_t) snprintf(chunk_lines + manifest_length, manifest_capacity - manifest_length,
+            "%s %zu\n", hex, length);
+        num_chunks++;
+        offset += length;
+    }
+
+    if (ok) {
+        // The header goes in front of the chunk lines, so build the final manifest in a second buffer
+        char header[256];
+        const int header_length = snprintf(header, sizeof(header), "%s\nversion %llu\ncreated %lld\nsize %zu\nchunks %zu\n",
+            MANIFEST_HEADER, (unsigned long long) version, (long long) time(NULL), size, num_chunks);
+        char *file = malloc((size_t) header_length + manifest_length);
+        ok = file != NULL;
+        if (ok) {
+            memcpy(file, header, (size_t) header_length);
+            memcpy(file + header_length, manifest, manifest_length);
+            ok = write_file(manifest_file, file, (size_t) header_length + manifest_length);
+        }
+        free(file);
+    }
+
+    unlock_vault_file(lock);
+    secure_free(keys);
+    secure_free(cleartext);
+    free(manifest);
+    free(chunks_directory);
+    free(versions_directory);
+    free(manifest_file);
+    free(lock_path);
+    return ok;
+}
+
+
+/*
+ * Read a manifest file
+ *
+ * return bool: false if the manifest is missing or malformed
+ */
+static bool read_manifest(const char *path, struct manifest *manifest) {
+    memset(manifest, 0, sizeof(struct manifest));
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    char line[256];
+    unsigned long long version = 0, size = 0;
+    size_t num_chunks = 0;
+    bool ok = fgets(line, sizeof(line), file) && strncmp(line, MANIFEST_HEADER, strlen(MANIFEST_HEADER)) == 0 &&
+        fscanf(file, "version %llu\ncreated %lld\nsize %llu\nchunks %zu\n", &version, &manifest->created, &size,
+            &num_chunks) == 4;
+    manifest->chunks = ok ? calloc(num_chunks + 1, sizeof(struct chunk_reference)) : NULL;
+    ok = manifest->chunks != NULL;
+    uint64_t total = 0;
+    for (size_t i = 0; ok && i < num_chunks; i++) {
+        char hex[2 * BACKUP_ID_SIZE + 1];
+        unsigned int length;
+        ok = fscanf(file, "%64s %u\n", hex, &length) == 2 && parse_id(hex, manifest->chunks[i].id);
+        manifest->chunks[i].length = length;
+        total += length;
+    }
+    fclose(file);
+    manifest->version = version;
+    manifest->size = size;
+    manifest->num_chunks = num_chunks;
+    if (!ok || total != size) {
+        free(manifest->chunks);
+        manifest->chunks = NULL;
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * Read all manifests of the store in version order
+ *
+ * param struct manifest** manifests: Receives the manifests
+ * param size_t* count: Receives the number of manifests
+ * param struct name_list* names: Receives the manifest file names
+ * return bool: false if a manifest could not be read
+ */
+static bool read_manifests(const char *directory, struct manifest **manifests, size_t *count, struct name_list *names) {
+    *manifests = NULL;
+    *count = 0;
+    char *versions_directory = join_path(directory, "versions");
+    bool ok = versions_directory && list_directory(versions_directory, MANIFEST_SUFFIX, names);
+    *manifests = ok ? calloc(names->count + 1, sizeof(struct manifest)) : NULL;
+    ok = *manifests != NULL;
+    for (size_t i = 0; ok && i < names->count; i++) {
+        char *path = join_path(versions_directory, names->names[i]);
+        ok = path && read_manifest(path, &(*manifests)[i]);
+        free(path);
+        *count = i + 1;
+    }
+    free(versions_directory);
+    return ok;
+}
+
+
+static void free_manifests(struct manifest *manifests, const size_t count) {
+    for (size_t i = 0; manifests && i < count; i++)
+        free(manifests[i].chunks);
+    free(manifests);
+}
+
+
+/*
+ * Order chunk references by id and then by the version that references them
+ */
+static int compare_references(const void *a, const void *b) {
+    const struct chunk_reference *first = a;
+    const struct chunk_reference *second = b;
+    const int order = memcmp(first->id, second->id, BACKUP_ID_SIZE);
+    if (order != 0)
+        return order;
+    return (first->version_index > second->version_index) - (first->version_index < second->version_index);
+}
+
+
+/*
+ * Collect the chunk references of all manifests, sorted by id
+ *
+ * return struct chunk_reference*: The references that have to be freed, NULL if memory ran out
+ */
+static struct chunk_reference *collect_references(const struct manifest *manifests, const size_t count, size_t *total) {
+    *total = 0;
+    for (size_t i = 0; i < count; i++)
+        *total += manifests[i].num_chunks;
+    struct chunk_reference *references = malloc((*total + 1) * sizeof(struct chunk_reference));
+    if (!references)
+        return NULL;
+    size_t next = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < manifests[i].num_chunks; j++) {
+            references[next] = manifests[i].chunks[j];
+            references[next++].version_index = (int) i;
+        }
+    }
+    qsort(references, *total, sizeof(struct chunk_reference), compare_references);
+    return references;
+}
+
+
+/*
+ * Print all versions in the store with the bytes each of them added
+ *
+ * param const char* directory: The backup store
+ * return bool: false if the store could not be read
+ */
+bool list_backups(const char *directory) {
+    struct name_list names = {0};
+    struct manifest *manifests = NULL;
+    size_t count = 0;
+    size_t total = 0;
+    bool ok = read_manifests(directory, &manifests, &count, &names);
+    struct chunk_reference *references = ok ? collect_references(manifests, count, &total) : NULL;
+    uint64_t *added = ok ? calloc(count + 1, sizeof(uint64_t)) : NULL;
+    ok = references && added;
+    if (ok) {
+        // A chunk is charged to the first version referencing it
+        for (size_t i = 0; i < total; i++) {
+            if (i == 0 || memcmp(references[i].id, references[i - 1].id, BACKUP_ID_SIZE) != 0)
+                added[references[i].version_index] += references[i].length + BACKUP_TAG_SIZE;
+        }
+        uint64_t stored = 0;
+        printf("%-10s %-20s %12s %8s %12s\n", "Version", "Created", "Size", "Chunks", "Added");
+        for (size_t i = 0; i < count; i++) {
+            char created[32] = "-";
+            const time_t timestamp = (time_t) manifests[i].created;
+            const struct tm *local = localtime(&timestamp);
+            if (local)
+                strftime(created, sizeof(created), "%Y-%m-%d %H:%M:%S", local);
+            printf("%-10llu %-20s %12llu %8zu %12llu\n", (unsigned long long) manifests[i].version, created,
+                (unsigned long long) manifests[i].size, manifests[i].num_chunks, (unsigned long long) added[i]);
+            stored += added[i];
+        }
+        printf("%zu version(s), %llu bytes stored\n", count, (unsigned long long) stored);
+    }
+    free(added);
+    free(references);
+    free_manifests(manifests, count);
+    free_names(&names);
+    return ok;
+}
+
+
+/*
+ * Check whether a chunk id is referenced, the references are sorted by id
+ */
+static bool is_referenced(const struct chunk_reference *references, const size_t total, const unsigned char *id) {
+    size_t low = 0, high = total;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const int order = memcmp(references[middle].id, id, BACKUP_ID_SIZE);
+        if (order == 0)
+            return true;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return false;
+}
+
+
+/*
+ * Delete all but the newest versions and every chunk no remaining version references
+ *
+ * param const char* directory: The backup store
+ * param int keep: Number of versions to keep
+ * return bool: false if the store could not be read
+ */
+bool prune_backups(const char *directory, const int keep) {
+    char *lock_path = join_path(directory, "store");
+    struct vault_file_lock *lock = lock_path ? lock_vault_file(lock_path) : NULL;
+    free(lock_path);
+    if (!lock)
+        return false;
+
+    struct name_list names = {0};
+    struct manifest *manifests = NULL;
+    size_t count = 0;
+    bool ok = read_manifests(directory, &manifests, &count, &names);
+    const size_t first_kept = ok && count > (size_t) keep ? count - (size_t) keep : 0;
+    char *versions_directory = join_path(directory, "versions");
+    ok = ok && versions_directory;
+    for (size_t i = 0; ok && i < first_kept; i++) {
+        char *path = join_path(versions_directory, names.names[i]);
+        ok = path && remove(path) == 0;
+        free(path);
+    }
+
+    size_t total = 0;
+    struct chunk_reference *references = ok ? collect_references(manifests + first_kept, count - first_kept, &total) : NULL;
+    char *chunks_directory = join_path(directory, "chunks");
+    struct name_list prefixes = {0};
+    ok = references && chunks_directory && list_directory(chunks_directory, "", &prefixes);
+    size_t removed = 0;
+    for (size_t i = 0; ok && i < prefixes.count; i++) {
+        char *prefix_directory = join_path(chunks_directory, prefixes.names[i]);
+        struct name_list chunks = {0};
+        ok = prefix_directory && list_directory(prefix_directory, "", &chunks);
+        for (size_t j = 0; ok && j < chunks.count; j++) {
+            char hex[2 * BACKUP_ID_SIZE + 1];
+            unsigned char id[BACKUP_ID_SIZE];
+            snprintf(hex, sizeof(hex), "%s%s", prefixes.names[i], chunks.names[j]);
+            // Leftover temporary files and anything else that is no chunk are left alone
+            if (strlen(hex) != 2 * BACKUP_ID_SIZE || !parse_id(hex, id) || is_referenced(references, total, id))
+                continue;
+            char *path = join_path(prefix_directory, chunks.names[j]);
+            if (path && remove(path) == 0)
+                removed++;
+            free(path);
+        }
+        free_names(&chunks);
+        free(prefix_directory);
+    }
+    if (ok)
+        printf("%zu version(s) and %zu chunk(s) removed, %zu version(s) kept\n", first_kept, removed, count - first_kept);
+
+    free_names(&prefixes);
+    free(chunks_directory);
+    free(references);
+    free(versions_directory);
+    free_manifests(manifests, count);
+    free_names(&names);
+    unlock_vault_file(lock);
+    return ok;
+}
+
+
+/*
+ * Reassemble the cleartext of a backed up version. Every chunk is authenticated and checked against its id
+ *
+ * param const char* directory: The backup store
+ * param uint64_t version: The version to restore
+ * param const struct vault_key* vault_key: The vault key the version was saved with
+ * param char** cleartext: Receives the cleartext vault on the secure heap
+ * return bool: false if the version does not exist or a chunk is missing or damaged
+ */
+bool restore_backup(const char *directory, const uint64_t version, const struct vault_key *vault_key, char **cleartext) {
+    char *path = manifest_path(directory, version);
+    struct manifest manifest;
+    bool ok = path && read_manifest(path, &manifest);
+    free(path);
+    if (!ok)
+        return false;
+    unsigned char *keys = secure_malloc(2 * BACKUP_KEY_SIZE);
+    *cleartext = secure_malloc(manifest.size + 1);
+    ok = keys && *cleartext && derive_store_keys(directory, vault_key, false, keys);
+    size_t offset = 0;
+    for (size_t i = 0; ok && i < manifest.num_chunks; i++) {
+        const struct chunk_reference *chunk = &manifest.chunks[i];
+        char *file = chunk_path(directory, chunk->id, false);
+        size_t size = 0;
+        unsigned char *sealed = file ? read_file(file, &size) : NULL;
+        free(file);
+        EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+        int out_length = 0, final_length = 0;
+        unsigned char id[BACKUP_ID_SIZE];
+        unsigned char *plain = (unsigned char *) *cleartext + offset;
+        ok = sealed && ctx && size == (size_t) chunk->length + BACKUP_TAG_SIZE &&
+            EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, keys, chunk->id) == 1 &&
+            EVP_DecryptUpdate(ctx, plain, &out_length, sealed, (int) chunk->length) == 1 &&
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, BACKUP_TAG_SIZE, sealed + chunk->length) == 1 &&
+            EVP_DecryptFinal_ex(ctx, plain + out_length, &final_length) == 1 &&
+            HMAC(EVP_sha256(), keys + BACKUP_KEY_SIZE, BACKUP_KEY_SIZE, plain, chunk->length, id, NULL) != NULL &&
+            CRYPTO_memcmp(id, chunk->id, BACKUP_ID_SIZE) == 0;
+        EVP_CIPHER_CTX_free(ctx);
+        free(sealed);
+        offset += chunk->length;
+    }
+    free(manifest.chunks);
+    secure_free(keys);
+    if (!ok) {
+        secure_free(*cleartext);
+        *cleartext = NULL;
+        return false;
+    }
+    (*cleartext)[offset] = '\0';
+    return true;
+}
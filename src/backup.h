@@ -0,0 +1,24 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "crypto.h"
+
+// Every vault has its own backup store next to it, "<vault>.backups", overridable with the
+// C_PASS_BACKUP_DIR environment variable (empty disables backups). A store belongs to one vault only
+#define BACKUP_DIRECTORY_SUFFIX ".backups"
+// Content-defined chunking: no cut before the minimum, a cut on average every 2^BITS bytes after it
+#define BACKUP_MIN_CHUNK_SIZE 2048
+#define BACKUP_AVERAGE_CHUNK_BITS 13
+#define BACKUP_MAX_CHUNK_SIZE 65536
+// Chunk keys are derived from the vault key and the salt of the store
+#define BACKUP_KEY_PURPOSE "cpass backup"
+
+char *default_backup_directory(const char *vault_path);
+bool backup_vault(const char *directory, const char *vault_path, const struct vault_key *vault_key);
+bool list_backups(const char *directory);
+bool prune_backups(const char *directory, int keep);
+bool restore_backup(const char *directory, uint64_t version, const struct vault_key *vault_key, char **cleartext);
+
+#endif //BACKUP_H
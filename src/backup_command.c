@@ -0,0 +1,133 @@
+#include "commands.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "backup.h"
+#include "secure_heap.h"
+
+
+/*
+ * Run the backup list and backup prune commands, which only read the backup store
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const char* vault_path: The vault whose backup store is used
+ * return int: Exit code of the command
+ */
+int run_backup_store_command(const int argc, char *argv[], const char *vault_path) {
+    const bool list = strcmp(argv[1], "list") == 0;
+    int keep = -1;
+    if (list && argc > 2) {
+        printf("Unknown option for backup list: %s\n", argv[2]);
+        return 2;
+    }
+    for (int i = 2; i < argc && !list; i++) {
+        if (strcmp(argv[i], "--keep") == 0 && i + 1 < argc) {
+            keep = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for backup prune: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!list && keep < 1) {
+        printf("backup prune needs --keep N with N of at least 1\n");
+        return 2;
+    }
+
+    char *directory = default_backup_directory(vault_path);
+    if (!directory) {
+        printf("Backups are disabled, C_PASS_BACKUP_DIR is empty\n");
+        return 2;
+    }
+    int exit_code = 0;
+    if (list && !list_backups(directory)) {
+        printf("Failed to read the backup store %s\n", directory);
+        exit_code = 1;
+    } else if (!list && !prune_backups(directory, keep)) {
+        printf("Failed to prune the backup store %s\n", directory);
+        exit_code = 1;
+    }
+    free(directory);
+    return exit_code;
+}
+
+
+/*
+ * Run the backup create and backup restore commands on the loaded vault
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+int run_backup(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *requirement,
+    bool *modified) {
+    const bool create = argc == 1 || (argc == 2 && strcmp(argv[1], "create") == 0);
+    if (!create && strcmp(argv[1], "restore") != 0) {
+        printf("Unknown backup command: %s\n", argv[1]);
+        return 2;
+    }
+    char *end = NULL;
+    const unsigned long long version = !create && argc == 3 ? strtoull(argv[2], &end, 10) : 0;
+    if (!create && (!end || *end != '\0' || end == argv[2])) {
+        printf("backup restore needs exactly one version number\n");
+        return 2;
+    }
+    char *directory = default_backup_directory(source->path);
+    if (!directory) {
+        printf("Backups are disabled, C_PASS_BACKUP_DIR is empty\n");
+        return 2;
+    }
+    if (create) {
+        const bool backed_up = backup_vault(directory, source->path, source->vault_key);
+        if (backed_up)
+            printf("Version %llu is backed up in %s\n", (unsigned long long) source->version, directory);
+        else
+            printf("Failed to back up %s to %s\n", source->path, directory);
+        free(directory);
+        return backed_up ? 0 : 1;
+    }
+
+    char *cleartext = NULL;
+    const bool restored_version = restore_backup(directory, version, source->vault_key, &cleartext);
+    if (!restored_version)
+        printf("Failed to restore version %llu from %s\n", version, directory);
+    free(directory);
+    if (!restored_version)
+        return 1;
+    int num_restored = 0;
+    struct password_requirement *restored_requirement = read_password_requirement(cleartext);
+    struct password **restored = read_passwords(cleartext, &num_restored);
+    secure_free(cleartext);
+    if (!restored_requirement || !restored) {
+        free_password_requirement(restored_requirement);
+        free_passwords(restored, num_restored);
+        free(restored);
+        printf("Version %llu could not be parsed\n", version);
+        return 1;
+    }
+
+    // The restored state is committed like any other edit, so it becomes the next version
+    free_passwords(*passwords, *num_passwords);
+    free(*passwords);
+    *passwords = restored;
+    *num_passwords = num_restored;
+    // Swap, so the policies of the replaced requirement are freed with the restored struct
+    const struct password_requirement replaced = *requirement;
+    *requirement = *restored_requirement;
+    *restored_requirement = replaced;
+    free_password_requirement(restored_requirement);
+    *modified = true;
+    printf("Version %llu restored, %d password(s).\n", version, count_live_passwords(restored, num_restored));
+    return 0;
+}
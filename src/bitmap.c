@@ -0,0 +1,493 @@
+#include "bitmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define count_bits(word) ((uint32_t) __builtin_popcountll(word))
+#define lowest_bit(word) ((uint32_t) __builtin_ctzll(word))
+#else
+static uint32_t count_bits(uint64_t word) {
+    uint32_t count = 0;
+    for (; word; word &= word - 1)
+        count++;
+    return count;
+}
+
+
+static uint32_t lowest_bit(const uint64_t word) {
+    uint32_t bit = 0;
+    while (!((word >> bit) & 1))
+        bit++;
+    return bit;
+}
+#endif
+
+enum bitmap_operation {
+    OPERATION_AND,
+    OPERATION_OR,
+    OPERATION_ANDNOT
+};
+
+
+/*
+ * Initialize an empty bitmap
+ *
+ * param struct bitmap* bitmap: The bitmap
+ */
+void bitmap_init(struct bitmap *bitmap) {
+    memset(bitmap, 0, sizeof(struct bitmap));
+}
+
+
+static void free_container(struct bitmap_container *container) {
+    free(container->values);
+    free(container->words);
+    memset(container, 0, sizeof(struct bitmap_container));
+}
+
+
+/*
+ * Release all containers of a bitmap, it is empty afterwards
+ *
+ * param struct bitmap* bitmap: The bitmap
+ */
+void bitmap_free(struct bitmap *bitmap) {
+    for (int i = 0; i < bitmap->count; i++)
+        free_container(&bitmap->containers[i]);
+    free(bitmap->containers);
+    bitmap_init(bitmap);
+}
+
+
+/*
+ * Find the container with the given key
+ *
+ * param bool* found: Receives whether the container exists
+ * return int: Its position, or the position it has to be inserted at
+ */
+static int find_container(const struct bitmap *bitmap, const uint16_t key, bool *found) {
+    // Values are mostly added in ascending order, so check the last container first
+    if (bitmap->count > 0 && bitmap->containers[bitmap->count - 1].key <= key) {
+        *found = bitmap->containers[bitmap->count - 1].key == key;
+        return *found ? bitmap->count - 1 : bitmap->count;
+    }
+    int low = 0, high = bitmap->count;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (bitmap->containers[middle].key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    *found = low < bitmap->count && bitmap->containers[low].key == key;
+    return low;
+}
+
+
+/*
+ * Insert an empty container
+ *
+ * return struct bitmap_container*: The new container, NULL if memory ran out
+ */
+static struct bitmap_container *insert_container(struct bitmap *bitmap, const int position, const uint16_t key) {
+    if (bitmap->count == bitmap->capacity) {
+        const int capacity = bitmap->capacity ? 2 * bitmap->capacity : 4;
+        struct bitmap_container *containers = realloc(bitmap->containers, capacity * sizeof(struct bitmap_container));
+        if (!containers)
+            return NULL;
+        bitmap->containers = containers;
+        bitmap->capacity = capacity;
+    }
+    memmove(&bitmap->containers[position + 1], &bitmap->containers[position],
+        (size_t) (bitmap->count - position) * sizeof(struct bitmap_container));
+    bitmap->count++;
+    struct bitmap_container *container = &bitmap->containers[position];
+    memset(container, 0, sizeof(struct bitmap_container));
+    container->key = key;
+    return container;
+}
+
+
+/*
+ * Turn a full array container into a bitset container
+ */
+static bool convert_to_bitset(struct bitmap_container *container) {
+    uint64_t *words = calloc(BITMAP_CONTAINER_WORDS, sizeof(uint64_t));
+    if (!words)
+        return false;
+    for (uint32_t i = 0; i < container->cardinality; i++)
+        words[container->values[i] >> 6] |= 1ULL << (container->values[i] & 63);
+    free(container->values);
+    container->values = NULL;
+    container->capacity = 0;
+    container->words = words;
+    container->is_bitset = true;
+    return true;
+}
+
+
+/*
+ * Add a value to a bitmap
+ *
+ * param struct bitmap* bitmap: The bitmap
+ * param uint32_t value: The value
+ * return bool: false if memory ran out
+ */
+bool bitmap_add(struct bitmap *bitmap, const uint32_t value) {
+    const uint16_t key = (uint16_t) (value >> 16);
+    const uint16_t low_bits = (uint16_t) value;
+    bool found;
+    const int position = find_container(bitmap, key, &found);
+    struct bitmap_container *container = found ? &bitmap->containers[position] : insert_container(bitmap, position, key);
+    if (!container)
+        return false;
+
+    if (container->is_bitset) {
+        uint64_t *word = &container->words[low_bits >> 6];
+        const uint64_t bit = 1ULL << (low_bits & 63);
+        if (!(*word & bit)) {
+            *word |= bit;
+            container->cardinality++;
+        }
+        return true;
+    }
+
+    // Find the insert position, appending is the common case
+    uint32_t index = container->cardinality;
+    if (index > 0 && container->values[index - 1] >= low_bits) {
+        uint32_t low = 0, high = container->cardinality;
+        while (low < high) {
+            const uint32_t middle = low + (high - low) / 2;
+            if (container->values[middle] < low_bits)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (container->values[low] == low_bits)
+            return true;
+        index = low;
+    }
+    if (container->cardinality == BITMAP_ARRAY_MAX) {
+        if (!convert_to_bitset(container))
+            return false;
+        return bitmap_add(bitmap, value);
+    }
+    if (container->cardinality == container->capacity) {
+        uint32_t capacity = container->capacity ? 2 * container->capacity : 8;
+        if (capacity > BITMAP_ARRAY_MAX)
+            capacity = BITMAP_ARRAY_MAX;
+        uint16_t *values = realloc(container->values, capacity * sizeof(uint16_t));
+        if (!values)
+            return false;
+        container->values = values;
+        container->capacity = capacity;
+    }
+    memmove(&container->values[index + 1], &container->values[index],
+        (container->cardinality - index) * sizeof(uint16_t));
+    container->values[index] = low_bits;
+    container->cardinality++;
+    return true;
+}
+
+
+/*
+ * Check whether a bitmap contains a value
+ *
+ * param const struct bitmap* bitmap: The bitmap
+ * param uint32_t value: The value
+ * return bool: true if the value is in the bitmap
+ */
+bool bitmap_contains(const struct bitmap *bitmap, const uint32_t value) {
+    bool found;
+    const int position = find_container(bitmap, (uint16_t) (value >> 16), &found);
+    if (!found)
+        return false;
+    const struct bitmap_container *container = &bitmap->containers[position];
+    const uint16_t low_bits = (uint16_t) value;
+    if (container->is_bitset)
+        return (container->words[low_bits >> 6] >> (low_bits & 63)) & 1;
+    uint32_t low = 0, high = container->cardinality;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        if (container->values[middle] < low_bits)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low < container->cardinality && container->values[low] == low_bits;
+}
+
+
+/*
+ * Count the values of a bitmap
+ *
+ * param const struct bitmap* bitmap: The bitmap
+ * return uint64_t: Number of values
+ */
+uint64_t bitmap_cardinality(const struct bitmap *bitmap) {
+    uint64_t count = 0;
+    for (int i = 0; i < bitmap->count; i++)
+        count += bitmap->containers[i].cardinality;
+    return count;
+}
+
+
+/*
+ * Combine two sorted array containers
+ *
+ * param uint16_t* output: Receives the result, room for both inputs
+ * return uint32_t: Number of values in the result
+ */
+static uint32_t combine_arrays(
+    const struct bitmap_container *a,
+    const struct bitmap_container *b,
+    const enum bitmap_operation operation,
+    uint16_t *output) {
+    uint32_t i = 0, j = 0, count = 0;
+    while (i < a->cardinality && j < b->cardinality) {
+        if (a->values[i] < b->values[j]) {
+            if (operation != OPERATION_AND)
+                output[count++] = a->values[i];
+            i++;
+        } else if (a->values[i] > b->values[j]) {
+            if (operation == OPERATION_OR)
+                output[count++] = b->values[j];
+            j++;
+        } else {
+            if (operation != OPERATION_ANDNOT)
+                output[count++] = a->values[i];
+            i++;
+            j++;
+        }
+    }
+    if (operation != OPERATION_AND) {
+        while (i < a->cardinality)
+            output[count++] = a->values[i++];
+    }
+    if (operation == OPERATION_OR) {
+        while (j < b->cardinality)
+            output[count++] = b->values[j++];
+    }
+    return count;
+}
+
+
+/*
+ * Expand a container into bitset words
+ */
+static void expand_container(const struct bitmap_container *container, uint64_t *words) {
+    if (container->is_bitset) {
+        memcpy(words, container->words, BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+        return;
+    }
+    memset(words, 0, BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+    for (uint32_t i = 0; i < container->cardinality; i++)
+        words[container->values[i] >> 6] |= 1ULL << (container->values[i] & 63);
+}
+
+
+/*
+ * Store the combination of two containers in a new container of the result.
+ * Two arrays are merged directly, everything else goes through bitset words
+ *
+ * return bool: false if memory ran out
+ */
+static bool combine_containers(
+    const struct bitmap_container *a,
+    const struct bitmap_container *b,
+    const enum bitmap_operation operation,
+    struct bitmap *result) {
+    if (!a->is_bitset && !b->is_bitset) {
+        uint16_t values[2 * BITMAP_ARRAY_MAX];
+        const uint32_t count = combine_arrays(a, b, operation, values);
+        if (count == 0)
+            return true;
+        struct bitmap_container *container = insert_container(result, result->count, a->key);
+        if (!container)
+            return false;
+        container->values = malloc(count * sizeof(uint16_t));
+        if (!container->values)
+            return false;
+        memcpy(container->values, values, count * sizeof(uint16_t));
+        container->cardinality = container->capacity = count;
+        // A union of two arrays can outgrow the array limit
+        return count <= BITMAP_ARRAY_MAX || convert_to_bitset(container);
+    }
+
+    uint64_t *words = malloc(2 * BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+    if (!words)
+        return false;
+    uint64_t *other = words + BITMAP_CONTAINER_WORDS;
+    expand_container(a, words);
+    expand_container(b, other);
+    uint32_t cardinality = 0;
+    for (int i = 0; i < BITMAP_CONTAINER_WORDS; i++) {
+        if (operation == OPERATION_AND)
+            words[i] &= other[i];
+        else if (operation == OPERATION_OR)
+            words[i] |= other[i];
+        else
+            words[i] &= ~other[i];
+        cardinality += count_bits(words[i]);
+    }
+    if (cardinality == 0) {
+        free(words);
+        return true;
+    }
+    struct bitmap_container *container = insert_container(result, result->count, a->key);
+    if (!container) {
+        free(words);
+        return false;
+    }
+    container->cardinality = cardinality;
+    if (cardinality > BITMAP_ARRAY_MAX) {
+        container->words = realloc(words, BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+        container->is_bitset = true;
+        return container->words != NULL;
+    }
+    // Sparse results go back to an array
+    container->values = malloc(cardinality * sizeof(uint16_t));
+    if (container->values) {
+        uint32_t count = 0;
+        for (int i = 0; i < BITMAP_CONTAINER_WORDS; i++) {
+            for (uint64_t word = words[i]; word; word &= word - 1)
+                container->values[count++] = (uint16_t) (i * 64 + lowest_bit(word));
+        }
+        container->capacity = cardinality;
+    }
+    free(words);
+    return container->values != NULL;
+}
+
+
+/*
+ * Copy a container into a new container at the end of the result
+ */
+static bool copy_container(const struct bitmap_container *source, struct bitmap *result) {
+    struct bitmap_container *container = insert_container(result, result->count, source->key);
+    if (!container)
+        return false;
+    container->is_bitset = source->is_bitset;
+    container->cardinality = source->cardinality;
+    if (source->is_bitset) {
+        container->words = malloc(BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+        if (container->words)
+            memcpy(container->words, source->words, BITMAP_CONTAINER_WORDS * sizeof(uint64_t));
+        return container->words != NULL;
+    }
+    container->capacity = source->cardinality ? source->cardinality : 1;
+    container->values = malloc(container->capacity * sizeof(uint16_t));
+    if (container->values)
+        memcpy(container->values, source->values, source->cardinality * sizeof(uint16_t));
+    return container->values != NULL;
+}
+
+
+/*
+ * Walk the containers of both bitmaps in key order and combine them.
+ * Containers only present in one bitmap are skipped or copied depending on the operation
+ *
+ * param struct bitmap* result: Receives the result, has to be initialized and is replaced
+ * return bool: false if memory ran out, the result is empty then
+ */
+static bool combine(
+    const struct bitmap *a,
+    const struct bitmap *b,
+    const enum bitmap_operation operation,
+    struct bitmap *result) {
+    struct bitmap combined;
+    bitmap_init(&combined);
+    int i = 0, j = 0;
+    bool ok = true;
+    while (ok && (i < a->count || j < b->count)) {
+        if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            if (operation != OPERATION_AND)
+                ok = copy_container(&a->containers[i], &combined);
+            i++;
+        } else if (i == a->count || a->containers[i].key > b->containers[j].key) {
+            if (operation == OPERATION_OR)
+                ok = copy_container(&b->containers[j], &combined);
+            j++;
+        } else {
+            ok = combine_containers(&a->containers[i], &b->containers[j], operation, &combined);
+            i++;
+            j++;
+        }
+    }
+    bitmap_free(result);
+    if (!ok) {
+        bitmap_free(&combined);
+        return false;
+    }
+    *result = combined;
+    return true;
+}
+
+
+/*
+ * Intersect two bitmaps. The result may be one of the inputs
+ *
+ * param const struct bitmap* a: The first bitmap
+ * param const struct bitmap* b: The second bitmap
+ * param struct bitmap* result: Receives the values in both, has to be initialized
+ * return bool: false if memory ran out
+ */
+bool bitmap_and(const struct bitmap *a, const struct bitmap *b, struct bitmap *result) {
+    return combine(a, b, OPERATION_AND, result);
+}
+
+
+/*
+ * Unite two bitmaps. The result may be one of the inputs
+ *
+ * param const struct bitmap* a: The first bitmap
+ * param const struct bitmap* b: The second bitmap
+ * param struct bitmap* result: Receives the values in either, has to be initialized
+ * return bool: false if memory ran out
+ */
+bool bitmap_or(const struct bitmap *a, const struct bitmap *b, struct bitmap *result) {
+    return combine(a, b, OPERATION_OR, result);
+}
+
+
+/*
+ * Subtract a bitmap from another. The result may be one of the inputs
+ *
+ * param const struct bitmap* a: The bitmap to subtract from
+ * param const struct bitmap* b: The values to remove
+ * param struct bitmap* result: Receives the values of a that are not in b, has to be initialized
+ * return bool: false if memory ran out
+ */
+bool bitmap_andnot(const struct bitmap *a, const struct bitmap *b, struct bitmap *result) {
+    return combine(a, b, OPERATION_ANDNOT, result);
+}
+
+
+/*
+ * List the values of a bitmap in ascending order
+ *
+ * param const struct bitmap* bitmap: The bitmap
+ * param size_t* count: Receives the number of values
+ * return uint32_t*: The values that have to be freed, NULL if memory ran out
+ */
+uint32_t *bitmap_to_array(const struct bitmap *bitmap, size_t *count) {
+    *count = (size_t) bitmap_cardinality(bitmap);
+    uint32_t *values = malloc((*count + 1) * sizeof(uint32_t));
+    if (!values)
+        return NULL;
+    size_t next = 0;
+    for (int i = 0; i < bitmap->count; i++) {
+        const struct bitmap_container *container = &bitmap->containers[i];
+        const uint32_t high_bits = (uint32_t) container->key << 16;
+        if (container->is_bitset) {
+            for (int w = 0; w < BITMAP_CONTAINER_WORDS; w++) {
+                for (uint64_t word = container->words[w]; word; word &= word - 1)
+                    values[next++] = high_bits | (uint32_t) (w * 64 + lowest_bit(word));
+            }
+        } else {
+            for (uint32_t v = 0; v < container->cardinality; v++)
+                values[next++] = high_bits | container->values[v];
+        }
+    }
+    return values;
+}
@@ -0,0 +1,39 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Values are split into the upper 16 bits selecting a container and the lower 16 bits stored in it.
+// Containers with up to this many values are sorted arrays, fuller ones are plain bitsets
+#define BITMAP_ARRAY_MAX 4096
+#define BITMAP_CONTAINER_WORDS 1024
+
+struct bitmap_container {
+    uint16_t key;
+    bool is_bitset;
+    uint32_t cardinality;
+    uint32_t capacity; // Capacity of values, unused for bitsets
+    uint16_t *values;  // Sorted lower bits of an array container
+    uint64_t *words;   // BITMAP_CONTAINER_WORDS words of a bitset container
+};
+
+// Compressed set of 32 bit integers in the style of a roaring bitmap
+struct bitmap {
+    struct bitmap_container *containers; // Sorted by key
+    int count;
+    int capacity;
+};
+
+void bitmap_init(struct bitmap *bitmap);
+void bitmap_free(struct bitmap *bitmap);
+bool bitmap_add(struct bitmap *bitmap, uint32_t value);
+bool bitmap_contains(const struct bitmap *bitmap, uint32_t value);
+uint64_t bitmap_cardinality(const struct bitmap *bitmap);
+bool bitmap_and(const struct bitmap *a, const struct bitmap *b, struct bitmap *result);
+bool bitmap_or(const struct bitmap *a, const struct bitmap *b, struct bitmap *result);
+bool bitmap_andnot(const struct bitmap *a, const struct bitmap *b, struct bitmap *result);
+uint32_t *bitmap_to_array(const struct bitmap *bitmap, size_t *count);
+
+#endif //BITMAP_H
@@ -0,0 +1,366 @@
+#include "breach.h"
+#include <openssl/evp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#define BREACH_MAGIC "CPBREACH"
+#define BREACH_FORMAT_VERSION 1
+// Bytes of each SHA-1 hash that are kept, 64 bits leave a negligible false positive rate
+#define BREACH_PREFIX_BYTES 8
+#define SHA1_BYTES 20
+// Shortest line of a HIBP file: 40 hex digits, ':', one digit and '\n'
+#define MIN_LINE_LENGTH 43
+// Aim for buckets small enough to fit into a single page
+#define TARGET_BUCKET_SIZE 32
+#define MIN_FANOUT_BITS 8
+#define MAX_FANOUT_BITS 24
+// Blocked Bloom filter: all bits of an entry live in one cache line
+#define BLOOM_BLOCK_BYTES 64
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_BYTES * 8)
+
+struct breach_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t prefix_bytes;
+    uint32_t fanout_bits;
+    uint32_t bloom_hashes;
+    uint64_t count;
+    uint64_t fanout_offset;
+    uint64_t bloom_offset;
+    uint64_t bloom_blocks;
+    uint64_t prefixes_offset;
+};
+
+
+/*
+ * Read the first eight bytes of a hash as big-endian number
+ *
+ * param const unsigned char* bytes: The hash bytes
+ * return uint64_t: The leading 64 bits of the hash
+ */
+static uint64_t leading_bits(const unsigned char *bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = value << 8 | bytes[i];
+    }
+    return value;
+}
+
+
+/*
+ * Compute the bit positions of a hash inside its Bloom filter block using double hashing
+ *
+ * param const unsigned char* hash: The full SHA-1 hash
+ * param uint64_t bloom_blocks: Number of blocks of the filter
+ * param uint64_t* block: Receives the index of the block
+ * param uint32_t* h1: Receives the first bit hash
+ * param uint32_t* h2: Receives the second bit hash
+ */
+static void bloom_position(const unsigned char *hash, const uint64_t bloom_blocks, uint64_t *block, uint32_t *h1, uint32_t *h2) {
+    *block = leading_bits(hash) % bloom_blocks;
+    *h1 = (uint32_t) hash[8] << 24 | (uint32_t) hash[9] << 16 | (uint32_t) hash[10] << 8 | hash[11];
+    *h2 = ((uint32_t) hash[12] << 24 | (uint32_t) hash[13] << 16 | (uint32_t) hash[14] << 8 | hash[15]) | 1;
+}
+
+
+/*
+ * Decode the leading 40 hex digits of a line into a SHA-1 hash
+ *
+ * param const char* line: The line, e.g. "000000005AD76BD555C1D6D771DE417A4B87E4B4:10"
+ * param unsigned char* hash: Receives the 20 bytes of the hash
+ * return bool: false if the line does not start with a hex encoded SHA-1 hash
+ */
+static bool parse_hex_hash(const char *line, unsigned char *hash) {
+    for (int i = 0; i < 2 * SHA1_BYTES; i++) {
+        const char c = line[i];
+        int nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else return false;
+        if (i % 2 == 0)
+            hash[i / 2] = (unsigned char) (nibble << 4);
+        else
+            hash[i / 2] |= (unsigned char) nibble;
+    }
+    return true;
+}
+
+
+/*
+ * Convert a sorted text corpus of SHA-1 hashes (one "HASH:COUNT" per line, as in the
+ * downloadable Have I Been Pwned files) once into the compact binary corpus format:
+ * a header, a fan-out table indexed by the leading hash bits, an optional blocked Bloom
+ * filter and the sorted, de-duplicated hash prefixes. The input is streamed line by line.
+ *
+ * param const char* text_file: Path of the sorted text corpus
+ * param const char* corpus_file: Path of the binary corpus to create
+ * param int bloom_bits_per_entry: Size of the Bloom filter in bits per entry, 0 for no filter
+ * return bool: Indication whether the conversion was successful
+ */
+bool convert_breach_corpus(const char *text_file, const char *corpus_file, const int bloom_bits_per_entry) {
+    struct stat info;
+    if (stat(text_file, &info) != 0) {
+        perror("Failed to open corpus");
+        return false;
+    }
+    FILE *input = fopen(text_file, "r");
+    if (!input) {
+        perror("Failed to open corpus");
+        return false;
+    }
+    FILE *output = fopen(corpus_file, "wb");
+    if (!output) {
+        perror("Failed to create corpus file");
+        fclose(input);
+        return false;
+    }
+
+    // The exact number of hashes is only known at the end, size the tables for the upper bound
+    const uint64_t estimate = (uint64_t) info.st_size / MIN_LINE_LENGTH + 1;
+    struct breach_file_header header = {0};
+    memcpy(header.magic, BREACH_MAGIC, sizeof(header.magic));
+    header.version = BREACH_FORMAT_VERSION;
+    header.prefix_bytes = BREACH_PREFIX_BYTES;
+    header.fanout_bits = MIN_FANOUT_BITS;
+    while (header.fanout_bits < MAX_FANOUT_BITS && estimate >> header.fanout_bits > TARGET_BUCKET_SIZE)
+        header.fanout_bits++;
+    if (bloom_bits_per_entry > 0) {
+        header.bloom_blocks = (estimate * bloom_bits_per_entry + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+        // The optimal number of hashes is ln(2) * bits per entry
+        header.bloom_hashes = (uint32_t) (bloom_bits_per_entry * 0.6931 + 0.5);
+        if (header.bloom_hashes < 1) header.bloom_hashes = 1;
+        if (header.bloom_hashes > 16) header.bloom_hashes = 16;
+    }
+    const uint64_t num_buckets = (uint64_t) 1 << header.fanout_bits;
+    header.fanout_offset = sizeof(header);
+    header.bloom_offset = (header.fanout_offset + (num_buckets + 1) * sizeof(uint64_t) + BLOOM_BLOCK_BYTES - 1) /
+        BLOOM_BLOCK_BYTES * BLOOM_BLOCK_BYTES;
+    header.prefixes_offset = header.bloom_offset + header.bloom_blocks * BLOOM_BLOCK_BYTES;
+
+    uint64_t *fanout = calloc(num_buckets + 1, sizeof(uint64_t));
+    unsigned char *bloom = header.bloom_blocks ? calloc(header.bloom_blocks, BLOOM_BLOCK_BYTES) : NULL;
+    bool ok = fanout && (bloom || !header.bloom_blocks) && fseeko(output, (off_t) header.prefixes_offset, SEEK_SET) == 0;
+    if (!ok)
+        perror("Failed to prepare corpus file");
+
+    char line[256];
+    unsigned char hash[SHA1_BYTES];
+    unsigned char previous[BREACH_PREFIX_BYTES] = {0};
+    uint64_t next_bucket = 0;
+    uint64_t line_number = 0;
+    while (ok && fgets(line, sizeof(line), input)) {
+        line_number++;
+        const size_t length = strlen(line);
+        // Skip the remainder of overlong lines
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n') {
+            int c;
+            while ((c = fgetc(input)) != EOF && c != '\n') {}
+        }
+        if (!parse_hex_hash(line, hash)) {
+            if (line[strspn(line, " \r\n")] == '\0')
+                continue;
+            printf("Line %llu is not a SHA-1 hash\n", (unsigned long long) line_number);
+            ok = false;
+            break;
+        }
+        if (header.count > 0) {
+            const int order = memcmp(hash, previous, BREACH_PREFIX_BYTES);
+            if (order < 0) {
+                printf("Line %llu is out of order, the corpus has to be sorted by hash\n",
+                    (unsigned long long) line_number);
+                ok = false;
+                break;
+            }
+            if (order == 0)
+                continue;
+        }
+
+        const uint64_t bucket = leading_bits(hash) >> (64 - header.fanout_bits);
+        while (next_bucket <= bucket)
+            fanout[next_bucket++] = header.count;
+        if (bloom) {
+            uint64_t block;
+            uint32_t h1, h2;
+            bloom_position(hash, header.bloom_blocks, &block, &h1, &h2);
+            unsigned char *bits = bloom + block * BLOOM_BLOCK_BYTES;
+            for (uint32_t i = 0; i < header.bloom_hashes; i++) {
+                const uint32_t bit = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+                bits[bit / 8] |= (unsigned char) (1u << bit % 8);
+            }
+        }
+        if (fwrite(hash, 1, BREACH_PREFIX_BYTES, output) != BREACH_PREFIX_BYTES) {
+            perror("Failed to write corpus file");
+            ok = false;
+            break;
+        }
+        memcpy(previous, hash, BREACH_PREFIX_BYTES);
+        header.count++;
+    }
+    if (ok && ferror(input)) {
+        perror("Failed to read corpus");
+        ok = false;
+    }
+
+    if (ok) {
+        while (next_bucket <= num_buckets)
+            fanout[next_bucket++] = header.count;
+        ok = fseeko(output, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, output) == 1 &&
+            fwrite(fanout, sizeof(uint64_t), num_buckets + 1, output) == num_buckets + 1 &&
+            (!bloom || (fseeko(output, (off_t) header.bloom_offset, SEEK_SET) == 0 &&
+                fwrite(bloom, BLOOM_BLOCK_BYTES, header.bloom_blocks, output) == header.bloom_blocks));
+        if (!ok)
+            perror("Failed to write corpus file");
+    }
+    if (fclose(output) != 0)
+        ok = false;
+    fclose(input);
+    free(fanout);
+    free(bloom);
+    if (!ok)
+        remove(corpus_file);
+    return ok;
+}
+
+
+/*
+ * Get the path of the binary breach corpus
+ *
+ * return const char*: The value of C_PASS_BREACH_CORPUS if set, DEFAULT_BREACH_CORPUS otherwise
+ */
+const char *default_breach_corpus_path(void) {
+    const char *path = getenv("C_PASS_BREACH_CORPUS");
+    return path && *path ? path : DEFAULT_BREACH_CORPUS;
+}
+
+
+/*
+ * Memory-map a binary breach corpus created by convert_breach_corpus.
+ * Nothing is read up front, pages are only touched by lookups.
+ *
+ * param const char* corpus_file: Path of the binary corpus
+ * return struct breach_corpus*: The opened corpus or NULL if it does not exist or is invalid
+ */
+struct breach_corpus *open_breach_corpus(const char *corpus_file) {
+#if defined(_WIN32)
+    (void) corpus_file;
+    return NULL;
+#else
+    const int fd = open(corpus_file, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(struct breach_file_header)) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+    // Lookups jump around the file, read-ahead would only waste I/O
+    madvise(map, info.st_size, MADV_RANDOM);
+
+    const struct breach_file_header *header = map;
+    const uint64_t size = (uint64_t) info.st_size;
+    const uint64_t num_buckets = (uint64_t) 1 << (header->fanout_bits <= MAX_FANOUT_BITS ? header->fanout_bits : 0);
+    if (memcmp(header->magic, BREACH_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != BREACH_FORMAT_VERSION ||
+        header->prefix_bytes != BREACH_PREFIX_BYTES ||
+        header->fanout_bits > MAX_FANOUT_BITS ||
+        header->fanout_offset + (num_buckets + 1) * sizeof(uint64_t) > size ||
+        header->bloom_offset + header->bloom_blocks * BLOOM_BLOCK_BYTES > size ||
+        header->prefixes_offset + header->count * BREACH_PREFIX_BYTES > size) {
+        munmap(map, info.st_size);
+        return NULL;
+    }
+
+    struct breach_corpus *corpus = calloc(1, sizeof(struct breach_corpus));
+    if (!corpus) {
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    corpus->map = map;
+    corpus->map_size = info.st_size;
+    corpus->count = header->count;
+    corpus->fanout_bits = header->fanout_bits;
+    corpus->bloom_hashes = header->bloom_blocks ? header->bloom_hashes : 0;
+    corpus->fanout = (const uint64_t *) (corpus->map + header->fanout_offset);
+    corpus->bloom = header->bloom_blocks ? corpus->map + header->bloom_offset : NULL;
+    corpus->bloom_blocks = header->bloom_blocks;
+    corpus->prefixes = corpus->map + header->prefixes_offset;
+    return corpus;
+#endif
+}
+
+
+/*
+ * Unmap and free a breach corpus
+ *
+ * param struct breach_corpus* corpus: The corpus to close, may be NULL
+ */
+void close_breach_corpus(struct breach_corpus *corpus) {
+    if (!corpus)
+        return;
+#if !defined(_WIN32)
+    munmap((void *) corpus->map, corpus->map_size);
+#endif
+    free(corpus);
+}
+
+
+/*
+ * Check whether the SHA-1 hash of a password is contained in the breach corpus.
+ * A lookup touches at most one Bloom filter block, two adjacent fan-out entries and
+ * one small bucket of prefixes, so it needs a constant number of page accesses
+ * independent of the size of the corpus.
+ *
+ * param const struct breach_corpus* corpus: The opened corpus, may be NULL
+ * param const char* password: The cleartext password
+ * return bool: true if the password appears in the corpus
+ */
+bool is_password_breached(const struct breach_corpus *corpus, const char *password) {
+    if (!corpus || corpus->count == 0)
+        return false;
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_length;
+    if (!EVP_Digest(password, strlen(password), hash, &hash_length, EVP_sha1(), NULL))
+        return false;
+
+    if (corpus->bloom) {
+        uint64_t block;
+        uint32_t h1, h2;
+        bloom_position(hash, corpus->bloom_blocks, &block, &h1, &h2);
+        const unsigned char *bits = corpus->bloom + block * BLOOM_BLOCK_BYTES;
+        for (uint32_t i = 0; i < corpus->bloom_hashes; i++) {
+            const uint32_t bit = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+            if (!(bits[bit / 8] & 1u << bit % 8))
+                return false;
+        }
+    }
+
+    const uint64_t bucket = leading_bits(hash) >> (64 - corpus->fanout_bits);
+    uint64_t low = corpus->fanout[bucket];
+    uint64_t high = corpus->fanout[bucket + 1];
+    while (low < high) {
+        const uint64_t middle = low + (high - low) / 2;
+        const int order = memcmp(corpus->prefixes + middle * BREACH_PREFIX_BYTES, hash, BREACH_PREFIX_BYTES);
+        if (order == 0)
+            return true;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef BREACH_H
+#define BREACH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Default file name of the converted corpus, overridable with the C_PASS_BREACH_CORPUS environment variable
+#define DEFAULT_BREACH_CORPUS "c_pass_breach.bin"
+
+struct breach_corpus {
+    const unsigned char *map;      // The memory-mapped file
+    size_t map_size;
+    uint64_t count;                // Number of hash prefixes
+    uint32_t fanout_bits;          // Number of leading hash bits indexing the fan-out table
+    uint32_t bloom_hashes;         // Number of bits set per entry in the Bloom filter, 0 if there is none
+    const uint64_t *fanout;        // fanout[b] is the index of the first prefix whose leading bits are >= b
+    const unsigned char *bloom;    // Blocked Bloom filter of 64-byte blocks, NULL if there is none
+    uint64_t bloom_blocks;
+    const unsigned char *prefixes; // Sorted big-endian hash prefixes of BREACH_PREFIX_BYTES each
+};
+
+bool convert_breach_corpus(const char *text_file, const char *corpus_file, int bloom_bits_per_entry);
+const char *default_breach_corpus_path(void);
+struct breach_corpus *open_breach_corpus(const char *corpus_file);
+void close_breach_corpus(struct breach_corpus *corpus);
+bool is_password_breached(const struct breach_corpus *corpus, const char *password);
+
+#endif //BREACH_H
@@ -0,0 +1,1547 @@
+#include "commands.h"
+#include <openssl/crypto.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rotation.h"
+#include "breach.h"
+#include "audit.h"
+#include "strength.h"
+#include "secure_heap.h"
+#include "backup.h"
+#include "crypto.h"
+#include "tag_index.h"
+#include "federation.h"
+#include "login.h"
+#include "frecency.h"
+#include "history.h"
+#include "workload.h"
+#include "attachments.h"
+#include "expiry.h"
+#include "session_cache.h"
+#include "util.h"
+
+// Data encrypted per round of bench-ciphers and the number of rounds, the fastest round counts
+#define BENCH_CIPHERS_DEFAULT_MIB 64
+#define BENCH_CIPHERS_ROUNDS 5
+// Saves and unlocks per codec of bench-codecs, the fastest one counts
+#define BENCH_CODECS_ROUNDS 3
+// Parses per thread count of bench-parse, the fastest one counts
+#define BENCH_PARSE_ROUNDS 5
+// Cold and warm unlocks of bench-unlock unless --rounds is given, the fastest one counts
+#define BENCH_UNLOCK_ROUNDS 10
+// Seconds a key cached only for bench-unlock may outlive the command if it is interrupted
+#define BENCH_UNLOCK_TIMEOUT 60
+// Stand-in master password bench-unlock derives a key from
+#define BENCH_UNLOCK_PASSWORD "correct-horse-battery"
+// Matches printed by search unless --limit is given
+#define FEDERATED_SEARCH_LIMIT 50
+
+
+/*
+ * Check whether the given word names a command that can be run without the interactive menu
+ *
+ * param const char* command: The first command line argument
+ * return bool: true if the command is known
+ */
+bool is_known_command(const char *command) {
+    return strcmp(command, "rotate") == 0 ||
+        strcmp(command, "import") == 0 ||
+        strcmp(command, "export") == 0 ||
+        strcmp(command, "breach-check") == 0 ||
+        strcmp(command, "audit") == 0 ||
+        strcmp(command, "strength") == 0 ||
+        strcmp(command, "sync") == 0 ||
+        strcmp(command, "sync-serve") == 0 ||
+        strcmp(command, "backup") == 0 ||
+        strcmp(command, "bench-ciphers") == 0 ||
+        strcmp(command, "bench-codecs") == 0 ||
+        strcmp(command, "bench-parse") == 0 ||
+        strcmp(command, "list") == 0 ||
+        strcmp(command, "recent") == 0 ||
+        strcmp(command, "history") == 0 ||
+        strcmp(command, "attach") == 0 ||
+        strcmp(command, "attachments") == 0 ||
+        strcmp(command, "extract") == 0 ||
+        strcmp(command, "detach") == 0 ||
+        strcmp(command, "expiry") == 0 ||
+        strcmp(command, "unlock") == 0 ||
+        strcmp(command, "lock") == 0 ||
+        strcmp(command, "flush") == 0 ||
+        strcmp(command, "bench-unlock") == 0 ||
+        strcmp(command, "search") == 0 ||
+        strcmp(command, "get") == 0 ||
+        strcmp(command, "replay") == 0 ||
+        strcmp(command, "policy") == 0 ||
+        strcmp(command, "tag") == 0;
+}
+
+
+/*
+ * Check whether a command works on the vault and therefore needs the master password
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * return bool: false for commands that run without unlocking the vault
+ */
+bool command_needs_vault(const int argc, char *argv[]) {
+    if (strcmp(argv[0], "bench-ciphers") == 0 || strcmp(argv[0], "search") == 0 || strcmp(argv[0], "get") == 0 ||
+        strcmp(argv[0], "replay") == 0 || strcmp(argv[0], "lock") == 0 || strcmp(argv[0], "flush") == 0)
+        return false;
+    if (strcmp(argv[0], "backup") == 0)
+        return !(argc > 1 && (strcmp(argv[1], "list") == 0 || strcmp(argv[1], "prune") == 0));
+    return !(strcmp(argv[0], "breach-check") == 0 && argc > 1 && strcmp(argv[1], "convert") == 0);
+}
+
+
+/*
+ * Print the command line usage
+ *
+ * param const char* program: Name of the executable as passed in argv[0]
+ */
+void print_usage(const char *program) {
+    printf("Usage: %s [--vault PATH] [command]\n\n", program);
+    printf("Without a command the interactive menu is started.\n");
+    printf("The vault is PATH, $%s or %s.\n\n", VAULT_ENVIRONMENT_VARIABLE, DEFAULT_VAULT_FILE);
+    printf("Commands:\n");
+    printf("  list [QUERY]\n");
+    printf("      List the entries matching a query such as 'tag:prod AND tag:db NOT tag:legacy'.\n");
+    printf("      Terms are tag:TAG, folder:PATH (with subfolders) and name:PATTERN, combined with\n");
+    printf("      AND, OR, NOT and parentheses\n");
+    printf("  history PATTERN [--restore N]\n");
+    printf("      Show the former passwords of the matching entries, newest first, or put back the Nth one\n");
+    printf("      (kept per entry: $%s or %d, 0 disables the history)\n", HISTORY_DEPTH_VARIABLE,
+        DEFAULT_HISTORY_DEPTH);
+    printf("  attach PATTERN FILE [--label LABEL]\n");
+    printf("      Encrypt FILE into the attachment file next to the vault and reference it from the one\n");
+    printf("      entry whose name matches PATTERN, e.g. an SSH key or a certificate\n");
+    printf("  attachments [PATTERN]\n");
+    printf("      List the attachments of the matching entries (default: all) by ID, size and label\n");
+    printf("  extract ID FILE\n");
+    printf("      Decrypt the attachment ID into the new file FILE\n");
+    printf("  detach ID\n");
+    printf("      Remove the reference to the attachment ID, its bytes stay in the attachment file\n");
+    printf("  recent [--top K]\n");
+    printf("      List the K entries shown most often and most recently (default %d)\n", DEFAULT_TOP_ENTRIES);
+    printf("  search TERM [--vault PATH]... [--limit N]\n");
+    printf("  get NAME [--vault PATH]...\n");
+    printf("      Unlock several vaults at once and rank the matching entries of all of them, or show\n");
+    printf("      the entries named NAME (vaults: each --vault, $%s separated by '%c', or the vault)\n",
+        VAULTS_ENVIRONMENT_VARIABLE, VAULT_LIST_SEPARATOR);
+    printf("  policy [list]\n");
+    printf("      List the vault requirement and the named policies with the entries following them\n");
+    printf("  policy set NAME [--length N] [--max-length N] [--digits N] [--special N] [--upper N]\n");
+    printf("             [--allowed SET] [--required SET --required-count N] [--strength N]\n");
+    printf("             [--max-age DAYS] [--folder PATH]... [--entry PATTERN]...\n");
+    printf("      Define a policy for the entries of the folders (with subfolders) or matching the patterns.\n");
+    printf("      SETs are characters and ranges such as 'a-zA-Z0-9_'. Audits, rotation and the menu\n");
+    printf("      check and generate passwords of these entries against the policy\n");
+    printf("  policy delete NAME\n");
+    printf("  policy max-age DAYS\n");
+    printf("      Days a password following the vault requirement may be kept, 0 for no limit\n");
+    printf("  expiry [--within DAYS] [--top K]\n");
+    printf("      List the passwords that exceed the maximum age of their policy within DAYS\n");
+    printf("      (default %d), the earliest first\n", DEFAULT_EXPIRY_WINDOW_DAYS);
+    printf("  unlock [--timeout SECONDS]\n");
+    printf("      Keep the key of the vault in the kernel keyring, so the following commands on it skip the\n");
+    printf("      password prompt and the key derivation (default: $%s or %d seconds, keyring: $%s=session|user)\n",
+        SESSION_TIMEOUT_VARIABLE, DEFAULT_SESSION_TIMEOUT, SESSION_KEYRING_VARIABLE);
+    printf("  lock\n");
+    printf("      Drop the cached key of the vault\n");
+    printf("  flush\n");
+    printf("      Drop the cached keys of all vaults\n");
+    printf("  tag PATTERN [+TAG] [-TAG] [--folder PATH]\n");
+    printf("      Add or remove tags of all entries whose name matches PATTERN and move them to a folder\n");
+    printf("  rotate [--name PATTERN] [--username PATTERN] [--noncompliant] [--weak] [--breached] [--reused] [--keep-history] [--report FILE]\n");
+    printf("      Regenerate all matching passwords against the current requirements and\n");
+    printf("      write the new credentials as JSON lines to FILE (default: stdout).\n");
+    printf("      --keep-history records the replaced passwords in the password history\n");
+    printf("  import FILE [--format csv|jsonl]\n");
+    printf("      Add all entries of a CSV or JSON Lines file ('-' for stdin, CSV unless --format is given) to the vault\n");
+    printf("  export FILE [--format csv|jsonl]\n");
+    printf("      Write all entries as CSV or JSON Lines to FILE ('-' for stdout, CSV unless --format is given)\n");
+    printf("      The file is created readable by its owner only\n");
+    printf("  audit [--near]\n");
+    printf("      Report passwords not meeting the requirements and reused passwords,\n");
+    printf("      with --near also near-duplicates such as an incremented suffix\n");
+    printf("  strength [--all]\n");
+    printf("      Estimate how easy each password is to guess and list those below the\n");
+    printf("      minimum strength score, with --all list every entry with its score\n");
+    printf("  breach-check convert TEXT_CORPUS [CORPUS] [--bloom BITS_PER_ENTRY]\n");
+    printf("      Convert a sorted SHA-1 corpus (HASH:COUNT per line) once into the binary corpus format\n");
+    printf("  breach-check [--corpus CORPUS]\n");
+    printf("      List all entries whose password appears in the breach corpus\n");
+    printf("      (default corpus: $C_PASS_BREACH_CORPUS or %s)\n", DEFAULT_BREACH_CORPUS);
+    printf("  sync-serve ADDRESS [--once]\n");
+    printf("      Serve the vault to sync clients on HOST:PORT or a Unix socket path\n");
+    printf("  sync ADDRESS\n");
+    printf("      Make the vault a copy of the one served at ADDRESS, transferring only changed entries\n");
+    printf("  backup [create]\n");
+    printf("      Add the saved vault to the backup store, only chunks not stored yet are written\n");
+    printf("      (store: $C_PASS_BACKUP_DIR or VAULT%s, empty disables the backup after each save)\n",
+        BACKUP_DIRECTORY_SUFFIX);
+    printf("  backup list\n");
+    printf("      List the backed up versions with the bytes each of them added\n");
+    printf("  backup prune --keep N\n");
+    printf("      Delete all but the newest N versions and the chunks only they referenced\n");
+    printf("  backup restore VERSION\n");
+    printf("      Replace the vault with a backed up version, saved as a new version\n");
+    printf("  bench-ciphers [--size MIB]\n");
+    printf("      Measure each cipher suite on this host and recommend the fastest, set it with\n");
+    printf("      %s=NAME to re-encrypt the vault with it on the next save\n", CIPHER_ENVIRONMENT_VARIABLE);
+    printf("  bench-codecs\n");
+    printf("      Compare file size, save and unlock time of the vault for each compression setting,\n");
+    printf("      select one with %s=none|zlib|zlib:LEVEL\n", CODEC_ENVIRONMENT_VARIABLE);
+    printf("  bench-parse [--threads N]\n");
+    printf("      Measure parsing the decrypted vault with 1, 2, 4, ... up to N threads\n");
+    printf("      (default: the number of processors, %d here)\n", available_threads());
+    printf("  bench-unlock [--rounds N]\n");
+    printf("      Compare unlocking the vault with the key derivation and with the key cached by unlock\n");
+    printf("  replay TRACE [--entries N]...\n");
+    printf("      Run the menu operations recorded in TRACE against synthetic vaults of N entries each\n");
+    printf("      (default %d) and print the latency of every operation. Menu sessions are recorded\n",
+        DEFAULT_REPLAY_ENTRIES);
+    printf("      to $%s if set, without names or passwords\n", TRACE_ENVIRONMENT_VARIABLE);
+}
+
+
+/*
+ * Write the output a command left for after the vault is saved and release it
+ *
+ * param struct command_output* output: The pending output, empty afterwards
+ * param bool saved: Whether the changes of the command were saved, the output is discarded otherwise
+ * return bool: false if the output was discarded or could not be written
+ */
+bool finish_command(struct command_output *output, const bool saved) {
+    if (!output->report)
+        return true;
+    bool ok = saved && write_rotation_report(output->report, &output->rotation);
+    if (output->report_file) {
+        ok = fclose(output->report) == 0 && ok;
+        // An empty report would suggest that nothing was rotated
+        if (!saved)
+            remove(output->report_file);
+    }
+    if (!saved && output->rotation.count > 0)
+        printf("The vault was not saved, so the rotation report was not written\n");
+    else if (saved && !ok)
+        printf("Failed to write the rotation report, the new passwords are saved in the vault\n");
+    else if (saved && output->report_file)
+        // Keep stdout machine-readable when the report is written there
+        printf("%d password(s) rotated.\n", output->rotation.count);
+    free_rotation_report(&output->rotation);
+    memset(output, 0, sizeof(struct command_output));
+    return ok;
+}
+
+
+/*
+ * Run the audit command, printing requirement violations and reused passwords
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param const struct password_requirement* requirement: The current password requirement
+ * return int: Exit code of the command
+ */
+static int run_audit(
+    const int argc,
+    char *argv[],
+    struct password **passwords,
+    const int num_passwords,
+    const struct password_requirement *requirement) {
+    bool find_near = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--near") == 0) {
+            find_near = true;
+        } else {
+            printf("Unknown option for audit: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    struct reuse_report report;
+    if (!find_reused_passwords(passwords, num_passwords, find_near, &report)) {
+        printf("Failed to search for reused passwords\n");
+        return 1;
+    }
+    print_audit_report(stdout, passwords, num_passwords, requirement, &report);
+    free_reuse_report(&report);
+    return 0;
+}
+
+
+/*
+ * Run the strength command, scoring every password of the vault
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param const struct password_requirement* requirement: The current password requirement
+ * return int: Exit code of the command, 3 if passwords below the minimum strength were found
+ */
+static int run_strength(
+    const int argc,
+    char *argv[],
+    struct password **passwords,
+    const int num_passwords,
+    const struct password_requirement *requirement) {
+    bool list_all = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--all") == 0) {
+            list_all = true;
+        } else {
+            printf("Unknown option for strength: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    return print_strength_report(stdout, passwords, num_passwords, requirement, list_all) > 0 ? 3 : 0;
+}
+
+
+/*
+ * Run the breach-check command, listing every entry whose password is in the breach corpus
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return int: Exit code of the command, 3 if breached passwords were found
+ */
+static int run_breach_check(const int argc, char *argv[], struct password **passwords, const int num_passwords) {
+    const char *corpus_file = default_breach_corpus_path();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpus_file = argv[++i];
+        } else {
+            printf("Unknown option for breach-check: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    struct breach_corpus *corpus = open_breach_corpus(corpus_file);
+    if (!corpus) {
+        printf("Failed to open breach corpus %s, create it with 'breach-check convert'\n", corpus_file);
+        return 1;
+    }
+
+    int breached = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] != NULL && is_password_breached(corpus, passwords[i]->password)) {
+            printf("BREACHED: %s (%s)\n", passwords[i]->name, passwords[i]->username);
+            breached++;
+        }
+    }
+    printf("%d of %d password(s) found in %llu breached hashes.\n",
+        breached, count_live_passwords(passwords, num_passwords), (unsigned long long) corpus->count);
+    close_breach_corpus(corpus);
+    return breached > 0 ? 3 : 0;
+}
+
+
+/*
+ * Run the bench-ciphers command, measuring the throughput of every cipher suite on this host
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * return int: Exit code of the command
+ */
+static int run_bench_ciphers(const int argc, char *argv[]) {
+    int size_mib = BENCH_CIPHERS_DEFAULT_MIB;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size_mib = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for bench-ciphers: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (size_mib < 1 || size_mib > 1024) {
+        printf("--size has to be between 1 and 1024 MiB\n");
+        return 2;
+    }
+
+    printf("AES instructions: %s\n", has_aes_acceleration() ? "yes" : "no");
+    enum cipher_suite fastest = CIPHER_AES_256_GCM;
+    double fastest_speed = 0;
+    for (int i = 0; i < CIPHER_SUITE_COUNT; i++) {
+        const enum cipher_suite suite = (enum cipher_suite) i;
+        const double speed = benchmark_cipher_suite(suite, (size_t) size_mib * 1024 * 1024, BENCH_CIPHERS_ROUNDS);
+        if (speed <= 0) {
+            printf("%-20s unavailable\n", cipher_suite_name(suite));
+            continue;
+        }
+        printf("%-20s %10.1f MiB/s%s\n", cipher_suite_name(suite), speed,
+            suite == CIPHER_AES_256_CBC ? "  (legacy, no integrity protection)" : "");
+        // Only authenticated suites are recommended
+        if (suite != CIPHER_AES_256_CBC && speed > fastest_speed) {
+            fastest = suite;
+            fastest_speed = speed;
+        }
+    }
+    printf("Recommended: %s\n", cipher_suite_name(fastest));
+    printf("In use for new saves: %s\n", cipher_suite_name(preferred_cipher_suite()));
+    return 0;
+}
+
+
+/*
+ * Get the milliseconds passed since a point in time
+ */
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return 1000.0 * (double) (now.tv_sec - since->tv_sec) + (double) (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+
+/*
+ * Ask for the master password of every vault of a federation and derive its vault key. An empty
+ * input reuses the key of the previous vault, vault files that do not exist are skipped
+ *
+ * param struct federation* federation: The federation
+ * return bool: false if memory ran out
+ */
+static bool ask_federation_passwords(struct federation *federation) {
+    const struct vault_key *previous = NULL;
+    for (int i = 0; i < federation->num_vaults; i++) {
+        struct federated_vault *vault = &federation->vaults[i];
+        if (!file_exists(vault->path)) {
+            printf("Skipping %s, no such vault\n", vault->path);
+            continue;
+        }
+        printf("Master password for %s%s\n", vault->path, previous ? " (empty reuses the previous one)" : "");
+        char *password = read_password();
+        vault->vault_key = password ? secure_malloc(sizeof(struct vault_key)) : NULL;
+        bool derived = vault->vault_key != NULL;
+        if (derived && *password == '\0' && previous)
+            *vault->vault_key = *previous;
+        else if (derived)
+            derived = derive_vault_key(password, vault->vault_key);
+        secure_free(password);
+        if (!derived)
+            return false;
+        previous = vault->vault_key;
+    }
+    return true;
+}
+
+
+/*
+ * Run the search and get commands, which unlock several vaults at once and look up entries in all of them.
+ * The vaults are given with --vault, by C_PASS_VAULTS or default to the single vault of the other commands
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * return int: Exit code of the command
+ */
+static int run_federated(const int argc, char *argv[]) {
+    const bool exact = strcmp(argv[0], "get") == 0;
+    const char *term = NULL;
+    const char *paths[MAX_FEDERATED_VAULTS];
+    int num_paths = 0;
+    int limit = FEDERATED_SEARCH_LIMIT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--vault") == 0 && i + 1 < argc) {
+            if (num_paths == MAX_FEDERATED_VAULTS) {
+                printf("At most %d vaults can be opened at once\n", MAX_FEDERATED_VAULTS);
+                return 2;
+            }
+            paths[num_paths++] = argv[++i];
+        } else if (!exact && strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+            limit = atoi(argv[++i]);
+        } else if (!term && argv[i][0] != '-') {
+            term = argv[i];
+        } else {
+            printf("Unknown option for %s: %s\n", argv[0], argv[i]);
+            return 2;
+        }
+    }
+    if (!term || !*term) {
+        printf("%s needs a %s\n", argv[0], exact ? "NAME" : "TERM");
+        return 2;
+    }
+
+    char *vault_list = NULL;
+    if (num_paths == 0 && getenv(VAULTS_ENVIRONMENT_VARIABLE)) {
+        vault_list = strdup(getenv(VAULTS_ENVIRONMENT_VARIABLE));
+        if (!vault_list)
+            return 1;
+        num_paths = split_vault_list(vault_list, paths, MAX_FEDERATED_VAULTS);
+        if (num_paths < 0) {
+            printf("At most %d vaults can be opened at once\n", MAX_FEDERATED_VAULTS);
+            free(vault_list);
+            return 2;
+        }
+    }
+    if (num_paths == 0)
+        paths[num_paths++] = default_vault_path();
+
+    struct federation federation;
+    if (!open_federation(&federation, paths, num_paths) || !ask_federation_passwords(&federation)) {
+        close_federation(&federation);
+        free(vault_list);
+        return 1;
+    }
+    struct timespec started;
+    timespec_get(&started, TIME_UTC);
+    unlock_federation(&federation);
+    const double unlock_ms = elapsed_ms(&started);
+    int num_unlocked = 0;
+    double slowest = 0;
+    for (int i = 0; i < federation.num_vaults; i++) {
+        const struct federated_vault *vault = &federation.vaults[i];
+        if (!vault->vault_key)
+            continue;
+        if (vault->unlocked) {
+            num_unlocked++;
+            printf("%s: %d password(s), unlocked in %.1f ms\n", vault->path,
+                count_live_passwords(vault->passwords, vault->num_passwords), vault->unlock_ms);
+        } else {
+            printf("%s: wrong master password or damaged vault\n", vault->path);
+        }
+        if (vault->unlock_ms > slowest)
+            slowest = vault->unlock_ms;
+    }
+    printf("Unlocked %d of %d vault(s) in %.1f ms, the slowest took %.1f ms\n\n",
+        num_unlocked, federation.num_vaults, unlock_ms, slowest);
+
+    int num_matches = 0;
+    struct federated_match *matches = search_federation(&federation, term, exact, &num_matches);
+    if (!matches) {
+        printf("Failed to search the vaults\n");
+    } else if (num_matches == 0) {
+        printf("No entry %s %s\n", exact ? "named" : "matches", term);
+    } else if (exact) {
+        bool shown[MAX_FEDERATED_VAULTS] = {false};
+        for (int i = 0; i < num_matches; i++) {
+            struct password *entry = federation.vaults[matches[i].vault].passwords[matches[i].slot];
+            printf("[%s]\nUsername for %s: %s\nPassword: %s\n", federation.vaults[matches[i].vault].path,
+                entry->name, entry->username, entry->password);
+            record_access(entry);
+            shown[matches[i].vault] = true;
+        }
+        for (int i = 0; i < federation.num_vaults; i++) {
+            const struct federated_vault *vault = &federation.vaults[i];
+            if (shown[i] && !save_access_stats(vault->path, vault->vault_key, vault->passwords, vault->num_passwords))
+                printf("Failed to save the access counts of %s\n", vault->path);
+        }
+    } else {
+        for (int i = 0; i < num_matches && (limit <= 0 || i < limit); i++) {
+            const struct password *entry = federation.vaults[matches[i].vault].passwords[matches[i].slot];
+            printf("%3d  %-24s %-32s %s\n", matches[i].score, federation.vaults[matches[i].vault].path,
+                entry->name, entry->username);
+        }
+        if (limit > 0 && num_matches > limit)
+            printf("... %d more, raise --limit to see them\n", num_matches - limit);
+    }
+    const int exit_code = matches && num_matches > 0 ? 0 : 1;
+    free(matches);
+    close_federation(&federation);
+    free(vault_list);
+    return exit_code;
+}
+
+
+/*
+ * Run the replay command on a recorded trace
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * return int: Exit code of the command
+ */
+static int run_replay(const int argc, char *argv[]) {
+    const char *trace_path = NULL;
+    int sizes[MAX_REPLAY_SIZES];
+    int num_sizes = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--entries") == 0 && i + 1 < argc) {
+            if (num_sizes == MAX_REPLAY_SIZES) {
+                printf("At most %d vault sizes can be replayed at once\n", MAX_REPLAY_SIZES);
+                return 2;
+            }
+            sizes[num_sizes] = atoi(argv[++i]);
+            if (sizes[num_sizes] < 1) {
+                printf("--entries has to be at least 1\n");
+                return 2;
+            }
+            num_sizes++;
+        } else if (!trace_path) {
+            trace_path = argv[i];
+        } else {
+            printf("Unknown option for replay: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!trace_path) {
+        printf("Missing trace for replay\n");
+        return 2;
+    }
+    if (num_sizes == 0)
+        sizes[num_sizes++] = DEFAULT_REPLAY_ENTRIES;
+    return replay_trace(trace_path, sizes, num_sizes);
+}
+
+
+/*
+ * Run the lock or flush command, which drop cached vault keys without unlocking a vault
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const char* vault_path: The vault lock drops the key of
+ * return int: Exit code of the command
+ */
+static int run_lock(const int argc, char *argv[], const char *vault_path) {
+    if (argc > 1) {
+        printf("Unknown option for %s: %s\n", argv[0], argv[1]);
+        return 2;
+    }
+    if (!has_session_cache()) {
+        printf("Keys cannot be cached on this platform\n");
+        return 1;
+    }
+    if (strcmp(argv[0], "flush") == 0) {
+        if (!flush_session_keys()) {
+            printf("Failed to drop the cached keys\n");
+            return 1;
+        }
+        printf("All vaults are locked\n");
+    } else if (forget_session_key(vault_path)) {
+        printf("%s is locked\n", vault_path);
+    } else {
+        printf("%s was not unlocked\n", vault_path);
+    }
+    return 0;
+}
+
+
+/*
+ * Run a command that does not need the vault, e.g. converting a breach corpus
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const char* vault_path: The vault selected on the command line, it is not unlocked
+ * return int: Exit code of the command
+ */
+int run_standalone_command(const int argc, char *argv[], const char *vault_path) {
+    if (strcmp(argv[0], "backup") == 0)
+        return run_backup_store_command(argc, argv, vault_path);
+    if (strcmp(argv[0], "bench-ciphers") == 0)
+        return run_bench_ciphers(argc, argv);
+    if (strcmp(argv[0], "search") == 0 || strcmp(argv[0], "get") == 0)
+        return run_federated(argc, argv);
+    if (strcmp(argv[0], "replay") == 0)
+        return run_replay(argc, argv);
+    if (strcmp(argv[0], "lock") == 0 || strcmp(argv[0], "flush") == 0)
+        return run_lock(argc, argv, vault_path);
+
+    // breach-check convert TEXT_CORPUS [CORPUS] [--bloom BITS_PER_ENTRY]
+    const char *text_file = NULL;
+    const char *corpus_file = NULL;
+    int bloom_bits = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--bloom") == 0 && i + 1 < argc) {
+            bloom_bits = atoi(argv[++i]);
+        } else if (!text_file) {
+            text_file = argv[i];
+        } else if (!corpus_file) {
+            corpus_file = argv[i];
+        } else {
+            printf("Unknown option for breach-check convert: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!text_file) {
+        printf("Missing text corpus for breach-check convert\n");
+        return 2;
+    }
+    if (!corpus_file)
+        corpus_file = default_breach_corpus_path();
+    if (!convert_breach_corpus(text_file, corpus_file, bloom_bits)) {
+        printf("Failed to convert %s\n", text_file);
+        return 1;
+    }
+    printf("Breach corpus written to %s\n", corpus_file);
+    return 0;
+}
+
+
+/*
+ * Run the list command, printing the entries matching a tag and folder query
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name, the others form the query
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return int: Exit code of the command
+ */
+static int run_list(const int argc, char *argv[], struct password **passwords, const int num_passwords) {
+    // The shell splits the query into words, join them again
+    size_t length = 1;
+    for (int i = 1; i < argc; i++)
+        length += strlen(argv[i]) + 1;
+    char *query = malloc(length);
+    if (!query)
+        return 1;
+    query[0] = '\0';
+    for (int i = 1; i < argc; i++) {
+        strcat(query, argv[i]);
+        strcat(query, " ");
+    }
+
+    struct tag_index index;
+    struct bitmap matches;
+    bitmap_init(&matches);
+    const char *error = NULL;
+    struct timespec started;
+    if (!build_tag_index(passwords, num_passwords, &index)) {
+        free(query);
+        printf("Failed to index the vault\n");
+        return 1;
+    }
+    timespec_get(&started, TIME_UTC);
+    const bool ok = run_tag_query(&index, passwords, num_passwords, query, &matches, &error);
+    const double query_ms = elapsed_ms(&started);
+    free(query);
+    free_tag_index(&index);
+    if (!ok) {
+        printf("Invalid query: %s\n", error);
+        return 2;
+    }
+
+    size_t count = 0;
+    uint32_t *slots = bitmap_to_array(&matches, &count);
+    bitmap_free(&matches);
+    if (!slots)
+        return 1;
+    for (size_t i = 0; i < count; i++) {
+        const struct password *entry = passwords[slots[i]];
+        printf("%s\t%s\t%s\t%s\n", entry->name, entry->username, entry->folder ? entry->folder : "-",
+            entry->tags ? entry->tags : "-");
+    }
+    free(slots);
+    printf("%zu of %d password(s) match (query took %.3f ms).\n", count,
+        count_live_passwords(passwords, num_passwords), query_ms);
+    return 0;
+}
+
+
+/*
+ * Run the tag command, changing the tags and the folder of all entries whose name matches a pattern
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+static int run_tag(const int argc, char *argv[], struct password **passwords, const int num_passwords, bool *modified) {
+    const char *pattern = NULL;
+    const char *folder = NULL;
+    bool has_folder = false;
+    bool has_changes = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--folder") == 0 && i + 1 < argc) {
+            folder = argv[++i];
+            has_folder = has_changes = true;
+        } else if ((argv[i][0] == '+' || argv[i][0] == '-') && argv[i][1] != '\0' && argv[i][1] != '-') {
+            has_changes = true;
+        } else if (!pattern) {
+            pattern = argv[i];
+        } else {
+            printf("Unknown option for tag: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!pattern || !has_changes) {
+        printf("tag needs a name pattern and at least one +TAG, -TAG or --folder PATH\n");
+        return 2;
+    }
+
+    int changed = 0;
+    for (int slot = 0; slot < num_passwords; slot++) {
+        struct password *entry = passwords[slot];
+        if (!entry || !pattern_matches(pattern, entry->name))
+            continue;
+        bool ok = !has_folder || set_password_folder(entry, folder);
+        for (int i = 1; ok && i < argc; i++) {
+            if (strcmp(argv[i], "--folder") == 0) {
+                i++;
+            } else if ((argv[i][0] == '+' || argv[i][0] == '-') && argv[i][1] != '\0' && argv[i][1] != '-') {
+                ok = edit_password_tags(entry, argv[i] + 1, argv[i][0] == '+');
+            }
+        }
+        if (!ok) {
+            printf("Failed to tag %s\n", entry->name);
+            return 1;
+        }
+        changed++;
+    }
+    if (changed > 0)
+        *modified = true;
+    printf("%d password(s) updated.\n", changed);
+    return 0;
+}
+
+
+/*
+ * Run the bench-codecs command. Saves (serialize, compress, encrypt, write) and unlocks (read, decrypt,
+ * decompress, parse) the loaded vault with every compression setting next to the vault file
+ *
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * return int: Exit code of the command
+ */
+static int run_bench_codecs(
+    const struct vault_source *source,
+    struct password **passwords,
+    int num_passwords,
+    struct password_requirement *requirement) {
+    static const char *const settings[] = {"none", "zlib:1", "zlib:6", "zlib:9"};
+    const size_t path_length = strlen(source->path);
+    char *bench_path = malloc(path_length + sizeof(".bench"));
+    if (!bench_path)
+        return 1;
+    memcpy(bench_path, source->path, path_length);
+    memcpy(bench_path + path_length, ".bench", sizeof(".bench"));
+
+    struct vault_encoding encoding = preferred_vault_encoding();
+    printf("Cipher suite: %s, %d password(s)\n", cipher_suite_name(encoding.suite),
+        count_live_passwords(passwords, num_passwords));
+    printf("%-8s %12s %10s %10s\n", "Codec", "File bytes", "Save ms", "Unlock ms");
+    bool ok = true;
+    for (size_t i = 0; ok && i < sizeof(settings) / sizeof(settings[0]); i++) {
+        parse_vault_codec(settings[i], &encoding.codec, &encoding.level);
+        double best_save = 0, best_unlock = 0;
+        for (int round = 0; ok && round < BENCH_CODECS_ROUNDS; round++) {
+            struct timespec started;
+            timespec_get(&started, TIME_UTC);
+            char *cleartext = NULL;
+            ok = save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext) &&
+                encrypt_file_as(bench_path, &cleartext, source->vault_key, source->version, &encoding);
+            secure_free(cleartext);
+            const double save = elapsed_ms(&started);
+
+            timespec_get(&started, TIME_UTC);
+            cleartext = NULL;
+            ok = ok && decrypt_file(bench_path, &cleartext, source->vault_key, NULL);
+            if (ok) {
+                int num_loaded = 0;
+                free_password_requirement(read_password_requirement(cleartext));
+                struct password **loaded = read_passwords(cleartext, &num_loaded);
+                secure_free(cleartext);
+                free_passwords(loaded, num_loaded);
+                free(loaded);
+            }
+            const double unlock = elapsed_ms(&started);
+            if (round == 0 || save < best_save)
+                best_save = save;
+            if (round == 0 || unlock < best_unlock)
+                best_unlock = unlock;
+        }
+        FILE *file = ok ? fopen(bench_path, "rb") : NULL;
+        long size = -1;
+        if (file && fseek(file, 0, SEEK_END) == 0)
+            size = ftell(file);
+        if (file)
+            fclose(file);
+        if (ok)
+            printf("%-8s %12ld %10.1f %10.1f\n", settings[i], size, best_save, best_unlock);
+    }
+    remove(bench_path);
+    free(bench_path);
+    if (!ok) {
+        printf("Failed to save or unlock the benchmark vault\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Run the bench-parse command. Serializes the loaded vault once and parses the cleartext with
+ * a doubling number of threads, checking that every run yields the same number of entries
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * return int: Exit code of the command
+ */
+static int run_bench_parse(
+    const int argc,
+    char *argv[],
+    struct password **passwords,
+    int num_passwords,
+    struct password_requirement *requirement) {
+    int max_threads = available_threads();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for bench-parse: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (max_threads < 1 || max_threads > MAX_THREADS) {
+        printf("--threads has to be between 1 and %d\n", MAX_THREADS);
+        return 2;
+    }
+
+    char *cleartext = NULL;
+    if (!save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext)) {
+        printf("Failed to serialize the vault\n");
+        return 1;
+    }
+    const int expected = count_live_passwords(passwords, num_passwords);
+    printf("%zu cleartext bytes, %d password(s), %d processor(s)\n",
+        strlen(cleartext), expected, available_threads());
+    printf("%-8s %10s %8s\n", "Threads", "Parse ms", "Speedup");
+    bool ok = true;
+    double single = 0;
+    for (int threads = 1; ok; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        double best = 0;
+        for (int round = 0; ok && round < BENCH_PARSE_ROUNDS; round++) {
+            struct timespec started;
+            timespec_get(&started, TIME_UTC);
+            int num_loaded = 0;
+            struct password **loaded = read_passwords_with_threads(cleartext, &num_loaded, threads);
+            const double parse = elapsed_ms(&started);
+            ok = loaded && num_loaded == expected;
+            free_passwords(loaded, num_loaded);
+            free(loaded);
+            if (round == 0 || parse < best)
+                best = parse;
+        }
+        if (threads == 1)
+            single = best;
+        if (ok)
+            printf("%-8d %10.1f %7.2fx\n", threads, best, best > 0 ? single / best : 1.0);
+        if (threads >= max_threads)
+            break;
+    }
+    secure_free(cleartext);
+    if (!ok) {
+        printf("Parsing yielded a different number of entries\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Run the recent command, listing the entries used most often and most recently
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return int: Exit code of the command
+ */
+static int run_recent(const int argc, char *argv[], struct password **passwords, const int num_passwords) {
+    int top = DEFAULT_TOP_ENTRIES;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for recent: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (top < 1) {
+        printf("--top has to be at least 1\n");
+        return 2;
+    }
+    int *slots = malloc((size_t) top * sizeof(int));
+    const int count = slots ? top_frecent_passwords(passwords, num_passwords, top, slots) : -1;
+    if (count < 0) {
+        free(slots);
+        return 1;
+    }
+    if (count == 0)
+        printf("No password has been shown yet.\n");
+    const long long now = (long long) time(NULL);
+    for (int i = 0; i < count; i++) {
+        const struct password *entry = passwords[slots[i]];
+        char used[32] = "";
+        const time_t last_access = (time_t) entry->last_access;
+        const struct tm *local = localtime(&last_access);
+        if (local)
+            strftime(used, sizeof(used), "%Y-%m-%d %H:%M", local);
+        printf("%3d  %8.2f  %5u  %-16s  %s\t%s\n", i + 1, frecency_score(entry, now), entry->access_count, used,
+            entry->name, entry->username);
+    }
+    free(slots);
+    return 0;
+}
+
+
+/*
+ * Run the history command, showing the former passwords of the entries whose name matches
+ * a pattern, or putting one of them back
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+static int run_history(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password **passwords,
+    const int num_passwords,
+    bool *modified) {
+    const char *pattern = NULL;
+    int restore = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            restore = atoi(argv[++i]);
+            if (restore < 1) {
+                printf("--restore needs the number of a former password, 1 is the newest\n");
+                return 2;
+            }
+        } else if (!pattern) {
+            pattern = argv[i];
+        } else {
+            printf("Unknown option for history: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!pattern) {
+        printf("history needs a name PATTERN\n");
+        return 2;
+    }
+    int num_matches = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] && pattern_matches(pattern, passwords[i]->name))
+            num_matches++;
+    }
+    if (num_matches == 0) {
+        printf("No entry matches %s\n", pattern);
+        return 1;
+    }
+    if (restore && num_matches > 1) {
+        printf("%d entries match %s, --restore needs exactly one\n", num_matches, pattern);
+        return 2;
+    }
+
+    for (int i = 0; i < num_passwords; i++) {
+        struct password *entry = passwords[i];
+        if (!entry || !pattern_matches(pattern, entry->name))
+            continue;
+        struct history_item *items = NULL;
+        const int count = read_password_history(source->path, source->vault_key, entry, &items);
+        if (count < 0) {
+            printf("Failed to read the history of %s\n", source->path);
+            return 1;
+        }
+        if (restore) {
+            if (restore > count) {
+                printf("%s has %d former password(s)\n", entry->name, count);
+                free_history_items(items, count);
+                return 1;
+            }
+            char *replaced = entry->password;
+            entry->password = secure_strdup(items[restore - 1].password);
+            free_history_items(items, count);
+            if (!entry->password) {
+                entry->password = replaced;
+                return 1;
+            }
+            stamp_password_change(entry, NULL);
+            // The restored password can be undone like any other change
+            struct password_history *history = open_password_history(source->path, source->vault_key);
+            if (!record_password_change(history, entry, replaced) || !close_password_history(history))
+                printf("Failed to record the replaced password in the history\n");
+            secure_free(replaced);
+            *modified = true;
+            printf("Password of %s restored.\n", entry->name);
+            return 0;
+        }
+        printf("%s (%s): %d former password(s)\n", entry->name, entry->username, count);
+        for (int j = 0; j < count; j++) {
+            char replaced[32] = "";
+            const time_t time = (time_t) items[j].replaced;
+            const struct tm *local = localtime(&time);
+            if (local)
+                strftime(replaced, sizeof(replaced), "%Y-%m-%d %H:%M", local);
+            printf("%4d  %-16s  %s\n", j + 1, replaced, items[j].password);
+        }
+        free_history_items(items, count);
+    }
+    return 0;
+}
+
+
+/*
+ * Run the attach command, storing a file in the attachment file of the vault and referencing it
+ * from the one entry whose name matches a pattern. The file is streamed, it is never read as a whole
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+static int run_attach(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password **passwords,
+    const int num_passwords,
+    bool *modified) {
+    const char *pattern = NULL;
+    const char *file_path = NULL;
+    const char *label = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (!pattern) {
+            pattern = argv[i];
+        } else if (!file_path) {
+            file_path = argv[i];
+        } else {
+            printf("Unknown option for attach: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!file_path) {
+        printf("attach needs a name PATTERN and a FILE\n");
+        return 2;
+    }
+    struct password *entry = NULL;
+    int num_matches = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] && pattern_matches(pattern, passwords[i]->name)) {
+            entry = passwords[i];
+            num_matches++;
+        }
+    }
+    if (num_matches != 1) {
+        printf("%d entries match %s, attach needs exactly one\n", num_matches, pattern);
+        return num_matches == 0 ? 1 : 2;
+    }
+    if (!label) {
+        // Label the attachment with the file name without its directories
+        label = file_path;
+        for (const char *c = file_path; *c; c++) {
+            if (*c == '/' || *c == '\\')
+                label = c + 1;
+        }
+    }
+
+    FILE *input = fopen(file_path, "rb");
+    if (!input) {
+        printf("Failed to open %s\n", file_path);
+        return 1;
+    }
+    uint64_t id = 0, size = 0;
+    const bool stored = store_attachment(source->path, source->vault_key, input, &id, &size);
+    fclose(input);
+    if (!stored) {
+        printf("Failed to store %s in the attachment file of %s\n", file_path, source->path);
+        return 1;
+    }
+    if (!add_attachment_reference(entry, id, size, label))
+        return 1;
+    *modified = true;
+    printf("Attached %s to %s as %016" PRIx64 " (%" PRIu64 " bytes).\n", file_path, entry->name, id, size);
+    return 0;
+}
+
+
+/*
+ * Run the attachments command, listing the attachments of the entries whose name matches a pattern.
+ * Only the references in the vault are read, not the attachment file
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return int: Exit code of the command
+ */
+static int run_attachments(const int argc, char *argv[], struct password **passwords, const int num_passwords) {
+    if (argc > 2) {
+        printf("Unknown option for attachments: %s\n", argv[2]);
+        return 2;
+    }
+    const char *pattern = argc > 1 ? argv[1] : "*";
+    int count = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        const struct password *entry = passwords[i];
+        if (!entry || !entry->attachments || !pattern_matches(pattern, entry->name))
+            continue;
+        const char *cursor = entry->attachments;
+        struct attachment_reference reference;
+        while (next_attachment_reference(&cursor, &reference)) {
+            printf("%s\t%016" PRIx64 "\t%" PRIu64 "\t%.*s\n", entry->name, reference.id, reference.size,
+                (int) reference.label_length, reference.label);
+            total += reference.size;
+            count++;
+        }
+    }
+    printf("%d attachment(s), %" PRIu64 " bytes.\n", count, total);
+    return 0;
+}
+
+
+/*
+ * Run the extract command, decrypting an attachment into a new file, or the detach command,
+ * removing the references to an attachment
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+static int run_extract(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password **passwords,
+    const int num_passwords,
+    bool *modified) {
+    const bool extract = strcmp(argv[0], "extract") == 0;
+    if (argc != (extract ? 3 : 2)) {
+        printf(extract ? "extract needs an attachment ID and a FILE\n" : "detach needs an attachment ID\n");
+        return 2;
+    }
+    char *end = NULL;
+    const uint64_t id = strtoull(argv[1], &end, 16);
+    if (*argv[1] == '\0' || *end != '\0' || id == 0) {
+        printf("Invalid attachment ID: %s\n", argv[1]);
+        return 2;
+    }
+    struct attachment_reference reference;
+    int num_references = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (!passwords[i] || !find_attachment_reference(passwords[i], id, &reference))
+            continue;
+        num_references++;
+        if (extract)
+            break;
+        if (!remove_attachment_reference(passwords[i], id))
+            return 1;
+        *modified = true;
+        printf("Detached %s from %s.\n", argv[1], passwords[i]->name);
+    }
+    if (num_references == 0) {
+        printf("No entry references the attachment %s\n", argv[1]);
+        return 1;
+    }
+    if (!extract)
+        return 0;
+
+    // Never overwrite an existing file with a secret
+    FILE *output = fopen(argv[2], "wbx");
+    if (!output) {
+        printf("Failed to create %s, it must not exist yet\n", argv[2]);
+        return 1;
+    }
+    const bool extracted = extract_attachment(source->path, source->vault_key, id, reference.size,
+        fileno(output));
+    const bool closed = fclose(output) == 0;
+    if (!extracted || !closed) {
+        remove(argv[2]);
+        printf("Failed to extract the attachment %s, it is missing or damaged\n", argv[1]);
+        return 1;
+    }
+    printf("Extracted %.*s (%" PRIu64 " bytes) to %s.\n", (int) reference.label_length, reference.label,
+        reference.size, argv[2]);
+    return 0;
+}
+
+
+/*
+ * Run the expiry command, listing the passwords due for rotation within a number of days.
+ * The due dates are indexed in a heap once, listing K of them then takes O(K log K)
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param const struct password_requirement* requirement: The requirement holding the maximum ages
+ * return int: Exit code of the command
+ */
+static int run_expiry(
+    const int argc,
+    char *argv[],
+    struct password **passwords,
+    const int num_passwords,
+    const struct password_requirement *requirement) {
+    int within = DEFAULT_EXPIRY_WINDOW_DAYS;
+    int top = num_passwords;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--within") == 0 && i + 1 < argc) {
+            within = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for expiry: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (within < 0 || top < 1) {
+        printf("--within needs at least 0 days and --top at least 1 entry\n");
+        return 2;
+    }
+
+    struct timespec started;
+    timespec_get(&started, TIME_UTC);
+    struct expiry_index index;
+    if (!build_expiry_index(&index, requirement, passwords, num_passwords)) {
+        printf("Failed to index the vault\n");
+        return 1;
+    }
+    const double build_ms = elapsed_ms(&started);
+    const long long now = (long long) time(NULL);
+    if (top > index.count)
+        top = index.count;
+    struct expiry_item *items = malloc(((size_t) top + 1) * sizeof(struct expiry_item));
+    timespec_get(&started, TIME_UTC);
+    const int count = items ? next_expiring_passwords(&index, now + (long long) within * SECONDS_PER_DAY, top, items) : -1;
+    const double query_ms = elapsed_ms(&started);
+    if (count < 0) {
+        free(items);
+        free_expiry_index(&index);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        const struct password *entry = items[i].entry;
+        // Passwords of unknown age are due since 1970, their date says nothing
+        char due[32] = "unknown";
+        char days[24] = "";
+        const time_t time = (time_t) items[i].due;
+        const struct tm *local = localtime(&time);
+        if (entry->changed != 0 && local) {
+            strftime(due, sizeof(due), "%Y-%m-%d", local);
+            // Days left, rounded up, or days overdue
+            const long long left = items[i].due - now;
+            snprintf(days, sizeof(days), "%+lld", left >= 0 ? (left + SECONDS_PER_DAY - 1) / SECONDS_PER_DAY :
+                left / SECONDS_PER_DAY);
+        }
+        struct password_rules rules;
+        get_password_rules(requirement, entry, &rules);
+        printf("%-10s  %6s  %s\t%s\t%s\n", due, days, entry->name, entry->username,
+            rules.policy ? rules.policy : "-");
+    }
+    printf("%d of %d indexed password(s) due within %d days (index built in %.3f ms, query took %.3f ms).\n",
+        count, index.count, within, build_ms, query_ms);
+    free(items);
+    free_expiry_index(&index);
+    return 0;
+}
+
+
+/*
+ * Run the unlock command, caching the key of the loaded vault for the following commands
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * return int: Exit code of the command
+ */
+static int run_unlock(const int argc, char *argv[], const struct vault_source *source) {
+    int timeout = session_timeout();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeout = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for unlock: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (timeout < 1) {
+        printf("--timeout needs at least 1 second\n");
+        return 2;
+    }
+    if (!has_session_cache()) {
+        printf("Keys cannot be cached on this platform\n");
+        return 1;
+    }
+    if (!store_session_key(source->path, source->vault_key, timeout)) {
+        printf("Failed to cache the key of %s\n", source->path);
+        return 1;
+    }
+    printf("%s stays unlocked for %d seconds, lock it with the lock command\n", source->path, timeout);
+    return 0;
+}
+
+
+/*
+ * Decrypt and parse a vault file once for bench-unlock
+ *
+ * return bool: false if the vault could not be decrypted
+ */
+static bool unlock_once(const char *vault_path, const struct vault_key *vault_key) {
+    char *cleartext = NULL;
+    if (!decrypt_file(vault_path, &cleartext, vault_key, NULL))
+        return false;
+    int num_loaded = 0;
+    free_password_requirement(read_password_requirement(cleartext));
+    struct password **loaded = read_passwords(cleartext, &num_loaded);
+    secure_free(cleartext);
+    free_passwords(loaded, num_loaded);
+    free(loaded);
+    return true;
+}
+
+
+/*
+ * Run the bench-unlock command. Unlocks the vault file cold, deriving the key from a master password,
+ * and warm, reading the key cached by the unlock command from the keyring. The master password is not
+ * kept after the unlock, so the derivation is timed on a stand-in, which costs the same. The password
+ * prompt a cold unlock also waits for is not measured
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * return int: Exit code of the command
+ */
+static int run_bench_unlock(const int argc, char *argv[], const struct vault_source *source) {
+    int rounds = BENCH_UNLOCK_ROUNDS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else {
+            printf("Unknown option for bench-unlock: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (rounds < 1) {
+        printf("--rounds needs at least 1 round\n");
+        return 2;
+    }
+    if (!has_session_cache()) {
+        printf("Keys cannot be cached on this platform\n");
+        return 1;
+    }
+    // A vault that is not unlocked is only unlocked for the benchmark
+    struct vault_key *cached = load_session_key(source->path);
+    const bool was_unlocked = cached != NULL;
+    secure_free(cached);
+    if (!was_unlocked && !store_session_key(source->path, source->vault_key, BENCH_UNLOCK_TIMEOUT)) {
+        printf("Failed to cache the key of %s\n", source->path);
+        return 1;
+    }
+
+    bool ok = true;
+    double best_derive = 0, best_cold = 0, best_warm = 0;
+    for (int round = 0; ok && round < rounds; round++) {
+        struct timespec started;
+        struct vault_key stand_in;
+        timespec_get(&started, TIME_UTC);
+        ok = derive_vault_key(BENCH_UNLOCK_PASSWORD, &stand_in);
+        const double derive = elapsed_ms(&started);
+        ok = ok && unlock_once(source->path, source->vault_key);
+        const double cold = elapsed_ms(&started);
+        OPENSSL_cleanse(&stand_in, sizeof(stand_in));
+
+        timespec_get(&started, TIME_UTC);
+        struct vault_key *cached_key = load_session_key(source->path);
+        ok = ok && cached_key && unlock_once(source->path, cached_key);
+        secure_free(cached_key);
+        const double warm = elapsed_ms(&started);
+        if (round == 0 || derive < best_derive)
+            best_derive = derive;
+        if (round == 0 || cold < best_cold)
+            best_cold = cold;
+        if (round == 0 || warm < best_warm)
+            best_warm = warm;
+    }
+    if (!was_unlocked)
+        forget_session_key(source->path);
+    if (!ok) {
+        printf("Failed to unlock the vault\n");
+        return 1;
+    }
+    printf("Fastest of %d round(s) on %s:\n", rounds, source->path);
+    printf("  Key derivation %10.3f ms\n", best_derive);
+    printf("  Cold unlock    %10.3f ms (key derivation, decrypt, parse; plus the password prompt)\n", best_cold);
+    printf("  Warm unlock    %10.3f ms (keyring, decrypt, parse)\n", best_warm);
+    return 0;
+}
+
+
+/*
+ * Run a non-interactive command on the loaded vault.
+ * The caller saves and encrypts the vault once afterwards if it has been modified
+ * and then finishes the command with finish_command.
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * param bool* modified: Set to true if the vault has to be saved
+ * param struct command_output* output: Receives output the caller writes with finish_command after saving
+ * return int: Exit code of the command
+ */
+int run_command(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *requirement,
+    bool *modified,
+    struct command_output *output) {
+    if (strcmp(argv[0], "rotate") == 0)
+        return run_rotate(argc, argv, source, *passwords, *num_passwords, requirement, modified, output);
+    if (strcmp(argv[0], "import") == 0 || strcmp(argv[0], "export") == 0)
+        return run_transfer(argc, argv, passwords, num_passwords, modified);
+    if (strcmp(argv[0], "breach-check") == 0)
+        return run_breach_check(argc, argv, *passwords, *num_passwords);
+    if (strcmp(argv[0], "audit") == 0)
+        return run_audit(argc, argv, *passwords, *num_passwords, requirement);
+    if (strcmp(argv[0], "strength") == 0)
+        return run_strength(argc, argv, *passwords, *num_passwords, requirement);
+    if (strcmp(argv[0], "sync") == 0 || strcmp(argv[0], "sync-serve") == 0)
+        return run_sync(argc, argv, source, passwords, num_passwords, modified);
+    if (strcmp(argv[0], "backup") == 0)
+        return run_backup(argc, argv, source, passwords, num_passwords, requirement, modified);
+    if (strcmp(argv[0], "list") == 0)
+        return run_list(argc, argv, *passwords, *num_passwords);
+    if (strcmp(argv[0], "tag") == 0)
+        return run_tag(argc, argv, *passwords, *num_passwords, modified);
+    if (strcmp(argv[0], "policy") == 0)
+        return run_policy(argc, argv, *passwords, *num_passwords, requirement, modified);
+    if (strcmp(argv[0], "bench-codecs") == 0)
+        return run_bench_codecs(source, *passwords, *num_passwords, requirement);
+    if (strcmp(argv[0], "bench-parse") == 0)
+        return run_bench_parse(argc, argv, *passwords, *num_passwords, requirement);
+    if (strcmp(argv[0], "recent") == 0)
+        return run_recent(argc, argv, *passwords, *num_passwords);
+    if (strcmp(argv[0], "history") == 0)
+        return run_history(argc, argv, source, *passwords, *num_passwords, modified);
+    if (strcmp(argv[0], "attach") == 0)
+        return run_attach(argc, argv, source, *passwords, *num_passwords, modified);
+    if (strcmp(argv[0], "attachments") == 0)
+        return run_attachments(argc, argv, *passwords, *num_passwords);
+    if (strcmp(argv[0], "extract") == 0 || strcmp(argv[0], "detach") == 0)
+        return run_extract(argc, argv, source, *passwords, *num_passwords, modified);
+    if (strcmp(argv[0], "expiry") == 0)
+        return run_expiry(argc, argv, *passwords, *num_passwords, requirement);
+    if (strcmp(argv[0], "unlock") == 0)
+        return run_unlock(argc, argv, source);
+    if (strcmp(argv[0], "bench-unlock") == 0)
+        return run_bench_unlock(argc, argv, source);
+    return 2;
+}
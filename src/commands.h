@@ -0,0 +1,74 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "crypto.h"
+#include "password.h"
+#include "rotation.h"
+
+// The unlocked vault file the loaded entries come from
+struct vault_source {
+    const char *path;
+    const struct vault_key *vault_key;
+    uint64_t version;
+};
+
+// Output of a command that is only written once its changes are saved, see finish_command
+struct command_output {
+    FILE *report;                    // Stream of the rotation report, NULL if nothing is pending
+    const char *report_file;         // Path of the report, NULL if it goes to stdout
+    struct rotation_report rotation; // The rotated credentials
+};
+
+bool is_known_command(const char *command);
+bool command_needs_vault(int argc, char *argv[]);
+int run_standalone_command(int argc, char *argv[], const char *vault_path);
+void print_usage(const char *program);
+int run_command(
+    int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *requirement,
+    bool *modified,
+    struct command_output *output);
+bool finish_command(struct command_output *output, bool saved);
+
+// Handlers of the feature commands, each one lives in a FEATURE_command.c file next to its module
+int run_rotate(
+    int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password **passwords,
+    int num_passwords,
+    const struct password_requirement *requirement,
+    bool *modified,
+    struct command_output *output);
+int run_transfer(int argc, char *argv[], struct password ***passwords, int *num_passwords, bool *modified);
+int run_sync(
+    int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password ***passwords,
+    int *num_passwords,
+    bool *modified);
+int run_backup_store_command(int argc, char *argv[], const char *vault_path);
+int run_backup(
+    int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *requirement,
+    bool *modified);
+int run_policy(
+    int argc,
+    char *argv[],
+    struct password **passwords,
+    int num_passwords,
+    struct password_requirement *requirement,
+    bool *modified);
+
+#endif //COMMANDS_H
@@ -0,0 +1,370 @@
+#include "cpass.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crypto.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "util.h"
+#include "vault_store.h"
+
+#define INDEX_EMPTY (-1)
+#define INDEX_DELETED (-2)
+#define MIN_INDEX_CAPACITY 64
+
+struct cpass_vault {
+    char *path;
+    struct vault_key *vault_key;    // Kept on the secure heap for commits, the password is not kept
+    struct password **passwords;
+    int num_passwords;              // Size of the array including tombstones
+    int num_live;                   // Entries that are not tombstones
+    struct password_requirement *requirement;
+    int *index;                     // Open addressing map from name to array slot
+    size_t index_capacity;          // Power of two
+    size_t index_used;              // Occupied and deleted positions
+    bool has_duplicate_names;       // Vaults written by older versions may repeat names
+    struct vault_base base;         // Vault file state the handle is based on
+};
+
+
+/*
+ * Find the index position holding the entry with the given name
+ *
+ * param const cpass_vault* vault: The vault
+ * param const char* name: The name
+ * return size_t: The position, index_capacity if there is no such entry
+ */
+static size_t find_position(const cpass_vault *vault, const char *name) {
+    const size_t mask = vault->index_capacity - 1;
+    for (size_t position = hash_text(HASH_SEED, name) & mask; ; position = (position + 1) & mask) {
+        const int slot = vault->index[position];
+        if (slot == INDEX_EMPTY)
+            return vault->index_capacity;
+        if (slot >= 0 && strcmp(vault->passwords[slot]->name, name) == 0)
+            return position;
+    }
+}
+
+
+/*
+ * Add an array slot to the index, unless its name is already indexed
+ *
+ * param cpass_vault* vault: The vault, the index must have a free position
+ * param int slot: The array slot
+ */
+static void index_slot(cpass_vault *vault, const int slot) {
+    const char *name = vault->passwords[slot]->name;
+    if (find_position(vault, name) != vault->index_capacity) {
+        vault->has_duplicate_names = true;
+        return;
+    }
+    const size_t mask = vault->index_capacity - 1;
+    size_t position = hash_text(HASH_SEED, name) & mask;
+    while (vault->index[position] >= 0)
+        position = (position + 1) & mask;
+    if (vault->index[position] == INDEX_EMPTY)
+        vault->index_used++;
+    vault->index[position] = slot;
+}
+
+
+/*
+ * Rebuild the index for all live entries with room for the given number of additional entries.
+ * Keeps the load factor at or below one half
+ *
+ * param cpass_vault* vault: The vault
+ * param int additional: Number of entries that will be added
+ * param bool compact: Drop the tombstones from the array first, only once the new index is allocated
+ * return bool: false if memory ran out, the old index and the array are kept then
+ */
+static bool rebuild_index(cpass_vault *vault, const int additional, const bool compact) {
+    size_t capacity = MIN_INDEX_CAPACITY;
+    while (capacity < 2 * ((size_t) vault->num_live + additional))
+        capacity *= 2;
+    int *index = malloc(capacity * sizeof(int));
+    if (!index)
+        return false;
+    if (compact)
+        compact_passwords(vault->passwords, &vault->num_passwords);
+    memset(index, 0xff, capacity * sizeof(int)); // INDEX_EMPTY
+    free(vault->index);
+    vault->index = index;
+    vault->index_capacity = capacity;
+    vault->index_used = 0;
+    vault->has_duplicate_names = false;
+    for (int slot = 0; slot < vault->num_passwords; slot++) {
+        if (vault->passwords[slot] != NULL)
+            index_slot(vault, slot);
+    }
+    return true;
+}
+
+
+/*
+ * Open and decrypt a vault file. The whole vault is kept in memory afterwards
+ *
+ * param const char* path: Path of the vault file
+ * param const char* master_password: The master password
+ * param int flags: CPASS_OPEN_CREATE or 0
+ * param cpass_vault** vault: Receives the handle that has to be released with cpass_close
+ * return int: CPASS_OK or an error status
+ */
+int cpass_open(const char *path, const char *master_password, const int flags, cpass_vault **vault) {
+    if (!path || !master_password || !vault)
+        return CPASS_ERROR_INVALID;
+    *vault = NULL;
+    const bool exists = file_exists(path);
+    if (!exists && !(flags & CPASS_OPEN_CREATE))
+        return CPASS_ERROR_NOT_FOUND;
+
+    cpass_vault *opened = calloc(1, sizeof(cpass_vault));
+    if (!opened)
+        return CPASS_ERROR_NO_MEMORY;
+    opened->path = strdup(path);
+    opened->vault_key = secure_malloc(sizeof(struct vault_key));
+    if (!opened->path || !opened->vault_key) {
+        cpass_close(opened);
+        return CPASS_ERROR_NO_MEMORY;
+    }
+    if (!derive_vault_key(master_password, opened->vault_key)) {
+        cpass_close(opened);
+        return CPASS_ERROR_DECRYPT;
+    }
+
+    char *cleartext = NULL;
+    uint64_t version = 0;
+    if (exists && !decrypt_file(path, &cleartext, opened->vault_key, &version)) {
+        cpass_close(opened);
+        return CPASS_ERROR_DECRYPT;
+    }
+    opened->requirement = read_password_requirement(cleartext);
+    opened->passwords = read_passwords(cleartext, &opened->num_passwords);
+    secure_free(cleartext);
+    opened->num_live = opened->num_passwords;
+    if (!opened->requirement || !opened->passwords || !rebuild_index(opened, 0, false) ||
+        !record_vault_base(&opened->base, version, opened->requirement, opened->passwords, opened->num_passwords)) {
+        cpass_close(opened);
+        return CPASS_ERROR_NO_MEMORY;
+    }
+    *vault = opened;
+    return CPASS_OK;
+}
+
+
+/*
+ * Close a vault without saving, wiping all cleartext it holds
+ *
+ * param cpass_vault* vault: The vault, may be NULL
+ */
+void cpass_close(cpass_vault *vault) {
+    if (!vault)
+        return;
+    free_passwords(vault->passwords, vault->num_passwords);
+    free(vault->passwords);
+    free_password_requirement(vault->requirement);
+    free(vault->index);
+    free_vault_base(&vault->base);
+    secure_free(vault->vault_key);
+    free(vault->path);
+    free(vault);
+}
+
+
+/*
+ * Look up an entry by name
+ *
+ * param const cpass_vault* vault: The vault
+ * param const char* name: The name of the entry
+ * param struct cpass_entry* entry: Receives the entry
+ * return int: CPASS_OK or CPASS_ERROR_NOT_FOUND
+ */
+int cpass_get(const cpass_vault *vault, const char *name, struct cpass_entry *entry) {
+    if (!vault || !name || !entry)
+        return CPASS_ERROR_INVALID;
+    const size_t position = find_position(vault, name);
+    if (position == vault->index_capacity)
+        return CPASS_ERROR_NOT_FOUND;
+    const struct password *found = vault->passwords[vault->index[position]];
+    entry->name = found->name;
+    entry->username = found->username;
+    entry->password = found->password;
+    return CPASS_OK;
+}
+
+
+/*
+ * Count the entries of the vault
+ *
+ * param const cpass_vault* vault: The vault
+ * return int: Number of entries
+ */
+int cpass_count(const cpass_vault *vault) {
+    return vault ? vault->num_live : 0;
+}
+
+
+/*
+ * Call a function for every entry of the vault in storage order.
+ * The vault must not be changed from within the visitor
+ *
+ * param const cpass_vault* vault: The vault
+ * param cpass_visitor visitor: Called once per entry
+ * param void* context: Passed to the visitor
+ * return int: CPASS_OK, or the first value other than 0 returned by the visitor
+ */
+int cpass_foreach(const cpass_vault *vault, const cpass_visitor visitor, void *context) {
+    if (!vault || !visitor)
+        return CPASS_ERROR_INVALID;
+    for (int slot = 0; slot < vault->num_passwords; slot++) {
+        const struct password *current = vault->passwords[slot];
+        if (current == NULL)
+            continue;
+        const struct cpass_entry entry = {current->name, current->username, current->password};
+        const int result = visitor(&entry, context);
+        if (result != 0)
+            return result;
+    }
+    return CPASS_OK;
+}
+
+
+/*
+ * Add a new entry. Nothing is written before cpass_commit
+ *
+ * param cpass_vault* vault: The vault
+ * param const char* name: The unique name of the entry
+ * param const char* username: The username
+ * param const char* password: The password
+ * return int: CPASS_OK, CPASS_ERROR_EXISTS or an error status
+ */
+int cpass_add(cpass_vault *vault, const char *name, const char *username, const char *password) {
+    if (!vault || !name || !username || !password)
+        return CPASS_ERROR_INVALID;
+    if (find_position(vault, name) != vault->index_capacity)
+        return CPASS_ERROR_EXISTS;
+    if (2 * (vault->index_used + 1) > vault->index_capacity && !rebuild_index(vault, 1, false))
+        return CPASS_ERROR_NO_MEMORY;
+    if (!add_password(&vault->passwords, &vault->num_passwords, name, username, password, NULL))
+        return CPASS_ERROR_NO_MEMORY;
+    vault->num_live++;
+    index_slot(vault, vault->num_passwords - 1);
+    return CPASS_OK;
+}
+
+
+/*
+ * Change the username and/or password of an entry. Nothing is written before cpass_commit
+ *
+ * param cpass_vault* vault: The vault
+ * param const char* name: The name of the entry
+ * param const char* username: The new username, NULL to keep the current one
+ * param const char* password: The new password, NULL to keep the current one
+ * return int: CPASS_OK, CPASS_ERROR_NOT_FOUND or an error status
+ */
+int cpass_update(cpass_vault *vault, const char *name, const char *username, const char *password) {
+    if (!vault || !name)
+        return CPASS_ERROR_INVALID;
+    const size_t position = find_position(vault, name);
+    if (position == vault->index_capacity)
+        return CPASS_ERROR_NOT_FOUND;
+    struct password *entry = vault->passwords[vault->index[position]];
+    char *new_username = username ? secure_strdup(username) : NULL;
+    char *new_password = password ? secure_strdup(password) : NULL;
+    if ((username && !new_username) || (password && !new_password)) {
+        secure_free(new_username);
+        secure_free(new_password);
+        return CPASS_ERROR_NO_MEMORY;
+    }
+    if (new_username) {
+        secure_free(entry->username);
+        entry->username = new_username;
+    }
+    if (new_password) {
+        secure_free(entry->password);
+        entry->password = new_password;
+        stamp_password_change(entry, NULL);
+    }
+    return CPASS_OK;
+}
+
+
+/*
+ * Delete an entry. Nothing is written before cpass_commit
+ *
+ * param cpass_vault* vault: The vault
+ * param const char* name: The name of the entry
+ * return int: CPASS_OK, CPASS_ERROR_NOT_FOUND or an error status
+ */
+int cpass_delete(cpass_vault *vault, const char *name) {
+    if (!vault || !name)
+        return CPASS_ERROR_INVALID;
+    const size_t position = find_position(vault, name);
+    if (position == vault->index_capacity)
+        return CPASS_ERROR_NOT_FOUND;
+    const int slot = vault->index[position];
+    // The name may be the one cpass_get returned for this entry, which is freed with it,
+    // so the entry of the same name taking over is looked up before
+    int successor = -1;
+    for (int other = 0; vault->has_duplicate_names && other < vault->num_passwords; other++) {
+        if (other != slot && vault->passwords[other] != NULL && strcmp(vault->passwords[other]->name, name) == 0) {
+            successor = other;
+            break;
+        }
+    }
+    delete_password(&vault->passwords, slot, NULL);
+    vault->index[position] = INDEX_DELETED;
+    vault->num_live--;
+
+    // Compaction moves the entries, so the index is rebuilt with it. Without memory for a new index
+    // the tombstones stay until a later delete
+    const bool compact = (vault->num_passwords - vault->num_live) * COMPACTION_RATIO >= vault->num_passwords;
+    if ((!compact || !rebuild_index(vault, 0, true)) && successor >= 0)
+        index_slot(vault, successor);
+    return CPASS_OK;
+}
+
+
+/*
+ * Encrypt the vault and write it to its file. Changes other processes committed since the vault was
+ * opened or last committed are merged first, unless they touch the same entries. The file is replaced
+ * atomically, so a failed commit leaves the previous version intact
+ *
+ * param cpass_vault* vault: The vault
+ * return int: CPASS_OK, CPASS_ERROR_CONFLICT or CPASS_ERROR_IO
+ */
+int cpass_commit(cpass_vault *vault) {
+    if (!vault)
+        return CPASS_ERROR_INVALID;
+    const enum commit_status status = commit_vault(vault->path, vault->vault_key, &vault->base,
+        vault->requirement, &vault->passwords, &vault->num_passwords, NULL);
+    if (status == COMMIT_CONFLICT)
+        return CPASS_ERROR_CONFLICT;
+    // A merge may have added or removed entries
+    vault->num_live = count_live_passwords(vault->passwords, vault->num_passwords);
+    if (!rebuild_index(vault, 0, false))
+        return CPASS_ERROR_NO_MEMORY;
+    return status == COMMIT_OK ? CPASS_OK : CPASS_ERROR_IO;
+}
+
+
+/*
+ * Describe a status returned by the library
+ *
+ * param int status: The status
+ * return const char*: Static description of the status
+ */
+const char *cpass_strerror(const int status) {
+    switch (status) {
+        case CPASS_OK: return "Success";
+        case CPASS_ERROR_INVALID: return "Invalid argument";
+        case CPASS_ERROR_NOT_FOUND: return "Not found";
+        case CPASS_ERROR_EXISTS: return "An entry with this name already exists";
+        case CPASS_ERROR_DECRYPT: return "Wrong master password or damaged vault";
+        case CPASS_ERROR_IO: return "Failed to write the vault file";
+        case CPASS_ERROR_NO_MEMORY: return "Out of memory";
+        case CPASS_ERROR_CONFLICT: return "Another process changed the same entries";
+        default: return "Unknown error";
+    }
+}
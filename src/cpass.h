@@ -0,0 +1,57 @@
+#ifndef CPASS_H
+#define CPASS_H
+
+/*
+ * libcpass: embeddable access to a C-Pass vault.
+ * A process unlocks the vault once and then serves lookups from memory. The library never
+ * reads from stdin, writes to stdout or exits the process, every failure is returned as status.
+ * A handle must not be used by several threads at the same time. Several handles and processes may
+ * open the same vault, commits merge their changes as long as they do not touch the same entries.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum cpass_status {
+    CPASS_OK = 0,
+    CPASS_ERROR_INVALID,   // Invalid argument, e.g. a NULL name
+    CPASS_ERROR_NOT_FOUND, // No entry with this name, or no vault file without CPASS_OPEN_CREATE
+    CPASS_ERROR_EXISTS,    // An entry with this name already exists
+    CPASS_ERROR_DECRYPT,   // Wrong master password or damaged vault file
+    CPASS_ERROR_IO,        // The vault file could not be written
+    CPASS_ERROR_NO_MEMORY,
+    CPASS_ERROR_CONFLICT   // Another process committed changes to the same entries, nothing was written
+};
+
+// Flags of cpass_open
+#define CPASS_OPEN_CREATE 1 // Start with an empty vault if the file does not exist yet
+
+typedef struct cpass_vault cpass_vault;
+
+// The strings stay valid until the entry is changed or deleted or the vault is closed
+struct cpass_entry {
+    const char *name;
+    const char *username;
+    const char *password;
+};
+
+// Return a value other than 0 to stop the iteration, cpass_foreach passes it on
+typedef int (*cpass_visitor)(const struct cpass_entry *entry, void *context);
+
+int cpass_open(const char *path, const char *master_password, int flags, cpass_vault **vault);
+void cpass_close(cpass_vault *vault);
+int cpass_get(const cpass_vault *vault, const char *name, struct cpass_entry *entry);
+int cpass_count(const cpass_vault *vault);
+int cpass_foreach(const cpass_vault *vault, cpass_visitor visitor, void *context);
+int cpass_add(cpass_vault *vault, const char *name, const char *username, const char *password);
+int cpass_update(cpass_vault *vault, const char *name, const char *username, const char *password);
+int cpass_delete(cpass_vault *vault, const char *name);
+int cpass_commit(cpass_vault *vault);
+const char *cpass_strerror(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CPASS_H
@@ -2,12 +2,48 @@
 #include <openssl/applink.c>
 #endif
 #include <openssl/evp.h>
+#include <openssl/crypto.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "crypto.h"
+#include "secure_heap.h"
+#include <zlib.h>
 
-#define AES_256_KEY_SIZE 32
-#define AES_BLOCK_SIZE 16
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#define AES_256_KEY_SIZE VAULT_KEY_SIZE
+#define AES_BLOCK_SIZE VAULT_IV_SIZE
+// Nonce and tag of the authenticated suites, the nonce follows the header and the tag ends the file
+#define AEAD_NONCE_SIZE 12
+#define AEAD_TAG_SIZE 16
+// Position of the cipher suite in the header, followed by the codec (high nibble) and its level (low nibble)
+#define HEADER_SUITE_OFFSET (VAULT_MAGIC_SIZE + 1)
+#define HEADER_CODEC_OFFSET (VAULT_MAGIC_SIZE + 2)
+// Cleartext bytes handled per step while encrypting and decrypting
+#define STREAM_CHUNK_SIZE (AES_BLOCK_SIZE * 1024)
+
+struct cipher_suite_info {
+    const char *name;
+    const EVP_CIPHER *(*cipher)(void);
+    bool authenticated;
+};
+
+static const struct cipher_suite_info cipher_suites[CIPHER_SUITE_COUNT] = {
+    [CIPHER_AES_256_CBC] = {"aes-256-cbc", EVP_aes_256_cbc, false},
+    [CIPHER_AES_256_GCM] = {"aes-256-gcm", EVP_aes_256_gcm, true},
+    [CIPHER_CHACHA20_POLY1305] = {"chacha20-poly1305", EVP_chacha20_poly1305, true},
+};
 
 /*
  * Derive key and IV from password
@@ -23,179 +59,636 @@ bool derive_key_and_iv(const unsigned char *password, unsigned char *key, unsign
 
     // Using EVP_BytesToKey to derive the key and IV
     if (!EVP_BytesToKey(EVP_aes_256_cbc(), EVP_sha256(), salt, password, strlen((const char *)password), nrounds, key, iv)) {
-        fprintf(stderr, "Key derivation failed\n");
         return 0;
     }
     return 1;
 }
 
 /*
- * Encrypt data from input file to output file using AES-256-CBC
+ * Derive the vault key from a master password. The keys of the files next to the vault are derived
+ * from the vault key in turn, so the master password can be wiped as soon as the vault is unlocked
  *
- * param const char* encrypted_filename: Name of encrypted file
- * param const char** input: Pointer to the char array in which the cleartext contents are stored
- * param char* password: Master password to be used for encryption
- * return bool: Indication whether operation was successful
+ * param const char* password: Master password
+ * param struct vault_key* key: Receives the key, wipe it after use
+ * return bool: false if the key could not be derived
  */
-bool encrypt_file(const char *encrypted_filename, char **input, char *password) {
-    FILE *output_file = fopen(encrypted_filename, "wb");
+bool derive_vault_key(const char *password, struct vault_key *key) {
+    return derive_key_and_iv((const unsigned char *) password, key->key, key->iv);
+}
 
-    if (!output_file) {
-        fclose(output_file);
-        return false;
+
+/*
+ * Derive a key for one purpose from the vault key with HKDF-SHA256
+ *
+ * param const struct vault_key* key: The vault key
+ * param const char* purpose: Names what the key is used for, keys of different purposes are unrelated
+ * param const unsigned char* salt: Salt, e.g. stored in the header of the file the key encrypts, may be NULL
+ * param size_t salt_size: Size of the salt
+ * param unsigned char* subkey: Receives the key
+ * param size_t subkey_size: Size of the key
+ * return bool: false if the key could not be derived
+ */
+bool derive_subkey(
+    const struct vault_key *key,
+    const char *purpose,
+    const unsigned char *salt,
+    const size_t salt_size,
+    unsigned char *subkey,
+    const size_t subkey_size) {
+    unsigned char material[VAULT_KEY_SIZE + VAULT_IV_SIZE];
+    memcpy(material, key->key, VAULT_KEY_SIZE);
+    memcpy(material + VAULT_KEY_SIZE, key->iv, VAULT_IV_SIZE);
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+    size_t length = subkey_size;
+    const bool ok = ctx && EVP_PKEY_derive_init(ctx) > 0 &&
+        EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) > 0 &&
+        EVP_PKEY_CTX_set1_hkdf_key(ctx, material, (int) sizeof(material)) > 0 &&
+        (salt_size == 0 || EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt, (int) salt_size) > 0) &&
+        EVP_PKEY_CTX_add1_hkdf_info(ctx, (const unsigned char *) purpose, (int) strlen(purpose)) > 0 &&
+        EVP_PKEY_derive(ctx, subkey, &length) > 0 && length == subkey_size;
+    EVP_PKEY_CTX_free(ctx);
+    OPENSSL_cleanse(material, sizeof(material));
+    return ok;
+}
+
+
+/*
+ * Derive the key of a file in the vault format that is not the vault itself, e.g. the access file
+ *
+ * param const struct vault_key* key: The vault key
+ * param const char* purpose: Names the file
+ * param struct vault_key* file_key: Receives the key to pass to encrypt_file and decrypt_file
+ * return bool: false if the key could not be derived
+ */
+bool derive_file_key(const struct vault_key *key, const char *purpose, struct vault_key *file_key) {
+    unsigned char material[VAULT_KEY_SIZE + VAULT_IV_SIZE];
+    const bool ok = derive_subkey(key, purpose, NULL, 0, material, sizeof(material));
+    memcpy(file_key->key, material, VAULT_KEY_SIZE);
+    memcpy(file_key->iv, material + VAULT_KEY_SIZE, VAULT_IV_SIZE);
+    OPENSSL_cleanse(material, sizeof(material));
+    return ok;
+}
+
+
+/*
+ * Get the name of a cipher suite as accepted by parse_cipher_suite
+ *
+ * param enum cipher_suite suite: The cipher suite
+ * return const char*: The name, "unknown" for values that are no suite
+ */
+const char *cipher_suite_name(const enum cipher_suite suite) {
+    return suite >= 0 && suite < CIPHER_SUITE_COUNT ? cipher_suites[suite].name : "unknown";
+}
+
+
+/*
+ * Parse the name of a cipher suite
+ *
+ * param const char* name: The name, e.g. "aes-256-gcm"
+ * param enum cipher_suite* suite: Receives the cipher suite
+ * return bool: false if the name is unknown
+ */
+bool parse_cipher_suite(const char *name, enum cipher_suite *suite) {
+    for (int i = 0; i < CIPHER_SUITE_COUNT; i++) {
+        if (strcmp(name, cipher_suites[i].name) == 0) {
+            *suite = (enum cipher_suite) i;
+            return true;
+        }
     }
+    return false;
+}
 
-    unsigned char key[AES_256_KEY_SIZE], iv[AES_BLOCK_SIZE];
-    if (!derive_key_and_iv((const unsigned char*) password, key, iv)) {
-        fclose(output_file);
+
+/*
+ * Check whether the CPU has AES instructions. Without them AES runs as table lookups in software,
+ * which is both slower than ChaCha20 and open to cache timing attacks
+ *
+ * return bool: true if AES is accelerated in hardware
+ */
+bool has_aes_acceleration(void) {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0;
+#elif defined(__aarch64__) && defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#elif defined(__aarch64__) && defined(__APPLE__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/*
+ * Get the cipher suite new vault files are written with: the one named by C_PASS_CIPHER if set,
+ * otherwise AES-256-GCM on CPUs with AES instructions and ChaCha20-Poly1305 on all others
+ *
+ * return enum cipher_suite: The cipher suite
+ */
+enum cipher_suite preferred_cipher_suite(void) {
+    const char *name = getenv(CIPHER_ENVIRONMENT_VARIABLE);
+    enum cipher_suite suite;
+    if (name && *name && parse_cipher_suite(name, &suite))
+        return suite;
+    return has_aes_acceleration() ? CIPHER_AES_256_GCM : CIPHER_CHACHA20_POLY1305;
+}
+
+
+/*
+ * Parse a compression setting
+ *
+ * param const char* text: "none", "zlib" or "zlib:LEVEL" with a level from 1 to 9
+ * param enum vault_codec* codec: Receives the codec
+ * param int* level: Receives the level, 0 for no compression
+ * return bool: false if the setting is malformed
+ */
+bool parse_vault_codec(const char *text, enum vault_codec *codec, int *level) {
+    if (strcmp(text, "none") == 0) {
+        *codec = CODEC_NONE;
+        *level = 0;
+        return true;
+    }
+    if (strncmp(text, "zlib", 4) != 0)
+        return false;
+    *codec = CODEC_ZLIB;
+    *level = DEFAULT_ZLIB_LEVEL;
+    if (text[4] == '\0')
+        return true;
+    if (text[4] != ':' || text[5] < '1' || text[5] > '9' || text[6] != '\0')
         return false;
+    *level = text[5] - '0';
+    return true;
+}
+
+
+/*
+ * Get the encoding new vault files are written with, see preferred_cipher_suite and C_PASS_COMPRESSION
+ *
+ * return struct vault_encoding: The encoding
+ */
+struct vault_encoding preferred_vault_encoding(void) {
+    struct vault_encoding encoding = {preferred_cipher_suite(), CODEC_ZLIB, DEFAULT_ZLIB_LEVEL};
+    const char *codec = getenv(CODEC_ENVIRONMENT_VARIABLE);
+    if (codec && *codec && !parse_vault_codec(codec, &encoding.codec, &encoding.level)) {
+        encoding.codec = CODEC_ZLIB;
+        encoding.level = DEFAULT_ZLIB_LEVEL;
     }
+    return encoding;
+}
+
 
+/*
+ * Measure how fast a cipher suite encrypts on this host
+ *
+ * param enum cipher_suite suite: The cipher suite
+ * param size_t size: Bytes encrypted per round
+ * param int rounds: Number of rounds, the fastest one counts
+ * return double: Throughput in MiB per second, 0 on failure
+ */
+double benchmark_cipher_suite(const enum cipher_suite suite, const size_t size, const int rounds) {
+    unsigned char key[AES_256_KEY_SIZE], iv[AES_BLOCK_SIZE];
+    unsigned char *input = malloc(size);
+    unsigned char *output = malloc(size + AES_BLOCK_SIZE);
     EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx){
-        fclose(output_file);
-        return false;
+    bool ok = input && output && ctx && RAND_bytes(key, sizeof(key)) == 1 && RAND_bytes(iv, sizeof(iv)) == 1;
+    if (ok)
+        memset(input, 'x', size);
+    double best = 0;
+    for (int round = 0; ok && round < rounds; round++) {
+        struct timespec start, end;
+        int length = 0, final_length = 0;
+        timespec_get(&start, TIME_UTC);
+        ok = EVP_EncryptInit_ex(ctx, cipher_suites[suite].cipher(), NULL, key, iv) == 1 &&
+            EVP_EncryptUpdate(ctx, output, &length, input, (int) size) == 1 &&
+            EVP_EncryptFinal_ex(ctx, output + length, &final_length) == 1;
+        timespec_get(&end, TIME_UTC);
+        const double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (ok && seconds > 0 && size / seconds > best)
+            best = (double) size / seconds;
     }
+    EVP_CIPHER_CTX_free(ctx);
+    free(output);
+    free(input);
+    return ok ? best / (1024.0 * 1024.0) : 0;
+}
 
-    if (1 != EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key, iv)) {
-        fclose(output_file);
+
+/*
+ * Write the plaintext header of a vault file
+ *
+ * param unsigned char* header: Receives the header, VAULT_HEADER_SIZE bytes
+ * param const struct vault_encoding* encoding: The cipher suite and codec of the file
+ * param uint64_t version: The vault version, incremented by every commit
+ */
+static void format_header(unsigned char *header, const struct vault_encoding *encoding, const uint64_t version) {
+    memset(header, 0, VAULT_HEADER_SIZE);
+    memcpy(header, VAULT_MAGIC, VAULT_MAGIC_SIZE);
+    header[VAULT_MAGIC_SIZE] = VAULT_HEADER_FORMAT;
+    header[HEADER_SUITE_OFFSET] = (unsigned char) encoding->suite;
+    header[HEADER_CODEC_OFFSET] = (unsigned char) (encoding->codec << 4 | (encoding->level & 0x0F));
+    for (int i = 0; i < 8; i++)
+        header[8 + i] = (unsigned char) (version >> (8 * i));
+}
+
+
+/*
+ * Read the plaintext header of a vault file. Files without a header are left at their start
+ *
+ * param FILE* file: The vault file, positioned at its start
+ * param unsigned char* header: Receives the header, all zero for files without one
+ * param struct vault_encoding* encoding: Receives cipher suite and codec, AES-256-CBC without compression
+ *                                        for files without a header
+ * param uint64_t* version: Receives the vault version, 0 for files without a header
+ * return bool: false if the header names an unknown cipher suite or codec
+ */
+static bool read_header(FILE *file, unsigned char *header, struct vault_encoding *encoding, uint64_t *version) {
+    encoding->suite = CIPHER_AES_256_CBC;
+    encoding->codec = CODEC_NONE;
+    encoding->level = 0;
+    *version = 0;
+    if (fread(header, 1, VAULT_HEADER_SIZE, file) != VAULT_HEADER_SIZE ||
+        memcmp(header, VAULT_MAGIC, VAULT_MAGIC_SIZE) != 0 ||
+        (header[VAULT_MAGIC_SIZE] != VAULT_HEADER_FORMAT && header[VAULT_MAGIC_SIZE] != VAULT_HEADER_FORMAT_UNBOUND)) {
+        memset(header, 0, VAULT_HEADER_SIZE);
+        rewind(file);
+        return true;
+    }
+    for (int i = 0; i < 8; i++)
+        *version |= (uint64_t) header[8 + i] << (8 * i);
+    const int codec = header[HEADER_CODEC_OFFSET] >> 4;
+    if (header[HEADER_SUITE_OFFSET] >= CIPHER_SUITE_COUNT || codec > CODEC_ZLIB)
         return false;
+    encoding->suite = (enum cipher_suite) header[HEADER_SUITE_OFFSET];
+    encoding->codec = (enum vault_codec) codec;
+    encoding->level = header[HEADER_CODEC_OFFSET] & 0x0F;
+    return true;
+}
+
+
+/*
+ * Read the version of a vault file without decrypting it
+ *
+ * param const char* encrypted_filename: Name of encrypted file
+ * return uint64_t: The vault version, 0 if the file has no header or does not exist
+ */
+uint64_t read_vault_version(const char *encrypted_filename) {
+    uint64_t version = 0;
+    FILE *input_file = fopen(encrypted_filename, "rb");
+    if (input_file) {
+        unsigned char header[VAULT_HEADER_SIZE];
+        struct vault_encoding encoding;
+        read_header(input_file, header, &encoding, &version);
+        fclose(input_file);
+    }
+    return version;
+}
+
+
+/*
+ * Set up a cipher context for a vault file. The authenticated suites cover the header as
+ * additional data, so neither the version nor the suite can be changed unnoticed.
+ * Since header format 2 the key is derived for the cipher suite of the file, so no two suites
+ * ever use the same key, even if the suite byte of a file is changed
+ *
+ * param enum cipher_suite suite: The cipher suite of the file
+ * param const unsigned char* header: The header of the file
+ * param const struct vault_key* derived: The vault key
+ * param const unsigned char* nonce: Nonce of the authenticated suites, ignored otherwise
+ * param int encrypt: 1 to encrypt, 0 to decrypt
+ * return EVP_CIPHER_CTX*: The context, NULL on failure
+ */
+static EVP_CIPHER_CTX *init_vault_cipher(
+    const enum cipher_suite suite,
+    const unsigned char *header,
+    const struct vault_key *derived,
+    const unsigned char *nonce,
+    const int encrypt) {
+    const struct cipher_suite_info *info = &cipher_suites[suite];
+    struct vault_key suite_key;
+    char purpose[64];
+    snprintf(purpose, sizeof(purpose), "vault cipher %s", info->name);
+    const bool bound = header[VAULT_MAGIC_SIZE] >= VAULT_HEADER_FORMAT;
+    if (bound && !derive_file_key(derived, purpose, &suite_key)) {
+        OPENSSL_cleanse(&suite_key, sizeof(suite_key));
+        return NULL;
     }
+    const unsigned char *key = bound ? suite_key.key : derived->key;
+    const unsigned char *iv = bound ? suite_key.iv : derived->iv;
 
-    const size_t chunk_size = AES_BLOCK_SIZE * 1024;  // Define chunk size
-    unsigned char buffer[chunk_size];
-    unsigned char cipher_buffer[chunk_size + AES_BLOCK_SIZE];
+    // The cipher context keeps its own copy of the key schedule
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int aad_length = 0;
+    const bool initialized = ctx &&
+        EVP_CipherInit_ex(ctx, info->cipher(), NULL, key, info->authenticated ? nonce : iv, encrypt) == 1 &&
+        (!info->authenticated || EVP_CipherUpdate(ctx, NULL, &aad_length, header, VAULT_HEADER_SIZE) == 1);
+    OPENSSL_cleanse(&suite_key, sizeof(suite_key));
+    if (!initialized) {
+        EVP_CIPHER_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+
+// zlib keeps cleartext in its window and buffers, so its state lives on the secure heap as well
+static voidpf secure_zalloc(voidpf opaque, const uInt items, const uInt size) {
+    (void) opaque;
+    return secure_malloc((size_t) items * size);
+}
+
+
+static void secure_zfree(voidpf opaque, voidpf address) {
+    (void) opaque;
+    secure_free(address);
+}
+
+
+/*
+ * Encrypt a piece of the (compressed) payload and write it to the vault file
+ *
+ * param EVP_CIPHER_CTX* ctx: The cipher context
+ * param FILE* file: The vault file
+ * param const unsigned char* data: The payload
+ * param size_t length: Length of the payload, at most STREAM_CHUNK_SIZE
+ * param unsigned char* cipher_buffer: Scratch buffer of STREAM_CHUNK_SIZE + AES_BLOCK_SIZE bytes
+ * return bool: Indication whether the piece was written
+ */
+static bool write_encrypted(
+    EVP_CIPHER_CTX *ctx,
+    FILE *file,
+    const unsigned char *data,
+    const size_t length,
+    unsigned char *cipher_buffer) {
     int cipher_len;
+    return 1 == EVP_EncryptUpdate(ctx, cipher_buffer, &cipher_len, data, (int) length) &&
+        fwrite(cipher_buffer, 1, cipher_len, file) == (size_t) cipher_len;
+}
 
-    size_t input_size = strlen(*input);
-    size_t offset = 0;
-    while (offset < input_size) {
-        size_t bytes_to_read = input_size - offset > chunk_size ? chunk_size : input_size - offset;
 
-        // Copy data from the input array into the buffer
-        memcpy(buffer, *input + offset, bytes_to_read);
+/*
+ * Encrypt data to a vault file with the preferred encoding. Files written with another cipher
+ * suite or codec are thereby converted on their next save
+ *
+ * param const char* encrypted_filename: Name of encrypted file
+ * param const char** input: Pointer to the char array in which the cleartext contents are stored
+ * param const struct vault_key* key: Vault key to be used for encryption
+ * param uint64_t version: Vault version stored in the header
+ * return bool: Indication whether operation was successful
+ */
+bool encrypt_file(const char *encrypted_filename, char **input, const struct vault_key *key, const uint64_t version) {
+    const struct vault_encoding encoding = preferred_vault_encoding();
+    return encrypt_file_as(encrypted_filename, input, key, version, &encoding);
+}
 
-        // Encrypt the current chunk
-        if (1 != EVP_EncryptUpdate(ctx, cipher_buffer, &cipher_len, buffer, bytes_to_read)) {
-            EVP_CIPHER_CTX_free(ctx);
-            fclose(output_file);
-            return false;
-        }
 
-        // Write the encrypted chunk to the output file
-        if (fwrite(cipher_buffer, 1, cipher_len, output_file) != cipher_len) {
-            EVP_CIPHER_CTX_free(ctx);
-            fclose(output_file);
-            return false;
-        }
+/*
+ * Encrypt data to a vault file with the given cipher suite and codec
+ *
+ * param const char* encrypted_filename: Name of encrypted file
+ * param const char** input: Pointer to the char array in which the cleartext contents are stored
+ * param const struct vault_key* key: Vault key to be used for encryption
+ * param uint64_t version: Vault version stored in the header
+ * param const struct vault_encoding* encoding: Cipher suite and codec
+ * return bool: Indication whether operation was successful
+ */
+bool encrypt_file_as(
+    const char *encrypted_filename,
+    char **input,
+    const struct vault_key *key,
+    const uint64_t version,
+    const struct vault_encoding *encoding) {
+    const bool authenticated = cipher_suites[encoding->suite].authenticated;
+    unsigned char header[VAULT_HEADER_SIZE];
+    unsigned char nonce[AEAD_NONCE_SIZE];
+    format_header(header, encoding, version);
+    // Every file gets a fresh nonce, the key stays the same across saves
+    if (authenticated && RAND_bytes(nonce, sizeof(nonce)) != 1)
+        return false;
 
-        offset += bytes_to_read;
-    }
+    FILE *output_file = fopen(encrypted_filename, "wb");
 
-    // Finalize the encryption
-    if (1 != EVP_EncryptFinal_ex(ctx, cipher_buffer, &cipher_len)) {
-        EVP_CIPHER_CTX_free(ctx);
+    if (!output_file) {
+        return false;
+    }
+    if (fwrite(header, 1, sizeof(header), output_file) != sizeof(header) ||
+        (authenticated && fwrite(nonce, 1, sizeof(nonce), output_file) != sizeof(nonce))) {
         fclose(output_file);
         return false;
     }
 
-    if (fwrite(cipher_buffer, 1, cipher_len, output_file) != cipher_len) {
-        EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_CTX *ctx = init_vault_cipher(encoding->suite, header, key, nonce, 1);
+    if (!ctx) {
         fclose(output_file);
         return false;
     }
 
+    unsigned char cipher_buffer[STREAM_CHUNK_SIZE + AES_BLOCK_SIZE];
+    int cipher_len;
+    const size_t input_size = strlen(*input);
+    bool ok = true;
+    if (encoding->codec == CODEC_ZLIB) {
+        // Compressed output is cleartext as well
+        unsigned char *compressed = secure_malloc(STREAM_CHUNK_SIZE);
+        z_stream stream = {.zalloc = secure_zalloc, .zfree = secure_zfree};
+        ok = compressed && deflateInit(&stream, encoding->level) == Z_OK;
+        if (ok) {
+            // zlib counts in uInt, so the input is fed in pieces
+            size_t offset = 0;
+            int status = Z_OK;
+            while (ok && status != Z_STREAM_END) {
+                if (stream.avail_in == 0 && offset < input_size) {
+                    const size_t piece = input_size - offset > UINT32_MAX / 2 ? UINT32_MAX / 2 : input_size - offset;
+                    stream.next_in = (Bytef *) *input + offset;
+                    stream.avail_in = (uInt) piece;
+                    offset += piece;
+                }
+                stream.next_out = compressed;
+                stream.avail_out = STREAM_CHUNK_SIZE;
+                status = deflate(&stream, offset == input_size ? Z_FINISH : Z_NO_FLUSH);
+                ok = (status == Z_OK || status == Z_STREAM_END || status == Z_BUF_ERROR) &&
+                    write_encrypted(ctx, output_file, compressed, STREAM_CHUNK_SIZE - stream.avail_out, cipher_buffer);
+            }
+            deflateEnd(&stream);
+        }
+        secure_free(compressed);
+    } else {
+        // Encrypt the input chunk by chunk directly, so no cleartext copy is left on the stack
+        for (size_t offset = 0; ok && offset < input_size; offset += STREAM_CHUNK_SIZE) {
+            const size_t length = input_size - offset > STREAM_CHUNK_SIZE ? STREAM_CHUNK_SIZE : input_size - offset;
+            ok = write_encrypted(ctx, output_file, (const unsigned char *) *input + offset, length, cipher_buffer);
+        }
+    }
+
+    // Finalize the encryption, the authenticated suites end the file with their tag
+    ok = ok && 1 == EVP_EncryptFinal_ex(ctx, cipher_buffer, &cipher_len) &&
+        (!authenticated || 1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, cipher_buffer + cipher_len));
+    if (ok && authenticated)
+        cipher_len += AEAD_TAG_SIZE;
+    ok = ok && fwrite(cipher_buffer, 1, cipher_len, output_file) == (size_t) cipher_len;
+
     EVP_CIPHER_CTX_free(ctx);
-    fclose(output_file);
+    return fclose(output_file) == 0 && ok;
+}
+
 
+/*
+ * Make room for more decompressed output
+ *
+ * param char** output: The output buffer on the secure heap
+ * param size_t* allocated_size: Its size, doubled
+ * return bool: false if memory ran out, the buffer is freed then
+ */
+static bool grow_output(char **output, size_t *allocated_size) {
+    char *new_output = secure_realloc(*output, 2 * *allocated_size);
+    if (!new_output) {
+        secure_free(*output);
+        *output = NULL;
+        return false;
+    }
+    *output = new_output;
+    *allocated_size *= 2;
     return true;
 }
 
+
 /*
- * Decrypt data from input file to output file using AES-256-CBC
+ * Decompress a decrypted payload
+ *
+ * param const unsigned char* compressed: The zlib stream
+ * param size_t size: Its length
+ * return char*: The terminated cleartext on the secure heap, NULL if the stream is damaged,
+ *               truncated or followed by other data, or if memory ran out
+ */
+static char *inflate_payload(const unsigned char *compressed, const size_t size) {
+    size_t allocated_size = 4 * size + STREAM_CHUNK_SIZE;
+    char *output = secure_malloc(allocated_size);
+    z_stream stream = {.zalloc = secure_zalloc, .zfree = secure_zfree};
+    if (!output || inflateInit(&stream) != Z_OK) {
+        secure_free(output);
+        return NULL;
+    }
+
+    size_t offset = 0;
+    size_t total_size = 0;
+    int status = Z_OK;
+    bool ok = true;
+    while (ok && status != Z_STREAM_END) {
+        // zlib counts in uInt, so the input is fed in pieces
+        if (stream.avail_in == 0 && offset < size) {
+            const size_t piece = size - offset > UINT32_MAX / 2 ? UINT32_MAX / 2 : size - offset;
+            stream.next_in = (Bytef *) compressed + offset;
+            stream.avail_in = (uInt) piece;
+            offset += piece;
+        }
+        if (allocated_size - total_size < STREAM_CHUNK_SIZE / 2 && !grow_output(&output, &allocated_size))
+            break;
+        const size_t room = allocated_size - total_size - 1;
+        stream.next_out = (Bytef *) output + total_size;
+        stream.avail_out = (uInt) (room > UINT32_MAX / 2 ? UINT32_MAX / 2 : room);
+        status = inflate(&stream, Z_NO_FLUSH);
+        total_size = (size_t) ((char *) stream.next_out - output);
+        // There is always room for output, so running out of buffer means the input is truncated
+        ok = status == Z_OK || status == Z_STREAM_END;
+    }
+    inflateEnd(&stream);
+    // A truncated stream fails as well as trailing data after it
+    if (!output || !ok || stream.avail_in != 0 || offset != size) {
+        secure_free(output);
+        return NULL;
+    }
+    output[total_size] = '\0';
+    return output;
+}
+
+
+/*
+ * Decrypt a vault file with the cipher suite and codec named in its header.
+ * The file is opened once, so the result is a consistent snapshot even if another process
+ * replaces the file meanwhile. The whole ciphertext is decrypted, and the tag of the authenticated
+ * suites checked, before anything is decompressed, so a forged file never reaches zlib.
  *
  * param const char* encrypted_filename: Name of encrypted file
  * param const char** output: Pointer to char array in which cleartext file contents will be saved
- * param char* password: Master password to be used for decryption
+ * param const struct vault_key* key: Vault key to be used for decryption
+ * param uint64_t* version: Receives the vault version from the header, may be NULL
  * return bool: Indication whether decryption was successful or not
  */
-bool decrypt_file(const char *encrypted_filename, char **output, char *password) {
+bool decrypt_file(const char *encrypted_filename, char **output, const struct vault_key *key, uint64_t *version) {
+    *output = NULL;
     FILE *input_file = fopen(encrypted_filename, "rb");
 
     if (!input_file) {
-        fclose(input_file);
         return false;
     }
-
-    unsigned char key[AES_256_KEY_SIZE], iv[AES_BLOCK_SIZE];
-    if (!derive_key_and_iv((const unsigned char*) password, key, iv)) {
+    unsigned char header[VAULT_HEADER_SIZE];
+    struct vault_encoding encoding;
+    uint64_t file_version;
+    if (!read_header(input_file, header, &encoding, &file_version)) {
         fclose(input_file);
         return false;
     }
+    if (version)
+        *version = file_version;
 
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
+    const bool authenticated = cipher_suites[encoding.suite].authenticated;
+    unsigned char nonce[AEAD_NONCE_SIZE];
+    const long start = ftell(input_file);
+    long end = -1;
+    if (start >= 0 && fseek(input_file, 0, SEEK_END) == 0)
+        end = ftell(input_file);
+    const long overhead = authenticated ? AEAD_NONCE_SIZE + AEAD_TAG_SIZE : 0;
+    if (end < start + overhead || fseek(input_file, start, SEEK_SET) != 0 ||
+        (authenticated && fread(nonce, 1, sizeof(nonce), input_file) != sizeof(nonce))) {
         fclose(input_file);
         return false;
     }
+    size_t remaining = (size_t) (end - start - overhead);
 
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key, iv)) {
+    EVP_CIPHER_CTX *ctx = init_vault_cipher(encoding.suite, header, key, nonce, 0);
+    if (!ctx) {
         fclose(input_file);
         return false;
     }
 
-    unsigned char buffer[AES_BLOCK_SIZE * 1024];
-    int len, plain_len;
-    // Allocate initial memory for output
+    // The size of the decrypted payload is known up front, so it is allocated once and never copied.
+    // An update may write up to one block more than it is given, plus room for the terminator
+    unsigned char *plain = secure_malloc(remaining + 2 * AES_BLOCK_SIZE + 1);
+    bool ok = plain != NULL;
+    unsigned char buffer[STREAM_CHUNK_SIZE];
+    int plain_len;
     size_t total_size = 0;
-    size_t allocated_size = AES_BLOCK_SIZE * 1024;
-    *output = calloc(allocated_size, sizeof(char));
-    if (!*output) {
-        EVP_CIPHER_CTX_free(ctx);
-        fclose(input_file);
-        return false;
+    while (ok && remaining > 0) {
+        const size_t len = fread(buffer, 1, remaining < sizeof(buffer) ? remaining : sizeof(buffer), input_file);
+        remaining -= len;
+        ok = len > 0 && 1 == EVP_DecryptUpdate(ctx, plain + total_size, &plain_len, buffer, (int) len);
+        if (ok)
+            total_size += plain_len;
     }
-
-    while ((len = fread(buffer, 1, sizeof(buffer), input_file)) > 0) {
-        if (1 != EVP_DecryptUpdate(ctx, (unsigned char *)*output + total_size, &plain_len, buffer, len)) {
-            free(*output);
-            EVP_CIPHER_CTX_free(ctx);
-            fclose(input_file);
-            return false;
-        }
+    // The authenticated suites only succeed if the tag matches the header, nonce and ciphertext
+    unsigned char tag[AEAD_TAG_SIZE];
+    ok = ok && (!authenticated || (fread(tag, 1, sizeof(tag), input_file) == sizeof(tag) &&
+            1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE, tag))) &&
+        1 == EVP_DecryptFinal_ex(ctx, plain + total_size, &plain_len);
+    if (ok)
         total_size += plain_len;
+    EVP_CIPHER_CTX_free(ctx);
+    fclose(input_file);
 
-        // Resize output buffer if needed
-        if (total_size + AES_BLOCK_SIZE > allocated_size) {
-            allocated_size *= 2;
-            char *new_output = realloc(*output, allocated_size);
-            if (!new_output) {
-                free(*output);
-                EVP_CIPHER_CTX_free(ctx);
-                fclose(input_file);
-                return false;
-            }
-            *output = new_output;
-        }
-    }
-
-    if (1 != EVP_DecryptFinal_ex(ctx, (unsigned char *)*output + total_size, &plain_len)) {
-        fprintf(stderr, "Decryption failed\n");
-        free(*output);
-        EVP_CIPHER_CTX_free(ctx);
-        fclose(input_file);
+    if (!ok) {
+        secure_free(plain);
         return false;
     }
-    total_size += plain_len;
-
-    // Resize to actual size
-    char *final_output = realloc(*output, total_size + 1);
-    if (final_output) {
-        final_output[total_size] = '\0';
-        *output = final_output;
+    if (encoding.codec == CODEC_ZLIB) {
+        *output = inflate_payload(plain, total_size);
+        secure_free(plain);
+        return *output != NULL;
     }
-
-    EVP_CIPHER_CTX_free(ctx);
-    fclose(input_file);
+    // The buffer always has room for the terminator, shrinking it would copy the cleartext again
+    plain[total_size] = '\0';
+    *output = (char *) plain;
     return true;
 }
@@ -6,9 +6,77 @@
 #define CRYPTO_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-bool encrypt_file(const char *encrypted_filename, char **input, char *password);
-bool decrypt_file(const char *encrypted_filename, char **output, char *password);
+// Vault files start with a plaintext header, files written before it hold only the ciphertext
+#define VAULT_MAGIC "CPASS"
+#define VAULT_MAGIC_SIZE 5
+#define VAULT_HEADER_FORMAT 2
+// Files of header format 1 are encrypted with the vault key itself instead of a key bound to their cipher suite
+#define VAULT_HEADER_FORMAT_UNBOUND 1
+// Magic, format, cipher suite, codec and the vault version as 64 bit little endian integer
+#define VAULT_HEADER_SIZE 16
+// Overrides the cipher suite new vault files are written with, e.g. C_PASS_CIPHER=chacha20-poly1305
+#define CIPHER_ENVIRONMENT_VARIABLE "C_PASS_CIPHER"
+// Selects the compression of new vault files: "none", "zlib" or "zlib:LEVEL"
+#define CODEC_ENVIRONMENT_VARIABLE "C_PASS_COMPRESSION"
+#define DEFAULT_ZLIB_LEVEL 1
+#define VAULT_KEY_SIZE 32
+#define VAULT_IV_SIZE 16
+
+// Cipher suite of a vault file, stored in its header. Files without a header use AES-256-CBC
+enum cipher_suite {
+    CIPHER_AES_256_CBC = 0,
+    CIPHER_AES_256_GCM = 1,
+    CIPHER_CHACHA20_POLY1305 = 2
+};
+#define CIPHER_SUITE_COUNT 3
+
+// Compression applied to the payload before encryption, stored in the header with its level
+enum vault_codec {
+    CODEC_NONE = 0,
+    CODEC_ZLIB = 1
+};
+
+// Key and IV derived from a master password, the root of every other key of the vault
+struct vault_key {
+    unsigned char key[VAULT_KEY_SIZE];
+    unsigned char iv[VAULT_IV_SIZE];
+};
+
+// How a vault file is written
+struct vault_encoding {
+    enum cipher_suite suite;
+    enum vault_codec codec;
+    int level; // Compression level, 1 (fastest) to 9 (smallest)
+};
+
+const char *cipher_suite_name(enum cipher_suite suite);
+bool parse_cipher_suite(const char *name, enum cipher_suite *suite);
+bool derive_vault_key(const char *password, struct vault_key *key);
+bool derive_subkey(
+    const struct vault_key *key,
+    const char *purpose,
+    const unsigned char *salt,
+    size_t salt_size,
+    unsigned char *subkey,
+    size_t subkey_size);
+bool derive_file_key(const struct vault_key *key, const char *purpose, struct vault_key *file_key);
+bool has_aes_acceleration(void);
+enum cipher_suite preferred_cipher_suite(void);
+bool parse_vault_codec(const char *text, enum vault_codec *codec, int *level);
+struct vault_encoding preferred_vault_encoding(void);
+double benchmark_cipher_suite(enum cipher_suite suite, size_t size, int rounds);
+bool encrypt_file(const char *encrypted_filename, char **input, const struct vault_key *key, uint64_t version);
+bool encrypt_file_as(
+    const char *encrypted_filename,
+    char **input,
+    const struct vault_key *key,
+    uint64_t version,
+    const struct vault_encoding *encoding);
+bool decrypt_file(const char *encrypted_filename, char **output, const struct vault_key *key, uint64_t *version);
+uint64_t read_vault_version(const char *encrypted_filename);
 
 
 #endif //CRYPTO_H
@@ -0,0 +1,267 @@
+#include "expiry.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * Get the time the password of an entry has to be rotated, from the maximum age of its policy
+ * or of the vault requirement. Passwords of unknown age count as set in 1970, so they are due
+ *
+ * param const struct password_requirement* requirement: The requirement holding the policies
+ * param const struct password* entry: The entry
+ * return long long: The Unix time the password expires, 0 if it never does
+ */
+long long password_due_date(const struct password_requirement *requirement, const struct password *entry) {
+    struct password_rules rules;
+    get_password_rules(requirement, entry, &rules);
+    if (rules.max_age <= 0)
+        return 0;
+    return entry->changed + (long long) rules.max_age * SECONDS_PER_DAY;
+}
+
+
+/*
+ * Put an item at a position of the heap and tell its entry where it is
+ */
+static void place(struct expiry_index *index, const int position, const struct expiry_item item) {
+    index->heap[position] = item;
+    item.entry->expiry_position = position + 1;
+}
+
+
+static void sift_up(struct expiry_index *index, int position) {
+    const struct expiry_item item = index->heap[position];
+    while (position > 0 && index->heap[(position - 1) / 2].due > item.due) {
+        place(index, position, index->heap[(position - 1) / 2]);
+        position = (position - 1) / 2;
+    }
+    place(index, position, item);
+}
+
+
+static void sift_down(struct expiry_index *index, int position) {
+    const struct expiry_item item = index->heap[position];
+    for (;;) {
+        int smallest = -1;
+        const int left = 2 * position + 1;
+        const int right = left + 1;
+        if (left < index->count && index->heap[left].due < item.due)
+            smallest = left;
+        if (right < index->count && index->heap[right].due < (smallest < 0 ? item.due : index->heap[left].due))
+            smallest = right;
+        if (smallest < 0)
+            break;
+        place(index, position, index->heap[smallest]);
+        position = smallest;
+    }
+    place(index, position, item);
+}
+
+
+/*
+ * Build the index of all entries whose password has a maximum age. The heap is built bottom up in O(n)
+ *
+ * param struct expiry_index* index: Receives the index, free it with free_expiry_index
+ * param const struct password_requirement* requirement: Resolves the maximum age of every entry, must outlive the index
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return bool: false if memory ran out
+ */
+bool build_expiry_index(
+    struct expiry_index *index,
+    const struct password_requirement *requirement,
+    struct password **passwords,
+    const int num_passwords) {
+    memset(index, 0, sizeof(struct expiry_index));
+    index->requirement = requirement;
+    index->capacity = num_passwords > DEFAULT_CAPACITY ? num_passwords : DEFAULT_CAPACITY;
+    index->heap = malloc((size_t) index->capacity * sizeof(struct expiry_item));
+    if (!index->heap)
+        return false;
+    for (int i = 0; i < num_passwords; i++) {
+        if (!passwords[i])
+            continue;
+        passwords[i]->expiry_position = 0;
+        const long long due = password_due_date(requirement, passwords[i]);
+        if (due != 0)
+            place(index, index->count++, (struct expiry_item) {due, passwords[i]});
+    }
+    for (int position = index->count / 2 - 1; position >= 0; position--)
+        sift_down(index, position);
+    return true;
+}
+
+
+/*
+ * Free the heap of an index, the entries keep stale positions until they are indexed again
+ *
+ * param struct expiry_index* index: The index
+ */
+void free_expiry_index(struct expiry_index *index) {
+    free(index->heap);
+    memset(index, 0, sizeof(struct expiry_index));
+}
+
+
+/*
+ * Insert an entry or move it to its new due date in O(log n), e.g. after its password changed
+ *
+ * param struct expiry_index* index: The index
+ * param struct password* entry: The entry
+ */
+void update_expiry(struct expiry_index *index, struct password *entry) {
+    const long long due = password_due_date(index->requirement, entry);
+    if (due == 0) {
+        remove_expiry(index, entry);
+        return;
+    }
+    const int position = entry->expiry_position - 1;
+    if (position >= 0 && position < index->count && index->heap[position].entry == entry) {
+        const long long previous = index->heap[position].due;
+        index->heap[position].due = due;
+        if (due < previous)
+            sift_up(index, position);
+        else
+            sift_down(index, position);
+        return;
+    }
+    if (index->count == index->capacity) {
+        const int capacity = index->capacity ? 2 * index->capacity : DEFAULT_CAPACITY;
+        struct expiry_item *grown = realloc(index->heap, (size_t) capacity * sizeof(struct expiry_item));
+        if (!grown) {
+            index->incomplete = true;
+            return;
+        }
+        index->heap = grown;
+        index->capacity = capacity;
+    }
+    place(index, index->count, (struct expiry_item) {due, entry});
+    sift_up(index, index->count++);
+}
+
+
+/*
+ * Remove an entry from the index in O(log n), e.g. before it is deleted
+ *
+ * param struct expiry_index* index: The index
+ * param struct password* entry: The entry, nothing happens if it is not indexed
+ */
+void remove_expiry(struct expiry_index *index, struct password *entry) {
+    const int position = entry->expiry_position - 1;
+    if (position < 0 || position >= index->count || index->heap[position].entry != entry)
+        return;
+    entry->expiry_position = 0;
+    const struct expiry_item last = index->heap[--index->count];
+    if (position == index->count)
+        return;
+    const long long removed = index->heap[position].due;
+    place(index, position, last);
+    if (last.due < removed)
+        sift_up(index, position);
+    else
+        sift_down(index, position);
+}
+
+
+/*
+ * Notify function of a password listener keeping an index current
+ *
+ * param void* context: The struct expiry_index
+ */
+void track_expiry(struct password *entry, const enum password_change change, void *context) {
+    if (change == PASSWORD_REMOVED)
+        remove_expiry(context, entry);
+    else
+        update_expiry(context, entry);
+}
+
+
+/*
+ * Push a heap position onto the candidates of next_expiring_passwords, a min-heap of positions ordered by due date
+ */
+static void push_candidate(const struct expiry_index *index, int *candidates, int *count, const int position) {
+    int at = (*count)++;
+    while (at > 0 && index->heap[candidates[(at - 1) / 2]].due > index->heap[position].due) {
+        candidates[at] = candidates[(at - 1) / 2];
+        at = (at - 1) / 2;
+    }
+    candidates[at] = position;
+}
+
+
+static int pop_candidate(const struct expiry_index *index, int *candidates, int *count) {
+    const int top = candidates[0];
+    const int last = candidates[--(*count)];
+    int at = 0;
+    for (;;) {
+        int smallest = -1;
+        const int left = 2 * at + 1;
+        const int right = left + 1;
+        const long long due = index->heap[last].due;
+        if (left < *count && index->heap[candidates[left]].due < due)
+            smallest = left;
+        if (right < *count &&
+            index->heap[candidates[right]].due < (smallest < 0 ? due : index->heap[candidates[left]].due))
+            smallest = right;
+        if (smallest < 0)
+            break;
+        candidates[at] = candidates[smallest];
+        at = smallest;
+    }
+    if (*count > 0)
+        candidates[at] = last;
+    return top;
+}
+
+
+/*
+ * Get the K entries due first, up to a time, in O(K log K) without changing the index: the
+ * children of a heap node are never due before it, so only the children of the nodes taken so far
+ * can be next
+ *
+ * param const struct expiry_index* index: The index
+ * param long long until: Unix time, entries due later are left out
+ * param int k: Most entries to return
+ * param struct expiry_item* items: Receives the entries, earliest due date first, room for k items
+ * return int: Number of entries, -1 if memory ran out
+ */
+int next_expiring_passwords(const struct expiry_index *index, const long long until, const int k, struct expiry_item *items) {
+    if (k <= 0 || index->count == 0 || index->heap[0].due > until)
+        return 0;
+    // Every item taken adds at most two candidates and removes one
+    int *candidates = malloc(((size_t) (k < index->count ? k : index->count) + 1) * sizeof(int));
+    if (!candidates)
+        return -1;
+    int num_candidates = 0;
+    int count = 0;
+    push_candidate(index, candidates, &num_candidates, 0);
+    while (count < k && num_candidates > 0) {
+        const int position = pop_candidate(index, candidates, &num_candidates);
+        if (index->heap[position].due > until)
+            break;
+        items[count++] = index->heap[position];
+        for (int child = 2 * position + 1; child <= 2 * position + 2 && child < index->count; child++)
+            push_candidate(index, candidates, &num_candidates, child);
+    }
+    free(candidates);
+    return count;
+}
+
+
+static int count_subtree(const struct expiry_index *index, const int position, const long long until) {
+    if (position >= index->count || index->heap[position].due > until)
+        return 0;
+    return 1 + count_subtree(index, 2 * position + 1, until) + count_subtree(index, 2 * position + 2, until);
+}
+
+
+/*
+ * Count the entries due up to a time in O(K), only the due entries and their children are visited
+ *
+ * param const struct expiry_index* index: The index
+ * param long long until: Unix time, entries due later are not counted
+ * return int: Number of entries due
+ */
+int count_expiring_passwords(const struct expiry_index *index, const long long until) {
+    return count_subtree(index, 0, until);
+}
@@ -0,0 +1,42 @@
+#ifndef EXPIRY_H
+#define EXPIRY_H
+
+#include <stdbool.h>
+#include "password.h"
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+// Days ahead the menu and the expiry command look for passwords due for rotation
+#define DEFAULT_EXPIRY_WINDOW_DAYS 14
+// Due passwords the menu lists when it starts
+#define EXPIRY_MENU_ENTRIES 5
+
+// An entry whose password is due for rotation at a Unix time
+struct expiry_item {
+    long long due;
+    struct password *entry;
+};
+
+// Min-heap of the due dates of all entries whose password has a maximum age. The entries know
+// their position in the heap, so a changed or deleted entry is moved or removed in O(log n)
+struct expiry_index {
+    const struct password_requirement *requirement;
+    struct expiry_item *heap;
+    int count;
+    int capacity;
+    bool incomplete; // An insert ran out of memory, the index misses entries until it is rebuilt
+};
+
+long long password_due_date(const struct password_requirement *requirement, const struct password *entry);
+bool build_expiry_index(
+    struct expiry_index *index,
+    const struct password_requirement *requirement,
+    struct password **passwords,
+    int num_passwords);
+void free_expiry_index(struct expiry_index *index);
+void update_expiry(struct expiry_index *index, struct password *entry);
+void remove_expiry(struct expiry_index *index, struct password *entry);
+void track_expiry(struct password *entry, enum password_change change, void *context);
+int next_expiring_passwords(const struct expiry_index *index, long long until, int k, struct expiry_item *items);
+int count_expiring_passwords(const struct expiry_index *index, long long until);
+
+#endif //EXPIRY_H
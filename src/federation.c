@@ -0,0 +1,301 @@
+#include "federation.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crypto.h"
+#include "frecency.h"
+#include "secure_heap.h"
+#include "util.h"
+
+// Unlocks one vault of the federation
+struct unlock_job {
+    struct federated_vault *vault;
+};
+
+// Searches one vault of the federation, the matches are owned by the job
+struct search_job {
+    const struct federated_vault *vault;
+    int vault_index;
+    const char *term;
+    bool exact;
+    struct federated_match *matches;
+    int count;
+    int capacity;
+    long long now;
+};
+
+
+/*
+ * Get the vault file to open, the value of C_PASS_VAULT if set and not empty
+ *
+ * return const char*: The path of the vault file
+ */
+const char *default_vault_path(void) {
+    const char *path = getenv(VAULT_ENVIRONMENT_VARIABLE);
+    return path && *path ? path : DEFAULT_VAULT_FILE;
+}
+
+
+/*
+ * Split a list of vault paths in place at VAULT_LIST_SEPARATOR, empty entries are skipped
+ *
+ * param char* list: The list, e.g. the value of C_PASS_VAULTS, modified in place
+ * param const char** paths: Receives pointers into the list
+ * param int max_paths: Capacity of paths
+ * return int: Number of paths, -1 if the list holds more than max_paths
+ */
+int split_vault_list(char *list, const char **paths, const int max_paths) {
+    int num_paths = 0;
+    char *path = list;
+    while (path) {
+        char *separator = strchr(path, VAULT_LIST_SEPARATOR);
+        if (separator)
+            *separator = '\0';
+        if (*path) {
+            if (num_paths == max_paths)
+                return -1;
+            paths[num_paths++] = path;
+        }
+        path = separator ? separator + 1 : NULL;
+    }
+    return num_paths;
+}
+
+
+/*
+ * Prepare a federation of the given vault files, none of them is unlocked yet.
+ * The caller sets the vault key of every vault before unlock_federation
+ *
+ * param struct federation* federation: The federation to initialize
+ * param const char** paths: The vault files, they must outlive the federation
+ * param int num_paths: Number of vault files, at most MAX_FEDERATED_VAULTS
+ * return bool: false if there are too many vaults or memory ran out
+ */
+bool open_federation(struct federation *federation, const char **paths, const int num_paths) {
+    federation->num_vaults = 0;
+    federation->vaults = NULL;
+    if (num_paths < 1 || num_paths > MAX_FEDERATED_VAULTS)
+        return false;
+    federation->vaults = calloc(num_paths, sizeof(struct federated_vault));
+    if (!federation->vaults)
+        return false;
+    for (int i = 0; i < num_paths; i++)
+        federation->vaults[i].path = paths[i];
+    federation->num_vaults = num_paths;
+    return true;
+}
+
+
+/*
+ * Get the milliseconds passed since a point in time
+ */
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return 1000.0 * (double) (now.tv_sec - since->tv_sec) + (double) (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+
+/*
+ * Decrypt and parse one vault
+ *
+ * param void* arg: The struct unlock_job
+ * return void*: NULL
+ */
+static void *unlock_vault_job(void *arg) {
+    struct federated_vault *vault = ((struct unlock_job *) arg)->vault;
+    struct timespec started;
+    timespec_get(&started, TIME_UTC);
+    char *cleartext = NULL;
+    uint64_t version = 0;
+    if (vault->vault_key && file_exists(vault->path) &&
+        decrypt_file(vault->path, &cleartext, vault->vault_key, &version)) {
+        vault->passwords = read_passwords(cleartext, &vault->num_passwords);
+        vault->unlocked = vault->passwords != NULL;
+        // Without access counts the ranking only loses its tie-breaker
+        if (vault->unlocked)
+            load_access_stats(vault->path, vault->vault_key, vault->passwords, vault->num_passwords);
+    }
+    secure_free(cleartext);
+    vault->unlock_ms = elapsed_ms(&started);
+    return NULL;
+}
+
+
+/*
+ * Unlock all vaults of the federation at once, each on a thread of its own, so the whole
+ * federation takes about as long as its slowest vault. Vaults that cannot be decrypted
+ * are left locked
+ *
+ * param struct federation* federation: The federation with the vault keys set
+ */
+void unlock_federation(struct federation *federation) {
+    struct unlock_job jobs[MAX_FEDERATED_VAULTS];
+    for (int i = 0; i < federation->num_vaults; i++)
+        jobs[i].vault = &federation->vaults[i];
+    run_jobs(unlock_vault_job, jobs, sizeof(struct unlock_job), federation->num_vaults);
+}
+
+
+/*
+ * Find a string in another one ignoring the case of ASCII letters
+ *
+ * param const char* text: The string to search in
+ * param const char* term: The string to search for, not empty
+ * return const char*: The first occurrence in text or NULL
+ */
+static const char *find_ignoring_case(const char *text, const char *term) {
+    for (; *text; text++) {
+        size_t i = 0;
+        while (term[i] && tolower((unsigned char) text[i]) == tolower((unsigned char) term[i]))
+            i++;
+        if (!term[i])
+            return text;
+    }
+    return NULL;
+}
+
+
+/*
+ * Rank how well an entry matches a search term
+ *
+ * param const struct password* entry: The entry
+ * param const char* term: The search term, not empty
+ * return int: One of the MATCH_* scores, 0 if the entry does not match
+ */
+static int score_entry(const struct password *entry, const char *term) {
+    const char *found = find_ignoring_case(entry->name, term);
+    if (found == entry->name)
+        return entry->name[strlen(term)] == '\0' ? MATCH_EXACT_NAME : MATCH_NAME_PREFIX;
+    if (found) {
+        for (const char *at = found; at; at = find_ignoring_case(at + 1, term)) {
+            if (!isalnum((unsigned char) at[-1]))
+                return MATCH_NAME_WORD;
+        }
+        return MATCH_NAME;
+    }
+    if (find_ignoring_case(entry->username, term))
+        return MATCH_USERNAME;
+    if ((entry->folder && find_ignoring_case(entry->folder, term)) ||
+        (entry->tags && find_ignoring_case(entry->tags, term)))
+        return MATCH_FOLDER_OR_TAG;
+    return 0;
+}
+
+
+/*
+ * Collect the matching entries of one vault
+ *
+ * param void* arg: The struct search_job
+ * return void*: NULL
+ */
+static void *search_vault_job(void *arg) {
+    struct search_job *job = arg;
+    const struct federated_vault *vault = job->vault;
+    if (!vault->unlocked)
+        return NULL;
+    for (int slot = 0; slot < vault->num_passwords; slot++) {
+        const struct password *entry = vault->passwords[slot];
+        if (!entry)
+            continue;
+        const int score = job->exact ?
+            (strcmp(entry->name, job->term) == 0 ? MATCH_EXACT_NAME : 0) : score_entry(entry, job->term);
+        if (score == 0)
+            continue;
+        if (job->count == job->capacity) {
+            const int new_capacity = job->capacity ? 2 * job->capacity : DEFAULT_CAPACITY;
+            struct federated_match *matches = realloc(job->matches, new_capacity * sizeof(struct federated_match));
+            if (!matches)
+                return NULL;
+            job->matches = matches;
+            job->capacity = new_capacity;
+        }
+        job->matches[job->count++] = (struct federated_match) {
+            job->vault_index, slot, score, frecency_score(entry, job->now), entry->name};
+    }
+    return NULL;
+}
+
+
+/*
+ * Order matches by descending score, equally good ones by descending frecency, then by name and
+ * by the order of the vaults
+ */
+static int compare_matches(const void *a, const void *b) {
+    const struct federated_match *first = a;
+    const struct federated_match *second = b;
+    if (first->score != second->score)
+        return first->score > second->score ? -1 : 1;
+    if (first->frecency != second->frecency)
+        return first->frecency > second->frecency ? -1 : 1;
+    const int by_name = strcmp(first->name, second->name);
+    if (by_name != 0)
+        return by_name;
+    if (first->vault != second->vault)
+        return first->vault < second->vault ? -1 : 1;
+    return first->slot < second->slot ? -1 : first->slot > second->slot;
+}
+
+
+/*
+ * Search all unlocked vaults of the federation at once, each on a thread of its own, and merge
+ * their matches into one ranked list
+ *
+ * param const struct federation* federation: The federation
+ * param const char* term: The search term, matched against name, username, folder and tags ignoring case
+ * param bool exact: Only return entries whose name is exactly the term
+ * param int* num_matches: Receives the number of matches
+ * return struct federated_match*: The matches best first, to be freed by the caller, NULL if memory ran out
+ */
+struct federated_match *search_federation(
+    const struct federation *federation,
+    const char *term,
+    const bool exact,
+    int *num_matches) {
+    *num_matches = 0;
+    struct search_job jobs[MAX_FEDERATED_VAULTS] = {0};
+    const long long now = (long long) time(NULL);
+    for (int i = 0; i < federation->num_vaults; i++) {
+        jobs[i].vault = &federation->vaults[i];
+        jobs[i].vault_index = i;
+        jobs[i].term = term;
+        jobs[i].exact = exact;
+        jobs[i].now = now;
+    }
+    if (*term)
+        run_jobs(search_vault_job, jobs, sizeof(struct search_job), federation->num_vaults);
+
+    size_t total = 0;
+    for (int i = 0; i < federation->num_vaults; i++)
+        total += jobs[i].count;
+    struct federated_match *matches = malloc((total > 0 ? total : 1) * sizeof(struct federated_match));
+    for (int i = 0; i < federation->num_vaults; i++) {
+        if (matches && jobs[i].count > 0) {
+            memcpy(matches + *num_matches, jobs[i].matches, jobs[i].count * sizeof(struct federated_match));
+            *num_matches += jobs[i].count;
+        }
+        free(jobs[i].matches);
+    }
+    if (matches)
+        qsort(matches, *num_matches, sizeof(struct federated_match), compare_matches);
+    return matches;
+}
+
+
+/*
+ * Free all entries and vault keys of the federation
+ *
+ * param struct federation* federation: The federation
+ */
+void close_federation(struct federation *federation) {
+    for (int i = 0; i < federation->num_vaults; i++) {
+        struct federated_vault *vault = &federation->vaults[i];
+        free_passwords(vault->passwords, vault->num_passwords);
+        free(vault->passwords);
+        secure_free(vault->vault_key);
+    }
+    free(federation->vaults);
+    federation->vaults = NULL;
+    federation->num_vaults = 0;
+}
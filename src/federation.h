@@ -0,0 +1,64 @@
+#ifndef FEDERATION_H
+#define FEDERATION_H
+
+#include <stdbool.h>
+#include "crypto.h"
+#include "password.h"
+
+// Vault opened when no path is given, overridable with C_PASS_VAULT or --vault
+#define DEFAULT_VAULT_FILE "c_pass.bin"
+#define VAULT_ENVIRONMENT_VARIABLE "C_PASS_VAULT"
+// Vaults searched by search and get without --vault, separated like the entries of PATH
+#define VAULTS_ENVIRONMENT_VARIABLE "C_PASS_VAULTS"
+#ifdef _WIN32
+#define VAULT_LIST_SEPARATOR ';'
+#else
+#define VAULT_LIST_SEPARATOR ':'
+#endif
+// Every vault is unlocked and searched on a thread of its own
+#define MAX_FEDERATED_VAULTS 64
+
+// Match scores of search_federation, higher ranks first, equal scores by frecency
+#define MATCH_EXACT_NAME 100
+#define MATCH_NAME_PREFIX 75
+#define MATCH_NAME_WORD 50
+#define MATCH_NAME 40
+#define MATCH_USERNAME 20
+#define MATCH_FOLDER_OR_TAG 10
+
+// One vault of a federation, each with its own master password
+struct federated_vault {
+    const char *path;
+    struct vault_key *vault_key;  // On the secure heap, owned by the vault
+    struct password **passwords;
+    int num_passwords;
+    bool unlocked;                // false if the password was wrong or the file is damaged or missing
+    double unlock_ms;             // Time taken to decrypt and parse the vault
+};
+
+struct federation {
+    struct federated_vault *vaults;
+    int num_vaults;
+};
+
+// An entry found by search_federation
+struct federated_match {
+    int vault;
+    int slot;
+    int score;
+    double frecency;  // Breaks ties between equal scores, see frecency_score
+    const char *name; // Name of the entry, valid while the federation is open
+};
+
+const char *default_vault_path(void);
+int split_vault_list(char *list, const char **paths, int max_paths);
+bool open_federation(struct federation *federation, const char **paths, int num_paths);
+void unlock_federation(struct federation *federation);
+struct federated_match *search_federation(
+    const struct federation *federation,
+    const char *term,
+    bool exact,
+    int *num_matches);
+void close_federation(struct federation *federation);
+
+#endif //FEDERATION_H
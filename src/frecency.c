@@ -0,0 +1,293 @@
+#include "frecency.h"
+#include <openssl/crypto.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crypto.h"
+#include "secure_heap.h"
+#include "util.h"
+#include "vault_store.h"
+
+// Longest line of the access file: count, time and key with separators
+#define ACCESS_LINE_SIZE 64
+
+// Access statistics of one entry as stored in the access file
+struct access_record {
+    uint64_t key;
+    unsigned int count;
+    long long last_access;
+};
+
+// Candidate of the top-K heap
+struct ranked_slot {
+    double score;
+    int slot;
+};
+
+
+/*
+ * Count one access of an entry
+ *
+ * param struct password* entry: The entry whose password was shown
+ */
+void record_access(struct password *entry) {
+    entry->access_count++;
+    entry->last_access = (long long) time(NULL);
+}
+
+
+/*
+ * Weigh the accesses of an entry by their age: every access counts fully when it happened and
+ * half as much after each FRECENCY_HALF_LIFE, so both frequent and recent use rank high
+ *
+ * param const struct password* entry: The entry
+ * param long long now: The current Unix time
+ * return double: The score, 0 for entries that were never accessed
+ */
+double frecency_score(const struct password *entry, const long long now) {
+    if (entry->access_count == 0)
+        return 0;
+    const double age = now > entry->last_access ? (double) (now - entry->last_access) : 0;
+    return entry->access_count * exp2(-age / FRECENCY_HALF_LIFE);
+}
+
+
+/*
+ * Key of an entry in the access file. Names and usernames are not stored there
+ *
+ * param const struct password* entry: The entry
+ * return uint64_t: Hash of name and username
+ */
+static uint64_t access_key(const struct password *entry) {
+    return hash_text(hash_text(HASH_SEED, entry->name), entry->username);
+}
+
+
+static int compare_records(const void *a, const void *b) {
+    const uint64_t first = ((const struct access_record *) a)->key;
+    const uint64_t second = ((const struct access_record *) b)->key;
+    return first < second ? -1 : first > second;
+}
+
+
+/*
+ * Get the path of the access file of a vault
+ *
+ * return char*: The path that has to be freed, NULL if memory ran out
+ */
+static char *access_file_path(const char *vault_path) {
+    const size_t length = strlen(vault_path);
+    char *path = malloc(length + sizeof(ACCESS_FILE_SUFFIX));
+    if (path) {
+        memcpy(path, vault_path, length);
+        memcpy(path + length, ACCESS_FILE_SUFFIX, sizeof(ACCESS_FILE_SUFFIX));
+    }
+    return path;
+}
+
+
+/*
+ * Read the access file of a vault into the loaded entries. Entries the file does not know keep
+ * their counts, records of entries that no longer exist are ignored
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key, the key of the access file is derived from it
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return bool: true if there is no access file or it was read, false if it is damaged
+ */
+bool load_access_stats(const char *vault_path, const struct vault_key *vault_key, struct password **passwords, const int num_passwords) {
+    char *path = access_file_path(vault_path);
+    if (!path)
+        return false;
+    char *cleartext = NULL;
+    struct vault_key file_key;
+    const bool exists = file_exists(path);
+    const bool decrypted = exists && derive_file_key(vault_key, ACCESS_KEY_PURPOSE, &file_key) &&
+        decrypt_file(path, &cleartext, &file_key, NULL);
+    OPENSSL_cleanse(&file_key, sizeof(file_key));
+    free(path);
+    if (!exists)
+        return true;
+    if (!decrypted)
+        return false;
+
+    const size_t header_length = strlen(ACCESS_FILE_HEADER);
+    bool ok = strncmp(cleartext, ACCESS_FILE_HEADER, header_length) == 0 && cleartext[header_length] == '\n';
+    struct access_record *records = NULL;
+    size_t num_records = 0;
+    size_t capacity = 0;
+    for (const char *line = cleartext + header_length + 1; ok && *line; ) {
+        struct access_record record;
+        unsigned long long key;
+        ok = sscanf(line, "%u %lld %llx", &record.count, &record.last_access, &key) == 3;
+        record.key = key;
+        if (ok && num_records == capacity) {
+            capacity = capacity ? 2 * capacity : DEFAULT_CAPACITY;
+            struct access_record *grown = realloc(records, capacity * sizeof(struct access_record));
+            ok = grown != NULL;
+            if (grown)
+                records = grown;
+        }
+        if (ok)
+            records[num_records++] = record;
+        const char *next_line = strchr(line, '\n');
+        line = next_line ? next_line + 1 : line + strlen(line);
+    }
+    secure_free(cleartext);
+
+    if (ok && num_records > 0) {
+        qsort(records, num_records, sizeof(struct access_record), compare_records);
+        for (int i = 0; i < num_passwords; i++) {
+            if (!passwords[i])
+                continue;
+            const struct access_record wanted = {access_key(passwords[i]), 0, 0};
+            const struct access_record *found =
+                bsearch(&wanted, records, num_records, sizeof(struct access_record), compare_records);
+            if (found) {
+                passwords[i]->access_count = found->count;
+                passwords[i]->last_access = found->last_access;
+            }
+        }
+    }
+    free(records);
+    return ok;
+}
+
+
+/*
+ * Serialize the counts of all accessed entries for the access file. Only entries that were shown at
+ * least once are stored, so the file stays small
+ *
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return char*: The access file contents on the secure heap, NULL if memory ran out
+ */
+char *serialize_access_stats(struct password **passwords, const int num_passwords) {
+    size_t num_accessed = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] && passwords[i]->access_count > 0)
+            num_accessed++;
+    }
+    const size_t size = sizeof(ACCESS_FILE_HEADER) + 1 + num_accessed * ACCESS_LINE_SIZE;
+    char *cleartext = secure_malloc(size);
+    if (!cleartext)
+        return NULL;
+    size_t length = (size_t) snprintf(cleartext, size, "%s\n", ACCESS_FILE_HEADER);
+    for (int i = 0; i < num_passwords; i++) {
+        const struct password *entry = passwords[i];
+        if (!entry || entry->access_count == 0)
+            continue;
+        length += (size_t) snprintf(cleartext + length, size - length, "%u %lld %016llx\n",
+            entry->access_count, entry->last_access, (unsigned long long) access_key(entry));
+    }
+    return cleartext;
+}
+
+
+/*
+ * Encrypt serialized counts into the access file of a vault, the vault itself is not rewritten
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key, the key of the access file is derived from it
+ * param char** cleartext: Pointer to the counts from serialize_access_stats
+ * return bool: true if the file was written
+ */
+bool write_access_stats(const char *vault_path, const struct vault_key *vault_key, char **cleartext) {
+    char *path = access_file_path(vault_path);
+    struct vault_key file_key;
+    const bool ok = path && derive_file_key(vault_key, ACCESS_KEY_PURPOSE, &file_key) &&
+        write_vault(path, cleartext, &file_key, 0);
+    OPENSSL_cleanse(&file_key, sizeof(file_key));
+    free(path);
+    return ok;
+}
+
+
+/*
+ * Write the counts of all accessed entries to the access file of a vault
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key, the key of the access file is derived from it
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return bool: true if the file was written
+ */
+bool save_access_stats(const char *vault_path, const struct vault_key *vault_key, struct password **passwords, const int num_passwords) {
+    char *cleartext = serialize_access_stats(passwords, num_passwords);
+    const bool ok = cleartext && write_access_stats(vault_path, vault_key, &cleartext);
+    secure_free(cleartext);
+    return ok;
+}
+
+
+/*
+ * Restore the min-heap property downwards from a position of the top-K heap
+ */
+static void sift_down(struct ranked_slot *heap, const int size, int position) {
+    for (;;) {
+        int smallest = position;
+        const int left = 2 * position + 1;
+        const int right = left + 1;
+        if (left < size && heap[left].score < heap[smallest].score)
+            smallest = left;
+        if (right < size && heap[right].score < heap[smallest].score)
+            smallest = right;
+        if (smallest == position)
+            return;
+        const struct ranked_slot swap = heap[position];
+        heap[position] = heap[smallest];
+        heap[smallest] = swap;
+        position = smallest;
+    }
+}
+
+
+/*
+ * Find the K accessed entries with the highest frecency in O(n log K) using a min-heap of the
+ * best K seen so far, whose root is replaced whenever a better entry comes along
+ *
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param int k: Number of entries wanted
+ * param int* slots: Receives up to k array slots, best first
+ * return int: Number of slots stored, fewer than k if fewer entries were ever accessed, -1 if memory ran out
+ */
+int top_frecent_passwords(struct password **passwords, const int num_passwords, const int k, int *slots) {
+    if (k <= 0)
+        return 0;
+    struct ranked_slot *heap = malloc((size_t) k * sizeof(struct ranked_slot));
+    if (!heap)
+        return -1;
+    const long long now = (long long) time(NULL);
+    int size = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (!passwords[i] || passwords[i]->access_count == 0)
+            continue;
+        const double score = frecency_score(passwords[i], now);
+        if (size < k) {
+            // Sift the new candidate up
+            int position = size++;
+            while (position > 0 && heap[(position - 1) / 2].score > score) {
+                heap[position] = heap[(position - 1) / 2];
+                position = (position - 1) / 2;
+            }
+            heap[position] = (struct ranked_slot) {score, i};
+        } else if (score > heap[0].score) {
+            heap[0] = (struct ranked_slot) {score, i};
+            sift_down(heap, size, 0);
+        }
+    }
+    // Popping the minimum repeatedly fills the result from the back
+    const int count = size;
+    while (size > 0) {
+        slots[size - 1] = heap[0].slot;
+        heap[0] = heap[--size];
+        sift_down(heap, size, 0);
+    }
+    free(heap);
+    return count;
+}
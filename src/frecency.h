@@ -0,0 +1,26 @@
+#ifndef FRECENCY_H
+#define FRECENCY_H
+
+#include <stdbool.h>
+#include "crypto.h"
+#include "password.h"
+
+// Access counts live in "<vault>.access", encrypted like the vault, so showing a password does not rewrite the vault
+#define ACCESS_FILE_SUFFIX ".access"
+#define ACCESS_FILE_HEADER "C-Pass access 1"
+// The access file is encrypted with a key derived from the vault key for this purpose
+#define ACCESS_KEY_PURPOSE "cpass access"
+// The weight of an access halves after this many seconds
+#define FRECENCY_HALF_LIFE (14 * 24 * 60 * 60)
+// Entries offered first by the get menu and listed by the recent command without --top
+#define DEFAULT_TOP_ENTRIES 5
+
+void record_access(struct password *entry);
+double frecency_score(const struct password *entry, long long now);
+bool load_access_stats(const char *vault_path, const struct vault_key *vault_key, struct password **passwords, int num_passwords);
+char *serialize_access_stats(struct password **passwords, int num_passwords);
+bool write_access_stats(const char *vault_path, const struct vault_key *vault_key, char **cleartext);
+bool save_access_stats(const char *vault_path, const struct vault_key *vault_key, struct password **passwords, int num_passwords);
+int top_frecent_passwords(struct password **passwords, int num_passwords, int k, int *slots);
+
+#endif //FRECENCY_H
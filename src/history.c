@@ -0,0 +1,590 @@
+#include "history.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "secure_heap.h"
+#include "util.h"
+#include "vault_store.h"
+
+#define HISTORY_SALT_SIZE 16
+#define HISTORY_KEY_SIZE 32
+#define HISTORY_NONCE_SIZE 12
+#define HISTORY_TAG_SIZE 16
+#define HISTORY_MAGIC_SIZE (sizeof(HISTORY_MAGIC) - 1)
+#define HISTORY_HEADER_SIZE (HISTORY_MAGIC_SIZE + HISTORY_SALT_SIZE)
+// A block is its plaintext length (4 bytes), the nonce, the ciphertext and the tag
+#define BLOCK_OVERHEAD (4 + HISTORY_NONCE_SIZE + HISTORY_TAG_SIZE)
+// Longest record without the rest of the old password: key, check and four varints
+#define MAX_RECORD_HEADER (8 + 4 + 4 * 10)
+
+// Appends the replaced passwords of one session as a single encrypted block
+struct password_history {
+    char *path;
+    unsigned char header[HISTORY_HEADER_SIZE];
+    unsigned char *key;     // HISTORY_KEY_SIZE bytes on the secure heap
+    unsigned char *pending; // Records not written yet, on the secure heap
+    size_t length;
+    size_t capacity;
+};
+
+// A replaced password, delta encoded against the password that replaced it. Stored as the key of
+// the entry (8 bytes), the time (varint), a check of the newer password (4 bytes), the lengths of
+// the prefix and suffix both share and of the differing rest (varints) followed by the rest
+struct history_record {
+    uint64_t key;
+    long long replaced;
+    uint32_t check;
+    uint64_t prefix;
+    uint64_t suffix;
+    const unsigned char *middle;
+    uint64_t middle_length;
+    const unsigned char *start; // The whole record in the plaintext
+    size_t length;
+    size_t position;            // Position in the file, records of an entry keep this order
+    bool dropped;
+};
+
+
+/*
+ * Get the number of replaced passwords kept per entry
+ *
+ * return int: The value of C_PASS_HISTORY_DEPTH if set, DEFAULT_HISTORY_DEPTH otherwise, 0 if disabled
+ */
+int history_depth(void) {
+    const char *value = getenv(HISTORY_DEPTH_VARIABLE);
+    if (!value || !*value)
+        return DEFAULT_HISTORY_DEPTH;
+    const int depth = atoi(value);
+    if (depth < 0)
+        return 0;
+    return depth > MAX_HISTORY_DEPTH ? MAX_HISTORY_DEPTH : depth;
+}
+
+
+/*
+ * Get the path of the history file of a vault
+ *
+ * return char*: The path that has to be freed, NULL if memory ran out
+ */
+static char *history_file_path(const char *vault_path) {
+    const size_t length = strlen(vault_path);
+    char *path = malloc(length + sizeof(HISTORY_FILE_SUFFIX));
+    if (path) {
+        memcpy(path, vault_path, length);
+        memcpy(path + length, HISTORY_FILE_SUFFIX, sizeof(HISTORY_FILE_SUFFIX));
+    }
+    return path;
+}
+
+
+/*
+ * Key of an entry in the history, the name survives edits of the username
+ */
+static uint64_t entry_key(const struct password *entry) {
+    return hash_text(HASH_SEED, entry->name);
+}
+
+
+/*
+ * Short hash of a password, tells whether a record was made against it
+ */
+static uint32_t password_check(const char *password) {
+    return (uint32_t) (hash_text(HASH_SEED, password) >> 32);
+}
+
+
+static size_t put_varint(unsigned char *out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char) value;
+    return length;
+}
+
+
+static bool get_varint(const unsigned char **cursor, const unsigned char *end, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+        const unsigned char byte = *(*cursor)++;
+        *value |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+
+static void put_le(unsigned char *out, uint64_t value, const int bytes) {
+    for (int i = 0; i < bytes; i++, value >>= 8)
+        out[i] = (unsigned char) value;
+}
+
+
+static uint64_t get_le(const unsigned char *in, const int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        value = value << 8 | in[i];
+    return value;
+}
+
+
+/*
+ * Read a whole file into memory
+ *
+ * param size_t* size: Receives the file size
+ * return unsigned char*: The contents that have to be freed, NULL if the file cannot be read
+ */
+static unsigned char *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    unsigned char *data = NULL;
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+        data = malloc(length > 0 ? (size_t) length : 1);
+    if (data && fread(data, 1, (size_t) length, file) != (size_t) length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t) length : 0;
+    return data;
+}
+
+
+static bool derive_history_key(const struct vault_key *vault_key, const unsigned char *header, unsigned char *key) {
+    return derive_subkey(vault_key, HISTORY_KEY_PURPOSE, header + HISTORY_MAGIC_SIZE, HISTORY_SALT_SIZE,
+        key, HISTORY_KEY_SIZE);
+}
+
+
+/*
+ * Encrypt a block of records and append it to a history file. The header and the position of the
+ * block are authenticated too, so blocks cannot be moved between files or reordered
+ *
+ * param FILE* file: The history file, positioned at its end
+ * param long position: Offset of the block in the file
+ * return bool: false if the block could not be written
+ */
+static bool write_block(
+    FILE *file,
+    const unsigned char *key,
+    const unsigned char *header,
+    const long position,
+    const unsigned char *plain,
+    const size_t length) {
+    unsigned char aad[HISTORY_HEADER_SIZE + 8];
+    memcpy(aad, header, HISTORY_HEADER_SIZE);
+    put_le(aad + HISTORY_HEADER_SIZE, (uint64_t) position, 8);
+    unsigned char *sealed = malloc(length + BLOCK_OVERHEAD);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_length = 0, final_length = 0;
+    unsigned char *nonce = sealed + 4;
+    unsigned char *ciphertext = nonce + HISTORY_NONCE_SIZE;
+    bool ok = sealed && ctx && length <= UINT32_MAX &&
+        RAND_bytes(nonce, HISTORY_NONCE_SIZE) == 1 &&
+        EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce) == 1 &&
+        EVP_EncryptUpdate(ctx, NULL, &out_length, aad, sizeof(aad)) == 1 &&
+        EVP_EncryptUpdate(ctx, ciphertext, &out_length, plain, (int) length) == 1 &&
+        EVP_EncryptFinal_ex(ctx, ciphertext + out_length, &final_length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, HISTORY_TAG_SIZE, ciphertext + length) == 1;
+    if (ok) {
+        put_le(sealed, length, 4);
+        ok = fwrite(sealed, 1, length + BLOCK_OVERHEAD, file) == length + BLOCK_OVERHEAD;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    free(sealed);
+    return ok;
+}
+
+
+/*
+ * Decrypt all blocks of a history file
+ *
+ * param const unsigned char* file: The file contents starting with the header
+ * param size_t size: The file size
+ * param const unsigned char* key: The history key
+ * param size_t* length: Receives the length of the plaintext
+ * return unsigned char*: The records of all blocks on the secure heap, NULL if the file is damaged
+ */
+static unsigned char *open_blocks(const unsigned char *file, const size_t size, const unsigned char *key, size_t *length) {
+    unsigned char *plain = secure_malloc(size > 0 ? size : 1);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    bool ok = plain && ctx;
+    *length = 0;
+    size_t position = HISTORY_HEADER_SIZE;
+    while (ok && position < size) {
+        ok = size - position >= BLOCK_OVERHEAD && get_le(file + position, 4) <= size - position - BLOCK_OVERHEAD;
+        if (!ok)
+            break;
+        const size_t block_length = get_le(file + position, 4);
+        unsigned char aad[HISTORY_HEADER_SIZE + 8];
+        memcpy(aad, file, HISTORY_HEADER_SIZE);
+        put_le(aad + HISTORY_HEADER_SIZE, position, 8);
+        const unsigned char *nonce = file + position + 4;
+        const unsigned char *ciphertext = nonce + HISTORY_NONCE_SIZE;
+        int out_length = 0, final_length = 0;
+        ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, nonce) == 1 &&
+            EVP_DecryptUpdate(ctx, NULL, &out_length, aad, sizeof(aad)) == 1 &&
+            EVP_DecryptUpdate(ctx, plain + *length, &out_length, ciphertext, (int) block_length) == 1 &&
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, HISTORY_TAG_SIZE,
+                (void *) (ciphertext + block_length)) == 1 &&
+            EVP_DecryptFinal_ex(ctx, plain + *length + out_length, &final_length) == 1;
+        *length += block_length;
+        position += block_length + BLOCK_OVERHEAD;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) {
+        secure_free(plain);
+        return NULL;
+    }
+    return plain;
+}
+
+
+/*
+ * Open the history of a vault for recording replaced passwords. The history file is created
+ * with a new salt if the vault has none yet. Nothing is decrypted, records are only appended
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * return struct password_history*: The history or NULL if it is disabled or cannot be opened
+ */
+struct password_history *open_password_history(const char *vault_path, const struct vault_key *vault_key) {
+    if (history_depth() == 0)
+        return NULL;
+    struct password_history *history = calloc(1, sizeof(struct password_history));
+    if (!history)
+        return NULL;
+    history->path = history_file_path(vault_path);
+    history->key = secure_malloc(HISTORY_KEY_SIZE);
+    struct vault_file_lock *lock = history->path && history->key ? lock_vault_file(history->path) : NULL;
+    bool ok = lock != NULL;
+    if (ok) {
+        // Every process has to use the salt of the first one, so the header is written under the lock
+        FILE *file = fopen(history->path, "rb");
+        if (file) {
+            ok = fread(history->header, 1, HISTORY_HEADER_SIZE, file) == HISTORY_HEADER_SIZE &&
+                memcmp(history->header, HISTORY_MAGIC, HISTORY_MAGIC_SIZE) == 0;
+            fclose(file);
+        } else {
+            memcpy(history->header, HISTORY_MAGIC, HISTORY_MAGIC_SIZE);
+            ok = RAND_bytes(history->header + HISTORY_MAGIC_SIZE, HISTORY_SALT_SIZE) == 1 &&
+                (file = fopen(history->path, "wb")) != NULL;
+            if (file) {
+                ok = fwrite(history->header, 1, HISTORY_HEADER_SIZE, file) == HISTORY_HEADER_SIZE;
+                ok = fclose(file) == 0 && ok;
+            }
+        }
+        unlock_vault_file(lock);
+    }
+    if (!ok || !derive_history_key(vault_key, history->header, history->key)) {
+        free(history->path);
+        secure_free(history->key);
+        free(history);
+        return NULL;
+    }
+    return history;
+}
+
+
+/*
+ * Remember the password an entry had before it was changed. The record is written by
+ * close_password_history together with all other changes of the session
+ *
+ * param struct password_history* history: The history, NULL records nothing
+ * param const struct password* entry: The entry, already holding its new password
+ * param const char* old_password: The replaced password
+ * return bool: false if memory ran out
+ */
+bool record_password_change(struct password_history *history, const struct password *entry, const char *old_password) {
+    if (!history || strcmp(old_password, entry->password) == 0)
+        return true;
+    const char *new_password = entry->password;
+    const size_t old_length = strlen(old_password);
+    const size_t new_length = strlen(new_password);
+    size_t prefix = 0;
+    while (prefix < old_length && prefix < new_length && old_password[prefix] == new_password[prefix])
+        prefix++;
+    size_t suffix = 0;
+    while (suffix < old_length - prefix && suffix < new_length - prefix &&
+        old_password[old_length - 1 - suffix] == new_password[new_length - 1 - suffix])
+        suffix++;
+    const size_t middle_length = old_length - prefix - suffix;
+
+    if (history->capacity - history->length < MAX_RECORD_HEADER + middle_length) {
+        size_t capacity = history->capacity ? history->capacity : 256;
+        while (capacity - history->length < MAX_RECORD_HEADER + middle_length)
+            capacity *= 2;
+        unsigned char *pending = secure_realloc(history->pending, capacity);
+        if (!pending)
+            return false;
+        history->pending = pending;
+        history->capacity = capacity;
+    }
+    unsigned char *out = history->pending + history->length;
+    put_le(out, entry_key(entry), 8);
+    out += 8;
+    out += put_varint(out, (uint64_t) time(NULL));
+    put_le(out, password_check(new_password), 4);
+    out += 4;
+    out += put_varint(out, prefix);
+    out += put_varint(out, suffix);
+    out += put_varint(out, middle_length);
+    memcpy(out, old_password + prefix, middle_length);
+    history->length = (size_t) (out + middle_length - history->pending);
+    return true;
+}
+
+
+/*
+ * Append the recorded changes to the history file as one block and free the history
+ *
+ * param struct password_history* history: The history, may be NULL
+ * return bool: false if the changes could not be written
+ */
+bool close_password_history(struct password_history *history) {
+    if (!history)
+        return true;
+    bool ok = true;
+    if (history->length > 0) {
+        struct vault_file_lock *lock = lock_vault_file(history->path);
+        FILE *file = lock ? fopen(history->path, "ab") : NULL;
+        long position = -1;
+        ok = file && fseek(file, 0, SEEK_END) == 0 && (position = ftell(file)) >= (long) HISTORY_HEADER_SIZE &&
+            write_block(file, history->key, history->header, position, history->pending, history->length);
+        if (file)
+            ok = fclose(file) == 0 && ok;
+        unlock_vault_file(lock);
+    }
+    secure_free(history->pending);
+    secure_free(history->key);
+    free(history->path);
+    free(history);
+    return ok;
+}
+
+
+/*
+ * Parse the next record of the decrypted history
+ *
+ * return bool: false if the plaintext ends within the record
+ */
+static bool parse_record(const unsigned char **cursor, const unsigned char *end, struct history_record *record) {
+    uint64_t replaced;
+    record->start = *cursor;
+    if (end - *cursor < 8)
+        return false;
+    record->key = get_le(*cursor, 8);
+    *cursor += 8;
+    if (!get_varint(cursor, end, &replaced) || end - *cursor < 4)
+        return false;
+    record->replaced = (long long) replaced;
+    record->check = (uint32_t) get_le(*cursor, 4);
+    *cursor += 4;
+    if (!get_varint(cursor, end, &record->prefix) || !get_varint(cursor, end, &record->suffix) ||
+        !get_varint(cursor, end, &record->middle_length) || record->middle_length > (uint64_t) (end - *cursor))
+        return false;
+    record->middle = *cursor;
+    *cursor += record->middle_length;
+    record->length = (size_t) (*cursor - record->start);
+    record->dropped = false;
+    return true;
+}
+
+
+static int compare_records(const void *a, const void *b) {
+    const struct history_record *first = a;
+    const struct history_record *second = b;
+    if (first->key != second->key)
+        return first->key < second->key ? -1 : 1;
+    return first->position < second->position ? -1 : first->position > second->position;
+}
+
+
+/*
+ * Drop all but the newest depth records of every entry and rewrite the history file as a single
+ * block if anything was dropped. The records must be sorted by entry and position
+ *
+ * return bool: false if the file could not be rewritten
+ */
+static bool compact_history(
+    const char *path,
+    const unsigned char *header,
+    const unsigned char *key,
+    struct history_record *records,
+    const size_t num_records,
+    const int depth) {
+    size_t kept_length = 0;
+    size_t num_dropped = 0;
+    for (size_t group = 0; group < num_records; ) {
+        size_t end = group;
+        while (end < num_records && records[end].key == records[group].key)
+            end++;
+        for (size_t i = group; i < end; i++) {
+            records[i].dropped = end - i > (size_t) depth;
+            if (records[i].dropped)
+                num_dropped++;
+            else
+                kept_length += records[i].length;
+        }
+        group = end;
+    }
+    if (num_dropped == 0)
+        return true;
+
+    unsigned char *plain = secure_malloc(kept_length > 0 ? kept_length : 1);
+    const size_t temporary_length = strlen(path);
+    char *temporary_path = malloc(temporary_length + sizeof(".tmp"));
+    FILE *file = NULL;
+    bool ok = plain && temporary_path;
+    if (ok) {
+        size_t length = 0;
+        for (size_t i = 0; i < num_records; i++) {
+            if (records[i].dropped)
+                continue;
+            memcpy(plain + length, records[i].start, records[i].length);
+            length += records[i].length;
+        }
+        memcpy(temporary_path, path, temporary_length);
+        memcpy(temporary_path + temporary_length, ".tmp", sizeof(".tmp"));
+        file = fopen(temporary_path, "wb");
+        ok = file && fwrite(header, 1, HISTORY_HEADER_SIZE, file) == HISTORY_HEADER_SIZE &&
+            (length == 0 || write_block(file, key, header, HISTORY_HEADER_SIZE, plain, length));
+        if (file)
+            ok = fclose(file) == 0 && ok;
+        ok = ok && replace_file(temporary_path, path);
+        if (!ok && file)
+            remove(temporary_path);
+    }
+    secure_free(plain);
+    free(temporary_path);
+    return ok;
+}
+
+
+/*
+ * Read the former passwords of an entry, newest first. Each record is decoded against the
+ * password that replaced it, starting with the current one. Records whose check does not match
+ * describe a change that never reached the vault (or a password changed without history) and are skipped.
+ * Reading also trims the history of all entries to the configured depth.
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * param const struct password* entry: The entry
+ * param struct history_item** items: Receives the former passwords, free with free_history_items
+ * return int: Number of items, -1 if the history cannot be read
+ */
+int read_password_history(
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    const struct password *entry,
+    struct history_item **items) {
+    *items = NULL;
+    char *path = history_file_path(vault_path);
+    if (!path)
+        return -1;
+    if (!file_exists(path)) {
+        free(path);
+        return 0;
+    }
+    struct vault_file_lock *lock = lock_vault_file(path);
+    size_t size = 0;
+    unsigned char *file = lock ? read_file(path, &size) : NULL;
+    unsigned char *key = secure_malloc(HISTORY_KEY_SIZE);
+    size_t plain_length = 0;
+    unsigned char *plain = NULL;
+    bool ok = file && key && size >= HISTORY_HEADER_SIZE && memcmp(file, HISTORY_MAGIC, HISTORY_MAGIC_SIZE) == 0 &&
+        derive_history_key(vault_key, file, key) &&
+        (plain = open_blocks(file, size, key, &plain_length)) != NULL;
+
+    struct history_record *records = NULL;
+    size_t num_records = 0;
+    size_t capacity = 0;
+    for (const unsigned char *cursor = plain, *end = plain + plain_length; ok && cursor < end; ) {
+        if (num_records == capacity) {
+            capacity = capacity ? 2 * capacity : DEFAULT_CAPACITY;
+            struct history_record *grown = realloc(records, capacity * sizeof(struct history_record));
+            ok = grown != NULL;
+            if (!ok)
+                break;
+            records = grown;
+        }
+        ok = parse_record(&cursor, end, &records[num_records]);
+        records[num_records].position = num_records;
+        num_records++;
+    }
+    const int depth = history_depth();
+    if (ok) {
+        qsort(records, num_records, sizeof(struct history_record), compare_records);
+        // A failed compaction keeps the longer file, the history is still complete
+        if (depth > 0)
+            compact_history(path, file, key, records, num_records, depth);
+    }
+    unlock_vault_file(lock);
+
+    // The records of the entry are adjacent, the newest last
+    int count = 0;
+    if (ok) {
+        const uint64_t wanted = entry_key(entry);
+        size_t first = 0;
+        while (first < num_records && records[first].key < wanted)
+            first++;
+        size_t last = first;
+        while (last < num_records && records[last].key == wanted)
+            last++;
+        *items = calloc(last - first > 0 ? last - first : 1, sizeof(struct history_item));
+        ok = *items != NULL;
+        const char *base = entry->password;
+        for (size_t i = last; ok && i > first && (depth == 0 || count < depth); i--) {
+            const struct history_record *record = &records[i - 1];
+            const size_t base_length = strlen(base);
+            if (record->dropped || record->check != password_check(base) ||
+                record->prefix + record->suffix > base_length)
+                continue;
+            const size_t length = record->prefix + record->middle_length + record->suffix;
+            char *password = secure_malloc(length + 1);
+            ok = password != NULL;
+            if (!ok)
+                break;
+            memcpy(password, base, record->prefix);
+            memcpy(password + record->prefix, record->middle, record->middle_length);
+            memcpy(password + record->prefix + record->middle_length, base + base_length - record->suffix,
+                record->suffix);
+            password[length] = '\0';
+            (*items)[count++] = (struct history_item) {record->replaced, password};
+            base = password;
+        }
+    }
+    free(records);
+    secure_free(plain);
+    secure_free(key);
+    free(file);
+    free(path);
+    if (!ok) {
+        free_history_items(*items, count);
+        *items = NULL;
+        return -1;
+    }
+    return count;
+}
+
+
+/*
+ * Wipe and free the items returned by read_password_history
+ *
+ * param struct history_item* items: The items, may be NULL
+ * param int count: Number of items
+ */
+void free_history_items(struct history_item *items, const int count) {
+    for (int i = 0; i < count && items; i++)
+        secure_free(items[i].password);
+    free(items);
+}
@@ -0,0 +1,37 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include "crypto.h"
+#include "password.h"
+
+// Replaced passwords are appended to "<vault>.history", which is only decrypted when the history is shown
+#define HISTORY_FILE_SUFFIX ".history"
+#define HISTORY_MAGIC "CPHIST02"
+// Number of replaced passwords kept per entry, overridable with C_PASS_HISTORY_DEPTH (0 disables the history)
+#define DEFAULT_HISTORY_DEPTH 10
+#define MAX_HISTORY_DEPTH 1000
+#define HISTORY_DEPTH_VARIABLE "C_PASS_HISTORY_DEPTH"
+// The history key is derived from the vault key and the salt in the file header
+#define HISTORY_KEY_PURPOSE "cpass history"
+
+struct password_history;
+
+// A former password of an entry
+struct history_item {
+    long long replaced; // Unix time the password was replaced
+    char *password;     // On the secure heap
+};
+
+int history_depth(void);
+struct password_history *open_password_history(const char *vault_path, const struct vault_key *vault_key);
+bool record_password_change(struct password_history *history, const struct password *entry, const char *old_password);
+bool close_password_history(struct password_history *history);
+int read_password_history(
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    const struct password *entry,
+    struct history_item **items);
+void free_history_items(struct history_item *items, int count);
+
+#endif //HISTORY_H
@@ -6,9 +6,103 @@
 #include "password.h"
 #include "util.h"
 #include "crypto.h"
+#include "secure_heap.h"
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(_WIN32)
+    #include <conio.h>
+    #include <io.h>
+#else
+    #include <termios.h>
+    #include <unistd.h>
+#endif
+
+#define DEFAULT_LENGTH 20
+
+
+void clear_console() {
+    // Nothing to clear when the output is redirected, e.g. while a trace is replayed
+#ifdef _WIN32
+    if (_isatty(_fileno(stdout)))
+        system("cls");
+#else
+    if (isatty(STDOUT_FILENO))
+        system("clear");
+#endif
+}
+
+/*
+ * Read in a password from console without displaying the plain characters
+ *
+ * return char*: The password entered by the user
+ */
+char* read_password() {
+    char *password = secure_malloc(DEFAULT_LENGTH);
+    if (!password)
+        return NULL;
+    int i = 0;
+    int ch;
+    printf("Enter password: ");
+
+#if defined(_WIN32)
+    while (true) {
+        if (i % DEFAULT_LENGTH == 0 && i > 0) {
+            char* temp = secure_realloc(password, i + DEFAULT_LENGTH);
+            if (temp == NULL) {
+                secure_free(password);
+                return NULL;
+            }
+            password = temp;
+        }
+        ch = _getch();
+        if (ch == '\r' || ch == '\n')
+            break;
+        if (ch == '\b') {
+            // Handle backspace, there is nothing to erase in front of the first character
+            if (i > 0) {
+                printf("\b \b");
+                i--;
+            }
+        } else if (ch >= ' ' && ch != 127) {
+            password[i++] = (char) ch;
+            printf("*"); // Mask character
+        }
+    }
+#else
+    struct termios oldt, newt;
+    tcgetattr(STDIN_FILENO, &oldt);
+    newt = oldt;
+    newt.c_lflag &= ~ECHO;
+    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+
+    while ((ch = getchar()) != '\n' && ch != EOF) {
+        if (i % DEFAULT_LENGTH == 0 && i > 0) {
+            char* temp = secure_realloc(password, i + DEFAULT_LENGTH);
+            if (temp == NULL) {
+                secure_free(password);
+                return NULL;
+            }
+            password = temp;
+        }
+        if (ch == 127 || ch == '\b') {
+            // Handle backspace, there is nothing to erase in front of the first character
+            if (i > 0) {
+                i--;
+                printf("\b \b");
+            }
+        } else if (ch >= ' ') {
+            password[i++] = (char) ch;
+            printf("*");
+        }
+    }
+    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+#endif
+    password[i] = '\0'; // Null-terminate the password
+    printf("\n");
+    return password;
+}
+
 
 /*
  * Print the ASCII-art header of the application
@@ -53,20 +147,31 @@ char* login_dialog(const int remaining_tries, const bool first_time_user) {
  *
  * param const char* encrypted_file: The file name of the encrypted file storing the saved passwords
  * param char** decrypted_char: A pointer to a char array in which the cleartext passwords will be stored
- * return char*: The master password as character array
+ * param uint64_t* version: Receives the version of the decrypted vault, 0 for a new vault
+ * return struct vault_key*: The vault key on the secure heap, the master password itself is wiped
  */
-char* login(const char* encrypted_file, char** decrypted_char) {
+struct vault_key* login(const char* encrypted_file, char** decrypted_char, uint64_t* version) {
+    struct vault_key* key = secure_malloc(sizeof(struct vault_key));
+    if (!key)
+        exit(-99);
     if (file_exists(encrypted_file)) {
         int i = 3;
         for (; i > 0; i--) {
             char* password = login_dialog(i, false);
-            if (decrypt_file(encrypted_file, decrypted_char, password))
-                return password;
-            free(password);
+            const bool derived = password && derive_vault_key(password, key);
+            secure_free(password);
+            if (derived && decrypt_file(encrypted_file, decrypted_char, key, version))
+                return key;
         }
         if (!i)
             exit(1);
     }
-    *decrypted_char = calloc(1, sizeof(char));
-    return login_dialog(0, true);
+    *decrypted_char = secure_malloc(1);
+    *version = 0;
+    char* password = login_dialog(0, true);
+    const bool derived = password && derive_vault_key(password, key);
+    secure_free(password);
+    if (!derived)
+        exit(-99);
+    return key;
 }
@@ -6,7 +6,11 @@
 #define LOGIN_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "crypto.h"
 
-char* login(const char* encrypted_file, char** decrypted_char);
+char* read_password();
+void clear_console();
+struct vault_key* login(const char* encrypted_file, char** decrypted_char, uint64_t* version);
 
 #endif // LOGIN_H
@@ -9,42 +9,104 @@
 #include <openssl/conf.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "password.h"
 #include "util.h"
 #include "crypto.h"
 #include "login.h"
 #include "vault_menu.h"
+#include "commands.h"
+#include "breach.h"
+#include "secure_heap.h"
+#include "autosave.h"
+#include "vault_store.h"
+#include "backup.h"
+#include "federation.h"
+#include "frecency.h"
+#include "workload.h"
+#include "expiry.h"
+#include "session_cache.h"
+#ifdef C_PASS_ALLOC_STATS
+#include "alloc_stats.h"
+#endif
 
 
-int main() {
-    // Redirect stderr to NUL to suppress all error by openssl
-    freopen("NUL", "w", stderr);
+/*
+ * Tell how many passwords are due for rotation soon
+ *
+ * param const struct expiry_index* expiry: Due dates of the vault
+ * param struct autosave* saver: Merges entries of other processes into the index meanwhile, may be NULL
+ * param bool list: Also list the names of the EXPIRY_MENU_ENTRIES passwords due first
+ */
+static void print_due_passwords(const struct expiry_index *expiry, struct autosave *saver, const bool list) {
+    const long long until = (long long) time(NULL) + DEFAULT_EXPIRY_WINDOW_DAYS * SECONDS_PER_DAY;
+    struct expiry_item items[EXPIRY_MENU_ENTRIES];
+    lock_vault(saver);
+    const int due = count_expiring_passwords(expiry, until);
+    const int count = list && due > 0 ? next_expiring_passwords(expiry, until, EXPIRY_MENU_ENTRIES, items) : 0;
+    if (due > 0)
+        printf("%d password(s) are due for rotation within %d days, see the expiry command\n", due,
+            DEFAULT_EXPIRY_WINDOW_DAYS);
+    for (int i = 0; i < count; i++)
+        printf("  %s (%s)\n", items[i].entry->name, items[i].entry->username);
+    unlock_vault(saver, false);
+}
 
-    // Initialize the openssl library
-    ERR_load_crypto_strings();
-    OpenSSL_add_all_algorithms();
 
-    // Define file names
-    char** decrypted_char = malloc(sizeof(char *));
-    if (!decrypted_char) {
-        exit(-99);
+/*
+ * Tell the user when a background save failed, once until the outcome changes
+ *
+ * param const char* vault_path: Path of the vault file
+ * param struct autosave* saver: The saver, may be NULL
+ */
+static void print_save_status(const char *vault_path, struct autosave *saver) {
+    switch (take_save_status(saver)) {
+        case COMMIT_CONFLICT:
+            printf("Another process changed the same entries, your version will be saved to %s.conflict on exit\n",
+                vault_path);
+            break;
+        case COMMIT_FAILED:
+            printf("Failed to save the vault, it is retried in the background\n");
+            break;
+        default:
+            break;
     }
-    const char* encrypted_file = "c_pass.bin";
-
-    // Display login screen, get master password and decrypt the previously saved passwords
-    char* password = login(encrypted_file, decrypted_char);
-
-    // Load the previously saved requirements and passwords from decrypted file
-    int num_passwords = 0;
-    struct password_requirement* p_requirement = read_password_requirement(*decrypted_char);
-    struct password** passwords = read_passwords(*decrypted_char, &num_passwords);
+}
 
-    // Free decrypted characters
-    free(*decrypted_char);
 
+/*
+ * Run the interactive menu until the user closes C-Pass
+ *
+ * param const char* vault_path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param struct password_requirement* p_requirement: The current password requirement
+ * param const struct breach_corpus* corpus: Breach corpus new passwords are checked against, may be NULL
+ * param struct autosave* saver: Saves the changes in the background, may be NULL
+ * param struct trace_recorder* trace: Records the chosen options, may be NULL
+ * param const struct expiry_index* expiry: Due dates kept current by the listener, may be NULL
+ * param const struct password_listener* listener: Told about every edit of the menu, may be NULL
+ */
+static void run_menu(
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    struct password ***passwords,
+    int *num_passwords,
+    struct password_requirement *p_requirement,
+    const struct breach_corpus *corpus,
+    struct autosave *saver,
+    struct trace_recorder *trace,
+    const struct expiry_index *expiry,
+    const struct password_listener *listener) {
     int running = 1;
+    bool first = true;
     clear_console();
     while (running) {
+        print_save_status(vault_path, saver);
+        if (expiry)
+            print_due_passwords(expiry, saver, first);
+        first = false;
         printf("Choose a option:\n");
         printf("[1] Get a password:\n");
         printf("[2] Generate new password\n");
@@ -52,6 +114,8 @@ int main() {
         printf("[4] Edit an existing password\n");
         printf("[5] Delete existing password\n");
         printf("[6] Edit password requirements\n");
+        printf("[7] Audit passwords\n");
+        printf("[8] Search passwords by tag and folder\n");
         printf("[0] Close C-Pass\n");
 
         int choice;
@@ -62,24 +126,37 @@ int main() {
             clear_console();
             continue;
         }
+        // The menu functions lock the vault themselves, only while they read or change the entries,
+        // so a save is never held up by a prompt
+        if (trace) {
+            lock_vault(saver);
+            record_operation(trace, choice, count_live_passwords(*passwords, *num_passwords));
+            unlock_vault(saver, false);
+        }
         switch (choice) {
             case 1:
-                get_password(passwords, num_passwords);
+                get_password(passwords, num_passwords, vault_path, vault_key, saver);
             break;
             case 2:
-                generate_and_save_password(passwords, &num_passwords, p_requirement);
+                generate_and_save_password(passwords, num_passwords, p_requirement, corpus, listener, saver);
             break;
             case 3:
-                add_existing_password(passwords, &num_passwords, p_requirement);
+                add_existing_password(passwords, num_passwords, p_requirement, corpus, listener, saver);
             break;
             case 4:
-                edit_password(passwords, num_passwords, p_requirement);
+                edit_password(passwords, num_passwords, p_requirement, corpus, vault_path, vault_key, listener, saver);
             break;
             case 5:
-                loop_delete_password(&passwords, &num_passwords);
+                loop_delete_password(passwords, num_passwords, listener, saver);
             break;
             case 6:
-                update_password_requirements(p_requirement);
+                update_password_requirements(p_requirement, saver);
+            break;
+            case 7:
+                audit_passwords(passwords, num_passwords, p_requirement, saver);
+            break;
+            case 8:
+                search_passwords(passwords, num_passwords, saver);
             break;
             case 0:
                 running = 0;
@@ -88,19 +165,158 @@ int main() {
                 printf("Invalid choice\n");
         }
     }
+}
 
-    // Save the password requirements and passwords to the decrypted file
-    save_passwords_and_requirements(p_requirement, passwords, &num_passwords, decrypted_char);
-    free(p_requirement);
-    free(passwords);
 
-    // Encrypt the saved data using the master password
-    encrypt_file(encrypted_file, decrypted_char, password);
-    free(password);
-    free(*decrypted_char);
+int main(int argc, char *argv[]) {
+#ifdef C_PASS_ALLOC_STATS
+    // Keeps the real stderr for the report before it is redirected below
+    alloc_stats_init();
+#endif
+    // --vault PATH in front of the command selects another vault than $C_PASS_VAULT
+    const char* encrypted_file = default_vault_path();
+    if (argc > 2 && strcmp(argv[1], "--vault") == 0) {
+        encrypted_file = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc > 1 && !is_known_command(argv[1])) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (argc > 1 && !command_needs_vault(argc - 1, argv + 1)) {
+        return run_standalone_command(argc - 1, argv + 1, encrypted_file);
+    }
+
+    // Redirect stderr to NUL to suppress all error by openssl
+    freopen("NUL", "w", stderr);
+
+    // Initialize the openssl library
+    ERR_load_crypto_strings();
+    OpenSSL_add_all_algorithms();
+
+    // Define file names
+    char** decrypted_char = malloc(sizeof(char *));
+    if (!decrypted_char) {
+        exit(-99);
+    }
+    // Receives the edits that could not be merged with those of another process
+    char* conflict_file = malloc(strlen(encrypted_file) + sizeof(".conflict"));
+    if (!conflict_file) {
+        exit(-99);
+    }
+    strcpy(conflict_file, encrypted_file);
+    strcat(conflict_file, ".conflict");
+
+    // A vault unlocked by the unlock command opens without the login screen and the key derivation
+    uint64_t version = 0;
+    struct vault_key* vault_key = load_session_key(encrypted_file);
+    if (vault_key && !decrypt_file(encrypted_file, decrypted_char, vault_key, &version)) {
+        // The vault was replaced or its password changed since it was unlocked
+        forget_session_key(encrypted_file);
+        secure_free(vault_key);
+        vault_key = NULL;
+    }
+
+    // Display login screen, derive the vault key from the master password and decrypt the previously saved passwords
+    if (!vault_key)
+        vault_key = login(encrypted_file, decrypted_char, &version);
+
+    // Load the previously saved requirements and passwords from decrypted file
+    int num_passwords = 0;
+    struct password_requirement* p_requirement = read_password_requirement(*decrypted_char);
+    struct password** passwords = read_passwords(*decrypted_char, &num_passwords);
+    if (!p_requirement || !passwords) {
+        // Going on with part of the vault would delete the rest on the next save
+        printf("Out of memory while loading the vault\n");
+        secure_free(*decrypted_char);
+        free_password_requirement(p_requirement);
+        free_passwords(passwords, num_passwords);
+        free(passwords);
+        secure_free(vault_key);
+        free(decrypted_char);
+        free(conflict_file);
+        return 1;
+    }
+    if (!load_access_stats(encrypted_file, vault_key, passwords, num_passwords))
+        printf("The access counts of %s could not be read\n", encrypted_file);
+
+    // Wipe and free decrypted characters
+    secure_free(*decrypted_char);
+
+    // Remember the loaded state, so commits can merge changes other processes made meanwhile
+    struct vault_base base = {0};
+    record_vault_base(&base, version, p_requirement, passwords, num_passwords);
+
+    // Commands only save when they changed the vault, the menu saves in the background
+    bool modified = true;
+    int exit_code = 0;
+    struct command_output output = {0};
+    if (argc > 1) {
+        modified = false;
+        const struct vault_source source = {encrypted_file, vault_key, version};
+        exit_code = run_command(argc - 1, argv + 1, &source, &passwords, &num_passwords, p_requirement, &modified,
+            &output);
+    } else {
+        // The breach corpus is only mapped, opening it costs nothing even if it is huge
+        struct breach_corpus *corpus = open_breach_corpus(default_breach_corpus_path());
+        // Edits and merges keep the due dates current, so the menu never scans the vault for them
+        struct expiry_index expiry;
+        const bool indexed = build_expiry_index(&expiry, p_requirement, passwords, num_passwords);
+        const struct password_listener expiry_listener = {track_expiry, &expiry};
+        const struct password_listener *listener = indexed ? &expiry_listener : NULL;
+        struct autosave *saver = start_autosave(encrypted_file, vault_key, &base, &passwords, &num_passwords,
+            p_requirement, listener);
+        struct trace_recorder *trace = open_trace_recorder(getenv(TRACE_ENVIRONMENT_VARIABLE));
+        run_menu(encrypted_file, vault_key, &passwords, &num_passwords, p_requirement, corpus, saver, trace,
+            indexed ? &expiry : NULL, listener);
+        close_trace_recorder(trace);
+        // Only save again on exit if the saver could not store every edit
+        modified = !stop_autosave(saver);
+        close_breach_corpus(corpus);
+        if (indexed)
+            free_expiry_index(&expiry);
+    }
+
+    // Drop the tombstones left behind by deleted passwords before saving
+    compact_passwords(passwords, &num_passwords);
+
+    // Save the password requirements and passwords and encrypt them using the vault key
+    const enum commit_status status = modified ?
+        commit_vault(encrypted_file, vault_key, &base, p_requirement, &passwords, &num_passwords, NULL) : COMMIT_OK;
+    if (status == COMMIT_CONFLICT) {
+        // Keep the conflicting version, so no edit is lost
+        if (save_passwords_and_requirements(p_requirement, passwords, &num_passwords, decrypted_char)) {
+            encrypt_file(conflict_file, decrypted_char, vault_key, base.version);
+            secure_free(*decrypted_char);
+        }
+        printf("Another process changed the same entries meanwhile, your version was saved to %s\n", conflict_file);
+    } else if (status == COMMIT_FAILED) {
+        printf("Failed to save the vault!\n");
+    }
+    if (status != COMMIT_OK && exit_code == 0)
+        exit_code = 1;
+    // Output such as the rotation report must only name what was saved
+    if (!finish_command(&output, status == COMMIT_OK) && exit_code == 0)
+        exit_code = 1;
+
+    // Back up the last version this session saved, earlier versions of the session are superseded by it
+    char *backup_directory = status == COMMIT_OK ? default_backup_directory(encrypted_file) : NULL;
+    if (status == COMMIT_OK && backup_directory && read_vault_version(encrypted_file) != version &&
+        !backup_vault(backup_directory, encrypted_file, vault_key))
+        printf("Failed to back up the vault to %s\n", backup_directory);
+    free(backup_directory);
+    free_vault_base(&base);
+    free_passwords(passwords, num_passwords);
+    free_password_requirement(p_requirement);
+    free(passwords);
+    secure_free(vault_key);
     free(decrypted_char);
+    free(conflict_file);
 
     // Cleanup openssl library
     EVP_cleanup();
     ERR_free_strings();
+    return exit_code;
 }
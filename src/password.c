@@ -7,19 +7,37 @@
 #include <stdio.h>
 
 #include "util.h"
+#include "secure_heap.h"
 #include <stdlib.h>
-#include <time.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <ctype.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <time.h>
+
+// Whole lines of the cleartext parsed by one thread and the entries it produced
+struct parse_job {
+    char *begin;
+    char *end;
+    int version;
+    struct password **entries;
+    int count;
+    int capacity;
+    bool out_of_memory; // Set if an entry of the range could not be stored, the whole load fails then
+};
 
-#if defined(_WIN32)
-    #include <conio.h>
-#else
-    #include <termios.h>
-    #include <unistd.h>
-#endif
+// Fields of a policy line: name, length, maximum length, the minimum of each counted class, minimum
+// strength, allowed characters, custom characters, folders and entry patterns
+#define POLICY_FIELDS (8 + NUM_COUNTED_CLASSES)
 
-#define DEFAULT_LENGTH 20
+// Random bytes fetched from OpenSSL at once when generating passwords
+struct random_pool {
+    unsigned char bytes[1024];
+    size_t pos;
+};
 
 
 const char *digits = "0123456789";
@@ -29,144 +47,629 @@ const char *alpha_lower = "abcdefghijklmnopqrstuvwxyz";
 
 
 /*
- * Read in a password from console without displaying the plain characters
+ * Draw a uniformly distributed random number below the given bound from the random pool.
+ * Uses rejection sampling so that no value is more likely than another
  *
- * return char*: The password entered by the user
+ * param struct random_pool* pool: Pool of random bytes, refilled from OpenSSL when empty
+ * param uint32_t bound: Exclusive upper bound of the random number
+ * param uint32_t* number: Receives the random number in [0, bound), 0 on failure
+ * return bool: false if OpenSSL could not refill the pool
  */
-char* read_password() {
-    char *password = calloc(DEFAULT_LENGTH, sizeof(char));
-    int i = 0;
-    char ch;
-    printf("Enter password: ");
-
-#if defined(_WIN32)
-    while (true) {
-        if (i % DEFAULT_LENGTH == 0 && i > 0) {
-            char* temp = realloc(password, i + DEFAULT_LENGTH);
-            if (temp == NULL) {
-                free(password);
-                return NULL;
-            }
-            free(password);
-            password = temp;
+static bool random_below(struct random_pool *pool, const uint32_t bound, uint32_t *number) {
+    *number = 0;
+    const uint32_t limit = UINT32_MAX - UINT32_MAX % bound;
+    uint32_t value;
+    do {
+        if (pool->pos + sizeof(value) > sizeof(pool->bytes)) {
+            if (RAND_bytes(pool->bytes, sizeof(pool->bytes)) != 1)
+                return false;
+            pool->pos = 0;
         }
-        ch = _getch();
-        if (ch == '\r' || ch == '\n')
-            break;
-        if (ch == '\b' && i > 0) {
-            // Handle backspace
-            printf("\b \b");
-            i--;
+        memcpy(&value, pool->bytes + pool->pos, sizeof(value));
+        pool->pos += sizeof(value);
+    } while (value >= limit);
+    *number = value % bound;
+    return true;
+}
+
+/*
+ * Add a byte value to a character class
+ */
+static void add_to_class(struct character_class *class, const unsigned char c) {
+    class->bits[c >> 6] |= (uint64_t) 1 << (c & 63);
+}
+
+
+static bool class_contains(const struct character_class *class, const unsigned char c) {
+    return class->bits[c >> 6] >> (c & 63) & 1;
+}
+
+
+/*
+ * Add a character set such as "a-zA-Z0-9_" to a class. A '-' between two characters is a range,
+ * at the start or the end of the set it stands for itself
+ *
+ * param struct character_class* class: The class
+ * param const char* set: The character set
+ * return bool: false if a range is reversed
+ */
+static bool add_character_set(struct character_class *class, const char *set) {
+    const unsigned char *c = (const unsigned char *) set;
+    while (*c) {
+        if (c[1] == '-' && c[2] != '\0') {
+            if (c[2] < c[0])
+                return false;
+            for (int value = c[0]; value <= c[2]; value++)
+                add_to_class(class, (unsigned char) value);
+            c += 3;
         } else {
-            password[i++] = ch;
-            printf("*"); // Mask character
+            add_to_class(class, *c++);
         }
     }
-#else
-    struct termios oldt, newt;
-    tcgetattr(STDIN_FILENO, &oldt);
-    newt = oldt;
-    newt.c_lflag &= ~ECHO;
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-
-    while ((ch = getchar()) != '\n') {
-        if (i % DEFAULT_LENGTH == 0 && i > 0) {
-            char* temp = realloc(password, i + DEFAULT_LENGTH);
-            if (temp == NULL) {
-                free(password);
-                return NULL;
+    return true;
+}
+
+
+/*
+ * Compile the character sets of a requirement or policy into class bitmaps and the alphabets
+ * generated passwords are drawn from. Generated characters are printable, allowed and, for the
+ * filling characters, lowercase letters unless the allowed characters exclude all of them
+ *
+ * param const char* allowed: Allowed characters, NULL allows every character
+ * param const char* required: Characters of the custom class, NULL if there are none
+ * param struct compiled_policy* compiled: Receives the classes and alphabets
+ * return bool: false if a character set is malformed
+ */
+static bool compile_character_classes(const char *allowed, const char *required, struct compiled_policy *compiled) {
+    memset(compiled, 0, sizeof(struct compiled_policy));
+    if (allowed && !add_character_set(&compiled->allowed, allowed))
+        return false;
+    if (!allowed) {
+        for (int c = 1; c < 256; c++)
+            add_to_class(&compiled->allowed, (unsigned char) c);
+    }
+    for (const char *c = digits; *c; c++)
+        add_to_class(&compiled->counted[CLASS_DIGIT], (unsigned char) *c);
+    for (const char *c = special_characters; *c; c++)
+        add_to_class(&compiled->counted[CLASS_SPECIAL], (unsigned char) *c);
+    for (const char *c = alpha_upper; *c; c++)
+        add_to_class(&compiled->counted[CLASS_UPPERCASE], (unsigned char) *c);
+    if (required && !add_character_set(&compiled->counted[CLASS_CUSTOM], required))
+        return false;
+
+    struct character_class lowercase = {{0}};
+    for (const char *c = alpha_lower; *c; c++)
+        add_to_class(&lowercase, (unsigned char) *c);
+    for (int k = 0; k <= NUM_COUNTED_CLASSES; k++) {
+        const struct character_class *source = k < NUM_COUNTED_CLASSES ? &compiled->counted[k] : &lowercase;
+        for (int pass = 0; pass < 2 && compiled->alphabet_lengths[k] == 0; pass++) {
+            // The filling characters fall back to every printable allowed character
+            for (int c = '!'; c <= '~'; c++) {
+                if (class_contains(&compiled->allowed, (unsigned char) c) &&
+                    (pass == 1 || class_contains(source, (unsigned char) c)))
+                    compiled->alphabets[k][compiled->alphabet_lengths[k]++] = (char) c;
             }
-            free(password);
-            password = temp;
-        }
-        if (ch == 127 || ch == '\b' && i > 0) {
-            // Handle backspace
-            i--;
-            printf("\b \b");
-        } else {
-            password[i++] = ch;
-            printf("*");
+            if (k < NUM_COUNTED_CLASSES)
+                break;
         }
     }
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-#endif
-    password[i] = '\0'; // Null-terminate the password
-    printf("\n");
-    return password;
+    return true;
 }
 
+
+static struct compiled_policy default_policy;
+static pthread_once_t default_policy_once = PTHREAD_ONCE_INIT;
+
+static void compile_default_policy(void) {
+    compile_character_classes(NULL, NULL, &default_policy);
+}
+
+
 /*
- * Generate a random new password that matches the requirements
+ * Free the strings of a policy, the policy itself is left to the caller
+ */
+static void free_policy_fields(struct password_policy *policy) {
+    free(policy->name);
+    free(policy->allowed);
+    free(policy->required);
+    free(policy->folders);
+    free(policy->entries);
+}
+
+
+/*
+ * Check a policy and compile its character sets. Policies that no password could meet are rejected
  *
- * param struct password_requirement* requirement: Pointer to the minimum password requirement defined by the user
- * return char*: Newly created character array with the new password
+ * param struct password_policy* policy: The policy, its compiled sets are replaced
+ * return bool: false if the policy is unnamed, a character set is malformed or the limits contradict each other
  */
-char *generate_password(const struct password_requirement *requirement) {
-    if (requirement->length < requirement->uppercased + requirement->digits + requirement->special_characters) {
-        return NULL;
+bool compile_password_policy(struct password_policy *policy) {
+    if (!policy->name || !*policy->name || !compile_character_classes(policy->allowed, policy->required, &policy->compiled))
+        return false;
+    int num_required = 0;
+    for (int k = 0; k < NUM_COUNTED_CLASSES; k++) {
+        if (policy->minimum[k] < 0 || (policy->minimum[k] > 0 && policy->compiled.alphabet_lengths[k] == 0))
+            return false;
+        num_required += policy->minimum[k];
+    }
+    return policy->length > 0 && policy->length >= num_required && policy->min_strength >= 0 &&
+        policy->max_age >= 0 && (policy->max_length == 0 || policy->max_length >= policy->length) &&
+        policy->compiled.alphabet_lengths[NUM_COUNTED_CLASSES] > 0;
+}
+
+
+/*
+ * Add a policy to the requirement or replace the policy of the same name
+ *
+ * param struct password_requirement* requirement: The requirement
+ * param const struct password_policy* policy: The policy, it is copied
+ * return bool: false if the policy is invalid, MAX_POLICIES are defined already or memory ran out
+ */
+bool set_password_policy(struct password_requirement *requirement, const struct password_policy *policy) {
+    struct password_policy copy = *policy;
+    char **texts[] = {&copy.name, &copy.allowed, &copy.required, &copy.folders, &copy.entries};
+    const char *sources[] = {policy->name, policy->allowed, policy->required, policy->folders, policy->entries};
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        *texts[i] = sources[i] ? strdup(sources[i]) : NULL;
+        ok = ok && (!sources[i] || *texts[i]);
+    }
+    ok = ok && compile_password_policy(&copy);
+
+    int index = 0;
+    while (index < requirement->num_policies && strcmp(requirement->policies[index].name, policy->name) != 0)
+        index++;
+    if (ok && index == requirement->num_policies) {
+        struct password_policy *grown = index + requirement->num_unreadable_policies < MAX_POLICIES ?
+            realloc(requirement->policies, (index + 1) * sizeof(struct password_policy)) : NULL;
+        ok = grown != NULL;
+        if (grown)
+            requirement->policies = grown;
+    } else if (ok) {
+        free_policy_fields(&requirement->policies[index]);
     }
-    // Seed the random number generator
-    char *password = calloc(requirement->length, sizeof(char));
+    if (!ok) {
+        free_policy_fields(&copy);
+        return false;
+    }
+    requirement->policies[index] = copy;
+    if (index == requirement->num_policies)
+        requirement->num_policies++;
+    return true;
+}
+
 
-    srand(time(NULL));
+/*
+ * Remove a policy, the entries it applied to follow the vault requirement or another policy afterwards
+ *
+ * param struct password_requirement* requirement: The requirement
+ * param const char* name: Name of the policy
+ * return bool: false if there is no such policy
+ */
+bool delete_password_policy(struct password_requirement *requirement, const char *name) {
+    for (int i = 0; i < requirement->num_policies; i++) {
+        if (strcmp(requirement->policies[i].name, name) == 0) {
+            free_policy_fields(&requirement->policies[i]);
+            memmove(requirement->policies + i, requirement->policies + i + 1,
+                (requirement->num_policies - i - 1) * sizeof(struct password_policy));
+            requirement->num_policies--;
+            return true;
+        }
+    }
+    return false;
+}
 
-    int i = 0;
 
-    // Add required number of digits
-    for (int j = 0; j < requirement->digits; j++) {
-        password[i++] = digits[rand() % strlen(digits)];
+/*
+ * Check whether a name matches one of the comma separated patterns of a list
+ */
+static bool list_matches_name(const char *list, const char *name) {
+    char pattern[256];
+    for (const char *item = list; *item; ) {
+        const size_t length = strcspn(item, ",");
+        if (length < sizeof(pattern)) {
+            memcpy(pattern, item, length);
+            pattern[length] = '\0';
+            if (pattern_matches(pattern, name))
+                return true;
+        }
+        item += length;
+        if (*item == ',')
+            item++;
     }
+    return false;
+}
+
 
-    // Add required number of special characters
-    for (int j = 0; j < requirement->special_characters; j++) {
-        password[i++] = special_characters[rand() % strlen(special_characters)];
+/*
+ * Get the length of the longest folder of a comma separated list that is the folder or one of its parents
+ *
+ * return size_t: The length, 0 if no folder of the list contains the folder
+ */
+static size_t containing_folder_length(const char *list, const char *folder) {
+    size_t longest = 0;
+    for (const char *item = list; *item; ) {
+        const size_t length = strcspn(item, ",");
+        if (length > longest && strncmp(item, folder, length) == 0 &&
+            (folder[length] == '\0' || folder[length] == FOLDER_SEPARATOR))
+            longest = length;
+        item += length;
+        if (*item == ',')
+            item++;
     }
+    return longest;
+}
 
-    // Add required number of uppercased letter
-    for (int j = 0; j < requirement->uppercased; j++) {
-        password[i++] = alpha_upper[rand() % strlen(alpha_upper)];
+
+/*
+ * Find the policy an entry follows. A policy naming the entry wins over policies of its folders,
+ * among those the one of the innermost folder wins. The cost grows with the number of policies only,
+ * so checking a whole vault stays linear
+ *
+ * param const struct password_requirement* requirement: The requirement holding the policies
+ * param const struct password* entry: The entry, only its name and folder are used
+ * return int: Index of the policy, -1 if the entry follows the vault requirement
+ */
+int find_password_policy(const struct password_requirement *requirement, const struct password *entry) {
+    int found = -1;
+    size_t found_length = 0;
+    for (int i = 0; i < requirement->num_policies; i++) {
+        const struct password_policy *policy = &requirement->policies[i];
+        if (policy->entries && entry->name && list_matches_name(policy->entries, entry->name))
+            return i;
+        if (policy->folders && entry->folder) {
+            const size_t length = containing_folder_length(policy->folders, entry->folder);
+            if (length > found_length) {
+                found = i;
+                found_length = length;
+            }
+        }
     }
+    return found;
+}
+
 
-    // Fill the remaining characters with alphabetic characters
-    while (i < requirement->length) {
-        password[i++] = alpha_lower[rand() % strlen(alpha_lower)];
+/*
+ * Get the rules of a policy or of the vault requirement
+ *
+ * param const struct password_requirement* requirement: The requirement holding the policies
+ * param int policy: Index of the policy, -1 for the vault requirement
+ * param struct password_rules* rules: Receives the rules, valid as long as the policy is not changed
+ */
+void get_policy_rules(const struct password_requirement *requirement, const int policy, struct password_rules *rules) {
+    if (policy < 0 || policy >= requirement->num_policies) {
+        pthread_once(&default_policy_once, compile_default_policy);
+        rules->policy = NULL;
+        rules->compiled = &default_policy;
+        rules->length = requirement->length;
+        rules->max_length = 0;
+        rules->minimum[CLASS_DIGIT] = requirement->digits;
+        rules->minimum[CLASS_SPECIAL] = requirement->special_characters;
+        rules->minimum[CLASS_UPPERCASE] = requirement->uppercased;
+        rules->minimum[CLASS_CUSTOM] = 0;
+        rules->min_strength = requirement->min_strength;
+        rules->max_age = requirement->max_age;
+        return;
     }
+    const struct password_policy *named = &requirement->policies[policy];
+    rules->policy = named->name;
+    rules->compiled = &named->compiled;
+    rules->length = named->length;
+    rules->max_length = named->max_length;
+    memcpy(rules->minimum, named->minimum, sizeof(rules->minimum));
+    rules->min_strength = named->min_strength;
+    rules->max_age = named->max_age;
+}
+
+
+/*
+ * Get the rules the password of an entry has to meet, see find_password_policy
+ *
+ * param const struct password_requirement* requirement: The requirement holding the policies
+ * param const struct password* entry: The entry, NULL for the vault requirement
+ * param struct password_rules* rules: Receives the rules
+ */
+void get_password_rules(const struct password_requirement *requirement, const struct password *entry, struct password_rules *rules) {
+    get_policy_rules(requirement, entry ? find_password_policy(requirement, entry) : -1, rules);
+}
+
 
-    // Shuffle the password to mix the characters
-    for (int j = 0; j < requirement->length; j++) {
-        const int k = rand() % requirement->length;
-        if (j != k) {
+/*
+ * Generate a batch of random new passwords that match the requirements.
+ * See generate_passwords_with_rules
+ *
+ * param struct password_requirement* requirement: Pointer to the minimum password requirement defined by the user
+ * param int count: Number of passwords to generate
+ * return char**: Newly created array of count character arrays, NULL if the requirements are invalid
+ */
+char **generate_passwords(const struct password_requirement *requirement, const int count) {
+    struct password_rules rules;
+    get_policy_rules(requirement, -1, &rules);
+    return generate_passwords_with_rules(&rules, count);
+}
+
+
+/*
+ * Generate a batch of random new passwords that meet the rules of the vault requirement or a policy.
+ * All passwords share one pool of cryptographically secure random bytes,
+ * so generating many passwords at once only needs a few calls into OpenSSL
+ *
+ * param const struct password_rules* rules: The rules, see get_password_rules
+ * param int count: Number of passwords to generate
+ * return char**: Newly created array of count character arrays, NULL if the rules cannot be met,
+ *                memory ran out or OpenSSL could not provide random bytes
+ */
+char **generate_passwords_with_rules(const struct password_rules *rules, const int count) {
+    const struct compiled_policy *compiled = rules->compiled;
+    int num_required = 0;
+    for (int k = 0; k < NUM_COUNTED_CLASSES; k++) {
+        if (rules->minimum[k] > 0 && compiled->alphabet_lengths[k] == 0)
+            return NULL;
+        num_required += rules->minimum[k] > 0 ? rules->minimum[k] : 0;
+    }
+    if (count <= 0 || rules->length <= 0 || rules->length < num_required ||
+        compiled->alphabet_lengths[NUM_COUNTED_CLASSES] == 0) {
+        return NULL;
+    }
+    char **passwords = calloc(count, sizeof(char *));
+    if (!passwords) {
+        return NULL;
+    }
+
+    struct random_pool pool;
+    pool.pos = sizeof(pool.bytes);
+
+    bool failed = false;
+    for (int n = 0; n < count && !failed; n++) {
+        char *password = secure_malloc(rules->length + 1);
+        if (!password) {
+            failed = true;
+            break;
+        }
+        int i = 0;
+        uint32_t pick = 0;
+
+        // Add the required number of digits, special characters, uppercased letters and custom characters
+        for (int k = 0; k < NUM_COUNTED_CLASSES && !failed; k++) {
+            for (int j = 0; j < rules->minimum[k] && !failed; j++) {
+                failed = !random_below(&pool, (uint32_t) compiled->alphabet_lengths[k], &pick);
+                password[i++] = compiled->alphabets[k][pick];
+            }
+        }
+
+        // Fill the remaining characters with alphabetic characters
+        const uint32_t num_fill = (uint32_t) compiled->alphabet_lengths[NUM_COUNTED_CLASSES];
+        while (i < rules->length && !failed) {
+            failed = !random_below(&pool, num_fill, &pick);
+            password[i++] = compiled->alphabets[NUM_COUNTED_CLASSES][pick];
+        }
+
+        // Shuffle the password to mix the characters (Fisher-Yates)
+        for (int j = rules->length - 1; j > 0 && !failed; j--) {
+            failed = !random_below(&pool, (uint32_t) j + 1, &pick);
+            const int k = (int) pick;
             const char temp = password[j];
             password[j] = password[k];
             password[k] = temp;
         }
+
+        // Null-terminate the password
+        password[rules->length] = '\0';
+        passwords[n] = password;
+    }
+    OPENSSL_cleanse(pool.bytes, sizeof(pool.bytes));
+    if (failed) {
+        // Without fresh random bytes no password may be handed out, not even the ones already generated
+        for (int n = 0; n < count; n++) {
+            secure_free(passwords[n]);
+        }
+        free(passwords);
+        return NULL;
     }
+    return passwords;
+}
+
+/*
+ * Generate a random new password that matches the requirements
+ *
+ * param struct password_requirement* requirement: Pointer to the minimum password requirement defined by the user
+ * return char*: Newly created character array with the new password
+ */
+char *generate_password(const struct password_requirement *requirement) {
+    struct password_rules rules;
+    get_policy_rules(requirement, -1, &rules);
+    return generate_password_with_rules(&rules);
+}
+
 
-    // Null-terminate the password
-    password[requirement->length] = '\0';
+/*
+ * Generate a random new password that meets the rules of the vault requirement or a policy
+ *
+ * param const struct password_rules* rules: The rules, see get_password_rules
+ * return char*: Newly created character array with the new password, NULL if the rules cannot be met
+ */
+char *generate_password_with_rules(const struct password_rules *rules) {
+    char **passwords = generate_passwords_with_rules(rules, 1);
+    if (!passwords) {
+        return NULL;
+    }
+    char *password = passwords[0];
+    free(passwords);
     return password;
 }
 
 
+/*
+ * Free a single password struct and all strings it owns
+ *
+ * param struct password* entry: The password struct to free, may be NULL
+ */
+static void free_password(struct password *entry) {
+    if (!entry)
+        return;
+    secure_free(entry->name);
+    secure_free(entry->username);
+    secure_free(entry->password);
+    secure_free(entry->previous_password);
+    secure_free(entry->folder);
+    secure_free(entry->tags);
+    secure_free(entry->attachments);
+    free(entry);
+}
+
+
+/*
+ * Free every password struct in the array.
+ * The array itself is left to the caller
+ *
+ * param struct password** arr: Array containing the password struct pointers
+ * param int curr_size: The current size of the array including tombstones
+ */
+void free_passwords(struct password **arr, const int curr_size) {
+    if (arr == NULL)
+        return;
+    for (int i = 0; i < curr_size; i++) {
+        free_password(arr[i]);
+        arr[i] = NULL;
+    }
+}
+
+
 /*
  * Deletes the password in the password array at the given index.
- * Frees all memory and sets the array at the given index to NULL
+ * Frees all memory and sets the array at the given index to NULL, leaving a tombstone.
+ * The array is not shifted, tombstones are removed later by compact_passwords
  *
  * param struct password*** arr: Pointer to the array containing the password struct pointers
- * param const int* index: Pointer to the integer depicting the given index
+ * param const int index: The index of the password to delete
+ * param const struct password_listener* listener: Told about the deletion, may be NULL
  */
-void delete_password(struct password ***arr, const int index) {
-    if (*arr == NULL)
+void delete_password(struct password ***arr, const int index, const struct password_listener *listener) {
+    if (*arr == NULL || (*arr)[index] == NULL)
         return;
-    struct password *temp = (*arr)[index];
-    free(temp->name);
-    free(temp->username);
-    free(temp->password);
-    free(temp);
+    report_password_change(listener, (*arr)[index], PASSWORD_REMOVED);
+    free_password((*arr)[index]);
     (*arr)[index] = NULL;
 }
 
 
+/*
+ * Deletes every password for which the predicate returns true in a single linear pass.
+ * Surviving entries are moved down in place, so the array is compacted at the same time
+ * and keeps its original order. Existing tombstones are removed as well.
+ *
+ * param struct password*** arr: Pointer to the array containing the password struct pointers
+ * param int* curr_size: Pointer to the integer describing the current size of the array
+ * param password_predicate predicate: Function deciding whether an entry should be deleted
+ * param const void* context: Additional data handed to the predicate, e.g. a name pattern
+ * param const struct password_listener* listener: Told about every deletion, may be NULL
+ * return int: The number of deleted passwords
+ */
+int delete_passwords_if(
+    struct password ***arr,
+    int *curr_size,
+    const password_predicate predicate,
+    const void *context,
+    const struct password_listener *listener) {
+    if (*arr == NULL)
+        return 0;
+    int deleted = 0;
+    int write = 0;
+    for (int read = 0; read < *curr_size; read++) {
+        struct password *entry = (*arr)[read];
+        if (entry == NULL)
+            continue;
+        if (predicate(entry, context)) {
+            report_password_change(listener, entry, PASSWORD_REMOVED);
+            free_password(entry);
+            deleted++;
+            continue;
+        }
+        (*arr)[write++] = entry;
+    }
+    for (int i = write; i < *curr_size; i++) {
+        (*arr)[i] = NULL;
+    }
+    *curr_size = write;
+    return deleted;
+}
+
+
+/*
+ * Predicate for delete_passwords_if matching the entry name against a wildcard pattern
+ *
+ * param const struct password* entry: The entry to test
+ * param const void* pattern: The wildcard pattern as character array
+ * return bool: true if the name of the entry matches the pattern
+ */
+bool password_name_matches(const struct password *entry, const void *pattern) {
+    return pattern_matches(pattern, entry->name);
+}
+
+
+/*
+ * Removes all tombstones (NULL entries) from the password array in a single pass,
+ * keeping the order of the remaining entries
+ *
+ * param struct password** arr: Array containing the password struct pointers
+ * param int* curr_size: Pointer to the integer describing the current size of the array
+ * return int: The number of removed tombstones
+ */
+int compact_passwords(struct password **arr, int *curr_size) {
+    if (arr == NULL)
+        return 0;
+    int write = 0;
+    for (int read = 0; read < *curr_size; read++) {
+        if (arr[read] != NULL)
+            arr[write++] = arr[read];
+    }
+    const int removed = *curr_size - write;
+    for (int i = write; i < *curr_size; i++) {
+        arr[i] = NULL;
+    }
+    *curr_size = write;
+    return removed;
+}
+
+
+/*
+ * Count the entries of the password array that have not been deleted
+ *
+ * param struct password** arr: Array containing the password struct pointers
+ * param int curr_size: The current size of the array including tombstones
+ * return int: The number of live entries
+ */
+int count_live_passwords(struct password **arr, const int curr_size) {
+    int live = 0;
+    for (int i = 0; i < curr_size; i++) {
+        if (arr[i] != NULL)
+            live++;
+    }
+    return live;
+}
+
+
+/*
+ * Translate the number shown to the user (1-based, skipping deleted entries)
+ * into the index of the entry in the password array
+ *
+ * param struct password** arr: Array containing the password struct pointers
+ * param int curr_size: The current size of the array including tombstones
+ * param int ordinal: The 1-based number of the live entry
+ * return int: The index in the array or -1 if there is no such entry
+ */
+int find_password_slot(struct password **arr, const int curr_size, const int ordinal) {
+    if (ordinal < 1)
+        return -1;
+    int seen = 0;
+    for (int i = 0; i < curr_size; i++) {
+        if (arr[i] != NULL && ++seen == ordinal)
+            return i;
+    }
+    return -1;
+}
+
+
 /*
  * Changes the password in the password array at the given index.
  * Frees the memory of the old password string and allocates new memory in the password struct,
@@ -175,126 +678,586 @@ void delete_password(struct password ***arr, const int index) {
  * param struct password*** arr: Pointer to the array containing the password struct pointers
  * param const int* index: Pointer to the integer depicting the given index
  * param const char* password: Character array containing the string of the new password
+ * param const struct password_listener* listener: Told about the change, may be NULL
+ * return bool: false if memory ran out, the entry keeps its old password then
  */
-void change_password(struct password ***arr, const int *index, const char *password) {
+bool change_password(
+    struct password ***arr,
+    const int *index,
+    const char *password,
+    const struct password_listener *listener) {
     if (*arr == NULL)
-        return;
+        return false;
     struct password *temp = (*arr)[*index];
-    free(temp->password);
-    temp->password = strdup(password);
+    char *copy = secure_strdup(password);
+    if (!copy)
+        return false;
+    secure_free(temp->password);
+    temp->password = copy;
+    stamp_password_change(temp, listener);
+    return true;
+}
+
+
+/*
+ * Remember that the password of an entry was just set. Everything that replaces a password
+ * calls this, so the age of the password and the expiry index stay correct
+ *
+ * param struct password* entry: The entry holding its new password
+ * param const struct password_listener* listener: Told about the change, may be NULL
+ */
+void stamp_password_change(struct password *entry, const struct password_listener *listener) {
+    entry->changed = (long long) time(NULL);
+    report_password_change(listener, entry, PASSWORD_CHANGED);
+}
+
+
+/*
+ * Tell a listener about a change, for code that moves entries between arrays or copies fields
+ *
+ * param const struct password_listener* listener: The listener, may be NULL
+ * param struct password* entry: The entry
+ * param enum password_change change: What happened to it
+ */
+void report_password_change(
+    const struct password_listener *listener,
+    struct password *entry,
+    const enum password_change change) {
+    if (listener && listener->notify)
+        listener->notify(entry, change, listener->context);
+}
+
+
+/*
+ * Set the folder of an entry. Leading, trailing and repeated separators are dropped,
+ * so "/work//db/" becomes "work/db"
+ *
+ * param struct password* entry: The entry
+ * param const char* folder: The folder path, NULL or "" for the top level
+ * return bool: false if memory ran out, the entry is unchanged then
+ */
+bool set_password_folder(struct password *entry, const char *folder) {
+    char *normalized = NULL;
+    if (folder && folder[strspn(folder, "/")] != '\0') {
+        normalized = secure_malloc(strlen(folder) + 1);
+        if (!normalized)
+            return false;
+        char *write = normalized;
+        for (const char *c = folder; *c; c++) {
+            if (*c != FOLDER_SEPARATOR || (write > normalized && write[-1] != FOLDER_SEPARATOR))
+                *write++ = *c;
+        }
+        if (write > normalized && write[-1] == FOLDER_SEPARATOR)
+            write--;
+        *write = '\0';
+    }
+    secure_free(entry->folder);
+    entry->folder = normalized;
+    return true;
+}
+
+
+static int compare_tags(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+
+/*
+ * Set the tags of an entry. Tags are separated by commas or white space, they are stored
+ * sorted and without duplicates
+ *
+ * param struct password* entry: The entry
+ * param const char* tags: The tags, NULL or "" to remove all
+ * return bool: false if memory ran out, the entry is unchanged then
+ */
+bool set_password_tags(struct password *entry, const char *tags) {
+    const char *separators = ", \t\r\n";
+    char *copy = secure_strdup(tags ? tags : "");
+    const size_t max_tags = copy ? strlen(copy) / 2 + 1 : 0;
+    char **list = copy ? malloc(max_tags * sizeof(char *)) : NULL;
+    char *joined = copy ? secure_malloc(strlen(copy) + 1) : NULL;
+    if (!list || !joined) {
+        free(list);
+        secure_free(copy);
+        secure_free(joined);
+        return false;
+    }
+
+    size_t count = 0;
+    for (char *c = copy; *c; ) {
+        c += strspn(c, separators);
+        if (*c == '\0')
+            break;
+        list[count++] = c;
+        c += strcspn(c, separators);
+        if (*c)
+            *c++ = '\0';
+    }
+    qsort(list, count, sizeof(char *), compare_tags);
+    char *write = joined;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && strcmp(list[i], list[i - 1]) == 0)
+            continue;
+        if (write > joined)
+            *write++ = TAG_SEPARATOR;
+        const size_t length = strlen(list[i]);
+        memcpy(write, list[i], length);
+        write += length;
+    }
+    *write = '\0';
+    free(list);
+    secure_free(copy);
+
+    secure_free(entry->tags);
+    entry->tags = write > joined ? joined : NULL;
+    if (!entry->tags)
+        secure_free(joined);
+    return true;
+}
+
+
+/*
+ * Add a tag to an entry or remove it
+ *
+ * param struct password* entry: The entry
+ * param const char* tag: The tag
+ * param bool add: true to add the tag, false to remove it
+ * return bool: false if memory ran out
+ */
+bool edit_password_tags(struct password *entry, const char *tag, const bool add) {
+    const char *current = entry->tags ? entry->tags : "";
+    if (add) {
+        char *combined = secure_malloc(strlen(current) + strlen(tag) + 2);
+        if (!combined)
+            return false;
+        snprintf(combined, strlen(current) + strlen(tag) + 2, "%s%c%s", current, TAG_SEPARATOR, tag);
+        const bool set = set_password_tags(entry, combined);
+        secure_free(combined);
+        return set;
+    }
+    if (!password_has_tag(entry, tag))
+        return true;
+    // Blank out the tag, set_password_tags drops the empty slot
+    char *remaining = secure_strdup(current);
+    if (!remaining)
+        return false;
+    const size_t length = strlen(tag);
+    for (char *c = remaining; *c; ) {
+        const size_t field = strcspn(c, ",");
+        if (field == length && strncmp(c, tag, length) == 0)
+            memset(c, ' ', length);
+        c += field;
+        if (*c)
+            c++;
+    }
+    const bool set = set_password_tags(entry, remaining);
+    secure_free(remaining);
+    return set;
+}
+
+
+/*
+ * Check whether an entry has a tag
+ *
+ * param const struct password* entry: The entry
+ * param const char* tag: The tag
+ * return bool: true if the entry carries the tag
+ */
+bool password_has_tag(const struct password *entry, const char *tag) {
+    const size_t length = strlen(tag);
+    for (const char *c = entry->tags; c && *c; ) {
+        const size_t field = strcspn(c, ",");
+        if (field == length && strncmp(c, tag, length) == 0)
+            return true;
+        c += field;
+        if (*c)
+            c++;
+    }
+    return false;
+}
+
+
+/*
+ * Allocate a password struct holding copies of the given strings
+ *
+ * param const char* name: String containing the name of the new entry
+ * param const char* username: String containing the username of the new entry
+ * param const char* password: String containing the password of the new entry
+ * return struct password*: The new entry or NULL if memory ran out
+ */
+static struct password *new_password(const char *name, const char *username, const char *password) {
+    struct password *entry = calloc(1, sizeof(struct password));
+    if (!entry) {
+        return NULL;
+    }
+    entry->name = secure_strdup(name);
+    entry->username = secure_strdup(username);
+    entry->password = secure_strdup(password);
+    if (!entry->name || !entry->username || !entry->password) {
+        free_password(entry);
+        return NULL;
+    }
+    return entry;
 }
 
 
 /*
  * Add a new password to the array containing the password structs.
- * Dynamically allocates new memory if the array is currently full and initializes newly
- * allocated memory with NULL
+ * Doubles the capacity of the array whenever its size reaches a power of two (starting at
+ * DEFAULT_CAPACITY), so adding n entries only reallocates O(log n) times, and initializes
+ * newly allocated memory with NULL
  *
  * param struct password*** arr: Pointer to the array containing the password struct pointers
  * param int* curr_size: Pointer to the integer describing the current size of the array
  * param const char* name: String containing the name of the new entry
  * param const char* username: String containing the username of the new entry
  * param const char* password: String containing the password of the new entry
+ * param const struct password_listener* listener: Told about the new entry, may be NULL
+ * return bool: false if memory ran out, the array is unchanged then
  */
-void add_password(
+bool add_password(
     struct password ***arr,
     int *curr_size,
     const char *name,
     const char *username,
-    const char *password) {
-    if (*curr_size % DEFAULT_CAPACITY == 0 && *curr_size > 0) {
-        struct password **new_array = realloc(*arr, *curr_size + DEFAULT_CAPACITY * sizeof(struct password *));
+    const char *password,
+    const struct password_listener *listener) {
+    if (*curr_size >= DEFAULT_CAPACITY && (*curr_size & (*curr_size - 1)) == 0) {
+        const size_t new_capacity = 2 * (size_t) *curr_size;
+        struct password **new_array = realloc(*arr, new_capacity * sizeof(struct password *));
         if (!new_array) {
-            perror("Failed to resize array");
-            return;
+            return false;
         }
         *arr = new_array;
         struct password **ptr = (*arr) + *curr_size;
         // Initialize newly allocated pointers to NULL
-        for (size_t i = *curr_size; i < *curr_size + DEFAULT_CAPACITY; i++, ptr++) {
+        for (size_t i = *curr_size; i < new_capacity; i++, ptr++) {
             *ptr = NULL;
         }
     }
 
-    struct password **ptr = (*arr) + *curr_size;
-
-    // Allocate memory for the new password entry
-    *ptr = calloc(1, sizeof(struct password));
-    (*ptr)->name = strdup(name);
-    (*ptr)->username = strdup(username);
-    (*ptr)->password = strdup(password);
+    struct password *entry = new_password(name, username, password);
+    if (!entry) {
+        return false;
+    }
+    entry->created = entry->changed = (long long) time(NULL);
+    (*arr)[*curr_size] = entry;
     (*curr_size)++;
+    report_password_change(listener, entry, PASSWORD_ADDED);
+    return true;
 }
 
 
 /*
- * Reads all stored passwords in the given file.
- * If the file exists, skip the first line, because this is holding the password requirements.
- * From the second line on, read every line and initialize the password structs accordingly.
+ * Split the next space separated field off a line and undo the escaping of format version 2 in place.
+ * Version 1 files were written without escaping, there consecutive spaces are skipped like strtok does
+ *
+ * param char** cursor: Pointer to the current position in the line, advanced past the field
+ * param int version: The format version of the vault
+ * return char*: The field or NULL if the line has no more fields
+ */
+static char *next_field(char **cursor, const int version) {
+    char *field = *cursor;
+    if (field == NULL)
+        return NULL;
+    if (version < 2) {
+        while (*field == ' ')
+            field++;
+        if (*field == '\0') {
+            *cursor = NULL;
+            return NULL;
+        }
+    }
+    char *read = field;
+    char *write = field;
+    while (*read != '\0' && *read != ' ') {
+        if (version >= 2 && *read == '\\' && read[1] != '\0') {
+            read++;
+            switch (*read) {
+                case 's': *write++ = ' '; break;
+                case 'n': *write++ = '\n'; break;
+                case 'r': *write++ = '\r'; break;
+                case 't': *write++ = '\t'; break;
+                default: *write++ = *read; break;
+            }
+            read++;
+        } else {
+            *write++ = *read++;
+        }
+    }
+    *cursor = *read == ' ' ? read + 1 : NULL;
+    *write = '\0';
+    return field;
+}
+
+
+/*
+ * Parse one cleartext line into a new password struct. The line is split in place
+ *
+ * param char* line: The NUL terminated line
+ * param int version: The format version of the vault
+ * param bool* out_of_memory: Set to true if memory ran out, left alone otherwise
+ * return struct password*: The entry or NULL if the line is malformed or memory ran out
+ */
+static struct password *parse_password_line(char *line, const int version, bool *out_of_memory) {
+    char *cursor = line;
+    const char *name = next_field(&cursor, version);
+    const char *username = next_field(&cursor, version);
+    const char *password = next_field(&cursor, version);
+    const char *previous_password = next_field(&cursor, version);
+    const char *folder = next_field(&cursor, version);
+    const char *tags = next_field(&cursor, version);
+    const char *attachments = next_field(&cursor, version);
+    const char *created = next_field(&cursor, version);
+    const char *changed = next_field(&cursor, version);
+    if (!name || !username || !password)
+        return NULL;
+    struct password *entry = new_password(name, username, password);
+    if (!entry) {
+        *out_of_memory = true;
+        return NULL;
+    }
+    // Version 3 leaves the previous password empty if an entry only has a folder or tags
+    const bool has_previous_password = previous_password && (version < 3 || *previous_password);
+    const bool has_attachments = attachments && *attachments;
+    if (has_previous_password)
+        entry->previous_password = secure_strdup(previous_password);
+    if (has_attachments)
+        entry->attachments = secure_strdup(attachments);
+    // An entry missing a field would lose it on the next save
+    if ((has_previous_password && !entry->previous_password) || (has_attachments && !entry->attachments) ||
+        !set_password_folder(entry, folder) || !set_password_tags(entry, tags)) {
+        free_password(entry);
+        *out_of_memory = true;
+        return NULL;
+    }
+    entry->created = created ? atoll(created) : 0;
+    entry->changed = changed ? atoll(changed) : 0;
+    return entry;
+}
+
+
+/*
+ * Parse the whole lines of one range of the cleartext into a block of entries owned by the job.
+ * Malformed lines are skipped, running out of memory stops the job with out_of_memory set
+ *
+ * param void* arg: The struct parse_job
+ * return void*: NULL
+ */
+static void *parse_range(void *arg) {
+    struct parse_job *job = arg;
+    char *line = job->begin;
+    char *next_line;
+    while (!job->out_of_memory && line < job->end && (next_line = memchr(line, '\n', job->end - line)) != NULL) {
+        *next_line = '\0';
+        struct password *entry = parse_password_line(line, job->version, &job->out_of_memory);
+        line = next_line + 1;
+        if (!entry)
+            continue;
+        if (job->count == job->capacity) {
+            const int new_capacity = job->capacity ? 2 * job->capacity : DEFAULT_CAPACITY;
+            struct password **entries = realloc(job->entries, new_capacity * sizeof(struct password *));
+            if (!entries) {
+                free_password(entry);
+                job->out_of_memory = true;
+                break;
+            }
+            job->entries = entries;
+            job->capacity = new_capacity;
+        }
+        job->entries[job->count++] = entry;
+    }
+    return NULL;
+}
+
+
+/*
+ * Reads all stored passwords in the given file on all available processors.
+ * See read_passwords_with_threads
  *
  * param const char* input: Character array containing the cleartext file contents
  * param int* curr_size: Pointer to the integer where the current size of the array is stored
  * return struct password**: Array of pointers to password structs
  */
 struct password **read_passwords(const char *input, int *curr_size) {
-    struct password **p_passwords = calloc(DEFAULT_CAPACITY, sizeof(struct password *));
+    return read_passwords_with_threads(input, curr_size, available_threads());
+}
+
+
+/*
+ * Reads all stored passwords in the given file.
+ * If the file exists, skip the first line, because this is holding the password requirements
+ * and the format version, and the policy lines following it. The remaining lines are cut into
+ * one range per thread at line boundaries, every thread parses its range into its own block of
+ * entries and the blocks are joined in file order, so the result does not depend on the number
+ * of threads.
+ * The input is copied once and split in place.
+ *
+ * param const char* input: Character array containing the cleartext file contents
+ * param int* curr_size: Pointer to the integer where the current size of the array is stored
+ * param int num_threads: Most threads to parse with, inputs below MIN_PARSE_BYTES_PER_THREAD use one
+ * return struct password**: Array of pointers to password structs, NULL if memory ran out for any entry
+ */
+struct password **read_passwords_with_threads(const char *input, int *curr_size, int num_threads) {
     *curr_size = 0;
     // If there are no passwords yet, return empty array
     if (!input || *input == '\0') {
-        return p_passwords;
+        return calloc(DEFAULT_CAPACITY, sizeof(struct password *));
+    }
+    const size_t length = strlen(input);
+    char *temp = secure_malloc(length + 1);
+    if (!temp)
+        return NULL;
+    char *next_line = memchr(input, '\n', length);
+    if (!next_line) {
+        secure_free(temp);
+        return calloc(DEFAULT_CAPACITY, sizeof(struct password *));
     }
-    char *temp = strdup(input);
+    memcpy(temp, input, length + 1);
+    next_line = temp + (next_line - input);
+    *next_line = '\0';
 
-    char *line = temp;
-    char *next_line;
-    next_line = strchr(line, '\n');
-    line = next_line + 1;
+    // The fifth token of the requirement line holds the format version, files without it are version 1.
+    // Since version 4 the seventh token counts the policy lines between the requirement and the entries
+    int version = 1;
+    int num_policies = 0;
+    char *cursor = temp;
+    for (int i = 0; i < 7; i++) {
+        const char *token = next_field(&cursor, 1);
+        if (i == 4 && token)
+            version = atoi(token);
+        if (i == 6 && token && version >= 4)
+            num_policies = atoi(token);
+    }
 
-    // Loop through each line
-    while ((next_line = strchr(line, '\n')) != NULL) {
-        *next_line = '\0';
-        char *words = strdup(line);
-        const size_t len = strlen(words);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
+    char *body = next_line + 1;
+    char *const end = temp + length;
+    for (int i = 0; i < num_policies && body < end; i++) {
+        char *policy_end = memchr(body, '\n', end - body);
+        body = policy_end ? policy_end + 1 : end;
+    }
+    const size_t body_length = (size_t) (end - body);
+    if ((size_t) num_threads > body_length / MIN_PARSE_BYTES_PER_THREAD)
+        num_threads = (int) (body_length / MIN_PARSE_BYTES_PER_THREAD);
+    if (num_threads > MAX_THREADS)
+        num_threads = MAX_THREADS;
+    if (num_threads < 1)
+        num_threads = 1;
+
+    // Every range ends behind a newline, so no line is split between two threads
+    struct parse_job jobs[MAX_THREADS] = {0};
+    char *begin = body;
+    for (int t = 0; t < num_threads; t++) {
+        char *range_end = end;
+        if (t < num_threads - 1) {
+            char *target = body + body_length / num_threads * (t + 1);
+            if (target < begin)
+                target = begin;
+            char *newline = memchr(target, '\n', end - target);
+            range_end = newline ? newline + 1 : end;
         }
-        const char *name = strtok(words, " ");
-        const char *username = strtok(NULL, " ");
-        const char *password = strtok(NULL, " ");
-        add_password(&p_passwords, curr_size, name, username, password);
-        line = next_line + 1; // Move to the next line
-        free(words);
+        jobs[t].begin = begin;
+        jobs[t].end = range_end;
+        jobs[t].version = version;
+        begin = range_end;
     }
+    run_jobs(parse_range, jobs, sizeof(struct parse_job), num_threads);
 
-    free(temp);
+    // A vault missing some of its entries would drop them on the next save, so it is not loaded at all
+    size_t total = 0;
+    bool complete = true;
+    for (int t = 0; t < num_threads; t++) {
+        total += jobs[t].count;
+        complete = complete && !jobs[t].out_of_memory;
+    }
+    // Keep the capacity invariant of add_password, a power of two of at least DEFAULT_CAPACITY
+    size_t capacity = DEFAULT_CAPACITY;
+    while (capacity < total)
+        capacity *= 2;
+    struct password **p_passwords = complete && total <= INT_MAX ? calloc(capacity, sizeof(struct password *)) : NULL;
+    for (int t = 0; t < num_threads; t++) {
+        if (p_passwords && jobs[t].count > 0) {
+            memcpy(p_passwords + *curr_size, jobs[t].entries, jobs[t].count * sizeof(struct password *));
+            *curr_size += jobs[t].count;
+        } else {
+            free_passwords(jobs[t].entries, jobs[t].count);
+        }
+        free(jobs[t].entries);
+    }
+
+    secure_free(temp);
     return p_passwords;
 }
 
 
+/*
+ * Parse one policy line of the cleartext, the line is split in place
+ *
+ * param char* line: The NUL terminated line
+ * param struct password_policy* policy: Receives the compiled policy, free it with free_policy_fields
+ * return bool: false if the line is malformed or memory ran out
+ */
+static bool parse_policy_line(char *line, struct password_policy *policy) {
+    char *cursor = line;
+    const char *fields[POLICY_FIELDS];
+    for (int i = 0; i < POLICY_FIELDS; i++) {
+        fields[i] = next_field(&cursor, VAULT_FORMAT_VERSION);
+        if (!fields[i])
+            return false;
+    }
+    // Version 6 appends the maximum age
+    const char *max_age = next_field(&cursor, VAULT_FORMAT_VERSION);
+    memset(policy, 0, sizeof(struct password_policy));
+    policy->max_age = max_age ? atoi(max_age) : 0;
+    policy->length = atoi(fields[1]);
+    policy->max_length = atoi(fields[2]);
+    for (int k = 0; k < NUM_COUNTED_CLASSES; k++)
+        policy->minimum[k] = atoi(fields[3 + k]);
+    policy->min_strength = atoi(fields[3 + NUM_COUNTED_CLASSES]);
+    char **texts[] = {&policy->name, &policy->allowed, &policy->required, &policy->folders, &policy->entries};
+    for (int i = 0; i < 5; i++) {
+        const char *field = fields[i == 0 ? 0 : 3 + NUM_COUNTED_CLASSES + i];
+        if ((i == 0 || *field) && !(*texts[i] = strdup(field)))
+            return false;
+    }
+    return compile_password_policy(policy);
+}
+
+
 /*
  * Read the password requirement saved in the password file.
  * If none has been defined yet, a default is returned.
- * Default = (length: 12, uppercased letters: 1, digits: 1, special characters: 1)
+ * Default = (length: 12, uppercased letters: 1, digits: 1, special characters: 1, strength score: 3)
+ * Since version 4 the seventh token holds the number of policy lines following the requirement line,
+ * since version 6 the eighth the maximum password age in days
  *
  * param const char* input: Character array containing the cleartext file contents
- * return struct password_requirement*: Pointer to the struct containing the defined password requirements
+ * return struct password_requirement*: Pointer to the struct containing the defined password requirements,
+ * NULL if memory ran out
 */
 struct password_requirement *read_password_requirement(const char *input) {
     struct password_requirement *p_requirement = calloc(1, sizeof(struct password_requirement));
+    if (!p_requirement) {
+        return NULL;
+    }
     p_requirement->length = 12;
     p_requirement->uppercased = 1;
     p_requirement->digits = 1;
     p_requirement->special_characters = 1;
+    p_requirement->min_strength = 3;
 
     // If there is no requirement set, return default requirement
     if (!input) {
         return p_requirement;
     }
-    char *temp = strdup(input);
+    // Only copy the requirement line, the rest of the input holds the cleartext entries
+    char *temp = strndup(input, strcspn(input, "\n"));
+    if (!temp) {
+        return p_requirement;
+    }
 
     // Parse the line for integers separated by spaces
-    char *line = strtok(temp, "\n");
-    const char *token = strtok(line, " ");
+    const char *token = strtok(temp, " ");
     if (token) p_requirement->length = atoi(token);
     token = strtok(NULL, " ");
     if (token) p_requirement->uppercased = atoi(token);
@@ -302,49 +1265,194 @@ struct password_requirement *read_password_requirement(const char *input) {
     if (token) p_requirement->digits = atoi(token);
     token = strtok(NULL, " ");
     if (token) p_requirement->special_characters = atoi(token);
+    // The fifth token is the format version, the sixth the minimum strength added after version 2
+    token = strtok(NULL, " ");
+    if (token) token = strtok(NULL, " ");
+    if (token) p_requirement->min_strength = atoi(token);
+    if (token) token = strtok(NULL, " ");
+    const int num_policies = token ? atoi(token) : 0;
+    // Version 6 appends the maximum age
+    if (token) token = strtok(NULL, " ");
+    if (token) p_requirement->max_age = atoi(token);
     free(temp);
+
+    const char *line = strchr(input, '\n');
+    if (num_policies > 0 && num_policies <= MAX_POLICIES) {
+        p_requirement->policies = calloc(num_policies, sizeof(struct password_policy));
+        p_requirement->unreadable_policies = calloc(num_policies, sizeof(char *));
+        if (!p_requirement->policies || !p_requirement->unreadable_policies) {
+            free_password_requirement(p_requirement);
+            return NULL;
+        }
+    }
+    for (int i = 0; p_requirement->policies && line && i < num_policies; i++) {
+        line++;
+        const size_t line_length = strcspn(line, "\n");
+        char *policy_line = strndup(line, line_length);
+        char *raw_line = strndup(line, line_length);
+        struct password_policy *policy = &p_requirement->policies[p_requirement->num_policies];
+        if (!policy_line || !raw_line) {
+            free(policy_line);
+            free(raw_line);
+            free_password_requirement(p_requirement);
+            return NULL;
+        }
+        // Policies that do not compile any more are kept verbatim, so saving does not drop them.
+        // Their entries follow the requirement meanwhile
+        if (parse_policy_line(policy_line, policy)) {
+            p_requirement->num_policies++;
+            free(raw_line);
+        } else {
+            free_policy_fields(policy);
+            p_requirement->unreadable_policies[p_requirement->num_unreadable_policies++] = raw_line;
+        }
+        free(policy_line);
+        line = strchr(line, '\n');
+    }
     return p_requirement;
 }
 
 
 /*
- * Saves the given password requirement to the open file stream
+ * Free a requirement, its policies and the policy lines kept verbatim
+ *
+ * param struct password_requirement* requirement: The requirement, may be NULL
+ */
+void free_password_requirement(struct password_requirement *requirement) {
+    if (!requirement)
+        return;
+    for (int i = 0; i < requirement->num_policies; i++)
+        free_policy_fields(&requirement->policies[i]);
+    free(requirement->policies);
+    for (int i = 0; i < requirement->num_unreadable_policies; i++)
+        free(requirement->unreadable_policies[i]);
+    free(requirement->unreadable_policies);
+    free(requirement);
+}
+
+
+/*
+ * Append a field to the output buffer, escaping characters that would break the line format.
+ * The buffer is grown geometrically, so serializing n entries stays linear
  *
- * param struct password_requirement* requirement: Pointer to the current password requirement
- * return char*: Character array displaying the password requirement as string
+ * param char** output: Pointer to the output buffer
+ * param size_t* length: Pointer to the number of used bytes in the buffer
+ * param size_t* size: Pointer to the allocated size of the buffer
+ * param const char* field: The field to append
+ * param char separator: Character written after the field
+ * return bool: false if the buffer could not be grown
  */
-char * get_password_requirement(struct password_requirement *requirement) {
-    char buffer[50];
-    const int len_length = snprintf(buffer, sizeof(buffer), "%d", requirement->length);
-    const int len_digits = snprintf(buffer, sizeof(buffer), "%d", requirement->digits);
-    const int len_uppercased = snprintf(buffer, sizeof(buffer), "%d", requirement->uppercased);
-    const int len_special = snprintf(buffer, sizeof(buffer), "%d", requirement->special_characters);
+static bool append_field(char **output, size_t *length, size_t *size, const char *field, const char separator) {
+    const size_t field_length = strlen(field);
+    // Worst case every character is escaped, plus separator and '\0'
+    const size_t needed = *length + 2 * field_length + 2;
+    if (needed > *size) {
+        size_t new_size = *size * 2;
+        while (new_size < needed)
+            new_size *= 2;
+        char *temp = secure_realloc(*output, new_size);
+        if (!temp) {
+            return false;
+        }
+        *output = temp;
+        *size = new_size;
+    }
+    char *write = *output + *length;
+    for (const char *c = field; *c; c++) {
+        switch (*c) {
+            case ' ': *write++ = '\\'; *write++ = 's'; break;
+            case '\n': *write++ = '\\'; *write++ = 'n'; break;
+            case '\r': *write++ = '\\'; *write++ = 'r'; break;
+            case '\t': *write++ = '\\'; *write++ = 't'; break;
+            case '\\': *write++ = '\\'; *write++ = '\\'; break;
+            default: *write++ = *c;
+        }
+    }
+    *write++ = separator;
+    *write = '\0';
+    *length = write - *output;
+    return true;
+}
 
-    // Total length: sum of lengths + 3 spaces + 1 for '\0'
-    const size_t size = len_length + len_digits + len_uppercased + len_special + 5;
 
-    char * output = calloc(size, sizeof(char));
+/*
+ * Serialize the password requirement and the format version, followed by one line per policy
+ *
+ * param const struct password_requirement* requirement: Pointer to the current password requirement
+ * return char*: The requirement lines on the secure heap, NULL if memory ran out
+ */
+char *get_password_requirement(const struct password_requirement *requirement) {
+    size_t size = 128;
+    char *output = secure_malloc(size);
     if (!output) {
-        perror("Failed to allocate memory for password_requirement");
         return NULL;
     }
-
-    // Format the string as space-separated integers
-    snprintf(
+    size_t length = (size_t) snprintf(
         output,
         size,
-        "%d %d %d %d\n",
+        "%d %d %d %d %d %d %d %d\n",
         requirement->length,
         requirement->uppercased,
         requirement->digits,
-        requirement->special_characters);
+        requirement->special_characters,
+        VAULT_FORMAT_VERSION,
+        requirement->min_strength,
+        requirement->num_policies + requirement->num_unreadable_policies,
+        requirement->max_age);
+
+    bool failed = false;
+    for (int i = 0; i < requirement->num_policies && !failed; i++) {
+        const struct password_policy *policy = &requirement->policies[i];
+        failed = !append_field(&output, &length, &size, policy->name, ' ');
+        const int numbers[] = {
+            policy->length, policy->max_length, policy->minimum[0], policy->minimum[1], policy->minimum[2],
+            policy->minimum[3], policy->min_strength
+        };
+        for (size_t n = 0; n < sizeof(numbers) / sizeof(numbers[0]) && !failed; n++) {
+            char number[16];
+            snprintf(number, sizeof(number), "%d", numbers[n]);
+            failed = !append_field(&output, &length, &size, number, ' ');
+        }
+        failed = failed ||
+            !append_field(&output, &length, &size, policy->allowed ? policy->allowed : "", ' ') ||
+            !append_field(&output, &length, &size, policy->required ? policy->required : "", ' ') ||
+            !append_field(&output, &length, &size, policy->folders ? policy->folders : "", ' ') ||
+            !append_field(&output, &length, &size, policy->entries ? policy->entries : "", ' ');
+        if (!failed) {
+            char max_age[16];
+            snprintf(max_age, sizeof(max_age), "%d", policy->max_age);
+            failed = !append_field(&output, &length, &size, max_age, '\n');
+        }
+    }
+    // Lines that did not compile are written as read, they are escaped already
+    for (int i = 0; i < requirement->num_unreadable_policies && !failed; i++) {
+        const char *raw_line = requirement->unreadable_policies[i];
+        const size_t needed = length + strlen(raw_line) + 2;
+        if (needed > size) {
+            size_t new_size = size * 2;
+            while (new_size < needed)
+                new_size *= 2;
+            char *temp = secure_realloc(output, new_size);
+            failed = temp == NULL;
+            if (temp) {
+                output = temp;
+                size = new_size;
+            }
+        }
+        if (!failed)
+            length += (size_t) snprintf(output + length, size - length, "%s\n", raw_line);
+    }
+    if (failed) {
+        secure_free(output);
+        return NULL;
+    }
     return output;
 }
 
 
 /*
- * Saves the passwords in the array to the open file stream
- * After saving each password, the memory used in the password struct pointer is freed
+ * Serialize the passwords in the array, one entry per line. The entries are left untouched,
+ * so the vault stays usable after saving
  *
  * param struct passwords** passwords: Array of password struct pointers
  * param const int* curr_size: Current size of the password array
@@ -352,60 +1460,55 @@ char * get_password_requirement(struct password_requirement *requirement) {
  */
 char * get_passwords(struct password **passwords, const int *curr_size) {
     size_t size = 1024;
-    char *output= calloc(size, sizeof(char));
+    size_t length = 0;
+    char *output = secure_malloc(size);
     if (!output) {
-        perror("Failed to allocate memory for password_requirement");
         return NULL;
     }
     output[0] = '\0';
-    struct password **ptr = passwords;
-    for (int i = 0; i < *curr_size; i++, ptr++) {
-        if (*ptr != NULL) {
-            // Calculate the required buffer size (2 for space, 1 for '\0')
-            const size_t length = strlen((*ptr)->name) + strlen((*ptr)->username) + strlen((*ptr)->password) + 4;
-            char *pw = malloc(length);
-            if (!pw) {
-                free((*ptr)->name);
-                free((*ptr)->username);
-                free((*ptr)->password);
-                free(*ptr);
-                continue;
+    bool failed = false;
+    for (int i = 0; i < *curr_size && !failed; i++) {
+        const struct password *entry = passwords[i];
+        if (entry != NULL) {
+            char created[24] = "", changed[24] = "";
+            if (entry->created || entry->changed) {
+                snprintf(created, sizeof(created), "%lld", entry->created);
+                snprintf(changed, sizeof(changed), "%lld", entry->changed);
             }
-            snprintf(pw, length, "%s %s %s\n", (*ptr)->name, (*ptr)->username, (*ptr)->password);
-
-            free((*ptr)->name);
-            free((*ptr)->username);
-            free((*ptr)->password);
-            free(*ptr);
-            if (strlen(pw) + strlen(output) + 1 > size) {
-                size *= 2;
-                char * temp = realloc(output, size);
-                if (!temp) {
-                    perror("Failed to resize array");
-                    free(pw);
-                    free(output);
-                    return NULL;
-                }
-                output = temp;
-                free(temp);
+            // The optional fields are written up to the last one the entry has, the others stay empty
+            const char *optional[] = {
+                entry->previous_password, entry->folder, entry->tags, entry->attachments, created, changed
+            };
+            int num_optional = sizeof(optional) / sizeof(optional[0]);
+            while (num_optional > 0 && (!optional[num_optional - 1] || !*optional[num_optional - 1]))
+                num_optional--;
+            failed = !append_field(&output, &length, &size, entry->name, ' ') ||
+                !append_field(&output, &length, &size, entry->username, ' ') ||
+                !append_field(&output, &length, &size, entry->password, num_optional > 0 ? ' ' : '\n');
+            for (int field = 0; field < num_optional && !failed; field++) {
+                failed = !append_field(&output, &length, &size, optional[field] ? optional[field] : "",
+                    field + 1 < num_optional ? ' ' : '\n');
             }
-            strcat(output, pw);
-            free(pw);
         }
     }
+    if (failed) {
+        secure_free(output);
+        return NULL;
+    }
     return output;
 }
 
 
 /*
- * Saves the password requirement and the passwords to a given file.
- * Frees all memory used in the password struct pointers
+ * Serialize the password requirement and the passwords into the cleartext vault format
  *
  * param struct password_requirement* requirements: Pointer to the current password requirement struct
  * param struct password** passwords: Array of password struct pointers
  * param const int* curr_size: Pointer to the integer holding the current array size
+ * param char** output: Receives the cleartext, allocated on the secure heap
+ * return bool: false if memory ran out
  */
-void save_passwords_and_requirements(
+bool save_passwords_and_requirements(
     struct password_requirement *requirements,
     struct password **passwords,
     const int *curr_size,
@@ -413,48 +1516,60 @@ void save_passwords_and_requirements(
     char *req = get_password_requirement(requirements);
     char *pwd = get_passwords(passwords, curr_size);
     if (!req || !pwd) {
-        perror("Failed to allocate memory for password_requirement");
-        free(req);
-        free(pwd);
-        return;
+        secure_free(req);
+        secure_free(pwd);
+        return false;
+    }
+    const size_t req_length = strlen(req);
+    const size_t pwd_length = strlen(pwd);
+    *output = secure_malloc(req_length + pwd_length + 1);
+    if (*output) {
+        memcpy(*output, req, req_length);
+        memcpy(*output + req_length, pwd, pwd_length + 1);
     }
-    *output = calloc(strlen(req) + strlen(pwd) + 1, sizeof(char));
-    strcat(*output, req);
-    strcat(*output, pwd);
-    free(req);
-    free(pwd);
+    secure_free(req);
+    secure_free(pwd);
+    return *output != NULL;
 }
 
 /*
- * Check whether a given password meets the requirements
+ * Check whether a given password meets the vault requirement
  *
  * param const char* password: Character array containing the password in question
  * param const struct* password_requirement: Point to given password_requirement struct
  * return int: 1 if password is valid, else 0
  */
 int is_valid_password(const char *password, const struct password_requirement *requirement) {
-    const int length = strlen(password);
-    int num_uppercased = 0, num_digits = 0, num_special_characters = 0;
+    struct password_rules rules;
+    get_policy_rules(requirement, -1, &rules);
+    return meets_password_rules(password, &rules);
+}
 
-    if (length < requirement->length) {
-        return 0;  // Password is too short
-    }
 
-    // Count the required character types in the password
-    for (int i = 0; i < length; i++) {
-        if (isupper(password[i])) {
-            num_uppercased++;
-        } else if (isdigit(password[i])) {
-            num_digits++;
-        } else if (strchr(special_characters, password[i]) != NULL) {
-            num_special_characters++;
-        }
+/*
+ * Check whether a password meets the rules of the vault requirement or a policy. Every character
+ * costs one bitmap lookup per class, whichever rules apply
+ *
+ * param const char* password: The password in question
+ * param const struct password_rules* rules: The rules, see get_password_rules
+ * return bool: true if the password is long enough, not too long, only uses allowed characters and
+ *              contains enough characters of every class
+ */
+bool meets_password_rules(const char *password, const struct password_rules *rules) {
+    const struct compiled_policy *compiled = rules->compiled;
+    int counts[NUM_COUNTED_CLASSES] = {0};
+    int length = 0;
+    for (const unsigned char *c = (const unsigned char *) password; *c; c++, length++) {
+        if (!class_contains(&compiled->allowed, *c))
+            return false;
+        for (int k = 0; k < NUM_COUNTED_CLASSES; k++)
+            counts[k] += class_contains(&compiled->counted[k], *c);
     }
-
-    // Check if the password meets the requirements
-    if (num_uppercased >= requirement->uppercased && num_digits >= requirement->digits && num_special_characters >= requirement->special_characters) {
-        return 1;  // Password is valid
+    if (length < rules->length || (rules->max_length > 0 && length > rules->max_length))
+        return false;
+    for (int k = 0; k < NUM_COUNTED_CLASSES; k++) {
+        if (counts[k] < rules->minimum[k])
+            return false;
     }
-
-    return 0;  // Password is invalid
+    return true;
 }
@@ -5,12 +5,93 @@
 #ifndef PASSWORD_H
 #define PASSWORD_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define DEFAULT_CAPACITY 32
+// Version 2 escapes spaces, newlines and backslashes in the fields of each entry,
+// version 3 adds the folder and the tags of an entry after the previous password,
+// version 4 adds the number of named policies to the requirement line, one policy per line follows it,
+// version 5 adds the references to the attachments of an entry after the tags,
+// version 6 adds the maximum password age to the requirement line and each policy, and the time
+// an entry was created and its password last changed after the attachments
+#define VAULT_FORMAT_VERSION 6
+#define MAX_POLICIES 64
+// Separator of the tags of an entry and of the levels of a folder path
+#define TAG_SEPARATOR ','
+#define FOLDER_SEPARATOR '/'
+// Cleartext bytes below which read_passwords does not start another thread
+#define MIN_PARSE_BYTES_PER_THREAD (256 * 1024)
+// Compact the array once at least 1 / COMPACTION_RATIO of its slots are tombstones
+#define COMPACTION_RATIO 4
 
 struct password {
     char* name;
     char* username;
     char* password;
+    char* previous_password; // Value before the last rotation in vaults from before the history file, NULL otherwise
+    char* folder;            // Folder path such as "work/db", NULL for the top level
+    char* tags;              // Sorted, unique, comma separated tags, NULL if the entry has none
+    char* attachments;       // Comma separated ID:SIZE:LABEL references into the attachment file, NULL if none
+    long long created;         // Unix time the entry was added, 0 if unknown (added before version 6)
+    long long changed;         // Unix time the password was last set, 0 if unknown
+    unsigned int access_count; // Times the password was shown, kept in the access file next to the vault
+    long long last_access;     // Unix time it was last shown, 0 if never
+    int expiry_position;       // Position in an expiry index plus one, 0 if the entry is not indexed
+};
+
+// Changes reported to a password listener
+enum password_change {
+    PASSWORD_ADDED,
+    PASSWORD_CHANGED,
+    PASSWORD_REMOVED  // Reported before the entry is freed
+};
+
+// Told about the entries a function adds, changes or deletes, e.g. to keep an index of the session current.
+// Functions that edit an array take it as a parameter, NULL if nobody listens
+struct password_listener {
+    void (*notify)(struct password *entry, enum password_change change, void *context);
+    void *context;
+};
+
+typedef bool (*password_predicate)(const struct password *entry, const void *context);
+
+// Character classes whose occurrences a requirement or policy counts
+enum character_class_id {
+    CLASS_DIGIT,
+    CLASS_SPECIAL,
+    CLASS_UPPERCASE,
+    CLASS_CUSTOM, // The required characters of a policy
+    NUM_COUNTED_CLASSES
+};
+
+// Set of byte values, one bit per value
+struct character_class {
+    uint64_t bits[4];
+};
+
+// Character sets of a policy, compiled once so validating and generating cost the same for every policy
+struct compiled_policy {
+    struct character_class allowed;
+    struct character_class counted[NUM_COUNTED_CLASSES];
+    // Generated passwords draw the required characters of each class from its alphabet and fill up from the last one
+    char alphabets[NUM_COUNTED_CLASSES + 1][256];
+    int alphabet_lengths[NUM_COUNTED_CLASSES + 1];
+};
+
+// Named rules for entries that cannot follow the vault requirement, e.g. systems limiting the length
+struct password_policy {
+    char *name;
+    int length;                        // Minimum length
+    int max_length;                    // Maximum length, 0 for none
+    int minimum[NUM_COUNTED_CLASSES];  // Characters required of each class
+    int min_strength;
+    int max_age;    // Days a password may be kept, 0 for no limit
+    char *allowed;  // Allowed characters with ranges such as "a-zA-Z0-9_", NULL allows every character
+    char *required; // Characters of the custom class, NULL if the policy has none
+    char *folders;  // Comma separated folders the policy applies to, including their subfolders, NULL if none
+    char *entries;  // Comma separated name patterns of the entries it applies to, NULL if none
+    struct compiled_policy compiled;
 };
 
 struct password_requirement {
@@ -18,21 +99,75 @@ struct password_requirement {
     int uppercased;
     int digits;
     int special_characters;
+    int min_strength; // Minimum strength score (0-4) of added passwords, see strength.h
+    int max_age;      // Days a password may be kept, 0 for no limit
+    struct password_policy *policies; // Named policies, entries they do not apply to follow the fields above
+    int num_policies;
+    char **unreadable_policies; // Policy lines that no longer compile, saved back unchanged
+    int num_unreadable_policies;
+};
+
+// What the password of an entry has to meet, resolved from its policy or the vault requirement
+struct password_rules {
+    const char *policy; // Name of the policy, NULL for the vault requirement
+    const struct compiled_policy *compiled;
+    int length;
+    int max_length;
+    int minimum[NUM_COUNTED_CLASSES];
+    int min_strength;
+    int max_age;
 };
 
-char* read_password();
 char* generate_password(const struct password_requirement* requirement);
-void add_password(
+char** generate_passwords(const struct password_requirement* requirement, int count);
+char **generate_passwords_with_rules(const struct password_rules *rules, int count);
+char *generate_password_with_rules(const struct password_rules *rules);
+bool add_password(
     struct password ***arr,
     int *curr_size,
     const char *name,
     const char* username,
-    const char *password);
-void delete_password(struct password*** arr, int index);
-void change_password(struct password*** arr, const int* index, const char* password);
+    const char *password,
+    const struct password_listener *listener);
+void delete_password(struct password*** arr, int index, const struct password_listener *listener);
+void free_passwords(struct password **arr, int curr_size);
+int delete_passwords_if(
+    struct password ***arr,
+    int *curr_size,
+    password_predicate predicate,
+    const void *context,
+    const struct password_listener *listener);
+bool password_name_matches(const struct password *entry, const void *pattern);
+int compact_passwords(struct password **arr, int *curr_size);
+int count_live_passwords(struct password **arr, int curr_size);
+int find_password_slot(struct password **arr, int curr_size, int ordinal);
+bool change_password(
+    struct password*** arr,
+    const int* index,
+    const char* password,
+    const struct password_listener *listener);
+void stamp_password_change(struct password *entry, const struct password_listener *listener);
+void report_password_change(
+    const struct password_listener *listener,
+    struct password *entry,
+    enum password_change change);
+bool set_password_folder(struct password *entry, const char *folder);
+bool set_password_tags(struct password *entry, const char *tags);
+bool edit_password_tags(struct password *entry, const char *tag, bool add);
+bool password_has_tag(const struct password *entry, const char *tag);
 struct password** read_passwords(const char* file_name, int* curr_size);
+struct password **read_passwords_with_threads(const char *input, int *curr_size, int num_threads);
 struct password_requirement* read_password_requirement(const char* file_name);
-void save_passwords_and_requirements(
+char *get_password_requirement(const struct password_requirement *requirement);
+void free_password_requirement(struct password_requirement *requirement);
+bool compile_password_policy(struct password_policy *policy);
+bool set_password_policy(struct password_requirement *requirement, const struct password_policy *policy);
+bool delete_password_policy(struct password_requirement *requirement, const char *name);
+int find_password_policy(const struct password_requirement *requirement, const struct password *entry);
+void get_policy_rules(const struct password_requirement *requirement, int policy, struct password_rules *rules);
+void get_password_rules(const struct password_requirement *requirement, const struct password *entry, struct password_rules *rules);
+bool meets_password_rules(const char *password, const struct password_rules *rules);
+bool save_passwords_and_requirements(
     struct password_requirement* requirements,
     struct password** passwords,
     const int* curr_size,
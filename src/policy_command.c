@@ -0,0 +1,214 @@
+#include "commands.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "expiry.h"
+#include "password.h"
+
+
+/*
+ * Join the values of all occurrences of an option with commas
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const char* option: The option, e.g. --folder
+ * param char** joined: Receives the joined values, NULL if the option is not given
+ * return bool: false if memory ran out
+ */
+static bool join_option_values(const int argc, char *argv[], const char *option, char **joined) {
+    size_t length = 0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], option) == 0)
+            length += strlen(argv[++i]) + 1;
+    }
+    *joined = NULL;
+    if (length == 0)
+        return true;
+    *joined = malloc(length);
+    if (!*joined)
+        return false;
+    (*joined)[0] = '\0';
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], option) == 0) {
+            if ((*joined)[0])
+                strcat(*joined, ",");
+            strcat(*joined, argv[++i]);
+        }
+    }
+    return true;
+}
+
+
+/*
+ * Print the limits of the vault requirement or a policy
+ */
+static void print_rules(const struct password_rules *rules, const int num_entries, const int num_noncompliant) {
+    printf("  length %d", rules->length);
+    if (rules->max_length > 0)
+        printf("-%d", rules->max_length);
+    printf(", %d digit(s), %d special, %d uppercase", rules->minimum[CLASS_DIGIT], rules->minimum[CLASS_SPECIAL],
+        rules->minimum[CLASS_UPPERCASE]);
+    if (rules->minimum[CLASS_CUSTOM] > 0)
+        printf(", %d custom", rules->minimum[CLASS_CUSTOM]);
+    printf(", strength %d", rules->min_strength);
+    if (rules->max_age > 0)
+        printf(", max age %d days", rules->max_age);
+    printf("; %d entries, %d not compliant\n", num_entries, num_noncompliant);
+}
+
+
+/*
+ * Run the policy command: list the policies, or define or delete one
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+int run_policy(
+    const int argc,
+    char *argv[],
+    struct password **passwords,
+    const int num_passwords,
+    struct password_requirement *requirement,
+    bool *modified) {
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "list") == 0)) {
+        // One pass resolves the policy of every entry
+        int entries[MAX_POLICIES + 1] = {0};
+        int noncompliant[MAX_POLICIES + 1] = {0};
+        for (int i = 0; i < num_passwords; i++) {
+            if (!passwords[i])
+                continue;
+            const int policy = find_password_policy(requirement, passwords[i]);
+            struct password_rules rules;
+            get_policy_rules(requirement, policy, &rules);
+            entries[policy + 1]++;
+            noncompliant[policy + 1] += !meets_password_rules(passwords[i]->password, &rules);
+        }
+        for (int policy = -1; policy < requirement->num_policies; policy++) {
+            struct password_rules rules;
+            get_policy_rules(requirement, policy, &rules);
+            if (policy < 0) {
+                printf("Vault requirement:\n");
+            } else {
+                const struct password_policy *named = &requirement->policies[policy];
+                printf("%s:", named->name);
+                if (named->folders)
+                    printf(" folders %s", named->folders);
+                if (named->entries)
+                    printf(" entries %s", named->entries);
+                if (named->allowed)
+                    printf(" allowed '%s'", named->allowed);
+                if (named->required)
+                    printf(" custom '%s'", named->required);
+                printf("\n");
+            }
+            print_rules(&rules, entries[policy + 1], noncompliant[policy + 1]);
+        }
+        if (requirement->num_unreadable_policies > 0)
+            printf("%d policies could not be read and are kept unchanged, their entries follow the vault requirement\n",
+                requirement->num_unreadable_policies);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "delete") == 0) {
+        if (!delete_password_policy(requirement, argv[2])) {
+            printf("There is no policy %s\n", argv[2]);
+            return 1;
+        }
+        *modified = true;
+        printf("Policy %s deleted.\n", argv[2]);
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "max-age") == 0) {
+        char *end = NULL;
+        const long days = strtol(argv[2], &end, 10);
+        if (*end != '\0' || end == argv[2] || days < 0 || days > INT32_MAX / SECONDS_PER_DAY) {
+            printf("max-age needs a number of days, 0 for no limit\n");
+            return 2;
+        }
+        requirement->max_age = (int) days;
+        *modified = true;
+        printf("Maximum age of the vault requirement set to %ld days.\n", days);
+        return 0;
+    }
+    if (argc < 3 || strcmp(argv[1], "set") != 0) {
+        printf("Usage: policy [list] | policy set NAME [OPTIONS] | policy delete NAME | policy max-age DAYS\n");
+        return 2;
+    }
+
+    // Options that are not given keep the value of the existing policy or of the vault requirement
+    const char *name = argv[2];
+    struct password_policy policy = {0};
+    int index = 0;
+    while (index < requirement->num_policies && strcmp(requirement->policies[index].name, name) != 0)
+        index++;
+    if (index < requirement->num_policies) {
+        policy = requirement->policies[index];
+    } else {
+        struct password_rules rules;
+        get_policy_rules(requirement, -1, &rules);
+        policy.length = rules.length;
+        memcpy(policy.minimum, rules.minimum, sizeof(policy.minimum));
+        policy.min_strength = rules.min_strength;
+        policy.max_age = rules.max_age;
+    }
+    policy.name = (char *) name;
+    char *folders = NULL;
+    char *entries = NULL;
+    for (int i = 3; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--length") == 0 && has_value) {
+            policy.length = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-length") == 0 && has_value) {
+            policy.max_length = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--digits") == 0 && has_value) {
+            policy.minimum[CLASS_DIGIT] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--special") == 0 && has_value) {
+            policy.minimum[CLASS_SPECIAL] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--upper") == 0 && has_value) {
+            policy.minimum[CLASS_UPPERCASE] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--required-count") == 0 && has_value) {
+            policy.minimum[CLASS_CUSTOM] = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--strength") == 0 && has_value) {
+            policy.min_strength = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-age") == 0 && has_value) {
+            policy.max_age = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--allowed") == 0 && has_value) {
+            i++;
+            policy.allowed = *argv[i] ? argv[i] : NULL;
+        } else if (strcmp(argv[i], "--required") == 0 && has_value) {
+            i++;
+            policy.required = *argv[i] ? argv[i] : NULL;
+        } else if ((strcmp(argv[i], "--folder") == 0 || strcmp(argv[i], "--entry") == 0) && has_value) {
+            i++;
+        } else {
+            printf("Unknown option for policy set: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!join_option_values(argc, argv, "--folder", &folders) || !join_option_values(argc, argv, "--entry", &entries)) {
+        free(folders);
+        printf("Out of memory\n");
+        return 1;
+    }
+    // Given folders and entry patterns replace the previous ones
+    if (folders)
+        policy.folders = folders;
+    if (entries)
+        policy.entries = entries;
+    const bool set = set_password_policy(requirement, &policy);
+    free(folders);
+    free(entries);
+    if (!set) {
+        printf("Policy %s was not saved: its limits contradict each other, a character set is malformed\n", name);
+        printf("or there are %d policies already\n", MAX_POLICIES);
+        return 1;
+    }
+    *modified = true;
+    printf("Policy %s saved.\n", name);
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "rotation.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "util.h"
+#include "strength.h"
+#include "secure_heap.h"
+
+
+/*
+ * Check whether an entry is selected by the rotation filter.
+ * All criteria that are set must match
+ *
+ * param const struct password* entry: The entry to test
+ * param int index: Index of the entry in the password array
+ * param const struct rotation_filter* filter: The selection criteria
+ * param const struct password_requirement* requirement: The current password requirement used for audit criteria
+ * return bool: true if the entry should be rotated
+ */
+bool rotation_filter_matches(
+    const struct password *entry,
+    const int index,
+    const struct rotation_filter *filter,
+    const struct password_requirement *requirement) {
+    if (filter->name_pattern && !pattern_matches(filter->name_pattern, entry->name))
+        return false;
+    if (filter->username_pattern && !pattern_matches(filter->username_pattern, entry->username))
+        return false;
+    if (filter->noncompliant_only || filter->weak_only) {
+        struct password_rules rules;
+        get_password_rules(requirement, entry, &rules);
+        if (filter->noncompliant_only && meets_password_rules(entry->password, &rules))
+            return false;
+        if (filter->weak_only && rules.min_strength > 0) {
+            struct strength_result strength;
+            estimate_strength(entry->password, &strength);
+            if (strength.score >= rules.min_strength)
+                return false;
+        }
+    }
+    if (filter->breached_in && !is_password_breached(filter->breached_in, entry->password))
+        return false;
+    if (filter->reused) {
+        // The first entry of each group keeps its password, all others get a new one
+        const int group = filter->reused->group_of[index];
+        if (group < 0 || filter->reused->members[filter->reused->starts[group]] == index)
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * Write the rotated credentials as one JSON object per line
+ *
+ * param FILE* stream: The open report stream
+ * param const struct rotation_report* report: The credentials of the rotation
+ * return bool: false if the report could not be written
+ */
+bool write_rotation_report(FILE *stream, const struct rotation_report *report) {
+    for (int i = 0; i < report->count; i++) {
+        const struct rotated_credential *credential = &report->credentials[i];
+        fputs("{\"name\":", stream);
+        write_json_string(stream, credential->name);
+        fputs(",\"username\":", stream);
+        write_json_string(stream, credential->username);
+        fputs(",\"password\":", stream);
+        write_json_string(stream, credential->password);
+        fprintf(stream, ",\"rotated_at\":%lld}\n", report->rotated_at);
+    }
+    return fflush(stream) == 0 && !ferror(stream);
+}
+
+
+/*
+ * Release the credentials of a rotation report
+ *
+ * param struct rotation_report* report: The report, empty afterwards
+ */
+void free_rotation_report(struct rotation_report *report) {
+    for (int i = 0; report->credentials && i < report->count; i++) {
+        secure_free(report->credentials[i].name);
+        secure_free(report->credentials[i].username);
+        secure_free(report->credentials[i].password);
+    }
+    secure_free(report->credentials);
+    memset(report, 0, sizeof(struct rotation_report));
+}
+
+
+/*
+ * Rotate every password selected by the filter in a single pass over the array.
+ * The new passwords are created with one call to the bulk generator per policy in use, so the
+ * whole rotation only needs to be serialized and encrypted once by the caller.
+ * The new credentials are copied into the report, which the caller writes once the vault is saved
+ *
+ * param struct password** passwords: Array containing the password struct pointers, may contain tombstones
+ * param int num_passwords: The current size of the array
+ * param const struct rotation_filter* filter: Selects the entries to rotate
+ * param const struct password_requirement* requirement: Requirement and policies the new passwords are generated against
+ * param const struct breach_corpus* corpus: Generated passwords found in it are generated again, may be NULL
+ * param struct password_history* history: Keeps the replaced passwords, NULL discards them
+ * param struct rotation_report* report: Receives the rotated credentials, may be NULL
+ * return int: Number of rotated passwords or -1 if the passwords could not be generated or copied into the report,
+ *             the entries must not be saved then
+ */
+int rotate_passwords(
+    struct password **passwords,
+    const int num_passwords,
+    const struct rotation_filter *filter,
+    const struct password_requirement *requirement,
+    const struct breach_corpus *corpus,
+    struct password_history *history,
+    struct rotation_report *report) {
+    int *selected = malloc((num_passwords > 0 ? num_passwords : 1) * sizeof(int));
+    if (!selected) {
+        return -1;
+    }
+    int num_selected = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] != NULL && rotation_filter_matches(passwords[i], i, filter, requirement))
+            selected[num_selected++] = i;
+    }
+    if (num_selected == 0) {
+        free(selected);
+        return 0;
+    }
+
+    // Batch b holds the passwords of policy b - 1, batch 0 those following the vault requirement
+    int *batch_of = malloc(num_selected * sizeof(int));
+    int batch_sizes[MAX_POLICIES + 1] = {0};
+    int batch_used[MAX_POLICIES + 1] = {0};
+    char **batches[MAX_POLICIES + 1] = {NULL};
+    bool ok = batch_of != NULL;
+    if (ok && report) {
+        report->credentials = secure_malloc(num_selected * sizeof(struct rotated_credential));
+        ok = report->credentials != NULL;
+        if (ok)
+            memset(report->credentials, 0, num_selected * sizeof(struct rotated_credential));
+    }
+    for (int i = 0; ok && i < num_selected; i++) {
+        batch_of[i] = find_password_policy(requirement, passwords[selected[i]]) + 1;
+        batch_sizes[batch_of[i]]++;
+    }
+    for (int b = 0; ok && b <= requirement->num_policies; b++) {
+        if (batch_sizes[b] == 0)
+            continue;
+        struct password_rules rules;
+        get_policy_rules(requirement, b - 1, &rules);
+        batches[b] = generate_passwords_with_rules(&rules, batch_sizes[b]);
+        ok = batches[b] != NULL;
+        // A random password showing up in a breach corpus is extremely unlikely, but never hand one out
+        for (int i = 0; ok && i < batch_sizes[b]; i++) {
+            while (ok && is_password_breached(corpus, batches[b][i])) {
+                char *replacement = generate_password_with_rules(&rules);
+                ok = replacement != NULL;
+                if (ok) {
+                    secure_free(batches[b][i]);
+                    batches[b][i] = replacement;
+                }
+            }
+        }
+    }
+    if (!ok) {
+        for (int b = 0; b <= requirement->num_policies; b++) {
+            for (int i = 0; batches[b] && i < batch_sizes[b]; i++)
+                secure_free(batches[b][i]);
+            free(batches[b]);
+        }
+        if (report)
+            free_rotation_report(report);
+        free(batch_of);
+        free(selected);
+        return -1;
+    }
+
+    if (report)
+        report->rotated_at = (long long) time(NULL);
+    for (int i = 0; i < num_selected; i++) {
+        struct password *entry = passwords[selected[i]];
+        // The history replaces the previous password older vaults kept in the entry, it moves there first.
+        // Records are checked against the password that replaced them, which is still the current one here
+        if (entry->previous_password)
+            record_password_change(history, entry, entry->previous_password);
+        char *replaced = entry->password;
+        // Ownership of the generated string moves into the entry
+        entry->password = batches[batch_of[i]][batch_used[batch_of[i]]++];
+        stamp_password_change(entry, NULL);
+        record_password_change(history, entry, replaced);
+        secure_free(entry->previous_password);
+        entry->previous_password = NULL;
+        secure_free(replaced);
+        if (report) {
+            struct rotated_credential *credential = &report->credentials[report->count++];
+            credential->name = secure_strdup(entry->name);
+            credential->username = secure_strdup(entry->username);
+            credential->password = secure_strdup(entry->password);
+            ok = ok && credential->name && credential->username && credential->password;
+        }
+    }
+
+    for (int b = 0; b <= requirement->num_policies; b++)
+        free(batches[b]);
+    free(batch_of);
+    free(selected);
+    if (!ok)
+        free_rotation_report(report);
+    return ok ? num_selected : -1;
+}
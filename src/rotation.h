@@ -0,0 +1,50 @@
+#ifndef ROTATION_H
+#define ROTATION_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "password.h"
+#include "breach.h"
+#include "audit.h"
+#include "history.h"
+
+struct rotation_filter {
+    const char *name_pattern;     // Wildcard pattern on the entry name, NULL matches every name
+    const char *username_pattern; // Wildcard pattern on the username, NULL matches every username
+    bool noncompliant_only;       // Only select entries failing the current password requirement
+    bool weak_only;               // Only select entries below the minimum strength score of the requirement
+    const struct breach_corpus *breached_in; // Only select entries found in this breach corpus, NULL to ignore
+    const struct reuse_groups *reused; // Only select entries sharing their password with an earlier entry, NULL to ignore
+};
+
+// A credential rotate_passwords replaced the password of, the strings are on the secure heap
+struct rotated_credential {
+    char *name;
+    char *username;
+    char *password;
+};
+
+// The credentials of one rotation, only reported with write_rotation_report once the vault is saved
+struct rotation_report {
+    struct rotated_credential *credentials;
+    int count;
+    long long rotated_at;
+};
+
+bool rotation_filter_matches(
+    const struct password *entry,
+    int index,
+    const struct rotation_filter *filter,
+    const struct password_requirement *requirement);
+int rotate_passwords(
+    struct password **passwords,
+    int num_passwords,
+    const struct rotation_filter *filter,
+    const struct password_requirement *requirement,
+    const struct breach_corpus *corpus,
+    struct password_history *history,
+    struct rotation_report *report);
+bool write_rotation_report(FILE *stream, const struct rotation_report *report);
+void free_rotation_report(struct rotation_report *report);
+
+#endif //ROTATION_H
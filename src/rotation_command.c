@@ -0,0 +1,114 @@
+#include "commands.h"
+#include <stdio.h>
+#include <string.h>
+#include "audit.h"
+#include "breach.h"
+#include "history.h"
+#include "rotation.h"
+#include "util.h"
+
+
+/*
+ * Run the rotate command on the loaded vault
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param struct password_requirement* requirement: The current password requirement
+ * param bool* modified: Set to true if the vault has to be saved
+ * param struct command_output* output: Receives the report, written by finish_command once the vault is saved
+ * return int: Exit code of the command
+ */
+int run_rotate(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password **passwords,
+    const int num_passwords,
+    const struct password_requirement *requirement,
+    bool *modified,
+    struct command_output *output) {
+    struct rotation_filter filter = {0};
+    bool keep_history = false;
+    const char *report_file = NULL;
+
+    struct breach_corpus *corpus = NULL;
+    struct reuse_report reuse = {0};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            filter.name_pattern = argv[++i];
+        } else if (strcmp(argv[i], "--username") == 0 && i + 1 < argc) {
+            filter.username_pattern = argv[++i];
+        } else if (strcmp(argv[i], "--noncompliant") == 0) {
+            filter.noncompliant_only = true;
+        } else if (strcmp(argv[i], "--weak") == 0) {
+            filter.weak_only = true;
+        } else if (strcmp(argv[i], "--breached") == 0) {
+            if (!corpus)
+                corpus = open_breach_corpus(default_breach_corpus_path());
+            if (!corpus) {
+                printf("Failed to open breach corpus %s\n", default_breach_corpus_path());
+                return 1;
+            }
+            filter.breached_in = corpus;
+        } else if (strcmp(argv[i], "--reused") == 0) {
+            if (!filter.reused && !find_reused_passwords(passwords, num_passwords, false, &reuse)) {
+                printf("Failed to search for reused passwords\n");
+                close_breach_corpus(corpus);
+                return 1;
+            }
+            filter.reused = &reuse.exact;
+        } else if (strcmp(argv[i], "--keep-history") == 0) {
+            keep_history = true;
+        } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+            report_file = argv[++i];
+        } else {
+            printf("Unknown option for rotate: %s\n", argv[i]);
+            close_breach_corpus(corpus);
+            free_reuse_report(&reuse);
+            return 2;
+        }
+    }
+
+    // New passwords are checked against the breach corpus like those added in the menu, a missing corpus is no error
+    if (!corpus)
+        corpus = open_breach_corpus(default_breach_corpus_path());
+
+    // The report is created right away, so a bad path fails before anything is rotated. It stays empty
+    // until the vault is saved, a report of passwords that were never saved would lock out its reader
+    FILE *report = report_file ? create_private_file(report_file, "w") : stdout;
+    if (!report) {
+        perror("Failed to open report file");
+        close_breach_corpus(corpus);
+        free_reuse_report(&reuse);
+        return 1;
+    }
+
+    // Only --keep-history records the replaced passwords, a rotation after a breach has no use for them
+    struct password_history *history = keep_history ? open_password_history(source->path, source->vault_key) : NULL;
+    const int rotated = !keep_history || history ?
+        rotate_passwords(passwords, num_passwords, &filter, requirement, corpus, history, &output->rotation) : -1;
+    if (keep_history && !history) {
+        if (history_depth() == 0)
+            printf("--keep-history needs the password history, %s is 0\n", HISTORY_DEPTH_VARIABLE);
+        else
+            printf("Failed to open the password history of %s\n", source->path);
+    } else if (rotated < 0) {
+        printf("Failed to generate passwords. Ensure requirements are valid.\n");
+    }
+    if (!close_password_history(history))
+        printf("Failed to record the replaced passwords in the history\n");
+    close_breach_corpus(corpus);
+    free_reuse_report(&reuse);
+    output->report = report;
+    output->report_file = report_file;
+    if (rotated < 0) {
+        finish_command(output, false);
+        return 1;
+    }
+    if (rotated > 0)
+        *modified = true;
+    return 0;
+}
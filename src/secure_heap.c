@@ -0,0 +1,238 @@
+#include "secure_heap.h"
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Marks blocks handed out by the secure heap, freeing anything else is a bug
+#define BLOCK_MAGIC 0x53454352u
+// Size classes of 16, 32, ... SECURE_MAX_SMALL_SIZE bytes
+#define MIN_CLASS_SHIFT 4
+#define NUM_SIZE_CLASSES 9
+#define LARGE_CLASS UINT32_MAX
+
+struct block_header {
+    uint32_t magic;
+    uint32_t size_class; // LARGE_CLASS for blocks with a mapping of their own
+    uint64_t capacity;   // Usable bytes following the header
+};
+
+struct free_block {
+    struct free_block *next;
+};
+
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct free_block *free_lists[NUM_SIZE_CLASSES];
+static unsigned char *region_next;
+static unsigned char *region_end;
+
+
+/*
+ * Get the size of a memory page
+ *
+ * return size_t: The page size in bytes
+ */
+static size_t page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t) sysconf(_SC_PAGESIZE);
+#endif
+}
+
+
+/*
+ * Map memory that is locked into RAM and excluded from core dumps, surrounded by an
+ * inaccessible guard page on each side. Locking is best effort: if the limit for locked
+ * memory is reached, the memory is still excluded from core dumps and wiped on free.
+ *
+ * param size_t size: Number of usable bytes, a multiple of the page size
+ * return void*: The zeroed usable memory, NULL if it could not be mapped
+ */
+static void *map_secret_pages(const size_t size) {
+    const size_t page = page_size();
+#ifdef _WIN32
+    unsigned char *base = VirtualAlloc(NULL, size + 2 * page, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!base)
+        return NULL;
+    DWORD old_protection;
+    VirtualProtect(base, page, PAGE_NOACCESS, &old_protection);
+    VirtualProtect(base + page + size, page, PAGE_NOACCESS, &old_protection);
+    VirtualLock(base + page, size);
+#else
+    unsigned char *base = mmap(NULL, size + 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    mprotect(base, page, PROT_NONE);
+    mprotect(base + page + size, page, PROT_NONE);
+    mlock(base + page, size);
+#ifdef MADV_DONTDUMP
+    madvise(base + page, size, MADV_DONTDUMP);
+#endif
+#endif
+    return base + page;
+}
+
+
+/*
+ * Release memory mapped with map_secret_pages, the caller has wiped it already
+ *
+ * param void* memory: The usable memory
+ * param size_t size: Number of usable bytes
+ */
+static void unmap_secret_pages(void *memory, const size_t size) {
+    const size_t page = page_size();
+    unsigned char *base = (unsigned char *) memory - page;
+#ifdef _WIN32
+    VirtualUnlock(memory, size);
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munlock(memory, size);
+    munmap(base, size + 2 * page);
+#endif
+}
+
+
+/*
+ * Round the size of a large block including its header up to whole pages
+ *
+ * param size_t capacity: Usable bytes of the block
+ * return size_t: Size of the mapping without guard pages
+ */
+static size_t large_mapping_size(const size_t capacity) {
+    const size_t page = page_size();
+    return (sizeof(struct block_header) + capacity + page - 1) / page * page;
+}
+
+
+/*
+ * Allocate memory for secrets such as cleartext passwords and decrypted vault contents.
+ * Small blocks are carved from a few large locked regions by size class, so locking costs
+ * one system call per region instead of one per allocation. Freed blocks are wiped and reused.
+ *
+ * param size_t size: Number of bytes
+ * return void*: Zeroed memory that has to be released with secure_free, NULL if memory ran out
+ */
+void *secure_malloc(size_t size) {
+    if (size == 0)
+        size = 1;
+    if (size > SECURE_MAX_SMALL_SIZE) {
+        if (size > SIZE_MAX - 2 * page_size())
+            return NULL;
+        struct block_header *header = map_secret_pages(large_mapping_size(size));
+        if (!header)
+            return NULL;
+        header->magic = BLOCK_MAGIC;
+        header->size_class = LARGE_CLASS;
+        header->capacity = size;
+        return header + 1;
+    }
+
+    uint32_t size_class = 0;
+    while (((size_t) 1 << (size_class + MIN_CLASS_SHIFT)) < size)
+        size_class++;
+    const size_t capacity = (size_t) 1 << (size_class + MIN_CLASS_SHIFT);
+
+    pthread_mutex_lock(&heap_lock);
+    struct block_header *header;
+    if (free_lists[size_class]) {
+        struct free_block *block = free_lists[size_class];
+        free_lists[size_class] = block->next;
+        block->next = NULL;
+        header = (struct block_header *) block - 1;
+        header->magic = BLOCK_MAGIC;
+    } else {
+        const size_t needed = sizeof(struct block_header) + capacity;
+        if (!region_next || (size_t) (region_end - region_next) < needed) {
+            // The rest of the current region is abandoned, it is smaller than the largest class
+            unsigned char *region = map_secret_pages(SECURE_REGION_SIZE);
+            if (!region) {
+                pthread_mutex_unlock(&heap_lock);
+                return NULL;
+            }
+            region_next = region;
+            region_end = region + SECURE_REGION_SIZE;
+        }
+        header = (struct block_header *) region_next;
+        region_next += needed;
+        header->magic = BLOCK_MAGIC;
+        header->size_class = size_class;
+        header->capacity = capacity;
+    }
+    pthread_mutex_unlock(&heap_lock);
+    return header + 1;
+}
+
+
+/*
+ * Resize a block of the secure heap. The old block is wiped if the contents have to move
+ *
+ * param void* ptr: Block returned by secure_malloc, may be NULL
+ * param size_t size: New number of bytes
+ * return void*: The resized block, NULL if memory ran out (the old block is still valid then)
+ */
+void *secure_realloc(void *ptr, const size_t size) {
+    if (!ptr)
+        return secure_malloc(size);
+    const struct block_header *header = (const struct block_header *) ptr - 1;
+    if (size <= header->capacity)
+        return ptr;
+    void *resized = secure_malloc(size);
+    if (!resized)
+        return NULL;
+    memcpy(resized, ptr, header->capacity);
+    secure_free(ptr);
+    return resized;
+}
+
+
+/*
+ * Copy a string into the secure heap
+ *
+ * param const char* text: The string to copy
+ * return char*: The copy that has to be released with secure_free, NULL if memory ran out
+ */
+char *secure_strdup(const char *text) {
+    const size_t length = strlen(text);
+    char *copy = secure_malloc(length + 1);
+    if (copy)
+        memcpy(copy, text, length + 1);
+    return copy;
+}
+
+
+/*
+ * Wipe and release a block of the secure heap
+ *
+ * param void* ptr: Block returned by secure_malloc, may be NULL
+ */
+void secure_free(void *ptr) {
+    if (!ptr)
+        return;
+    struct block_header *header = (struct block_header *) ptr - 1;
+    if (header->magic != BLOCK_MAGIC)
+        abort();
+    OPENSSL_cleanse(ptr, header->capacity);
+    // Clearing the magic turns a double free into an abort instead of a corrupted free list
+    header->magic = 0;
+    if (header->size_class == LARGE_CLASS) {
+        unmap_secret_pages(header, large_mapping_size(header->capacity));
+        return;
+    }
+    pthread_mutex_lock(&heap_lock);
+    struct free_block *block = ptr;
+    block->next = free_lists[header->size_class];
+    free_lists[header->size_class] = block;
+    pthread_mutex_unlock(&heap_lock);
+}
@@ -0,0 +1,16 @@
+#ifndef SECURE_HEAP_H
+#define SECURE_HEAP_H
+
+#include <stddef.h>
+
+// Usable bytes of each locked region the small size classes are carved from
+#define SECURE_REGION_SIZE (1024 * 1024)
+// Allocations above this size get a mapping of their own
+#define SECURE_MAX_SMALL_SIZE 4096
+
+void *secure_malloc(size_t size);
+void *secure_realloc(void *ptr, size_t size);
+char *secure_strdup(const char *text);
+void secure_free(void *ptr);
+
+#endif //SECURE_HEAP_H
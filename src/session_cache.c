@@ -0,0 +1,239 @@
+#include "session_cache.h"
+#include <openssl/evp.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crypto.h"
+#include "secure_heap.h"
+#ifdef __linux__
+#include <linux/keyctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// First byte of a cached key, followed by the vault key and its IV
+#define SESSION_KEY_FORMAT 2
+#define SESSION_KEY_PAYLOAD_SIZE (1 + VAULT_KEY_SIZE + VAULT_IV_SIZE)
+#define SESSION_KEY_PREFIX SESSION_KEYRING_NAME ":vault:"
+// Permissions of a cached key: only processes possessing it through their keyrings may use it
+#define KEY_POS_VIEW 0x01000000
+#define KEY_POS_READ 0x02000000
+#define KEY_POS_WRITE 0x04000000
+#define KEY_POS_SEARCH 0x08000000
+#define KEY_POS_SETATTR 0x20000000
+
+
+/*
+ * Check whether this platform can cache vault keys
+ *
+ * return bool: true on Linux, the commands fail with a message otherwise
+ */
+bool has_session_cache(void) {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/*
+ * Get how long the unlock command keeps a vault key
+ *
+ * return int: Seconds from C_PASS_SESSION_TIMEOUT if it is positive, DEFAULT_SESSION_TIMEOUT otherwise
+ */
+int session_timeout(void) {
+    const char *value = getenv(SESSION_TIMEOUT_VARIABLE);
+    const int timeout = value ? atoi(value) : 0;
+    return timeout > 0 ? timeout : DEFAULT_SESSION_TIMEOUT;
+}
+
+#ifdef __linux__
+
+/*
+ * Get the keyring the cpass keyring is linked into, see SESSION_KEYRING_VARIABLE. It is resolved
+ * without creating it: a process outside of a login session would otherwise get a new session
+ * keyring that ends with it, instead of the user session keyring the kernel falls back to
+ */
+static int32_t base_keyring(void) {
+    const char *name = getenv(SESSION_KEYRING_VARIABLE);
+    const int32_t special = name && strcmp(name, "user") == 0 ? KEY_SPEC_USER_KEYRING : KEY_SPEC_SESSION_KEYRING;
+    return (int32_t) syscall(SYS_keyctl, KEYCTL_GET_KEYRING_ID, special, 0);
+}
+
+
+/*
+ * Find the keyring holding the vault keys
+ *
+ * param bool create: Create it in the base keyring if it does not exist
+ * return int32_t: Its serial number, -1 if it does not exist
+ */
+static int32_t find_cache_keyring(const bool create) {
+    const int32_t base = base_keyring();
+    if (base < 0)
+        return -1;
+    const long found = syscall(SYS_keyctl, KEYCTL_SEARCH, base, "keyring", SESSION_KEYRING_NAME, 0);
+    if (found >= 0 || !create)
+        return (int32_t) found;
+    // Adding a keyring under an existing name replaces the old one, so it is only added when the search failed
+    return (int32_t) syscall(SYS_add_key, "keyring", SESSION_KEYRING_NAME, NULL, (size_t) 0, base);
+}
+
+
+/*
+ * Get the description of the cached key of a vault. Every path to the same file yields the same one,
+ * the path itself is hashed, so the keyring does not tell which vaults were unlocked
+ *
+ * param char* description: Receives the description, room for sizeof(SESSION_KEY_PREFIX) + 64 bytes
+ * return bool: false if the path could not be hashed
+ */
+static bool key_description(const char *vault_path, char *description) {
+    char *resolved = realpath(vault_path, NULL);
+    const char *path = resolved ? resolved : vault_path;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_length = 0;
+    const bool hashed = EVP_Digest(path, strlen(path), digest, &digest_length, EVP_sha256(), NULL) == 1;
+    free(resolved);
+    if (!hashed)
+        return false;
+    static const char hex[] = "0123456789abcdef";
+    char *out = description + strlen(SESSION_KEY_PREFIX);
+    memcpy(description, SESSION_KEY_PREFIX, strlen(SESSION_KEY_PREFIX));
+    for (unsigned int i = 0; i < digest_length && i < 32; i++) {
+        *out++ = hex[digest[i] >> 4];
+        *out++ = hex[digest[i] & 0xf];
+    }
+    *out = '\0';
+    return true;
+}
+
+
+/*
+ * Find the cached key of a vault
+ *
+ * return int32_t: Its serial number, -1 if there is none
+ */
+static int32_t find_session_key(const char *vault_path) {
+    char description[sizeof(SESSION_KEY_PREFIX) + 64];
+    if (!key_description(vault_path, description))
+        return -1;
+    const int32_t keyring = find_cache_keyring(false);
+    if (keyring < 0)
+        return -1;
+    return (int32_t) syscall(SYS_keyctl, KEYCTL_SEARCH, keyring, "user", description, 0);
+}
+
+
+/*
+ * Get the key of a vault from the session cache
+ *
+ * param const char* vault_path: Path of the vault
+ * return struct vault_key*: The vault key on the secure heap, NULL if the vault is not unlocked
+ */
+struct vault_key *load_session_key(const char *vault_path) {
+    const int32_t key = find_session_key(vault_path);
+    if (key < 0)
+        return NULL;
+    unsigned char *payload = secure_malloc(SESSION_KEY_PAYLOAD_SIZE);
+    struct vault_key *vault_key = secure_malloc(sizeof(struct vault_key));
+    const bool read = payload && vault_key &&
+        syscall(SYS_keyctl, KEYCTL_READ, key, payload, (size_t) SESSION_KEY_PAYLOAD_SIZE) == SESSION_KEY_PAYLOAD_SIZE &&
+        payload[0] == SESSION_KEY_FORMAT;
+    if (read) {
+        memcpy(vault_key->key, payload + 1, VAULT_KEY_SIZE);
+        memcpy(vault_key->iv, payload + 1 + VAULT_KEY_SIZE, VAULT_IV_SIZE);
+    }
+    secure_free(payload);
+    if (!read) {
+        secure_free(vault_key);
+        return NULL;
+    }
+    return vault_key;
+}
+
+
+/*
+ * Put the key of an unlocked vault into the session cache or renew its timeout
+ *
+ * param const char* vault_path: Path of the vault
+ * param const struct vault_key* vault_key: Its vault key
+ * param int timeout: Seconds until the kernel drops the key
+ * return bool: false if the key could not be cached
+ */
+bool store_session_key(const char *vault_path, const struct vault_key *vault_key, const int timeout) {
+    char description[sizeof(SESSION_KEY_PREFIX) + 64];
+    unsigned char *payload = secure_malloc(SESSION_KEY_PAYLOAD_SIZE);
+    if (timeout <= 0 || !payload || !key_description(vault_path, description)) {
+        secure_free(payload);
+        return false;
+    }
+    payload[0] = SESSION_KEY_FORMAT;
+    memcpy(payload + 1, vault_key->key, VAULT_KEY_SIZE);
+    memcpy(payload + 1 + VAULT_KEY_SIZE, vault_key->iv, VAULT_IV_SIZE);
+
+    const int32_t keyring = find_cache_keyring(true);
+    // Adding a key under an existing description updates it in place
+    const int32_t key = keyring < 0 ? -1 :
+        (int32_t) syscall(SYS_add_key, "user", description, payload, (size_t) SESSION_KEY_PAYLOAD_SIZE, keyring);
+    secure_free(payload);
+    if (key < 0)
+        return false;
+    const unsigned long permissions = KEY_POS_VIEW | KEY_POS_READ | KEY_POS_WRITE | KEY_POS_SEARCH | KEY_POS_SETATTR;
+    if (syscall(SYS_keyctl, KEYCTL_SETPERM, key, permissions) < 0 ||
+        syscall(SYS_keyctl, KEYCTL_SET_TIMEOUT, key, (unsigned int) timeout) < 0) {
+        syscall(SYS_keyctl, KEYCTL_INVALIDATE, key);
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * Drop the cached key of a vault, the next command prompts for the master password again
+ *
+ * param const char* vault_path: Path of the vault
+ * return bool: false if the vault was not unlocked
+ */
+bool forget_session_key(const char *vault_path) {
+    const int32_t key = find_session_key(vault_path);
+    if (key < 0)
+        return false;
+    // Invalidating drops the key from every keyring at once, unlinking is the fallback for kernels before 3.5
+    if (syscall(SYS_keyctl, KEYCTL_INVALIDATE, key) == 0)
+        return true;
+    return syscall(SYS_keyctl, KEYCTL_UNLINK, key, find_cache_keyring(false)) == 0;
+}
+
+
+/*
+ * Drop the cached keys of all vaults
+ *
+ * return bool: false if the keys could not be dropped, true if none were cached
+ */
+bool flush_session_keys(void) {
+    const int32_t keyring = find_cache_keyring(false);
+    return keyring < 0 || syscall(SYS_keyctl, KEYCTL_CLEAR, keyring) == 0;
+}
+
+#else
+
+struct vault_key *load_session_key(const char *vault_path) {
+    return NULL;
+}
+
+
+bool store_session_key(const char *vault_path, const struct vault_key *vault_key, const int timeout) {
+    return false;
+}
+
+
+bool forget_session_key(const char *vault_path) {
+    return false;
+}
+
+
+bool flush_session_keys(void) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SESSION_CACHE_H
+#define SESSION_CACHE_H
+
+#include <stdbool.h>
+#include "crypto.h"
+
+// The unlock command keeps the derived vault key in the kernel keyring, so later commands
+// on the same vault neither prompt for the master password nor derive the key again.
+// Only the key is cached, the master password never leaves the process that read it
+#define SESSION_TIMEOUT_VARIABLE "C_PASS_SESSION_TIMEOUT"
+#define DEFAULT_SESSION_TIMEOUT (15 * 60)
+// "session" keeps the keys until the login session ends, "user" shares them with all sessions of the user
+#define SESSION_KEYRING_VARIABLE "C_PASS_KEYRING"
+// Keyring holding the keys of all vaults, linked into the session or user keyring
+#define SESSION_KEYRING_NAME "cpass"
+
+bool has_session_cache(void);
+int session_timeout(void);
+struct vault_key *load_session_key(const char *vault_path);
+bool store_session_key(const char *vault_path, const struct vault_key *vault_key, int timeout);
+bool forget_session_key(const char *vault_path);
+bool flush_session_keys(void);
+
+#endif //SESSION_CACHE_H
@@ -0,0 +1,901 @@
+#include "strength.h"
+#include <openssl/crypto.h>
+#include <ctype.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "strength_data.h"
+
+// Only this many leading characters are matched, every further character counts as brute force
+#define MAX_ANALYZED_LENGTH 64
+// Guesses per character of a brute forced part
+#define BRUTEFORCE_CARDINALITY 10
+// Minimum guesses of a pattern that only covers part of the password
+#define MIN_SUBMATCH_GUESSES_SINGLE_CHAR 10
+#define MIN_SUBMATCH_GUESSES_MULTI_CHAR 50
+// Sequences with a larger step between characters are not considered a pattern
+#define MAX_SEQUENCE_DELTA 5
+#define MIN_YEAR_SPACE 20
+#define MIN_YEAR 1000
+#define MAX_YEAR 2050
+#define DAYS_PER_YEAR 365
+#define SECONDS_PER_YEAR 31556952
+
+enum match_kind {
+    MATCH_BRUTEFORCE,
+    MATCH_DICTIONARY,
+    MATCH_SPATIAL,
+    MATCH_REPEAT,
+    MATCH_SEQUENCE,
+    MATCH_YEAR,
+    MATCH_DATE
+};
+
+struct match {
+    int i;                       // First character of the match
+    int j;                       // Last character of the match
+    enum match_kind kind;
+    double guesses_log10;
+    enum dictionary dictionary;  // MATCH_DICTIONARY only
+    int rank;                    // MATCH_DICTIONARY only
+    int turns;                   // MATCH_SPATIAL only
+    int base_length;             // MATCH_REPEAT only
+};
+
+struct match_list {
+    struct match *items;
+    int count;
+    int capacity;
+};
+
+struct dictionary_walk {
+    const char *token;          // The password, reversed for the reversed pass
+    int length;
+    bool reversed;
+    bool l33t;                  // Try leetspeak substitutions
+    int start;
+    char substitution[MAX_ANALYZED_LENGTH]; // Letter substituted at each position, 0 for none
+    struct match_list *matches;
+};
+
+// Letters a character may stand for in leetspeak
+static const char *const l33t_letters[128] = {
+    ['4'] = "a", ['@'] = "a", ['8'] = "b", ['('] = "c", ['{'] = "c", ['['] = "c", ['<'] = "c",
+    ['3'] = "e", ['6'] = "g", ['9'] = "g", ['1'] = "il", ['!'] = "i", ['|'] = "il", ['7'] = "lt",
+    ['0'] = "o", ['$'] = "s", ['5'] = "s", ['+'] = "t", ['%'] = "x", ['2'] = "z"
+};
+
+static const char *const shifted_characters = "~!@#$%^&*()_+QWERTYUIOP{}|ASDFGHJKL:\"ZXCVBNM<>?";
+static const char *const date_separators = " /\\_.-";
+
+// Splits of a date without separators into day, month and year, indexed by its length
+static const int date_splits[9][4][2] = {
+    [4] = {{1, 2}, {2, 3}},
+    [5] = {{1, 3}, {2, 3}},
+    [6] = {{1, 2}, {2, 4}, {4, 5}},
+    [7] = {{1, 3}, {2, 3}, {4, 5}, {4, 6}},
+    [8] = {{2, 4}, {4, 6}}
+};
+
+static double most_guessable_log10(const char *password, int length, const char **warning);
+
+
+/*
+ * Compute the binomial coefficient as floating point number, the results can exceed any integer type
+ *
+ * param int n: Number of elements
+ * param int k: Number of chosen elements
+ * return double: n choose k
+ */
+static double choose(const int n, const int k) {
+    if (k < 0 || k > n)
+        return 0;
+    double result = 1;
+    for (int d = 1; d <= k; d++) {
+        result = result * (n - k + d) / d;
+    }
+    return result;
+}
+
+
+/*
+ * Number of ways to mix two kinds of characters within a token, e.g. upper- and lowercase letters.
+ * One kind alone only doubles the guesses, because that is the first thing an attacker tries
+ *
+ * param int a: Number of characters of the first kind
+ * param int b: Number of characters of the second kind
+ * return double: Factor the guesses are multiplied with
+ */
+static double mix_variations(const int a, const int b) {
+    if (a == 0 || b == 0)
+        return 2;
+    double variations = 0;
+    for (int i = 1; i <= (a < b ? a : b); i++) {
+        variations += choose(a + b, i);
+    }
+    return variations;
+}
+
+
+/*
+ * Compute log10(10^a + 10^b) without leaving the logarithmic domain
+ *
+ * param double a: First summand as log10
+ * param double b: Second summand as log10
+ * return double: The sum as log10
+ */
+static double log10_sum(const double a, const double b) {
+    const double larger = a > b ? a : b;
+    const double smaller = a > b ? b : a;
+    return larger + log10(1 + pow(10, smaller - larger));
+}
+
+
+/*
+ * Append a match to the list, growing it geometrically. Matches that do not fit are dropped,
+ * which only makes the estimate more conservative
+ *
+ * param struct match_list* matches: The list
+ * param const struct match* match: The match to append
+ */
+static void add_match(struct match_list *matches, const struct match *match) {
+    if (matches->count == matches->capacity) {
+        const int capacity = matches->capacity ? matches->capacity * 2 : 64;
+        struct match *items = realloc(matches->items, capacity * sizeof(struct match));
+        if (!items)
+            return;
+        matches->items = items;
+        matches->capacity = capacity;
+    }
+    matches->items[matches->count++] = *match;
+}
+
+
+/*
+ * Estimate how many times the guesses of a dictionary word are multiplied by the capitalization
+ *
+ * param const char* token: The matched characters
+ * param int length: Number of characters
+ * return double: Factor of the guesses
+ */
+static double uppercase_variations(const char *token, const int length) {
+    int upper = 0, lower = 0;
+    for (int k = 0; k < length; k++) {
+        if (isupper((unsigned char) token[k])) upper++;
+        else if (islower((unsigned char) token[k])) lower++;
+    }
+    if (upper == 0)
+        return 1;
+    // Capitalizing the first or last letter or all of them is common enough to only double the guesses
+    const bool first_only = upper == 1 && isupper((unsigned char) token[0]);
+    const bool last_only = upper == 1 && isupper((unsigned char) token[length - 1]);
+    if (first_only || last_only || lower == 0)
+        return 2;
+    return mix_variations(upper, lower);
+}
+
+
+/*
+ * Estimate how many times the guesses of a dictionary word are multiplied by leetspeak substitutions
+ *
+ * param const struct dictionary_walk* walk: The walk holding the substitutions
+ * param int i: First character of the match
+ * param int j: Last character of the match
+ * return double: Factor of the guesses
+ */
+static double l33t_variations(const struct dictionary_walk *walk, const int i, const int j) {
+    double variations = 1;
+    for (int k = i; k <= j; k++) {
+        if (!walk->substitution[k])
+            continue;
+        // Only evaluate every pair of substituted character and letter once
+        bool seen = false;
+        for (int p = i; p < k && !seen; p++) {
+            seen = walk->substitution[p] == walk->substitution[k] && walk->token[p] == walk->token[k];
+        }
+        if (seen)
+            continue;
+        int substituted = 0, unsubstituted = 0;
+        for (int p = i; p <= j; p++) {
+            if (walk->substitution[p] == walk->substitution[k] && walk->token[p] == walk->token[k])
+                substituted++;
+            else if (!walk->substitution[p] && tolower((unsigned char) walk->token[p]) == walk->substitution[k])
+                unsubstituted++;
+        }
+        variations *= mix_variations(substituted, unsubstituted);
+    }
+    return variations;
+}
+
+
+/*
+ * Find the range of words having the given character at the given depth.
+ * All words of the input range share the same prefix of depth characters, so they are
+ * sorted by their character at depth and the sorted array can be walked like a trie
+ *
+ * param int* lo: First word of the range, updated to the first word of the narrowed range
+ * param int* hi: End of the range, updated to the end of the narrowed range
+ * param int depth: Index of the character to compare
+ * param unsigned char c: The character
+ * return bool: false if no word of the range has the character at depth
+ */
+static bool narrow_range(int *lo, int *hi, const int depth, const unsigned char c) {
+    int left = *lo, right = *hi;
+    while (left < right) {
+        const int middle = left + (right - left) / 2;
+        if ((unsigned char) dictionary_words[middle].word[depth] < c) left = middle + 1;
+        else right = middle;
+    }
+    const int first = left;
+    right = *hi;
+    while (left < right) {
+        const int middle = left + (right - left) / 2;
+        if ((unsigned char) dictionary_words[middle].word[depth] <= c) left = middle + 1;
+        else right = middle;
+    }
+    if (first == left)
+        return false;
+    *lo = first;
+    *hi = left;
+    return true;
+}
+
+
+/*
+ * Walk the dictionary from the start of the walk, adding a match for every word that ends at position.
+ * Characters with leetspeak meanings branch into one walk per letter
+ *
+ * param struct dictionary_walk* walk: The walk
+ * param int position: Index of the next character of the token
+ * param int lo: First word sharing the prefix walked so far
+ * param int hi: End of the words sharing the prefix walked so far
+ */
+static void walk_dictionary(struct dictionary_walk *walk, const int position, const int lo, const int hi) {
+    const unsigned char c = (unsigned char) walk->token[position];
+    char candidates[4] = {(char) tolower(c), '\0'};
+    if (walk->l33t && c < 128 && l33t_letters[c])
+        strcpy(candidates + 1, l33t_letters[c]);
+
+    const int depth = position - walk->start;
+    for (int k = 0; candidates[k]; k++) {
+        int first = lo, end = hi;
+        if (!narrow_range(&first, &end, depth, (unsigned char) candidates[k]))
+            continue;
+        walk->substitution[position] = k > 0 ? candidates[k] : '\0';
+
+        // The shortest word of the range comes first, it ends here if it has exactly depth + 1 characters
+        const struct dictionary_word *word = &dictionary_words[first];
+        bool substituted = false;
+        for (int p = walk->start; p <= position; p++) {
+            substituted |= walk->substitution[p] != '\0';
+        }
+        if (word->word[depth + 1] == '\0' && !(substituted && depth == 0)) {
+            const int i = walk->reversed ? walk->length - 1 - position : walk->start;
+            const int j = walk->reversed ? walk->length - 1 - walk->start : position;
+            double guesses = word->rank *
+                uppercase_variations(walk->token + walk->start, depth + 1) *
+                l33t_variations(walk, walk->start, position);
+            if (walk->reversed)
+                guesses *= 2;
+            const struct match match = {
+                .i = i, .j = j, .kind = MATCH_DICTIONARY, .guesses_log10 = log10(guesses),
+                .dictionary = word->dictionary, .rank = word->rank
+            };
+            add_match(walk->matches, &match);
+        }
+        if (position + 1 < walk->length)
+            walk_dictionary(walk, position + 1, first, end);
+    }
+    walk->substitution[position] = '\0';
+}
+
+
+/*
+ * Find dictionary words, also reversed and with leetspeak substitutions
+ *
+ * param const char* password: The password
+ * param int length: Length of the password
+ * param struct match_list* matches: Receives the matches
+ */
+static void match_dictionary(const char *password, const int length, struct match_list *matches) {
+    char reversed[MAX_ANALYZED_LENGTH];
+    for (int k = 0; k < length; k++) {
+        reversed[k] = password[length - 1 - k];
+    }
+    struct dictionary_walk walk = {.token = password, .length = length, .l33t = true, .matches = matches};
+    for (walk.start = 0; walk.start < length; walk.start++) {
+        walk_dictionary(&walk, walk.start, 0, num_dictionary_words);
+    }
+    struct dictionary_walk reversed_walk = {.token = reversed, .length = length, .reversed = true, .matches = matches};
+    for (reversed_walk.start = 0; reversed_walk.start < length; reversed_walk.start++) {
+        walk_dictionary(&reversed_walk, reversed_walk.start, 0, num_dictionary_words);
+    }
+    OPENSSL_cleanse(reversed, sizeof(reversed));
+}
+
+
+/*
+ * Estimate the guesses of a keyboard walk: every key can start it, every turn
+ * multiplies the guesses by the average number of neighbors and shifted keys add variations
+ *
+ * param const struct keyboard_graph* graph: The keyboard
+ * param int length: Number of keys of the walk
+ * param int turns: Number of direction changes
+ * param int shifted: Number of shifted keys
+ * return double: The guesses as log10
+ */
+static double spatial_guesses_log10(const struct keyboard_graph *graph, const int length, const int turns, const int shifted) {
+    double guesses = 0;
+    for (int i = 2; i <= length; i++) {
+        const int possible_turns = turns < i - 1 ? turns : i - 1;
+        for (int j = 1; j <= possible_turns; j++) {
+            guesses += choose(i - 1, j - 1) * graph->starting_positions * pow(graph->average_degree, j);
+        }
+    }
+    if (shifted > 0)
+        guesses *= mix_variations(shifted, length - shifted);
+    return log10(guesses);
+}
+
+
+/*
+ * Find walks of at least three adjacent keys on a keyboard, e.g. "qwerty" or "zxcvfr"
+ *
+ * param const char* password: The password
+ * param int length: Length of the password
+ * param const struct keyboard_graph* graph: The keyboard
+ * param bool has_shift: Count shifted characters, only the qwerty layout has them
+ * param struct match_list* matches: Receives the matches
+ */
+static void match_spatial(
+    const char *password,
+    const int length,
+    const struct keyboard_graph *graph,
+    const bool has_shift,
+    struct match_list *matches) {
+    int i = 0;
+    while (i < length - 1) {
+        int j = i + 1;
+        int last_direction = -1;
+        int turns = 0;
+        int shifted = has_shift && strchr(shifted_characters, password[i]) ? 1 : 0;
+        while (1) {
+            const unsigned char previous = (unsigned char) password[j - 1];
+            bool found = false;
+            if (j < length && previous < 128) {
+                const char current = password[j];
+                for (int direction = 0; direction < MAX_KEY_NEIGHBORS && !found; direction++) {
+                    const char *neighbor = graph->neighbors[previous][direction];
+                    if (neighbor[0] == '\0' || (neighbor[0] != current && neighbor[1] != current))
+                        continue;
+                    found = true;
+                    if (has_shift && neighbor[1] == current)
+                        shifted++;
+                    if (direction != last_direction) {
+                        turns++;
+                        last_direction = direction;
+                    }
+                }
+            }
+            if (found) {
+                j++;
+                continue;
+            }
+            if (j - i > 2) {
+                const struct match match = {
+                    .i = i, .j = j - 1, .kind = MATCH_SPATIAL, .turns = turns,
+                    .guesses_log10 = spatial_guesses_log10(graph, j - i, turns, shifted)
+                };
+                add_match(matches, &match);
+            }
+            i = j;
+            break;
+        }
+    }
+}
+
+
+/*
+ * Find repetitions of a base string, e.g. "aaaa" or "abcabc". The guesses are those of the base
+ * times the number of repetitions
+ *
+ * param const char* password: The password
+ * param int length: Length of the password
+ * param struct match_list* matches: Receives the matches
+ */
+static void match_repeat(const char *password, const int length, struct match_list *matches) {
+    int i = 0;
+    while (i < length - 1) {
+        int best_length = 0, best_period = 0;
+        for (int period = 1; period <= (length - i) / 2; period++) {
+            int k = i + period;
+            while (k < length && password[k] == password[k - period])
+                k++;
+            const int repetitions = (k - i) / period;
+            if (repetitions >= 2 && repetitions * period > best_length) {
+                best_length = repetitions * period;
+                best_period = period;
+            }
+        }
+        if (best_length == 0) {
+            i++;
+            continue;
+        }
+        const struct match match = {
+            .i = i, .j = i + best_length - 1, .kind = MATCH_REPEAT, .base_length = best_period,
+            .guesses_log10 = most_guessable_log10(password + i, best_period, NULL) + log10(best_length / best_period)
+        };
+        add_match(matches, &match);
+        i += best_length;
+    }
+}
+
+
+/*
+ * Add a run of characters with a constant step as sequence match, e.g. "abcd", "9753" or "ZYX"
+ *
+ * param const char* password: The password
+ * param int i: First character of the run
+ * param int j: Last character of the run
+ * param int delta: Step between the characters
+ * param struct match_list* matches: Receives the match
+ */
+static void add_sequence(const char *password, const int i, const int j, const int delta, struct match_list *matches) {
+    if (!(j - i > 1 || abs(delta) == 1) || delta == 0 || abs(delta) > MAX_SEQUENCE_DELTA)
+        return;
+    const char first = password[i];
+    double base;
+    if (strchr("aAzZ019", first)) base = 4;
+    else if (isdigit((unsigned char) first)) base = 10;
+    else base = 26;
+    if (delta < 0)
+        base *= 2;
+    const struct match match = {.i = i, .j = j, .kind = MATCH_SEQUENCE, .guesses_log10 = log10(base * (j - i + 1))};
+    add_match(matches, &match);
+}
+
+
+/*
+ * Find runs of characters with a constant step
+ *
+ * param const char* password: The password
+ * param int length: Length of the password
+ * param struct match_list* matches: Receives the matches
+ */
+static void match_sequence(const char *password, const int length, struct match_list *matches) {
+    if (length < 2)
+        return;
+    int i = 0;
+    int last_delta = (unsigned char) password[1] - (unsigned char) password[0];
+    for (int k = 2; k < length; k++) {
+        const int delta = (unsigned char) password[k] - (unsigned char) password[k - 1];
+        if (delta == last_delta)
+            continue;
+        add_sequence(password, i, k - 1, last_delta, matches);
+        i = k - 1;
+        last_delta = delta;
+    }
+    add_sequence(password, i, length - 1, last_delta, matches);
+}
+
+
+/*
+ * Parse a run of digits
+ *
+ * param const char* digits: The first digit
+ * param int count: Number of digits
+ * return int: The value
+ */
+static int parse_digits(const char *digits, const int count) {
+    int value = 0;
+    for (int k = 0; k < count; k++) {
+        value = value * 10 + digits[k] - '0';
+    }
+    return value;
+}
+
+
+/*
+ * Interpret three numbers as day, month and year in any common order.
+ * Two digit years are mapped to the closest century
+ *
+ * param const int* numbers: The three numbers in order of appearance
+ * param int* year: Receives the year
+ * return bool: false if the numbers do not form a date
+ */
+static bool numbers_to_date(const int numbers[3], int *year) {
+    if (numbers[1] > 31 || numbers[1] <= 0)
+        return false;
+    int over_12 = 0, over_31 = 0, under_1 = 0;
+    for (int k = 0; k < 3; k++) {
+        if ((numbers[k] > 99 && numbers[k] < MIN_YEAR) || numbers[k] > MAX_YEAR)
+            return false;
+        if (numbers[k] > 31) over_31++;
+        if (numbers[k] > 12) over_12++;
+        if (numbers[k] <= 0) under_1++;
+    }
+    if (over_31 >= 2 || over_12 == 3 || under_1 >= 2)
+        return false;
+
+    // The year is either the last or the first number
+    const int candidates[2][3] = {
+        {numbers[2], numbers[0], numbers[1]},
+        {numbers[0], numbers[1], numbers[2]}
+    };
+    for (int pass = 0; pass < 2; pass++) {
+        for (int c = 0; c < 2; c++) {
+            const int y = candidates[c][0];
+            const bool full_year = y >= MIN_YEAR && y <= MAX_YEAR;
+            if (pass == 0 && !full_year)
+                continue;
+            const int a = candidates[c][1], b = candidates[c][2];
+            const bool day_month = (a >= 1 && a <= 31 && b >= 1 && b <= 12) || (b >= 1 && b <= 31 && a >= 1 && a <= 12);
+            if (pass == 0 && !day_month)
+                return false;
+            if (day_month) {
+                *year = y > 99 ? y : y > 50 ? y + 1900 : y + 2000;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+/*
+ * Find years and dates with or without separators, e.g. "1987", "13.05.1987" or "130587"
+ *
+ * param const char* password: The password
+ * param int length: Length of the password
+ * param int reference_year: The current year
+ * param struct match_list* matches: Receives the matches
+ */
+static void match_dates(const char *password, const int length, const int reference_year, struct match_list *matches) {
+    for (int i = 0; i + 4 <= length; i++) {
+        // Years on their own
+        int digits = 0;
+        while (i + digits < length && isdigit((unsigned char) password[i + digits]))
+            digits++;
+        if (digits >= 4) {
+            const int year = parse_digits(password + i, 4);
+            if (year >= 1900 && year <= MAX_YEAR) {
+                const int space = abs(year - reference_year) > MIN_YEAR_SPACE ? abs(year - reference_year) : MIN_YEAR_SPACE;
+                const struct match match = {.i = i, .j = i + 3, .kind = MATCH_YEAR, .guesses_log10 = log10(space)};
+                add_match(matches, &match);
+            }
+        }
+
+        // Dates without separators, the split closest to the current year wins
+        for (int count = 4; count <= 8 && count <= digits; count++) {
+            int best_year = -1;
+            for (int s = 0; s < 4 && date_splits[count][s][0]; s++) {
+                const int k = date_splits[count][s][0], l = date_splits[count][s][1];
+                const int numbers[3] = {
+                    parse_digits(password + i, k),
+                    parse_digits(password + i + k, l - k),
+                    parse_digits(password + i + l, count - l)
+                };
+                int year;
+                if (numbers_to_date(numbers, &year) &&
+                    (best_year < 0 || abs(year - reference_year) < abs(best_year - reference_year)))
+                    best_year = year;
+            }
+            if (best_year >= 0) {
+                const int space = abs(best_year - reference_year) > MIN_YEAR_SPACE ? abs(best_year - reference_year) : MIN_YEAR_SPACE;
+                const struct match match = {
+                    .i = i, .j = i + count - 1, .kind = MATCH_DATE, .guesses_log10 = log10((double) space * DAYS_PER_YEAR)
+                };
+                add_match(matches, &match);
+            }
+        }
+
+        // Dates with separators: 1-4 digits, separator, 1-2 digits, the same separator, 1-4 digits
+        if (digits < 1 || digits > 4 || i + digits >= length || !strchr(date_separators, password[i + digits]))
+            continue;
+        const char separator = password[i + digits];
+        const int second = i + digits + 1;
+        int second_digits = 0;
+        while (second + second_digits < length && isdigit((unsigned char) password[second + second_digits]))
+            second_digits++;
+        if (second_digits < 1 || second_digits > 2 || second + second_digits >= length ||
+            password[second + second_digits] != separator)
+            continue;
+        const int third = second + second_digits + 1;
+        int third_digits = 0;
+        while (third + third_digits < length && isdigit((unsigned char) password[third + third_digits]))
+            third_digits++;
+        if (third_digits < 1 || third_digits > 4)
+            continue;
+        const int numbers[3] = {
+            parse_digits(password + i, digits),
+            parse_digits(password + second, second_digits),
+            parse_digits(password + third, third_digits)
+        };
+        int year;
+        if (numbers_to_date(numbers, &year)) {
+            const int space = abs(year - reference_year) > MIN_YEAR_SPACE ? abs(year - reference_year) : MIN_YEAR_SPACE;
+            const struct match match = {
+                .i = i, .j = third + third_digits - 1, .kind = MATCH_DATE,
+                .guesses_log10 = log10((double) space * DAYS_PER_YEAR * 4)
+            };
+            add_match(matches, &match);
+        }
+    }
+}
+
+
+/*
+ * Explain why a match is easy to guess
+ *
+ * param const struct match* match: The match
+ * param bool is_sole_match: true if the match covers the whole password
+ * return const char*: The warning, NULL if there is none
+ */
+static const char *match_warning(const struct match *match, const bool is_sole_match) {
+    switch (match->kind) {
+        case MATCH_DICTIONARY:
+            if (match->dictionary == DICTIONARY_PASSWORDS) {
+                if (!is_sole_match) return "This is similar to a commonly used password";
+                if (match->rank <= 10) return "This is a top-10 common password";
+                if (match->rank <= 100) return "This is a top-100 common password";
+                return "This is a very common password";
+            }
+            if (match->dictionary == DICTIONARY_NAMES)
+                return is_sole_match ? "Names and surnames by themselves are easy to guess" :
+                    "Common names and surnames are easy to guess";
+            return is_sole_match ? "A word by itself is easy to guess" : "Dictionary words are easy to guess";
+        case MATCH_SPATIAL:
+            return match->turns == 1 ? "Straight rows of keys are easy to guess" : "Short keyboard patterns are easy to guess";
+        case MATCH_REPEAT:
+            return match->base_length == 1 ? "Repeats like \"aaa\" are easy to guess" :
+                "Repeats like \"abcabcabc\" are only slightly harder to guess than \"abc\"";
+        case MATCH_SEQUENCE:
+            return "Sequences like abc or 6543 are easy to guess";
+        case MATCH_YEAR:
+            return "Recent years are easy to guess";
+        case MATCH_DATE:
+            return "Dates are often easy to guess";
+        default:
+            return NULL;
+    }
+}
+
+
+struct optimal_cell {
+    double pi;    // Product of the guesses of the sequence as log10
+    double g;     // Guesses of the whole sequence as log10, including the combinations of its length
+    int match;    // Index of the last match, -1 for brute force
+    int start;    // First character of the last match
+    bool set;
+};
+
+struct optimal_sequences {
+    // cells[k][l]: best sequence of l matches covering the first k + 1 characters
+    struct optimal_cell cells[MAX_ANALYZED_LENGTH][MAX_ANALYZED_LENGTH + 1];
+    double log10_factorial[MAX_ANALYZED_LENGTH + 1];
+};
+
+
+/*
+ * Consider a match as last match of a sequence of l matches ending at character k
+ *
+ * param struct optimal_sequences* optimal: The dynamic programming table
+ * param int match: Index of the match, -1 for brute force
+ * param int start: First character of the match
+ * param int k: Last character of the match
+ * param double guesses_log10: Guesses of the match
+ * param int l: Number of matches of the sequence
+ */
+static void update_optimal(
+    struct optimal_sequences *optimal,
+    const int match,
+    const int start,
+    const int k,
+    const double guesses_log10,
+    const int l) {
+    double pi = guesses_log10;
+    if (l > 1)
+        pi += optimal->cells[start - 1][l - 1].pi;
+    // An attacker has to try all orders of the l patterns and all shorter sequences first
+    const double g = log10_sum(optimal->log10_factorial[l] + pi, (l - 1) * 4.0);
+    for (int competing = 1; competing <= l; competing++) {
+        if (optimal->cells[k][competing].set && optimal->cells[k][competing].g <= g)
+            return;
+    }
+    optimal->cells[k][l] = (struct optimal_cell) {.pi = pi, .g = g, .match = match, .start = start, .set = true};
+}
+
+
+/*
+ * Estimate the guesses of a password as the cheapest sequence of non-overlapping patterns and
+ * brute forced parts covering it, following the zxcvbn model
+ *
+ * param const char* password: The password
+ * param int length: Number of characters to analyze, at most MAX_ANALYZED_LENGTH
+ * param const char** warning: Receives a warning about the weakest pattern, may be NULL
+ * return double: The guesses as log10
+ */
+static double most_guessable_log10(const char *password, const int length, const char **warning) {
+    if (warning)
+        *warning = NULL;
+    if (length <= 0)
+        return 0;
+    struct optimal_sequences *optimal = malloc(sizeof(struct optimal_sequences));
+    if (!optimal)
+        return length;
+    // Only the rows of the analyzed characters are used
+    memset(optimal->cells, 0, length * sizeof(optimal->cells[0]));
+    optimal->log10_factorial[1] = 0;
+
+    const time_t now = time(NULL);
+    const int reference_year = 1970 + (int) (now / SECONDS_PER_YEAR);
+    struct match_list matches = {0};
+    match_dictionary(password, length, &matches);
+    match_spatial(password, length, &qwerty_graph, true, &matches);
+    match_spatial(password, length, &keypad_graph, false, &matches);
+    match_repeat(password, length, &matches);
+    match_sequence(password, length, &matches);
+    match_dates(password, length, reference_year, &matches);
+
+    for (int l = 2; l <= length; l++) {
+        optimal->log10_factorial[l] = optimal->log10_factorial[l - 1] + log10(l);
+    }
+
+    for (int k = 0; k < length; k++) {
+        for (int m = 0; m < matches.count; m++) {
+            const struct match *match = &matches.items[m];
+            if (match->j != k)
+                continue;
+            double guesses = match->guesses_log10;
+            // Patterns covering only part of the password still cost a minimum number of guesses
+            if (match->j - match->i + 1 < length) {
+                const double minimum = log10(match->i == match->j ?
+                    MIN_SUBMATCH_GUESSES_SINGLE_CHAR : MIN_SUBMATCH_GUESSES_MULTI_CHAR);
+                if (guesses < minimum)
+                    guesses = minimum;
+            }
+            if (match->i == 0) {
+                update_optimal(optimal, m, 0, k, guesses, 1);
+                continue;
+            }
+            for (int l = 1; l <= match->i; l++) {
+                if (optimal->cells[match->i - 1][l].set)
+                    update_optimal(optimal, m, match->i, k, guesses, l + 1);
+            }
+        }
+
+        // Brute force from any start, but never directly after another brute forced part
+        for (int i = 0; i <= k; i++) {
+            const int bruteforce_length = k - i + 1;
+            double guesses = bruteforce_length * log10(BRUTEFORCE_CARDINALITY);
+            const double minimum = log10(bruteforce_length == 1 ? MIN_SUBMATCH_GUESSES_SINGLE_CHAR + 1 :
+                MIN_SUBMATCH_GUESSES_MULTI_CHAR + 1);
+            if (guesses < minimum)
+                guesses = minimum;
+            if (i == 0) {
+                update_optimal(optimal, -1, 0, k, guesses, 1);
+                continue;
+            }
+            for (int l = 1; l <= i; l++) {
+                const struct optimal_cell *previous = &optimal->cells[i - 1][l];
+                if (previous->set && previous->match >= 0)
+                    update_optimal(optimal, -1, i, k, guesses, l + 1);
+            }
+        }
+    }
+
+    int best_l = 0;
+    double best_g = DBL_MAX;
+    for (int l = 1; l <= length; l++) {
+        if (optimal->cells[length - 1][l].set && optimal->cells[length - 1][l].g < best_g) {
+            best_g = optimal->cells[length - 1][l].g;
+            best_l = l;
+        }
+    }
+
+    if (warning) {
+        // Report the longest pattern of the optimal sequence
+        int longest = -1;
+        for (int k = length - 1, l = best_l; k >= 0 && l > 0; l--) {
+            const struct optimal_cell *cell = &optimal->cells[k][l];
+            if (cell->match >= 0 && (longest < 0 ||
+                matches.items[cell->match].j - matches.items[cell->match].i >
+                matches.items[longest].j - matches.items[longest].i))
+                longest = cell->match;
+            k = cell->start - 1;
+        }
+        if (longest >= 0)
+            *warning = match_warning(&matches.items[longest], best_l == 1);
+    }
+    free(matches.items);
+    free(optimal);
+    return best_g;
+}
+
+
+/*
+ * Estimate the strength of a password by the number of guesses an attacker trying common
+ * passwords, words, keyboard walks, repeats, sequences and dates first would need.
+ * All tables are static, so there is no setup cost and the function can be called from any thread.
+ *
+ * param const char* password: The password
+ * param struct strength_result* result: Receives the estimate
+ */
+void estimate_strength(const char *password, struct strength_result *result) {
+    const int length = (int) strlen(password);
+    const int analyzed = length < MAX_ANALYZED_LENGTH ? length : MAX_ANALYZED_LENGTH;
+    const char *warning = NULL;
+    result->guesses_log10 = most_guessable_log10(password, analyzed, &warning) +
+        (length - analyzed) * log10(BRUTEFORCE_CARDINALITY);
+    if (result->guesses_log10 < STRENGTH_SCORE_1_LOG10) result->score = 0;
+    else if (result->guesses_log10 < STRENGTH_SCORE_2_LOG10) result->score = 1;
+    else if (result->guesses_log10 < STRENGTH_SCORE_3_LOG10) result->score = 2;
+    else if (result->guesses_log10 < STRENGTH_SCORE_4_LOG10) result->score = 3;
+    else result->score = 4;
+    // Strong passwords may still contain patterns, they are not worth a warning
+    result->warning = result->score <= 2 ? warning : NULL;
+}
+
+
+/*
+ * Check whether a password reaches the minimum strength score of the requirement
+ *
+ * param const char* password: The password
+ * param const struct password_requirement* requirement: The current password requirement
+ * return bool: true if the password is strong enough
+ */
+bool is_strong_password(const char *password, const struct password_requirement *requirement) {
+    if (requirement->min_strength <= 0)
+        return true;
+    struct strength_result result;
+    estimate_strength(password, &result);
+    return result.score >= requirement->min_strength;
+}
+
+
+/*
+ * Score every password of the vault and list the ones below the minimum strength of the requirement
+ * or of the policy they follow
+ *
+ * param FILE* stream: The output stream
+ * param struct password** passwords: Array containing the password struct pointers, may contain tombstones
+ * param int num_passwords: The current size of the array
+ * param const struct password_requirement* requirement: The current password requirement
+ * param bool list_all: List every entry with its score instead of only the weak ones
+ * return int: Number of passwords below the minimum strength
+ */
+int print_strength_report(
+    FILE *stream,
+    struct password **passwords,
+    const int num_passwords,
+    const struct password_requirement *requirement,
+    const bool list_all) {
+    int per_score[MAX_STRENGTH_SCORE + 1] = {0};
+    int weak = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] == NULL)
+            continue;
+        struct strength_result result;
+        estimate_strength(passwords[i]->password, &result);
+        per_score[result.score]++;
+        struct password_rules rules;
+        get_password_rules(requirement, passwords[i], &rules);
+        const bool is_weak = result.score < rules.min_strength;
+        if (is_weak && weak++ == 0 && !list_all)
+            fprintf(stream, "Passwords below the minimum strength:\n");
+        if (is_weak || list_all) {
+            fprintf(stream, "  [%d] %s (%s), about 10^%.1f guesses%s%s\n", result.score,
+                passwords[i]->name, passwords[i]->username, result.guesses_log10,
+                result.warning ? ": " : "", result.warning ? result.warning : "");
+        }
+    }
+    fprintf(stream, "Strength scores:");
+    for (int score = 0; score <= MAX_STRENGTH_SCORE; score++) {
+        fprintf(stream, " %d: %d%s", score, per_score[score], score < MAX_STRENGTH_SCORE ? "," : "\n");
+    }
+    fprintf(stream, "%d of %d password(s) are below the minimum strength of %d.\n",
+        weak, count_live_passwords(passwords, num_passwords), requirement->min_strength);
+    return weak;
+}
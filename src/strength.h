@@ -0,0 +1,29 @@
+#ifndef STRENGTH_H
+#define STRENGTH_H
+
+#include <stdio.h>
+#include "password.h"
+
+// Score thresholds as log10 of the estimated number of guesses
+#define STRENGTH_SCORE_1_LOG10 3
+#define STRENGTH_SCORE_2_LOG10 6
+#define STRENGTH_SCORE_3_LOG10 8
+#define STRENGTH_SCORE_4_LOG10 10
+#define MAX_STRENGTH_SCORE 4
+
+struct strength_result {
+    double guesses_log10; // log10 of the estimated number of guesses needed to find the password
+    int score;            // 0 (too guessable) to 4 (very unguessable)
+    const char *warning;  // Explanation of the weakest part, NULL if there is none
+};
+
+void estimate_strength(const char *password, struct strength_result *result);
+bool is_strong_password(const char *password, const struct password_requirement *requirement);
+int print_strength_report(
+    FILE *stream,
+    struct password **passwords,
+    int num_passwords,
+    const struct password_requirement *requirement,
+    bool list_all);
+
+#endif //STRENGTH_H
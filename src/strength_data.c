@@ -0,0 +1,1230 @@
+// Generated by tools/generate_strength_data.py, do not edit by hand
+
+#include "strength_data.h"
+
+const struct dictionary_word dictionary_words[] = {
+    {"0000", 184, DICTIONARY_PASSWORDS},
+    {"000000", 31, DICTIONARY_PASSWORDS},
+    {"1111", 64, DICTIONARY_PASSWORDS},
+    {"11111", 119, DICTIONARY_PASSWORDS},
+    {"111111", 8, DICTIONARY_PASSWORDS},
+    {"11111111", 67, DICTIONARY_PASSWORDS},
+    {"112233", 58, DICTIONARY_PASSWORDS},
+    {"121212", 30, DICTIONARY_PASSWORDS},
+    {"123123", 11, DICTIONARY_PASSWORDS},
+    {"123123123", 159, DICTIONARY_PASSWORDS},
+    {"123321", 22, DICTIONARY_PASSWORDS},
+    {"1234", 7, DICTIONARY_PASSWORDS},
+    {"12344321", 242, DICTIONARY_PASSWORDS},
+    {"12345", 6, DICTIONARY_PASSWORDS},
+    {"123456", 1, DICTIONARY_PASSWORDS},
+    {"1234567", 9, DICTIONARY_PASSWORDS},
+    {"12345678", 3, DICTIONARY_PASSWORDS},
+    {"123456789", 5, DICTIONARY_PASSWORDS},
+    {"1234567890", 24, DICTIONARY_PASSWORDS},
+    {"123456a", 279, DICTIONARY_PASSWORDS},
+    {"1234qwer", 104, DICTIONARY_PASSWORDS},
+    {"123654", 171, DICTIONARY_PASSWORDS},
+    {"123abc", 277, DICTIONARY_PASSWORDS},
+    {"123qwe", 33, DICTIONARY_PASSWORDS},
+    {"131313", 68, DICTIONARY_PASSWORDS},
+    {"159753", 73, DICTIONARY_PASSWORDS},
+    {"1q2w3e", 269, DICTIONARY_PASSWORDS},
+    {"1q2w3e4r", 224, DICTIONARY_PASSWORDS},
+    {"1qaz2wsx", 28, DICTIONARY_PASSWORDS},
+    {"1qaz2wsx3edc", 270, DICTIONARY_PASSWORDS},
+    {"2000", 49, DICTIONARY_PASSWORDS},
+    {"222222", 108, DICTIONARY_PASSWORDS},
+    {"232323", 234, DICTIONARY_PASSWORDS},
+    {"333333", 195, DICTIONARY_PASSWORDS},
+    {"555555", 66, DICTIONARY_PASSWORDS},
+    {"654321", 26, DICTIONARY_PASSWORDS},
+    {"666666", 20, DICTIONARY_PASSWORDS},
+    {"696969", 17, DICTIONARY_PASSWORDS},
+    {"7777", 245, DICTIONARY_PASSWORDS},
+    {"777777", 70, DICTIONARY_PASSWORDS},
+    {"7777777", 29, DICTIONARY_PASSWORDS},
+    {"8675309", 244, DICTIONARY_PASSWORDS},
+    {"87654321", 241, DICTIONARY_PASSWORDS},
+    {"888888", 236, DICTIONARY_PASSWORDS},
+    {"88888888", 109, DICTIONARY_PASSWORDS},
+    {"987654", 177, DICTIONARY_PASSWORDS},
+    {"987654321", 89, DICTIONARY_PASSWORDS},
+    {"999999", 180, DICTIONARY_PASSWORDS},
+    {"a123456", 278, DICTIONARY_PASSWORDS},
+    {"aaaaaa", 74, DICTIONARY_PASSWORDS},
+    {"aaron", 52, DICTIONARY_NAMES},
+    {"abc123", 13, DICTIONARY_PASSWORDS},
+    {"abc1234", 290, DICTIONARY_PASSWORDS},
+    {"abcd1234", 264, DICTIONARY_PASSWORDS},
+    {"abcdef", 263, DICTIONARY_PASSWORDS},
+    {"abigail", 179, DICTIONARY_NAMES},
+    {"able", 110, DICTIONARY_ENGLISH},
+    {"about", 23, DICTIONARY_ENGLISH},
+    {"access", 87, DICTIONARY_PASSWORDS},
+    {"action", 230, DICTIONARY_ENGLISH},
+    {"activity", 250, DICTIONARY_ENGLISH},
+    {"adam", 54, DICTIONARY_NAMES},
+    {"adams", 269, DICTIONARY_NAMES},
+    {"adidas", 221, DICTIONARY_PASSWORDS},
+    {"admin", 254, DICTIONARY_PASSWORDS},
+    {"admin123", 255, DICTIONARY_PASSWORDS},
+    {"after", 57, DICTIONARY_ENGLISH},
+    {"again", 525, DICTIONARY_ENGLISH},
+    {"age", 189, DICTIONARY_ENGLISH},
+    {"air", 183, DICTIONARY_ENGLISH},
+    {"alan", 87, DICTIONARY_NAMES},
+    {"albert", 85, DICTIONARY_NAMES},
+    {"alex", 200, DICTIONARY_NAMES},
+    {"alexander", 44, DICTIONARY_NAMES},
+    {"alexis", 198, DICTIONARY_NAMES},
+    {"alice", 180, DICTIONARY_NAMES},
+    {"all", 17, DICTIONARY_ENGLISH},
+    {"allen", 261, DICTIONARY_NAMES},
+    {"alone", 526, DICTIONARY_ENGLISH},
+    {"also", 55, DICTIONARY_ENGLISH},
+    {"alvarez", 317, DICTIONARY_NAMES},
+    {"always", 523, DICTIONARY_ENGLISH},
+    {"amanda", 79, DICTIONARY_PASSWORDS},
+    {"amber", 185, DICTIONARY_NAMES},
+    {"america", 574, DICTIONARY_ENGLISH},
+    {"amy", 132, DICTIONARY_NAMES},
+    {"and", 3, DICTIONARY_ENGLISH},
+    {"anderson", 245, DICTIONARY_NAMES},
+    {"andrea", 142, DICTIONARY_PASSWORDS},
+    {"andrew", 19, DICTIONARY_NAMES},
+    {"angel", 211, DICTIONARY_PASSWORDS},
+    {"angela", 133, DICTIONARY_NAMES},
+    {"animal", 472, DICTIONARY_ENGLISH},
+    {"ann", 172, DICTIONARY_NAMES},
+    {"anna", 135, DICTIONARY_NAMES},
+    {"annie", 229, DICTIONARY_NAMES},
+    {"anthony", 14, DICTIONARY_NAMES},
+    {"any", 70, DICTIONARY_ENGLISH},
+    {"apple", 316, DICTIONARY_ENGLISH},
+    {"april", 504, DICTIONARY_ENGLISH},
+    {"area", 166, DICTIONARY_ENGLISH},
+    {"arm", 226, DICTIONARY_ENGLISH},
+    {"army", 460, DICTIONARY_ENGLISH},
+    {"arsenal", 148, DICTIONARY_PASSWORDS},
+    {"art", 171, DICTIONARY_ENGLISH},
+    {"arthur", 74, DICTIONARY_NAMES},
+    {"asdf", 274, DICTIONARY_PASSWORDS},
+    {"asdfasdf", 239, DICTIONARY_PASSWORDS},
+    {"asdfgh", 39, DICTIONARY_PASSWORDS},
+    {"asdfghjkl", 276, DICTIONARY_PASSWORDS},
+    {"ashley", 82, DICTIONARY_PASSWORDS},
+    {"attention", 284, DICTIONARY_ENGLISH},
+    {"august", 508, DICTIONARY_ENGLISH},
+    {"austin", 72, DICTIONARY_NAMES},
+    {"autumn", 298, DICTIONARY_ENGLISH},
+    {"azerty", 265, DICTIONARY_PASSWORDS},
+    {"baby", 281, DICTIONARY_ENGLISH},
+    {"back", 56, DICTIONARY_ENGLISH},
+    {"bacon", 340, DICTIONARY_ENGLISH},
+    {"bad", 108, DICTIONARY_ENGLISH},
+    {"badboy", 207, DICTIONARY_PASSWORDS},
+    {"bailey", 113, DICTIONARY_PASSWORDS},
+    {"baker", 271, DICTIONARY_NAMES},
+    {"banana", 168, DICTIONARY_PASSWORDS},
+    {"barbara", 106, DICTIONARY_NAMES},
+    {"barney", 202, DICTIONARY_PASSWORDS},
+    {"baseball", 12, DICTIONARY_PASSWORDS},
+    {"baseball1", 286, DICTIONARY_PASSWORDS},
+    {"basketball", 478, DICTIONARY_ENGLISH},
+    {"batman", 44, DICTIONARY_PASSWORDS},
+    {"battle", 459, DICTIONARY_ENGLISH},
+    {"bear", 343, DICTIONARY_ENGLISH},
+    {"beautiful", 408, DICTIONARY_ENGLISH},
+    {"because", 69, DICTIONARY_ENGLISH},
+    {"ben", 203, DICTIONARY_NAMES},
+    {"benjamin", 41, DICTIONARY_NAMES},
+    {"bennett", 311, DICTIONARY_NAMES},
+    {"berlin", 565, DICTIONARY_ENGLISH},
+    {"berry", 324, DICTIONARY_ENGLISH},
+    {"betty", 113, DICTIONARY_NAMES},
+    {"beverly", 189, DICTIONARY_NAMES},
+    {"big", 97, DICTIONARY_ENGLISH},
+    {"bigdog", 124, DICTIONARY_PASSWORDS},
+    {"bill", 208, DICTIONARY_NAMES},
+    {"billy", 80, DICTIONARY_NAMES},
+    {"bird", 473, DICTIONARY_ENGLISH},
+    {"biteme", 85, DICTIONARY_PASSWORDS},
+    {"black", 372, DICTIONARY_ENGLISH},
+    {"blood", 452, DICTIONARY_ENGLISH},
+    {"blue", 368, DICTIONARY_ENGLISH},
+    {"blues", 556, DICTIONARY_ENGLISH},
+    {"bob", 207, DICTIONARY_NAMES},
+    {"bobby", 97, DICTIONARY_NAMES},
+    {"body", 451, DICTIONARY_ENGLISH},
+    {"bone", 453, DICTIONARY_ENGLISH},
+    {"booboo", 152, DICTIONARY_PASSWORDS},
+    {"book", 142, DICTIONARY_ENGLISH},
+    {"boomer", 151, DICTIONARY_PASSWORDS},
+    {"boston", 186, DICTIONARY_PASSWORDS},
+    {"boxing", 484, DICTIONARY_ENGLISH},
+    {"boy", 188, DICTIONARY_ENGLISH},
+    {"brandon", 40, DICTIONARY_NAMES},
+    {"brandy", 205, DICTIONARY_PASSWORDS},
+    {"brave", 420, DICTIONARY_ENGLISH},
+    {"bread", 332, DICTIONARY_ENGLISH},
+    {"brenda", 136, DICTIONARY_NAMES},
+    {"brian", 23, DICTIONARY_NAMES},
+    {"brittany", 194, DICTIONARY_NAMES},
+    {"brooks", 308, DICTIONARY_NAMES},
+    {"brother", 154, DICTIONARY_ENGLISH},
+    {"brown", 234, DICTIONARY_NAMES},
+    {"bruce", 82, DICTIONARY_NAMES},
+    {"bryan", 79, DICTIONARY_NAMES},
+    {"buddy", 532, DICTIONARY_ENGLISH},
+    {"building", 229, DICTIONARY_ENGLISH},
+    {"bulldog", 163, DICTIONARY_PASSWORDS},
+    {"bunny", 360, DICTIONARY_ENGLISH},
+    {"burger", 337, DICTIONARY_ENGLISH},
+    {"business", 146, DICTIONARY_ENGLISH},
+    {"buster", 41, DICTIONARY_PASSWORDS},
+    {"but", 10, DICTIONARY_ENGLISH},
+    {"butter", 333, DICTIONARY_ENGLISH},
+    {"california", 577, DICTIONARY_ENGLISH},
+    {"call", 83, DICTIONARY_ENGLISH},
+    {"camaro", 134, DICTIONARY_PASSWORDS},
+    {"campbell", 274, DICTIONARY_NAMES},
+    {"can", 29, DICTIONARY_ENGLISH},
+    {"canada", 572, DICTIONARY_ENGLISH},
+    {"candy", 329, DICTIONARY_ENGLISH},
+    {"car", 163, DICTIONARY_ENGLISH},
+    {"care", 203, DICTIONARY_ENGLISH},
+    {"carl", 73, DICTIONARY_NAMES},
+    {"carol", 121, DICTIONARY_NAMES},
+    {"carolyn", 146, DICTIONARY_NAMES},
+    {"carter", 276, DICTIONARY_NAMES},
+    {"case", 124, DICTIONARY_ENGLISH},
+    {"casper", 232, DICTIONARY_PASSWORDS},
+    {"castillo", 318, DICTIONARY_NAMES},
+    {"cat", 355, DICTIONARY_ENGLISH},
+    {"catherine", 148, DICTIONARY_NAMES},
+    {"center", 246, DICTIONARY_ENGLISH},
+    {"champion", 493, DICTIONARY_ENGLISH},
+    {"change", 176, DICTIONARY_ENGLISH},
+    {"changeme", 259, DICTIONARY_PASSWORDS},
+    {"charles", 10, DICTIONARY_NAMES},
+    {"charlie", 50, DICTIONARY_PASSWORDS},
+    {"charlie1", 300, DICTIONARY_PASSWORDS},
+    {"charlotte", 195, DICTIONARY_NAMES},
+    {"chavez", 309, DICTIONARY_NAMES},
+    {"cheese", 78, DICTIONARY_PASSWORDS},
+    {"chelsea", 84, DICTIONARY_PASSWORDS},
+    {"cherry", 319, DICTIONARY_ENGLISH},
+    {"cheryl", 166, DICTIONARY_NAMES},
+    {"chester", 190, DICTIONARY_PASSWORDS},
+    {"chicago", 206, DICTIONARY_PASSWORDS},
+    {"chicken", 129, DICTIONARY_PASSWORDS},
+    {"child", 111, DICTIONARY_ENGLISH},
+    {"china", 569, DICTIONARY_ENGLISH},
+    {"chloe", 223, DICTIONARY_NAMES},
+    {"chocolate", 326, DICTIONARY_ENGLISH},
+    {"chris", 212, DICTIONARY_NAMES},
+    {"christ", 440, DICTIONARY_ENGLISH},
+    {"christian", 65, DICTIONARY_NAMES},
+    {"christina", 160, DICTIONARY_NAMES},
+    {"christine", 143, DICTIONARY_NAMES},
+    {"christopher", 11, DICTIONARY_NAMES},
+    {"city", 134, DICTIONARY_ENGLISH},
+    {"clark", 255, DICTIONARY_NAMES},
+    {"class", 201, DICTIONARY_ENGLISH},
+    {"cloud", 305, DICTIONARY_ENGLISH},
+    {"cocacola", 231, DICTIONARY_PASSWORDS},
+    {"coffee", 182, DICTIONARY_PASSWORDS},
+    {"college", 196, DICTIONARY_ENGLISH},
+    {"collins", 286, DICTIONARY_NAMES},
+    {"come", 51, DICTIONARY_ENGLISH},
+    {"company", 126, DICTIONARY_ENGLISH},
+    {"compaq", 165, DICTIONARY_PASSWORDS},
+    {"computer", 60, DICTIONARY_PASSWORDS},
+    {"control", 202, DICTIONARY_ENGLISH},
+    {"cook", 292, DICTIONARY_NAMES},
+    {"cookie", 121, DICTIONARY_PASSWORDS},
+    {"cool", 413, DICTIONARY_ENGLISH},
+    {"cooper", 297, DICTIONARY_NAMES},
+    {"corvette", 97, DICTIONARY_PASSWORDS},
+    {"cost", 257, DICTIONARY_ENGLISH},
+    {"could", 42, DICTIONARY_ENGLISH},
+    {"country", 119, DICTIONARY_ENGLISH},
+    {"couple", 247, DICTIONARY_ENGLISH},
+    {"court", 254, DICTIONARY_ENGLISH},
+    {"cowboy", 139, DICTIONARY_PASSWORDS},
+    {"cowboys", 176, DICTIONARY_PASSWORDS},
+    {"cox", 304, DICTIONARY_NAMES},
+    {"crazy", 411, DICTIONARY_ENGLISH},
+    {"cricket", 483, DICTIONARY_ENGLISH},
+    {"crimson", 382, DICTIONARY_ENGLISH},
+    {"cruz", 284, DICTIONARY_NAMES},
+    {"crystal", 240, DICTIONARY_PASSWORDS},
+    {"cute", 406, DICTIONARY_ENGLISH},
+    {"cynthia", 130, DICTIONARY_NAMES},
+    {"dakota", 147, DICTIONARY_PASSWORDS},
+    {"dallas", 90, DICTIONARY_PASSWORDS},
+    {"dance", 557, DICTIONARY_ENGLISH},
+    {"daniel", 12, DICTIONARY_NAMES},
+    {"danielle", 188, DICTIONARY_NAMES},
+    {"darling", 530, DICTIONARY_ENGLISH},
+    {"data", 263, DICTIONARY_ENGLISH},
+    {"dave", 210, DICTIONARY_NAMES},
+    {"david", 6, DICTIONARY_NAMES},
+    {"davis", 238, DICTIONARY_NAMES},
+    {"day", 73, DICTIONARY_ENGLISH},
+    {"death", 198, DICTIONARY_ENGLISH},
+    {"deborah", 125, DICTIONARY_NAMES},
+    {"debra", 144, DICTIONARY_NAMES},
+    {"december", 512, DICTIONARY_ENGLISH},
+    {"decision", 220, DICTIONARY_ENGLISH},
+    {"default", 260, DICTIONARY_PASSWORDS},
+    {"demon", 400, DICTIONARY_ENGLISH},
+    {"denise", 184, DICTIONARY_NAMES},
+    {"dennis", 49, DICTIONARY_NAMES},
+    {"denver", 581, DICTIONARY_ENGLISH},
+    {"development", 205, DICTIONARY_ENGLISH},
+    {"devil", 399, DICTIONARY_ENGLISH},
+    {"diablo", 162, DICTIONARY_PASSWORDS},
+    {"diamond", 103, DICTIONARY_PASSWORDS},
+    {"diana", 192, DICTIONARY_NAMES},
+    {"diane", 151, DICTIONARY_NAMES},
+    {"diaz", 282, DICTIONARY_NAMES},
+    {"die", 456, DICTIONARY_ENGLISH},
+    {"difference", 227, DICTIONARY_ENGLISH},
+    {"different", 99, DICTIONARY_ENGLISH},
+    {"director", 235, DICTIONARY_ENGLISH},
+    {"disco", 558, DICTIONARY_ENGLISH},
+    {"doctor", 269, DICTIONARY_ENGLISH},
+    {"dog", 353, DICTIONARY_ENGLISH},
+    {"dolphin", 350, DICTIONARY_ENGLISH},
+    {"donald", 16, DICTIONARY_NAMES},
+    {"donna", 119, DICTIONARY_NAMES},
+    {"door", 168, DICTIONARY_ENGLISH},
+    {"doris", 186, DICTIONARY_NAMES},
+    {"dorothy", 123, DICTIONARY_NAMES},
+    {"douglas", 57, DICTIONARY_NAMES},
+    {"down", 88, DICTIONARY_ENGLISH},
+    {"dragon", 10, DICTIONARY_PASSWORDS},
+    {"dragon123", 284, DICTIONARY_PASSWORDS},
+    {"dream", 404, DICTIONARY_ENGLISH},
+    {"driver", 490, DICTIONARY_ENGLISH},
+    {"drug", 210, DICTIONARY_ENGLISH},
+    {"drums", 551, DICTIONARY_ENGLISH},
+    {"dylan", 76, DICTIONARY_NAMES},
+    {"eagle", 345, DICTIONARY_ENGLISH},
+    {"eagles", 149, DICTIONARY_PASSWORDS},
+    {"early", 103, DICTIONARY_ENGLISH},
+    {"earth", 470, DICTIONARY_ENGLISH},
+    {"education", 186, DICTIONARY_ENGLISH},
+    {"edward", 27, DICTIONARY_NAMES},
+    {"edwards", 285, DICTIONARY_NAMES},
+    {"effect", 200, DICTIONARY_ENGLISH},
+    {"effort", 207, DICTIONARY_ENGLISH},
+    {"elijah", 90, DICTIONARY_NAMES},
+    {"elizabeth", 105, DICTIONARY_NAMES},
+    {"ella", 220, DICTIONARY_NAMES},
+    {"email", 543, DICTIONARY_ENGLISH},
+    {"emerald", 388, DICTIONARY_ENGLISH},
+    {"emily", 118, DICTIONARY_NAMES},
+    {"emma", 138, DICTIONARY_NAMES},
+    {"end", 160, DICTIONARY_ENGLISH},
+    {"enter", 216, DICTIONARY_PASSWORDS},
+    {"eric", 34, DICTIONARY_NAMES},
+    {"ethan", 61, DICTIONARY_NAMES},
+    {"eugene", 95, DICTIONARY_NAMES},
+    {"evans", 280, DICTIONARY_NAMES},
+    {"evelyn", 162, DICTIONARY_NAMES},
+    {"even", 66, DICTIONARY_ENGLISH},
+    {"evening", 519, DICTIONARY_ENGLISH},
+    {"event", 243, DICTIONARY_ENGLISH},
+    {"evidence", 291, DICTIONARY_ENGLISH},
+    {"experience", 199, DICTIONARY_ENGLISH},
+    {"eye", 143, DICTIONARY_ENGLISH},
+    {"facebook", 547, DICTIONARY_ENGLISH},
+    {"fact", 138, DICTIONARY_ENGLISH},
+    {"falcon", 138, DICTIONARY_PASSWORDS},
+    {"fall", 299, DICTIONARY_ENGLISH},
+    {"family", 117, DICTIONARY_ENGLISH},
+    {"fast", 415, DICTIONARY_ENGLISH},
+    {"father", 152, DICTIONARY_ENGLISH},
+    {"february", 502, DICTIONARY_ENGLISH},
+    {"fender", 201, DICTIONARY_PASSWORDS},
+    {"ferrari", 140, DICTIONARY_PASSWORDS},
+    {"few", 106, DICTIONARY_ENGLISH},
+    {"field", 204, DICTIONARY_ENGLISH},
+    {"fight", 458, DICTIONARY_ENGLISH},
+    {"figure", 259, DICTIONARY_ENGLISH},
+    {"film", 285, DICTIONARY_ENGLISH},
+    {"find", 75, DICTIONARY_ENGLISH},
+    {"fire", 294, DICTIONARY_ENGLISH},
+    {"fireman", 562, DICTIONARY_ENGLISH},
+    {"first", 63, DICTIONARY_ENGLISH},
+    {"fish", 474, DICTIONARY_ENGLISH},
+    {"fishing", 230, DICTIONARY_PASSWORDS},
+    {"flores", 267, DICTIONARY_NAMES},
+    {"florida", 576, DICTIONARY_ENGLISH},
+    {"flower", 212, DICTIONARY_PASSWORDS},
+    {"foot", 187, DICTIONARY_ENGLISH},
+    {"football", 14, DICTIONARY_PASSWORDS},
+    {"football1", 285, DICTIONARY_PASSWORDS},
+    {"for", 6, DICTIONARY_ENGLISH},
+    {"force", 185, DICTIONARY_ENGLISH},
+    {"forest", 311, DICTIONARY_ENGLISH},
+    {"forever", 192, DICTIONARY_PASSWORDS},
+    {"form", 242, DICTIONARY_ENGLISH},
+    {"foster", 324, DICTIONARY_NAMES},
+    {"frances", 175, DICTIONARY_NAMES},
+    {"frank", 45, DICTIONARY_NAMES},
+    {"freedom", 69, DICTIONARY_PASSWORDS},
+    {"freedom1", 303, DICTIONARY_PASSWORDS},
+    {"friday", 498, DICTIONARY_ENGLISH},
+    {"friend", 151, DICTIONARY_ENGLISH},
+    {"friends", 528, DICTIONARY_ENGLISH},
+    {"gabriel", 83, DICTIONARY_NAMES},
+    {"galaxy", 468, DICTIONARY_ENGLISH},
+    {"game", 158, DICTIONARY_ENGLISH},
+    {"gamer", 491, DICTIONARY_ENGLISH},
+    {"gandalf", 238, DICTIONARY_PASSWORDS},
+    {"garcia", 236, DICTIONARY_NAMES},
+    {"garden", 312, DICTIONARY_ENGLISH},
+    {"gary", 32, DICTIONARY_NAMES},
+    {"gateway", 160, DICTIONARY_PASSWORDS},
+    {"george", 24, DICTIONARY_NAMES},
+    {"gerald", 69, DICTIONARY_NAMES},
+    {"get", 25, DICTIONARY_ENGLISH},
+    {"gfhjkm", 105, DICTIONARY_PASSWORDS},
+    {"ghbdtn", 229, DICTIONARY_PASSWORDS},
+    {"ghost", 397, DICTIONARY_ENGLISH},
+    {"ginger", 75, DICTIONARY_PASSWORDS},
+    {"girl", 180, DICTIONARY_ENGLISH},
+    {"give", 72, DICTIONARY_ENGLISH},
+    {"gloria", 170, DICTIONARY_NAMES},
+    {"glory", 447, DICTIONARY_ENGLISH},
+    {"god", 438, DICTIONARY_ENGLISH},
+    {"gold", 376, DICTIONARY_ENGLISH},
+    {"golden", 243, DICTIONARY_PASSWORDS},
+    {"golf", 481, DICTIONARY_ENGLISH},
+    {"golfer", 120, DICTIONARY_PASSWORDS},
+    {"gomez", 278, DICTIONARY_NAMES},
+    {"gonzalez", 243, DICTIONARY_NAMES},
+    {"good", 40, DICTIONARY_ENGLISH},
+    {"goodbye", 518, DICTIONARY_ENGLISH},
+    {"google", 545, DICTIONARY_ENGLISH},
+    {"government", 130, DICTIONARY_ENGLISH},
+    {"grace", 183, DICTIONARY_NAMES},
+    {"grape", 321, DICTIONARY_ENGLISH},
+    {"gray", 312, DICTIONARY_NAMES},
+    {"great", 92, DICTIONARY_ENGLISH},
+    {"green", 268, DICTIONARY_NAMES},
+    {"gregory", 43, DICTIONARY_NAMES},
+    {"grey", 380, DICTIONARY_ENGLISH},
+    {"ground", 241, DICTIONARY_ENGLISH},
+    {"group", 118, DICTIONARY_ENGLISH},
+    {"guest", 261, DICTIONARY_PASSWORDS},
+    {"guitar", 125, DICTIONARY_PASSWORDS},
+    {"gutierrez", 294, DICTIONARY_NAMES},
+    {"guy", 181, DICTIONARY_ENGLISH},
+    {"hair", 289, DICTIONARY_ENGLISH},
+    {"hall", 272, DICTIONARY_NAMES},
+    {"hammer", 106, DICTIONARY_PASSWORDS},
+    {"hand", 121, DICTIONARY_ENGLISH},
+    {"hannah", 167, DICTIONARY_NAMES},
+    {"happy", 300, DICTIONARY_ENGLISH},
+    {"hardcore", 167, DICTIONARY_PASSWORDS},
+    {"harley", 43, DICTIONARY_PASSWORDS},
+    {"harold", 70, DICTIONARY_NAMES},
+    {"harris", 253, DICTIONARY_NAMES},
+    {"have", 5, DICTIONARY_ENGLISH},
+    {"hawk", 346, DICTIONARY_ENGLISH},
+    {"head", 150, DICTIONARY_ENGLISH},
+    {"health", 169, DICTIONARY_ENGLISH},
+    {"heart", 209, DICTIONARY_ENGLISH},
+    {"heather", 100, DICTIONARY_PASSWORDS},
+    {"heaven", 401, DICTIONARY_ENGLISH},
+    {"helen", 140, DICTIONARY_NAMES},
+    {"hell", 402, DICTIONARY_ENGLISH},
+    {"hello", 98, DICTIONARY_PASSWORDS},
+    {"hello123", 282, DICTIONARY_PASSWORDS},
+    {"henry", 56, DICTIONARY_NAMES},
+    {"her", 13, DICTIONARY_ENGLISH},
+    {"here", 76, DICTIONARY_ENGLISH},
+    {"hernandez", 241, DICTIONARY_NAMES},
+    {"hero", 421, DICTIONARY_ENGLISH},
+    {"hidden", 395, DICTIONARY_ENGLISH},
+    {"high", 98, DICTIONARY_ENGLISH},
+    {"hill", 266, DICTIONARY_NAMES},
+    {"him", 33, DICTIONARY_ENGLISH},
+    {"his", 11, DICTIONARY_ENGLISH},
+    {"history", 173, DICTIONARY_ENGLISH},
+    {"hockey", 53, DICTIONARY_PASSWORDS},
+    {"home", 116, DICTIONARY_ENGLISH},
+    {"honey", 331, DICTIONARY_ENGLISH},
+    {"honor", 448, DICTIONARY_ENGLISH},
+    {"horse", 351, DICTIONARY_ENGLISH},
+    {"hot", 414, DICTIONARY_ENGLISH},
+    {"hour", 157, DICTIONARY_ENGLISH},
+    {"house", 114, DICTIONARY_ENGLISH},
+    {"how", 60, DICTIONARY_ENGLISH},
+    {"howard", 301, DICTIONARY_NAMES},
+    {"hughes", 315, DICTIONARY_NAMES},
+    {"hunter", 40, DICTIONARY_PASSWORDS},
+    {"iceman", 174, DICTIONARY_PASSWORDS},
+    {"iloveu", 266, DICTIONARY_PASSWORDS},
+    {"iloveyou", 48, DICTIONARY_PASSWORDS},
+    {"iloveyou1", 299, DICTIONARY_PASSWORDS},
+    {"image", 261, DICTIONARY_ENGLISH},
+    {"important", 105, DICTIONARY_ENGLISH},
+    {"india", 571, DICTIONARY_ENGLISH},
+    {"industry", 258, DICTIONARY_ENGLISH},
+    {"interest", 197, DICTIONARY_ENGLISH},
+    {"internet", 116, DICTIONARY_PASSWORDS},
+    {"into", 37, DICTIONARY_ENGLISH},
+    {"isabella", 190, DICTIONARY_NAMES},
+    {"issue", 147, DICTIONARY_ENGLISH},
+    {"its", 52, DICTIONARY_ENGLISH},
+    {"ivory", 392, DICTIONARY_ENGLISH},
+    {"jack", 48, DICTIONARY_NAMES},
+    {"jackson", 126, DICTIONARY_PASSWORDS},
+    {"jacob", 31, DICTIONARY_NAMES},
+    {"jacqueline", 168, DICTIONARY_NAMES},
+    {"jade", 390, DICTIONARY_ENGLISH},
+    {"jake", 216, DICTIONARY_NAMES},
+    {"james", 1, DICTIONARY_NAMES},
+    {"janet", 147, DICTIONARY_NAMES},
+    {"janice", 177, DICTIONARY_NAMES},
+    {"january", 501, DICTIONARY_ENGLISH},
+    {"japan", 570, DICTIONARY_ENGLISH},
+    {"jasmine", 225, DICTIONARY_PASSWORDS},
+    {"jason", 28, DICTIONARY_NAMES},
+    {"jasper", 215, DICTIONARY_PASSWORDS},
+    {"jazz", 555, DICTIONARY_ENGLISH},
+    {"jean", 178, DICTIONARY_NAMES},
+    {"jeffrey", 29, DICTIONARY_NAMES},
+    {"jennifer", 37, DICTIONARY_PASSWORDS},
+    {"jenny", 228, DICTIONARY_NAMES},
+    {"jeremy", 64, DICTIONARY_NAMES},
+    {"jerry", 50, DICTIONARY_NAMES},
+    {"jesse", 77, DICTIONARY_NAMES},
+    {"jessica", 62, DICTIONARY_PASSWORDS},
+    {"jessie", 225, DICTIONARY_NAMES},
+    {"jesus", 439, DICTIONARY_ENGLISH},
+    {"jim", 206, DICTIONARY_NAMES},
+    {"jimenez", 325, DICTIONARY_NAMES},
+    {"joan", 161, DICTIONARY_NAMES},
+    {"job", 144, DICTIONARY_ENGLISH},
+    {"joe", 81, DICTIONARY_NAMES},
+    {"john", 2, DICTIONARY_NAMES},
+    {"johnny", 193, DICTIONARY_PASSWORDS},
+    {"johnson", 232, DICTIONARY_NAMES},
+    {"jonathan", 35, DICTIONARY_NAMES},
+    {"jones", 235, DICTIONARY_NAMES},
+    {"jordan", 36, DICTIONARY_PASSWORDS},
+    {"jordan23", 295, DICTIONARY_PASSWORDS},
+    {"jose", 53, DICTIONARY_NAMES},
+    {"joseph", 8, DICTIONARY_NAMES},
+    {"josh", 215, DICTIONARY_NAMES},
+    {"joshua", 20, DICTIONARY_NAMES},
+    {"joyce", 155, DICTIONARY_NAMES},
+    {"juan", 88, DICTIONARY_NAMES},
+    {"judith", 163, DICTIONARY_NAMES},
+    {"judy", 181, DICTIONARY_NAMES},
+    {"julie", 153, DICTIONARY_NAMES},
+    {"july", 507, DICTIONARY_ENGLISH},
+    {"june", 506, DICTIONARY_ENGLISH},
+    {"junior", 169, DICTIONARY_PASSWORDS},
+    {"just", 32, DICTIONARY_ENGLISH},
+    {"justice", 443, DICTIONARY_ENGLISH},
+    {"justin", 38, DICTIONARY_NAMES},
+    {"karen", 110, DICTIONARY_NAMES},
+    {"kate", 227, DICTIONARY_NAMES},
+    {"katherine", 142, DICTIONARY_NAMES},
+    {"kathleen", 131, DICTIONARY_NAMES},
+    {"kathryn", 176, DICTIONARY_NAMES},
+    {"katie", 226, DICTIONARY_NAMES},
+    {"kayla", 197, DICTIONARY_NAMES},
+    {"keith", 66, DICTIONARY_NAMES},
+    {"kelly", 158, DICTIONARY_NAMES},
+    {"kenneth", 21, DICTIONARY_NAMES},
+    {"kevin", 22, DICTIONARY_NAMES},
+    {"kill", 457, DICTIONARY_ENGLISH},
+    {"killer", 34, DICTIONARY_PASSWORDS},
+    {"killer123", 296, DICTIONARY_PASSWORDS},
+    {"kim", 303, DICTIONARY_NAMES},
+    {"kimberly", 117, DICTIONARY_NAMES},
+    {"kind", 149, DICTIONARY_ENGLISH},
+    {"king", 262, DICTIONARY_NAMES},
+    {"kitten", 357, DICTIONARY_ENGLISH},
+    {"kitty", 356, DICTIONARY_ENGLISH},
+    {"klaster", 57, DICTIONARY_PASSWORDS},
+    {"knight", 200, DICTIONARY_PASSWORDS},
+    {"know", 34, DICTIONARY_ENGLISH},
+    {"kyle", 60, DICTIONARY_NAMES},
+    {"lake", 309, DICTIONARY_ENGLISH},
+    {"lakers", 173, DICTIONARY_PASSWORDS},
+    {"land", 267, DICTIONARY_ENGLISH},
+    {"large", 101, DICTIONARY_ENGLISH},
+    {"larry", 37, DICTIONARY_NAMES},
+    {"last", 89, DICTIONARY_ENGLISH},
+    {"laura", 129, DICTIONARY_NAMES},
+    {"lauren", 159, DICTIONARY_NAMES},
+    {"law", 162, DICTIONARY_ENGLISH},
+    {"lawrence", 75, DICTIONARY_NAMES},
+    {"lawyer", 561, DICTIONARY_ENGLISH},
+    {"leader", 212, DICTIONARY_ENGLISH},
+    {"lee", 250, DICTIONARY_NAMES},
+    {"legend", 422, DICTIONARY_ENGLISH},
+    {"lemon", 320, DICTIONARY_ENGLISH},
+    {"letmein", 16, DICTIONARY_PASSWORDS},
+    {"letmein1", 258, DICTIONARY_PASSWORDS},
+    {"letmein123", 301, DICTIONARY_PASSWORDS},
+    {"lewis", 257, DICTIONARY_NAMES},
+    {"liberty", 442, DICTIONARY_ENGLISH},
+    {"life", 87, DICTIONARY_ENGLISH},
+    {"light", 213, DICTIONARY_ENGLISH},
+    {"like", 30, DICTIONARY_ENGLISH},
+    {"lily", 219, DICTIONARY_NAMES},
+    {"linda", 104, DICTIONARY_NAMES},
+    {"line", 159, DICTIONARY_ENGLISH},
+    {"lion", 342, DICTIONARY_ENGLISH},
+    {"lisa", 111, DICTIONARY_NAMES},
+    {"little", 93, DICTIONARY_ENGLISH},
+    {"live", 455, DICTIONARY_ENGLISH},
+    {"liverpool", 247, DICTIONARY_PASSWORDS},
+    {"logan", 84, DICTIONARY_NAMES},
+    {"login", 262, DICTIONARY_PASSWORDS},
+    {"london", 178, DICTIONARY_PASSWORDS},
+    {"long", 91, DICTIONARY_ENGLISH},
+    {"look", 49, DICTIONARY_ENGLISH},
+    {"lopez", 242, DICTIONARY_NAMES},
+    {"lord", 437, DICTIONARY_ENGLISH},
+    {"lori", 199, DICTIONARY_NAMES},
+    {"lot", 140, DICTIONARY_ENGLISH},
+    {"louis", 100, DICTIONARY_NAMES},
+    {"love", 81, DICTIONARY_PASSWORDS},
+    {"lovely", 246, DICTIONARY_PASSWORDS},
+    {"loveme", 267, DICTIONARY_PASSWORDS},
+    {"lover", 529, DICTIONARY_ENGLISH},
+    {"lucky", 410, DICTIONARY_ENGLISH},
+    {"lucy", 218, DICTIONARY_NAMES},
+    {"luke", 217, DICTIONARY_NAMES},
+    {"madison", 174, DICTIONARY_NAMES},
+    {"maggie", 72, DICTIONARY_PASSWORDS},
+    {"magic", 393, DICTIONARY_ENGLISH},
+    {"make", 28, DICTIONARY_ENGLISH},
+    {"man", 113, DICTIONARY_ENGLISH},
+    {"mango", 323, DICTIONARY_ENGLISH},
+    {"many", 78, DICTIONARY_ENGLISH},
+    {"march", 503, DICTIONARY_ENGLISH},
+    {"margaret", 114, DICTIONARY_NAMES},
+    {"maria", 149, DICTIONARY_NAMES},
+    {"marie", 196, DICTIONARY_NAMES},
+    {"marilyn", 187, DICTIONARY_NAMES},
+    {"marina", 161, DICTIONARY_PASSWORDS},
+    {"marine", 228, DICTIONARY_PASSWORDS},
+    {"mark", 15, DICTIONARY_NAMES},
+    {"market", 192, DICTIONARY_ENGLISH},
+    {"marlboro", 237, DICTIONARY_PASSWORDS},
+    {"martha", 169, DICTIONARY_NAMES},
+    {"martin", 99, DICTIONARY_PASSWORDS},
+    {"martinez", 240, DICTIONARY_NAMES},
+    {"mary", 101, DICTIONARY_NAMES},
+    {"mason", 98, DICTIONARY_NAMES},
+    {"master", 19, DICTIONARY_PASSWORDS},
+    {"master123", 292, DICTIONARY_PASSWORDS},
+    {"matrix", 94, DICTIONARY_PASSWORDS},
+    {"matt", 213, DICTIONARY_NAMES},
+    {"matter", 245, DICTIONARY_ENGLISH},
+    {"matthew", 13, DICTIONARY_NAMES},
+    {"maverick", 132, DICTIONARY_PASSWORDS},
+    {"max", 201, DICTIONARY_NAMES},
+    {"may", 505, DICTIONARY_ENGLISH},
+    {"mega", 417, DICTIONARY_ENGLISH},
+    {"megan", 164, DICTIONARY_NAMES},
+    {"melissa", 124, DICTIONARY_NAMES},
+    {"member", 161, DICTIONARY_ENGLISH},
+    {"mendoza", 313, DICTIONARY_NAMES},
+    {"mercedes", 146, DICTIONARY_PASSWORDS},
+    {"merlin", 102, DICTIONARY_PASSWORDS},
+    {"metal", 553, DICTIONARY_ENGLISH},
+    {"mexico", 573, DICTIONARY_ENGLISH},
+    {"mia", 221, DICTIONARY_NAMES},
+    {"miami", 582, DICTIONARY_ENGLISH},
+    {"michael", 4, DICTIONARY_NAMES},
+    {"michael1", 294, DICTIONARY_PASSWORDS},
+    {"michelle", 61, DICTIONARY_PASSWORDS},
+    {"mickey", 128, DICTIONARY_PASSWORDS},
+    {"midnight", 203, DICTIONARY_PASSWORDS},
+    {"mike", 209, DICTIONARY_NAMES},
+    {"miller", 185, DICTIONARY_PASSWORDS},
+    {"mind", 217, DICTIONARY_ENGLISH},
+    {"minecraft", 95, DICTIONARY_PASSWORDS},
+    {"mitchell", 275, DICTIONARY_NAMES},
+    {"mobile", 544, DICTIONARY_ENGLISH},
+    {"model", 231, DICTIONARY_ENGLISH},
+    {"molly", 230, DICTIONARY_NAMES},
+    {"moment", 182, DICTIONARY_ENGLISH},
+    {"monday", 494, DICTIONARY_ENGLISH},
+    {"money", 136, DICTIONARY_ENGLISH},
+    {"monkey", 15, DICTIONARY_PASSWORDS},
+    {"monkey123", 283, DICTIONARY_PASSWORDS},
+    {"monster", 155, DICTIONARY_PASSWORDS},
+    {"month", 139, DICTIONARY_ENGLISH},
+    {"moon", 466, DICTIONARY_ENGLISH},
+    {"moore", 247, DICTIONARY_NAMES},
+    {"morales", 290, DICTIONARY_NAMES},
+    {"morgan", 136, DICTIONARY_PASSWORDS},
+    {"morning", 177, DICTIONARY_ENGLISH},
+    {"morris", 289, DICTIONARY_NAMES},
+    {"moscow", 568, DICTIONARY_ENGLISH},
+    {"most", 74, DICTIONARY_ENGLISH},
+    {"mother", 153, DICTIONARY_ENGLISH},
+    {"mountain", 310, DICTIONARY_ENGLISH},
+    {"mouse", 358, DICTIONARY_ENGLISH},
+    {"movie", 275, DICTIONARY_ENGLISH},
+    {"murphy", 291, DICTIONARY_NAMES},
+    {"music", 191, DICTIONARY_ENGLISH},
+    {"mustang", 23, DICTIONARY_PASSWORDS},
+    {"myers", 321, DICTIONARY_NAMES},
+    {"nancy", 112, DICTIONARY_NAMES},
+    {"nascar", 154, DICTIONARY_PASSWORDS},
+    {"natalie", 193, DICTIONARY_NAMES},
+    {"natasha", 223, DICTIONARY_PASSWORDS},
+    {"nathan", 55, DICTIONARY_NAMES},
+    {"nation", 194, DICTIONARY_ENGLISH},
+    {"nature", 471, DICTIONARY_ENGLISH},
+    {"navy", 461, DICTIONARY_ENGLISH},
+    {"ncc1701", 181, DICTIONARY_PASSWORDS},
+    {"need", 253, DICTIONARY_ENGLISH},
+    {"nelson", 270, DICTIONARY_NAMES},
+    {"network", 541, DICTIONARY_ENGLISH},
+    {"never", 85, DICTIONARY_ENGLISH},
+    {"new", 67, DICTIONARY_ENGLISH},
+    {"news", 273, DICTIONARY_ENGLISH},
+    {"next", 102, DICTIONARY_ENGLISH},
+    {"nguyen", 265, DICTIONARY_NAMES},
+    {"nicholas", 33, DICTIONARY_NAMES},
+    {"nick", 214, DICTIONARY_NAMES},
+    {"nicole", 83, DICTIONARY_PASSWORDS},
+    {"night", 132, DICTIONARY_ENGLISH},
+    {"nikita", 199, DICTIONARY_PASSWORDS},
+    {"ninja", 431, DICTIONARY_ENGLISH},
+    {"noah", 63, DICTIONARY_NAMES},
+    {"north", 276, DICTIONARY_ENGLISH},
+    {"not", 7, DICTIONARY_ENGLISH},
+    {"november", 511, DICTIONARY_ENGLISH},
+    {"now", 48, DICTIONARY_ENGLISH},
+    {"number", 131, DICTIONARY_ENGLISH},
+    {"nurse", 560, DICTIONARY_ENGLISH},
+    {"ocean", 307, DICTIONARY_ENGLISH},
+    {"october", 510, DICTIONARY_ENGLISH},
+    {"office", 167, DICTIONARY_ENGLISH},
+    {"official", 244, DICTIONARY_ENGLISH},
+    {"oil", 255, DICTIONARY_ENGLISH},
+    {"old", 95, DICTIONARY_ENGLISH},
+    {"oliver", 196, DICTIONARY_PASSWORDS},
+    {"olivia", 154, DICTIONARY_NAMES},
+    {"one", 16, DICTIONARY_ENGLISH},
+    {"only", 50, DICTIONARY_ENGLISH},
+    {"orange", 118, DICTIONARY_PASSWORDS},
+    {"organization", 288, DICTIONARY_ENGLISH},
+    {"ortiz", 295, DICTIONARY_NAMES},
+    {"other", 45, DICTIONARY_ENGLISH},
+    {"our", 61, DICTIONARY_ENGLISH},
+    {"out", 22, DICTIONARY_ENGLISH},
+    {"over", 53, DICTIONARY_ENGLISH},
+    {"own", 94, DICTIONARY_ENGLISH},
+    {"p@ssw0rd", 251, DICTIONARY_PASSWORDS},
+    {"p@ssword", 252, DICTIONARY_PASSWORDS},
+    {"pamela", 137, DICTIONARY_NAMES},
+    {"panda", 365, DICTIONARY_ENGLISH},
+    {"paper", 239, DICTIONARY_ENGLISH},
+    {"paradise", 403, DICTIONARY_ENGLISH},
+    {"paris", 564, DICTIONARY_ENGLISH},
+    {"parker", 283, DICTIONARY_NAMES},
+    {"part", 122, DICTIONARY_ENGLISH},
+    {"party", 174, DICTIONARY_ENGLISH},
+    {"pass", 71, DICTIONARY_PASSWORDS},
+    {"pass123", 281, DICTIONARY_PASSWORDS},
+    {"passw0rd", 250, DICTIONARY_PASSWORDS},
+    {"password", 2, DICTIONARY_PASSWORDS},
+    {"password1", 249, DICTIONARY_PASSWORDS},
+    {"password123", 280, DICTIONARY_PASSWORDS},
+    {"pasta", 336, DICTIONARY_ENGLISH},
+    {"patel", 320, DICTIONARY_NAMES},
+    {"patient", 271, DICTIONARY_ENGLISH},
+    {"patricia", 102, DICTIONARY_NAMES},
+    {"patrick", 46, DICTIONARY_NAMES},
+    {"paul", 18, DICTIONARY_NAMES},
+    {"peace", 444, DICTIONARY_ENGLISH},
+    {"peach", 322, DICTIONARY_ENGLISH},
+    {"peanut", 135, DICTIONARY_PASSWORDS},
+    {"pearl", 386, DICTIONARY_ENGLISH},
+    {"people", 36, DICTIONARY_ENGLISH},
+    {"pepper", 63, DICTIONARY_PASSWORDS},
+    {"perez", 251, DICTIONARY_NAMES},
+    {"person", 170, DICTIONARY_ENGLISH},
+    {"peter", 59, DICTIONARY_NAMES},
+    {"peterson", 298, DICTIONARY_NAMES},
+    {"philip", 99, DICTIONARY_NAMES},
+    {"phillips", 279, DICTIONARY_NAMES},
+    {"phoenix", 133, DICTIONARY_PASSWORDS},
+    {"phone", 262, DICTIONARY_ENGLISH},
+    {"piano", 550, DICTIONARY_ENGLISH},
+    {"picture", 264, DICTIONARY_ENGLISH},
+    {"piece", 266, DICTIONARY_ENGLISH},
+    {"pilot", 463, DICTIONARY_ENGLISH},
+    {"pink", 377, DICTIONARY_ENGLISH},
+    {"pirate", 433, DICTIONARY_ENGLISH},
+    {"pizza", 335, DICTIONARY_ENGLISH},
+    {"place", 123, DICTIONARY_ENGLISH},
+    {"plan", 195, DICTIONARY_ENGLISH},
+    {"planet", 465, DICTIONARY_ENGLISH},
+    {"play", 135, DICTIONARY_ENGLISH},
+    {"player", 198, DICTIONARY_PASSWORDS},
+    {"please", 204, DICTIONARY_PASSWORDS},
+    {"point", 133, DICTIONARY_ENGLISH},
+    {"police", 216, DICTIONARY_ENGLISH},
+    {"policy", 190, DICTIONARY_ENGLISH},
+    {"pony", 352, DICTIONARY_ENGLISH},
+    {"population", 292, DICTIONARY_ENGLISH},
+    {"porsche", 172, DICTIONARY_PASSWORDS},
+    {"position", 236, DICTIONARY_ENGLISH},
+    {"power", 156, DICTIONARY_ENGLISH},
+    {"practice", 265, DICTIONARY_ENGLISH},
+    {"pretty", 407, DICTIONARY_ENGLISH},
+    {"price", 218, DICTIONARY_ENGLISH},
+    {"prince", 227, DICTIONARY_PASSWORDS},
+    {"princess", 76, DICTIONARY_PASSWORDS},
+    {"princess1", 298, DICTIONARY_PASSWORDS},
+    {"private", 538, DICTIONARY_ENGLISH},
+    {"problem", 120, DICTIONARY_ENGLISH},
+    {"product", 268, DICTIONARY_ENGLISH},
+    {"program", 128, DICTIONARY_ENGLISH},
+    {"project", 249, DICTIONARY_ENGLISH},
+    {"public", 107, DICTIONARY_ENGLISH},
+    {"punk", 554, DICTIONARY_ENGLISH},
+    {"puppy", 354, DICTIONARY_ENGLISH},
+    {"purple", 166, DICTIONARY_PASSWORDS},
+    {"q1w2e3r4", 187, DICTIONARY_PASSWORDS},
+    {"q1w2e3r4t5", 114, DICTIONARY_PASSWORDS},
+    {"qazwsx", 32, DICTIONARY_PASSWORDS},
+    {"queen", 424, DICTIONARY_ENGLISH},
+    {"question", 129, DICTIONARY_ENGLISH},
+    {"qweasd", 272, DICTIONARY_PASSWORDS},
+    {"qweasdzxc", 273, DICTIONARY_PASSWORDS},
+    {"qwer1234", 164, DICTIONARY_PASSWORDS},
+    {"qwert", 275, DICTIONARY_PASSWORDS},
+    {"qwerty", 4, DICTIONARY_PASSWORDS},
+    {"qwerty1", 289, DICTIONARY_PASSWORDS},
+    {"qwerty123", 248, DICTIONARY_PASSWORDS},
+    {"qwertyuiop", 21, DICTIONARY_PASSWORDS},
+    {"rabbit", 213, DICTIONARY_PASSWORDS},
+    {"rachel", 145, DICTIONARY_NAMES},
+    {"racing", 485, DICTIONARY_ENGLISH},
+    {"raiders", 235, DICTIONARY_PASSWORDS},
+    {"rain", 302, DICTIONARY_ENGLISH},
+    {"ralph", 94, DICTIONARY_NAMES},
+    {"ramirez", 256, DICTIONARY_NAMES},
+    {"ramos", 302, DICTIONARY_NAMES},
+    {"randy", 91, DICTIONARY_NAMES},
+    {"ranger", 54, DICTIONARY_PASSWORDS},
+    {"rangers", 209, DICTIONARY_PASSWORDS},
+    {"rate", 208, DICTIONARY_ENGLISH},
+    {"raymond", 47, DICTIONARY_NAMES},
+    {"reason", 178, DICTIONARY_ENGLISH},
+    {"rebecca", 127, DICTIONARY_NAMES},
+    {"record", 238, DICTIONARY_ENGLISH},
+    {"red", 367, DICTIONARY_ENGLISH},
+    {"redsox", 197, DICTIONARY_PASSWORDS},
+    {"reed", 300, DICTIONARY_NAMES},
+    {"relationship", 223, DICTIONARY_ENGLISH},
+    {"report", 219, DICTIONARY_ENGLISH},
+    {"research", 179, DICTIONARY_ENGLISH},
+    {"result", 175, DICTIONARY_ENGLISH},
+    {"reyes", 287, DICTIONARY_NAMES},
+    {"richard", 7, DICTIONARY_NAMES},
+    {"richardson", 306, DICTIONARY_NAMES},
+    {"rider", 489, DICTIONARY_ENGLISH},
+    {"right", 96, DICTIONARY_ENGLISH},
+    {"river", 308, DICTIONARY_ENGLISH},
+    {"rivera", 273, DICTIONARY_NAMES},
+    {"road", 225, DICTIONARY_ENGLISH},
+    {"robert", 3, DICTIONARY_NAMES},
+    {"roberts", 277, DICTIONARY_NAMES},
+    {"robinson", 258, DICTIONARY_NAMES},
+    {"rock", 552, DICTIONARY_ENGLISH},
+    {"rocket", 464, DICTIONARY_ENGLISH},
+    {"rodriguez", 239, DICTIONARY_NAMES},
+    {"roger", 67, DICTIONARY_NAMES},
+    {"rogers", 293, DICTIONARY_NAMES},
+    {"role", 206, DICTIONARY_ENGLISH},
+    {"rome", 566, DICTIONARY_ENGLISH},
+    {"ronald", 26, DICTIONARY_NAMES},
+    {"room", 165, DICTIONARY_ENGLISH},
+    {"root", 256, DICTIONARY_PASSWORDS},
+    {"rose", 314, DICTIONARY_ENGLISH},
+    {"ross", 323, DICTIONARY_NAMES},
+    {"roy", 92, DICTIONARY_NAMES},
+    {"ruby", 387, DICTIONARY_ENGLISH},
+    {"rugby", 482, DICTIONARY_ENGLISH},
+    {"ruiz", 314, DICTIONARY_NAMES},
+    {"runner", 486, DICTIONARY_ENGLISH},
+    {"russell", 96, DICTIONARY_NAMES},
+    {"ruth", 152, DICTIONARY_NAMES},
+    {"ryan", 30, DICTIONARY_NAMES},
+    {"sam", 202, DICTIONARY_NAMES},
+    {"samantha", 123, DICTIONARY_PASSWORDS},
+    {"same", 109, DICTIONARY_ENGLISH},
+    {"samsung", 141, DICTIONARY_PASSWORDS},
+    {"samuel", 42, DICTIONARY_NAMES},
+    {"samurai", 432, DICTIONARY_ENGLISH},
+    {"sanchez", 254, DICTIONARY_NAMES},
+    {"sanders", 319, DICTIONARY_NAMES},
+    {"sandra", 115, DICTIONARY_NAMES},
+    {"sapphire", 389, DICTIONARY_ENGLISH},
+    {"sara", 173, DICTIONARY_NAMES},
+    {"sarah", 109, DICTIONARY_NAMES},
+    {"saturday", 499, DICTIONARY_ENGLISH},
+    {"scarlet", 383, DICTIONARY_ENGLISH},
+    {"school", 115, DICTIONARY_ENGLISH},
+    {"scooby", 183, DICTIONARY_PASSWORDS},
+    {"scooter", 117, DICTIONARY_PASSWORDS},
+    {"scott", 39, DICTIONARY_NAMES},
+    {"sean", 71, DICTIONARY_NAMES},
+    {"season", 232, DICTIONARY_ENGLISH},
+    {"seattle", 584, DICTIONARY_ENGLISH},
+    {"secret", 101, DICTIONARY_PASSWORDS},
+    {"secret123", 291, DICTIONARY_PASSWORDS},
+    {"security", 539, DICTIONARY_ENGLISH},
+    {"see", 44, DICTIONARY_ENGLISH},
+    {"sense", 193, DICTIONARY_ENGLISH},
+    {"september", 509, DICTIONARY_ENGLISH},
+    {"server", 542, DICTIONARY_ENGLISH},
+    {"shadow", 18, DICTIONARY_PASSWORDS},
+    {"shadow123", 293, DICTIONARY_PASSWORDS},
+    {"shark", 348, DICTIONARY_ENGLISH},
+    {"sharon", 128, DICTIONARY_NAMES},
+    {"she", 14, DICTIONARY_ENGLISH},
+    {"shirley", 134, DICTIONARY_NAMES},
+    {"should", 84, DICTIONARY_ENGLISH},
+    {"show", 211, DICTIONARY_ENGLISH},
+    {"side", 148, DICTIONARY_ENGLISH},
+    {"silver", 107, DICTIONARY_PASSWORDS},
+    {"sister", 155, DICTIONARY_ENGLISH},
+    {"site", 248, DICTIONARY_ENGLISH},
+    {"situation", 256, DICTIONARY_ENGLISH},
+    {"skater", 487, DICTIONARY_ENGLISH},
+    {"skull", 454, DICTIONARY_ENGLISH},
+    {"slayer", 208, DICTIONARY_PASSWORDS},
+    {"small", 100, DICTIONARY_ENGLISH},
+    {"smith", 231, DICTIONARY_NAMES},
+    {"smokey", 143, DICTIONARY_PASSWORDS},
+    {"snake", 362, DICTIONARY_ENGLISH},
+    {"snoopy", 131, DICTIONARY_PASSWORDS},
+    {"snow", 303, DICTIONARY_ENGLISH},
+    {"soccer", 42, DICTIONARY_PASSWORDS},
+    {"society", 233, DICTIONARY_ENGLISH},
+    {"soldier", 429, DICTIONARY_ENGLISH},
+    {"some", 41, DICTIONARY_ENGLISH},
+    {"son", 221, DICTIONARY_ENGLISH},
+    {"sophia", 182, DICTIONARY_NAMES},
+    {"sophie", 224, DICTIONARY_NAMES},
+    {"sorry", 517, DICTIONARY_ENGLISH},
+    {"soul", 450, DICTIONARY_ENGLISH},
+    {"source", 287, DICTIONARY_ENGLISH},
+    {"space", 240, DICTIONARY_ENGLISH},
+    {"sparky", 130, DICTIONARY_PASSWORDS},
+    {"spider", 153, DICTIONARY_PASSWORDS},
+    {"spirit", 449, DICTIONARY_ENGLISH},
+    {"spring", 297, DICTIONARY_ENGLISH},
+    {"star", 251, DICTIONARY_ENGLISH},
+    {"starwars", 56, DICTIONARY_PASSWORDS},
+    {"starwars1", 288, DICTIONARY_PASSWORDS},
+    {"steelers", 144, DICTIONARY_PASSWORDS},
+    {"step", 280, DICTIONARY_ENGLISH},
+    {"stephanie", 126, DICTIONARY_NAMES},
+    {"stephen", 36, DICTIONARY_NAMES},
+    {"steve", 211, DICTIONARY_NAMES},
+    {"steven", 17, DICTIONARY_NAMES},
+    {"stewart", 288, DICTIONARY_NAMES},
+    {"still", 82, DICTIONARY_ENGLISH},
+    {"storm", 304, DICTIONARY_ENGLISH},
+    {"story", 137, DICTIONARY_ENGLISH},
+    {"strawberry", 325, DICTIONARY_ENGLISH},
+    {"street", 260, DICTIONARY_ENGLISH},
+    {"strong", 419, DICTIONARY_ENGLISH},
+    {"student", 559, DICTIONARY_ENGLISH},
+    {"study", 141, DICTIONARY_ENGLISH},
+    {"sugar", 330, DICTIONARY_ENGLISH},
+    {"summer", 80, DICTIONARY_PASSWORDS},
+    {"sun", 467, DICTIONARY_ENGLISH},
+    {"sunday", 500, DICTIONARY_ENGLISH},
+    {"sunny", 301, DICTIONARY_ENGLISH},
+    {"sunshine", 47, DICTIONARY_PASSWORDS},
+    {"sunshine1", 297, DICTIONARY_PASSWORDS},
+    {"super", 416, DICTIONARY_ENGLISH},
+    {"superman", 27, DICTIONARY_PASSWORDS},
+    {"superman1", 287, DICTIONARY_PASSWORDS},
+    {"support", 278, DICTIONARY_ENGLISH},
+    {"surfer", 488, DICTIONARY_ENGLISH},
+    {"susan", 107, DICTIONARY_NAMES},
+    {"sweet", 405, DICTIONARY_ENGLISH},
+    {"sweetie", 531, DICTIONARY_ENGLISH},
+    {"system", 127, DICTIONARY_ENGLISH},
+    {"table", 252, DICTIONARY_ENGLISH},
+    {"take", 35, DICTIONARY_ENGLISH},
+    {"tax", 234, DICTIONARY_ENGLISH},
+    {"taylor", 93, DICTIONARY_PASSWORDS},
+    {"teacher", 184, DICTIONARY_ENGLISH},
+    {"technology", 279, DICTIONARY_ENGLISH},
+    {"tell", 79, DICTIONARY_ENGLISH},
+    {"tennis", 179, DICTIONARY_PASSWORDS},
+    {"teresa", 171, DICTIONARY_NAMES},
+    {"terry", 68, DICTIONARY_NAMES},
+    {"test", 112, DICTIONARY_PASSWORDS},
+    {"texas", 575, DICTIONARY_ENGLISH},
+    {"than", 46, DICTIONARY_ENGLISH},
+    {"thanks", 516, DICTIONARY_ENGLISH},
+    {"that", 4, DICTIONARY_ENGLISH},
+    {"the", 2, DICTIONARY_ENGLISH},
+    {"their", 20, DICTIONARY_ENGLISH},
+    {"them", 43, DICTIONARY_ENGLISH},
+    {"then", 47, DICTIONARY_ENGLISH},
+    {"there", 19, DICTIONARY_ENGLISH},
+    {"theresa", 191, DICTIONARY_NAMES},
+    {"these", 71, DICTIONARY_ENGLISH},
+    {"they", 12, DICTIONARY_ENGLISH},
+    {"thing", 77, DICTIONARY_ENGLISH},
+    {"think", 54, DICTIONARY_ENGLISH},
+    {"this", 9, DICTIONARY_ENGLISH},
+    {"thomas", 9, DICTIONARY_NAMES},
+    {"thompson", 252, DICTIONARY_NAMES},
+    {"through", 81, DICTIONARY_ENGLISH},
+    {"thunder", 92, DICTIONARY_PASSWORDS},
+    {"thursday", 497, DICTIONARY_ENGLISH},
+    {"tiger", 341, DICTIONARY_ENGLISH},
+    {"tigers", 156, DICTIONARY_PASSWORDS},
+    {"tigger", 46, DICTIONARY_PASSWORDS},
+    {"tim", 205, DICTIONARY_NAMES},
+    {"time", 31, DICTIONARY_ENGLISH},
+    {"timothy", 25, DICTIONARY_NAMES},
+    {"today", 520, DICTIONARY_ENGLISH},
+    {"together", 527, DICTIONARY_ENGLISH},
+    {"tokyo", 567, DICTIONARY_ENGLISH},
+    {"tom", 204, DICTIONARY_NAMES},
+    {"tomorrow", 521, DICTIONARY_ENGLISH},
+    {"toor", 257, DICTIONARY_PASSWORDS},
+    {"torres", 264, DICTIONARY_NAMES},
+    {"town", 224, DICTIONARY_ENGLISH},
+    {"tree", 286, DICTIONARY_ENGLISH},
+    {"trustme", 268, DICTIONARY_PASSWORDS},
+    {"trustno1", 35, DICTIONARY_PASSWORDS},
+    {"truth", 293, DICTIONARY_ENGLISH},
+    {"tuesday", 495, DICTIONARY_ENGLISH},
+    {"turkey", 339, DICTIONARY_ENGLISH},
+    {"turner", 281, DICTIONARY_NAMES},
+    {"twitter", 548, DICTIONARY_ENGLISH},
+    {"two", 59, DICTIONARY_ENGLISH},
+    {"tyler", 51, DICTIONARY_NAMES},
+    {"type", 283, DICTIONARY_ENGLISH},
+    {"ultra", 418, DICTIONARY_ENGLISH},
+    {"unity", 445, DICTIONARY_ENGLISH},
+    {"universe", 469, DICTIONARY_ENGLISH},
+    {"use", 58, DICTIONARY_ENGLISH},
+    {"value", 228, DICTIONARY_ENGLISH},
+    {"vegas", 583, DICTIONARY_ENGLISH},
+    {"very", 80, DICTIONARY_ENGLISH},
+    {"victoria", 157, DICTIONARY_NAMES},
+    {"victory", 446, DICTIONARY_ENGLISH},
+    {"view", 222, DICTIONARY_ENGLISH},
+    {"vincent", 93, DICTIONARY_NAMES},
+    {"violet", 381, DICTIONARY_ENGLISH},
+    {"virginia", 156, DICTIONARY_NAMES},
+    {"voice", 214, DICTIONARY_ENGLISH},
+    {"walker", 259, DICTIONARY_NAMES},
+    {"wall", 270, DICTIONARY_ENGLISH},
+    {"walter", 62, DICTIONARY_NAMES},
+    {"want", 68, DICTIONARY_ENGLISH},
+    {"war", 172, DICTIONARY_ENGLISH},
+    {"ward", 305, DICTIONARY_NAMES},
+    {"warrior", 428, DICTIONARY_ENGLISH},
+    {"water", 164, DICTIONARY_ENGLISH},
+    {"watson", 307, DICTIONARY_NAMES},
+    {"way", 65, DICTIONARY_ENGLISH},
+    {"wayne", 89, DICTIONARY_NAMES},
+    {"wednesday", 496, DICTIONARY_ENGLISH},
+    {"week", 125, DICTIONARY_ENGLISH},
+    {"welcome", 137, DICTIONARY_PASSWORDS},
+    {"welcome1", 253, DICTIONARY_PASSWORDS},
+    {"welcome123", 302, DICTIONARY_PASSWORDS},
+    {"well", 64, DICTIONARY_ENGLISH},
+    {"whale", 349, DICTIONARY_ENGLISH},
+    {"what", 21, DICTIONARY_ENGLISH},
+    {"whatever", 127, DICTIONARY_PASSWORDS},
+    {"whatever1", 304, DICTIONARY_PASSWORDS},
+    {"when", 27, DICTIONARY_ENGLISH},
+    {"where", 90, DICTIONARY_ENGLISH},
+    {"which", 26, DICTIONARY_ENGLISH},
+    {"white", 373, DICTIONARY_ENGLISH},
+    {"who", 24, DICTIONARY_ENGLISH},
+    {"wife", 215, DICTIONARY_ENGLISH},
+    {"wild", 412, DICTIONARY_ENGLISH},
+    {"will", 15, DICTIONARY_ENGLISH},
+    {"william", 5, DICTIONARY_NAMES},
+    {"williams", 233, DICTIONARY_NAMES},
+    {"willie", 86, DICTIONARY_NAMES},
+    {"wilson", 244, DICTIONARY_NAMES},
+    {"wind", 306, DICTIONARY_ENGLISH},
+    {"window", 290, DICTIONARY_ENGLISH},
+    {"winner", 220, DICTIONARY_PASSWORDS},
+    {"winter", 226, DICTIONARY_PASSWORDS},
+    {"witch", 435, DICTIONARY_ENGLISH},
+    {"with", 8, DICTIONARY_ENGLISH},
+    {"wizard", 214, DICTIONARY_PASSWORDS},
+    {"wolf", 344, DICTIONARY_ENGLISH},
+    {"woman", 112, DICTIONARY_ENGLISH},
+    {"wood", 310, DICTIONARY_NAMES},
+    {"word", 145, DICTIONARY_ENGLISH},
+    {"work", 62, DICTIONARY_ENGLISH},
+    {"worker", 272, DICTIONARY_ENGLISH},
+    {"world", 86, DICTIONARY_ENGLISH},
+    {"would", 18, DICTIONARY_ENGLISH},
+    {"wright", 263, DICTIONARY_NAMES},
+    {"xxxxxx", 158, DICTIONARY_PASSWORDS},
+    {"yahoo", 546, DICTIONARY_ENGLISH},
+    {"yamaha", 189, DICTIONARY_PASSWORDS},
+    {"yankees", 88, DICTIONARY_PASSWORDS},
+    {"year", 38, DICTIONARY_ENGLISH},
+    {"yellow", 157, DICTIONARY_PASSWORDS},
+    {"yesterday", 522, DICTIONARY_ENGLISH},
+    {"you", 1, DICTIONARY_ENGLISH},
+    {"young", 104, DICTIONARY_ENGLISH},
+    {"your", 39, DICTIONARY_ENGLISH},
+    {"zachary", 58, DICTIONARY_NAMES},
+    {"zaq12wsx", 271, DICTIONARY_PASSWORDS},
+    {"zebra", 366, DICTIONARY_ENGLISH},
+    {"zoe", 222, DICTIONARY_NAMES},
+    {"zxcvbn", 65, DICTIONARY_PASSWORDS},
+    {"zxcvbnm", 38, DICTIONARY_PASSWORDS},
+};
+const int num_dictionary_words = 1104;
+
+const struct keyboard_graph qwerty_graph = {
+    94, 4.595745, {
+        ['!'] = {{'`', '~'}, {0}, {0}, {'2', '@'}, {'q', 'Q'}, {0}, {0}, {0}},
+        ['"'] = {{';', ':'}, {'[', '{'}, {']', '}'}, {0}, {0}, {'/', '?'}, {0}, {0}},
+        ['#'] = {{'2', '@'}, {0}, {0}, {'4', '$'}, {'e', 'E'}, {'w', 'W'}, {0}, {0}},
+        ['$'] = {{'3', '#'}, {0}, {0}, {'5', '%'}, {'r', 'R'}, {'e', 'E'}, {0}, {0}},
+        ['%'] = {{'4', '$'}, {0}, {0}, {'6', '^'}, {'t', 'T'}, {'r', 'R'}, {0}, {0}},
+        ['&'] = {{'6', '^'}, {0}, {0}, {'8', '*'}, {'u', 'U'}, {'y', 'Y'}, {0}, {0}},
+        ['\''] = {{';', ':'}, {'[', '{'}, {']', '}'}, {0}, {0}, {'/', '?'}, {0}, {0}},
+        ['('] = {{'8', '*'}, {0}, {0}, {'0', ')'}, {'o', 'O'}, {'i', 'I'}, {0}, {0}},
+        [')'] = {{'9', '('}, {0}, {0}, {'-', '_'}, {'p', 'P'}, {'o', 'O'}, {0}, {0}},
+        ['*'] = {{'7', '&'}, {0}, {0}, {'9', '('}, {'i', 'I'}, {'u', 'U'}, {0}, {0}},
+        ['+'] = {{'-', '_'}, {0}, {0}, {0}, {']', '}'}, {'[', '{'}, {0}, {0}},
+        [','] = {{'m', 'M'}, {'k', 'K'}, {'l', 'L'}, {'.', '>'}, {0}, {0}, {0}, {0}},
+        ['-'] = {{'0', ')'}, {0}, {0}, {'=', '+'}, {'[', '{'}, {'p', 'P'}, {0}, {0}},
+        ['.'] = {{',', '<'}, {'l', 'L'}, {';', ':'}, {'/', '?'}, {0}, {0}, {0}, {0}},
+        ['/'] = {{'.', '>'}, {';', ':'}, {'\'', '"'}, {0}, {0}, {0}, {0}, {0}},
+        ['0'] = {{'9', '('}, {0}, {0}, {'-', '_'}, {'p', 'P'}, {'o', 'O'}, {0}, {0}},
+        ['1'] = {{'`', '~'}, {0}, {0}, {'2', '@'}, {'q', 'Q'}, {0}, {0}, {0}},
+        ['2'] = {{'1', '!'}, {0}, {0}, {'3', '#'}, {'w', 'W'}, {'q', 'Q'}, {0}, {0}},
+        ['3'] = {{'2', '@'}, {0}, {0}, {'4', '$'}, {'e', 'E'}, {'w', 'W'}, {0}, {0}},
+        ['4'] = {{'3', '#'}, {0}, {0}, {'5', '%'}, {'r', 'R'}, {'e', 'E'}, {0}, {0}},
+        ['5'] = {{'4', '$'}, {0}, {0}, {'6', '^'}, {'t', 'T'}, {'r', 'R'}, {0}, {0}},
+        ['6'] = {{'5', '%'}, {0}, {0}, {'7', '&'}, {'y', 'Y'}, {'t', 'T'}, {0}, {0}},
+        ['7'] = {{'6', '^'}, {0}, {0}, {'8', '*'}, {'u', 'U'}, {'y', 'Y'}, {0}, {0}},
+        ['8'] = {{'7', '&'}, {0}, {0}, {'9', '('}, {'i', 'I'}, {'u', 'U'}, {0}, {0}},
+        ['9'] = {{'8', '*'}, {0}, {0}, {'0', ')'}, {'o', 'O'}, {'i', 'I'}, {0}, {0}},
+        [':'] = {{'l', 'L'}, {'p', 'P'}, {'[', '{'}, {'\'', '"'}, {'/', '?'}, {'.', '>'}, {0}, {0}},
+        [';'] = {{'l', 'L'}, {'p', 'P'}, {'[', '{'}, {'\'', '"'}, {'/', '?'}, {'.', '>'}, {0}, {0}},
+        ['<'] = {{'m', 'M'}, {'k', 'K'}, {'l', 'L'}, {'.', '>'}, {0}, {0}, {0}, {0}},
+        ['='] = {{'-', '_'}, {0}, {0}, {0}, {']', '}'}, {'[', '{'}, {0}, {0}},
+        ['>'] = {{',', '<'}, {'l', 'L'}, {';', ':'}, {'/', '?'}, {0}, {0}, {0}, {0}},
+        ['?'] = {{'.', '>'}, {';', ':'}, {'\'', '"'}, {0}, {0}, {0}, {0}, {0}},
+        ['@'] = {{'1', '!'}, {0}, {0}, {'3', '#'}, {'w', 'W'}, {'q', 'Q'}, {0}, {0}},
+        ['A'] = {{0}, {'q', 'Q'}, {'w', 'W'}, {'s', 'S'}, {'z', 'Z'}, {0}, {0}, {0}},
+        ['B'] = {{'v', 'V'}, {'g', 'G'}, {'h', 'H'}, {'n', 'N'}, {0}, {0}, {0}, {0}},
+        ['C'] = {{'x', 'X'}, {'d', 'D'}, {'f', 'F'}, {'v', 'V'}, {0}, {0}, {0}, {0}},
+        ['D'] = {{'s', 'S'}, {'e', 'E'}, {'r', 'R'}, {'f', 'F'}, {'c', 'C'}, {'x', 'X'}, {0}, {0}},
+        ['E'] = {{'w', 'W'}, {'3', '#'}, {'4', '$'}, {'r', 'R'}, {'d', 'D'}, {'s', 'S'}, {0}, {0}},
+        ['F'] = {{'d', 'D'}, {'r', 'R'}, {'t', 'T'}, {'g', 'G'}, {'v', 'V'}, {'c', 'C'}, {0}, {0}},
+        ['G'] = {{'f', 'F'}, {'t', 'T'}, {'y', 'Y'}, {'h', 'H'}, {'b', 'B'}, {'v', 'V'}, {0}, {0}},
+        ['H'] = {{'g', 'G'}, {'y', 'Y'}, {'u', 'U'}, {'j', 'J'}, {'n', 'N'}, {'b', 'B'}, {0}, {0}},
+        ['I'] = {{'u', 'U'}, {'8', '*'}, {'9', '('}, {'o', 'O'}, {'k', 'K'}, {'j', 'J'}, {0}, {0}},
+        ['J'] = {{'h', 'H'}, {'u', 'U'}, {'i', 'I'}, {'k', 'K'}, {'m', 'M'}, {'n', 'N'}, {0}, {0}},
+        ['K'] = {{'j', 'J'}, {'i', 'I'}, {'o', 'O'}, {'l', 'L'}, {',', '<'}, {'m', 'M'}, {0}, {0}},
+        ['L'] = {{'k', 'K'}, {'o', 'O'}, {'p', 'P'}, {';', ':'}, {'.', '>'}, {',', '<'}, {0}, {0}},
+        ['M'] = {{'n', 'N'}, {'j', 'J'}, {'k', 'K'}, {',', '<'}, {0}, {0}, {0}, {0}},
+        ['N'] = {{'b', 'B'}, {'h', 'H'}, {'j', 'J'}, {'m', 'M'}, {0}, {0}, {0}, {0}},
+        ['O'] = {{'i', 'I'}, {'9', '('}, {'0', ')'}, {'p', 'P'}, {'l', 'L'}, {'k', 'K'}, {0}, {0}},
+        ['P'] = {{'o', 'O'}, {'0', ')'}, {'-', '_'}, {'[', '{'}, {';', ':'}, {'l', 'L'}, {0}, {0}},
+        ['Q'] = {{0}, {'1', '!'}, {'2', '@'}, {'w', 'W'}, {'a', 'A'}, {0}, {0}, {0}},
+        ['R'] = {{'e', 'E'}, {'4', '$'}, {'5', '%'}, {'t', 'T'}, {'f', 'F'}, {'d', 'D'}, {0}, {0}},
+        ['S'] = {{'a', 'A'}, {'w', 'W'}, {'e', 'E'}, {'d', 'D'}, {'x', 'X'}, {'z', 'Z'}, {0}, {0}},
+        ['T'] = {{'r', 'R'}, {'5', '%'}, {'6', '^'}, {'y', 'Y'}, {'g', 'G'}, {'f', 'F'}, {0}, {0}},
+        ['U'] = {{'y', 'Y'}, {'7', '&'}, {'8', '*'}, {'i', 'I'}, {'j', 'J'}, {'h', 'H'}, {0}, {0}},
+        ['V'] = {{'c', 'C'}, {'f', 'F'}, {'g', 'G'}, {'b', 'B'}, {0}, {0}, {0}, {0}},
+        ['W'] = {{'q', 'Q'}, {'2', '@'}, {'3', '#'}, {'e', 'E'}, {'s', 'S'}, {'a', 'A'}, {0}, {0}},
+        ['X'] = {{'z', 'Z'}, {'s', 'S'}, {'d', 'D'}, {'c', 'C'}, {0}, {0}, {0}, {0}},
+        ['Y'] = {{'t', 'T'}, {'6', '^'}, {'7', '&'}, {'u', 'U'}, {'h', 'H'}, {'g', 'G'}, {0}, {0}},
+        ['Z'] = {{0}, {'a', 'A'}, {'s', 'S'}, {'x', 'X'}, {0}, {0}, {0}, {0}},
+        ['['] = {{'p', 'P'}, {'-', '_'}, {'=', '+'}, {']', '}'}, {'\'', '"'}, {';', ':'}, {0}, {0}},
+        ['\\'] = {{']', '}'}, {0}, {0}, {0}, {0}, {0}, {0}, {0}},
+        [']'] = {{'[', '{'}, {'=', '+'}, {0}, {'\\', '|'}, {0}, {'\'', '"'}, {0}, {0}},
+        ['^'] = {{'5', '%'}, {0}, {0}, {'7', '&'}, {'y', 'Y'}, {'t', 'T'}, {0}, {0}},
+        ['_'] = {{'0', ')'}, {0}, {0}, {'=', '+'}, {'[', '{'}, {'p', 'P'}, {0}, {0}},
+        ['`'] = {{0}, {0}, {0}, {'1', '!'}, {0}, {0}, {0}, {0}},
+        ['a'] = {{0}, {'q', 'Q'}, {'w', 'W'}, {'s', 'S'}, {'z', 'Z'}, {0}, {0}, {0}},
+        ['b'] = {{'v', 'V'}, {'g', 'G'}, {'h', 'H'}, {'n', 'N'}, {0}, {0}, {0}, {0}},
+        ['c'] = {{'x', 'X'}, {'d', 'D'}, {'f', 'F'}, {'v', 'V'}, {0}, {0}, {0}, {0}},
+        ['d'] = {{'s', 'S'}, {'e', 'E'}, {'r', 'R'}, {'f', 'F'}, {'c', 'C'}, {'x', 'X'}, {0}, {0}},
+        ['e'] = {{'w', 'W'}, {'3', '#'}, {'4', '$'}, {'r', 'R'}, {'d', 'D'}, {'s', 'S'}, {0}, {0}},
+        ['f'] = {{'d', 'D'}, {'r', 'R'}, {'t', 'T'}, {'g', 'G'}, {'v', 'V'}, {'c', 'C'}, {0}, {0}},
+        ['g'] = {{'f', 'F'}, {'t', 'T'}, {'y', 'Y'}, {'h', 'H'}, {'b', 'B'}, {'v', 'V'}, {0}, {0}},
+        ['h'] = {{'g', 'G'}, {'y', 'Y'}, {'u', 'U'}, {'j', 'J'}, {'n', 'N'}, {'b', 'B'}, {0}, {0}},
+        ['i'] = {{'u', 'U'}, {'8', '*'}, {'9', '('}, {'o', 'O'}, {'k', 'K'}, {'j', 'J'}, {0}, {0}},
+        ['j'] = {{'h', 'H'}, {'u', 'U'}, {'i', 'I'}, {'k', 'K'}, {'m', 'M'}, {'n', 'N'}, {0}, {0}},
+        ['k'] = {{'j', 'J'}, {'i', 'I'}, {'o', 'O'}, {'l', 'L'}, {',', '<'}, {'m', 'M'}, {0}, {0}},
+        ['l'] = {{'k', 'K'}, {'o', 'O'}, {'p', 'P'}, {';', ':'}, {'.', '>'}, {',', '<'}, {0}, {0}},
+        ['m'] = {{'n', 'N'}, {'j', 'J'}, {'k', 'K'}, {',', '<'}, {0}, {0}, {0}, {0}},
+        ['n'] = {{'b', 'B'}, {'h', 'H'}, {'j', 'J'}, {'m', 'M'}, {0}, {0}, {0}, {0}},
+        ['o'] = {{'i', 'I'}, {'9', '('}, {'0', ')'}, {'p', 'P'}, {'l', 'L'}, {'k', 'K'}, {0}, {0}},
+        ['p'] = {{'o', 'O'}, {'0', ')'}, {'-', '_'}, {'[', '{'}, {';', ':'}, {'l', 'L'}, {0}, {0}},
+        ['q'] = {{0}, {'1', '!'}, {'2', '@'}, {'w', 'W'}, {'a', 'A'}, {0}, {0}, {0}},
+        ['r'] = {{'e', 'E'}, {'4', '$'}, {'5', '%'}, {'t', 'T'}, {'f', 'F'}, {'d', 'D'}, {0}, {0}},
+        ['s'] = {{'a', 'A'}, {'w', 'W'}, {'e', 'E'}, {'d', 'D'}, {'x', 'X'}, {'z', 'Z'}, {0}, {0}},
+        ['t'] = {{'r', 'R'}, {'5', '%'}, {'6', '^'}, {'y', 'Y'}, {'g', 'G'}, {'f', 'F'}, {0}, {0}},
+        ['u'] = {{'y', 'Y'}, {'7', '&'}, {'8', '*'}, {'i', 'I'}, {'j', 'J'}, {'h', 'H'}, {0}, {0}},
+        ['v'] = {{'c', 'C'}, {'f', 'F'}, {'g', 'G'}, {'b', 'B'}, {0}, {0}, {0}, {0}},
+        ['w'] = {{'q', 'Q'}, {'2', '@'}, {'3', '#'}, {'e', 'E'}, {'s', 'S'}, {'a', 'A'}, {0}, {0}},
+        ['x'] = {{'z', 'Z'}, {'s', 'S'}, {'d', 'D'}, {'c', 'C'}, {0}, {0}, {0}, {0}},
+        ['y'] = {{'t', 'T'}, {'6', '^'}, {'7', '&'}, {'u', 'U'}, {'h', 'H'}, {'g', 'G'}, {0}, {0}},
+        ['z'] = {{0}, {'a', 'A'}, {'s', 'S'}, {'x', 'X'}, {0}, {0}, {0}, {0}},
+        ['{'] = {{'p', 'P'}, {'-', '_'}, {'=', '+'}, {']', '}'}, {'\'', '"'}, {';', ':'}, {0}, {0}},
+        ['|'] = {{']', '}'}, {0}, {0}, {0}, {0}, {0}, {0}, {0}},
+        ['}'] = {{'[', '{'}, {'=', '+'}, {0}, {'\\', '|'}, {0}, {'\'', '"'}, {0}, {0}},
+        ['~'] = {{0}, {0}, {0}, {'1', '!'}, {0}, {0}, {0}, {0}},
+    }
+};
+
+const struct keyboard_graph keypad_graph = {
+    15, 5.066667, {
+        ['*'] = {{'/'}, {0}, {0}, {0}, {'-'}, {'+'}, {'9'}, {'8'}},
+        ['+'] = {{'9'}, {'*'}, {'-'}, {0}, {0}, {0}, {0}, {'6'}},
+        ['-'] = {{'*'}, {0}, {0}, {0}, {0}, {0}, {'+'}, {'9'}},
+        ['.'] = {{'0'}, {'2'}, {'3'}, {0}, {0}, {0}, {0}, {0}},
+        ['/'] = {{0}, {0}, {0}, {0}, {'*'}, {'9'}, {'8'}, {'7'}},
+        ['0'] = {{0}, {'1'}, {'2'}, {'3'}, {'.'}, {0}, {0}, {0}},
+        ['1'] = {{0}, {0}, {'4'}, {'5'}, {'2'}, {'0'}, {0}, {0}},
+        ['2'] = {{'1'}, {'4'}, {'5'}, {'6'}, {'3'}, {'.'}, {'0'}, {0}},
+        ['3'] = {{'2'}, {'5'}, {'6'}, {0}, {0}, {0}, {'.'}, {'0'}},
+        ['4'] = {{0}, {0}, {'7'}, {'8'}, {'5'}, {'2'}, {'1'}, {0}},
+        ['5'] = {{'4'}, {'7'}, {'8'}, {'9'}, {'6'}, {'3'}, {'2'}, {'1'}},
+        ['6'] = {{'5'}, {'8'}, {'9'}, {'+'}, {0}, {0}, {'3'}, {'2'}},
+        ['7'] = {{0}, {0}, {0}, {'/'}, {'8'}, {'5'}, {'4'}, {0}},
+        ['8'] = {{'7'}, {0}, {'/'}, {'*'}, {'9'}, {'6'}, {'5'}, {'4'}},
+        ['9'] = {{'8'}, {'/'}, {'*'}, {'-'}, {'+'}, {0}, {'6'}, {'5'}},
+    }
+};
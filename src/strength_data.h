@@ -0,0 +1,31 @@
+#ifndef STRENGTH_DATA_H
+#define STRENGTH_DATA_H
+
+#define MAX_KEY_NEIGHBORS 8
+
+enum dictionary {
+    DICTIONARY_PASSWORDS,
+    DICTIONARY_ENGLISH,
+    DICTIONARY_NAMES
+};
+
+struct dictionary_word {
+    const char *word;
+    int rank;                    // 1 for the most frequent word of the dictionary
+    enum dictionary dictionary;
+};
+
+struct keyboard_graph {
+    int starting_positions;      // Number of keys
+    double average_degree;       // Average number of neighbors per key
+    // Unshifted and shifted character of each neighbor per character, in a fixed direction order
+    char neighbors[128][MAX_KEY_NEIGHBORS][2];
+};
+
+// Sorted by word, generated by tools/generate_strength_data.py
+extern const struct dictionary_word dictionary_words[];
+extern const int num_dictionary_words;
+extern const struct keyboard_graph qwerty_graph;
+extern const struct keyboard_graph keypad_graph;
+
+#endif //STRENGTH_DATA_H
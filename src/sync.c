@@ -0,0 +1,1051 @@
+#include "sync.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crypto.h"
+#include "secure_heap.h"
+#include "util.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET sync_socket;
+#define INVALID_SYNC_SOCKET INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int sync_socket;
+#define INVALID_SYNC_SOCKET (-1)
+#define close_socket close
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Sent in plaintext by the server before the encrypted frames: magic, salt and tree depth
+#define SYNC_MAGIC "CPSYNC05"
+#define SYNC_MAGIC_SIZE 8
+#define SYNC_SALT_SIZE 16
+#define SYNC_HELLO_SIZE (SYNC_MAGIC_SIZE + SYNC_SALT_SIZE + 1)
+#define SYNC_KEY_SIZE 32
+#define SYNC_NONCE_SIZE 12
+#define SYNC_TAG_SIZE 16
+// Marks a missing field, e.g. an entry without previous password
+#define ABSENT_FIELD UINT32_MAX
+
+// Request and reply types, the first byte of every frame
+#define REQUEST_NODES 'N'
+#define REQUEST_LEAVES 'L'
+#define REQUEST_DONE 'D'
+#define REPLY_HASHES 'H'
+#define REPLY_ENTRIES 'E'
+
+// An encrypted and authenticated connection to the other node
+struct sync_channel {
+    sync_socket socket;
+    unsigned char key[SYNC_KEY_SIZE];
+    bool is_server;
+    uint64_t frames_sent;
+    uint64_t frames_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+};
+
+// Growable message on the secure heap, it holds cleartext entries
+struct sync_buffer {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+    size_t position; // Read position
+    bool failed;     // Set once memory ran out or a read went past the end
+};
+
+// Digest of an entry together with its array slot and leaf
+struct slot_hash {
+    int slot;
+    uint32_t leaf;
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+};
+
+
+/*
+ * Append bytes to a message
+ */
+static void put_bytes(struct sync_buffer *buffer, const void *bytes, const size_t count) {
+    if (buffer->failed)
+        return;
+    if (buffer->length + count > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity < buffer->length + count)
+            capacity *= 2;
+        unsigned char *data = secure_realloc(buffer->data, capacity);
+        if (!data) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->length, bytes, count);
+    buffer->length += count;
+}
+
+
+/*
+ * Append a 32 bit big endian integer to a message
+ */
+static void put_u32(struct sync_buffer *buffer, const uint32_t value) {
+    const unsigned char bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+    put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+
+/*
+ * Append a 64 bit big endian integer to a message, such as a timestamp
+ */
+static void put_u64(struct sync_buffer *buffer, const uint64_t value) {
+    put_u32(buffer, (uint32_t) (value >> 32));
+    put_u32(buffer, (uint32_t) value);
+}
+
+
+/*
+ * Append a length prefixed string to a message, NULL is sent as absent field
+ */
+static void put_string(struct sync_buffer *buffer, const char *text) {
+    if (!text) {
+        put_u32(buffer, ABSENT_FIELD);
+        return;
+    }
+    const size_t length = strlen(text);
+    put_u32(buffer, (uint32_t) length);
+    put_bytes(buffer, text, length);
+}
+
+
+/*
+ * Read bytes from a message
+ *
+ * return const unsigned char*: The bytes inside the message, NULL past the end
+ */
+static const unsigned char *get_bytes(struct sync_buffer *buffer, const size_t count) {
+    if (buffer->failed || buffer->length - buffer->position < count) {
+        buffer->failed = true;
+        return NULL;
+    }
+    const unsigned char *bytes = buffer->data + buffer->position;
+    buffer->position += count;
+    return bytes;
+}
+
+
+/*
+ * Read a 32 bit big endian integer from a message, 0 past the end
+ */
+static uint32_t get_u32(struct sync_buffer *buffer) {
+    const unsigned char *bytes = get_bytes(buffer, 4);
+    if (!bytes)
+        return 0;
+    return (uint32_t) bytes[0] << 24 | (uint32_t) bytes[1] << 16 | (uint32_t) bytes[2] << 8 | bytes[3];
+}
+
+
+/*
+ * Read a 64 bit big endian integer from a message, 0 past the end
+ */
+static uint64_t get_u64(struct sync_buffer *buffer) {
+    const uint64_t high = get_u32(buffer);
+    return high << 32 | get_u32(buffer);
+}
+
+
+/*
+ * Read a length prefixed string from a message
+ *
+ * return char*: Copy on the secure heap, NULL for an absent field or past the end
+ */
+static char *get_string(struct sync_buffer *buffer) {
+    const uint32_t length = get_u32(buffer);
+    if (length == ABSENT_FIELD || buffer->failed)
+        return NULL;
+    const unsigned char *bytes = get_bytes(buffer, length);
+    char *text = bytes ? secure_malloc((size_t) length + 1) : NULL;
+    if (!text) {
+        buffer->failed = true;
+        return NULL;
+    }
+    memcpy(text, bytes, length);
+    text[length] = '\0';
+    return text;
+}
+
+
+/*
+ * Start a new message of the given type, reusing the buffer
+ */
+static void start_message(struct sync_buffer *buffer, const unsigned char type) {
+    buffer->length = 0;
+    buffer->position = 0;
+    buffer->failed = false;
+    put_bytes(buffer, &type, 1);
+}
+
+
+/*
+ * Wipe and release a message buffer
+ */
+static void free_buffer(struct sync_buffer *buffer) {
+    secure_free(buffer->data);
+    memset(buffer, 0, sizeof(struct sync_buffer));
+}
+
+
+/*
+ * Add a length prefixed field to a running digest, so field boundaries are part of the hash
+ */
+static void digest_field(EVP_MD_CTX *md, const char *field) {
+    const size_t length = field ? strlen(field) : 0;
+    const uint32_t prefix = field ? (uint32_t) length : ABSENT_FIELD;
+    const unsigned char bytes[4] = {prefix >> 24, prefix >> 16, prefix >> 8, prefix};
+    EVP_DigestUpdate(md, bytes, sizeof(bytes));
+    if (field)
+        EVP_DigestUpdate(md, field, length);
+}
+
+
+/*
+ * Compute the SHA-256 digest of all fields of an entry
+ */
+static void digest_entry(EVP_MD_CTX *md, const struct password *entry, unsigned char *hash) {
+    EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+    digest_field(md, entry->name);
+    digest_field(md, entry->username);
+    digest_field(md, entry->password);
+    digest_field(md, entry->previous_password);
+    digest_field(md, entry->folder);
+    digest_field(md, entry->tags);
+    digest_field(md, entry->attachments);
+    unsigned char times[16];
+    for (int i = 0; i < 8; i++) {
+        times[i] = (unsigned char) ((uint64_t) entry->created >> (56 - 8 * i));
+        times[8 + i] = (unsigned char) ((uint64_t) entry->changed >> (56 - 8 * i));
+    }
+    EVP_DigestUpdate(md, times, sizeof(times));
+    EVP_DigestFinal_ex(md, hash, NULL);
+}
+
+
+/*
+ * Get the leaf an entry belongs to
+ */
+static uint32_t leaf_of(const char *name, const int depth) {
+    return (uint32_t) (hash_text(HASH_SEED, name) >> (64 - depth));
+}
+
+
+/*
+ * Order entry digests by leaf and hash, so both nodes hash the entries of a leaf in the same order
+ */
+static int compare_slot_hashes(const void *a, const void *b) {
+    const struct slot_hash *first = a;
+    const struct slot_hash *second = b;
+    if (first->leaf != second->leaf)
+        return first->leaf < second->leaf ? -1 : 1;
+    return memcmp(first->hash, second->hash, SHA256_DIGEST_LENGTH);
+}
+
+
+/*
+ * Choose the tree depth for a vault, so leaves hold a few entries each
+ *
+ * param int num_entries: Number of live entries
+ * return int: The depth between SYNC_MIN_DEPTH and SYNC_MAX_DEPTH
+ */
+int sync_depth_for(const int num_entries) {
+    int depth = SYNC_MIN_DEPTH;
+    while (depth < SYNC_MAX_DEPTH && ((int64_t) SYNC_ENTRIES_PER_LEAF << depth) < num_entries)
+        depth++;
+    return depth;
+}
+
+
+/*
+ * Build the Merkle tree over the entry digests. A leaf hashes the sorted digests of its entries,
+ * an inner node the hashes of its two children. Empty subtrees hash to zero.
+ *
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param int depth: Depth of the tree, both nodes have to use the same
+ * param struct merkle_tree* tree: Receives the tree
+ * return bool: false if memory ran out
+ */
+bool build_merkle_tree(struct password **passwords, const int num_passwords, const int depth, struct merkle_tree *tree) {
+    const size_t num_leaves = (size_t) 1 << depth;
+    memset(tree, 0, sizeof(struct merkle_tree));
+    tree->depth = depth;
+    tree->nodes = calloc(2 * num_leaves, SYNC_NODE_HASH_SIZE);
+    tree->leaf_start = calloc(num_leaves + 1, sizeof(int));
+    tree->order = malloc(((size_t) num_passwords + 1) * sizeof(int));
+    struct slot_hash *hashes = secure_malloc(((size_t) num_passwords + 1) * sizeof(struct slot_hash));
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    if (!tree->nodes || !tree->leaf_start || !tree->order || !hashes || !md) {
+        secure_free(hashes);
+        EVP_MD_CTX_free(md);
+        free_merkle_tree(tree);
+        return false;
+    }
+
+    int count = 0;
+    for (int slot = 0; slot < num_passwords; slot++) {
+        if (passwords[slot] == NULL)
+            continue;
+        hashes[count].slot = slot;
+        hashes[count].leaf = leaf_of(passwords[slot]->name, depth);
+        digest_entry(md, passwords[slot], hashes[count].hash);
+        count++;
+    }
+    qsort(hashes, count, sizeof(struct slot_hash), compare_slot_hashes);
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    int next = 0;
+    for (size_t leaf = 0; leaf < num_leaves; leaf++) {
+        tree->leaf_start[leaf] = next;
+        if (next == count || hashes[next].leaf != leaf)
+            continue;
+        EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+        for (; next < count && hashes[next].leaf == leaf; next++) {
+            tree->order[next] = hashes[next].slot;
+            EVP_DigestUpdate(md, hashes[next].hash, SHA256_DIGEST_LENGTH);
+        }
+        EVP_DigestFinal_ex(md, digest, NULL);
+        memcpy(tree->nodes[num_leaves + leaf], digest, SYNC_NODE_HASH_SIZE);
+    }
+    tree->leaf_start[num_leaves] = next;
+
+    static const unsigned char empty[SYNC_NODE_HASH_SIZE];
+    for (size_t node = num_leaves - 1; node >= 1; node--) {
+        if (memcmp(tree->nodes[2 * node], empty, SYNC_NODE_HASH_SIZE) == 0 &&
+            memcmp(tree->nodes[2 * node + 1], empty, SYNC_NODE_HASH_SIZE) == 0)
+            continue;
+        EVP_DigestInit_ex(md, EVP_sha256(), NULL);
+        EVP_DigestUpdate(md, tree->nodes[2 * node], 2 * SYNC_NODE_HASH_SIZE);
+        EVP_DigestFinal_ex(md, digest, NULL);
+        memcpy(tree->nodes[node], digest, SYNC_NODE_HASH_SIZE);
+    }
+
+    secure_free(hashes);
+    EVP_MD_CTX_free(md);
+    return true;
+}
+
+
+/*
+ * Release a Merkle tree
+ *
+ * param struct merkle_tree* tree: The tree
+ */
+void free_merkle_tree(struct merkle_tree *tree) {
+    free(tree->nodes);
+    free(tree->leaf_start);
+    free(tree->order);
+    memset(tree, 0, sizeof(struct merkle_tree));
+}
+
+
+/*
+ * Initialize the socket library where needed
+ */
+static void start_sockets(void) {
+#ifdef _WIN32
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+}
+
+
+/*
+ * Send all bytes over a socket
+ */
+static bool send_all(struct sync_channel *channel, const void *bytes, size_t count) {
+    const char *next = bytes;
+    while (count > 0) {
+        const int chunk = count > INT32_MAX ? INT32_MAX : (int) count;
+        const long sent = send(channel->socket, next, chunk, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+        next += sent;
+        count -= (size_t) sent;
+        channel->bytes_sent += (uint64_t) sent;
+    }
+    return true;
+}
+
+
+/*
+ * Receive exactly the given number of bytes from a socket
+ */
+static bool receive_all(struct sync_channel *channel, void *bytes, size_t count) {
+    char *next = bytes;
+    while (count > 0) {
+        const int chunk = count > INT32_MAX ? INT32_MAX : (int) count;
+        const long received = recv(channel->socket, next, chunk, 0);
+        if (received <= 0)
+            return false;
+        next += received;
+        count -= (size_t) received;
+        channel->bytes_received += (uint64_t) received;
+    }
+    return true;
+}
+
+
+/*
+ * Build the nonce of a frame from its sender and number, so no nonce is ever used twice per session key
+ */
+static void frame_nonce(const bool from_server, const uint64_t number, unsigned char *nonce) {
+    memset(nonce, 0, SYNC_NONCE_SIZE);
+    nonce[0] = from_server ? 1 : 0;
+    for (int i = 0; i < 8; i++)
+        nonce[SYNC_NONCE_SIZE - 1 - i] = (unsigned char) (number >> (8 * i));
+}
+
+
+/*
+ * Encrypt a message with AES-256-GCM and send it as one frame: length, ciphertext and tag
+ *
+ * param struct sync_channel* channel: The connection
+ * param const struct sync_buffer* message: The message
+ * return bool: false if the message could not be sent
+ */
+static bool send_frame(struct sync_channel *channel, const struct sync_buffer *message) {
+    if (message->failed || message->length > SYNC_MAX_FRAME_SIZE)
+        return false;
+    unsigned char nonce[SYNC_NONCE_SIZE];
+    frame_nonce(channel->is_server, channel->frames_sent++, nonce);
+    unsigned char *frame = malloc(4 + message->length + SYNC_TAG_SIZE);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int length = 0, final_length = 0;
+    bool sealed = frame && ctx &&
+        EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, channel->key, nonce) == 1 &&
+        EVP_EncryptUpdate(ctx, frame + 4, &length, message->data, (int) message->length) == 1 &&
+        EVP_EncryptFinal_ex(ctx, frame + 4 + length, &final_length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, SYNC_TAG_SIZE, frame + 4 + message->length) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    if (sealed) {
+        const uint32_t size = (uint32_t) message->length;
+        frame[0] = size >> 24;
+        frame[1] = size >> 16;
+        frame[2] = size >> 8;
+        frame[3] = size;
+        sealed = send_all(channel, frame, 4 + message->length + SYNC_TAG_SIZE);
+    }
+    free(frame);
+    return sealed;
+}
+
+
+/*
+ * Receive a frame and decrypt it. Fails if the other node used another vault key
+ * or the frame was changed or replayed
+ *
+ * param struct sync_channel* channel: The connection
+ * param struct sync_buffer* message: Receives the message
+ * return bool: false if no authentic frame could be received
+ */
+static bool receive_frame(struct sync_channel *channel, struct sync_buffer *message) {
+    unsigned char header[4];
+    if (!receive_all(channel, header, sizeof(header)))
+        return false;
+    const size_t size = (size_t) header[0] << 24 | (size_t) header[1] << 16 | (size_t) header[2] << 8 | header[3];
+    if (size == 0 || size > SYNC_MAX_FRAME_SIZE)
+        return false;
+    unsigned char *frame = malloc(size + SYNC_TAG_SIZE);
+    if (!frame || !receive_all(channel, frame, size + SYNC_TAG_SIZE)) {
+        free(frame);
+        return false;
+    }
+
+    message->length = 0;
+    message->position = 0;
+    message->failed = false;
+    put_bytes(message, frame, 0);
+    if (size > message->capacity) {
+        unsigned char *data = secure_realloc(message->data, size);
+        if (!data) {
+            free(frame);
+            return false;
+        }
+        message->data = data;
+        message->capacity = size;
+    }
+
+    unsigned char nonce[SYNC_NONCE_SIZE];
+    frame_nonce(!channel->is_server, channel->frames_received++, nonce);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int length = 0, final_length = 0;
+    const bool opened = ctx &&
+        EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, channel->key, nonce) == 1 &&
+        EVP_DecryptUpdate(ctx, message->data, &length, frame, (int) size) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, SYNC_TAG_SIZE, frame + size) == 1 &&
+        EVP_DecryptFinal_ex(ctx, message->data + length, &final_length) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    free(frame);
+    if (!opened)
+        return false;
+    message->length = size;
+    return true;
+}
+
+
+/*
+ * Derive the session key from the vault key and the salt of the session
+ */
+static bool derive_session_key(struct sync_channel *channel, const struct vault_key *vault_key, const unsigned char *salt) {
+    return derive_subkey(vault_key, SYNC_KEY_PURPOSE, salt, SYNC_SALT_SIZE, channel->key, SYNC_KEY_SIZE);
+}
+
+
+/*
+ * Open a connection structure for a socket, on the secure heap as it holds the session key
+ */
+static struct sync_channel *open_channel(const sync_socket socket, const bool is_server) {
+    struct sync_channel *channel = secure_malloc(sizeof(struct sync_channel));
+    if (!channel) {
+        close_socket(socket);
+        return NULL;
+    }
+    channel->socket = socket;
+    channel->is_server = is_server;
+    return channel;
+}
+
+
+/*
+ * Close a connection and wipe its session key
+ */
+static void close_channel(struct sync_channel *channel) {
+    if (!channel)
+        return;
+    close_socket(channel->socket);
+    secure_free(channel);
+}
+
+
+/*
+ * Split an address into host and port. Addresses containing a '/' name a Unix socket instead
+ *
+ * param const char* address: "HOST:PORT", ":PORT" or a socket path
+ * param char* host: Receives the host, empty for the default
+ * param size_t host_size: Size of the host buffer
+ * return const char*: The port inside the address, NULL for socket paths or malformed addresses
+ */
+static const char *split_address(const char *address, char *host, const size_t host_size) {
+    const char *colon = strrchr(address, ':');
+    if (strchr(address, '/') || !colon || (size_t) (colon - address) >= host_size)
+        return NULL;
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+    return colon + 1;
+}
+
+
+/*
+ * Open a listening or connected socket for an address
+ *
+ * param const char* address: "HOST:PORT", ":PORT" or a Unix socket path
+ * param bool listening: true to listen for connections, false to connect
+ * return sync_socket: The socket, INVALID_SYNC_SOCKET on failure
+ */
+static sync_socket open_socket(const char *address, const bool listening) {
+    start_sockets();
+    char host[256];
+    const char *port = split_address(address, host, sizeof(host));
+    if (!port) {
+#ifdef _WIN32
+        return INVALID_SYNC_SOCKET;
+#else
+        struct sockaddr_un local = {0};
+        if (!strchr(address, '/') || strlen(address) >= sizeof(local.sun_path))
+            return INVALID_SYNC_SOCKET;
+        local.sun_family = AF_UNIX;
+        strcpy(local.sun_path, address);
+        const sync_socket fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == INVALID_SYNC_SOCKET)
+            return INVALID_SYNC_SOCKET;
+        if (listening) {
+            // Replace the socket left behind by an earlier server, but never any other file
+            struct stat info;
+            if (stat(address, &info) == 0 && S_ISSOCK(info.st_mode))
+                unlink(address);
+        }
+        const int result = listening ?
+            bind(fd, (struct sockaddr *) &local, sizeof(local)) == 0 && listen(fd, 8) == 0 ? 0 : -1 :
+            connect(fd, (struct sockaddr *) &local, sizeof(local));
+        if (result != 0) {
+            close_socket(fd);
+            return INVALID_SYNC_SOCKET;
+        }
+        return fd;
+#endif
+    }
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    struct addrinfo *addresses = NULL;
+    if (getaddrinfo(*host ? host : listening ? NULL : "localhost", port, &hints, &addresses) != 0)
+        return INVALID_SYNC_SOCKET;
+    sync_socket fd = INVALID_SYNC_SOCKET;
+    for (const struct addrinfo *candidate = addresses; candidate; candidate = candidate->ai_next) {
+        fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+        if (fd == INVALID_SYNC_SOCKET)
+            continue;
+        if (listening) {
+            const int reuse = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char *) &reuse, sizeof(reuse));
+            if (bind(fd, candidate->ai_addr, candidate->ai_addrlen) == 0 && listen(fd, 8) == 0)
+                break;
+        } else if (connect(fd, candidate->ai_addr, candidate->ai_addrlen) == 0) {
+            break;
+        }
+        close_socket(fd);
+        fd = INVALID_SYNC_SOCKET;
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+
+/*
+ * Answer the requests of one client until it is done
+ *
+ * param struct sync_channel* channel: The connection
+ * param const struct merkle_tree* tree: Tree over the served vault
+ * param struct password** passwords: The served entries
+ * return bool: true if the client finished the session
+ */
+static bool serve_session(struct sync_channel *channel, const struct merkle_tree *tree, struct password **passwords) {
+    const uint32_t num_leaves = (uint32_t) 1 << tree->depth;
+    struct sync_buffer request = {0};
+    struct sync_buffer reply = {0};
+    bool done = false;
+    while (!done && receive_frame(channel, &request)) {
+        const unsigned char *type = get_bytes(&request, 1);
+        const uint32_t count = type && *type != REQUEST_DONE ? get_u32(&request) : 0;
+        if (!type || request.failed || (size_t) count * 4 > request.length) {
+            break;
+        } else if (*type == REQUEST_DONE) {
+            done = true;
+        } else if (*type == REQUEST_NODES) {
+            start_message(&reply, REPLY_HASHES);
+            for (uint32_t i = 0; i < count; i++) {
+                const uint32_t node = get_u32(&request);
+                if (node == 0 || node >= 2 * num_leaves)
+                    request.failed = true;
+                else
+                    put_bytes(&reply, tree->nodes[node], SYNC_NODE_HASH_SIZE);
+            }
+            if (request.failed || !send_frame(channel, &reply))
+                break;
+        } else if (*type == REQUEST_LEAVES) {
+            start_message(&reply, REPLY_ENTRIES);
+            for (uint32_t i = 0; i < count; i++) {
+                const uint32_t leaf = get_u32(&request);
+                if (leaf >= num_leaves) {
+                    request.failed = true;
+                    break;
+                }
+                put_u32(&reply, leaf);
+                put_u32(&reply, (uint32_t) (tree->leaf_start[leaf + 1] - tree->leaf_start[leaf]));
+                for (int next = tree->leaf_start[leaf]; next < tree->leaf_start[leaf + 1]; next++) {
+                    const struct password *entry = passwords[tree->order[next]];
+                    put_string(&reply, entry->name);
+                    put_string(&reply, entry->username);
+                    put_string(&reply, entry->password);
+                    put_string(&reply, entry->previous_password);
+                    put_string(&reply, entry->folder);
+                    put_string(&reply, entry->tags);
+                    put_string(&reply, entry->attachments);
+                    put_u64(&reply, (uint64_t) entry->created);
+                    put_u64(&reply, (uint64_t) entry->changed);
+                }
+            }
+            if (request.failed || !send_frame(channel, &reply))
+                break;
+        } else {
+            break;
+        }
+    }
+    free_buffer(&request);
+    free_buffer(&reply);
+    return done;
+}
+
+
+/*
+ * Serve the vault to sync clients. Clients mirror the served vault, the served vault itself
+ * is never changed. The vault is reloaded when another process commits to it.
+ *
+ * param const char* address: "HOST:PORT", ":PORT" or a Unix socket path to listen on
+ * param bool once: Stop after the first finished session
+ * param const char* vault_path: Path of the vault file, to pick up later commits
+ * param const struct vault_key* vault_key: The vault key, clients have to know it as well
+ * param uint64_t version: Version of the loaded vault
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * return int: Exit code of the command
+ */
+int run_sync_server(
+    const char *address,
+    const bool once,
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    uint64_t version,
+    struct password **passwords,
+    int num_passwords) {
+    const sync_socket listener = open_socket(address, true);
+    if (listener == INVALID_SYNC_SOCKET) {
+        printf("Failed to listen on %s\n", address);
+        return 1;
+    }
+    // Entries loaded by the server itself after a commit of another process
+    struct password **reloaded = NULL;
+    int num_reloaded = 0;
+    struct merkle_tree tree;
+    if (!build_merkle_tree(passwords, num_passwords, sync_depth_for(count_live_passwords(passwords, num_passwords)), &tree)) {
+        printf("Failed to build the Merkle tree\n");
+        close_socket(listener);
+        return 1;
+    }
+    printf("Serving the vault on %s\n", address);
+    fflush(stdout);
+
+    int exit_code = 0;
+    while (true) {
+        const sync_socket client = accept(listener, NULL, NULL);
+        if (client == INVALID_SYNC_SOCKET)
+            continue;
+
+        char *cleartext = NULL;
+        if (read_vault_version(vault_path) != version && decrypt_file(vault_path, &cleartext, vault_key, &version)) {
+            free_passwords(reloaded, num_reloaded);
+            free(reloaded);
+            reloaded = read_passwords(cleartext, &num_reloaded);
+            secure_free(cleartext);
+            passwords = reloaded;
+            num_passwords = num_reloaded;
+            free_merkle_tree(&tree);
+            if (!passwords || !build_merkle_tree(passwords, num_passwords,
+                    sync_depth_for(count_live_passwords(passwords, num_passwords)), &tree)) {
+                printf("Failed to build the Merkle tree\n");
+                close_socket(client);
+                exit_code = 1;
+                break;
+            }
+        }
+
+        struct sync_channel *channel = open_channel(client, true);
+        unsigned char hello[SYNC_HELLO_SIZE];
+        memcpy(hello, SYNC_MAGIC, SYNC_MAGIC_SIZE);
+        hello[SYNC_HELLO_SIZE - 1] = (unsigned char) tree.depth;
+        const bool finished = channel &&
+            RAND_bytes(hello + SYNC_MAGIC_SIZE, SYNC_SALT_SIZE) == 1 &&
+            derive_session_key(channel, vault_key, hello + SYNC_MAGIC_SIZE) &&
+            send_all(channel, hello, sizeof(hello)) &&
+            serve_session(channel, &tree, passwords);
+        if (channel) {
+            printf("Sync session %s: %llu bytes received, %llu bytes sent\n", finished ? "finished" : "aborted",
+                (unsigned long long) channel->bytes_received, (unsigned long long) channel->bytes_sent);
+            fflush(stdout);
+        }
+        close_channel(channel);
+        if (once && finished)
+            break;
+    }
+
+    free_merkle_tree(&tree);
+    free_passwords(reloaded, num_reloaded);
+    free(reloaded);
+    close_socket(listener);
+    return exit_code;
+}
+
+
+/*
+ * Walk down the Merkle trees level by level and collect the leaves that differ.
+ * Only children of differing nodes are requested, so the number of compared nodes grows with
+ * the number of changes times the depth instead of the vault size.
+ *
+ * param struct sync_channel* channel: The connection
+ * param const struct merkle_tree* tree: The local tree
+ * param uint32_t** leaves: Receives the differing leaves, has to be freed
+ * param uint32_t* num_leaves: Receives the number of differing leaves
+ * param uint64_t* num_compared: Receives the number of compared nodes
+ * return bool: false if the exchange failed
+ */
+static bool find_differing_leaves(
+    struct sync_channel *channel,
+    const struct merkle_tree *tree,
+    uint32_t **leaves,
+    uint32_t *num_leaves,
+    uint64_t *num_compared) {
+    const uint32_t first_leaf = (uint32_t) 1 << tree->depth;
+    uint32_t *frontier = malloc(sizeof(uint32_t));
+    uint32_t frontier_size = 1;
+    struct sync_buffer request = {0};
+    struct sync_buffer reply = {0};
+    bool ok = frontier != NULL;
+    if (ok)
+        frontier[0] = 1;
+    *num_compared = 0;
+
+    for (int level = 0; ok && frontier_size > 0 && level <= tree->depth; level++) {
+        start_message(&request, REQUEST_NODES);
+        put_u32(&request, frontier_size);
+        for (uint32_t i = 0; i < frontier_size; i++)
+            put_u32(&request, frontier[i]);
+        ok = send_frame(channel, &request) && receive_frame(channel, &reply);
+        const unsigned char *type = ok ? get_bytes(&reply, 1) : NULL;
+        const unsigned char *hashes = type && *type == REPLY_HASHES ?
+            get_bytes(&reply, (size_t) frontier_size * SYNC_NODE_HASH_SIZE) : NULL;
+        // Children of differing nodes at most double the frontier
+        uint32_t *next = hashes ? malloc(2 * (size_t) frontier_size * sizeof(uint32_t)) : NULL;
+        ok = next != NULL;
+        uint32_t next_size = 0;
+        for (uint32_t i = 0; ok && i < frontier_size; i++) {
+            const uint32_t node = frontier[i];
+            if (memcmp(hashes + (size_t) i * SYNC_NODE_HASH_SIZE, tree->nodes[node], SYNC_NODE_HASH_SIZE) == 0)
+                continue;
+            if (level == tree->depth) {
+                next[next_size++] = node - first_leaf;
+            } else {
+                next[next_size++] = 2 * node;
+                next[next_size++] = 2 * node + 1;
+            }
+        }
+        *num_compared += frontier_size;
+        free(frontier);
+        frontier = next;
+        frontier_size = next_size;
+    }
+    free_buffer(&request);
+    free_buffer(&reply);
+    if (!ok) {
+        free(frontier);
+        return false;
+    }
+    // After the leaf level the frontier holds the numbers of the differing leaves
+    *leaves = frontier;
+    *num_leaves = frontier_size;
+    return true;
+}
+
+
+/*
+ * Get the time elapsed since an earlier point in time
+ *
+ * param const struct timespec* since: The earlier point in time
+ * return double: Elapsed milliseconds
+ */
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return 1000.0 * (double) (now.tv_sec - since->tv_sec) + (double) (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+
+/*
+ * Replace the entries of the differing leaves with those of the server.
+ * Entries that are equal on both nodes are kept, so only real changes are counted.
+ *
+ * param struct sync_buffer* reply: The REPLY_ENTRIES message, positioned behind its type
+ * param const struct merkle_tree* tree: The local tree
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param int* counts: Receives the number of added, changed and deleted entries
+ * param const struct password_listener* listener: Told about the applied entries, may be NULL
+ * return bool: false if the reply is malformed or memory ran out
+ */
+static bool apply_leaves(
+    struct sync_buffer *reply,
+    const struct merkle_tree *tree,
+    struct password ***passwords,
+    int *num_passwords,
+    int counts[3],
+    const struct password_listener *listener) {
+    const uint32_t num_leaves = (uint32_t) 1 << tree->depth;
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    bool ok = md != NULL;
+    while (ok && reply->position < reply->length) {
+        const uint32_t leaf = get_u32(reply);
+        const uint32_t num_entries = get_u32(reply);
+        if (reply->failed || leaf >= num_leaves)
+            break;
+        const int first = tree->leaf_start[leaf];
+        const int last = tree->leaf_start[leaf + 1];
+        // Leaves hold a few entries, so pairing them up by name is cheap
+        bool *matched = calloc((size_t) (last - first) + 1, sizeof(bool));
+        ok = matched != NULL;
+        for (uint32_t i = 0; ok && i < num_entries; i++) {
+            struct password received = {0};
+            received.name = get_string(reply);
+            received.username = get_string(reply);
+            received.password = get_string(reply);
+            received.previous_password = get_string(reply);
+            received.folder = get_string(reply);
+            received.tags = get_string(reply);
+            received.attachments = get_string(reply);
+            received.created = (long long) get_u64(reply);
+            received.changed = (long long) get_u64(reply);
+            ok = !reply->failed && received.name && received.username && received.password;
+            int local = -1;
+            for (int next = first; ok && next < last; next++) {
+                if (!matched[next - first] && strcmp((*passwords)[tree->order[next]]->name, received.name) == 0) {
+                    local = next;
+                    break;
+                }
+            }
+            unsigned char local_hash[SHA256_DIGEST_LENGTH], received_hash[SHA256_DIGEST_LENGTH];
+            if (ok && local >= 0) {
+                matched[local - first] = true;
+                struct password **slot = &(*passwords)[tree->order[local]];
+                digest_entry(md, *slot, local_hash);
+                digest_entry(md, &received, received_hash);
+                if (memcmp(local_hash, received_hash, sizeof(local_hash)) != 0) {
+                    // Move the received fields into the local entry, the old ones are freed below
+                    struct password old = **slot;
+                    **slot = received;
+                    (*slot)->expiry_position = old.expiry_position;
+                    received = old;
+                    report_password_change(listener, *slot, PASSWORD_CHANGED);
+                    counts[1]++;
+                }
+            } else if (ok) {
+                ok = add_password(passwords, num_passwords, received.name, received.username, received.password,
+                    listener);
+                if (ok) {
+                    struct password *added = (*passwords)[*num_passwords - 1];
+                    added->previous_password = received.previous_password;
+                    added->folder = received.folder;
+                    added->tags = received.tags;
+                    added->attachments = received.attachments;
+                    received.previous_password = received.folder = received.tags = received.attachments = NULL;
+                    added->created = received.created;
+                    added->changed = received.changed;
+                    report_password_change(listener, added, PASSWORD_CHANGED);
+                    counts[0]++;
+                }
+            }
+            secure_free(received.name);
+            secure_free(received.username);
+            secure_free(received.password);
+            secure_free(received.previous_password);
+            secure_free(received.folder);
+            secure_free(received.tags);
+            secure_free(received.attachments);
+        }
+        for (int next = first; ok && next < last; next++) {
+            if (!matched[next - first]) {
+                delete_password(passwords, tree->order[next], listener);
+                counts[2]++;
+            }
+        }
+        free(matched);
+    }
+    EVP_MD_CTX_free(md);
+    return ok && !reply->failed;
+}
+
+
+/*
+ * Mirror the vault served by another node: compare the Merkle trees, fetch only the entries
+ * of differing leaves and apply them. The caller saves the vault once afterwards.
+ *
+ * param const char* address: "HOST:PORT" or a Unix socket path of the server
+ * param const struct vault_key* vault_key: The vault key, has to be the same on both nodes
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * param const struct password_listener* listener: Told about the applied entries, may be NULL
+ * return int: Exit code of the command
+ */
+int run_sync_client(
+    const char *address,
+    const struct vault_key *vault_key,
+    struct password ***passwords,
+    int *num_passwords,
+    bool *modified,
+    const struct password_listener *listener) {
+    struct timespec started;
+    timespec_get(&started, TIME_UTC);
+    const sync_socket server = open_socket(address, false);
+    if (server == INVALID_SYNC_SOCKET) {
+        printf("Failed to connect to %s\n", address);
+        return 1;
+    }
+    struct sync_channel *channel = open_channel(server, false);
+    unsigned char hello[SYNC_HELLO_SIZE];
+    if (!channel || !receive_all(channel, hello, sizeof(hello)) || memcmp(hello, SYNC_MAGIC, SYNC_MAGIC_SIZE) != 0 ||
+        hello[SYNC_HELLO_SIZE - 1] < SYNC_MIN_DEPTH || hello[SYNC_HELLO_SIZE - 1] > SYNC_MAX_DEPTH ||
+        !derive_session_key(channel, vault_key, hello + SYNC_MAGIC_SIZE)) {
+        printf("%s is not a C-Pass sync server\n", address);
+        close_channel(channel);
+        return 1;
+    }
+
+    struct merkle_tree tree;
+    if (!build_merkle_tree(*passwords, *num_passwords, hello[SYNC_HELLO_SIZE - 1], &tree)) {
+        printf("Failed to build the Merkle tree\n");
+        close_channel(channel);
+        return 1;
+    }
+
+    uint32_t *leaves = NULL;
+    uint32_t num_leaves = 0;
+    uint64_t num_compared = 0;
+    int counts[3] = {0};
+    bool ok = find_differing_leaves(channel, &tree, &leaves, &num_leaves, &num_compared);
+    struct sync_buffer message = {0};
+    if (ok && num_leaves > 0) {
+        start_message(&message, REQUEST_LEAVES);
+        put_u32(&message, num_leaves);
+        for (uint32_t i = 0; i < num_leaves; i++)
+            put_u32(&message, leaves[i]);
+        ok = send_frame(channel, &message) && receive_frame(channel, &message);
+        const unsigned char *type = ok ? get_bytes(&message, 1) : NULL;
+        ok = type && *type == REPLY_ENTRIES && apply_leaves(&message, &tree, passwords, num_passwords, counts,
+            listener);
+    }
+    if (ok) {
+        start_message(&message, REQUEST_DONE);
+        send_frame(channel, &message);
+    }
+
+    if (ok) {
+        printf("Compared %llu tree nodes and %u leaves in %.1f ms, %llu bytes received, %llu bytes sent\n",
+            (unsigned long long) num_compared, num_leaves, elapsed_ms(&started),
+            (unsigned long long) channel->bytes_received, (unsigned long long) channel->bytes_sent);
+        printf("%d added, %d changed, %d deleted\n", counts[0], counts[1], counts[2]);
+    } else {
+        // Entries of a partially applied reply are kept, but the vault is not saved
+        printf("Sync with %s failed. Do both nodes use the same master password?\n", address);
+    }
+    if (ok && counts[0] + counts[1] + counts[2] > 0)
+        *modified = true;
+    free_buffer(&message);
+    free(leaves);
+    free_merkle_tree(&tree);
+    close_channel(channel);
+    return ok ? 0 : 1;
+}
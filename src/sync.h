@@ -0,0 +1,48 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "crypto.h"
+#include "password.h"
+
+// Leaves of the Merkle tree are selected by the leading bits of the name hash
+#define SYNC_MIN_DEPTH 4
+#define SYNC_MAX_DEPTH 20
+// Aim for about this many entries per leaf
+#define SYNC_ENTRIES_PER_LEAF 4
+// Bytes of each Merkle node hash that are compared and sent
+#define SYNC_NODE_HASH_SIZE 16
+// The session key is derived from the vault key and a random salt per connection
+#define SYNC_KEY_PURPOSE "cpass sync"
+// Upper bound for a single frame, protects against corrupt length fields
+#define SYNC_MAX_FRAME_SIZE (256 * 1024 * 1024)
+
+// Digests of all live entries, bucketed by name hash into the leaves of a complete binary tree
+struct merkle_tree {
+    int depth;
+    unsigned char (*nodes)[SYNC_NODE_HASH_SIZE]; // Heap order, node 1 is the root, leaves start at 1 << depth
+    int *leaf_start;                             // Entries of leaf i are order[leaf_start[i]] up to leaf_start[i + 1]
+    int *order;                                  // Array slots sorted by leaf and entry hash
+};
+
+int sync_depth_for(int num_entries);
+bool build_merkle_tree(struct password **passwords, int num_passwords, int depth, struct merkle_tree *tree);
+void free_merkle_tree(struct merkle_tree *tree);
+int run_sync_server(
+    const char *address,
+    bool once,
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    uint64_t version,
+    struct password **passwords,
+    int num_passwords);
+int run_sync_client(
+    const char *address,
+    const struct vault_key *vault_key,
+    struct password ***passwords,
+    int *num_passwords,
+    bool *modified,
+    const struct password_listener *listener);
+
+#endif //SYNC_H
@@ -0,0 +1,46 @@
+#include "commands.h"
+#include <stdio.h>
+#include <string.h>
+#include "sync.h"
+
+
+/*
+ * Run the sync or sync-serve command on the loaded vault
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param const struct vault_source* source: The vault file the entries were loaded from
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+int run_sync(
+    const int argc,
+    char *argv[],
+    const struct vault_source *source,
+    struct password ***passwords,
+    int *num_passwords,
+    bool *modified) {
+    const bool is_server = strcmp(argv[0], "sync-serve") == 0;
+    const char *address = NULL;
+    bool once = false;
+    for (int i = 1; i < argc; i++) {
+        if (is_server && strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (!address) {
+            address = argv[i];
+        } else {
+            printf("Unknown option for %s: %s\n", argv[0], argv[i]);
+            return 2;
+        }
+    }
+    if (!address) {
+        printf("Missing address for %s\n", argv[0]);
+        return 2;
+    }
+    if (is_server)
+        return run_sync_server(address, once, source->path, source->vault_key, source->version,
+            *passwords, *num_passwords);
+    return run_sync_client(address, source->vault_key, passwords, num_passwords, modified, NULL);
+}
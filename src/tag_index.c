@@ -0,0 +1,386 @@
+#include "tag_index.h"
+#include <stdlib.h>
+#include <string.h>
+#include "secure_heap.h"
+#include "util.h"
+
+// One occurrence of a tag or folder, sorted to build the posting lists
+struct occurrence {
+    const char *key;
+    size_t length;
+    int slot;
+};
+
+// Tokens of a query and the position of the parser
+struct query_parser {
+    const char *tokens[MAX_QUERY_TOKENS];
+    int num_tokens;
+    int position;
+    const struct tag_index *index;
+    struct password **passwords;
+    int num_passwords;
+    const char *error;
+};
+
+
+static int compare_occurrences(const void *a, const void *b) {
+    const struct occurrence *first = a;
+    const struct occurrence *second = b;
+    const size_t length = first->length < second->length ? first->length : second->length;
+    const int order = memcmp(first->key, second->key, length);
+    if (order != 0)
+        return order;
+    if (first->length != second->length)
+        return first->length < second->length ? -1 : 1;
+    return (first->slot > second->slot) - (first->slot < second->slot);
+}
+
+
+/*
+ * Turn sorted occurrences into posting lists
+ *
+ * param struct occurrence* occurrences: The occurrences, sorted by key and slot
+ * param size_t count: Number of occurrences
+ * param struct posting_list** lists: Receives the posting lists, sorted by key
+ * param int* num_lists: Receives the number of posting lists
+ * return bool: false if memory ran out
+ */
+static bool build_postings(
+    const struct occurrence *occurrences,
+    const size_t count,
+    struct posting_list **lists,
+    int *num_lists) {
+    *num_lists = 0;
+    *lists = calloc(count + 1, sizeof(struct posting_list));
+    if (!*lists)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        const struct occurrence *current = &occurrences[i];
+        if (i == 0 || current->length != occurrences[i - 1].length ||
+            memcmp(current->key, occurrences[i - 1].key, current->length) != 0) {
+            struct posting_list *list = &(*lists)[(*num_lists)++];
+            bitmap_init(&list->slots);
+            list->key = secure_malloc(current->length + 1);
+            if (!list->key)
+                return false;
+            memcpy(list->key, current->key, current->length);
+            list->key[current->length] = '\0';
+        }
+        // Slots arrive in ascending order, so every add appends
+        if (!bitmap_add(&(*lists)[*num_lists - 1].slots, (uint32_t) current->slot))
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * Build the inverted index of the tags and folders of all live entries. The index refers to
+ * array slots, so it has to be rebuilt after the array has been compacted or merged
+ *
+ * param struct password** passwords: Array containing the password struct pointers, may contain tombstones
+ * param int num_passwords: The current size of the array
+ * param struct tag_index* index: Receives the index
+ * return bool: false if memory ran out, the index is empty then
+ */
+bool build_tag_index(struct password **passwords, const int num_passwords, struct tag_index *index) {
+    memset(index, 0, sizeof(struct tag_index));
+    bitmap_init(&index->live);
+    size_t num_tags = 0, num_folders = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (!passwords[i])
+            continue;
+        for (const char *c = passwords[i]->tags; c && *c; c++)
+            num_tags += *c == TAG_SEPARATOR;
+        num_tags += passwords[i]->tags != NULL;
+        num_folders += passwords[i]->folder != NULL;
+    }
+
+    struct occurrence *tags = malloc((num_tags + 1) * sizeof(struct occurrence));
+    struct occurrence *folders = malloc((num_folders + 1) * sizeof(struct occurrence));
+    bool ok = tags && folders;
+    num_tags = num_folders = 0;
+    for (int i = 0; ok && i < num_passwords; i++) {
+        const struct password *entry = passwords[i];
+        if (!entry)
+            continue;
+        ok = bitmap_add(&index->live, (uint32_t) i);
+        for (const char *c = entry->tags; c && *c; ) {
+            const size_t length = strcspn(c, ",");
+            tags[num_tags++] = (struct occurrence) {c, length, i};
+            c += length;
+            if (*c)
+                c++;
+        }
+        if (entry->folder)
+            folders[num_folders++] = (struct occurrence) {entry->folder, strlen(entry->folder), i};
+    }
+    if (ok) {
+        qsort(tags, num_tags, sizeof(struct occurrence), compare_occurrences);
+        qsort(folders, num_folders, sizeof(struct occurrence), compare_occurrences);
+        ok = build_postings(tags, num_tags, &index->tags, &index->num_tags) &&
+            build_postings(folders, num_folders, &index->folders, &index->num_folders);
+    }
+    free(tags);
+    free(folders);
+    if (!ok)
+        free_tag_index(index);
+    return ok;
+}
+
+
+static void free_postings(struct posting_list *lists, const int count) {
+    for (int i = 0; lists && i < count; i++) {
+        secure_free(lists[i].key);
+        bitmap_free(&lists[i].slots);
+    }
+    free(lists);
+}
+
+
+/*
+ * Release an index
+ *
+ * param struct tag_index* index: The index
+ */
+void free_tag_index(struct tag_index *index) {
+    free_postings(index->tags, index->num_tags);
+    free_postings(index->folders, index->num_folders);
+    bitmap_free(&index->live);
+    memset(index, 0, sizeof(struct tag_index));
+}
+
+
+/*
+ * Find the first posting list whose key is not less than the given key
+ */
+static int lower_bound(const struct posting_list *lists, const int count, const char *key) {
+    int low = 0, high = count;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (strcmp(lists[middle].key, key) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+
+/*
+ * Split a query into words and parentheses
+ *
+ * param char* query: Copy of the query, split in place
+ * return bool: false if the query has too many tokens
+ */
+static bool tokenize_query(struct query_parser *parser, char *query) {
+    for (char *c = query; *c; ) {
+        if (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n') {
+            *c++ = '\0';
+            continue;
+        }
+        if (parser->num_tokens == MAX_QUERY_TOKENS)
+            return false;
+        if (*c == '(' || *c == ')') {
+            // Parentheses are tokens of their own even without surrounding spaces, they are
+            // replaced by static strings so the query can be cut at their position
+            parser->tokens[parser->num_tokens++] = *c == '(' ? "(" : ")";
+            *c++ = '\0';
+            continue;
+        }
+        parser->tokens[parser->num_tokens++] = c;
+        c += strcspn(c, " \t\r\n()");
+        if (*c == '(' || *c == ')') {
+            if (parser->num_tokens == MAX_QUERY_TOKENS)
+                return false;
+            parser->tokens[parser->num_tokens++] = *c == '(' ? "(" : ")";
+            *c++ = '\0';
+        } else if (*c) {
+            *c++ = '\0';
+        }
+    }
+    return true;
+}
+
+
+static const char *peek_token(const struct query_parser *parser) {
+    return parser->position < parser->num_tokens ? parser->tokens[parser->position] : NULL;
+}
+
+
+static bool is_keyword(const char *token, const char *keyword) {
+    if (!token)
+        return false;
+    for (; *token && *keyword; token++, keyword++) {
+        if ((*token & ~0x20) != *keyword)
+            return false;
+    }
+    return *token == '\0' && *keyword == '\0';
+}
+
+
+/*
+ * Evaluate a single term: tag:TAG, folder:PATH (including its subfolders) or name:PATTERN.
+ * A bare word is a name pattern as well
+ */
+static bool evaluate_term(struct query_parser *parser, const char *term, struct bitmap *result) {
+    const struct tag_index *index = parser->index;
+    if (strncmp(term, "tag:", 4) == 0) {
+        const int position = lower_bound(index->tags, index->num_tags, term + 4);
+        if (position < index->num_tags && strcmp(index->tags[position].key, term + 4) == 0)
+            return bitmap_or(result, &index->tags[position].slots, result);
+        return true;
+    }
+    if (strncmp(term, "folder:", 7) == 0) {
+        const char *folder = term + 7;
+        while (*folder == FOLDER_SEPARATOR)
+            folder++;
+        const size_t length = strlen(folder);
+        // Subfolders of a folder sort right behind it, so they form one run of posting lists
+        for (int i = lower_bound(index->folders, index->num_folders, folder); i < index->num_folders; i++) {
+            const char *key = index->folders[i].key;
+            if (strncmp(key, folder, length) != 0)
+                break;
+            if ((length == 0 || key[length] == '\0' || key[length] == FOLDER_SEPARATOR) &&
+                !bitmap_or(result, &index->folders[i].slots, result))
+                return false;
+        }
+        return true;
+    }
+    // Names are not indexed, matching them takes one pass over the entries
+    const char *pattern = strncmp(term, "name:", 5) == 0 ? term + 5 : term;
+    for (int i = 0; i < parser->num_passwords; i++) {
+        if (parser->passwords[i] && pattern_matches(pattern, parser->passwords[i]->name) &&
+            !bitmap_add(result, (uint32_t) i))
+            return false;
+    }
+    return true;
+}
+
+
+static bool parse_or(struct query_parser *parser, struct bitmap *result);
+
+
+/*
+ * Parse NOT x, ( x ) and terms
+ */
+static bool parse_unary(struct query_parser *parser, struct bitmap *result) {
+    const char *token = peek_token(parser);
+    if (!token || is_keyword(token, "AND") || is_keyword(token, "OR") || strcmp(token, ")") == 0) {
+        parser->error = token ? "Expected a term before an operator or ')'" : "Query ends early";
+        return false;
+    }
+    parser->position++;
+    if (is_keyword(token, "NOT")) {
+        struct bitmap negated;
+        bitmap_init(&negated);
+        const bool ok = parse_unary(parser, &negated) && bitmap_andnot(&parser->index->live, &negated, result);
+        bitmap_free(&negated);
+        return ok;
+    }
+    if (strcmp(token, "(") == 0) {
+        if (!parse_or(parser, result))
+            return false;
+        if (!peek_token(parser) || strcmp(peek_token(parser), ")") != 0) {
+            parser->error = "Missing ')'";
+            return false;
+        }
+        parser->position++;
+        return true;
+    }
+    if (!evaluate_term(parser, token, result)) {
+        parser->error = "Out of memory";
+        return false;
+    }
+    return true;
+}
+
+
+/*
+ * Parse terms joined by AND, NOT or nothing at all. "a NOT b" means a AND NOT b
+ */
+static bool parse_and(struct query_parser *parser, struct bitmap *result) {
+    if (!parse_unary(parser, result))
+        return false;
+    while (true) {
+        const char *token = peek_token(parser);
+        if (!token || is_keyword(token, "OR") || strcmp(token, ")") == 0)
+            return true;
+        if (is_keyword(token, "AND"))
+            parser->position++;
+        // An explicit NOT is left to parse_unary, which negates against all live entries
+        struct bitmap operand;
+        bitmap_init(&operand);
+        const bool ok = parse_unary(parser, &operand) && bitmap_and(result, &operand, result);
+        bitmap_free(&operand);
+        if (!ok)
+            return false;
+    }
+}
+
+
+/*
+ * Parse alternatives joined by OR
+ */
+static bool parse_or(struct query_parser *parser, struct bitmap *result) {
+    if (!parse_and(parser, result))
+        return false;
+    while (is_keyword(peek_token(parser), "OR")) {
+        parser->position++;
+        struct bitmap operand;
+        bitmap_init(&operand);
+        const bool ok = parse_and(parser, &operand) && bitmap_or(result, &operand, result);
+        bitmap_free(&operand);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * Find all entries matching a query such as "tag:prod AND tag:db NOT tag:legacy".
+ * Terms are tag:TAG, folder:PATH (matching its subfolders as well) and name:PATTERN or a bare
+ * wildcard pattern for the name. They are combined with AND, OR, NOT and parentheses, adjacent
+ * terms are joined by AND. Tag and folder terms are answered from the index by bitmap operations
+ *
+ * param const struct tag_index* index: Index of the entries
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param const char* query: The query, an empty query matches all entries
+ * param struct bitmap* result: Receives the slots of the matching entries, has to be initialized
+ * param const char** error: Receives a description of a malformed query
+ * return bool: false if the query is malformed or memory ran out
+ */
+bool run_tag_query(
+    const struct tag_index *index,
+    struct password **passwords,
+    const int num_passwords,
+    const char *query,
+    struct bitmap *result,
+    const char **error) {
+    struct query_parser parser = {0};
+    parser.index = index;
+    parser.passwords = passwords;
+    parser.num_passwords = num_passwords;
+    char *copy = secure_strdup(query);
+    bool ok = copy != NULL;
+    if (ok && !tokenize_query(&parser, copy)) {
+        parser.error = "Query has too many terms";
+        ok = false;
+    }
+    if (ok && parser.num_tokens == 0) {
+        ok = bitmap_or(result, &index->live, result);
+    } else if (ok) {
+        ok = parse_or(&parser, result);
+        if (ok && parser.position < parser.num_tokens) {
+            parser.error = "Unexpected ')'";
+            ok = false;
+        }
+    }
+    secure_free(copy);
+    if (!ok)
+        bitmap_free(result);
+    *error = parser.error ? parser.error : "Out of memory";
+    return ok;
+}
@@ -0,0 +1,36 @@
+#ifndef TAG_INDEX_H
+#define TAG_INDEX_H
+
+#include <stdbool.h>
+#include "bitmap.h"
+#include "password.h"
+
+// Longest query accepted, in tokens
+#define MAX_QUERY_TOKENS 256
+
+// Entries carrying one tag or lying directly in one folder, as array slots
+struct posting_list {
+    char *key;
+    struct bitmap slots;
+};
+
+// Inverted index of the tags and folders of the loaded entries, keyed by array slot
+struct tag_index {
+    struct posting_list *tags;    // Sorted by tag
+    int num_tags;
+    struct posting_list *folders; // Sorted by folder path
+    int num_folders;
+    struct bitmap live;           // Slots of all live entries
+};
+
+bool build_tag_index(struct password **passwords, int num_passwords, struct tag_index *index);
+void free_tag_index(struct tag_index *index);
+bool run_tag_query(
+    const struct tag_index *index,
+    struct password **passwords,
+    int num_passwords,
+    const char *query,
+    struct bitmap *result,
+    const char **error);
+
+#endif //TAG_INDEX_H
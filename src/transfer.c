@@ -0,0 +1,723 @@
+#include "transfer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "util.h"
+#include "secure_heap.h"
+
+// Bytes read from the input per call to fread
+#define TRANSFER_CHUNK_SIZE (256 * 1024)
+// Columns beyond this are ignored
+#define MAX_COLUMNS 64
+
+enum column {
+    COLUMN_IGNORED = -1,
+    COLUMN_NAME,
+    COLUMN_USERNAME,
+    COLUMN_PASSWORD,
+    COLUMN_FOLDER,
+    COLUMN_TAGS,
+    NUM_COLUMNS
+};
+
+struct column_alias {
+    const char *header;
+    enum column column;
+    int priority; // Lower wins if several headers map to the same column
+};
+
+// Header names used by common password managers, e.g. "name,url,username,password"
+static const struct column_alias column_aliases[] = {
+    {"name", COLUMN_NAME, 0},
+    {"title", COLUMN_NAME, 1},
+    {"website", COLUMN_NAME, 2},
+    {"site", COLUMN_NAME, 2},
+    {"url", COLUMN_NAME, 3},
+    {"login_uri", COLUMN_NAME, 3},
+    {"username", COLUMN_USERNAME, 0},
+    {"login_username", COLUMN_USERNAME, 1},
+    {"user", COLUMN_USERNAME, 1},
+    {"login", COLUMN_USERNAME, 2},
+    {"email", COLUMN_USERNAME, 3},
+    {"password", COLUMN_PASSWORD, 0},
+    {"login_password", COLUMN_PASSWORD, 1},
+    {"pass", COLUMN_PASSWORD, 2},
+    {"folder", COLUMN_FOLDER, 0},
+    {"group", COLUMN_FOLDER, 1},
+    {"tags", COLUMN_TAGS, 0},
+    {"labels", COLUMN_TAGS, 1},
+};
+
+// The fields of the record currently being parsed, stored '\0'-separated in one growing buffer
+struct record_buffer {
+    char *data;
+    size_t length;
+    size_t size;
+    size_t starts[MAX_COLUMNS];
+    int num_fields;
+};
+
+struct import_state {
+    struct password ***passwords;
+    int *num_passwords;
+    int field_of_column[NUM_COLUMNS]; // Index of the CSV field holding each column, -1 if missing
+    bool header_done;
+    long imported;
+    long skipped;
+};
+
+
+/*
+ * Parse the name of an import/export format
+ *
+ * param const char* text: "csv" or "jsonl" (also accepted: "json")
+ * param enum transfer_format* format: Receives the parsed format
+ * return bool: false if the name is unknown
+ */
+bool parse_transfer_format(const char *text, enum transfer_format *format) {
+    if (strcmp(text, "csv") == 0) {
+        *format = TRANSFER_CSV;
+        return true;
+    }
+    if (strcmp(text, "jsonl") == 0 || strcmp(text, "json") == 0) {
+        *format = TRANSFER_JSONL;
+        return true;
+    }
+    return false;
+}
+
+
+/*
+ * Derive the import/export format from the extension of a file name
+ *
+ * param const char* file_name: The file name, e.g. "export.csv"
+ * param enum transfer_format* format: Receives the format
+ * return bool: false if the extension is unknown
+ */
+bool guess_transfer_format(const char *file_name, enum transfer_format *format) {
+    const char *extension = strrchr(file_name, '.');
+    return extension && parse_transfer_format(extension + 1, format);
+}
+
+
+/*
+ * Make sure the record buffer can hold the given number of additional bytes
+ *
+ * param struct record_buffer* record: The record buffer
+ * param size_t additional: Number of bytes that will be appended
+ * return bool: false if the buffer could not be grown
+ */
+static bool reserve_record(struct record_buffer *record, const size_t additional) {
+    if (record->length + additional <= record->size)
+        return true;
+    size_t new_size = record->size ? record->size * 2 : 256;
+    while (new_size < record->length + additional)
+        new_size *= 2;
+    char *temp = secure_realloc(record->data, new_size);
+    if (!temp)
+        return false;
+    record->data = temp;
+    record->size = new_size;
+    return true;
+}
+
+
+/*
+ * Append bytes to the field currently being parsed
+ *
+ * param struct record_buffer* record: The record buffer
+ * param const char* bytes: The bytes to append
+ * param size_t count: Number of bytes
+ * return bool: false if the buffer could not be grown
+ */
+static bool append_bytes(struct record_buffer *record, const char *bytes, const size_t count) {
+    if (!reserve_record(record, count))
+        return false;
+    memcpy(record->data + record->length, bytes, count);
+    record->length += count;
+    return true;
+}
+
+
+/*
+ * Terminate the field currently being parsed and start a new one
+ *
+ * param struct record_buffer* record: The record buffer
+ * return bool: false if the buffer could not be grown
+ */
+static bool end_field(struct record_buffer *record) {
+    if (!append_bytes(record, "", 1))
+        return false;
+    if (record->num_fields + 1 < MAX_COLUMNS)
+        record->starts[++record->num_fields] = record->length;
+    else
+        record->length = record->starts[record->num_fields]; // Drop surplus columns
+    return true;
+}
+
+
+/*
+ * Forget the parsed fields, keeping the allocated memory for the next record
+ *
+ * param struct record_buffer* record: The record buffer
+ */
+static void reset_record(struct record_buffer *record) {
+    record->length = 0;
+    record->num_fields = 0;
+    record->starts[0] = 0;
+}
+
+
+/*
+ * Look up which column a header name stands for
+ *
+ * param const char* header: The header name, compared case-insensitively
+ * param int* priority: Receives the priority of the matching alias
+ * return enum column: The column or COLUMN_IGNORED
+ */
+static enum column column_for_header(const char *header, int *priority) {
+    for (size_t i = 0; i < sizeof(column_aliases) / sizeof(column_aliases[0]); i++) {
+        const char *a = column_aliases[i].header;
+        const char *h = header;
+        while (*a && tolower((unsigned char) *h) == *a) {
+            a++;
+            h++;
+        }
+        if (*a == '\0' && *h == '\0') {
+            *priority = column_aliases[i].priority;
+            return column_aliases[i].column;
+        }
+    }
+    return COLUMN_IGNORED;
+}
+
+
+/*
+ * Add one imported entry to the vault, skipping entries without name or password
+ *
+ * param struct import_state* state: The import state
+ * param const char** values: The value of each column, NULL for missing columns
+ */
+static void import_entry(struct import_state *state, const char **values) {
+    const char *name = values[COLUMN_NAME];
+    const char *password = values[COLUMN_PASSWORD];
+    if (!name || !*name || !password || !*password) {
+        state->skipped++;
+        return;
+    }
+    const char *username = values[COLUMN_USERNAME];
+    if (add_password(state->passwords, state->num_passwords, name, username ? username : "", password, NULL)) {
+        struct password *entry = (*state->passwords)[*state->num_passwords - 1];
+        set_password_folder(entry, values[COLUMN_FOLDER]);
+        set_password_tags(entry, values[COLUMN_TAGS]);
+        state->imported++;
+    } else {
+        state->skipped++;
+    }
+}
+
+
+/*
+ * Handle a complete CSV record. The first record is used as header if it names at least
+ * the name and password columns, otherwise the columns are assumed to be name, username, password
+ *
+ * param struct import_state* state: The import state
+ * param struct record_buffer* record: The parsed record
+ */
+static void handle_csv_record(struct import_state *state, const struct record_buffer *record) {
+    // Ignore empty lines
+    if (record->num_fields == 0 && record->data[0] == '\0')
+        return;
+
+    if (!state->header_done) {
+        state->header_done = true;
+        int best[NUM_COLUMNS];
+        for (int c = 0; c < NUM_COLUMNS; c++) {
+            state->field_of_column[c] = -1;
+            best[c] = 1 << 30;
+        }
+        for (int f = 0; f <= record->num_fields; f++) {
+            int priority;
+            const enum column column = column_for_header(record->data + record->starts[f], &priority);
+            if (column != COLUMN_IGNORED && priority < best[column]) {
+                best[column] = priority;
+                state->field_of_column[column] = f;
+            }
+        }
+        if (state->field_of_column[COLUMN_NAME] >= 0 && state->field_of_column[COLUMN_PASSWORD] >= 0)
+            return;
+        state->field_of_column[COLUMN_NAME] = 0;
+        state->field_of_column[COLUMN_USERNAME] = 1;
+        state->field_of_column[COLUMN_PASSWORD] = 2;
+    }
+
+    const char *values[NUM_COLUMNS];
+    for (int c = 0; c < NUM_COLUMNS; c++) {
+        const int f = state->field_of_column[c];
+        values[c] = f >= 0 && f <= record->num_fields ? record->data + record->starts[f] : NULL;
+    }
+    import_entry(state, values);
+}
+
+
+/*
+ * Stream a CSV file (RFC 4180: quoted fields, doubled quotes, line breaks inside quotes)
+ * into the vault. Only the current record is held in memory
+ *
+ * param FILE* input: The open input stream
+ * param struct import_state* state: The import state
+ * return bool: false if reading failed or memory ran out
+ */
+static bool import_csv(FILE *input, struct import_state *state) {
+    enum { FIELD_START, UNQUOTED, QUOTED, QUOTE_IN_QUOTED } mode = FIELD_START;
+    struct record_buffer record = {0};
+    char *chunk = secure_malloc(TRANSFER_CHUNK_SIZE);
+    bool ok = chunk != NULL && reserve_record(&record, 1);
+    size_t count;
+
+    while (ok && (count = fread(chunk, 1, TRANSFER_CHUNK_SIZE, input)) > 0) {
+        size_t i = 0;
+        while (ok && i < count) {
+            if (mode == UNQUOTED || mode == QUOTED) {
+                // Copy the longest run of ordinary characters at once
+                const size_t start = i;
+                if (mode == UNQUOTED) {
+                    while (i < count && chunk[i] != ',' && chunk[i] != '\n' && chunk[i] != '\r' && chunk[i] != '"')
+                        i++;
+                } else {
+                    while (i < count && chunk[i] != '"')
+                        i++;
+                }
+                ok = append_bytes(&record, chunk + start, i - start);
+                if (!ok || i == count)
+                    break;
+            }
+            const char c = chunk[i++];
+            switch (mode) {
+                case FIELD_START:
+                case UNQUOTED:
+                case QUOTE_IN_QUOTED:
+                    if (c == '"' && mode == FIELD_START) {
+                        mode = QUOTED;
+                    } else if (c == '"' && mode == QUOTE_IN_QUOTED) {
+                        // Doubled quote inside a quoted field
+                        ok = append_bytes(&record, "\"", 1);
+                        mode = QUOTED;
+                    } else if (c == ',') {
+                        ok = end_field(&record);
+                        mode = FIELD_START;
+                    } else if (c == '\n') {
+                        ok = append_bytes(&record, "", 1);
+                        if (ok)
+                            handle_csv_record(state, &record);
+                        reset_record(&record);
+                        mode = FIELD_START;
+                    } else if (c != '\r') {
+                        ok = append_bytes(&record, &c, 1);
+                        mode = UNQUOTED;
+                    }
+                    break;
+                case QUOTED:
+                    mode = QUOTE_IN_QUOTED;
+                    break;
+            }
+        }
+    }
+    if (ok && ferror(input))
+        ok = false;
+    // Last record without trailing newline
+    if (ok && (record.length > 0 || record.num_fields > 0)) {
+        ok = append_bytes(&record, "", 1);
+        if (ok)
+            handle_csv_record(state, &record);
+    }
+    secure_free(record.data);
+    secure_free(chunk);
+    return ok;
+}
+
+
+/*
+ * Append a code point as UTF-8 to the record
+ *
+ * param struct record_buffer* record: The record buffer
+ * param unsigned long code_point: The unicode code point
+ * return bool: false if the buffer could not be grown
+ */
+static bool append_utf8(struct record_buffer *record, const unsigned long code_point) {
+    char bytes[4];
+    size_t count;
+    if (code_point < 0x80) {
+        bytes[0] = (char) code_point;
+        count = 1;
+    } else if (code_point < 0x800) {
+        bytes[0] = (char) (0xC0 | code_point >> 6);
+        bytes[1] = (char) (0x80 | (code_point & 0x3F));
+        count = 2;
+    } else if (code_point < 0x10000) {
+        bytes[0] = (char) (0xE0 | code_point >> 12);
+        bytes[1] = (char) (0x80 | (code_point >> 6 & 0x3F));
+        bytes[2] = (char) (0x80 | (code_point & 0x3F));
+        count = 3;
+    } else {
+        bytes[0] = (char) (0xF0 | code_point >> 18);
+        bytes[1] = (char) (0x80 | (code_point >> 12 & 0x3F));
+        bytes[2] = (char) (0x80 | (code_point >> 6 & 0x3F));
+        bytes[3] = (char) (0x80 | (code_point & 0x3F));
+        count = 4;
+    }
+    return append_bytes(record, bytes, count);
+}
+
+
+/*
+ * Read four hex digits of a JSON \u escape
+ *
+ * param const char* text: Points at the first hex digit
+ * param const char* end: End of the line
+ * param unsigned long* value: Receives the value
+ * return bool: false if the escape is malformed
+ */
+static bool read_hex4(const char *text, const char *end, unsigned long *value) {
+    if (end - text < 4)
+        return false;
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        const char c = text[i];
+        *value <<= 4;
+        if (c >= '0' && c <= '9') *value |= c - '0';
+        else if (c >= 'a' && c <= 'f') *value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') *value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+
+/*
+ * Decode a JSON string literal. If a record is given, the decoded string is appended to it
+ *
+ * param const char** cursor: Points at the opening quote, advanced past the closing quote
+ * param const char* end: End of the line
+ * param struct record_buffer* record: Receives the decoded bytes, NULL to only skip the string
+ * return bool: false if the string is malformed
+ */
+static bool parse_json_string(const char **cursor, const char *end, struct record_buffer *record) {
+    const char *c = *cursor + 1;
+    while (c < end) {
+        const char *start = c;
+        while (c < end && *c != '"' && *c != '\\')
+            c++;
+        if (record && !append_bytes(record, start, c - start))
+            return false;
+        if (c >= end)
+            return false;
+        if (*c == '"') {
+            *cursor = c + 1;
+            return !record || append_bytes(record, "", 1);
+        }
+        // Escape sequence
+        if (++c >= end)
+            return false;
+        char decoded;
+        switch (*c) {
+            case '"': decoded = '"'; break;
+            case '\\': decoded = '\\'; break;
+            case '/': decoded = '/'; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'n': decoded = '\n'; break;
+            case 'r': decoded = '\r'; break;
+            case 't': decoded = '\t'; break;
+            case 'u': {
+                unsigned long code_point;
+                if (!read_hex4(c + 1, end, &code_point))
+                    return false;
+                c += 5;
+                // Combine UTF-16 surrogate pairs
+                if (code_point >= 0xD800 && code_point < 0xDC00 && end - c >= 6 && c[0] == '\\' && c[1] == 'u') {
+                    unsigned long low;
+                    if (read_hex4(c + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                        c += 6;
+                    }
+                }
+                if (record && !append_utf8(record, code_point))
+                    return false;
+                continue;
+            }
+            default:
+                return false;
+        }
+        if (record && !append_bytes(record, &decoded, 1))
+            return false;
+        c++;
+    }
+    return false;
+}
+
+
+/*
+ * Skip a JSON value that is not a string (number, literal, nested object or array)
+ *
+ * param const char** cursor: Points at the value, advanced past it
+ * param const char* end: End of the line
+ * return bool: false if the value is malformed
+ */
+static bool skip_json_value(const char **cursor, const char *end) {
+    const char *c = *cursor;
+    int depth = 0;
+    while (c < end) {
+        if (*c == '"') {
+            if (!parse_json_string(&c, end, NULL))
+                return false;
+            continue;
+        }
+        if (*c == '{' || *c == '[') {
+            depth++;
+        } else if (*c == '}' || *c == ']') {
+            if (depth == 0)
+                break;
+            depth--;
+        } else if (*c == ',' && depth == 0) {
+            break;
+        }
+        c++;
+    }
+    *cursor = c;
+    return depth == 0;
+}
+
+
+/*
+ * Parse one JSON Lines object and import it as entry
+ *
+ * param struct import_state* state: The import state
+ * param const char* line: The line, not '\0'-terminated
+ * param size_t length: Length of the line
+ * param struct record_buffer* record: Scratch buffer for the decoded values
+ */
+static void handle_json_line(struct import_state *state, const char *line, const size_t length, struct record_buffer *record) {
+    const char *c = line;
+    const char *end = line + length;
+    while (c < end && isspace((unsigned char) *c))
+        c++;
+    // Ignore empty lines
+    if (c == end)
+        return;
+
+    reset_record(record);
+    long field_of_column[NUM_COLUMNS];
+    int best[NUM_COLUMNS];
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        field_of_column[i] = -1;
+        best[i] = 1 << 30;
+    }
+
+    if (*c++ != '{') {
+        state->skipped++;
+        return;
+    }
+    while (c < end) {
+        while (c < end && (isspace((unsigned char) *c) || *c == ','))
+            c++;
+        if (c < end && *c == '}')
+            break;
+        if (c >= end || *c != '"') {
+            state->skipped++;
+            return;
+        }
+        const size_t key_start = record->length;
+        if (!parse_json_string(&c, end, record)) {
+            state->skipped++;
+            return;
+        }
+        int priority;
+        const enum column column = column_for_header(record->data + key_start, &priority);
+        record->length = key_start;
+
+        while (c < end && isspace((unsigned char) *c))
+            c++;
+        if (c >= end || *c++ != ':') {
+            state->skipped++;
+            return;
+        }
+        while (c < end && isspace((unsigned char) *c))
+            c++;
+        if (c < end && *c == '"') {
+            const size_t value_start = record->length;
+            const bool wanted = column != COLUMN_IGNORED && priority < best[column];
+            if (!parse_json_string(&c, end, wanted ? record : NULL)) {
+                state->skipped++;
+                return;
+            }
+            if (wanted) {
+                best[column] = priority;
+                field_of_column[column] = (long) value_start;
+            }
+        } else if (!skip_json_value(&c, end)) {
+            state->skipped++;
+            return;
+        }
+    }
+
+    const char *values[NUM_COLUMNS];
+    for (int i = 0; i < NUM_COLUMNS; i++) {
+        values[i] = field_of_column[i] >= 0 ? record->data + field_of_column[i] : NULL;
+    }
+    import_entry(state, values);
+}
+
+
+/*
+ * Stream a JSON Lines file (one object with "name", "username" and "password" per line)
+ * into the vault. Only the current line is held in memory
+ *
+ * param FILE* input: The open input stream
+ * param struct import_state* state: The import state
+ * return bool: false if reading failed or memory ran out
+ */
+static bool import_jsonl(FILE *input, struct import_state *state) {
+    struct record_buffer line = {0};
+    struct record_buffer values = {0};
+    char *chunk = secure_malloc(TRANSFER_CHUNK_SIZE);
+    bool ok = chunk != NULL && reserve_record(&values, 256);
+    size_t count;
+
+    while (ok && (count = fread(chunk, 1, TRANSFER_CHUNK_SIZE, input)) > 0) {
+        const char *c = chunk;
+        const char *end = chunk + count;
+        while (c < end) {
+            const char *newline = memchr(c, '\n', end - c);
+            if (!newline) {
+                ok = append_bytes(&line, c, end - c);
+                break;
+            }
+            if (line.length > 0) {
+                // Line started in the previous chunk
+                ok = append_bytes(&line, c, newline - c);
+                if (!ok)
+                    break;
+                handle_json_line(state, line.data, line.length, &values);
+                line.length = 0;
+            } else {
+                // Parse directly from the chunk without copying
+                handle_json_line(state, c, newline - c, &values);
+            }
+            c = newline + 1;
+        }
+    }
+    if (ok && ferror(input))
+        ok = false;
+    if (ok && line.length > 0)
+        handle_json_line(state, line.data, line.length, &values);
+    secure_free(line.data);
+    secure_free(values.data);
+    secure_free(chunk);
+    return ok;
+}
+
+
+/*
+ * Import all entries of a CSV or JSON Lines stream directly into the password array.
+ * The input is parsed incrementally in fixed-size chunks, so apart from the vault itself
+ * memory use does not grow with the size of the input. The caller saves and encrypts
+ * the vault once afterwards.
+ *
+ * param FILE* input: The open input stream
+ * param enum transfer_format format: Format of the input
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param long* num_skipped: Receives the number of records that could not be imported, may be NULL
+ * return long: Number of imported entries or -1 if reading failed
+ */
+long import_passwords(
+    FILE *input,
+    const enum transfer_format format,
+    struct password ***passwords,
+    int *num_passwords,
+    long *num_skipped) {
+    struct import_state state = {0};
+    state.passwords = passwords;
+    state.num_passwords = num_passwords;
+
+    const bool ok = format == TRANSFER_CSV ? import_csv(input, &state) : import_jsonl(input, &state);
+    if (num_skipped)
+        *num_skipped = state.skipped;
+    return ok ? state.imported : -1;
+}
+
+
+/*
+ * Write a field as CSV, quoting it only if it contains a separator, quote or line break
+ *
+ * param FILE* output: The open output stream
+ * param const char* field: The field to write
+ */
+static void write_csv_field(FILE *output, const char *field) {
+    if (field[strcspn(field, ",\"\r\n")] == '\0') {
+        fputs(field, output);
+        return;
+    }
+    fputc('"', output);
+    for (const char *c = field; *c; c++) {
+        if (*c == '"')
+            fputc('"', output);
+        fputc(*c, output);
+    }
+    fputc('"', output);
+}
+
+
+/*
+ * Export all entries as CSV (with header) or JSON Lines. Entries are written one by one,
+ * so no copy of the vault is built in memory
+ *
+ * param FILE* output: The open output stream
+ * param enum transfer_format format: Format of the output
+ * param struct password** passwords: Array containing the password struct pointers, may contain tombstones
+ * param int num_passwords: The current size of the array
+ * return long: Number of exported entries or -1 if writing failed
+ */
+long export_passwords(FILE *output, const enum transfer_format format, struct password **passwords, const int num_passwords) {
+    long exported = 0;
+    if (format == TRANSFER_CSV)
+        fputs("name,username,password,folder,tags\n", output);
+    for (int i = 0; i < num_passwords; i++) {
+        const struct password *entry = passwords[i];
+        if (entry == NULL)
+            continue;
+        if (format == TRANSFER_CSV) {
+            write_csv_field(output, entry->name);
+            fputc(',', output);
+            write_csv_field(output, entry->username);
+            fputc(',', output);
+            write_csv_field(output, entry->password);
+            fputc(',', output);
+            write_csv_field(output, entry->folder ? entry->folder : "");
+            fputc(',', output);
+            write_csv_field(output, entry->tags ? entry->tags : "");
+            fputc('\n', output);
+        } else {
+            fputs("{\"name\":", output);
+            write_json_string(output, entry->name);
+            fputs(",\"username\":", output);
+            write_json_string(output, entry->username);
+            fputs(",\"password\":", output);
+            write_json_string(output, entry->password);
+            if (entry->folder) {
+                fputs(",\"folder\":", output);
+                write_json_string(output, entry->folder);
+            }
+            if (entry->tags) {
+                fputs(",\"tags\":", output);
+                write_json_string(output, entry->tags);
+            }
+            fputs("}\n", output);
+        }
+        exported++;
+    }
+    if (fflush(output) != 0 || ferror(output))
+        return -1;
+    return exported;
+}
@@ -0,0 +1,23 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "password.h"
+
+enum transfer_format {
+    TRANSFER_CSV,
+    TRANSFER_JSONL
+};
+
+bool parse_transfer_format(const char *text, enum transfer_format *format);
+bool guess_transfer_format(const char *file_name, enum transfer_format *format);
+long import_passwords(
+    FILE *input,
+    enum transfer_format format,
+    struct password ***passwords,
+    int *num_passwords,
+    long *num_skipped);
+long export_passwords(FILE *output, enum transfer_format format, struct password **passwords, int num_passwords);
+
+#endif //TRANSFER_H
@@ -0,0 +1,90 @@
+#include "commands.h"
+#include <stdio.h>
+#include <string.h>
+#include "secure_heap.h"
+#include "transfer.h"
+#include "util.h"
+
+// Stream buffer used for import and export files
+#define TRANSFER_BUFFER_SIZE (1024 * 1024)
+
+
+/*
+ * Run the import or export command on the loaded vault
+ *
+ * param int argc: Number of arguments including the command name
+ * param char* argv[]: The arguments, argv[0] is the command name
+ * param struct password*** passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param bool* modified: Set to true if the vault has to be saved
+ * return int: Exit code of the command
+ */
+int run_transfer(const int argc, char *argv[], struct password ***passwords, int *num_passwords, bool *modified) {
+    const bool is_import = strcmp(argv[0], "import") == 0;
+    const char *file_name = NULL;
+    const char *format_name = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format_name = argv[++i];
+        } else if (!file_name) {
+            file_name = argv[i];
+        } else {
+            printf("Unknown option for %s: %s\n", argv[0], argv[i]);
+            return 2;
+        }
+    }
+    if (!file_name) {
+        printf("Missing file name for %s\n", argv[0]);
+        return 2;
+    }
+
+    // The standard streams have no extension to guess the format from, they default to CSV
+    const bool is_standard_stream = strcmp(file_name, "-") == 0;
+    enum transfer_format format = TRANSFER_CSV;
+    const bool known_format = format_name ? parse_transfer_format(format_name, &format) :
+        is_standard_stream || guess_transfer_format(file_name, &format);
+    if (!known_format) {
+        printf("Unknown format, use --format csv or --format jsonl\n");
+        return 2;
+    }
+
+    // Exports hold every password in cleartext, so only the owner may read them
+    FILE *file = is_standard_stream ? (is_import ? stdin : stdout) :
+        is_import ? fopen(file_name, "rb") : create_private_file(file_name, "wb");
+    if (!file) {
+        perror("Failed to open file");
+        return 1;
+    }
+    char *buffer = NULL;
+    if (!is_standard_stream) {
+        // The stream buffer holds cleartext credentials as well
+        buffer = secure_malloc(TRANSFER_BUFFER_SIZE);
+        if (buffer)
+            setvbuf(file, buffer, _IOFBF, TRANSFER_BUFFER_SIZE);
+    }
+
+    long count;
+    long skipped = 0;
+    if (is_import) {
+        count = import_passwords(file, format, passwords, num_passwords, &skipped);
+        if (count > 0)
+            *modified = true;
+    } else {
+        count = export_passwords(file, format, *passwords, *num_passwords);
+    }
+    // Buffered output that fails to reach the file only shows up when it is closed
+    if (!is_standard_stream && fclose(file) != 0 && !is_import)
+        count = -1;
+    secure_free(buffer);
+
+    if (count < 0) {
+        printf("Failed to %s %s\n", argv[0], file_name);
+        return 1;
+    }
+    if (is_import) {
+        printf("%ld password(s) imported, %ld skipped.\n", count, skipped);
+    } else if (!is_standard_stream) {
+        printf("%ld password(s) exported.\n", count);
+    }
+    return 0;
+}
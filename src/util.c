@@ -5,6 +5,15 @@
 #include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 /*
@@ -21,10 +30,164 @@ bool file_exists(const char *path){
   return true;
 }
 
-void clear_console() {
+
+/*
+ * Move a file over another one in a single step, so readers see either the old or the new contents
+ *
+ * param const char* source: The file holding the new contents
+ * param const char* destination: The file to replace
+ * return bool: true if the file was replaced, false otherwise
+ */
+bool replace_file(const char *source, const char *destination) {
+#ifdef _WIN32
+    return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(source, destination) == 0;
+#endif
+}
+
+
+/*
+ * Create or truncate a file that only the owner may read, for output holding credentials.
+ * The permissions are set before anything is written, so the content is never readable by others
+ *
+ * param const char* path: Path of the file
+ * param const char* mode: The fopen mode, "w" or "wb"
+ * return FILE*: The open stream or NULL on failure, errno tells why
+ */
+FILE *create_private_file(const char *path, const char *mode) {
+#ifdef _WIN32
+    // Files are private to their owner by the default ACL of the profile directories
+    return fopen(path, mode);
+#else
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return NULL;
+    // An existing file keeps its mode when it is truncated
+    fchmod(fd, 0600);
+    FILE *file = fdopen(fd, mode);
+    if (!file)
+        close(fd);
+    return file;
+#endif
+}
+
+/*
+ * Match a text against a simple wildcard pattern.
+ * '*' matches any sequence of characters (including none), '?' matches exactly one character.
+ * Runs in linear time for patterns with a single '*' and never recurses.
+ *
+ * param const char* pattern: The wildcard pattern, e.g. "old-*"
+ * param const char* text: The text to test against the pattern
+ * return bool: true if the whole text matches the pattern, false otherwise
+ */
+bool pattern_matches(const char *pattern, const char *text) {
+    const char *star = NULL;
+    const char *resume = NULL;
+    while (*text) {
+        if (*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        } else if (*pattern == '?' || *pattern == *text) {
+            pattern++;
+            text++;
+        } else if (star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*')
+        pattern++;
+    return *pattern == '\0';
+}
+
+
+/*
+ * Write a string as quoted and escaped JSON string literal
+ *
+ * param FILE* stream: The open output stream
+ * param const char* text: The string to write
+ */
+void write_json_string(FILE *stream, const char *text) {
+    fputc('"', stream);
+    const unsigned char *c = (const unsigned char *) text;
+    while (*c) {
+        // Write runs of characters that need no escaping at once
+        const unsigned char *start = c;
+        while (*c >= 0x20 && *c != '"' && *c != '\\')
+            c++;
+        fwrite(start, 1, c - start, stream);
+        if (*c == '\0')
+            break;
+        switch (*c) {
+            case '"': fputs("\\\"", stream); break;
+            case '\\': fputs("\\\\", stream); break;
+            case '\n': fputs("\\n", stream); break;
+            case '\r': fputs("\\r", stream); break;
+            case '\t': fputs("\\t", stream); break;
+            default: fprintf(stream, "\\u%04x", *c);
+        }
+        c++;
+    }
+    fputc('"', stream);
+}
+
+
+/*
+ * Get the number of processors available for worker threads
+ *
+ * return int: Number of online processors, at least 1
+ */
+int available_threads(void) {
 #ifdef _WIN32
-    system("cls");
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const long count = info.dwNumberOfProcessors;
 #else
-    system("clear");
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
 #endif
-}
\ No newline at end of file
+    return count > 0 ? (int) count : 1;
+}
+
+
+/*
+ * Run a job function on several threads, falling back to the calling thread if threads cannot be created
+ *
+ * param void* (*function)(void*): The job function
+ * param void* jobs: Array of job structs
+ * param size_t job_size: Size of one job struct
+ * param int num_jobs: Number of jobs
+ */
+void run_jobs(void *(*function)(void *), void *jobs, const size_t job_size, const int num_jobs) {
+    pthread_t threads[MAX_THREADS];
+    bool started[MAX_THREADS];
+    for (int t = 1; t < num_jobs; t++) {
+        started[t] = pthread_create(&threads[t], NULL, function, (char *) jobs + t * job_size) == 0;
+        if (!started[t])
+            function((char *) jobs + t * job_size);
+    }
+    function(jobs);
+    for (int t = 1; t < num_jobs; t++) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+    }
+}
+
+
+/*
+ * Continue an FNV-1a hash over a string including its terminator, so hashing several strings
+ * in a row keeps them apart. Not suitable against adversarial input.
+ *
+ * param uint64_t hash: HASH_SEED or the hash of the preceding strings
+ * param const char* text: The string, NULL hashes like an empty string
+ * return uint64_t: The hash
+ */
+uint64_t hash_text(uint64_t hash, const char *text) {
+    const unsigned char *c = (const unsigned char *) (text ? text : "");
+    do {
+        hash = (hash ^ *c) * 1099511628211ULL;
+    } while (*c++);
+    return hash;
+}
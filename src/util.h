@@ -6,8 +6,21 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Start value of hash_text
+#define HASH_SEED 14695981039346656037ULL
+// Most threads run_jobs starts at once
+#define MAX_THREADS 64
 
 bool file_exists(const char *path);
-void clear_console();
+bool replace_file(const char *source, const char *destination);
+FILE *create_private_file(const char *path, const char *mode);
+bool pattern_matches(const char *pattern, const char *text);
+void write_json_string(FILE *stream, const char *text);
+int available_threads(void);
+void run_jobs(void *(*function)(void *), void *jobs, size_t job_size, int num_jobs);
+uint64_t hash_text(uint64_t hash, const char *text);
 
 #endif //UTIL_H
@@ -9,69 +9,219 @@
 #include <stdlib.h>
 
 #include "util.h"
+#include "login.h"
+#include "audit.h"
+#include "strength.h"
+#include "secure_heap.h"
+#include "tag_index.h"
+#include "frecency.h"
+#include "history.h"
+
+// Size of the buffers usernames and passwords are typed into, including the terminator
+#define PROMPT_SIZE 256
+
+static void print_frequent_password_names(struct password **passwords, int num_passwords);
+
+
+/*
+ * Lock the vault again after the user picked one of the listed entries. The saver may have merged
+ * commits of other processes while the user was typing, the listed numbers no longer apply then
+ *
+ * param struct autosave* saver: The saver, may be NULL
+ * param unsigned long merges: count_vault_merges when the entries were listed
+ * return bool: true with the vault locked, false with the vault unlocked if the entries changed
+ */
+static bool relock_listed_vault(struct autosave *saver, const unsigned long merges) {
+    lock_vault(saver);
+    if (count_vault_merges(saver) == merges)
+        return true;
+    unlock_vault(saver, false);
+    clear_console();
+    printf("Another process changed the vault meanwhile, please choose again.\n");
+    printf("--------------\n");
+    return false;
+}
 
-void get_password(struct password **p_passwords, const int num_passwords) {
+
+/*
+ * Tell the user a choice does not name a listed entry
+ */
+static void print_invalid_choice(void) {
+    clear_console();
+    printf("Invalid choice.\n");
+    printf("--------------\n");
+}
+
+
+/*
+ * Let the user pick an entry and show its username and password. The most frecently used entries
+ * are repeated below the full list, their access counts are saved next to the vault afterwards
+ *
+ * param struct password*** p_passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param const char* vault_path: Path of the vault file, the access file is stored next to it
+ * param const struct vault_key* vault_key: The vault key the access file is encrypted with
+ * param struct autosave* saver: Saves the vault and the access counts in the background, may be NULL
+ */
+void get_password(
+    struct password ***p_passwords,
+    int *num_passwords,
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    struct autosave *saver) {
 
     clear_console();
     printf("---Get a password ---\n");
-    list_password_names(p_passwords, &num_passwords);
-    if (num_passwords == 0) {
+    lock_vault(saver);
+    list_password_names(*p_passwords, num_passwords);
+    const int num_live = count_live_passwords(*p_passwords, *num_passwords);
+    if (num_live > 0)
+        print_frequent_password_names(*p_passwords, *num_passwords);
+    const unsigned long merges = count_vault_merges(saver);
+    unlock_vault(saver, false);
+    if (num_live == 0) {
         return;
     }
 
     int choice;
-    printf("Enter your choice (1-%d): ", num_passwords);
+    printf("Enter your choice (1-%d): ", num_live);
     int result = scanf("%d", &choice);
     if (result != 1) {
         while(getchar() != '\n'){}
-        clear_console();
-        printf("Invalid choice.\n");
-        printf("--------------\n");
+        print_invalid_choice();
         return;
     }
 
-    if (choice < 1 || choice > num_passwords) {
-        clear_console();
-        printf("Invalid choice.\n");
-        printf("--------------\n");
+    if (!relock_listed_vault(saver, merges))
+        return;
+    const int slot = find_password_slot(*p_passwords, *num_passwords, choice);
+    if (slot < 0) {
+        unlock_vault(saver, false);
+        print_invalid_choice();
         return;
     }
 
-    struct password* selected_password = p_passwords[choice - 1];
+    struct password* selected_password = (*p_passwords)[slot];
 
     printf("Username for %s: %s \n",selected_password->name, selected_password->username);
     printf("Password: %s: \n", selected_password->password);
 
+    record_access(selected_password);
+    // The saver writes the counts in the background, without one they are written right away
+    if (saver)
+        note_vault_access(saver);
+    else if (!save_access_stats(vault_path, vault_key, *p_passwords, *num_passwords))
+        printf("Failed to save the access counts\n");
+    unlock_vault(saver, false);
+}
+
+/*
+ * Check a password typed by the user against the breach corpus, the rules of its entry and the minimum
+ * strength, and print why it is refused
+ *
+ * param const char* password: The typed password
+ * param const struct password_rules* rules: The rules of the entry the password is for
+ * param const struct breach_corpus* corpus: Breach corpus to check against, may be NULL
+ * return bool: true if the password may be stored
+ */
+static bool is_acceptable_password(
+    const char *password,
+    const struct password_rules *rules,
+    const struct breach_corpus *corpus) {
+    if (is_password_breached(corpus, password)) {
+        printf("This password appears in a known data breach.\n");
+        return false;
+    }
+    if (!meets_password_rules(password, rules)) {
+        if (rules->policy)
+            printf("Password does not meet the policy %s.\n", rules->policy);
+        else
+            printf("Password does not meet the requirements.\n");
+        return false;
+    }
+    struct strength_result strength;
+    estimate_strength(password, &strength);
+    if (strength.score < rules->min_strength) {
+        printf("Password is too easy to guess (strength %d of %d, minimum %d).\n",
+            strength.score, MAX_STRENGTH_SCORE, rules->min_strength);
+        if (strength.warning)
+            printf("%s.\n", strength.warning);
+        return false;
+    }
+    return true;
 }
 
+
 void generate_and_save_password(
-    struct password **p_passwords,
+    struct password ***p_passwords,
     int *p_num_passwords,
-    const struct password_requirement *requirements) {
-    char name[256], username[256];
+    const struct password_requirement *requirements,
+    const struct breach_corpus *corpus,
+    const struct password_listener *listener,
+    struct autosave *saver) {
+    char name[256];
+    char *username = secure_malloc(PROMPT_SIZE);
+    if (!username) {
+        printf("Out of memory\n");
+        return;
+    }
     clear_console();
     printf("---Generate new password---\n");
     printf("Enter website / application name: \n");
     scanf("%255s", name);
     printf("Enter username: \n");
+    username[0] = '\0';
     scanf("%255s", username);
 
-    char *new_password = generate_password(requirements);
+    // The rules point into the requirement, which a merge may replace, so they are only used under the lock
+    lock_vault(saver);
+    // New entries are created at the top level, so only policies naming them apply
+    struct password_rules rules;
+    const struct password new_entry = {.name = name};
+    get_password_rules(requirements, &new_entry, &rules);
+    char *new_password = generate_password_with_rules(&rules);
+    // A random password showing up in a breach corpus is extremely unlikely, but never hand one out
+    while (new_password && is_password_breached(corpus, new_password)) {
+        secure_free(new_password);
+        new_password = generate_password_with_rules(&rules);
+    }
     if (!new_password) {
+        unlock_vault(saver, false);
+        secure_free(username);
         clear_console();
         printf("Failed to generate password. Ensure requirements are valid.\n");
         printf("--------------\n");
         return;
     }
+    const bool added = add_password(p_passwords, p_num_passwords, name, username, new_password, listener);
+    unlock_vault(saver, added);
     clear_console();
-    printf("Generated password: %s\n", new_password);
+    if (added)
+        printf("Generated password: %s\n", new_password);
+    else
+        printf("Out of memory, %s was not added\n", name);
     printf("--------------\n");
-    add_password(&p_passwords, p_num_passwords, name, username, new_password);
-    free(new_password);
+    secure_free(username);
+    secure_free(new_password);
 }
 
-void add_existing_password(struct password **p_passwords, int *p_num_passwords, const struct password_requirement *requirements) {
-    char name[256], username[256], password[256];
+void add_existing_password(
+    struct password ***p_passwords,
+    int *p_num_passwords,
+    const struct password_requirement *requirements,
+    const struct breach_corpus *corpus,
+    const struct password_listener *listener,
+    struct autosave *saver) {
+    char name[256];
+    // Typed credentials are cleartext, so they are read into the secure heap like every other copy
+    char *username = secure_malloc(PROMPT_SIZE);
+    char *password = secure_malloc(PROMPT_SIZE);
+    if (!username || !password) {
+        secure_free(username);
+        secure_free(password);
+        printf("Out of memory\n");
+        return;
+    }
     clear_console();
     printf("---Add existing password ---\n");
     printf("Enter website / application name: \n");
@@ -86,201 +236,451 @@ void add_existing_password(struct password **p_passwords, int *p_num_passwords,
     // Consume leftover newline character
     while (getchar() != '\n');
 
+    const struct password new_entry = {.name = name};
     while(1) {
         printf("Enter the password for this site (or leave blank to exit): \n");
+        password[0] = '\0';
         scanf("%255s", password);
 
         if (strlen(password) == 0) {
             clear_console();
             printf("No password provided. Exiting.\n");
             printf("--------------\n");
-            return;
+            break;
         }
 
-        if (is_valid_password(password, requirements)) {
-            add_password(&p_passwords, p_num_passwords, name, username, password);
-            clear_console();
-            printf("Password successfully added for %s!\n", name);
-            printf("--------------\n");
-            break; // Exit the loop after successful addition
+        // The rules point into the requirement, which a merge may replace, so they are only used under the lock
+        lock_vault(saver);
+        struct password_rules rules;
+        get_password_rules(requirements, &new_entry, &rules);
+        if (!is_acceptable_password(password, &rules, corpus)) {
+            unlock_vault(saver, false);
+            printf("Try again.\n");
+            continue;
         }
-        printf("Password does not meet the requirements. Try again.\n");
+        const bool added = add_password(p_passwords, p_num_passwords, name, username, password, listener);
+        unlock_vault(saver, added);
+        clear_console();
+        if (added)
+            printf("Password successfully added for %s!\n", name);
+        else
+            printf("Out of memory, %s was not added\n", name);
+        printf("--------------\n");
+        break; // Exit the loop after successful addition
     }
+    secure_free(username);
+    secure_free(password);
+}
+
+/*
+ * Print the name of an entry with its number, folder and tags
+ *
+ * param const struct password* entry: The entry
+ * param int ordinal: The number shown to the user
+ */
+static void print_password_name(const struct password *entry, const int ordinal) {
+    printf("[%d] %s", ordinal, entry->name);
+    if (entry->folder)
+        printf("  in %s", entry->folder);
+    if (entry->tags)
+        printf("  [%s]", entry->tags);
+    printf("\n");
 }
 
 void list_password_names(struct password** passwords, const int *num_passwords) {
-    if (*num_passwords == 0) {
+    if (count_live_passwords(passwords, *num_passwords) == 0) {
         printf("No passwords saved yet.\n");
         return;
     }
 
     printf("Available passwords:\n");
+    int ordinal = 0;
     for (int i = 0; i < *num_passwords; i++) {
-        printf("[%d] %s\n", i + 1, passwords[i]->name);
+        // Deleted entries stay as NULL tombstones until the array is compacted
+        if (passwords[i] == NULL)
+            continue;
+        print_password_name(passwords[i], ++ordinal);
     }
 }
 
-void edit_password(struct password** passwords, int num_passwords, const struct password_requirement *requirements) {
+
+/*
+ * Repeat the most frecently used entries with their ordinals, so they can be picked without scrolling
+ *
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ */
+static void print_frequent_password_names(struct password **passwords, const int num_passwords) {
+    int slots[DEFAULT_TOP_ENTRIES];
+    const int count = top_frecent_passwords(passwords, num_passwords, DEFAULT_TOP_ENTRIES, slots);
+    if (count <= 0)
+        return;
+    printf("Frequently used:\n");
+    for (int rank = 0; rank < count; rank++) {
+        int ordinal = 0;
+        for (int i = 0; i <= slots[rank]; i++)
+            ordinal += passwords[i] != NULL;
+        print_password_name(passwords[slots[rank]], ordinal);
+    }
+}
+
+
+/*
+ * Let the user pick an entry and change its username and password. The replaced password is
+ * recorded in the history next to the vault
+ *
+ * param struct password*** p_passwords: Pointer to the array containing the password struct pointers
+ * param int* num_passwords: Pointer to the current size of the array
+ * param const struct password_requirement* requirements: Requirement new passwords have to meet
+ * param const struct breach_corpus* corpus: Breach corpus new passwords are checked against, may be NULL
+ * param const char* vault_path: Path of the vault file, the history is stored next to it
+ * param const struct vault_key* vault_key: The vault key the history is encrypted with
+ * param const struct password_listener* listener: Told about the change, may be NULL
+ * param struct autosave* saver: Saves the vault in the background, may be NULL
+ */
+void edit_password(
+    struct password ***p_passwords,
+    int *num_passwords,
+    const struct password_requirement *requirements,
+    const struct breach_corpus *corpus,
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    const struct password_listener *listener,
+    struct autosave *saver) {
     clear_console();
     printf("---Edit password ---\n");
-    list_password_names(passwords, &num_passwords);
-    if (num_passwords == 0) {
+    lock_vault(saver);
+    list_password_names(*p_passwords, num_passwords);
+    const int num_live = count_live_passwords(*p_passwords, *num_passwords);
+    const unsigned long merges = count_vault_merges(saver);
+    unlock_vault(saver, false);
+    if (num_live == 0) {
         return;
     }
 
     int choice;
-    printf("Enter your choice (1-%d): ", num_passwords);
+    printf("Enter your choice (1-%d): ", num_live);
     int result = scanf("%d", &choice);
     if (result != 1) {
         while(getchar() != '\n'){}
-        clear_console();
-        printf("Invalid choice.\n");
-        printf("--------------\n");
+        print_invalid_choice();
         return;
     }
 
-    if (choice < 1 || choice > num_passwords) {
-        clear_console();
-        printf("Invalid choice.\n");
-        printf("--------------\n");
+    if (!relock_listed_vault(saver, merges))
+        return;
+    int slot = find_password_slot(*p_passwords, *num_passwords, choice);
+    if (slot < 0) {
+        unlock_vault(saver, false);
+        print_invalid_choice();
         return;
     }
 
-    struct password* selected_password = passwords[choice - 1];
+    struct password* selected_password = (*p_passwords)[slot];
 
     printf("Editing password for '%s':\n", selected_password->name);
-
-    char new_username[100];
-    char new_password[100];
-
     printf("Enter new username (or press Enter to keep '%s'): ", selected_password->username);
+    unlock_vault(saver, false);
+
+    // Typed credentials are cleartext, so they are read into the secure heap like every other copy
+    char *new_username = secure_malloc(PROMPT_SIZE);
+    char *new_password = secure_malloc(PROMPT_SIZE);
+    if (!new_username || !new_password) {
+        secure_free(new_username);
+        secure_free(new_password);
+        printf("Out of memory\n");
+        return;
+    }
+
     getchar();
-    fgets(new_username, sizeof(new_username), stdin);
+    if (!fgets(new_username, PROMPT_SIZE, stdin))
+        new_username[0] = '\0';
     new_username[strcspn(new_username, "\n")] = '\0'; // Remove trailing newline
 
     // Update username if not empty
     printf("Enter new password (or press Enter to keep the current password, or type 'generate' to generate a new password): ");
-    fgets(new_password, sizeof(new_password), stdin);
+    if (!fgets(new_password, PROMPT_SIZE, stdin))
+        new_password[0] = '\0';
     new_password[strcspn(new_password, "\n")] = '\0'; // Remove trailing newline
 
+    // The entry is only changed if it is still the one the user picked
+    if (!relock_listed_vault(saver, merges)) {
+        secure_free(new_username);
+        secure_free(new_password);
+        return;
+    }
+    slot = find_password_slot(*p_passwords, *num_passwords, choice);
+    selected_password = (*p_passwords)[slot];
+
+    // A new password has to pass the same checks as one that is added
+    struct password_rules rules;
+    get_password_rules(requirements, selected_password, &rules);
     if (strcmp(new_password, "generate") == 0) {
-        // Call a password generation function
-        char *generated_password = generate_password(requirements);
-        if (generated_password) {
-            strcpy(new_password, generated_password);
-            free(generated_password);
-        } else {
+        char *generated_password = generate_password_with_rules(&rules);
+        while (generated_password && is_password_breached(corpus, generated_password)) {
+            secure_free(generated_password);
+            generated_password = generate_password_with_rules(&rules);
+        }
+        if (!generated_password) {
+            unlock_vault(saver, false);
+            secure_free(new_username);
+            secure_free(new_password);
             printf("Password generation failed due to invalid requirements.\n");
-            free(generated_password);
             return;
         }
+        // The generated password may be longer than anything typed, it replaces the prompt buffer
+        secure_free(new_password);
+        new_password = generated_password;
+    } else if (strlen(new_password) > 0 && !is_acceptable_password(new_password, &rules, corpus)) {
+        // Keep the reason on screen instead of clearing it
+        printf("The password was not changed.\n");
+        new_password[0] = '\0';
+    } else {
+        clear_console();
     }
-    clear_console();
+    bool modified = false;
     // Update username if not empty
     if (strlen(new_username) > 0) {
-        free(selected_password->username);
-        selected_password->username = strdup(new_username);
-        printf("Successfully updated username to: '%s'\n",new_username);
+        char *username = secure_strdup(new_username);
+        if (username) {
+            secure_free(selected_password->username);
+            selected_password->username = username;
+            modified = true;
+            printf("Successfully updated username to: '%s'\n",new_username);
+        } else {
+            printf("Out of memory, the username was not changed\n");
+        }
     }
 
     // Update password if not empty
     if (strlen(new_password) > 0) {
-        free(selected_password->password);
-        selected_password->password = strdup(new_password);
-        printf("Successfully updated password to: '%s'\n",new_password);
+        char *replaced = selected_password->password;
+        char *password = secure_strdup(new_password);
+        if (password) {
+            selected_password->password = password;
+            stamp_password_change(selected_password, listener);
+            modified = true;
+            struct password_history *history = open_password_history(vault_path, vault_key);
+            if (!record_password_change(history, selected_password, replaced) || !close_password_history(history))
+                printf("Failed to record the replaced password in the history\n");
+            secure_free(replaced);
+            printf("Successfully updated password to: '%s'\n",new_password);
+        } else {
+            printf("Out of memory, the password was not changed\n");
+        }
     }
+    unlock_vault(saver, modified);
+    secure_free(new_username);
+    secure_free(new_password);
 
 
     printf("--------------\n");
 }
 
-void loop_delete_password(struct password*** passwords, int* num_passwords) {
+void loop_delete_password(
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_listener *listener,
+    struct autosave *saver) {
     clear_console();
     printf("---Delete password ---\n");
+    lock_vault(saver);
     list_password_names(*passwords, num_passwords);
-    if (num_passwords == 0) {
+    const int num_live = count_live_passwords(*passwords, *num_passwords);
+    const unsigned long merges = count_vault_merges(saver);
+    unlock_vault(saver, false);
+    if (num_live == 0) {
         return;
     }
 
-    int choice;
-    printf("Enter your choice (1-%d): ", *num_passwords);
-    const int result = scanf("%d", &choice);
+    char input[256];
+    printf("Enter your choice (1-%d) or a name pattern to delete all matches (e.g. old-*): ", num_live);
+    const int result = scanf("%255s", input);
     if (result != 1) {
         while(getchar() != '\n'){}
-        clear_console();
-        printf("Invalid choice.\n");
-        printf("--------------\n");
+        print_invalid_choice();
         return;
     }
 
-    if (choice < 1 || choice > *num_passwords) {
+    char *end;
+    const long choice = strtol(input, &end, 10);
+    if (*end != '\0') {
+        // Not a number, treat the input as a name pattern and delete all matches in one pass
+        int matches = 0;
+        lock_vault(saver);
+        for (int i = 0; i < *num_passwords; i++) {
+            if ((*passwords)[i] != NULL && password_name_matches((*passwords)[i], input))
+                matches++;
+        }
+        unlock_vault(saver, false);
+        if (matches == 0) {
+            clear_console();
+            printf("No password matches '%s'.\n", input);
+            printf("--------------\n");
+            return;
+        }
+        char confirm[8];
+        printf("Delete %d password(s) matching '%s'? (y/n): ", matches, input);
+        if (scanf("%7s", confirm) != 1 || (confirm[0] != 'y' && confirm[0] != 'Y')) {
+            clear_console();
+            printf("Nothing deleted.\n");
+            printf("--------------\n");
+            return;
+        }
+        // The pattern is matched again, so entries merged meanwhile are handled like the listed ones
+        lock_vault(saver);
+        const int deleted = delete_passwords_if(passwords, num_passwords, password_name_matches, input, listener);
+        unlock_vault(saver, deleted > 0);
         clear_console();
-        printf("Invalid choice.\n");
+        printf("%d password(s) deleted successfully.\n", deleted);
         printf("--------------\n");
         return;
     }
-    delete_password(passwords, choice - 1);
 
-    for (int i = choice; i < *num_passwords; i++) {
-        (*passwords)[i - 1] = (*passwords)[i];
+    if (!relock_listed_vault(saver, merges))
+        return;
+    const int slot = choice > num_live ? -1 : find_password_slot(*passwords, *num_passwords, (int) choice);
+    if (slot < 0) {
+        unlock_vault(saver, false);
+        print_invalid_choice();
+        return;
     }
-    (*num_passwords)--;
 
-    // Adjust the size of the array
-    *passwords = realloc(*passwords, (*num_passwords) * sizeof(struct password*));
-    if (*passwords == NULL && *num_passwords > 0) {
-        perror("Error reallocating memory");
-        exit(EXIT_FAILURE);
+    // Leave a tombstone and only compact once enough of them have accumulated
+    delete_password(passwords, slot, listener);
+    if ((*num_passwords - (num_live - 1)) * COMPACTION_RATIO >= *num_passwords) {
+        compact_passwords(*passwords, num_passwords);
     }
+    unlock_vault(saver, true);
     clear_console();
     printf("Password deleted successfully.\n");
     printf("--------------\n");
 }
 
-void update_password_requirements(struct password_requirement* req) {
-    clear_console();
-    printf("Current password requirements:\n");
+/*
+ * Print the fields of a password requirement the menu can change
+ *
+ * param const struct password_requirement* req: The requirement
+ */
+static void print_password_requirements(const struct password_requirement *req) {
     printf("1. Minimum length: %d\n", req->length);
     printf("2. Minimum uppercase letters: %d\n", req->uppercased);
     printf("3. Minimum digits: %d\n", req->digits);
     printf("4. Minimum special characters: %d\n", req->special_characters);
+    printf("5. Minimum strength score (0-%d): %d\n", MAX_STRENGTH_SCORE, req->min_strength);
+}
 
-    printf("\nEnter new requirements (enter -1 to keep current value):\n");
+void update_password_requirements(struct password_requirement* req, struct autosave *saver) {
+    clear_console();
+    printf("Current password requirements:\n");
+    lock_vault(saver);
+    print_password_requirements(req);
+    unlock_vault(saver, false);
 
-    int new_value;
+    printf("\nEnter new requirements (enter -1 to keep current value):\n");
 
-    // Update minimum length
+    // The values are read first and applied together, a merge may replace the requirement meanwhile
+    int length = -1, uppercased = -1, digits = -1, special_characters = -1, min_strength = -1;
     printf("1. Minimum length: ");
-    scanf("%d", &new_value);
-    if (new_value >= 0) {
-        req->length = new_value;
+    scanf("%d", &length);
+    printf("2. Minimum uppercase letters: ");
+    scanf("%d", &uppercased);
+    printf("3. Minimum digits: ");
+    scanf("%d", &digits);
+    printf("4. Minimum special characters: ");
+    scanf("%d", &special_characters);
+    printf("5. Minimum strength score (0-%d): ", MAX_STRENGTH_SCORE);
+    scanf("%d", &min_strength);
+
+    lock_vault(saver);
+    if (length >= 0) {
+        req->length = length;
+    }
+    if (uppercased >= 0) {
+        req->uppercased = uppercased;
+    }
+    if (digits >= 0) {
+        req->digits = digits;
+    }
+    if (special_characters >= 0) {
+        req->special_characters = special_characters;
     }
+    if (min_strength >= 0 && min_strength <= MAX_STRENGTH_SCORE) {
+        req->min_strength = min_strength;
+    }
+    clear_console();
+    printf("\nUpdated password requirements:\n");
+    print_password_requirements(req);
+    unlock_vault(saver, true);
+    printf("--------------\n");
+}
 
-    // Update minimum uppercase letters
-    printf("2. Minimum uppercase letters: ");
-    scanf("%d", &new_value);
-    if (new_value >= 0) {
-        req->uppercased = new_value;
+void audit_passwords(
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_requirement *requirements,
+    struct autosave *saver) {
+    clear_console();
+    printf("---Password audit ---\n");
+    lock_vault(saver);
+    struct reuse_report report;
+    if (!find_reused_passwords(*passwords, *num_passwords, true, &report)) {
+        unlock_vault(saver, false);
+        printf("Failed to search for reused passwords.\n");
+        printf("--------------\n");
+        return;
     }
+    print_audit_report(stdout, *passwords, *num_passwords, requirements, &report);
+    free_reuse_report(&report);
+    unlock_vault(saver, false);
+    printf("--------------\n");
+}
 
-    // Update minimum digits
-    printf("3. Minimum digits: ");
-    scanf("%d", &new_value);
-    if (new_value >= 0) {
-        req->digits = new_value;
+void search_passwords(struct password ***p_passwords, int *p_num_passwords, struct autosave *saver) {
+    char query[1024];
+    clear_console();
+    printf("---Search passwords ---\n");
+    printf("Enter a query, e.g. tag:prod AND folder:work NOT tag:legacy: \n");
+    while (getchar() != '\n') {}
+    if (!fgets(query, sizeof(query), stdin))
+        return;
+
+    lock_vault(saver);
+    struct password **passwords = *p_passwords;
+    const int num_passwords = *p_num_passwords;
+    struct tag_index index;
+    struct bitmap matches;
+    bitmap_init(&matches);
+    const char *error = NULL;
+    if (!build_tag_index(passwords, num_passwords, &index)) {
+        unlock_vault(saver, false);
+        printf("Failed to index the passwords.\n");
+        printf("--------------\n");
+        return;
+    }
+    const bool ok = run_tag_query(&index, passwords, num_passwords, query, &matches, &error);
+    free_tag_index(&index);
+    if (!ok) {
+        unlock_vault(saver, false);
+        printf("Invalid query: %s\n", error);
+        printf("--------------\n");
+        return;
     }
 
-    // Update minimum special characters
-    printf("4. Minimum special characters: ");
-    scanf("%d", &new_value);
-    if (new_value >= 0) {
-        req->special_characters = new_value;
+    // Show the same numbers as the full list, so a match can be opened with "Get a password"
+    int ordinal = 0;
+    uint64_t found = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] == NULL)
+            continue;
+        ordinal++;
+        if (bitmap_contains(&matches, (uint32_t) i)) {
+            print_password_name(passwords[i], ordinal);
+            found++;
+        }
     }
-    clear_console();
-    printf("\nUpdated password requirements:\n");
-    printf("1. Minimum length: %d\n", req->length);
-    printf("2. Minimum uppercase letters: %d\n", req->uppercased);
-    printf("3. Minimum digits: %d\n", req->digits);
-    printf("4. Minimum special characters: %d\n", req->special_characters);
+    unlock_vault(saver, false);
+    bitmap_free(&matches);
+    printf("%llu password(s) found.\n", (unsigned long long) found);
     printf("--------------\n");
 }
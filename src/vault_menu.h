@@ -5,17 +5,52 @@
 #ifndef VAULT_MENU_H
 #define VAULT_MENU_H
 
+#include "crypto.h"
 #include "password.h"
+#include "breach.h"
+#include "autosave.h"
 
 void generate_and_save_password(
-    struct password **p_passwords,
+    struct password ***p_passwords,
     int *p_num_passwords,
-    const struct password_requirement *requirements);
-void add_existing_password(struct password **p_passwords, int *p_num_passwords, const struct password_requirement *requirements);
-void get_password(struct password **p_passwords, const int num_passwords);
+    const struct password_requirement *requirements,
+    const struct breach_corpus *corpus,
+    const struct password_listener *listener,
+    struct autosave *saver);
+void add_existing_password(
+    struct password ***p_passwords,
+    int *p_num_passwords,
+    const struct password_requirement *requirements,
+    const struct breach_corpus *corpus,
+    const struct password_listener *listener,
+    struct autosave *saver);
+void get_password(
+    struct password ***p_passwords,
+    int *num_passwords,
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    struct autosave *saver);
 void list_password_names(struct password** passwords, const int *num_passwords);
-void edit_password(struct password** passwords, int num_passwords, const struct password_requirement *requirements);
-void loop_delete_password(struct password*** passwords, int* num_passwords);
-void update_password_requirements(struct password_requirement* req);
+void edit_password(
+    struct password ***p_passwords,
+    int *num_passwords,
+    const struct password_requirement *requirements,
+    const struct breach_corpus *corpus,
+    const char *vault_path,
+    const struct vault_key *vault_key,
+    const struct password_listener *listener,
+    struct autosave *saver);
+void loop_delete_password(
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_listener *listener,
+    struct autosave *saver);
+void update_password_requirements(struct password_requirement* req, struct autosave *saver);
+void audit_passwords(
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_requirement *requirements,
+    struct autosave *saver);
+void search_passwords(struct password ***p_passwords, int *p_num_passwords, struct autosave *saver);
 
 #endif //VAULT_MENU_H
@@ -0,0 +1,545 @@
+#include "vault_store.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crypto.h"
+#include "secure_heap.h"
+#include "util.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct vault_file_lock {
+#ifdef _WIN32
+    HANDLE file;
+#else
+    int fd;
+#endif
+};
+
+// An entry digest together with the array slot of the entry
+struct keyed_entry {
+    struct entry_digest digest;
+    int slot;
+};
+
+
+/*
+ * Append a suffix to a path
+ *
+ * param const char* path: The path
+ * param const char* suffix: The suffix, e.g. ".tmp"
+ * return char*: The new path that has to be freed, NULL if memory ran out
+ */
+static char *path_with_suffix(const char *path, const char *suffix) {
+    const size_t path_length = strlen(path);
+    const size_t suffix_length = strlen(suffix);
+    char *result = malloc(path_length + suffix_length + 1);
+    if (result) {
+        memcpy(result, path, path_length);
+        memcpy(result + path_length, suffix, suffix_length + 1);
+    }
+    return result;
+}
+
+
+/*
+ * Compute the digest of an entry
+ *
+ * param const struct password* entry: The entry
+ * return struct entry_digest: Digest of the name and digest of all other fields
+ */
+static struct entry_digest digest_entry(const struct password *entry) {
+    struct entry_digest digest;
+    digest.name = hash_text(HASH_SEED, entry->name);
+    digest.contents = hash_text(hash_text(hash_text(HASH_SEED, entry->username), entry->password),
+        entry->previous_password);
+    digest.contents = hash_text(hash_text(digest.contents, entry->folder), entry->tags);
+    digest.contents = hash_text(digest.contents, entry->attachments);
+    digest.contents = (digest.contents ^ (uint64_t) entry->created) * 1099511628211ULL;
+    digest.contents = (digest.contents ^ (uint64_t) entry->changed) * 1099511628211ULL;
+    return digest;
+}
+
+
+/*
+ * Compute the digest of a password requirement over its serialized lines, so every field
+ * that is stored in the vault file, including the maximum age and the policies, is covered
+ *
+ * param const struct password_requirement* requirement: The requirement
+ * param uint64_t* digest: Receives the digest
+ * return bool: false if memory ran out
+ */
+static bool digest_requirement(const struct password_requirement *requirement, uint64_t *digest) {
+    char *serialized = get_password_requirement(requirement);
+    if (!serialized)
+        return false;
+    *digest = hash_text(HASH_SEED, serialized);
+    secure_free(serialized);
+    return true;
+}
+
+
+/*
+ * Order keyed entries by name digest and slot
+ */
+static int compare_keyed_entries(const void *a, const void *b) {
+    const struct keyed_entry *first = a;
+    const struct keyed_entry *second = b;
+    if (first->digest.name != second->digest.name)
+        return first->digest.name < second->digest.name ? -1 : 1;
+    return (first->slot > second->slot) - (first->slot < second->slot);
+}
+
+
+/*
+ * Compute the digests of all live entries, sorted by name digest
+ *
+ * param struct password** passwords: Array containing the password struct pointers
+ * param int num_passwords: The current size of the array
+ * param int* num_keyed: Receives the number of digests
+ * return struct keyed_entry*: The digests on the secure heap, NULL if memory ran out
+ */
+static struct keyed_entry *key_entries(struct password **passwords, const int num_passwords, int *num_keyed) {
+    struct keyed_entry *keyed = secure_malloc(((size_t) num_passwords + 1) * sizeof(struct keyed_entry));
+    if (!keyed)
+        return NULL;
+    int count = 0;
+    for (int slot = 0; slot < num_passwords; slot++) {
+        if (passwords[slot] == NULL)
+            continue;
+        keyed[count].digest = digest_entry(passwords[slot]);
+        keyed[count].slot = slot;
+        count++;
+    }
+    qsort(keyed, count, sizeof(struct keyed_entry), compare_keyed_entries);
+    *num_keyed = count;
+    return keyed;
+}
+
+
+/*
+ * Replace the base with the given sorted digests
+ *
+ * param struct vault_base* base: The base
+ * param uint64_t version: The vault version the digests belong to
+ * param uint64_t requirement: Digest of the password requirement
+ * param const struct keyed_entry* keyed: The sorted entry digests
+ * param int num_keyed: Number of digests
+ * return bool: false if memory ran out, the base is unchanged then
+ */
+static bool set_vault_base(
+    struct vault_base *base,
+    const uint64_t version,
+    const uint64_t requirement,
+    const struct keyed_entry *keyed,
+    const int num_keyed) {
+    struct entry_digest *entries = secure_malloc(((size_t) num_keyed + 1) * sizeof(struct entry_digest));
+    if (!entries)
+        return false;
+    for (int i = 0; i < num_keyed; i++)
+        entries[i] = keyed[i].digest;
+    secure_free(base->entries);
+    base->entries = entries;
+    base->num_entries = num_keyed;
+    base->version = version;
+    base->requirement = requirement;
+    return true;
+}
+
+
+/*
+ * Remember the state of the vault as it is stored in the vault file
+ *
+ * param struct vault_base* base: The base to replace, zero initialized before the first call
+ * param uint64_t version: The version of the vault file
+ * param const struct password_requirement* requirement: The password requirement in the file
+ * param struct password** passwords: Array containing the password struct pointers as in the file
+ * param int num_passwords: The current size of the array
+ * return bool: false if memory ran out, the base is unchanged then
+ */
+bool record_vault_base(
+    struct vault_base *base,
+    const uint64_t version,
+    const struct password_requirement *requirement,
+    struct password **passwords,
+    const int num_passwords) {
+    int num_keyed = 0;
+    struct keyed_entry *keyed = key_entries(passwords, num_passwords, &num_keyed);
+    if (!keyed)
+        return false;
+    uint64_t requirement_digest = 0;
+    const bool recorded = digest_requirement(requirement, &requirement_digest) &&
+        set_vault_base(base, version, requirement_digest, keyed, num_keyed);
+    secure_free(keyed);
+    return recorded;
+}
+
+
+/*
+ * Release the digests of a base
+ *
+ * param struct vault_base* base: The base
+ */
+void free_vault_base(struct vault_base *base) {
+    secure_free(base->entries);
+    base->entries = NULL;
+    base->num_entries = 0;
+}
+
+
+/*
+ * Open the lock file of a vault and lock it exclusively
+ *
+ * param const char* path: Path of the vault file
+ * param bool wait: Wait for another holder to release the lock instead of failing
+ * return struct vault_file_lock*: The lock, NULL if the lock file could not be opened or locked
+ */
+static struct vault_file_lock *acquire_vault_file_lock(const char *path, const bool wait) {
+    char *lock_path = path_with_suffix(path, ".lock");
+    struct vault_file_lock *lock = malloc(sizeof(struct vault_file_lock));
+    if (!lock_path || !lock) {
+        free(lock_path);
+        free(lock);
+        return NULL;
+    }
+#ifdef _WIN32
+    lock->file = CreateFileA(lock_path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    free(lock_path);
+    OVERLAPPED overlapped = {0};
+    const DWORD flags = LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+    if (lock->file == INVALID_HANDLE_VALUE || !LockFileEx(lock->file, flags, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+        if (lock->file != INVALID_HANDLE_VALUE)
+            CloseHandle(lock->file);
+        free(lock);
+        return NULL;
+    }
+#else
+    lock->fd = open(lock_path, O_RDWR | O_CREAT, 0600);
+    free(lock_path);
+    struct flock region = {0};
+    region.l_type = F_WRLCK;
+    region.l_whence = SEEK_SET;
+#ifdef F_OFD_SETLKW
+    // Open file description locks also keep apart two handles of the same process
+    const int command = wait ? F_OFD_SETLKW : F_OFD_SETLK;
+#else
+    const int command = wait ? F_SETLKW : F_SETLK;
+#endif
+    int result = lock->fd < 0 ? -1 : fcntl(lock->fd, command, &region);
+    while (result == -1 && errno == EINTR)
+        result = fcntl(lock->fd, command, &region);
+    if (result == -1) {
+        if (lock->fd >= 0)
+            close(lock->fd);
+        free(lock);
+        return NULL;
+    }
+#endif
+    return lock;
+}
+
+
+/*
+ * Take the exclusive lock that serializes commits to a vault file. It is held on "<path>.lock"
+ * instead of the vault itself, because every commit replaces the vault file. Readers never take it:
+ * a commit moves a complete new file into place, so opening the vault always yields a consistent snapshot.
+ *
+ * param const char* path: Path of the vault file
+ * return struct vault_file_lock*: The lock, NULL if the lock file could not be opened or locked
+ */
+struct vault_file_lock *lock_vault_file(const char *path) {
+    return acquire_vault_file_lock(path, true);
+}
+
+
+/*
+ * Take the lock of lock_vault_file only if no other commit holds it right now
+ *
+ * param const char* path: Path of the vault file
+ * return struct vault_file_lock*: The lock, NULL if it is held elsewhere or the lock file could not be opened
+ */
+struct vault_file_lock *try_lock_vault_file(const char *path) {
+    return acquire_vault_file_lock(path, false);
+}
+
+
+/*
+ * Release a lock taken with lock_vault_file or try_lock_vault_file
+ *
+ * param struct vault_file_lock* lock: The lock, may be NULL
+ */
+void unlock_vault_file(struct vault_file_lock *lock) {
+    if (!lock)
+        return;
+#ifdef _WIN32
+    OVERLAPPED overlapped = {0};
+    UnlockFileEx(lock->file, 0, MAXDWORD, MAXDWORD, &overlapped);
+    CloseHandle(lock->file);
+#else
+    // Closing the descriptor releases the lock
+    close(lock->fd);
+#endif
+    free(lock);
+}
+
+
+/*
+ * Check whether two digests describe the same state of an entry, NULL standing for a missing entry
+ */
+static bool same_state(const struct entry_digest *first, const struct entry_digest *second) {
+    if (!first || !second)
+        return first == second;
+    return first->contents == second->contents;
+}
+
+
+/*
+ * Scramble the contents digest of one entry of a group of entries sharing a name. Summing the
+ * scrambled digests gives a digest of the group that does not depend on the order of the entries.
+ */
+static uint64_t scramble_contents(uint64_t contents) {
+    contents = (contents ^ (contents >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    contents = (contents ^ (contents >> 27)) * 0x94d049bb133111ebULL;
+    return contents ^ (contents >> 31);
+}
+
+
+/*
+ * Three-way merge of the entries by name. An entry only changed by the other process is taken over,
+ * an entry changed by both processes in different ways is a conflict. Entries of the same name,
+ * which older vaults may hold, cannot be told apart, so such a group is kept as it is in memory if the
+ * vault file still has it as in the base or has it alike, and is a conflict otherwise.
+ *
+ * param const struct vault_base* base: The common base of both sides
+ * param const struct keyed_entry* mine: Sorted digests of the in-memory entries
+ * param int num_mine: Number of in-memory digests
+ * param const struct keyed_entry* theirs: Sorted digests of the entries in the vault file
+ * param int num_theirs: Number of vault file digests
+ * param struct password** their_passwords: The entries of the vault file, taken over entries are moved out
+ * param struct password*** passwords: Pointer to the in-memory array
+ * param int* num_passwords: Pointer to the current size of the in-memory array
+ * param bool apply: false to only check for conflicts, true to change the in-memory entries
+ * param const struct password_listener* listener: Told about the entries taken over, may be NULL
+ * return bool: false on a conflict when checking, or if memory ran out when applying
+ */
+static bool merge_entries(
+    const struct vault_base *base,
+    const struct keyed_entry *mine,
+    const int num_mine,
+    const struct keyed_entry *theirs,
+    const int num_theirs,
+    struct password **their_passwords,
+    struct password ***passwords,
+    int *num_passwords,
+    const bool apply,
+    const struct password_listener *listener) {
+    int i = 0, j = 0, k = 0;
+    while (i < num_mine || j < num_theirs || k < base->num_entries) {
+        // Visit the smallest name digest of the three sorted lists
+        uint64_t name = UINT64_MAX;
+        if (i < num_mine && mine[i].digest.name < name)
+            name = mine[i].digest.name;
+        if (j < num_theirs && theirs[j].digest.name < name)
+            name = theirs[j].digest.name;
+        if (k < base->num_entries && base->entries[k].name < name)
+            name = base->entries[k].name;
+        const int my_first = i, their_first = j, base_first = k;
+        uint64_t my_group = 0, their_group = 0, base_group = 0;
+        for (; i < num_mine && mine[i].digest.name == name; i++)
+            my_group += scramble_contents(mine[i].digest.contents);
+        for (; j < num_theirs && theirs[j].digest.name == name; j++)
+            their_group += scramble_contents(theirs[j].digest.contents);
+        for (; k < base->num_entries && base->entries[k].name == name; k++)
+            base_group += scramble_contents(base->entries[k].contents);
+        if (i - my_first > 1 || j - their_first > 1 || k - base_first > 1) {
+            const bool unchanged = (j - their_first == k - base_first && their_group == base_group) ||
+                (i - my_first == j - their_first && my_group == their_group);
+            if (!unchanged && !apply)
+                return false;
+            continue;
+        }
+
+        const struct keyed_entry *my_entry = i > my_first ? &mine[my_first] : NULL;
+        const struct keyed_entry *their_entry = j > their_first ? &theirs[their_first] : NULL;
+        const struct entry_digest *base_entry = k > base_first ? &base->entries[base_first] : NULL;
+        const struct entry_digest *my_digest = my_entry ? &my_entry->digest : NULL;
+        const struct entry_digest *their_digest = their_entry ? &their_entry->digest : NULL;
+
+        if (same_state(my_digest, their_digest) || same_state(their_digest, base_entry))
+            continue;
+        if (!same_state(my_digest, base_entry)) {
+            if (!apply)
+                return false;
+            continue;
+        }
+        if (!apply)
+            continue;
+
+        // Only the other process changed this entry, take over its state
+        if (!their_entry) {
+            delete_password(passwords, my_entry->slot, listener);
+        } else if (!my_entry) {
+            struct password *entry = their_passwords[their_entry->slot];
+            if (!add_password(passwords, num_passwords, entry->name, entry->username, entry->password, listener))
+                return false;
+            struct password *added = (*passwords)[*num_passwords - 1];
+            added->previous_password = entry->previous_password;
+            added->folder = entry->folder;
+            added->tags = entry->tags;
+            added->attachments = entry->attachments;
+            entry->previous_password = entry->folder = entry->tags = entry->attachments = NULL;
+            added->created = entry->created;
+            added->changed = entry->changed;
+            report_password_change(listener, added, PASSWORD_CHANGED);
+        } else {
+            struct password *entry = (*passwords)[my_entry->slot];
+            report_password_change(listener, entry, PASSWORD_REMOVED);
+            (*passwords)[my_entry->slot] = their_passwords[their_entry->slot];
+            their_passwords[their_entry->slot] = entry;
+            report_password_change(listener, (*passwords)[my_entry->slot], PASSWORD_ADDED);
+        }
+    }
+    return true;
+}
+
+
+/*
+ * Merge the changes other processes committed since the base into the in-memory vault.
+ * Has to be called with the lock of lock_vault_file held. Afterwards the base describes the
+ * current vault file.
+ *
+ * param const char* path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * param struct vault_base* base: The base of the in-memory vault
+ * param struct password_requirement* requirement: The in-memory password requirement
+ * param struct password*** passwords: Pointer to the in-memory array
+ * param int* num_passwords: Pointer to the current size of the in-memory array
+ * param const struct password_listener* listener: Told about the entries taken over, may be NULL
+ * return enum commit_status: COMMIT_CONFLICT if both changed the same entry, nothing is changed then
+ */
+enum commit_status merge_vault_changes(
+    const char *path,
+    const struct vault_key *vault_key,
+    struct vault_base *base,
+    struct password_requirement *requirement,
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_listener *listener) {
+    // The header is plaintext, so the common case of no concurrent commit costs no decryption
+    if (read_vault_version(path) == base->version)
+        return COMMIT_OK;
+
+    char *cleartext = NULL;
+    uint64_t version = 0;
+    if (!decrypt_file(path, &cleartext, vault_key, &version))
+        return COMMIT_FAILED;
+    struct password_requirement *their_requirement = read_password_requirement(cleartext);
+    int num_their_passwords = 0;
+    struct password **their_passwords = read_passwords(cleartext, &num_their_passwords);
+    secure_free(cleartext);
+
+    int num_mine = 0, num_theirs = 0;
+    struct keyed_entry *mine = key_entries(*passwords, *num_passwords, &num_mine);
+    struct keyed_entry *theirs = their_passwords ? key_entries(their_passwords, num_their_passwords, &num_theirs) : NULL;
+
+    enum commit_status status = COMMIT_FAILED;
+    uint64_t my_requirement = 0, new_base_requirement = 0;
+    if (their_requirement && mine && theirs && digest_requirement(requirement, &my_requirement) &&
+        digest_requirement(their_requirement, &new_base_requirement)) {
+        const uint64_t old_base_requirement = base->requirement;
+        const bool requirement_conflict = my_requirement != new_base_requirement &&
+            new_base_requirement != old_base_requirement && my_requirement != old_base_requirement;
+        if (requirement_conflict || !merge_entries(base, mine, num_mine, theirs, num_theirs, their_passwords,
+                passwords, num_passwords, false, NULL)) {
+            status = COMMIT_CONFLICT;
+        } else if (merge_entries(base, mine, num_mine, theirs, num_theirs, their_passwords, passwords, num_passwords,
+                true, listener) &&
+            set_vault_base(base, version, new_base_requirement, theirs, num_theirs)) {
+            if (my_requirement == old_base_requirement) {
+                // Swap, so the policies of the replaced requirement are freed with theirs
+                const struct password_requirement replaced = *requirement;
+                *requirement = *their_requirement;
+                *their_requirement = replaced;
+            }
+            status = COMMIT_OK;
+        }
+    }
+
+    secure_free(mine);
+    secure_free(theirs);
+    free_passwords(their_passwords, num_their_passwords);
+    free(their_passwords);
+    free_password_requirement(their_requirement);
+    return status;
+}
+
+
+/*
+ * Encrypt the cleartext into a temporary file and move it over the vault file
+ *
+ * param const char* path: Path of the vault file
+ * param char** cleartext: Pointer to the serialized vault
+ * param const struct vault_key* vault_key: The vault key
+ * param uint64_t version: The new vault version
+ * return bool: true if the vault file was replaced
+ */
+bool write_vault(const char *path, char **cleartext, const struct vault_key *vault_key, const uint64_t version) {
+    char *temporary_path = path_with_suffix(path, ".tmp");
+    if (!temporary_path)
+        return false;
+    const bool written = encrypt_file(temporary_path, cleartext, vault_key, version) &&
+        replace_file(temporary_path, path);
+    if (!written)
+        remove(temporary_path);
+    free(temporary_path);
+    return written;
+}
+
+
+/*
+ * Optimistically commit the in-memory vault: merge what other processes committed since the base,
+ * then write the result as the next version. Only commits wait for each other, readers never do.
+ *
+ * param const char* path: Path of the vault file
+ * param const struct vault_key* vault_key: The vault key
+ * param struct vault_base* base: The base of the in-memory vault, describes the written file afterwards
+ * param struct password_requirement* requirement: The in-memory password requirement
+ * param struct password*** passwords: Pointer to the in-memory array
+ * param int* num_passwords: Pointer to the current size of the in-memory array
+ * param const struct password_listener* listener: Told about the entries taken over, may be NULL
+ * return enum commit_status: COMMIT_OK, COMMIT_CONFLICT or COMMIT_FAILED
+ */
+enum commit_status commit_vault(
+    const char *path,
+    const struct vault_key *vault_key,
+    struct vault_base *base,
+    struct password_requirement *requirement,
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_listener *listener) {
+    struct vault_file_lock *lock = lock_vault_file(path);
+    if (!lock)
+        return COMMIT_FAILED;
+    enum commit_status status = merge_vault_changes(path, vault_key, base, requirement, passwords, num_passwords,
+        listener);
+    char *cleartext = NULL;
+    if (status == COMMIT_OK && !save_passwords_and_requirements(requirement, *passwords, num_passwords, &cleartext))
+        status = COMMIT_FAILED;
+    if (status == COMMIT_OK) {
+        const uint64_t version = base->version + 1;
+        if (!write_vault(path, &cleartext, vault_key, version))
+            status = COMMIT_FAILED;
+        else if (!record_vault_base(base, version, requirement, *passwords, *num_passwords))
+            base->version = version;
+    }
+    secure_free(cleartext);
+    unlock_vault_file(lock);
+    return status;
+}
@@ -0,0 +1,60 @@
+#ifndef VAULT_STORE_H
+#define VAULT_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "crypto.h"
+#include "password.h"
+
+enum commit_status {
+    COMMIT_OK,
+    COMMIT_CONFLICT, // Another process changed the same entries, nothing was written
+    COMMIT_FAILED
+};
+
+// Digest of an entry as it is stored in the vault file
+struct entry_digest {
+    uint64_t name;
+    uint64_t contents;
+};
+
+// The vault file version the in-memory vault was loaded from or last committed as.
+// Commits compare it with the file to find out what other processes changed meanwhile.
+struct vault_base {
+    uint64_t version;
+    uint64_t requirement;
+    struct entry_digest *entries; // Sorted by name digest, on the secure heap
+    int num_entries;
+};
+
+struct vault_file_lock;
+
+bool record_vault_base(
+    struct vault_base *base,
+    uint64_t version,
+    const struct password_requirement *requirement,
+    struct password **passwords,
+    int num_passwords);
+void free_vault_base(struct vault_base *base);
+struct vault_file_lock *lock_vault_file(const char *path);
+struct vault_file_lock *try_lock_vault_file(const char *path);
+void unlock_vault_file(struct vault_file_lock *lock);
+enum commit_status merge_vault_changes(
+    const char *path,
+    const struct vault_key *vault_key,
+    struct vault_base *base,
+    struct password_requirement *requirement,
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_listener *listener);
+bool write_vault(const char *path, char **cleartext, const struct vault_key *vault_key, uint64_t version);
+enum commit_status commit_vault(
+    const char *path,
+    const struct vault_key *vault_key,
+    struct vault_base *base,
+    struct password_requirement *requirement,
+    struct password ***passwords,
+    int *num_passwords,
+    const struct password_listener *listener);
+
+#endif //VAULT_STORE_H
@@ -0,0 +1,512 @@
+#include "workload.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "password.h"
+#include "secure_heap.h"
+#include "strength.h"
+#include "vault_menu.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define fileno _fileno
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+// Longest line of a trace file
+#define TRACE_LINE_SIZE 128
+// Longest scripted input of one operation
+#define SCRIPT_SIZE 512
+// Seed of the entry choices, the same trace always picks the same entries
+#define REPLAY_SEED 0x9E3779B97F4A7C15ull
+
+struct trace_recorder {
+    FILE *file;
+    struct timespec started;
+};
+
+// Latencies of one kind of operation
+struct latency_samples {
+    double *ms;
+    int count;
+    int capacity;
+};
+
+// Synthetic vault a trace runs against
+struct replay_vault {
+    struct password **passwords;
+    int num_passwords;
+    struct password_requirement *requirement;
+    char *path;    // Side files such as the access counts and the history are written next to it
+    uint64_t random;
+    int added;     // Entries added by the trace so far, keeps their names unique
+};
+
+static const char *operation_names[NUM_MENU_OPERATIONS] = {
+    NULL, "get", "generate", "add", "edit", "delete", "requirements", "audit", "search"
+};
+
+// Side files the menu operations may create next to the synthetic vault
+static const char *side_file_suffixes[] = {
+    ".access", ".access.lock", ".access.tmp", ".history", ".history.lock", ".history.tmp", ".script"
+};
+
+// The synthetic vault is not secret, its files are encrypted with this fixed key
+static const struct vault_key replay_vault_key = {{0}, {0}};
+
+
+/*
+ * Get the name of a menu operation as written to trace files
+ *
+ * param int operation: The menu option
+ * return const char*: The name, NULL for options that are not traced
+ */
+const char *menu_operation_name(const int operation) {
+    return operation > 0 && operation < NUM_MENU_OPERATIONS ? operation_names[operation] : NULL;
+}
+
+
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return 1000.0 * (double) (now.tv_sec - since->tv_sec) + (double) (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+
+/*
+ * Start recording the operations of a menu session. Traces only hold the menu option, the time
+ * it was chosen and the number of entries, never names, usernames or passwords
+ *
+ * param const char* path: The trace file, sessions are appended to it. NULL or empty disables the recording
+ * return struct trace_recorder*: The recorder, NULL if nothing is recorded
+ */
+struct trace_recorder *open_trace_recorder(const char *path) {
+    if (!path || !*path)
+        return NULL;
+    struct trace_recorder *recorder = malloc(sizeof(struct trace_recorder));
+    if (!recorder)
+        return NULL;
+    recorder->file = fopen(path, "a");
+    if (!recorder->file) {
+        free(recorder);
+        return NULL;
+    }
+    fseek(recorder->file, 0, SEEK_END);
+    if (ftell(recorder->file) == 0)
+        fprintf(recorder->file, "%s\n", TRACE_HEADER);
+    fprintf(recorder->file, "session %lld\n", (long long) time(NULL));
+    fflush(recorder->file);
+    timespec_get(&recorder->started, TIME_UTC);
+    return recorder;
+}
+
+
+/*
+ * Append an operation to the trace. Every line is flushed, so a crashed session keeps its trace
+ *
+ * param struct trace_recorder* recorder: The recorder, may be NULL
+ * param int operation: The chosen menu option, options that are not traced are ignored
+ * param int num_live: Number of entries in the vault when the option was chosen
+ */
+void record_operation(struct trace_recorder *recorder, const int operation, const int num_live) {
+    const char *name = menu_operation_name(operation);
+    if (!recorder || !name)
+        return;
+    fprintf(recorder->file, "%s %.0f %d\n", name, elapsed_ms(&recorder->started), num_live);
+    fflush(recorder->file);
+}
+
+
+void close_trace_recorder(struct trace_recorder *recorder) {
+    if (!recorder)
+        return;
+    fclose(recorder->file);
+    free(recorder);
+}
+
+
+/*
+ * Read the operations of all sessions of a trace file
+ *
+ * param const char* path: The trace file
+ * param int* count: Receives the number of operations
+ * return int*: The menu options in trace order, NULL if the file cannot be read or is no trace
+ */
+static int *read_trace(const char *path, int *count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        printf("Failed to open %s\n", path);
+        return NULL;
+    }
+    char line[TRACE_LINE_SIZE];
+    bool ok = fgets(line, sizeof(line), file) && strncmp(line, TRACE_HEADER, strlen(TRACE_HEADER)) == 0;
+    if (!ok)
+        printf("%s is no C-Pass trace\n", path);
+    int *operations = NULL;
+    int capacity = 0;
+    *count = 0;
+    for (int number = 2; ok && fgets(line, sizeof(line), file); number++) {
+        const size_t length = strcspn(line, " \n");
+        if (length == strlen("session") && strncmp(line, "session", length) == 0)
+            continue;
+        int operation = 1;
+        while (operation < NUM_MENU_OPERATIONS &&
+               !(strlen(operation_names[operation]) == length && strncmp(line, operation_names[operation], length) == 0))
+            operation++;
+        if (operation == NUM_MENU_OPERATIONS) {
+            printf("Unknown operation in line %d of %s\n", number, path);
+            ok = false;
+            break;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? 2 * capacity : DEFAULT_CAPACITY;
+            int *grown = realloc(operations, capacity * sizeof(int));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            operations = grown;
+        }
+        operations[(*count)++] = operation;
+    }
+    fclose(file);
+    if (!ok) {
+        free(operations);
+        return NULL;
+    }
+    return operations;
+}
+
+
+/*
+ * Draw the next number of the entry choices (xorshift64*)
+ */
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+
+static char *path_with_suffix(const char *path, const char *suffix) {
+    const size_t length = strlen(path);
+    char *result = malloc(length + strlen(suffix) + 1);
+    if (result) {
+        memcpy(result, path, length);
+        strcpy(result + length, suffix);
+    }
+    return result;
+}
+
+
+static void remove_side_files(const char *vault_path) {
+    for (size_t i = 0; i < sizeof(side_file_suffixes) / sizeof(side_file_suffixes[0]); i++) {
+        char *path = path_with_suffix(vault_path, side_file_suffixes[i]);
+        if (path)
+            remove(path);
+        free(path);
+    }
+}
+
+
+/*
+ * Fill a synthetic vault with generated entries. Every tenth entry is tagged prod and every
+ * fourth lies in a folder, so searches have something to find
+ *
+ * param struct replay_vault* vault: The vault, its requirement has to be set
+ * param int size: Number of entries
+ * return bool: false if memory ran out
+ */
+static bool fill_replay_vault(struct replay_vault *vault, const int size) {
+    // add_password grows the array once its size reaches a power of two, starting at DEFAULT_CAPACITY
+    vault->passwords = calloc(DEFAULT_CAPACITY, sizeof(struct password *));
+    char **generated = vault->passwords ? generate_passwords(vault->requirement, size) : NULL;
+    if (!generated)
+        return false;
+    bool ok = true;
+    for (int i = 0; i < size; i++) {
+        char name[32], username[32];
+        snprintf(name, sizeof(name), "replay-%07d", i);
+        snprintf(username, sizeof(username), "user%d", i);
+        ok = ok && add_password(&vault->passwords, &vault->num_passwords, name, username, generated[i], NULL);
+        struct password *entry = ok ? vault->passwords[vault->num_passwords - 1] : NULL;
+        if (entry && i % 10 == 0)
+            ok = set_password_tags(entry, "prod");
+        if (entry && i % 4 == 0)
+            ok = ok && set_password_folder(entry, "work/replay");
+        secure_free(generated[i]);
+    }
+    free(generated);
+    return ok;
+}
+
+
+/*
+ * Generate a password the add operation of the menu accepts with the current requirement
+ *
+ * return char*: The password on the secure heap, NULL if none was found
+ */
+static char *acceptable_password(const struct password_requirement *requirement) {
+    for (int i = 0; i < REPLAY_PASSWORD_TRIES; i++) {
+        char *password = generate_password(requirement);
+        if (!password)
+            return NULL;
+        struct strength_result strength;
+        estimate_strength(password, &strength);
+        if (is_valid_password(password, requirement) && strength.score >= requirement->min_strength)
+            return password;
+        secure_free(password);
+    }
+    return NULL;
+}
+
+
+/*
+ * Write the answers to the prompts of a menu operation, as a user would type them
+ *
+ * param struct replay_vault* vault: The vault the operation runs against
+ * param int operation: The menu option
+ * param char* script: Receives the input, SCRIPT_SIZE bytes
+ * return bool: false if the operation cannot be scripted and is skipped
+ */
+static bool write_script(struct replay_vault *vault, const int operation, char *script) {
+    const int num_live = count_live_passwords(vault->passwords, vault->num_passwords);
+    const int ordinal = num_live > 0 ? 1 + (int) (next_random(&vault->random) % (uint64_t) num_live) : 1;
+    script[0] = '\0';
+    switch (operation) {
+        case OPERATION_GET:
+        case OPERATION_DELETE:
+            snprintf(script, SCRIPT_SIZE, "%d\n", ordinal);
+            return true;
+        case OPERATION_GENERATE:
+            snprintf(script, SCRIPT_SIZE, "replay-new-%d user\n", vault->added++);
+            return true;
+        case OPERATION_ADD: {
+            char *password = acceptable_password(vault->requirement);
+            if (!password)
+                return false;
+            snprintf(script, SCRIPT_SIZE, "replay-new-%d\nuser\n%s\n", vault->added++, password);
+            secure_free(password);
+            return true;
+        }
+        case OPERATION_EDIT:
+            // Keep the username and let the menu generate the new password
+            snprintf(script, SCRIPT_SIZE, "%d\n\ngenerate\n", ordinal);
+            return true;
+        case OPERATION_REQUIREMENTS:
+            snprintf(script, SCRIPT_SIZE, "-1\n-1\n-1\n-1\n-1\n");
+            return true;
+        case OPERATION_SEARCH:
+            // The menu expects the newline left behind by the option first
+            snprintf(script, SCRIPT_SIZE, "\ntag:prod AND folder:work\n");
+            return true;
+        default:
+            return true;
+    }
+}
+
+
+/*
+ * Run a menu operation through the same function the menu calls
+ */
+static void run_operation(struct replay_vault *vault, const int operation) {
+    switch (operation) {
+        case OPERATION_GET:
+            get_password(&vault->passwords, &vault->num_passwords, vault->path, &replay_vault_key, NULL);
+            break;
+        case OPERATION_GENERATE:
+            generate_and_save_password(&vault->passwords, &vault->num_passwords, vault->requirement, NULL, NULL, NULL);
+            break;
+        case OPERATION_ADD:
+            add_existing_password(&vault->passwords, &vault->num_passwords, vault->requirement, NULL, NULL, NULL);
+            break;
+        case OPERATION_EDIT:
+            edit_password(&vault->passwords, &vault->num_passwords, vault->requirement, NULL, vault->path,
+                &replay_vault_key, NULL, NULL);
+            break;
+        case OPERATION_DELETE:
+            loop_delete_password(&vault->passwords, &vault->num_passwords, NULL, NULL);
+            break;
+        case OPERATION_REQUIREMENTS:
+            update_password_requirements(vault->requirement, NULL);
+            break;
+        case OPERATION_AUDIT:
+            audit_passwords(&vault->passwords, &vault->num_passwords, vault->requirement, NULL);
+            break;
+        case OPERATION_SEARCH:
+            search_passwords(&vault->passwords, &vault->num_passwords, NULL);
+            break;
+        default:
+            break;
+    }
+}
+
+
+static bool add_sample(struct latency_samples *samples, const double ms) {
+    if (samples->count == samples->capacity) {
+        const int capacity = samples->capacity ? 2 * samples->capacity : DEFAULT_CAPACITY;
+        double *grown = realloc(samples->ms, capacity * sizeof(double));
+        if (!grown)
+            return false;
+        samples->ms = grown;
+        samples->capacity = capacity;
+    }
+    samples->ms[samples->count++] = ms;
+    return true;
+}
+
+
+static int compare_doubles(const void *a, const void *b) {
+    const double first = *(const double *) a;
+    const double second = *(const double *) b;
+    return first < second ? -1 : first > second;
+}
+
+
+/*
+ * Get a percentile of sorted samples (nearest rank)
+ */
+static double percentile(const struct latency_samples *samples, const int percent) {
+    int rank = (samples->count * percent + 99) / 100;
+    if (rank < 1)
+        rank = 1;
+    return samples->ms[rank - 1];
+}
+
+
+/*
+ * Replay the operations of a trace against one synthetic vault
+ *
+ * param const int* operations: The menu options in trace order
+ * param int num_operations: Number of operations
+ * param struct replay_vault* vault: The filled vault
+ * param const char* script_path: File the input of each operation is written to
+ * param struct latency_samples* samples: Receives the latencies per menu option
+ * param int* skipped: Receives the number of operations that could not be scripted
+ * return bool: false if the input could not be redirected or memory ran out
+ */
+static bool replay_operations(
+    const int *operations,
+    const int num_operations,
+    struct replay_vault *vault,
+    const char *script_path,
+    struct latency_samples *samples,
+    int *skipped) {
+    *skipped = 0;
+    for (int i = 0; i < num_operations; i++) {
+        char script[SCRIPT_SIZE];
+        if (!write_script(vault, operations[i], script)) {
+            (*skipped)++;
+            continue;
+        }
+        FILE *file = fopen(script_path, "w");
+        if (!file)
+            return false;
+        fputs(script, file);
+        fclose(file);
+        if (!freopen(script_path, "r", stdin))
+            return false;
+
+        struct timespec started;
+        timespec_get(&started, TIME_UTC);
+        run_operation(vault, operations[i]);
+        const double ms = elapsed_ms(&started);
+        fflush(stdout);
+        if (!add_sample(&samples[operations[i]], ms))
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * Print the latency distribution of every menu option of one replay
+ */
+static void print_latencies(struct latency_samples *samples, const int size, const int skipped) {
+    printf("%d entries\n", size);
+    printf("  %-13s %7s %10s %10s %10s %10s %10s\n", "Operation", "Count", "Mean ms", "p50 ms", "p90 ms", "p99 ms", "Max ms");
+    for (int operation = 1; operation < NUM_MENU_OPERATIONS; operation++) {
+        struct latency_samples *operation_samples = &samples[operation];
+        if (operation_samples->count == 0)
+            continue;
+        qsort(operation_samples->ms, operation_samples->count, sizeof(double), compare_doubles);
+        double sum = 0;
+        for (int i = 0; i < operation_samples->count; i++)
+            sum += operation_samples->ms[i];
+        printf("  %-13s %7d %10.2f %10.2f %10.2f %10.2f %10.2f\n", operation_names[operation],
+            operation_samples->count, sum / operation_samples->count, percentile(operation_samples, 50),
+            percentile(operation_samples, 90), percentile(operation_samples, 99),
+            operation_samples->ms[operation_samples->count - 1]);
+    }
+    if (skipped > 0)
+        printf("  %d operation(s) skipped, no acceptable password could be generated\n", skipped);
+}
+
+
+/*
+ * Replay a recorded trace against synthetic vaults of the given sizes and print the latency
+ * distribution of every menu option. The operations run through the functions of the menu with
+ * scripted input and their output discarded, so no terminal is needed. The entry choices are
+ * seeded, replaying the same trace with another build runs the same operations
+ *
+ * param const char* trace_path: The trace file
+ * param const int* sizes: Number of entries of each synthetic vault
+ * param int num_sizes: Number of vaults
+ * return int: Exit code of the replay command
+ */
+int replay_trace(const char *trace_path, const int *sizes, const int num_sizes) {
+    int num_operations = 0;
+    int *operations = read_trace(trace_path, &num_operations);
+    if (!operations)
+        return 1;
+    printf("Replaying %d operation(s) of %s\n", num_operations, trace_path);
+    fflush(stdout);
+
+    // The synthetic vault itself is never saved, only side files such as the access counts are written
+    char *vault_path = path_with_suffix(trace_path, ".replay");
+    char *script_path = vault_path ? path_with_suffix(vault_path, ".script") : NULL;
+    const int saved_stdout = dup(fileno(stdout));
+    bool ok = script_path && saved_stdout >= 0;
+    for (int s = 0; ok && s < num_sizes; s++) {
+        struct replay_vault vault = {NULL, 0, read_password_requirement(NULL), vault_path, REPLAY_SEED, 0};
+        struct latency_samples samples[NUM_MENU_OPERATIONS] = {{0}};
+        int skipped = 0;
+        remove_side_files(vault_path);
+        ok = vault.requirement && fill_replay_vault(&vault, sizes[s]);
+        if (ok) {
+            ok = freopen(NULL_DEVICE, "w", stdout) != NULL;
+            ok = ok && replay_operations(operations, num_operations, &vault, script_path, samples, &skipped);
+            fflush(stdout);
+            dup2(saved_stdout, fileno(stdout));
+            clearerr(stdout);
+        }
+        if (ok)
+            print_latencies(samples, sizes[s], skipped);
+        for (int operation = 0; operation < NUM_MENU_OPERATIONS; operation++)
+            free(samples[operation].ms);
+        free_passwords(vault.passwords, vault.num_passwords);
+        free(vault.passwords);
+        free_password_requirement(vault.requirement);
+    }
+    if (!ok)
+        printf("The replay failed\n");
+    freopen(NULL_DEVICE, "r", stdin);
+    if (vault_path)
+        remove_side_files(vault_path);
+    if (saved_stdout >= 0)
+        close(saved_stdout);
+    free(script_path);
+    free(vault_path);
+    free(operations);
+    return ok ? 0 : 1;
+}
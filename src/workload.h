@@ -0,0 +1,34 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+// If set, the interactive menu appends the operations of the session to this trace file
+#define TRACE_ENVIRONMENT_VARIABLE "C_PASS_TRACE"
+#define TRACE_HEADER "C-Pass trace 1"
+// Vault sizes a trace is replayed against unless --entries is given
+#define DEFAULT_REPLAY_ENTRIES 1000
+#define MAX_REPLAY_SIZES 16
+// Tries to generate a password the add operation accepts before the operation is skipped
+#define REPLAY_PASSWORD_TRIES 100
+
+// Menu options, numbered as in the menu. Only the option is traced, never names or passwords
+enum menu_operation {
+    OPERATION_GET = 1,
+    OPERATION_GENERATE,
+    OPERATION_ADD,
+    OPERATION_EDIT,
+    OPERATION_DELETE,
+    OPERATION_REQUIREMENTS,
+    OPERATION_AUDIT,
+    OPERATION_SEARCH,
+    NUM_MENU_OPERATIONS
+};
+
+struct trace_recorder;
+
+const char *menu_operation_name(int operation);
+struct trace_recorder *open_trace_recorder(const char *path);
+void record_operation(struct trace_recorder *recorder, int operation, int num_live);
+void close_trace_recorder(struct trace_recorder *recorder);
+int replay_trace(const char *trace_path, const int *sizes, int num_sizes);
+
+#endif //WORKLOAD_H
@@ -0,0 +1,106 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Number of failed checks of the running test program, main returns whether it is 0
+static int test_failures = 0;
+
+// Report a failed check with its location and keep going, so one run shows every failure
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_STRING(actual, expected) \
+    do { \
+        const char *actual_text = (actual); \
+        const char *expected_text = (expected); \
+        if (!actual_text || !expected_text ? actual_text != expected_text : strcmp(actual_text, expected_text) != 0) { \
+            fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, \
+                actual_text ? actual_text : "(null)", expected_text ? expected_text : "(null)"); \
+            test_failures++; \
+        } \
+    } while (0)
+
+
+/*
+ * Create an empty directory for the files of a test
+ *
+ * param char* path: Receives the path, room for 64 bytes
+ * return int: 0 if the directory could not be created
+ */
+static inline int make_test_directory(char *path) {
+#ifdef _WIN32
+    snprintf(path, 64, "cpass_test_%d", _getpid());
+    return _mkdir(path) == 0;
+#else
+    snprintf(path, 64, "/tmp/cpass_test_XXXXXX");
+    return mkdtemp(path) != NULL;
+#endif
+}
+
+
+/*
+ * Delete the directory of a test with everything in it
+ */
+static inline void remove_test_directory(const char *path) {
+#ifndef _WIN32
+    DIR *directory = opendir(path);
+    const struct dirent *item;
+    while (directory && (item = readdir(directory)) != NULL) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0)
+            continue;
+        char child[512];
+        snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+        struct stat status;
+        if (lstat(child, &status) == 0 && S_ISDIR(status.st_mode))
+            remove_test_directory(child);
+        else
+            remove(child);
+    }
+    if (directory)
+        closedir(directory);
+    rmdir(path);
+#endif
+}
+
+
+/*
+ * Join the test directory and a file name
+ *
+ * param char* path: Receives the path, room for 256 bytes
+ */
+static inline void test_path(char *path, const char *directory, const char *name) {
+    snprintf(path, 256, "%s/%s", directory, name);
+}
+
+
+/*
+ * Finish a test program
+ *
+ * return int: The exit code, 0 if every check passed
+ */
+static inline int test_result(const char *name) {
+    if (test_failures == 0)
+        printf("%s: all checks passed\n", name);
+    else
+        printf("%s: %d check(s) failed\n", name, test_failures);
+    return test_failures == 0 ? 0 : 1;
+}
+
+#endif //TEST_H
@@ -0,0 +1,153 @@
+#include <stdbool.h>
+#include "test.h"
+#include "attachments.h"
+#include "crypto.h"
+#include "password.h"
+#include "secure_heap.h"
+
+// Three full chunks and a partial one
+#define LARGE_SIZE (3 * ATTACHMENT_CHUNK_SIZE + 123)
+
+static struct vault_key key;
+
+
+/*
+ * Store bytes as an attachment of the vault, through a temporary stream like a file being attached
+ */
+static bool store_bytes(const char *vault_path, const unsigned char *data, const size_t length, uint64_t *id,
+    uint64_t *size) {
+    FILE *input = tmpfile();
+    CHECK(input != NULL);
+    if (!input)
+        return false;
+    CHECK(fwrite(data, 1, length, input) == length);
+    rewind(input);
+    const bool stored = store_attachment(vault_path, &key, input, id, size);
+    fclose(input);
+    return stored;
+}
+
+
+/*
+ * Extract an attachment and compare it with the stored bytes
+ */
+static bool extracts_to(const char *vault_path, const struct vault_key *vault_key, const uint64_t id,
+    const uint64_t size, const unsigned char *data, const size_t length) {
+    FILE *output = tmpfile();
+    CHECK(output != NULL);
+    if (!output)
+        return false;
+    bool equal = extract_attachment(vault_path, vault_key, id, size, fileno(output));
+    unsigned char *read_back = malloc(length + 1);
+    rewind(output);
+    equal = equal && read_back && fread(read_back, 1, length + 1, output) == length &&
+        memcmp(read_back, data, length) == 0;
+    free(read_back);
+    fclose(output);
+    return equal;
+}
+
+
+/*
+ * Attachments of several chunks and empty ones come back as stored, whatever is appended after
+ * them. A wrong key, ID or size extracts nothing
+ */
+static void test_store_and_extract(const char *directory) {
+    char vault_path[256];
+    test_path(vault_path, directory, "files.vault");
+    unsigned char *large = malloc(LARGE_SIZE);
+    CHECK(large != NULL);
+    if (!large)
+        return;
+    for (size_t i = 0; i < LARGE_SIZE; i++)
+        large[i] = (unsigned char) (i * 31 + i / 7);
+    const unsigned char small[] = "token";
+
+    uint64_t large_id = 0, large_size = 0, empty_id = 0, empty_size = 1, small_id = 0, small_size = 0;
+    CHECK(store_bytes(vault_path, large, LARGE_SIZE, &large_id, &large_size));
+    CHECK(large_id != 0 && large_size == LARGE_SIZE);
+    CHECK(store_bytes(vault_path, small, 0, &empty_id, &empty_size));
+    CHECK(empty_id != 0 && empty_size == 0);
+    CHECK(store_bytes(vault_path, small, sizeof(small), &small_id, &small_size));
+    CHECK(small_id != large_id && small_size == sizeof(small));
+
+    CHECK(extracts_to(vault_path, &key, large_id, large_size, large, LARGE_SIZE));
+    CHECK(extracts_to(vault_path, &key, empty_id, empty_size, small, 0));
+    CHECK(extracts_to(vault_path, &key, small_id, small_size, small, sizeof(small)));
+
+    struct vault_key wrong_key;
+    CHECK(derive_vault_key("another master password", &wrong_key));
+    CHECK(!extracts_to(vault_path, &wrong_key, small_id, small_size, small, sizeof(small)));
+    CHECK(!extracts_to(vault_path, &key, small_id, small_size - 1, small, sizeof(small) - 1));
+    CHECK(!extracts_to(vault_path, &key, small_id ^ 1, small_size, small, sizeof(small)));
+
+    // Without an attachment file nothing can be extracted
+    char other_path[256];
+    test_path(other_path, directory, "other.vault");
+    CHECK(!extracts_to(other_path, &key, small_id, small_size, small, sizeof(small)));
+    free(large);
+}
+
+
+/*
+ * Check the labels of the references of an entry, in order and separated by spaces
+ */
+static void check_labels(const struct password *entry, const char *labels) {
+    char listed[256] = "";
+    const char *cursor = entry->attachments;
+    struct attachment_reference reference;
+    while (next_attachment_reference(&cursor, &reference))
+        snprintf(listed + strlen(listed), sizeof(listed) - strlen(listed), "%s%.*s", *listed ? " " : "",
+            (int) reference.label_length, reference.label);
+    CHECK_STRING(listed, labels);
+}
+
+
+/*
+ * References keep their sizes and labels, commas in labels are replaced and missing labels get a
+ * default. Removing a reference keeps the others in order
+ */
+static void test_references(void) {
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    CHECK(add_password(&passwords, &num_passwords, "server", "root", "secret", NULL));
+    if (num_passwords != 1)
+        return;
+    struct password *entry = passwords[0];
+    CHECK(entry->attachments == NULL);
+    CHECK(add_attachment_reference(entry, 0x1a, 100, "id_rsa"));
+    CHECK(add_attachment_reference(entry, 0x2b, 0, "notes:v2,old"));
+    CHECK(add_attachment_reference(entry, 0x3c, 5000000000ULL, NULL));
+    CHECK(add_attachment_reference(entry, 0x4d, 7, "cert.pem"));
+    check_labels(entry, "id_rsa notes:v2_old attachment cert.pem");
+
+    struct attachment_reference reference;
+    CHECK(find_attachment_reference(entry, 0x3c, &reference));
+    CHECK(reference.size == 5000000000ULL);
+    CHECK(find_attachment_reference(entry, 0x2b, &reference) && reference.size == 0);
+    CHECK(!find_attachment_reference(entry, 0x5e, &reference));
+
+    CHECK(remove_attachment_reference(entry, 0x2b));
+    check_labels(entry, "id_rsa attachment cert.pem");
+    CHECK(!remove_attachment_reference(entry, 0x2b));
+    CHECK(remove_attachment_reference(entry, 0x4d));
+    CHECK(remove_attachment_reference(entry, 0x1a));
+    check_labels(entry, "attachment");
+    CHECK(find_attachment_reference(entry, 0x3c, &reference) && reference.size == 5000000000ULL);
+    CHECK(remove_attachment_reference(entry, 0x3c));
+    CHECK(entry->attachments == NULL);
+
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+int main(void) {
+    char directory[64];
+    CHECK(make_test_directory(directory));
+    CHECK(derive_vault_key("attachment test", &key));
+    test_store_and_extract(directory);
+    test_references();
+    remove_test_directory(directory);
+    return test_result("attachments");
+}
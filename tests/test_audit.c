@@ -0,0 +1,93 @@
+#include <stdbool.h>
+#include "test.h"
+#include "audit.h"
+#include "password.h"
+
+// Large enough that the digests are computed and grouped on several threads
+#define NUM_ENTRIES 40000
+#define NUM_DISTINCT 1000
+
+
+static int group_size(const struct reuse_groups *groups, const int slot) {
+    const int g = groups->group_of[slot];
+    return g < 0 ? 0 : groups->starts[g + 1] - groups->starts[g];
+}
+
+
+/*
+ * Exact reuse and near-duplicates are grouped, deleted entries are ignored, and near-duplicate groups
+ * that only repeat an exact group are not reported twice
+ */
+static void test_small_vault(void) {
+    const char *const entries[][2] = {
+        {"mail", "Summer2023!"},
+        {"bank", "summer2024"},
+        {"shop", "$umm3r"},
+        {"news", "Summer2023!"},
+        {"git", "correct horse"},
+        {"wiki", "correct horse"},
+        {"chat", "unrelated pass"},
+        {"gone", "unrelated pass"},
+        {"pin", "1234"},
+        {"pin2", "5678"},
+    };
+    const int count = sizeof(entries) / sizeof(entries[0]);
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < count; i++)
+        CHECK(add_password(&passwords, &num_passwords, entries[i][0], "user", entries[i][1], NULL));
+    delete_password(&passwords, 7, NULL);
+
+    struct reuse_report report;
+    CHECK(find_reused_passwords(passwords, num_passwords, true, &report));
+    CHECK(report.exact.num_groups == 2);
+    CHECK(report.exact.group_of[0] >= 0 && report.exact.group_of[0] == report.exact.group_of[3]);
+    CHECK(report.exact.group_of[4] >= 0 && report.exact.group_of[4] == report.exact.group_of[5]);
+    CHECK(report.exact.group_of[1] < 0 && report.exact.group_of[6] < 0 && report.exact.group_of[7] < 0);
+    // "git" and "wiki" are identical, so only the summer variants form a near-duplicate group.
+    // Skeletons shorter than MIN_SKELETON_LENGTH, like those of the pins, are not compared
+    CHECK(report.near.num_groups == 1);
+    CHECK(group_size(&report.near, 0) == 4);
+    CHECK(report.near.group_of[1] == report.near.group_of[0] && report.near.group_of[2] == report.near.group_of[0]);
+    CHECK(report.near.group_of[4] < 0 && report.near.group_of[8] < 0);
+    free_reuse_report(&report);
+
+    CHECK(find_reused_passwords(passwords, num_passwords, false, &report));
+    CHECK(!report.has_near && report.exact.num_groups == 2);
+    free_reuse_report(&report);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+/*
+ * A vault big enough for several threads: every password is shared by NUM_ENTRIES / NUM_DISTINCT
+ * entries, no matter on which thread the entries were hashed
+ */
+static void test_large_vault(void) {
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char name[32], password[32];
+        snprintf(name, sizeof(name), "entry-%d", i);
+        snprintf(password, sizeof(password), "shared-%d", i % NUM_DISTINCT);
+        CHECK(add_password(&passwords, &num_passwords, name, "user", password, NULL));
+    }
+    struct reuse_report report;
+    CHECK(find_reused_passwords(passwords, num_passwords, false, &report));
+    CHECK(report.exact.num_groups == NUM_DISTINCT);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        CHECK(group_size(&report.exact, i) == NUM_ENTRIES / NUM_DISTINCT);
+        CHECK(report.exact.group_of[i] == report.exact.group_of[i % NUM_DISTINCT]);
+    }
+    free_reuse_report(&report);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+int main(void) {
+    test_small_vault();
+    test_large_vault();
+    return test_result("audit");
+}
@@ -0,0 +1,177 @@
+#include <stdbool.h>
+#include "test.h"
+#include "backup.h"
+#include "crypto.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "vault_store.h"
+
+#define NUM_ENTRIES 20000
+
+static struct vault_key key;
+
+
+/*
+ * Count the files below a directory
+ */
+static int count_files(const char *path) {
+    int count = 0;
+#ifndef _WIN32
+    DIR *directory = opendir(path);
+    const struct dirent *item;
+    while (directory && (item = readdir(directory)) != NULL) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0)
+            continue;
+        char child[512];
+        snprintf(child, sizeof(child), "%s/%s", path, item->d_name);
+        struct stat status;
+        if (lstat(child, &status) == 0 && S_ISDIR(status.st_mode))
+            count += count_files(child);
+        else
+            count++;
+    }
+    if (directory)
+        closedir(directory);
+#endif
+    return count;
+}
+
+
+/*
+ * Serialize the entries and write them as the given version of the vault
+ *
+ * return char*: The cleartext that was written, on the secure heap
+ */
+static char *write_version(const char *path, struct password **passwords, int num_passwords, const uint64_t version) {
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    char *cleartext = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext));
+    CHECK(cleartext && write_vault(path, &cleartext, &key, version));
+    free_password_requirement(requirement);
+    return cleartext;
+}
+
+
+static void check_restore(const char *store, const uint64_t version, const char *expected) {
+    char *cleartext = NULL;
+    CHECK(restore_backup(store, version, &key, &cleartext));
+    CHECK(cleartext && strcmp(cleartext, expected) == 0);
+    secure_free(cleartext);
+}
+
+
+/*
+ * Back up two versions that differ in one entry. The second one may only add the chunks around the change,
+ * both have to be restored byte for byte
+ */
+static void test_backup_and_restore(const char *directory, const char *store) {
+    char vault_path[256];
+    test_path(vault_path, directory, "backup.vault");
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char name[32], password[32];
+        snprintf(name, sizeof(name), "entry-%05d", i);
+        snprintf(password, sizeof(password), "secret-%d-%d", i, i * 7919 % 10007);
+        CHECK(add_password(&passwords, &num_passwords, name, "user", password, NULL));
+    }
+
+    char *first = write_version(vault_path, passwords, num_passwords, 1);
+    CHECK(backup_vault(store, vault_path, &key));
+    char chunks[256];
+    test_path(chunks, store, "chunks");
+    const int first_chunks = count_files(chunks);
+    CHECK(first_chunks > 10);
+    // Backing up a stored version again changes nothing
+    CHECK(backup_vault(store, vault_path, &key));
+    CHECK(count_files(chunks) == first_chunks);
+
+    const int slot = NUM_ENTRIES / 2;
+    CHECK(change_password(&passwords, &slot, "a completely new password", NULL));
+    char *second = write_version(vault_path, passwords, num_passwords, 2);
+    CHECK(backup_vault(store, vault_path, &key));
+    const int added_chunks = count_files(chunks) - first_chunks;
+    CHECK(added_chunks >= 1 && added_chunks <= 3);
+
+    check_restore(store, 1, first);
+    check_restore(store, 2, second);
+    char *missing = NULL;
+    CHECK(!restore_backup(store, 3, &key, &missing));
+    CHECK(list_backups(store));
+
+    // Pruning keeps the newest version and every chunk it references, only the chunks of the change go
+    CHECK(prune_backups(store, 1));
+    CHECK(!restore_backup(store, 1, &key, &missing));
+    check_restore(store, 2, second);
+    const int pruned_chunks = first_chunks + added_chunks - count_files(chunks);
+    CHECK(pruned_chunks >= 1 && pruned_chunks <= 3);
+
+    secure_free(first);
+    secure_free(second);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+/*
+ * A store belongs to the vault that created it, other vaults and damaged chunks are refused
+ */
+static void test_refusals(const char *directory, const char *store) {
+    char vault_path[256];
+    test_path(vault_path, directory, "other.vault");
+    struct vault_key other_key;
+    CHECK(derive_vault_key("another vault", &other_key));
+    char cleartext[] = "12 1 1 1 6 3 0 0\nmail alice secret\n";
+    char *input = cleartext;
+    CHECK(write_vault(vault_path, &input, &other_key, 2));
+    CHECK(!backup_vault(store, vault_path, &other_key));
+    char *restored = NULL;
+    CHECK(!restore_backup(store, 2, &other_key, &restored));
+
+    // Flip a byte of every chunk, restoring has to notice it
+    char chunks[256];
+    test_path(chunks, store, "chunks");
+#ifndef _WIN32
+    DIR *outer = opendir(chunks);
+    const struct dirent *prefix;
+    while (outer && (prefix = readdir(outer)) != NULL) {
+        if (prefix->d_name[0] == '.')
+            continue;
+        char sub[512];
+        snprintf(sub, sizeof(sub), "%s/%s", chunks, prefix->d_name);
+        DIR *inner = opendir(sub);
+        const struct dirent *chunk;
+        while (inner && (chunk = readdir(inner)) != NULL) {
+            if (chunk->d_name[0] == '.')
+                continue;
+            char file_path[768];
+            snprintf(file_path, sizeof(file_path), "%s/%s", sub, chunk->d_name);
+            FILE *file = fopen(file_path, "r+b");
+            if (file) {
+                const int byte = fgetc(file);
+                fseek(file, 0, SEEK_SET);
+                fputc(byte ^ 1, file);
+                fclose(file);
+            }
+        }
+        if (inner)
+            closedir(inner);
+    }
+    if (outer)
+        closedir(outer);
+    CHECK(!restore_backup(store, 2, &key, &restored));
+#endif
+}
+
+
+int main(void) {
+    char directory[64];
+    char store[256];
+    CHECK(make_test_directory(directory));
+    test_path(store, directory, "store");
+    CHECK(derive_vault_key("backup test", &key));
+    test_backup_and_restore(directory, store);
+    test_refusals(directory, store);
+    remove_test_directory(directory);
+    return test_result("backup");
+}
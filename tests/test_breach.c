@@ -0,0 +1,140 @@
+#include <stdbool.h>
+#include <openssl/evp.h>
+#include "test.h"
+#include "breach.h"
+
+// Enough hashes that the fan-out table has more than its minimum number of buckets
+#define NUM_BREACHED 20000
+
+static char (*lines)[41];
+
+
+static int compare_lines(const void *a, const void *b) {
+    return strcmp((const char *) a, (const char *) b);
+}
+
+
+/*
+ * Write the SHA-1 hashes of breached-0, breached-1 and so on sorted like the published corpora.
+ * Every tenth hash is written twice, every seventh in lowercase, and there are blank lines
+ */
+static void write_text_corpus(const char *path) {
+    lines = malloc(NUM_BREACHED * sizeof(lines[0]));
+    CHECK(lines != NULL);
+    if (!lines)
+        return;
+    for (int i = 0; i < NUM_BREACHED; i++) {
+        char password[32];
+        snprintf(password, sizeof(password), "breached-%d", i);
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int length = 0;
+        EVP_Digest(password, strlen(password), hash, &length, EVP_sha1(), NULL);
+        for (unsigned int b = 0; b < length; b++)
+            snprintf(lines[i] + 2 * b, 3, "%02X", hash[b]);
+    }
+    qsort(lines, NUM_BREACHED, sizeof(lines[0]), compare_lines);
+    FILE *text = fopen(path, "w");
+    CHECK(text != NULL);
+    if (!text)
+        return;
+    for (int i = 0; i < NUM_BREACHED; i++) {
+        char line[41];
+        memcpy(line, lines[i], sizeof(line));
+        for (int c = 0; i % 7 == 0 && c < 40; c++)
+            line[c] = (char) (line[c] >= 'A' ? line[c] + 'a' - 'A' : line[c]);
+        fprintf(text, "%s:%d\r\n", line, i + 1);
+        if (i % 10 == 0)
+            fprintf(text, "%s:%d\n", line, i + 1);
+        if (i % 1000 == 0)
+            fputs("\n", text);
+    }
+    fclose(text);
+}
+
+
+/*
+ * Every breached password is found with and without the Bloom filter, other passwords are not
+ */
+static void test_lookup(const char *directory, const int bloom_bits_per_entry) {
+    char text_path[256], corpus_path[256];
+    test_path(text_path, directory, "corpus.txt");
+    test_path(corpus_path, directory, "corpus.bin");
+    CHECK(convert_breach_corpus(text_path, corpus_path, bloom_bits_per_entry));
+    struct breach_corpus *corpus = open_breach_corpus(corpus_path);
+    CHECK(corpus != NULL);
+    if (!corpus)
+        return;
+    CHECK(corpus->count == NUM_BREACHED);
+    CHECK((corpus->bloom != NULL) == (bloom_bits_per_entry > 0));
+    int found = 0, false_positives = 0;
+    for (int i = 0; i < NUM_BREACHED; i++) {
+        char password[32];
+        snprintf(password, sizeof(password), "breached-%d", i);
+        found += is_password_breached(corpus, password);
+        snprintf(password, sizeof(password), "safe-%d", i);
+        false_positives += is_password_breached(corpus, password);
+    }
+    CHECK(found == NUM_BREACHED);
+    CHECK(false_positives == 0);
+    close_breach_corpus(corpus);
+}
+
+
+/*
+ * Unsorted or malformed input is refused and leaves no corpus behind, damaged corpora are not opened
+ */
+static void test_invalid_input(const char *directory) {
+    char text_path[256], corpus_path[256];
+    test_path(text_path, directory, "invalid.txt");
+    test_path(corpus_path, directory, "invalid.bin");
+
+    FILE *text = fopen(text_path, "w");
+    CHECK(text != NULL);
+    if (!text)
+        return;
+    fprintf(text, "%s:1\n%s:1\n", lines[1], lines[0]);
+    fclose(text);
+    CHECK(!convert_breach_corpus(text_path, corpus_path, 0));
+    FILE *left = fopen(corpus_path, "rb");
+    CHECK(left == NULL);
+    if (left)
+        fclose(left);
+
+    text = fopen(text_path, "w");
+    fprintf(text, "%s:1\nnot a hash\n", lines[0]);
+    fclose(text);
+    CHECK(!convert_breach_corpus(text_path, corpus_path, 0));
+
+    // A corpus cut short is not opened
+    text = fopen(text_path, "w");
+    fprintf(text, "%s:1\n%s:1\n", lines[0], lines[1]);
+    fclose(text);
+    CHECK(convert_breach_corpus(text_path, corpus_path, 0));
+    FILE *corpus = fopen(corpus_path, "r+b");
+    CHECK(corpus != NULL);
+    if (!corpus)
+        return;
+    fseek(corpus, 0, SEEK_END);
+    const long size = ftell(corpus);
+    fclose(corpus);
+    CHECK(truncate(corpus_path, size - 1) == 0);
+    CHECK(open_breach_corpus(corpus_path) == NULL);
+    CHECK(open_breach_corpus(text_path) == NULL);
+}
+
+
+int main(void) {
+    char directory[64];
+    char path[256];
+    CHECK(make_test_directory(directory));
+    test_path(path, directory, "corpus.txt");
+    write_text_corpus(path);
+    if (lines) {
+        test_lookup(directory, 0);
+        test_lookup(directory, 10);
+        test_invalid_input(directory);
+    }
+    free(lines);
+    remove_test_directory(directory);
+    return test_result("breach");
+}
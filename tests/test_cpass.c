@@ -0,0 +1,152 @@
+#include <stdbool.h>
+#include "test.h"
+#include "cpass.h"
+#include "crypto.h"
+#include "vault_store.h"
+
+#define MASTER_PASSWORD "library test"
+#define NUM_ENTRIES 500
+
+
+/*
+ * Check the username and password of an entry looked up by name
+ */
+static void check_entry(const cpass_vault *vault, const char *name, const char *username, const char *password) {
+    struct cpass_entry entry;
+    const int status = cpass_get(vault, name, &entry);
+    CHECK(status == CPASS_OK);
+    if (status != CPASS_OK)
+        return;
+    CHECK_STRING(entry.name, name);
+    CHECK_STRING(entry.username, username);
+    CHECK_STRING(entry.password, password);
+}
+
+
+static int count_entry(const struct cpass_entry *entry, void *context) {
+    (void) entry;
+    (*(int *) context)++;
+    return 0;
+}
+
+
+/*
+ * Entries added, updated and deleted through the API are found until the vault is committed,
+ * and again after opening the written file
+ */
+static void test_add_get_delete(const char *path) {
+    cpass_vault *vault = NULL;
+    CHECK(cpass_open(path, MASTER_PASSWORD, 0, &vault) == CPASS_ERROR_NOT_FOUND);
+    CHECK(cpass_open(path, MASTER_PASSWORD, CPASS_OPEN_CREATE, &vault) == CPASS_OK);
+    if (!vault)
+        return;
+    CHECK(cpass_add(vault, "mail", "alice", "mail-1") == CPASS_OK);
+    CHECK(cpass_add(vault, "bank", "bob", "bank-1") == CPASS_OK);
+    CHECK(cpass_add(vault, "mail", "mallory", "other") == CPASS_ERROR_EXISTS);
+    CHECK(cpass_add(vault, NULL, "bob", "bank-1") == CPASS_ERROR_INVALID);
+    CHECK(cpass_count(vault) == 2);
+    check_entry(vault, "mail", "alice", "mail-1");
+
+    CHECK(cpass_update(vault, "bank", NULL, "bank-2") == CPASS_OK);
+    check_entry(vault, "bank", "bob", "bank-2");
+    CHECK(cpass_update(vault, "shop", NULL, "shop-1") == CPASS_ERROR_NOT_FOUND);
+    CHECK(cpass_delete(vault, "mail") == CPASS_OK);
+    CHECK(cpass_delete(vault, "mail") == CPASS_ERROR_NOT_FOUND);
+    struct cpass_entry entry;
+    CHECK(cpass_get(vault, "mail", &entry) == CPASS_ERROR_NOT_FOUND);
+    CHECK(cpass_count(vault) == 1);
+    CHECK(cpass_commit(vault) == CPASS_OK);
+    cpass_close(vault);
+
+    CHECK(cpass_open(path, "wrong password", 0, &vault) == CPASS_ERROR_DECRYPT);
+    CHECK(cpass_open(path, MASTER_PASSWORD, 0, &vault) == CPASS_OK);
+    if (!vault)
+        return;
+    CHECK(cpass_count(vault) == 1);
+    check_entry(vault, "bank", "bob", "bank-2");
+    CHECK(cpass_get(vault, "mail", &entry) == CPASS_ERROR_NOT_FOUND);
+    cpass_close(vault);
+}
+
+
+/*
+ * Deleting most entries compacts the array and rebuilds the index, every remaining entry is still found
+ */
+static void test_compaction(const char *path) {
+    cpass_vault *vault = NULL;
+    CHECK(cpass_open(path, MASTER_PASSWORD, 0, &vault) == CPASS_OK);
+    if (!vault)
+        return;
+    char name[32], password[32];
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        snprintf(name, sizeof(name), "entry-%d", i);
+        snprintf(password, sizeof(password), "secret-%d", i);
+        CHECK(cpass_add(vault, name, "user", password) == CPASS_OK);
+    }
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        if (i % 10 == 0)
+            continue;
+        snprintf(name, sizeof(name), "entry-%d", i);
+        CHECK(cpass_delete(vault, name) == CPASS_OK);
+    }
+    CHECK(cpass_count(vault) == NUM_ENTRIES / 10 + 1);
+    int visited = 0;
+    CHECK(cpass_foreach(vault, count_entry, &visited) == CPASS_OK);
+    CHECK(visited == NUM_ENTRIES / 10 + 1);
+    for (int i = 0; i < NUM_ENTRIES; i += 10) {
+        snprintf(name, sizeof(name), "entry-%d", i);
+        snprintf(password, sizeof(password), "secret-%d", i);
+        check_entry(vault, name, "user", password);
+    }
+    check_entry(vault, "bank", "bob", "bank-2");
+    cpass_close(vault);
+}
+
+
+/*
+ * Vaults written by older versions may hold several entries of the same name. Deleting the one the
+ * index points to, even by the name string cpass_get returned for it, lets the next one take over
+ */
+static void test_duplicate_names(const char *path) {
+    struct vault_key key;
+    CHECK(derive_vault_key(MASTER_PASSWORD, &key));
+    // Enough other entries that deleting one of the duplicates does not compact the array
+    char cleartext[512] = "12 1 1 1 2\ngit alice first\ngit bob second\ngit carol third\n";
+    for (int i = 0; i < 10; i++)
+        snprintf(cleartext + strlen(cleartext), sizeof(cleartext) - strlen(cleartext), "site-%d user secret\n", i);
+    char *input = cleartext;
+    CHECK(write_vault(path, &input, &key, 1));
+
+    cpass_vault *vault = NULL;
+    CHECK(cpass_open(path, MASTER_PASSWORD, 0, &vault) == CPASS_OK);
+    if (!vault)
+        return;
+    CHECK(cpass_count(vault) == 13);
+    check_entry(vault, "git", "alice", "first");
+    struct cpass_entry entry;
+    CHECK(cpass_get(vault, "git", &entry) == CPASS_OK);
+    CHECK(cpass_delete(vault, entry.name) == CPASS_OK);
+    check_entry(vault, "git", "bob", "second");
+    CHECK(cpass_delete(vault, "git") == CPASS_OK);
+    check_entry(vault, "git", "carol", "third");
+    CHECK(cpass_delete(vault, "git") == CPASS_OK);
+    CHECK(cpass_get(vault, "git", &entry) == CPASS_ERROR_NOT_FOUND);
+    CHECK(cpass_count(vault) == 10);
+    check_entry(vault, "site-9", "user", "secret");
+    cpass_close(vault);
+}
+
+
+int main(void) {
+    char directory[64];
+    char path[256];
+    CHECK(make_test_directory(directory));
+    test_path(path, directory, "library.vault");
+    test_add_get_delete(path);
+    test_compaction(path);
+    test_path(path, directory, "duplicates.vault");
+    test_duplicate_names(path);
+    CHECK_STRING(cpass_strerror(CPASS_ERROR_CONFLICT), "Another process changed the same entries");
+    remove_test_directory(directory);
+    return test_result("cpass");
+}
@@ -0,0 +1,154 @@
+#include <stdbool.h>
+#include <time.h>
+#include "test.h"
+#include "expiry.h"
+#include "password.h"
+
+#define NUM_ENTRIES 500
+#define VAULT_MAX_AGE 90
+#define POLICY_MAX_AGE 7
+
+
+/*
+ * Entries get their creation and change times when added, a changed password only its change time.
+ * Listeners hear of both
+ */
+static void test_timestamps(void) {
+    struct expiry_index index;
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    requirement->max_age = VAULT_MAX_AGE;
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    CHECK(build_expiry_index(&index, requirement, passwords, num_passwords));
+    const struct password_listener listener = {track_expiry, &index};
+
+    const long long before = (long long) time(NULL);
+    CHECK(add_password(&passwords, &num_passwords, "mail", "alice", "secret", &listener));
+    const long long after = (long long) time(NULL);
+    struct password *entry = passwords[0];
+    CHECK(entry->created >= before && entry->created <= after && entry->changed == entry->created);
+    CHECK(index.count == 1 && index.heap[0].entry == entry);
+    CHECK(index.heap[0].due == entry->changed + (long long) VAULT_MAX_AGE * SECONDS_PER_DAY);
+
+    // Backdate the entry, changing its password makes it current again without touching its creation time
+    entry->created = entry->changed = 1000;
+    update_expiry(&index, entry);
+    CHECK(index.heap[0].due == 1000 + (long long) VAULT_MAX_AGE * SECONDS_PER_DAY);
+    const int slot = 0;
+    CHECK(change_password(&passwords, &slot, "rotated", &listener));
+    CHECK(entry->created == 1000 && entry->changed >= before);
+    CHECK(index.heap[0].due == entry->changed + (long long) VAULT_MAX_AGE * SECONDS_PER_DAY);
+
+    delete_password(&passwords, 0, &listener);
+    CHECK(index.count == 0);
+
+    free_expiry_index(&index);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+/*
+ * Compare the due entries of the index with all entries, earliest first, ties in any order
+ */
+static void check_due(const struct expiry_index *index, struct password **passwords, const int num_passwords,
+    const long long until, const int k) {
+    int expected = 0;
+    for (int i = 0; i < num_passwords; i++) {
+        const long long due = passwords[i] ? password_due_date(index->requirement, passwords[i]) : 0;
+        expected += due != 0 && due <= until;
+    }
+    CHECK(count_expiring_passwords(index, until) == expected);
+
+    struct expiry_item items[NUM_ENTRIES];
+    const int count = next_expiring_passwords(index, until, k, items);
+    CHECK(count == (expected < k ? expected : k));
+    bool ordered = true;
+    for (int i = 0; i < count; i++) {
+        ordered = ordered && items[i].due <= until && items[i].due == password_due_date(index->requirement, items[i].entry);
+        ordered = ordered && (i == 0 || items[i - 1].due <= items[i].due);
+    }
+    CHECK(ordered);
+    // Nothing left out is due before the last entry returned
+    for (int i = 0; count > 0 && count < expected && i < num_passwords; i++) {
+        if (!passwords[i] || passwords[i]->expiry_position == 0)
+            continue;
+        bool returned = false;
+        for (int j = 0; j < count; j++)
+            returned = returned || items[j].entry == passwords[i];
+        CHECK(returned || password_due_date(index->requirement, passwords[i]) >= items[count - 1].due);
+    }
+}
+
+
+/*
+ * The policy of an entry overrides the maximum age of the vault, entries without one are not
+ * indexed. Queries stay right while entries are changed and deleted
+ */
+static void test_due_queries(void) {
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    requirement->max_age = VAULT_MAX_AGE;
+    struct password_policy policy = {0};
+    policy.name = (char *) "rotate weekly";
+    policy.length = 12;
+    policy.max_age = POLICY_MAX_AGE;
+    policy.folders = (char *) "ops";
+    CHECK(set_password_policy(requirement, &policy));
+    policy.name = (char *) "kept";
+    policy.max_age = 0;
+    policy.folders = (char *) "archive";
+    CHECK(set_password_policy(requirement, &policy));
+
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    const long long now = (long long) time(NULL);
+    uint32_t state = 4321;
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "entry-%d", i);
+        CHECK(add_password(&passwords, &num_passwords, name, "user", "secret", NULL));
+        CHECK(set_password_folder(passwords[i], i % 5 == 0 ? "ops" : i % 7 == 0 ? "archive" : NULL));
+        state = state * 1103515245 + 12345;
+        // Some passwords are of unknown age, so they count as due long ago
+        passwords[i]->changed = i % 50 == 0 ? 0 : now - (long long) ((state >> 8) % (120 * SECONDS_PER_DAY));
+    }
+    CHECK(password_due_date(requirement, passwords[7]) == 0);
+    CHECK(password_due_date(requirement, passwords[5]) == passwords[5]->changed + (long long) POLICY_MAX_AGE * SECONDS_PER_DAY);
+
+    struct expiry_index index;
+    CHECK(build_expiry_index(&index, requirement, passwords, num_passwords));
+    const struct password_listener listener = {track_expiry, &index};
+    CHECK(passwords[7]->expiry_position == 0);
+    check_due(&index, passwords, num_passwords, now, EXPIRY_MENU_ENTRIES);
+    check_due(&index, passwords, num_passwords, now + (long long) DEFAULT_EXPIRY_WINDOW_DAYS * SECONDS_PER_DAY, NUM_ENTRIES);
+    check_due(&index, passwords, num_passwords, 0, NUM_ENTRIES);
+
+    // Rotate the passwords due first and delete some others
+    struct expiry_item items[10];
+    const int count = next_expiring_passwords(&index, now, 10, items);
+    CHECK(count == 10);
+    for (int i = 0; i < count; i++) {
+        int slot = 0;
+        while (passwords[slot] != items[i].entry)
+            slot++;
+        CHECK(change_password(&passwords, &slot, "rotated", &listener));
+    }
+    for (int i = 3; i < NUM_ENTRIES; i += 9)
+        delete_password(&passwords, i, &listener);
+    check_due(&index, passwords, num_passwords, now, EXPIRY_MENU_ENTRIES);
+    check_due(&index, passwords, num_passwords, now + (long long) DEFAULT_EXPIRY_WINDOW_DAYS * SECONDS_PER_DAY, NUM_ENTRIES);
+    check_due(&index, passwords, num_passwords, now + (long long) VAULT_MAX_AGE * SECONDS_PER_DAY, NUM_ENTRIES);
+
+    free_expiry_index(&index);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+int main(void) {
+    test_timestamps();
+    test_due_queries();
+    return test_result("expiry");
+}
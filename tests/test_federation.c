@@ -0,0 +1,140 @@
+#include <stdbool.h>
+#include <time.h>
+#include "test.h"
+#include "crypto.h"
+#include "federation.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "vault_store.h"
+
+
+/*
+ * Write a vault of the given entries, each given as name, username and folder
+ */
+static void write_test_vault(const char *path, const char *master_password, const char *const (*entries)[3],
+    const int count) {
+    struct vault_key key;
+    CHECK(derive_vault_key(master_password, &key));
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < count; i++) {
+        CHECK(add_password(&passwords, &num_passwords, entries[i][0], entries[i][1], "secret", NULL));
+        CHECK(set_password_folder(passwords[i], entries[i][2]));
+    }
+    char *cleartext = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext));
+    CHECK(write_vault(path, &cleartext, &key, 1));
+    secure_free(cleartext);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+static void set_vault_key(struct federated_vault *vault, const char *master_password) {
+    vault->vault_key = secure_malloc(sizeof(struct vault_key));
+    CHECK(vault->vault_key && derive_vault_key(master_password, vault->vault_key));
+}
+
+
+static void test_split_vault_list(void) {
+    const char separator = VAULT_LIST_SEPARATOR;
+    char list[32];
+    const char *paths[3];
+    // Empty entries are skipped
+    snprintf(list, sizeof(list), "team.bin%c%cops.bin%c", separator, separator, separator);
+    CHECK(split_vault_list(list, paths, 3) == 2);
+    CHECK_STRING(paths[0], "team.bin");
+    CHECK_STRING(paths[1], "ops.bin");
+    snprintf(list, sizeof(list), "a%cb%cc", separator, separator);
+    CHECK(split_vault_list(list, paths, 2) == -1);
+}
+
+
+/*
+ * Vaults with their own master passwords are unlocked together, missing vaults and wrong passwords
+ * leave only that vault locked. Matches of all vaults are merged and ranked by how well they match,
+ * equally good ones by frecency
+ */
+static void test_search(const char *directory) {
+    const char *const team[][3] = {
+        {"git", "alice", "code"},
+        {"gitlab", "alice", ""},
+        {"ci git", "bot", ""},
+        {"digital", "carol", ""},
+    };
+    const char *const ops[][3] = {
+        {"git", "ops", ""},
+        {"monitoring", "git-bot", ""},
+        {"dns", "ops", "git/infra"},
+    };
+    char paths[4][256];
+    test_path(paths[0], directory, "team.vault");
+    test_path(paths[1], directory, "ops.vault");
+    test_path(paths[2], directory, "missing.vault");
+    test_path(paths[3], directory, "other.vault");
+    write_test_vault(paths[0], "team password", team, 4);
+    write_test_vault(paths[1], "ops password", ops, 3);
+    write_test_vault(paths[3], "other password", ops, 3);
+
+    const char *vault_paths[] = {paths[0], paths[1], paths[2], paths[3]};
+    struct federation federation;
+    CHECK(!open_federation(&federation, vault_paths, 0));
+    CHECK(open_federation(&federation, vault_paths, 4));
+    set_vault_key(&federation.vaults[0], "team password");
+    set_vault_key(&federation.vaults[1], "ops password");
+    set_vault_key(&federation.vaults[2], "team password");
+    set_vault_key(&federation.vaults[3], "wrong password");
+    unlock_federation(&federation);
+    CHECK(federation.vaults[0].unlocked && federation.vaults[0].num_passwords == 4);
+    CHECK(federation.vaults[1].unlocked && federation.vaults[1].num_passwords == 3);
+    CHECK(!federation.vaults[2].unlocked && !federation.vaults[3].unlocked);
+    if (!federation.vaults[0].unlocked || !federation.vaults[1].unlocked) {
+        close_federation(&federation);
+        return;
+    }
+    // The git entry of the ops vault is used more often, so it ranks first among the exact matches
+    federation.vaults[1].passwords[0]->access_count = 5;
+    federation.vaults[1].passwords[0]->last_access = (long long) time(NULL);
+
+    int num_matches = 0;
+    struct federated_match *matches = search_federation(&federation, "GIT", false, &num_matches);
+    const int expected[][3] = {
+        {1, 0, MATCH_EXACT_NAME},
+        {0, 0, MATCH_EXACT_NAME},
+        {0, 1, MATCH_NAME_PREFIX},
+        {0, 2, MATCH_NAME_WORD},
+        {0, 3, MATCH_NAME},
+        {1, 1, MATCH_USERNAME},
+        {1, 2, MATCH_FOLDER_OR_TAG},
+    };
+    CHECK(matches != NULL && num_matches == 7);
+    for (int i = 0; matches && i < num_matches && i < 7; i++) {
+        if (matches[i].vault != expected[i][0] || matches[i].slot != expected[i][1] || matches[i].score != expected[i][2])
+            fprintf(stderr, "match %d is %s of vault %d with score %d\n", i, matches[i].name, matches[i].vault,
+                matches[i].score);
+        CHECK(matches[i].vault == expected[i][0] && matches[i].slot == expected[i][1]);
+        CHECK(matches[i].score == expected[i][2]);
+    }
+    free(matches);
+
+    matches = search_federation(&federation, "git", true, &num_matches);
+    CHECK(matches != NULL && num_matches == 2);
+    CHECK(matches && num_matches == 2 && matches[0].vault == 1 && matches[1].vault == 0);
+    free(matches);
+    matches = search_federation(&federation, "nothing", false, &num_matches);
+    CHECK(matches != NULL && num_matches == 0);
+    free(matches);
+    close_federation(&federation);
+}
+
+
+int main(void) {
+    char directory[64];
+    CHECK(make_test_directory(directory));
+    test_split_vault_list();
+    test_search(directory);
+    remove_test_directory(directory);
+    return test_result("federation");
+}
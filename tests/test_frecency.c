@@ -0,0 +1,117 @@
+#include <stdbool.h>
+#include <time.h>
+#include "test.h"
+#include "autosave.h"
+#include "crypto.h"
+#include "frecency.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "util.h"
+#include "vault_store.h"
+
+#define NUM_ENTRIES 50
+
+static struct vault_key key;
+
+
+/*
+ * Create entries named entry-0 and so on without any accesses
+ */
+static struct password **create_entries(const int count, int *num_passwords) {
+    *num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, num_passwords);
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "entry-%d", i);
+        CHECK(add_password(&passwords, num_passwords, name, "user", "secret", NULL));
+    }
+    return passwords;
+}
+
+
+/*
+ * The top-K listing ranks by frecency: an access long ago weighs less than a recent one, entries
+ * never accessed are not listed at all
+ */
+static void test_top_entries(void) {
+    int num_passwords = 0;
+    struct password **passwords = create_entries(NUM_ENTRIES, &num_passwords);
+    const long long now = (long long) time(NULL);
+    // entry-10 was used often but two half lives ago, entry-20 a little less often but today
+    passwords[10]->access_count = 12;
+    passwords[10]->last_access = now - 2 * FRECENCY_HALF_LIFE;
+    passwords[20]->access_count = 4;
+    passwords[20]->last_access = now;
+    passwords[30]->access_count = 1;
+    passwords[30]->last_access = now;
+    record_access(passwords[40]);
+    record_access(passwords[40]);
+
+    int slots[DEFAULT_TOP_ENTRIES];
+    CHECK(top_frecent_passwords(passwords, num_passwords, DEFAULT_TOP_ENTRIES, slots) == 4);
+    CHECK(slots[0] == 20 && slots[1] == 10 && slots[2] == 40 && slots[3] == 30);
+    CHECK(top_frecent_passwords(passwords, num_passwords, 2, slots) == 2);
+    CHECK(slots[0] == 20 && slots[1] == 10);
+    CHECK(frecency_score(passwords[0], now) == 0);
+
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+/*
+ * Showing a password through the saver does not write the access file right away, stopping the saver
+ * writes it, and reading it back restores the counts
+ */
+static void test_background_save(const char *path) {
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    int num_passwords = 0;
+    struct password **passwords = create_entries(3, &num_passwords);
+    char *cleartext = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext));
+    CHECK(write_vault(path, &cleartext, &key, 1));
+    secure_free(cleartext);
+    struct vault_base base = {0};
+    CHECK(record_vault_base(&base, 1, requirement, passwords, num_passwords));
+
+    struct autosave *saver = start_autosave(path, &key, &base, &passwords, &num_passwords, requirement, NULL);
+    CHECK(saver != NULL);
+    for (int i = 0; i < 3; i++) {
+        lock_vault(saver);
+        record_access(passwords[1]);
+        note_vault_access(saver);
+        unlock_vault(saver, false);
+    }
+    char access_path[256];
+    snprintf(access_path, sizeof(access_path), "%s%s", path, ACCESS_FILE_SUFFIX);
+    CHECK(!file_exists(access_path));
+    CHECK(stop_autosave(saver));
+    CHECK(file_exists(access_path));
+
+    int num_reread = 0;
+    struct password **reread = create_entries(3, &num_reread);
+    CHECK(load_access_stats(path, &key, reread, num_reread));
+    CHECK(reread[0]->access_count == 0);
+    CHECK(reread[1]->access_count == 3);
+    CHECK(reread[1]->last_access == passwords[1]->last_access);
+
+    free_passwords(reread, num_reread);
+    free(reread);
+    free_vault_base(&base);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+int main(void) {
+    char directory[64];
+    char path[256];
+    CHECK(make_test_directory(directory));
+    CHECK(derive_vault_key("frecency test", &key));
+    test_top_entries();
+    test_path(path, directory, "frecency.vault");
+    test_background_save(path);
+    remove_test_directory(directory);
+    return test_result("frecency");
+}
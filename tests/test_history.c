@@ -0,0 +1,117 @@
+#include <stdbool.h>
+#include "test.h"
+#include "crypto.h"
+#include "history.h"
+#include "password.h"
+#include "secure_heap.h"
+
+static struct vault_key key;
+
+
+/*
+ * Replace the password of an entry and record the old one in the history, like the menu does
+ */
+static void change_with_history(struct password_history *history, struct password ***passwords, const int slot,
+    const char *password) {
+    char *replaced = secure_strdup((*passwords)[slot]->password);
+    CHECK(change_password(passwords, &slot, password, NULL));
+    CHECK(record_password_change(history, (*passwords)[slot], replaced));
+    secure_free(replaced);
+}
+
+
+/*
+ * Check the former passwords of an entry, newest first
+ */
+static void check_history(const char *vault_path, const struct password *entry, const char *const *expected,
+    const int num_expected) {
+    struct history_item *items = NULL;
+    const int count = read_password_history(vault_path, &key, entry, &items);
+    CHECK(count == num_expected);
+    for (int i = 0; i < count && i < num_expected; i++) {
+        CHECK_STRING(items[i].password, expected[i]);
+        CHECK(items[i].replaced > 0);
+    }
+    free_history_items(items, count);
+}
+
+
+/*
+ * Records are deltas against the password that replaced them. Shared prefixes and suffixes, completely
+ * different and empty passwords all have to decode to the original value
+ */
+static void test_round_trip(const char *vault_path, struct password ***passwords) {
+    struct password_history *history = open_password_history(vault_path, &key);
+    CHECK(history != NULL);
+    change_with_history(history, passwords, 0, "correct-horse-2");
+    change_with_history(history, passwords, 0, "correct-battery-2");
+    change_with_history(history, passwords, 0, "Zq9!");
+    change_with_history(history, passwords, 1, "other-2");
+    CHECK(close_password_history(history));
+
+    const char *const mail[] = {"correct-battery-2", "correct-horse-2", "correct-horse-1"};
+    check_history(vault_path, (*passwords)[0], mail, 3);
+    const char *const bank[] = {"other-1"};
+    check_history(vault_path, (*passwords)[1], bank, 1);
+
+    // A later session appends to the same file
+    history = open_password_history(vault_path, &key);
+    change_with_history(history, passwords, 0, "Zq9!Zq9!");
+    CHECK(close_password_history(history));
+    const char *const appended[] = {"Zq9!", "correct-battery-2", "correct-horse-2", "correct-horse-1"};
+    check_history(vault_path, (*passwords)[0], appended, 4);
+}
+
+
+/*
+ * A password changed without recording it breaks the chain, the records must not decode into garbage
+ */
+static void test_unrecorded_change(const char *vault_path, struct password ***passwords) {
+    const int slot = 1;
+    CHECK(change_password(passwords, &slot, "changed-elsewhere", NULL));
+    check_history(vault_path, (*passwords)[1], NULL, 0);
+
+    struct history_item *items = NULL;
+    struct vault_key other_key;
+    CHECK(derive_vault_key("another vault", &other_key));
+    CHECK(read_password_history(vault_path, &other_key, (*passwords)[0], &items) == -1);
+}
+
+
+/*
+ * Reading trims every entry to the configured depth, newest records first
+ */
+static void test_depth(const char *vault_path, struct password ***passwords) {
+    setenv(HISTORY_DEPTH_VARIABLE, "2", 1);
+    CHECK(history_depth() == 2);
+    const char *const trimmed[] = {"Zq9!", "correct-battery-2"};
+    check_history(vault_path, (*passwords)[0], trimmed, 2);
+    setenv(HISTORY_DEPTH_VARIABLE, "0", 1);
+    CHECK(open_password_history(vault_path, &key) == NULL);
+    unsetenv(HISTORY_DEPTH_VARIABLE);
+    CHECK(history_depth() == DEFAULT_HISTORY_DEPTH);
+    check_history(vault_path, (*passwords)[0], trimmed, 2);
+}
+
+
+int main(void) {
+    char directory[64];
+    char vault_path[256];
+    CHECK(make_test_directory(directory));
+    test_path(vault_path, directory, "history.vault");
+    CHECK(derive_vault_key("history test", &key));
+    unsetenv(HISTORY_DEPTH_VARIABLE);
+
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    CHECK(add_password(&passwords, &num_passwords, "mail", "alice", "correct-horse-1", NULL));
+    CHECK(add_password(&passwords, &num_passwords, "bank", "bob", "other-1", NULL));
+    test_round_trip(vault_path, &passwords);
+    test_unrecorded_change(vault_path, &passwords);
+    test_depth(vault_path, &passwords);
+
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    remove_test_directory(directory);
+    return test_result("history");
+}
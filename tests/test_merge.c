@@ -0,0 +1,278 @@
+#include <stdbool.h>
+#include "test.h"
+#include "crypto.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "vault_store.h"
+
+// The state of the vault in one process, loaded from the file like main does
+struct session {
+    struct password_requirement *requirement;
+    struct password **passwords;
+    int num_passwords;
+    struct vault_base base;
+};
+
+static struct vault_key key;
+
+
+/*
+ * Load the vault file into a new session
+ */
+static bool open_session(const char *path, struct session *session) {
+    memset(session, 0, sizeof(struct session));
+    char *cleartext = NULL;
+    uint64_t version = 0;
+    if (!decrypt_file(path, &cleartext, &key, &version))
+        return false;
+    session->requirement = read_password_requirement(cleartext);
+    session->passwords = read_passwords(cleartext, &session->num_passwords);
+    secure_free(cleartext);
+    return session->requirement && session->passwords &&
+        record_vault_base(&session->base, version, session->requirement, session->passwords, session->num_passwords);
+}
+
+
+static void close_session(struct session *session) {
+    free_vault_base(&session->base);
+    free_passwords(session->passwords, session->num_passwords);
+    free(session->passwords);
+    free_password_requirement(session->requirement);
+}
+
+
+static enum commit_status commit_session(const char *path, struct session *session) {
+    compact_passwords(session->passwords, &session->num_passwords);
+    return commit_vault(path, &key, &session->base, session->requirement, &session->passwords, &session->num_passwords,
+        NULL);
+}
+
+
+/*
+ * Find a live entry by name
+ *
+ * return int: Its slot, -1 if there is none
+ */
+static int find_entry(const struct session *session, const char *name) {
+    for (int i = 0; i < session->num_passwords; i++) {
+        if (session->passwords[i] && strcmp(session->passwords[i]->name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+static void set_entry_password(struct session *session, const char *name, const char *password) {
+    const int slot = find_entry(session, name);
+    CHECK(slot >= 0);
+    if (slot >= 0)
+        CHECK(change_password(&session->passwords, &slot, password, NULL));
+}
+
+
+static void set_entry_username(struct session *session, const char *name, const char *username) {
+    const int slot = find_entry(session, name);
+    CHECK(slot >= 0);
+    if (slot < 0)
+        return;
+    secure_free(session->passwords[slot]->username);
+    session->passwords[slot]->username = secure_strdup(username);
+}
+
+
+/*
+ * Check the password of an entry as it is stored in the vault file
+ */
+static void check_stored_password(const char *path, const char *name, const char *password) {
+    struct session stored;
+    CHECK(open_session(path, &stored));
+    const int slot = find_entry(&stored, name);
+    CHECK(slot >= 0);
+    if (slot >= 0)
+        CHECK_STRING(stored.passwords[slot]->password, password);
+    close_session(&stored);
+}
+
+
+/*
+ * Write a vault with three entries as version 1
+ */
+static void create_vault(const char *path) {
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    CHECK(add_password(&passwords, &num_passwords, "mail", "alice", "mail-1", NULL));
+    CHECK(add_password(&passwords, &num_passwords, "bank", "bob", "bank-1", NULL));
+    CHECK(add_password(&passwords, &num_passwords, "shop", "carol", "shop-1", NULL));
+    char *cleartext = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext));
+    CHECK(write_vault(path, &cleartext, &key, 1));
+    secure_free(cleartext);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+/*
+ * Two sessions edit different entries, the second commit merges the first one
+ */
+static void test_disjoint_edits(const char *path) {
+    struct session first, second;
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    set_entry_password(&first, "mail", "mail-2");
+    set_entry_password(&second, "bank", "bank-2");
+    CHECK(add_password(&second.passwords, &second.num_passwords, "news", "dave", "news-1", NULL));
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_OK);
+    // The second session now holds the edit of the first one as well
+    const int mail = find_entry(&second, "mail");
+    CHECK(mail >= 0 && strcmp(second.passwords[mail]->password, "mail-2") == 0);
+    check_stored_password(path, "mail", "mail-2");
+    check_stored_password(path, "bank", "bank-2");
+    check_stored_password(path, "news", "news-1");
+    close_session(&first);
+    close_session(&second);
+}
+
+
+/*
+ * One session deletes an entry the other one does not touch
+ */
+static void test_delete_and_edit(const char *path) {
+    struct session first, second;
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    delete_password(&first.passwords, find_entry(&first, "news"), NULL);
+    set_entry_password(&second, "shop", "shop-2");
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_OK);
+    CHECK(find_entry(&second, "news") < 0);
+    check_stored_password(path, "shop", "shop-2");
+    struct session stored;
+    CHECK(open_session(path, &stored));
+    CHECK(find_entry(&stored, "news") < 0);
+    close_session(&stored);
+    close_session(&first);
+    close_session(&second);
+}
+
+
+/*
+ * Two sessions edit the same entry, the second commit must not overwrite the first one
+ */
+static void test_conflicting_edits(const char *path) {
+    struct session first, second;
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    set_entry_password(&first, "mail", "mail-3");
+    set_entry_username(&second, "mail", "mallory");
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    const uint64_t version = read_vault_version(path);
+    CHECK(commit_session(path, &second) == COMMIT_CONFLICT);
+    // Nothing was written
+    CHECK(read_vault_version(path) == version);
+    check_stored_password(path, "mail", "mail-3");
+    close_session(&first);
+    close_session(&second);
+
+    // Deleting an entry another session changed conflicts as well
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    set_entry_password(&first, "bank", "bank-3");
+    delete_password(&second.passwords, find_entry(&second, "bank"), NULL);
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_CONFLICT);
+    check_stored_password(path, "bank", "bank-3");
+    close_session(&first);
+    close_session(&second);
+}
+
+
+/*
+ * Requirement changes merge like entries: a change on one side is taken over, changes on both sides conflict.
+ * Every field of the requirement counts, the maximum age as well
+ */
+static void test_requirement_changes(const char *path) {
+    struct session first, second;
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    first.requirement->max_age = 30;
+    set_entry_password(&second, "shop", "shop-3");
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_OK);
+    CHECK(second.requirement->max_age == 30);
+    close_session(&first);
+    close_session(&second);
+
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    first.requirement->max_age = 60;
+    second.requirement->max_age = 90;
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_CONFLICT);
+    struct session stored;
+    CHECK(open_session(path, &stored));
+    CHECK(stored.requirement->max_age == 60);
+    close_session(&stored);
+    close_session(&first);
+    close_session(&second);
+}
+
+
+/*
+ * Entries of the same name cannot be paired between the sessions. Each session deleting a different one
+ * of them conflicts instead of bringing one back, edits of other entries still merge
+ */
+static void test_duplicate_names(const char *path) {
+    char cleartext[] = "12 1 1 1 2\ngit alice first\ngit bob second\nmail carol mail-1\n";
+    char *input = cleartext;
+    CHECK(write_vault(path, &input, &key, 1));
+
+    struct session first, second;
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    set_entry_password(&first, "mail", "mail-2");
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_OK);
+    close_session(&first);
+    close_session(&second);
+
+    CHECK(open_session(path, &first));
+    CHECK(open_session(path, &second));
+    const int alice = find_entry(&first, "git");
+    CHECK(alice >= 0 && strcmp(first.passwords[alice]->username, "alice") == 0);
+    delete_password(&first.passwords, alice, NULL);
+    const int bob = find_entry(&second, "git") + 1;
+    CHECK(bob > 0 && strcmp(second.passwords[bob]->username, "bob") == 0);
+    delete_password(&second.passwords, bob, NULL);
+    CHECK(commit_session(path, &first) == COMMIT_OK);
+    CHECK(commit_session(path, &second) == COMMIT_CONFLICT);
+    struct session stored;
+    CHECK(open_session(path, &stored));
+    const int remaining = find_entry(&stored, "git");
+    CHECK(remaining >= 0 && strcmp(stored.passwords[remaining]->username, "bob") == 0);
+    close_session(&stored);
+    check_stored_password(path, "mail", "mail-2");
+    close_session(&first);
+    close_session(&second);
+}
+
+
+int main(void) {
+    char directory[64];
+    char path[256];
+    CHECK(make_test_directory(directory));
+    test_path(path, directory, "merge.vault");
+    CHECK(derive_vault_key("merge test", &key));
+    create_vault(path);
+    test_disjoint_edits(path);
+    test_delete_and_edit(path);
+    test_conflicting_edits(path);
+    test_requirement_changes(path);
+    test_path(path, directory, "duplicates.vault");
+    test_duplicate_names(path);
+    remove_test_directory(directory);
+    return test_result("merge");
+}
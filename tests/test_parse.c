@@ -0,0 +1,105 @@
+#include <stdbool.h>
+#include "test.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "util.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Enough for MIN_PARSE_BYTES_PER_THREAD to allow more than a dozen threads
+#define NUM_ENTRIES 100000
+
+
+/*
+ * Build the cleartext of a vault with NUM_ENTRIES entries and a policy line in front of them
+ */
+static char *create_cleartext(void) {
+    const size_t size = 64 + (size_t) NUM_ENTRIES * 64;
+    char *cleartext = secure_malloc(size);
+    if (!cleartext)
+        return NULL;
+    size_t length = (size_t) snprintf(cleartext, size, "14 2 3 1 6 4 1 0\nweb 16 0 2 1 1 0 3   web  0\n");
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        length += (size_t) snprintf(cleartext + length, size - length, "entry-%d user-%d secret\\s%d  work tag%d\n",
+            i, i % 13, i, i % 5);
+        // A malformed line is skipped wherever it ends up
+        if (i == NUM_ENTRIES / 2)
+            length += (size_t) snprintf(cleartext + length, size - length, "malformed\n");
+    }
+    return cleartext;
+}
+
+
+/*
+ * Every number of threads yields the same entries in file order
+ */
+static void test_thread_counts(const char *cleartext) {
+    const int counts[] = {1, 2, 3, 8, MAX_THREADS};
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int num_passwords = 0;
+        struct password **passwords = read_passwords_with_threads(cleartext, &num_passwords, counts[c]);
+        CHECK(passwords != NULL);
+        CHECK(num_passwords == NUM_ENTRIES);
+        if (!passwords || num_passwords != NUM_ENTRIES)
+            continue;
+        for (int i = 0; i < num_passwords; i += 997) {
+            char name[32], password[32];
+            snprintf(name, sizeof(name), "entry-%d", i);
+            snprintf(password, sizeof(password), "secret %d", i);
+            CHECK_STRING(passwords[i]->name, name);
+            CHECK_STRING(passwords[i]->password, password);
+            CHECK_STRING(passwords[i]->folder, "work");
+        }
+        free_passwords(passwords, num_passwords);
+        free(passwords);
+    }
+}
+
+
+/*
+ * A vault that does not fit in memory is not loaded at all, a part of it would be saved as the whole
+ */
+static void test_out_of_memory(const char *cleartext) {
+#ifndef _WIN32
+    struct rlimit original;
+    CHECK(getrlimit(RLIMIT_AS, &original) == 0);
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status)
+        return;
+    char line[128];
+    unsigned long used_kb = 0;
+    while (fgets(line, sizeof(line), status)) {
+        if (sscanf(line, "VmSize: %lu kB", &used_kb) == 1)
+            break;
+    }
+    fclose(status);
+    // Room for the copy of the cleartext the parser splits, but not for every entry
+    struct rlimit limited = original;
+    limited.rlim_cur = used_kb * 1024 + 2 * strlen(cleartext) + 2 * 1024 * 1024;
+    CHECK(setrlimit(RLIMIT_AS, &limited) == 0);
+    int num_passwords = -1;
+    struct password **passwords = read_passwords_with_threads(cleartext, &num_passwords, 1);
+    CHECK(setrlimit(RLIMIT_AS, &original) == 0);
+    CHECK(passwords == NULL);
+    CHECK(num_passwords == 0);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+#else
+    (void) cleartext;
+#endif
+}
+
+
+int main(void) {
+    char *cleartext = create_cleartext();
+    CHECK(cleartext != NULL);
+    if (cleartext) {
+        // Memory freed by other tests stays mapped for reuse, so the limit is only meaningful first
+        test_out_of_memory(cleartext);
+        test_thread_counts(cleartext);
+    }
+    secure_free(cleartext);
+    return test_result("parse");
+}
@@ -0,0 +1,117 @@
+#include <stdbool.h>
+#include "test.h"
+#include "password.h"
+#include "secure_heap.h"
+
+#define NUM_GENERATED 200
+
+
+/*
+ * Define a policy through set_password_policy
+ */
+static bool define_policy(struct password_requirement *requirement, const char *name, const int length,
+    const int max_length, const char *allowed, const char *required, const int num_required,
+    const char *folders, const char *entries) {
+    struct password_policy policy = {0};
+    policy.name = (char *) name;
+    policy.length = length;
+    policy.max_length = max_length;
+    policy.minimum[CLASS_CUSTOM] = num_required;
+    policy.allowed = (char *) allowed;
+    policy.required = (char *) required;
+    policy.folders = (char *) folders;
+    policy.entries = (char *) entries;
+    return set_password_policy(requirement, &policy);
+}
+
+
+static int policy_of(const struct password_requirement *requirement, const char *name, const char *folder) {
+    struct password entry = {0};
+    entry.name = (char *) name;
+    entry.folder = (char *) folder;
+    return find_password_policy(requirement, &entry);
+}
+
+
+/*
+ * Policies no password could meet or with malformed character sets are refused
+ */
+static void test_invalid_policies(struct password_requirement *requirement) {
+    CHECK(!define_policy(requirement, "", 8, 0, NULL, NULL, 0, "a", NULL));
+    CHECK(!define_policy(requirement, "short", 2, 0, NULL, "#", 3, "a", NULL));
+    CHECK(!define_policy(requirement, "range", 8, 0, "z-a", NULL, 0, "a", NULL));
+    CHECK(!define_policy(requirement, "limits", 8, 6, NULL, NULL, 0, "a", NULL));
+    // The required characters are not allowed, so none can be generated
+    CHECK(!define_policy(requirement, "custom", 8, 0, "a-z", "#", 1, "a", NULL));
+    CHECK(requirement->num_policies == 0);
+}
+
+
+/*
+ * An entry named by a policy follows it, otherwise the policy of its innermost folder applies
+ */
+static void test_policy_selection(struct password_requirement *requirement) {
+    CHECK(define_policy(requirement, "bank", 6, 8, "0-9", NULL, 0, "finance", NULL));
+    CHECK(define_policy(requirement, "legacy", 8, 12, "a-zA-Z0-9", NULL, 0, "finance/old,legacy", NULL));
+    CHECK(define_policy(requirement, "pin", 4, 4, "0-9", NULL, 0, NULL, "*-pin"));
+    CHECK(requirement->num_policies == 3);
+    CHECK(policy_of(requirement, "savings", "finance") == 0);
+    CHECK(policy_of(requirement, "savings", "finance/cards") == 0);
+    CHECK(policy_of(requirement, "savings", "finance/old/archive") == 1);
+    CHECK(policy_of(requirement, "mainframe", "legacy") == 1);
+    CHECK(policy_of(requirement, "card-pin", "finance/old") == 2);
+    CHECK(policy_of(requirement, "savings", "financial") == -1);
+    CHECK(policy_of(requirement, "mail", NULL) == -1);
+
+    // Redefining a policy replaces it in place
+    CHECK(define_policy(requirement, "bank", 6, 10, "0-9", NULL, 0, "finance", NULL));
+    CHECK(requirement->num_policies == 3 && requirement->policies[0].max_length == 10);
+}
+
+
+/*
+ * Validation checks length limits, allowed characters and the custom class, generated passwords
+ * always pass it
+ */
+static void test_validation_and_generation(struct password_requirement *requirement) {
+    CHECK(define_policy(requirement, "symbols", 10, 16, "a-z0-9#%", "#%", 2, "symbols", NULL));
+    struct password_rules rules;
+    get_policy_rules(requirement, policy_of(requirement, "x", "symbols"), &rules);
+    CHECK_STRING(rules.policy, "symbols");
+    CHECK(meets_password_rules("abc#def%gh", &rules));
+    CHECK(!meets_password_rules("abc#defgh1", &rules));
+    CHECK(!meets_password_rules("abc#de%", &rules));
+    CHECK(!meets_password_rules("abc#def%ghijklmnopq", &rules));
+    CHECK(!meets_password_rules("Abc#def%gh", &rules));
+
+    char **generated = generate_passwords_with_rules(&rules, NUM_GENERATED);
+    CHECK(generated != NULL);
+    for (int i = 0; generated && i < NUM_GENERATED; i++) {
+        CHECK(meets_password_rules(generated[i], &rules));
+        CHECK(strspn(generated[i], "abcdefghijklmnopqrstuvwxyz0123456789#%") == strlen(generated[i]));
+        secure_free(generated[i]);
+    }
+    free(generated);
+
+    get_policy_rules(requirement, policy_of(requirement, "card-pin", NULL), &rules);
+    char *pin = generate_password_with_rules(&rules);
+    CHECK(pin && strlen(pin) == 4 && strspn(pin, "0123456789") == 4);
+    secure_free(pin);
+
+    CHECK(delete_password_policy(requirement, "symbols"));
+    CHECK(!delete_password_policy(requirement, "symbols"));
+    CHECK(policy_of(requirement, "x", "symbols") == -1);
+}
+
+
+int main(void) {
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    CHECK(requirement != NULL);
+    if (!requirement)
+        return test_result("policy");
+    test_invalid_policies(requirement);
+    test_policy_selection(requirement);
+    test_validation_and_generation(requirement);
+    free_password_requirement(requirement);
+    return test_result("policy");
+}
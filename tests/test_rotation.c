@@ -0,0 +1,139 @@
+#include <stdbool.h>
+#include <openssl/evp.h>
+#include "test.h"
+#include "breach.h"
+#include "crypto.h"
+#include "history.h"
+#include "password.h"
+#include "rotation.h"
+#include "secure_heap.h"
+
+#define NUM_ENTRIES 20
+
+
+static int compare_lines(const void *a, const void *b) {
+    return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+
+/*
+ * Convert a corpus holding the given passwords, the text corpus lists their SHA-1 hashes sorted like
+ * the published corpora
+ */
+static struct breach_corpus *create_corpus(const char *directory, const char *const *passwords, const int count) {
+    char text_path[256], corpus_path[256];
+    test_path(text_path, directory, "corpus.txt");
+    test_path(corpus_path, directory, "corpus.bin");
+    char lines[16][48];
+    const char *sorted[16];
+    for (int i = 0; i < count && i < 16; i++) {
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int length = 0;
+        EVP_Digest(passwords[i], strlen(passwords[i]), hash, &length, EVP_sha1(), NULL);
+        for (unsigned int b = 0; b < length; b++)
+            snprintf(lines[i] + 2 * b, 3, "%02X", hash[b]);
+        sorted[i] = lines[i];
+    }
+    qsort(sorted, (size_t) count, sizeof(sorted[0]), compare_lines);
+    FILE *text = fopen(text_path, "w");
+    CHECK(text != NULL);
+    if (!text)
+        return NULL;
+    for (int i = 0; i < count; i++)
+        fprintf(text, "%s:1\n", sorted[i]);
+    fclose(text);
+    CHECK(convert_breach_corpus(text_path, corpus_path, 0));
+    return open_breach_corpus(corpus_path);
+}
+
+
+/*
+ * Generated passwords found in the breach corpus are never handed out. With a single digit there are
+ * ten possible passwords and the corpus holds nine of them, so every rotated entry has to get the tenth
+ */
+static void test_breached_passwords_are_replaced(const char *directory) {
+    const char *const breached[] = {"0", "1", "2", "3", "4", "5", "6", "7", "8"};
+    struct breach_corpus *corpus = create_corpus(directory, breached, 9);
+    CHECK(corpus != NULL);
+
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    requirement->length = 1;
+    requirement->digits = 1;
+    requirement->uppercased = 0;
+    requirement->special_characters = 0;
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "entry-%d", i);
+        CHECK(add_password(&passwords, &num_passwords, name, "user", "old", NULL));
+    }
+
+    const struct rotation_filter filter = {0};
+    struct rotation_report report = {0};
+    CHECK(rotate_passwords(passwords, num_passwords, &filter, requirement, corpus, NULL, &report) == NUM_ENTRIES);
+    for (int i = 0; i < num_passwords; i++)
+        CHECK_STRING(passwords[i]->password, "9");
+    CHECK(report.count == NUM_ENTRIES);
+    for (int i = 0; i < report.count; i++)
+        CHECK_STRING(report.credentials[i].password, "9");
+
+    free_rotation_report(&report);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+    close_breach_corpus(corpus);
+}
+
+
+/*
+ * Vaults from before the history file kept the password before the last rotation in the entry.
+ * Rotating such an entry moves that password into the history, both former passwords have to be
+ * readable afterwards, newest first
+ */
+static void test_previous_password_moves_to_history(const char *directory) {
+    char vault_path[256];
+    test_path(vault_path, directory, "rotation.vault");
+    struct vault_key key;
+    CHECK(derive_vault_key("rotation test", &key));
+    unsetenv(HISTORY_DEPTH_VARIABLE);
+
+    // A version 2 entry holding its previous password
+    struct password_requirement *requirement = read_password_requirement("16 1 1 1 2\n");
+    int num_passwords = 0;
+    struct password **passwords = read_passwords("16 1 1 1 2\nmail alice current older\n", &num_passwords);
+    CHECK(num_passwords == 1);
+    if (num_passwords != 1)
+        return;
+    CHECK_STRING(passwords[0]->previous_password, "older");
+
+    struct password_history *history = open_password_history(vault_path, &key);
+    CHECK(history != NULL);
+    const struct rotation_filter filter = {0};
+    CHECK(rotate_passwords(passwords, num_passwords, &filter, requirement, NULL, history, NULL) == 1);
+    CHECK(close_password_history(history));
+    CHECK(passwords[0]->previous_password == NULL);
+    CHECK(strcmp(passwords[0]->password, "current") != 0);
+
+    struct history_item *items = NULL;
+    const int count = read_password_history(vault_path, &key, passwords[0], &items);
+    CHECK(count == 2);
+    if (count == 2) {
+        CHECK_STRING(items[0].password, "current");
+        CHECK_STRING(items[1].password, "older");
+    }
+    free_history_items(items, count);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+int main(void) {
+    char directory[64];
+    CHECK(make_test_directory(directory));
+    test_breached_passwords_are_replaced(directory);
+    test_previous_password_moves_to_history(directory);
+    remove_test_directory(directory);
+    return test_result("rotation");
+}
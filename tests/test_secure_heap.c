@@ -0,0 +1,110 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "test.h"
+#include "secure_heap.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+
+/*
+ * Check that the bytes of a block are all zero, the free list link at its start is skipped
+ */
+static bool is_wiped(const unsigned char *block, const size_t size) {
+    for (size_t i = sizeof(void *); i < size; i++) {
+        if (block[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+
+/*
+ * Blocks of every size class and large blocks keep what is written to them and can be resized
+ */
+static void test_allocation(void) {
+    const size_t sizes[] = {1, 15, 16, 100, 1000, SECURE_MAX_SMALL_SIZE, SECURE_MAX_SMALL_SIZE + 1, 3 * SECURE_REGION_SIZE};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        unsigned char *block = secure_malloc(sizes[i]);
+        CHECK(block != NULL);
+        if (!block)
+            continue;
+        memset(block, 0xA5, sizes[i]);
+        CHECK(block[0] == 0xA5 && block[sizes[i] - 1] == 0xA5);
+        secure_free(block);
+    }
+
+    // Growing from a small class into a large mapping keeps the content
+    char *text = secure_strdup("correct horse battery staple");
+    CHECK_STRING(text, "correct horse battery staple");
+    text = secure_realloc(text, 2 * SECURE_MAX_SMALL_SIZE);
+    CHECK(text && strcmp(text, "correct horse battery staple") == 0);
+    text = secure_realloc(text, 8);
+    CHECK(text && memcmp(text, "correct ", 8) == 0);
+    secure_free(text);
+    secure_free(NULL);
+}
+
+
+/*
+ * Freed small blocks are wiped at once and handed out again, without growing the heap
+ */
+static void test_wipe_and_reuse(void) {
+    unsigned char *block = secure_malloc(200);
+    CHECK(block != NULL);
+    if (!block)
+        return;
+    memset(block, 0xFF, 200);
+    secure_free(block);
+    // The block stays mapped in its region, so its former content can still be inspected
+    CHECK(is_wiped(block, 200));
+    unsigned char *again = secure_malloc(200);
+    CHECK(again == block);
+    secure_free(again);
+
+    // Many blocks of one class come from the same region, all of them are released again
+    void *blocks[1000];
+    for (int i = 0; i < 1000; i++) {
+        blocks[i] = secure_malloc(64);
+        CHECK(blocks[i] != NULL);
+    }
+    for (int i = 0; i < 1000; i++)
+        secure_free(blocks[i]);
+    for (int i = 0; i < 1000; i++) {
+        blocks[i] = secure_malloc(64);
+        CHECK(blocks[i] != NULL);
+    }
+    for (int i = 0; i < 1000; i++)
+        secure_free(blocks[i]);
+}
+
+
+/*
+ * Freeing a block twice must stop the program instead of linking the block into the free list twice,
+ * which would hand out the same secret memory to two owners
+ */
+static void test_double_free(void) {
+#ifndef _WIN32
+    fflush(NULL);
+    const pid_t child = fork();
+    if (child == 0) {
+        char *secret = secure_strdup("hunter2");
+        secure_free(secret);
+        secure_free(secret);
+        _exit(0);
+    }
+    int status = 0;
+    CHECK(child > 0 && waitpid(child, &status, 0) == child);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+#endif
+}
+
+
+int main(void) {
+    test_allocation();
+    test_wipe_and_reuse();
+    test_double_free();
+    return test_result("secure_heap");
+}
@@ -0,0 +1,101 @@
+#include <stdbool.h>
+#include "test.h"
+#include "crypto.h"
+#include "secure_heap.h"
+#include "session_cache.h"
+#ifdef __linux__
+#include <linux/keyctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ * Only positive timeouts of the environment variable are used
+ */
+static void test_timeout(void) {
+    unsetenv(SESSION_TIMEOUT_VARIABLE);
+    CHECK(session_timeout() == DEFAULT_SESSION_TIMEOUT);
+    setenv(SESSION_TIMEOUT_VARIABLE, "120", 1);
+    CHECK(session_timeout() == 120);
+    setenv(SESSION_TIMEOUT_VARIABLE, "0", 1);
+    CHECK(session_timeout() == DEFAULT_SESSION_TIMEOUT);
+    setenv(SESSION_TIMEOUT_VARIABLE, "-5", 1);
+    CHECK(session_timeout() == DEFAULT_SESSION_TIMEOUT);
+    setenv(SESSION_TIMEOUT_VARIABLE, "soon", 1);
+    CHECK(session_timeout() == DEFAULT_SESSION_TIMEOUT);
+    unsetenv(SESSION_TIMEOUT_VARIABLE);
+}
+
+
+#ifdef __linux__
+static bool loads_key(const char *vault_path, const struct vault_key *expected) {
+    struct vault_key *loaded = load_session_key(vault_path);
+    const bool equal = loaded && memcmp(loaded->key, expected->key, VAULT_KEY_SIZE) == 0 &&
+        memcmp(loaded->iv, expected->iv, VAULT_IV_SIZE) == 0;
+    secure_free(loaded);
+    return equal;
+}
+
+
+/*
+ * Keys are cached per vault file, whatever path names it, and can be dropped one at a time or all
+ * at once. The test runs in an anonymous session keyring of its own, so the keys of the user are
+ * left alone
+ */
+static void test_cache(const char *directory) {
+    if (syscall(SYS_keyctl, KEYCTL_JOIN_SESSION_KEYRING, NULL) < 0) {
+        fprintf(stderr, "session cache: no keyring available, skipped\n");
+        return;
+    }
+    unsetenv(SESSION_KEYRING_VARIABLE);
+    char first_path[256], second_path[256], alias[256];
+    test_path(first_path, directory, "first.vault");
+    test_path(second_path, directory, "second.vault");
+    test_path(alias, directory, "./first.vault");
+    FILE *file = fopen(first_path, "wb");
+    CHECK(file != NULL);
+    if (file)
+        fclose(file);
+    struct vault_key first_key, second_key;
+    CHECK(derive_vault_key("first master password", &first_key));
+    CHECK(derive_vault_key("second master password", &second_key));
+
+    CHECK(load_session_key(first_path) == NULL);
+    CHECK(flush_session_keys());
+    CHECK(!store_session_key(first_path, &first_key, 0));
+    CHECK(store_session_key(first_path, &first_key, 60));
+    CHECK(store_session_key(second_path, &second_key, 60));
+    CHECK(loads_key(first_path, &first_key));
+    CHECK(loads_key(alias, &first_key));
+    CHECK(loads_key(second_path, &second_key));
+
+    // Storing again replaces the cached key
+    CHECK(store_session_key(second_path, &first_key, 60));
+    CHECK(loads_key(second_path, &first_key));
+
+    CHECK(forget_session_key(alias));
+    CHECK(!forget_session_key(first_path));
+    CHECK(load_session_key(first_path) == NULL);
+    CHECK(loads_key(second_path, &first_key));
+    CHECK(flush_session_keys());
+    CHECK(load_session_key(second_path) == NULL);
+}
+#endif
+
+
+int main(void) {
+    test_timeout();
+    if (has_session_cache()) {
+#ifdef __linux__
+        char directory[64];
+        CHECK(make_test_directory(directory));
+        test_cache(directory);
+        remove_test_directory(directory);
+#endif
+    } else {
+        CHECK(load_session_key("vault.bin") == NULL);
+        CHECK(!flush_session_keys());
+    }
+    return test_result("session_cache");
+}
@@ -0,0 +1,90 @@
+#include <stdbool.h>
+#include "test.h"
+#include "password.h"
+#include "strength.h"
+
+
+/*
+ * Check the score of a password and that the warning names the pattern found in it
+ */
+static void check_strength(const char *password, const int score, const char *warning) {
+    struct strength_result result;
+    estimate_strength(password, &result);
+    if (result.score != score)
+        fprintf(stderr, "%s: score %d, about 10^%.1f guesses\n", password, result.score, result.guesses_log10);
+    CHECK(result.score == score);
+    if (!warning || !result.warning)
+        CHECK_STRING(result.warning, warning);
+    else if (!strstr(result.warning, warning))
+        CHECK_STRING(result.warning, warning);
+}
+
+
+/*
+ * Passwords that merely meet the character class counts still score low if they are made of common
+ * passwords, words, keyboard walks, repeats, sequences or dates
+ */
+static void test_patterns(void) {
+    check_strength("", 0, NULL);
+    check_strength("password", 0, "top-10 common password");
+    check_strength("P@ssw0rd", 0, "top-10 common password");
+    check_strength("Password1!", 1, "similar to a commonly used password");
+    check_strength("michael", 0, "Names and surnames");
+    check_strength("mnbvcx", 1, "Straight rows of keys");
+    check_strength("poiuytgf", 1, "Short keyboard patterns");
+    check_strength("aaaaaaaa", 0, "Repeats like \"aaa\"");
+    check_strength("hunter2hunter2", 1, "Repeats like \"abcabcabc\"");
+    check_strength("abcdefgh", 0, "Sequences");
+    check_strength("987654", 0, "Sequences");
+    check_strength("1987", 0, "Recent years");
+    check_strength("13.05.1991", 1, "Dates");
+    check_strength("19910513", 1, "Dates");
+    check_strength("Tr0ub4dour&3", 4, NULL);
+    check_strength("correcthorsebatterystaple", 4, NULL);
+
+    // Characters beyond the analyzed length only add guesses
+    char longer[200];
+    memset(longer, 'a', sizeof(longer) - 1);
+    longer[sizeof(longer) - 1] = '\0';
+    struct strength_result result;
+    estimate_strength(longer, &result);
+    CHECK(result.guesses_log10 > STRENGTH_SCORE_4_LOG10 && result.score == MAX_STRENGTH_SCORE);
+}
+
+
+/*
+ * The minimum strength of the requirement gates passwords and the vault report counts the weak ones
+ */
+static void test_requirement(void) {
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    CHECK(requirement->min_strength == 3);
+    CHECK(!is_strong_password("Password1!", requirement));
+    CHECK(is_strong_password("Tr0ub4dour&3", requirement));
+    requirement->min_strength = 0;
+    CHECK(is_strong_password("password", requirement));
+    requirement->min_strength = 3;
+
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    CHECK(add_password(&passwords, &num_passwords, "mail", "alice", "Password1!", NULL));
+    CHECK(add_password(&passwords, &num_passwords, "bank", "bob", "Tr0ub4dour&3", NULL));
+    CHECK(add_password(&passwords, &num_passwords, "shop", "carol", "qwertyuiop", NULL));
+    CHECK(add_password(&passwords, &num_passwords, "gone", "dave", "password", NULL));
+    delete_password(&passwords, 3, NULL);
+    FILE *output = tmpfile();
+    CHECK(output != NULL);
+    if (output) {
+        CHECK(print_strength_report(output, passwords, num_passwords, requirement, false) == 2);
+        fclose(output);
+    }
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+int main(void) {
+    test_patterns();
+    test_requirement();
+    return test_result("strength");
+}
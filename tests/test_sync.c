@@ -0,0 +1,189 @@
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "test.h"
+#include "crypto.h"
+#include "password.h"
+#include "secure_heap.h"
+#include "sync.h"
+#include "vault_store.h"
+
+#define NUM_ENTRIES 200
+
+static struct vault_key key;
+
+// What the server thread needs to serve one vault
+struct server_job {
+    const char *address;
+    const char *vault_path;
+    struct password **passwords;
+    int num_passwords;
+    int exit_code;
+};
+
+
+/*
+ * Load a copy of the serialized entries
+ */
+static struct password **load_copy(const char *cleartext, int *num_passwords) {
+    *num_passwords = 0;
+    struct password **passwords = read_passwords(cleartext, num_passwords);
+    CHECK(passwords != NULL && *num_passwords == NUM_ENTRIES);
+    return passwords;
+}
+
+
+static int find_entry(struct password **passwords, const int num_passwords, const char *name) {
+    for (int i = 0; i < num_passwords; i++) {
+        if (passwords[i] && strcmp(passwords[i]->name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+/*
+ * Count the leaves whose hashes differ between two trees of the same depth
+ */
+static int count_differing_leaves(const struct merkle_tree *first, const struct merkle_tree *second) {
+    const int num_leaves = 1 << first->depth;
+    int differing = 0;
+    for (int leaf = 0; leaf < num_leaves; leaf++)
+        differing += memcmp(first->nodes[num_leaves + leaf], second->nodes[num_leaves + leaf], SYNC_NODE_HASH_SIZE) != 0;
+    return differing;
+}
+
+
+/*
+ * Equal vaults have equal trees, no matter in which order the entries are stored. Changing one entry
+ * changes exactly one leaf and the root
+ */
+static void test_merkle_tree(const char *cleartext) {
+    int num_first = 0, num_second = 0;
+    struct password **first = load_copy(cleartext, &num_first);
+    struct password **second = load_copy(cleartext, &num_second);
+    struct password *swap = second[0];
+    second[0] = second[num_second - 1];
+    second[num_second - 1] = swap;
+    const int depth = sync_depth_for(NUM_ENTRIES);
+    CHECK(depth > SYNC_MIN_DEPTH && depth < SYNC_MAX_DEPTH);
+
+    struct merkle_tree first_tree, second_tree;
+    CHECK(build_merkle_tree(first, num_first, depth, &first_tree));
+    CHECK(build_merkle_tree(second, num_second, depth, &second_tree));
+    CHECK(memcmp(first_tree.nodes[1], second_tree.nodes[1], SYNC_NODE_HASH_SIZE) == 0);
+    CHECK(count_differing_leaves(&first_tree, &second_tree) == 0);
+    free_merkle_tree(&second_tree);
+
+    const int slot = find_entry(second, num_second, "entry-5");
+    CHECK(change_password(&second, &slot, "changed", NULL));
+    CHECK(build_merkle_tree(second, num_second, depth, &second_tree));
+    CHECK(memcmp(first_tree.nodes[1], second_tree.nodes[1], SYNC_NODE_HASH_SIZE) != 0);
+    CHECK(count_differing_leaves(&first_tree, &second_tree) == 1);
+
+    free_merkle_tree(&first_tree);
+    free_merkle_tree(&second_tree);
+    free_passwords(first, num_first);
+    free(first);
+    free_passwords(second, num_second);
+    free(second);
+}
+
+
+#ifndef _WIN32
+static void *serve(void *arg) {
+    struct server_job *job = arg;
+    job->exit_code = run_sync_server(job->address, true, job->vault_path, &key, 1, job->passwords, job->num_passwords);
+    return NULL;
+}
+
+
+/*
+ * A client that changed, deleted and added entries mirrors the server over a Unix socket afterwards.
+ * A client with another key is refused without ending the server
+ */
+static void test_loopback(const char *directory, const char *cleartext) {
+    char vault_path[256], address[256];
+    test_path(vault_path, directory, "server.vault");
+    test_path(address, directory, "sync.socket");
+    char *written = secure_strdup(cleartext);
+    CHECK(write_vault(vault_path, &written, &key, 1));
+    secure_free(written);
+
+    struct server_job job = {address, vault_path, NULL, 0, -1};
+    job.passwords = load_copy(cleartext, &job.num_passwords);
+    int num_passwords = 0;
+    struct password **passwords = load_copy(cleartext, &num_passwords);
+    int slot = find_entry(passwords, num_passwords, "entry-5");
+    CHECK(change_password(&passwords, &slot, "changed", NULL));
+    delete_password(&passwords, find_entry(passwords, num_passwords, "entry-7"), NULL);
+    CHECK(add_password(&passwords, &num_passwords, "extra", "user", "secret", NULL));
+
+    pthread_t server;
+    CHECK(pthread_create(&server, NULL, serve, &job) == 0);
+    const struct timespec pause = {0, 10 * 1000 * 1000};
+    for (int i = 0; i < 500 && access(address, F_OK) != 0; i++)
+        nanosleep(&pause, NULL);
+
+    struct vault_key wrong_key;
+    CHECK(derive_vault_key("another master password", &wrong_key));
+    bool modified = false;
+    CHECK(run_sync_client(address, &wrong_key, &passwords, &num_passwords, &modified, NULL) == 1);
+    CHECK(!modified);
+    CHECK(run_sync_client(address, &key, &passwords, &num_passwords, &modified, NULL) == 0);
+    CHECK(modified);
+    pthread_join(server, NULL);
+    CHECK(job.exit_code == 0);
+
+    CHECK(count_live_passwords(passwords, num_passwords) == NUM_ENTRIES);
+    CHECK(find_entry(passwords, num_passwords, "extra") < 0);
+    slot = find_entry(passwords, num_passwords, "entry-5");
+    CHECK(slot >= 0 && strcmp(passwords[slot]->password, "password-5") == 0);
+    slot = find_entry(passwords, num_passwords, "entry-7");
+    CHECK(slot >= 0 && strcmp(passwords[slot]->password, "password-7") == 0);
+    struct merkle_tree client_tree, server_tree;
+    const int depth = sync_depth_for(NUM_ENTRIES);
+    CHECK(build_merkle_tree(passwords, num_passwords, depth, &client_tree));
+    CHECK(build_merkle_tree(job.passwords, job.num_passwords, depth, &server_tree));
+    CHECK(memcmp(client_tree.nodes[1], server_tree.nodes[1], SYNC_NODE_HASH_SIZE) == 0);
+
+    free_merkle_tree(&client_tree);
+    free_merkle_tree(&server_tree);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_passwords(job.passwords, job.num_passwords);
+    free(job.passwords);
+}
+#endif
+
+
+int main(void) {
+    char directory[64];
+    CHECK(make_test_directory(directory));
+    CHECK(derive_vault_key("sync test", &key));
+
+    struct password_requirement *requirement = read_password_requirement(NULL);
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char name[32], password[32];
+        snprintf(name, sizeof(name), "entry-%d", i);
+        snprintf(password, sizeof(password), "password-%d", i);
+        CHECK(add_password(&passwords, &num_passwords, name, "user", password, NULL));
+    }
+    char *cleartext = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &cleartext));
+    if (cleartext) {
+        test_merkle_tree(cleartext);
+#ifndef _WIN32
+        test_loopback(directory, cleartext);
+#endif
+    }
+
+    secure_free(cleartext);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+    remove_test_directory(directory);
+    return test_result("sync");
+}
@@ -0,0 +1,167 @@
+#include <stdbool.h>
+#include "test.h"
+#include "bitmap.h"
+#include "password.h"
+#include "tag_index.h"
+
+// Spans several containers, the dense part turns array containers into bitsets
+#define VALUE_RANGE 300000
+#define DENSE_END 70000
+
+
+/*
+ * Check a bitmap against a plain array of flags
+ */
+static void check_bitmap(const struct bitmap *bitmap, const bool *expected) {
+    uint64_t count = 0;
+    bool equal = true;
+    for (uint32_t v = 0; v < VALUE_RANGE; v++) {
+        count += expected[v];
+        equal = equal && bitmap_contains(bitmap, v) == expected[v];
+    }
+    CHECK(equal);
+    CHECK(bitmap_cardinality(bitmap) == count);
+    size_t listed = 0;
+    uint32_t *values = bitmap_to_array(bitmap, &listed);
+    CHECK(values != NULL && listed == count);
+    for (size_t i = 0; values && i < listed; i++)
+        equal = equal && expected[values[i]] && (i == 0 || values[i - 1] < values[i]);
+    CHECK(equal);
+    free(values);
+}
+
+
+/*
+ * AND, OR and AND NOT give the same sets as plain flags, for array and bitset containers alike and
+ * with the result being one of the inputs
+ */
+static void test_bitmap(void) {
+    bool *in_a = calloc(VALUE_RANGE, sizeof(bool));
+    bool *in_b = calloc(VALUE_RANGE, sizeof(bool));
+    bool *expected = calloc(VALUE_RANGE, sizeof(bool));
+    CHECK(in_a && in_b && expected);
+    if (!in_a || !in_b || !expected)
+        return;
+    struct bitmap a, b, result;
+    bitmap_init(&a);
+    bitmap_init(&b);
+    uint32_t state = 12345;
+    for (uint32_t v = 0; v < VALUE_RANGE; v++) {
+        state = state * 1103515245 + 12345;
+        in_a[v] = v < DENSE_END ? v % 3 != 0 : (state >> 16) % 50 == 0;
+        in_b[v] = v < DENSE_END / 2 ? v % 2 == 0 : (state >> 8) % 40 == 0;
+        CHECK(!in_a[v] || bitmap_add(&a, v));
+        CHECK(!in_b[v] || bitmap_add(&b, v));
+    }
+    // Adding a value twice does not change the set
+    CHECK(bitmap_add(&a, 1));
+    check_bitmap(&a, in_a);
+
+    for (int operation = 0; operation < 3; operation++) {
+        bitmap_init(&result);
+        for (uint32_t v = 0; v < VALUE_RANGE; v++)
+            expected[v] = operation == 0 ? in_a[v] && in_b[v] : operation == 1 ? in_a[v] || in_b[v] : in_a[v] && !in_b[v];
+        CHECK(operation == 0 ? bitmap_and(&a, &b, &result) :
+            operation == 1 ? bitmap_or(&a, &b, &result) : bitmap_andnot(&a, &b, &result));
+        check_bitmap(&result, expected);
+        bitmap_free(&result);
+    }
+    CHECK(bitmap_and(&a, &b, &a));
+    for (uint32_t v = 0; v < VALUE_RANGE; v++)
+        expected[v] = in_a[v] && in_b[v];
+    check_bitmap(&a, expected);
+
+    bitmap_free(&a);
+    bitmap_free(&b);
+    free(in_a);
+    free(in_b);
+    free(expected);
+}
+
+
+/*
+ * Run a query and compare the names of the matching entries, in slot order and separated by spaces
+ */
+static void check_query(const struct tag_index *index, struct password **passwords, const int num_passwords,
+    const char *query, const char *names) {
+    struct bitmap result;
+    bitmap_init(&result);
+    const char *error = NULL;
+    CHECK(run_tag_query(index, passwords, num_passwords, query, &result, &error));
+    char matched[256] = "";
+    for (int i = 0; i < num_passwords; i++) {
+        if (bitmap_contains(&result, (uint32_t) i))
+            snprintf(matched + strlen(matched), sizeof(matched) - strlen(matched), "%s%s", *matched ? " " : "",
+                passwords[i]->name);
+    }
+    if (strcmp(matched, names) != 0)
+        fprintf(stderr, "query %s\n", query);
+    CHECK_STRING(matched, names);
+    bitmap_free(&result);
+}
+
+
+static void check_malformed(const struct tag_index *index, struct password **passwords, const int num_passwords,
+    const char *query) {
+    struct bitmap result;
+    bitmap_init(&result);
+    const char *error = NULL;
+    CHECK(!run_tag_query(index, passwords, num_passwords, query, &result, &error));
+    CHECK(error != NULL);
+    bitmap_free(&result);
+}
+
+
+/*
+ * Tag and folder terms are answered from the index, folders include their subfolders, deleted
+ * entries never match
+ */
+static void test_queries(void) {
+    const char *const entries[][3] = {
+        {"db-main", "prod,db", "work/servers"},
+        {"db-old", "prod,db,legacy", "work/servers/old"},
+        {"web", "prod", "work"},
+        {"test-db", "test,db", "workshop"},
+        {"mail", "", ""},
+        {"gone", "prod,db", "work"},
+    };
+    const int count = sizeof(entries) / sizeof(entries[0]);
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < count; i++) {
+        CHECK(add_password(&passwords, &num_passwords, entries[i][0], "user", "secret", NULL));
+        CHECK(set_password_tags(passwords[i], entries[i][1]));
+        CHECK(set_password_folder(passwords[i], entries[i][2]));
+    }
+    delete_password(&passwords, 5, NULL);
+    struct tag_index index;
+    CHECK(build_tag_index(passwords, num_passwords, &index));
+
+    check_query(&index, passwords, num_passwords, "", "db-main db-old web test-db mail");
+    check_query(&index, passwords, num_passwords, "tag:prod AND tag:db NOT tag:legacy", "db-main");
+    check_query(&index, passwords, num_passwords, "tag:db tag:prod", "db-main db-old");
+    check_query(&index, passwords, num_passwords, "tag:test OR tag:legacy", "db-old test-db");
+    check_query(&index, passwords, num_passwords, "NOT tag:prod", "test-db mail");
+    check_query(&index, passwords, num_passwords, "tag:db and not (tag:legacy or tag:test)", "db-main");
+    check_query(&index, passwords, num_passwords, "folder:work", "db-main db-old web");
+    check_query(&index, passwords, num_passwords, "folder:work/servers", "db-main db-old");
+    check_query(&index, passwords, num_passwords, "tag:unknown", "");
+    check_query(&index, passwords, num_passwords, "db-*", "db-main db-old");
+    check_query(&index, passwords, num_passwords, "name:*db* NOT folder:work", "test-db");
+
+    check_malformed(&index, passwords, num_passwords, "tag:prod AND");
+    check_malformed(&index, passwords, num_passwords, "(tag:prod");
+    check_malformed(&index, passwords, num_passwords, "tag:prod )");
+    check_malformed(&index, passwords, num_passwords, "OR tag:prod");
+
+    free_tag_index(&index);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+int main(void) {
+    test_bitmap();
+    test_queries();
+    return test_result("tags");
+}
@@ -0,0 +1,147 @@
+#include <stdbool.h>
+#include "test.h"
+#include "password.h"
+#include "transfer.h"
+
+// Enough entries that the export spans several read chunks of the import
+#define NUM_ENTRIES 20000
+
+
+/*
+ * Import a text into a new vault
+ *
+ * return long: The result of import_passwords
+ */
+static long import_text(const char *text, const enum transfer_format format, struct password ***passwords,
+    int *num_passwords, long *num_skipped) {
+    *num_passwords = 0;
+    *passwords = read_passwords(NULL, num_passwords);
+    FILE *input = tmpfile();
+    CHECK(input != NULL);
+    if (!input)
+        return -1;
+    fputs(text, input);
+    rewind(input);
+    const long imported = import_passwords(input, format, passwords, num_passwords, num_skipped);
+    fclose(input);
+    return imported;
+}
+
+
+static void free_vault(struct password **passwords, const int num_passwords) {
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+}
+
+
+/*
+ * Headers of other password managers are mapped to the columns, quoted fields may hold separators,
+ * quotes and line breaks, and records without name or password are skipped
+ */
+static void test_csv(void) {
+    const char *text =
+        "url,login_username,login_password,group,extra\r\n"
+        "mail,alice,\"pa,ss\"\"word\",work,x\r\n"
+        "bank,bob,\"two\nlines\",,y\n"
+        ",nobody,secret,,z\n"
+        "shop,carol,,,\n"
+        "news,dave,last";
+    struct password **passwords;
+    int num_passwords;
+    long skipped = 0;
+    CHECK(import_text(text, TRANSFER_CSV, &passwords, &num_passwords, &skipped) == 3);
+    CHECK(skipped == 2);
+    CHECK(num_passwords == 3);
+    if (num_passwords == 3) {
+        CHECK_STRING(passwords[0]->name, "mail");
+        CHECK_STRING(passwords[0]->username, "alice");
+        CHECK_STRING(passwords[0]->password, "pa,ss\"word");
+        CHECK_STRING(passwords[0]->folder, "work");
+        CHECK_STRING(passwords[1]->password, "two\nlines");
+        CHECK(passwords[1]->folder == NULL);
+        CHECK_STRING(passwords[2]->password, "last");
+    }
+    free_vault(passwords, num_passwords);
+
+    // Without a header the columns are name, username and password
+    CHECK(import_text("git,erin,hunter2\n", TRANSFER_CSV, &passwords, &num_passwords, NULL) == 1);
+    if (num_passwords == 1)
+        CHECK_STRING(passwords[0]->password, "hunter2");
+    free_vault(passwords, num_passwords);
+}
+
+
+/*
+ * JSON Lines values are unescaped, unknown keys of any type are skipped and broken lines are counted
+ */
+static void test_jsonl(void) {
+    const char *text =
+        "{\"name\": \"caf\\u00e9\", \"extra\": {\"a\": [1, 2]}, \"username\": \"alice\", \"password\": \"a\\\"b\\\\c\"}\n"
+        "\n"
+        "{\"title\":\"bank\",\"email\":\"bob@example.com\",\"pass\":\"x\\ny\",\"tags\":\"finance,urgent\"}\n"
+        "not json\n"
+        "{\"name\":\"shop\",\"username\":\"carol\"}";
+    struct password **passwords;
+    int num_passwords;
+    long skipped = 0;
+    CHECK(import_text(text, TRANSFER_JSONL, &passwords, &num_passwords, &skipped) == 2);
+    CHECK(skipped == 2);
+    CHECK(num_passwords == 2);
+    if (num_passwords == 2) {
+        CHECK_STRING(passwords[0]->name, "caf\xc3\xa9");
+        CHECK_STRING(passwords[0]->password, "a\"b\\c");
+        CHECK_STRING(passwords[1]->name, "bank");
+        CHECK_STRING(passwords[1]->username, "bob@example.com");
+        CHECK_STRING(passwords[1]->password, "x\ny");
+        CHECK_STRING(passwords[1]->tags, "finance,urgent");
+    }
+    free_vault(passwords, num_passwords);
+}
+
+
+/*
+ * Exporting a vault and importing the file again yields the same entries in both formats
+ */
+static void test_round_trip(const enum transfer_format format) {
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(NULL, &num_passwords);
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        char name[32], password[64];
+        snprintf(name, sizeof(name), "entry-%d", i);
+        snprintf(password, sizeof(password), i % 3 == 0 ? "with \"quote\", comma\n%d" : "plain-%d", i);
+        CHECK(add_password(&passwords, &num_passwords, name, "user", password, NULL));
+        if (i % 2 == 0)
+            set_password_folder(passwords[num_passwords - 1], "work/team");
+    }
+    FILE *file = tmpfile();
+    CHECK(file != NULL);
+    if (!file)
+        return;
+    CHECK(export_passwords(file, format, passwords, num_passwords) == NUM_ENTRIES);
+    rewind(file);
+
+    int num_imported = 0;
+    struct password **imported = read_passwords(NULL, &num_imported);
+    long skipped = 0;
+    CHECK(import_passwords(file, format, &imported, &num_imported, &skipped) == NUM_ENTRIES);
+    CHECK(skipped == 0);
+    fclose(file);
+    CHECK(num_imported == NUM_ENTRIES);
+    for (int i = 0; i < num_passwords && i < num_imported; i++) {
+        CHECK_STRING(imported[i]->name, passwords[i]->name);
+        CHECK_STRING(imported[i]->username, passwords[i]->username);
+        CHECK_STRING(imported[i]->password, passwords[i]->password);
+        CHECK_STRING(imported[i]->folder, passwords[i]->folder);
+    }
+    free_vault(imported, num_imported);
+    free_vault(passwords, num_passwords);
+}
+
+
+int main(void) {
+    test_csv();
+    test_jsonl();
+    test_round_trip(TRANSFER_CSV);
+    test_round_trip(TRANSFER_JSONL);
+    return test_result("transfer");
+}
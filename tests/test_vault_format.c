@@ -0,0 +1,354 @@
+#include <stdbool.h>
+#include "test.h"
+#include "crypto.h"
+#include "password.h"
+#include "secure_heap.h"
+
+// One vault per format version with the same entries, every version adds the fields listed in password.h
+static const char *const version_2 =
+    "14 2 3 1 2\n"
+    "mail alice hunter\\s2 old\\\\pass\n"
+    "bank bob p\\nw\n";
+static const char *const version_3 =
+    "14 2 3 1 3 4\n"
+    "mail alice hunter\\s2 old\\\\pass work/mail private,urgent\n"
+    "bank bob p\\nw  finance\n";
+static const char *const version_4 =
+    "14 2 3 1 4 4 1\n"
+    "web 16 0 2 1 1 0 3   web \n"
+    "mail alice hunter\\s2 old\\\\pass work/mail private,urgent\n"
+    "bank bob p\\nw  finance\n";
+static const char *const version_5 =
+    "14 2 3 1 5 4 1\n"
+    "web 16 0 2 1 1 0 3   web \n"
+    "mail alice hunter\\s2 old\\\\pass work/mail private,urgent 1:42:contract\n"
+    "bank bob p\\nw  finance\n";
+static const char *const version_6 =
+    "14 2 3 1 6 4 1 90\n"
+    "web 16 0 2 1 1 0 3   web  30\n"
+    "mail alice hunter\\s2 old\\\\pass work/mail private,urgent 1:42:contract 1700000000 1700000100\n"
+    "bank bob p\\nw  finance   1700000200 1700000300\n";
+
+// Vault files of header format 1, encrypted with the key of "correct horse" itself: AES-256-CBC,
+// AES-256-GCM compressed with zlib and ChaCha20-Poly1305
+static const char *const format_1_cleartext = "14 2 3 1 6 4 0 0\nmail alice secret   0 0\n";
+static const unsigned char format_1_cbc[] = {
+    0x43, 0x50, 0x41, 0x53, 0x53, 0x01, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x22, 0x66, 0x61, 0x1c, 0x9f, 0xbe, 0xc3, 0x83,
+    0x18, 0x64, 0xc6, 0xe4, 0xa6, 0x2e, 0x02, 0x37, 0xd5, 0x98, 0xe2, 0x63,
+    0xd7, 0x48, 0x01, 0xfa, 0x7d, 0x00, 0xac, 0xff, 0x22, 0x70, 0x8e, 0x61,
+    0x57, 0x9f, 0x9d, 0x2c, 0x94, 0x8b, 0x7f, 0x3c, 0x64, 0x12, 0x9b, 0x98,
+    0x25, 0x9b, 0x7b, 0x8d
+};
+static const unsigned char format_1_gcm[] = {
+    0x43, 0x50, 0x41, 0x53, 0x53, 0x01, 0x01, 0x19, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x38, 0xfa, 0xc5, 0x37, 0x18, 0xbb, 0x49, 0x0d,
+    0x21, 0xab, 0x50, 0xbe, 0xb3, 0xa2, 0x94, 0x4b, 0x4c, 0xe6, 0x2c, 0x67,
+    0xe4, 0xa1, 0x27, 0x1f, 0xe8, 0x1f, 0x1b, 0x23, 0xdd, 0x13, 0x32, 0x4d,
+    0x38, 0x29, 0x18, 0x37, 0x49, 0x90, 0x06, 0x20, 0xe0, 0x6a, 0x22, 0x45,
+    0x6e, 0x74, 0x1d, 0x68, 0x18, 0xf2, 0x12, 0xcc, 0xd7, 0xe2, 0x83, 0x3c,
+    0xd3, 0x34, 0x04, 0x8d, 0x6c, 0xa2, 0xc6, 0x9e, 0x3f, 0xf2, 0xe7, 0xba,
+    0xf0, 0xe4, 0xbf, 0x50, 0x94, 0x52
+};
+static const unsigned char format_1_chacha[] = {
+    0x43, 0x50, 0x41, 0x53, 0x53, 0x01, 0x02, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x7b, 0xf8, 0x00, 0x8e, 0x09, 0x05, 0x9a, 0x89,
+    0xea, 0x90, 0xa3, 0x40, 0x96, 0xa1, 0xe0, 0xe7, 0xf7, 0x2a, 0xdc, 0x71,
+    0x58, 0xd5, 0x35, 0xd3, 0x62, 0x92, 0xa8, 0xdd, 0xbf, 0x34, 0xfd, 0xbf,
+    0x22, 0xf6, 0xf6, 0x5f, 0x4b, 0x4b, 0xce, 0xbf, 0x86, 0x72, 0x2e, 0x35,
+    0x09, 0x67, 0x2b, 0x17, 0x25, 0x93, 0xd3, 0xf3, 0x01, 0xf5, 0xe1, 0xb0,
+    0x51, 0xe3, 0xcf, 0x3a, 0x95, 0xba, 0xa0, 0x63, 0xc0, 0xda, 0xda, 0xd7,
+    0xaa
+};
+
+
+/*
+ * Check the entries and the requirement every version has
+ */
+static void check_common_fields(const int version, struct password **passwords, const int num_passwords,
+    const struct password_requirement *requirement) {
+    CHECK(num_passwords == 2);
+    if (num_passwords != 2)
+        return;
+    CHECK(requirement->length == 14);
+    CHECK(requirement->uppercased == 2);
+    CHECK(requirement->digits == 3);
+    CHECK(requirement->special_characters == 1);
+    // The minimum strength was added after version 2, older vaults get the default
+    CHECK(requirement->min_strength == (version == 2 ? 3 : 4));
+    CHECK_STRING(passwords[0]->name, "mail");
+    CHECK_STRING(passwords[0]->username, "alice");
+    CHECK_STRING(passwords[0]->password, "hunter 2");
+    CHECK_STRING(passwords[0]->previous_password, "old\\pass");
+    CHECK_STRING(passwords[1]->name, "bank");
+    CHECK_STRING(passwords[1]->password, "p\nw");
+    CHECK(passwords[1]->previous_password == NULL);
+}
+
+
+/*
+ * Parse a vault of the given format version and check the fields it stores
+ */
+static void test_read_version(const int version, const char *cleartext) {
+    int num_passwords = 0;
+    struct password_requirement *requirement = read_password_requirement(cleartext);
+    struct password **passwords = read_passwords(cleartext, &num_passwords);
+    CHECK(requirement != NULL && passwords != NULL);
+    if (!requirement || !passwords)
+        return;
+    check_common_fields(version, passwords, num_passwords, requirement);
+    if (num_passwords == 2 && version >= 3) {
+        CHECK_STRING(passwords[0]->folder, "work/mail");
+        CHECK_STRING(passwords[0]->tags, "private,urgent");
+        CHECK_STRING(passwords[1]->folder, "finance");
+        CHECK(passwords[1]->tags == NULL);
+    }
+    CHECK(requirement->num_policies == (version >= 4 ? 1 : 0));
+    if (requirement->num_policies == 1) {
+        CHECK_STRING(requirement->policies[0].name, "web");
+        CHECK(requirement->policies[0].length == 16);
+        CHECK_STRING(requirement->policies[0].folders, "web");
+        CHECK(requirement->policies[0].max_age == (version >= 6 ? 30 : 0));
+    }
+    if (num_passwords == 2) {
+        CHECK_STRING(passwords[0]->attachments, version >= 5 ? "1:42:contract" : NULL);
+        CHECK(passwords[0]->created == (version >= 6 ? 1700000000 : 0));
+        CHECK(passwords[0]->changed == (version >= 6 ? 1700000100 : 0));
+        CHECK(passwords[1]->changed == (version >= 6 ? 1700000300 : 0));
+    }
+    CHECK(requirement->max_age == (version >= 6 ? 90 : 0));
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+}
+
+
+/*
+ * Parse a vault of an older format version, write it in the current one and parse it again.
+ * Nothing may be lost on the way
+ */
+static void test_upgrade(const int version, const char *cleartext) {
+    int num_passwords = 0;
+    struct password_requirement *requirement = read_password_requirement(cleartext);
+    struct password **passwords = read_passwords(cleartext, &num_passwords);
+    char *written = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &written));
+    if (!written)
+        return;
+    char header[32];
+    snprintf(header, sizeof(header), " %d ", VAULT_FORMAT_VERSION);
+    char *requirement_line = strndup(written, strcspn(written, "\n"));
+    CHECK(requirement_line && strstr(requirement_line, header) != NULL);
+    free(requirement_line);
+
+    int num_reread = 0;
+    struct password_requirement *reread_requirement = read_password_requirement(written);
+    struct password **reread = read_passwords(written, &num_reread);
+    check_common_fields(version, reread, num_reread, reread_requirement);
+    CHECK(num_reread == num_passwords);
+    for (int i = 0; i < num_passwords && i < num_reread; i++) {
+        CHECK_STRING(reread[i]->folder, passwords[i]->folder);
+        CHECK_STRING(reread[i]->tags, passwords[i]->tags);
+        CHECK_STRING(reread[i]->attachments, passwords[i]->attachments);
+        CHECK(reread[i]->created == passwords[i]->created);
+        CHECK(reread[i]->changed == passwords[i]->changed);
+    }
+    CHECK(reread_requirement->num_policies == requirement->num_policies);
+    CHECK(reread_requirement->max_age == requirement->max_age);
+
+    // Writing the parsed vault again yields the same text
+    char *rewritten = NULL;
+    CHECK(save_passwords_and_requirements(reread_requirement, reread, &num_reread, &rewritten));
+    CHECK_STRING(rewritten, written);
+
+    secure_free(written);
+    secure_free(rewritten);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_passwords(reread, num_reread);
+    free(reread);
+    free_password_requirement(requirement);
+    free_password_requirement(reread_requirement);
+}
+
+
+/*
+ * A policy line that does not compile any more, here because its minimums exceed its length, is not
+ * applied but written back unchanged, and still counts towards MAX_POLICIES
+ */
+static void test_unreadable_policy(void) {
+    const char *cleartext =
+        "14 2 3 1 6 4 2 90\n"
+        "short\\sone 4 0 3 3 3 0 3   web  30\n"
+        "web 16 0 2 1 1 0 3   web  30\n"
+        "mail alice hunter\\s2 old\\\\pass work/mail private,urgent 1:42:contract 1700000000 1700000100\n";
+    struct password_requirement *requirement = read_password_requirement(cleartext);
+    CHECK(requirement != NULL);
+    if (!requirement)
+        return;
+    CHECK(requirement->num_policies == 1);
+    CHECK(requirement->num_unreadable_policies == 1);
+    int num_passwords = 0;
+    struct password **passwords = read_passwords(cleartext, &num_passwords);
+    CHECK(num_passwords == 1);
+
+    char *written = NULL;
+    CHECK(save_passwords_and_requirements(requirement, passwords, &num_passwords, &written));
+    CHECK(written && strncmp(written, "14 2 3 1 6 4 2 90\n", 18) == 0);
+    CHECK(written && strstr(written, "\nshort\\sone 4 0 3 3 3 0 3   web  30\n") != NULL);
+    struct password_requirement *reread = read_password_requirement(written);
+    CHECK(reread && reread->num_policies == 1 && reread->num_unreadable_policies == 1);
+
+    struct password_policy policy = {.name = "extra", .length = 12, .min_strength = 0};
+    for (int i = 1; i < MAX_POLICIES - 1; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "extra-%d", i);
+        policy.name = name;
+        CHECK(set_password_policy(requirement, &policy));
+    }
+    policy.name = "one-too-many";
+    CHECK(!set_password_policy(requirement, &policy));
+
+    secure_free(written);
+    free_passwords(passwords, num_passwords);
+    free(passwords);
+    free_password_requirement(requirement);
+    free_password_requirement(reread);
+}
+
+
+/*
+ * Encrypt and decrypt a vault with every cipher suite and compression setting
+ */
+static void test_codecs(const char *directory) {
+    struct vault_key key;
+    CHECK(derive_vault_key("correct horse", &key));
+    struct vault_key other_key;
+    CHECK(derive_vault_key("wrong horse", &other_key));
+
+    // Repetitive enough for zlib to shrink it, long enough to span several cipher blocks
+    size_t size = 0;
+    char *cleartext = secure_malloc(64 * 1024);
+    memcpy(cleartext, version_6, strlen(version_6));
+    size = strlen(version_6);
+    for (int i = 0; size + 64 < 64 * 1024; i++)
+        size += (size_t) snprintf(cleartext + size, 64, "entry%d user%d secret%d\n", i, i % 7, i * 31);
+    cleartext[size] = '\0';
+
+    const char *const codecs[] = {"none", "zlib:1", "zlib:9"};
+    char path[256];
+    test_path(path, directory, "codec.vault");
+    for (int suite = 0; suite < CIPHER_SUITE_COUNT; suite++) {
+        for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+            struct vault_encoding encoding = {(enum cipher_suite) suite, CODEC_NONE, 0};
+            CHECK(parse_vault_codec(codecs[c], &encoding.codec, &encoding.level));
+            const uint64_t version = 100 + (uint64_t) suite * 10 + c;
+            CHECK(encrypt_file_as(path, &cleartext, &key, version, &encoding));
+            CHECK(read_vault_version(path) == version);
+
+            char *decrypted = NULL;
+            uint64_t read_version = 0;
+            CHECK(decrypt_file(path, &decrypted, &key, &read_version));
+            CHECK(read_version == version);
+            CHECK(decrypted && strcmp(decrypted, cleartext) == 0);
+            secure_free(decrypted);
+
+            // CBC cannot tell a wrong key from damaged padding in every case, the AEAD suites always can
+            if (suite != CIPHER_AES_256_CBC) {
+                decrypted = NULL;
+                CHECK(!decrypt_file(path, &decrypted, &other_key, NULL));
+                secure_free(decrypted);
+            }
+        }
+    }
+    remove(path);
+    secure_free(cleartext);
+}
+
+
+/*
+ * Write bytes to a file
+ */
+static bool write_bytes(const char *path, const unsigned char *bytes, const size_t size) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+    const bool written = fwrite(bytes, 1, size, file) == size;
+    return fclose(file) == 0 && written;
+}
+
+
+/*
+ * Files written before the key was bound to the cipher suite are still read
+ */
+static void test_unbound_format(const char *directory) {
+    struct vault_key key;
+    CHECK(derive_vault_key("correct horse", &key));
+    const unsigned char *const files[] = {format_1_cbc, format_1_gcm, format_1_chacha};
+    const size_t sizes[] = {sizeof(format_1_cbc), sizeof(format_1_gcm), sizeof(format_1_chacha)};
+    char path[256];
+    test_path(path, directory, "format_1.vault");
+    for (int i = 0; i < 3; i++) {
+        CHECK(write_bytes(path, files[i], sizes[i]));
+        char *decrypted = NULL;
+        uint64_t version = 0;
+        CHECK(decrypt_file(path, &decrypted, &key, &version));
+        CHECK(version == 7);
+        CHECK_STRING(decrypted, format_1_cleartext);
+        secure_free(decrypted);
+    }
+    remove(path);
+}
+
+
+/*
+ * A compressed file whose ciphertext was changed fails on its tag and is never inflated
+ */
+static void test_tampered_compressed(const char *directory) {
+    struct vault_key key;
+    CHECK(derive_vault_key("correct horse", &key));
+    char path[256];
+    test_path(path, directory, "tampered.vault");
+    const struct vault_encoding encoding = {CIPHER_AES_256_GCM, CODEC_ZLIB, 9};
+    char *cleartext = secure_strdup(version_6);
+    CHECK(encrypt_file_as(path, &cleartext, &key, 1, &encoding));
+    secure_free(cleartext);
+
+    FILE *file = fopen(path, "r+b");
+    CHECK(file != NULL);
+    if (!file)
+        return;
+    // The first byte of the ciphertext follows the header and the nonce
+    fseek(file, VAULT_HEADER_SIZE + 12, SEEK_SET);
+    const int byte = fgetc(file);
+    fseek(file, VAULT_HEADER_SIZE + 12, SEEK_SET);
+    fputc(byte ^ 0x01, file);
+    fclose(file);
+    char *decrypted = NULL;
+    CHECK(!decrypt_file(path, &decrypted, &key, NULL));
+    CHECK(decrypted == NULL);
+    remove(path);
+}
+
+
+int main(void) {
+    test_read_version(2, version_2);
+    test_read_version(3, version_3);
+    test_read_version(4, version_4);
+    test_read_version(5, version_5);
+    test_read_version(6, version_6);
+    test_upgrade(2, version_2);
+    test_upgrade(3, version_3);
+    test_upgrade(4, version_4);
+    test_upgrade(5, version_5);
+    test_upgrade(6, version_6);
+    test_unreadable_policy();
+
+    char directory[64];
+    CHECK(make_test_directory(directory));
+    test_codecs(directory);
+    test_unbound_format(directory);
+    test_tampered_compressed(directory);
+    remove_test_directory(directory);
+    return test_result("vault_format");
+}
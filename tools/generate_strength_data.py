@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""
+Generate src/strength_data.c, the static tables of the password strength estimator.
+
+The dictionaries are emitted as one sorted array, so the estimator can walk it like a
+trie by narrowing a range per character, and the keyboard graphs as fixed adjacency
+tables indexed by character. Everything ends up in read-only data of the executable,
+nothing has to be parsed or allocated at startup.
+
+Usage: python3 tools/generate_strength_data.py > src/strength_data.c
+"""
+
+import sys
+
+# Ordered by frequency, the position is the rank used by the estimator
+COMMON_PASSWORDS = """
+123456 password 12345678 qwerty 123456789 12345 1234 111111 1234567 dragon
+123123 baseball abc123 football monkey letmein 696969 shadow master 666666
+qwertyuiop 123321 mustang 1234567890 michael 654321 superman 1qaz2wsx 7777777 121212
+000000 qazwsx 123qwe killer trustno1 jordan jennifer zxcvbnm asdfgh hunter
+buster soccer harley batman andrew tigger sunshine iloveyou 2000 charlie
+robert thomas hockey ranger daniel starwars klaster 112233 george computer
+michelle jessica pepper 1111 zxcvbn 555555 11111111 131313 freedom 777777
+pass maggie 159753 aaaaaa ginger princess joshua cheese amanda summer
+love ashley nicole chelsea biteme matthew access yankees 987654321 dallas
+austin thunder taylor matrix minecraft william corvette hello martin heather
+secret merlin diamond 1234qwer gfhjkm hammer silver 222222 88888888 anthony
+justin test bailey q1w2e3r4t5 patrick internet scooter orange 11111 golfer
+cookie richard samantha bigdog guitar jackson whatever mickey chicken sparky
+snoopy maverick phoenix camaro peanut morgan welcome falcon cowboy ferrari
+samsung andrea smokey steelers joseph mercedes dakota arsenal eagles melissa
+boomer booboo spider nascar monster tigers yellow xxxxxx 123123123 gateway
+marina diablo bulldog qwer1234 compaq purple hardcore banana junior hannah
+123654 porsche lakers iceman money cowboys 987654 london tennis 999999
+ncc1701 coffee scooby 0000 miller boston q1w2e3r4 brandon yamaha chester
+mother forever johnny edward 333333 oliver redsox player nikita knight
+fender barney midnight please brandy chicago badboy slayer rangers charles
+angel flower rabbit wizard jasper enter rachel chris steven winner
+adidas victoria natasha 1q2w3e4r jasmine winter prince marine
+ghbdtn fishing cocacola casper james 232323 raiders 888888 marlboro gandalf
+asdfasdf crystal 87654321 12344321 golden 8675309 7777 lovely
+liverpool qwerty123 password1 passw0rd p@ssw0rd p@ssword welcome1 admin
+admin123 root toor letmein1 changeme default guest login abcdef abcd1234
+azerty iloveu loveme trustme 1q2w3e 1qaz2wsx3edc zaq12wsx qweasd qweasdzxc
+asdf qwert asdfghjkl 123abc a123456 123456a password123 pass123 hello123
+monkey123 dragon123 football1 baseball1 superman1 starwars1 qwerty1 abc1234
+secret123 master123 shadow123 michael1 jordan23 killer123 sunshine1
+princess1 iloveyou1 charlie1 letmein123 welcome123 freedom1 whatever1
+""".split()
+
+# Common English words, roughly by frequency
+ENGLISH_WORDS = """
+you the and that have for not with this but his they her she will one all would
+there their what out about who get which when make can like time just him know
+take people into year your good some could them see other than then now look only
+come its over think also back after use two how our work first well way even new
+want because any these give day most find here thing many tell very through still
+call should never world life down last where long great little own old right big
+high different small large next early young important few public bad same able
+child woman man house school home family group country problem hand part place
+case week company system program question government number night point city play
+money story fact month lot study book eye job word business issue side kind head
+friend father mother brother sister power hour game line end member law car
+water room area office door health person art war history party result change
+morning reason research girl guy moment air teacher force education foot boy age
+policy music market sense nation plan college interest death experience effect
+class control care field development role effort rate heart drug show leader
+light voice wife police mind price report decision son view relationship town
+road arm difference value building action model season society tax director
+position player record paper space ground form event official matter center
+couple site project activity star table need court oil situation cost industry
+figure street image phone data picture practice piece land product doctor wall
+patient worker news test movie north love support technology step baby computer
+type attention film tree source organization hair window evidence population
+site truth fire summer winter spring autumn fall happy sunny rain snow storm
+cloud wind ocean river lake mountain forest garden flower rose lily apple orange
+banana cherry lemon grape peach mango berry strawberry chocolate coffee cookie
+candy sugar honey bread butter cheese pizza pasta burger chicken turkey bacon
+tiger lion bear wolf eagle hawk falcon shark whale dolphin horse pony dog puppy
+cat kitty kitten mouse rabbit bunny dragon snake spider monkey panda zebra
+red blue green yellow purple black white silver golden gold pink brown gray
+grey orange violet crimson scarlet diamond crystal pearl ruby emerald
+sapphire jade amber ivory magic secret hidden shadow ghost angel devil demon
+heaven hell paradise dream sweet cute pretty beautiful lovely happy lucky
+crazy wild cool hot fast super mega ultra power strong brave hero legend king
+queen prince princess knight warrior soldier hunter ninja samurai pirate
+wizard witch master lord god jesus christ freedom liberty justice peace unity
+victory glory honor spirit soul heart mind body blood bone skull death life
+live die kill fight battle war army navy marine pilot rocket space planet
+moon sun star galaxy universe earth world nature animal bird fish
+football soccer baseball basketball hockey tennis golf rugby cricket boxing
+racing runner skater surfer rider driver gamer player winner champion
+summer monday tuesday wednesday thursday friday saturday sunday january
+february march april may june july august september october november december
+hello welcome please thanks sorry goodbye morning evening night today
+tomorrow yesterday always forever never again alone together family friends
+lover baby darling honey sweetie angel buddy brother sister mother father
+password letmein admin login access secret private security computer internet
+network server system email phone mobile apple google yahoo facebook twitter
+music guitar piano drums rock metal punk jazz blues dance party disco
+school college student teacher doctor nurse lawyer police fireman
+london paris berlin rome tokyo moscow china japan india canada mexico america
+texas florida california boston chicago dallas denver miami vegas seattle
+""".split()
+
+# Common first names and surnames
+NAMES = """
+james john robert michael william david richard joseph thomas charles christopher
+daniel matthew anthony mark donald steven paul andrew joshua kenneth kevin brian
+george timothy ronald edward jason jeffrey ryan jacob gary nicholas eric jonathan
+stephen larry justin scott brandon benjamin samuel gregory alexander frank patrick
+raymond jack dennis jerry tyler aaron jose adam nathan henry douglas zachary peter
+kyle ethan walter noah jeremy christian keith roger terry gerald harold sean austin
+carl arthur lawrence dylan jesse jordan bryan billy joe bruce gabriel logan albert
+willie alan juan wayne elijah randy roy vincent ralph eugene russell bobby mason
+philip louis mary patricia jennifer linda elizabeth barbara susan jessica sarah
+karen lisa nancy betty margaret sandra ashley kimberly emily donna michelle carol
+amanda dorothy melissa deborah stephanie rebecca sharon laura cynthia kathleen amy
+angela shirley anna brenda pamela emma nicole helen samantha katherine christine
+debra rachel carolyn janet catherine maria heather diane ruth julie olivia joyce
+virginia victoria kelly lauren christina joan evelyn judith megan andrea cheryl
+hannah jacqueline martha gloria teresa ann sara madison frances kathryn janice
+jean abigail alice judy sophia grace denise amber doris marilyn danielle beverly
+isabella theresa diana natalie brittany charlotte marie kayla alexis lori alex
+max sam ben tom tim jim bob bill mike dave steve chris matt nick josh jake luke
+anna lucy lily ella mia zoe chloe sophie jessie katie kate jenny annie molly
+smith johnson williams brown jones garcia miller davis rodriguez martinez
+hernandez lopez gonzalez wilson anderson taylor moore jackson martin lee perez
+thompson harris sanchez clark ramirez lewis robinson walker young allen king
+wright scott torres nguyen hill flores green adams nelson baker hall rivera
+campbell mitchell carter roberts gomez phillips evans turner diaz parker cruz
+edwards collins reyes stewart morris morales murphy cook rogers gutierrez ortiz
+morgan cooper peterson bailey reed kelly howard ramos kim cox ward richardson
+watson brooks chavez wood bennett gray mendoza ruiz hughes price alvarez
+castillo sanders patel myers long ross foster jimenez
+""".split()
+
+DICTIONARIES = [
+    ("DICTIONARY_PASSWORDS", COMMON_PASSWORDS),
+    ("DICTIONARY_ENGLISH", ENGLISH_WORDS),
+    ("DICTIONARY_NAMES", NAMES),
+]
+
+QWERTY = r"""
+`~ 1! 2@ 3# 4$ 5% 6^ 7& 8* 9( 0) -_ =+
+    qQ wW eE rR tT yY uU iI oO pP [{ ]} \|
+     aA sS dD fF gG hH jJ kK lL ;: '"
+      zZ xX cC vV bB nN mM ,< .> /?
+"""
+
+KEYPAD = r"""
+  / * -
+7 8 9 +
+4 5 6
+1 2 3
+  0 .
+"""
+
+MAX_NEIGHBORS = 8
+
+
+def slanted_neighbors(x, y):
+    return [(x - 1, y), (x, y - 1), (x + 1, y - 1), (x + 1, y), (x, y + 1), (x - 1, y + 1)]
+
+
+def aligned_neighbors(x, y):
+    return [(x - 1, y), (x - 1, y - 1), (x, y - 1), (x + 1, y - 1),
+            (x + 1, y), (x + 1, y + 1), (x, y + 1), (x - 1, y + 1)]
+
+
+def build_graph(layout, slanted):
+    positions = {}
+    token_size = len(layout.split()[0])
+    x_unit = token_size + 1
+    for y, line in enumerate(layout.split("\n")):
+        slant = y - 1 if slanted else 0
+        for token in line.split():
+            x = (line.index(token) - slant) // x_unit
+            positions[(x, y)] = token
+    neighbors = slanted_neighbors if slanted else aligned_neighbors
+    graph = {}
+    for (x, y), token in positions.items():
+        for char in token:
+            graph[char] = [positions.get(coord) for coord in neighbors(x, y)]
+    return graph
+
+
+def c_char(char):
+    if char == "\\" or char == "'":
+        return "'\\" + char + "'"
+    return "'" + char + "'"
+
+
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def emit_graph(out, name, graph):
+    degrees = [sum(1 for n in adjacent if n) for adjacent in graph.values()]
+    starting_positions = len(graph)
+    average_degree = sum(degrees) / len(degrees)
+    out.append("const struct keyboard_graph %s = {" % name)
+    out.append("    %d, %.6f, {" % (starting_positions, average_degree))
+    for char in sorted(graph):
+        cells = []
+        for adjacent in graph[char] + [None] * (MAX_NEIGHBORS - len(graph[char])):
+            if adjacent is None:
+                cells.append("{0}")
+            else:
+                cells.append("{" + ", ".join(c_char(c) for c in adjacent) + "}")
+        out.append("        [%s] = {%s}," % (c_char(char), ", ".join(cells)))
+    out.append("    }")
+    out.append("};")
+
+
+def main():
+    ranked = {}
+    for dictionary, words in DICTIONARIES:
+        rank = 0
+        seen = set()
+        for word in words:
+            word = word.lower()
+            if word in seen:
+                continue
+            seen.add(word)
+            rank += 1
+            # A word listed in several dictionaries keeps its best rank
+            if word not in ranked or rank < ranked[word][1]:
+                ranked[word] = (dictionary, rank)
+
+    out = [
+        "// Generated by tools/generate_strength_data.py, do not edit by hand",
+        "",
+        '#include "strength_data.h"',
+        "",
+        "const struct dictionary_word dictionary_words[] = {",
+    ]
+    for word in sorted(ranked):
+        dictionary, rank = ranked[word]
+        out.append("    {%s, %d, %s}," % (c_string(word), rank, dictionary))
+    out.append("};")
+    out.append("const int num_dictionary_words = %d;" % len(ranked))
+    out.append("")
+    emit_graph(out, "qwerty_graph", build_graph(QWERTY, True))
+    out.append("")
+    emit_graph(out, "keypad_graph", build_graph(KEYPAD, False))
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()